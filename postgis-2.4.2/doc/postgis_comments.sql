@@ -681,6 +681,8 @@ COMMENT ON FUNCTION ST_Node(geometry ) IS 'args: geom - Node a set of linestring
 			
 COMMENT ON FUNCTION ST_OffsetCurve(geometry , float , text ) IS 'args: line, signed_distance, style_parameters='' - Return an offset line at a given distance and side from an input line. Useful for computing parallel lines about a center line';
 			
+COMMENT ON AGGREGATE ST_ParallelUnion(geometry) IS 'args: g1field - Same as the ST_Union aggregate, but unions its input in bounded-size batches and can run as a parallel aggregate.';
+			
 COMMENT ON FUNCTION ST_RemoveRepeatedPoints(geometry, float8) IS 'args: geom, tolerance - Returns a version of the given geometry with duplicated points removed.';
 			
 COMMENT ON FUNCTION ST_SharedPaths(geometry, geometry) IS 'args: lineal1, lineal2 - Returns a collection containing paths shared by the two input linestrings/multilinestrings.';
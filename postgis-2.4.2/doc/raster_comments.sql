@@ -343,6 +343,10 @@ COMMENT ON FUNCTION ST_Quantile(text , text , integer , boolean , double precisi
 			
 COMMENT ON FUNCTION ST_Quantile(text , text , integer , double precision[] ) IS 'args: rastertable, rastercolumn, nband, quantiles - Compute quantiles for a raster or raster table coverage in the context of the sample or population. Thus, a value could be examined to be at the rasters 25%, 50%, 75% percentile.';
 			
+COMMENT ON AGGREGATE ST_QuantileAgg(raster, integer, boolean, double precision[]) IS 'args: rast, nband, exclude_nodata_value, quantiles - Aggregate. Returns the values at the given quantiles of a given raster band of a set of rasters. Band 1 is assumed if no band is specified.';
+			
+COMMENT ON AGGREGATE ST_QuantileAgg(raster, double precision[]) IS 'args: rast, quantiles - Aggregate. Returns the values at the given quantiles of a given raster band of a set of rasters. Band 1 is assumed if no band is specified.';
+			
 COMMENT ON FUNCTION ST_SummaryStats(raster , boolean ) IS 'args: rast, exclude_nodata_value - Returns summarystats consisting of count, sum, mean, stddev, min, max for a given raster band of a raster or raster coverage. Band 1 is assumed is no band is specified.';
 			
 COMMENT ON FUNCTION ST_SummaryStats(raster , integer , boolean ) IS 'args: rast, nband, exclude_nodata_value - Returns summarystats consisting of count, sum, mean, stddev, min, max for a given raster band of a raster or raster coverage. Band 1 is assumed is no band is specified.';
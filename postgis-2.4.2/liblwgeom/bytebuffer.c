@@ -180,6 +180,27 @@ bytebuffer_get_buffer_copy(const bytebuffer_t *s, size_t *buffer_length)
 	return buf;
 }
 
+/**
+* Hands the internal buffer over to the caller, who becomes responsible
+* for freeing it. Only a buffer living in the static area is copied.
+* The bytebuffer_t must not be used afterwards.
+*/
+uint8_t*
+bytebuffer_release_buffer(bytebuffer_t *s, size_t *buffer_length)
+{
+	uint8_t *buf;
+
+	if ( s->buf_start == s->buf_static )
+		return bytebuffer_get_buffer_copy(s, buffer_length);
+
+	if ( buffer_length )
+		*buffer_length = bytebuffer_getlength(s);
+	buf = s->buf_start;
+	s->buf_start = s->writecursor = s->readcursor = s->buf_static;
+	s->capacity = BYTEBUFFER_STATICSIZE;
+	return buf;
+}
+
 /** Returns a read-only reference to the internal buffer */
 const uint8_t*
 bytebuffer_get_buffer(const bytebuffer_t *s, size_t *buffer_length)
@@ -245,6 +266,24 @@ bytebuffer_append_varint(bytebuffer_t *b, const int64_t val)
 	return;
 }
 
+/**
+* Writes an array of signed varInts to the buffer, making room
+* for a block of values at a time rather than for each one.
+*/
+void
+bytebuffer_append_varint_array(bytebuffer_t *b, const int64_t *vals, size_t nvals)
+{
+	while ( nvals > 0 )
+	{
+		size_t n = nvals < 256 ? nvals : 256;
+		bytebuffer_makeroom(b, n * VARINT_MAX_SIZE);
+		b->writecursor += varint_s64_encode_array(vals, n, b->writecursor);
+		vals += n;
+		nvals -= n;
+	}
+	return;
+}
+
 /**
 * Writes a unsigned varInt to the buffer
 */
@@ -1183,6 +1183,128 @@ static void test_kmeans(void)
 	return;
 }
 
+/*
+* Every point of a converged clustering is closest to the mean
+* of its own cluster.
+*/
+static void
+check_kmeans_converged(LWGEOM **geoms, int N, int k, const int *r)
+{
+	POINT2D *means = lwalloc(sizeof(POINT2D) * k);
+	int *counts = lwalloc(sizeof(int) * k);
+	int i, c, bad = 0;
+
+	memset(means, 0, sizeof(POINT2D) * k);
+	memset(counts, 0, sizeof(int) * k);
+	for (i = 0; i < N; i++)
+	{
+		const POINT2D *p;
+		if (r[i] < 0) continue;
+		CU_ASSERT(r[i] < k);
+		p = getPoint2d_cp(lwgeom_as_lwpoint(geoms[i])->point, 0);
+		means[r[i]].x += p->x;
+		means[r[i]].y += p->y;
+		counts[r[i]]++;
+	}
+	for (c = 0; c < k; c++)
+	{
+		if (!counts[c]) continue;
+		means[c].x /= counts[c];
+		means[c].y /= counts[c];
+	}
+	for (i = 0; i < N; i++)
+	{
+		const POINT2D *p;
+		double d_own;
+		if (r[i] < 0) continue;
+		p = getPoint2d_cp(lwgeom_as_lwpoint(geoms[i])->point, 0);
+		d_own = distance2d_sqr_pt_pt(p, &means[r[i]]);
+		for (c = 0; c < k; c++)
+			if (counts[c] && distance2d_sqr_pt_pt(p, &means[c]) < d_own - 1e-9)
+				bad++;
+	}
+	CU_ASSERT_EQUAL(bad, 0);
+
+	lwfree(means);
+	lwfree(counts);
+}
+
+static void test_kmeans_many_clusters(void)
+{
+	int num_clusters = 60;
+	int cluster_size = 40;
+	int N = num_clusters * cluster_size + 2;
+	LWGEOM **geoms = lwalloc(sizeof(LWGEOM*) * N);
+	int *r, *r2;
+	int i, j, n = 0;
+
+	/* Tight blobs on a grid, far apart from each other */
+	for (j = 0; j < num_clusters; j++)
+	{
+		for (i = 0; i < cluster_size; i++)
+		{
+			double x = 100 * (j % 8) + (i % 7) * 0.1;
+			double y = 100 * (j / 8) + (i / 7) * 0.1;
+			geoms[n++] = lwpoint_as_lwgeom(lwpoint_make2d(SRID_UNKNOWN, x, y));
+		}
+	}
+	/* Empties and NULLs stay out of the clusters */
+	geoms[n++] = lwpoint_as_lwgeom(lwpoint_construct_empty(SRID_UNKNOWN, 0, 0));
+	geoms[n++] = NULL;
+
+	r = lwgeom_cluster_2d_kmeans((const LWGEOM **)geoms, N, num_clusters);
+	CU_ASSERT(r != NULL);
+	CU_ASSERT_EQUAL(r[N-2], -1);
+	CU_ASSERT_EQUAL(r[N-1], -1);
+	check_kmeans_converged(geoms, N, num_clusters, r);
+
+	/* Blobs end up whole, in clusters of their own */
+	for (j = 0; j < num_clusters; j++)
+	{
+		for (i = 1; i < cluster_size; i++)
+			CU_ASSERT_EQUAL(r[j * cluster_size + i], r[j * cluster_size]);
+		if (j > 0)
+			CU_ASSERT_NOT_EQUAL(r[j * cluster_size], r[(j - 1) * cluster_size]);
+	}
+
+	/* Seeding is repeatable */
+	r2 = lwgeom_cluster_2d_kmeans((const LWGEOM **)geoms, N, num_clusters);
+	CU_ASSERT_EQUAL(memcmp(r, r2, sizeof(int) * N), 0);
+
+	lwfree(r);
+	lwfree(r2);
+	for (i = 0; i < N; i++)
+		if (geoms[i]) lwgeom_free(geoms[i]);
+	lwfree(geoms);
+}
+
+static void test_kmeans_minibatch(void)
+{
+	int N = 60000;
+	int k = 30;
+	LWGEOM **geoms = lwalloc(sizeof(LWGEOM*) * N);
+	int *r;
+	int i;
+
+	/* Large enough for the mini-batch warm start */
+	srand(42);
+	for (i = 0; i < N; i++)
+	{
+		double x = 1000.0 * rand() / RAND_MAX;
+		double y = 1000.0 * rand() / RAND_MAX;
+		geoms[i] = lwpoint_as_lwgeom(lwpoint_make2d(SRID_UNKNOWN, x, y));
+	}
+
+	r = lwgeom_cluster_2d_kmeans((const LWGEOM **)geoms, N, k);
+	CU_ASSERT(r != NULL);
+	check_kmeans_converged(geoms, N, k, r);
+
+	lwfree(r);
+	for (i = 0; i < N; i++)
+		lwgeom_free(geoms[i]);
+	lwfree(geoms);
+}
+
 /*
 ** Used by test harness to register the tests in this file.
 */
@@ -1210,6 +1332,8 @@ void algorithms_suite_setup(void)
 	PG_ADD_TEST(suite,test_lw_arc_center);
 	PG_ADD_TEST(suite,test_point_density);
 	PG_ADD_TEST(suite,test_kmeans);
+	PG_ADD_TEST(suite,test_kmeans_many_clusters);
+	PG_ADD_TEST(suite,test_kmeans_minibatch);
 	PG_ADD_TEST(suite,test_median_handles_3d_correctly);
 	PG_ADD_TEST(suite,test_median_robustness);
 	PG_ADD_TEST(suite,test_lwpoly_construct_circle);
@@ -69,6 +69,64 @@ static void do_test_lwgeom_effectivearea_polys(void)
 	lwpoly_free(the_geom);
 }
 
+static void do_test_lwgeom_effectivearea_coverage(void)
+{
+	LWGEOM *geoms[4];
+	LWGEOM **out;
+	LWGEOM *alone;
+	char *ewkt, *ewkt_alone;
+	int i;
+
+	/* Two squares sharing a wiggly edge, a polygon of its own, a null and a line */
+	geoms[0] = lwgeom_from_wkt("POLYGON((0 0,0 10,10 10,10 8,10.1 5,10 2,10 0,0 0))", LW_PARSER_CHECK_NONE);
+	geoms[1] = lwgeom_from_wkt("MULTIPOLYGON(((10 0,10 2,10.1 5,10 8,10 10,20 10,20 0,10 0)))", LW_PARSER_CHECK_NONE);
+	geoms[2] = lwgeom_from_wkt("POLYGON((10 10,12 8, 15 7, 18 7, 20 20, 15 21, 18 22, 10 30,1 99, 0 100, 10 10))", LW_PARSER_CHECK_NONE);
+	geoms[3] = NULL;
+
+	out = lwgeom_set_effective_area_coverage(geoms, 4, 1);
+
+	ewkt = lwgeom_to_ewkt(out[0]);
+	ASSERT_STRING_EQUAL(ewkt, "POLYGON((0 0,0 10,10 10,10 0,0 0))");
+	lwfree(ewkt);
+	ewkt = lwgeom_to_ewkt(out[1]);
+	ASSERT_STRING_EQUAL(ewkt, "MULTIPOLYGON(((10 0,10 10,20 10,20 0,10 0)))");
+	lwfree(ewkt);
+	CU_ASSERT(out[3] == NULL);
+
+	/* Not touching anything, it is simplified as by itself */
+	alone = lwgeom_set_effective_area(geoms[2], 0, 1);
+	ewkt = lwgeom_to_ewkt(out[2]);
+	ewkt_alone = lwgeom_to_ewkt(alone);
+	ASSERT_STRING_EQUAL(ewkt, ewkt_alone);
+	lwfree(ewkt);
+	lwfree(ewkt_alone);
+	lwgeom_free(alone);
+
+	for (i = 0; i < 3; i++)
+	{
+		lwgeom_free(out[i]);
+		lwgeom_free(geoms[i]);
+	}
+	lwfree(out);
+
+	/* An island filling a hole keeps filling it */
+	geoms[0] = lwgeom_from_wkt("POLYGON((0 0,0 30,30 30,30 0,0 0),(10 10,20 10,20 20,15 20.1,10 20,10 10))", LW_PARSER_CHECK_NONE);
+	geoms[1] = lwgeom_from_wkt("POLYGON((10 10,10 20,15 20.1,20 20,20 10,10 10))", LW_PARSER_CHECK_NONE);
+	out = lwgeom_set_effective_area_coverage(geoms, 2, 1);
+	ewkt = lwgeom_to_ewkt(out[0]);
+	ASSERT_STRING_EQUAL(ewkt, "POLYGON((0 0,0 30,30 30,30 0,0 0),(10 10,20 10,20 20,10 20,10 10))");
+	lwfree(ewkt);
+	ewkt = lwgeom_to_ewkt(out[1]);
+	ASSERT_STRING_EQUAL(ewkt, "POLYGON((10 10,10 20,20 20,20 10,10 10))");
+	lwfree(ewkt);
+	for (i = 0; i < 2; i++)
+	{
+		lwgeom_free(out[i]);
+		lwgeom_free(geoms[i]);
+	}
+	lwfree(out);
+}
+
 
 void effectivearea_suite_setup(void);
 void effectivearea_suite_setup(void)
@@ -76,4 +134,5 @@ void effectivearea_suite_setup(void)
 	CU_pSuite suite = CU_add_suite("effectivearea",NULL,NULL);
 	PG_ADD_TEST(suite, do_test_lwgeom_effectivearea_lines);
 	PG_ADD_TEST(suite, do_test_lwgeom_effectivearea_polys);
+	PG_ADD_TEST(suite, do_test_lwgeom_effectivearea_coverage);
 }
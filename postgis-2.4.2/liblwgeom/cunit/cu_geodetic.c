@@ -1332,6 +1332,59 @@ static void test_spheroid_distance(void)
 
 }
 
+static void test_spheroid_distance_batch(void)
+{
+	GEOGRAPHIC_POINT g[5], h[5];
+	double d[5];
+	double length, total;
+	LWGEOM *lwg1, *lwg2;
+	SPHEROID s;
+	int i;
+
+	/* Init to WGS84 */
+	spheroid_init(&s, 6378137.0, 6356752.314245179498);
+
+	point_set(0.0, 0.0, &g[0]);
+	point_set(-10.0, 0.0, &g[1]);
+	point_set(-180.0, 0.0, &g[2]);
+	point_set(0.0, 90.0, &g[3]);
+	point_set(-80.0, -45.0, &g[4]);
+	for ( i = 0; i < 5; i++ )
+		point_set(10.0 * i, 10.0 * i - 20.0, &h[i]);
+
+	/* Pairwise batch matches pair by pair */
+	spheroid_distance_batch(g, h, 5, &s, d);
+	for ( i = 0; i < 5; i++ )
+		CU_ASSERT_DOUBLE_EQUAL(d[i], spheroid_distance(&g[i], &h[i], &s), 1e-8);
+
+	/* Chained batch, segments of a point array */
+	spheroid_distance_batch(g, g + 1, 4, &s, d);
+	for ( i = 0; i < 4; i++ )
+		CU_ASSERT_DOUBLE_EQUAL(d[i], spheroid_distance(&g[i], &g[i+1], &s), 1e-8);
+
+	/* Line length is the sum of the segment distances */
+	lwg1 = lwgeom_from_wkt("LINESTRING(0 0,-10 0,-180 0,0 90,-80 -45)", LW_PARSER_CHECK_NONE);
+	length = lwgeom_length_spheroid(lwg1, &s);
+	for ( i = 0, total = 0.0; i < 4; i++ )
+		total += d[i];
+	CU_ASSERT_DOUBLE_EQUAL(length, total, 1e-6);
+	lwgeom_free(lwg1);
+
+	/* Point set distance matches the nearest pair */
+	lwg1 = lwgeom_from_wkt("MULTIPOINT(0 0,-10 0,-180 0,0 90,-80 -45)", LW_PARSER_CHECK_NONE);
+	lwg2 = lwgeom_from_wkt("MULTIPOINT(0 -20,10 -10,20 0,30 10,40 20)", LW_PARSER_CHECK_NONE);
+	total = FLT_MAX;
+	for ( i = 0; i < 25; i++ )
+	{
+		double dd = spheroid_distance(&g[i/5], &h[i%5], &s);
+		if ( dd < total )
+			total = dd;
+	}
+	CU_ASSERT_DOUBLE_EQUAL(lwgeom_distance_spheroid(lwg1, lwg2, &s, 0.0), total, 1e-8);
+	lwgeom_free(lwg1);
+	lwgeom_free(lwg2);
+}
+
 static void test_spheroid_area(void)
 {
 	LWGEOM *lwg;
@@ -1612,6 +1665,7 @@ void geodetic_suite_setup(void)
 	PG_ADD_TEST(suite, test_lwgeom_check_geodetic);
 	PG_ADD_TEST(suite, test_gserialized_from_lwgeom);
 	PG_ADD_TEST(suite, test_spheroid_distance);
+	PG_ADD_TEST(suite, test_spheroid_distance_batch);
 	PG_ADD_TEST(suite, test_spheroid_area);
 	PG_ADD_TEST(suite, test_lwpoly_covers_point2d);
 	PG_ADD_TEST(suite, test_gbox_utils);
@@ -124,6 +124,94 @@ static void test_geos_subdivide(void)
 #endif
 }
 
+static void test_geos_subdivide_polygon(void)
+{
+	/* Comb with a hole, cut across its teeth */
+	char *ewkt = "POLYGON((0 0,100 0,100 100,90 100,90 10,80 10,80 100,70 100,70 10,60 10,60 100,50 100,50 10,40 10,40 100,30 100,30 10,20 10,20 100,10 100,10 10,0 10,0 0),(2 2,2 8,98 8,98 2,2 2))";
+	LWGEOM *geom1 = lwgeom_from_wkt(ewkt, LW_PARSER_CHECK_NONE);
+	LWGEOM *geom2 = lwgeom_segmentize2d(geom1, 5.0);
+	LWSUBDIVIDEITERATOR *it;
+	LWCOLLECTION *geom3;
+	LWGEOM *piece;
+	double area = 0;
+	int i, n = 0;
+
+	geom3 = lwgeom_subdivide(geom2, 16);
+	for ( i = 0; i < geom3->ngeoms; i++ )
+	{
+		CU_ASSERT_EQUAL(geom3->geoms[i]->type, POLYGONTYPE);
+		CU_ASSERT(lwgeom_count_vertices(geom3->geoms[i]) < 16);
+		area += lwgeom_area(geom3->geoms[i]);
+	}
+	CU_ASSERT_DOUBLE_EQUAL(area, lwgeom_area(geom2), 1e-8);
+
+	/* The iterator hands out the same pieces, in the same order */
+	it = lwsubdivideiterator_create(geom2, 16);
+	while ( (piece = lwsubdivideiterator_next(it)) )
+	{
+		if ( n < geom3->ngeoms )
+			CU_ASSERT(lwgeom_same(piece, geom3->geoms[n]));
+		lwgeom_free(piece);
+		n++;
+	}
+	lwsubdivideiterator_destroy(it);
+	CU_ASSERT_EQUAL(n, geom3->ngeoms);
+
+	lwcollection_free(geom3);
+	lwgeom_free(geom2);
+	lwgeom_free(geom1);
+}
+
+static int
+subdivide_piece_is_clean(const LWGEOM *geom)
+{
+	GEOSGeometry *g;
+	LWGEOM *clean;
+	int valid, repeated;
+
+	initGEOS(lwnotice, lwgeom_geos_error);
+	g = LWGEOM2GEOS(geom, 0);
+	valid = GEOSisValid(g);
+	GEOSGeom_destroy(g);
+
+	clean = lwgeom_remove_repeated_points(geom, 0.0);
+	repeated = lwgeom_count_vertices(clean) != lwgeom_count_vertices(geom);
+	lwgeom_free(clean);
+
+	return valid == 1 && ! repeated;
+}
+
+static void test_geos_subdivide_polygon_on_cut(void)
+{
+	/* Holes with edges and vertices lying on the medians */
+	char *wkt[] = {
+		"POLYGON((0 0,10 0,10 10,0 10,0 0),(2 2,8 2,8 8,2 8,2 2))",
+		"POLYGON((0 0,30 0,30 30,0 30,0 0),(5 5,10 5,10 10,5 10,5 5),(20 5,25 5,25 10,20 10,20 5),(5 20,10 20,10 25,5 25,5 20),(15 15,22.5 15,22.5 20,15 20,15 15))",
+		"POLYGON((0 0,39 0,39 39,0 39,0 0),(1 2,1 9,12 9,12 2,1 2),(20 3,20 9,24 9,24 3,20 3))",
+		"POLYGON((0 0,10 0,10 10,7 10,5 5,3 10,0 10,0 0))",
+		NULL
+	};
+	int i, j, maxvertices;
+
+	for ( i = 0; wkt[i]; i++ )
+	{
+		LWGEOM *geom = lwgeom_from_wkt(wkt[i], LW_PARSER_CHECK_NONE);
+		for ( maxvertices = 8; maxvertices < 16; maxvertices++ )
+		{
+			LWCOLLECTION *pieces = lwgeom_subdivide(geom, maxvertices);
+			double area = 0;
+			for ( j = 0; j < pieces->ngeoms; j++ )
+			{
+				CU_ASSERT(subdivide_piece_is_clean(pieces->geoms[j]));
+				area += lwgeom_area(pieces->geoms[j]);
+			}
+			CU_ASSERT_DOUBLE_EQUAL(area, lwgeom_area(geom), 1e-8);
+			lwcollection_free(pieces);
+		}
+		lwgeom_free(geom);
+	}
+}
+
 /*
 ** Used by test harness to register the tests in this file.
 */
@@ -133,5 +221,7 @@ void geos_suite_setup(void)
 	CU_pSuite suite = CU_add_suite("GEOS", NULL, NULL);
 	PG_ADD_TEST(suite, test_geos_noop);
 	PG_ADD_TEST(suite, test_geos_subdivide);
+	PG_ADD_TEST(suite, test_geos_subdivide_polygon);
+	PG_ADD_TEST(suite, test_geos_subdivide_polygon_on_cut);
 	PG_ADD_TEST(suite, test_geos_linemerge);
 }
@@ -224,6 +224,63 @@ static void test_twkb_in_precision(void)
 	precision = 0;
 }
 
+static void test_twkb_in_batch(void)
+{
+	int64_t ids[3] = {-7, 0, 1099511627776};
+	int64_t *idlist;
+	LWGEOM *g = lwgeom_from_wkt("GEOMETRYCOLLECTION(POINT(1 1),LINESTRING(0 0,1 1,2 2),POLYGON((0 0,0 1,1 1,0 0)))", LW_PARSER_CHECK_NONE);
+	LWCOLLECTION *col = lwgeom_as_lwcollection(g);
+	LWGEOM **geoms;
+	uint8_t *twkb;
+	size_t twkb_size;
+	int i, ngeoms;
+	char *wkt;
+
+	/* Collection, each member with its own header */
+	twkb = lwgeom_to_twkb_batch(col->geoms, ids, 3, TWKB_BBOX, 0, 0, 0, &twkb_size);
+	geoms = lwgeom_from_twkb_batch(twkb, twkb_size, LW_PARSER_CHECK_NONE, &idlist, &ngeoms);
+	CU_ASSERT_EQUAL(ngeoms, 3);
+	for ( i = 0; i < ngeoms; i++ )
+	{
+		CU_ASSERT_EQUAL(idlist[i], ids[i]);
+		CU_ASSERT_TRUE(lwgeom_same(geoms[i], col->geoms[i]));
+		lwgeom_free(geoms[i]);
+	}
+	lwfree(geoms);
+	lwfree(idlist);
+	lwfree(twkb);
+	lwgeom_free(g);
+
+	/* Multi, sharing the parent header and deltas */
+	g = lwgeom_from_wkt("MULTILINESTRING((0 0 1,1 1 2),(5 5 5,6 6 6))", LW_PARSER_CHECK_NONE);
+	col = lwgeom_as_lwcollection(g);
+	twkb = lwgeom_to_twkb_batch(col->geoms, ids, 2, TWKB_SIZE, 0, 0, 0, &twkb_size);
+	geoms = lwgeom_from_twkb_batch(twkb, twkb_size, LW_PARSER_CHECK_NONE, &idlist, &ngeoms);
+	CU_ASSERT_EQUAL(ngeoms, 2);
+	CU_ASSERT_EQUAL(idlist[0], -7);
+	CU_ASSERT_EQUAL(idlist[1], 0);
+	wkt = lwgeom_to_ewkt(geoms[1]);
+	CU_ASSERT_STRING_EQUAL(wkt, "LINESTRING(5 5 5,6 6 6)");
+	lwfree(wkt);
+	for ( i = 0; i < ngeoms; i++ )
+		lwgeom_free(geoms[i]);
+	lwfree(geoms);
+	lwfree(idlist);
+	lwfree(twkb);
+	lwgeom_free(g);
+
+	/* A plain geometry comes back on its own, without ids */
+	g = lwgeom_from_wkt("POINT(1 2)", LW_PARSER_CHECK_NONE);
+	twkb = lwgeom_to_twkb(g, 0, 0, 0, 0, &twkb_size);
+	geoms = lwgeom_from_twkb_batch(twkb, twkb_size, LW_PARSER_CHECK_NONE, &idlist, &ngeoms);
+	CU_ASSERT_EQUAL(ngeoms, 1);
+	CU_ASSERT_EQUAL(idlist, NULL);
+	CU_ASSERT_TRUE(lwgeom_same(geoms[0], g));
+	lwgeom_free(geoms[0]);
+	lwfree(geoms);
+	lwfree(twkb);
+	lwgeom_free(g);
+}
 
 
 /*
@@ -241,4 +298,5 @@ void twkb_in_suite_setup(void)
 	PG_ADD_TEST(suite, test_twkb_in_multipolygon);
 	PG_ADD_TEST(suite, test_twkb_in_collection);
 	PG_ADD_TEST(suite, test_twkb_in_precision);
+	PG_ADD_TEST(suite, test_twkb_in_batch);
 }
@@ -327,6 +327,70 @@ static void test_wkt_in_polyhedralsurface(void)
 
 }
 
+static void test_wkt_in_ordinates(void)
+{
+	/* Ordinates must come out as atof() reads them, on every path */
+	static const char *nums[] = {
+		"0.1", "-0.3", "116.397128", "-33.8688197", "1e-7", "2.5E+3", ".5", "7.",
+		"-0", "9007199254740993", "123456789012345678901234", "0.30000000000000004",
+		"1.7976931348623157e308", "4.9e-324", "1e-400", "12345678901234567e-22"
+	};
+	char wkt[256];
+	LWGEOM_PARSER_RESULT p;
+	POINT4D pt;
+	int i;
+
+	for ( i = 0; i < sizeof(nums) / sizeof(nums[0]); i++ )
+	{
+		snprintf(wkt, sizeof(wkt), "POINT(%s %s)", nums[i], nums[i]);
+		CU_ASSERT_EQUAL( lwgeom_parse_wkt(&p, wkt, LW_PARSER_CHECK_ALL), LW_SUCCESS );
+		getPoint4d_p(lwgeom_as_lwpoint(p.geom)->point, 0, &pt);
+		CU_ASSERT( memcmp(&pt.x, &pt.y, sizeof(double)) == 0 );
+		CU_ASSERT( pt.x == atof(nums[i]) );
+		CU_ASSERT( signbit(pt.x) == signbit(atof(nums[i])) );
+		lwgeom_parser_result_free(&p);
+	}
+}
+
+static void test_wkt_in_syntax(void)
+{
+	/* Keyword case, glued dimensionality and odd spacing */
+	s = "srid=4326 ;\n multipoint m((1 2 3),4 5 6, EMPTY)";
+	r = cu_wkt_in(s, WKT_EXTENDED);
+	CU_ASSERT_STRING_EQUAL(r,"SRID=4326;MULTIPOINTM(1 2 3,4 5 6,EMPTY)");
+	lwfree(r);
+
+	s = "POINTZM(1 2 3 4)";
+	r = cu_wkt_in(s, WKT_ISO);
+	CU_ASSERT_STRING_EQUAL(r,"POINT ZM (1 2 3 4)");
+	lwfree(r);
+
+	s = "POINT(1-2)";
+	r = cu_wkt_in(s, WKT_ISO);
+	CU_ASSERT_STRING_EQUAL(r,"POINT(1 -2)");
+	lwfree(r);
+
+	s = "LINESTRING(0 0,1 1 1)";
+	r = cu_wkt_in(s, WKT_ISO);
+	CU_ASSERT_STRING_EQUAL(r,"can not mix dimensionality in a geometry");
+	lwfree(r);
+
+	s = "LINESTRING(0 0,1 1 1 1,2 2)";
+	r = cu_wkt_in(s, WKT_ISO);
+	CU_ASSERT_STRING_EQUAL(r,"can not mix dimensionality in a geometry");
+	lwfree(r);
+
+	s = "GEOMETRYCOLLECTION(POINT(0 0),CIRCULARSTRING(0 0,1 1,1 0),POLYGON EMPTY)";
+	r = cu_wkt_in(s, WKT_ISO);
+	CU_ASSERT_STRING_EQUAL(r,s);
+	lwfree(r);
+
+	s = "POINT(0 0),POINT(1 1)";
+	r = cu_wkt_in(s, WKT_ISO);
+	CU_ASSERT_STRING_EQUAL(r,"parse error - invalid geometry");
+	lwfree(r);
+}
+
 static void test_wkt_in_errlocation(void)
 {
 	LWGEOM_PARSER_RESULT p;
@@ -368,4 +432,6 @@ void wkt_in_suite_setup(void)
 	PG_ADD_TEST(suite, test_wkt_in_tin);
 	PG_ADD_TEST(suite, test_wkt_in_polyhedralsurface);
 	PG_ADD_TEST(suite, test_wkt_in_errlocation);
+	PG_ADD_TEST(suite, test_wkt_in_ordinates);
+	PG_ADD_TEST(suite, test_wkt_in_syntax);
 }
@@ -1202,6 +1202,52 @@ void test_gserialized_peek_gbox_p_fails_for_unsupported_cases(void)
 	}
 }
 
+void test_gbox_get_sortable_hilbert(void);
+void test_gbox_get_sortable_hilbert(void)
+{
+	float f[] = { -FLT_MAX, -2.0, -1.0, -0.5, -FLT_MIN, 0.0, FLT_MIN, 0.5, 1.0, 2.0, FLT_MAX };
+	uint64_t seen[256];
+	uint32_t x, y;
+	uint64_t d, dmin = UINT64_MAX;
+	int i, j, n = sizeof(f) / sizeof(float);
+	GBOX b1, b2;
+
+	/* The float bit mapping keeps the float order, across zero too */
+	for ( i = 1; i < n; i++ )
+		CU_ASSERT(float_sortable_bits(f[i-1]) < float_sortable_bits(f[i]));
+
+	/* A 16x16 corner of the grid is a contiguous run of the curve */
+	for ( x = 0; x < 16; x++ )
+	{
+		for ( y = 0; y < 16; y++ )
+		{
+			d = uint32_hilbert(x, y);
+			if ( d < dmin ) dmin = d;
+			seen[(x * 16) + y] = d;
+		}
+	}
+	for ( i = 0; i < 256; i++ )
+	{
+		CU_ASSERT(seen[i] - dmin < 256);
+		for ( j = i + 1; j < 256; j++ )
+		{
+			CU_ASSERT(seen[i] != seen[j]);
+			/* Consecutive keys are neighbouring cells */
+			if ( seen[i] + 1 == seen[j] || seen[j] + 1 == seen[i] )
+				CU_ASSERT_EQUAL(abs((i / 16) - (j / 16)) + abs((i % 16) - (j % 16)), 1);
+		}
+	}
+
+	/* Same center, same key */
+	gbox_init(&b1);
+	b1.xmin = -10; b1.xmax = 10; b1.ymin = -3; b1.ymax = 5;
+	gbox_init(&b2);
+	b2.xmin = -1; b2.xmax = 1; b2.ymin = 0; b2.ymax = 2;
+	CU_ASSERT_EQUAL(gbox_get_sortable_hilbert(&b1), gbox_get_sortable_hilbert(&b2));
+	b2.xmax = 2;
+	CU_ASSERT_NOT_EQUAL(gbox_get_sortable_hilbert(&b1), gbox_get_sortable_hilbert(&b2));
+}
+
 void test_signum_macro(void);
 void test_signum_macro(void)
 {
@@ -1245,5 +1291,6 @@ void libgeom_suite_setup(void)
 	PG_ADD_TEST(suite, test_gserialized_peek_gbox_p_gets_correct_box);
 	PG_ADD_TEST(suite, test_gserialized_peek_gbox_p_fails_for_unsupported_cases);
 	PG_ADD_TEST(suite, test_gbox_same_2d);
+	PG_ADD_TEST(suite, test_gbox_get_sortable_hilbert);
 	PG_ADD_TEST(suite, test_signum_macro);
 }
@@ -315,6 +315,90 @@ static void test_lwcurve_linearize(void)
 	lwgeom_free(out2);
 	lwgeom_free(out);
 	lwgeom_free(in);
+
+	/***********************************************************
+	 *
+	 *  No repeated vertices when swept backwards
+	 *
+	 ***********************************************************/
+
+	in = lwgeom_from_text("CIRCULARSTRING(5.4216796308896065 1.6374524142125324,3.0286897671119206 2.1281849321770352,2.4511040377821658 3.2480481672170924)");
+	out = lwcurve_linearize(in, 0.0472,
+													 LW_LINEARIZE_TOLERANCE_TYPE_MAX_DEVIATION,
+													 LW_LINEARIZE_FLAG_SYMMETRIC);
+	out2 = lwgeom_remove_repeated_points(out, 0.0);
+	CU_ASSERT_EQUAL(lwgeom_count_vertices(out), 6);
+	CU_ASSERT_EQUAL(lwgeom_count_vertices(out2), lwgeom_count_vertices(out));
+	lwgeom_free(out2);
+	lwgeom_free(out);
+	lwgeom_free(in);
+}
+
+/*
+* A one-entry cache in the spirit of the backend one: same input
+* object and arguments give back a copy of the last result.
+*/
+static int linearize_cache_hits = 0;
+static int linearize_cache_misses = 0;
+static const LWGEOM *linearize_cache_key = NULL;
+static double linearize_cache_tol = 0;
+static LWGEOM *linearize_cache_geom = NULL;
+
+static LWGEOM* linearize_cache(const LWGEOM *geom, double tol, LW_LINEARIZE_TOLERANCE_TYPE type, int flags, lwlinearizer linearize)
+{
+	if ( geom == linearize_cache_key && tol == linearize_cache_tol )
+	{
+		linearize_cache_hits++;
+		return lwgeom_clone_deep(linearize_cache_geom);
+	}
+	linearize_cache_misses++;
+	if ( linearize_cache_geom ) lwgeom_free(linearize_cache_geom);
+	linearize_cache_key = geom;
+	linearize_cache_tol = tol;
+	linearize_cache_geom = linearize(geom, tol, type, flags);
+	return lwgeom_clone_deep(linearize_cache_geom);
+}
+
+static void test_lwcurve_linearize_cache(void)
+{
+	LWGEOM *in, *line;
+	LWGEOM *out, *out2, *out3;
+	double area;
+
+	in = lwgeom_from_text("CURVEPOLYGON ZM (COMPOUNDCURVE ZM (CIRCULARSTRING ZM (0 0 1 2,1 1 2 3,2 0 3 4),(2 0 3 4,2 -2 4 5,0 -2 5 6,0 0 1 2)),CIRCULARSTRING ZM (0.5 -1 0 0,1 -0.5 1 1,1.5 -1 2 2,1 -1.5 3 3,0.5 -1 0 0))");
+	line = lwgeom_from_text("LINESTRING(0 0,1 1)");
+	out = lwcurve_linearize(in, 32, LW_LINEARIZE_TOLERANCE_TYPE_SEGS_PER_QUAD, 0);
+	area = lwgeom_area(in);
+
+	lwgeom_set_linearize_cache(linearize_cache);
+
+	out2 = lwcurve_linearize(in, 32, LW_LINEARIZE_TOLERANCE_TYPE_SEGS_PER_QUAD, 0);
+	out3 = lwcurve_linearize(in, 32, LW_LINEARIZE_TOLERANCE_TYPE_SEGS_PER_QUAD, 0);
+	CU_ASSERT_EQUAL(linearize_cache_misses, 1);
+	CU_ASSERT_EQUAL(linearize_cache_hits, 1);
+	CU_ASSERT(lwgeom_same(out, out2));
+	CU_ASSERT(lwgeom_same(out, out3));
+	lwgeom_free(out2);
+	lwgeom_free(out3);
+
+	/* Area strokes the same way, and so shares the entry */
+	CU_ASSERT_DOUBLE_EQUAL(lwgeom_area(in), area, 1e-12);
+	CU_ASSERT_EQUAL(linearize_cache_hits, 2);
+
+	/* Geometries without arcs never reach the cache */
+	out2 = lwcurve_linearize(line, 32, LW_LINEARIZE_TOLERANCE_TYPE_SEGS_PER_QUAD, 0);
+	CU_ASSERT_EQUAL(linearize_cache_misses, 1);
+	CU_ASSERT_EQUAL(linearize_cache_hits, 2);
+	lwgeom_free(out2);
+
+	lwgeom_set_linearize_cache(NULL);
+	lwgeom_free(linearize_cache_geom);
+	linearize_cache_geom = NULL;
+	linearize_cache_key = NULL;
+
+	lwgeom_free(out);
+	lwgeom_free(line);
+	lwgeom_free(in);
 }
 
 /*
@@ -325,4 +409,5 @@ void lwstroke_suite_setup(void)
 {
 	CU_pSuite suite = CU_add_suite("lwstroke", NULL, NULL);
 	PG_ADD_TEST(suite, test_lwcurve_linearize);
+	PG_ADD_TEST(suite, test_lwcurve_linearize_cache);
 }
@@ -1271,6 +1271,150 @@ test_lwgeom_is_trajectory(void)
 	ASSERT_INT_EQUAL(ret, LW_TRUE); /* ok (corner case) */
 }
 
+/*
+* Closed star shaped ring around (cx,cy), with spikes reaching
+* in and out so that two of them interlock.
+*/
+static POINTARRAY *
+star_ring(int npoints, double cx, double cy, double r, double spike, double phase)
+{
+	POINTARRAY *pa = ptarray_construct(0, 0, npoints);
+	POINT4D p = {0.0, 0.0, 0.0, 0.0};
+	POINT4D first = p;
+	int i;
+
+	for ( i = 0; i < npoints - 1; i++ )
+	{
+		double a = 2 * M_PI * i / (npoints - 1) + phase;
+		double rr = r + ( i % 2 ? spike : -spike );
+		p.x = cx + rr * cos(a);
+		p.y = cy + rr * sin(a);
+		if ( i == 0 ) first = p;
+		ptarray_set_point4d(pa, i, &p);
+	}
+	ptarray_set_point4d(pa, npoints - 1, &first);
+	return pa;
+}
+
+/* The exhaustive loop of lw_dist2d_ptarray_ptarray */
+static void
+segtree_reference(const POINTARRAY *l1, const POINTARRAY *l2, DISTPTS *dl)
+{
+	int t, u, twist = dl->twisted;
+	for ( t = 1; t < l1->npoints; t++ )
+	{
+		for ( u = 1; u < l2->npoints; u++ )
+		{
+			dl->twisted = twist;
+			lw_dist2d_seg_seg(getPoint2d_cp(l1, t-1), getPoint2d_cp(l1, t),
+			                  getPoint2d_cp(l2, u-1), getPoint2d_cp(l2, u), dl);
+			if ( dl->distance <= dl->tolerance ) return;
+		}
+	}
+}
+
+static void
+test_lw_dist2d_segtree_ptarray_ptarray(void)
+{
+	double tolerances[] = {0.0, 0.05, 0.4, 3.0};
+	double offsets[] = {0.0, 0.7, 2.5};
+	int i, j, k;
+
+	for ( i = 0; i < 3; i++ )
+	{
+		POINTARRAY *pa1 = star_ring(301, 0, 0, 10, 0.3, 0);
+		POINTARRAY *pa2 = star_ring(203, offsets[i], 0, 9.2, 0.4, 0.01);
+		SEG_TREE *tree1 = seg_tree_new(pa1);
+		SEG_TREE *tree2 = seg_tree_new(pa2);
+
+		CU_ASSERT_EQUAL(tree1->nsegs, 300);
+		CU_ASSERT_EQUAL(tree1->minseg[tree1->nnodes - 1], 0);
+
+		for ( j = 0; j < 4; j++ )
+		{
+			DISTPTS ref, dl[3];
+			lw_dist2d_distpts_init(&ref, DIST_MIN);
+			ref.tolerance = tolerances[j];
+			ref.twisted = 1;
+			for ( k = 0; k < 3; k++ )
+				dl[k] = ref;
+
+			segtree_reference(pa1, pa2, &ref);
+			lw_dist2d_segtree_ptarray_ptarray(pa1, pa2, NULL, tree2, &dl[0]);
+			lw_dist2d_segtree_ptarray_ptarray(pa1, pa2, tree1, NULL, &dl[1]);
+			lw_dist2d_ptarray_ptarray(pa1, pa2, &dl[2]);
+
+			for ( k = 0; k < 3; k++ )
+			{
+				/* Same pair as the exhaustive loop, not just the same distance */
+				CU_ASSERT_EQUAL(dl[k].distance, ref.distance);
+				CU_ASSERT_EQUAL(dl[k].p1.x, ref.p1.x);
+				CU_ASSERT_EQUAL(dl[k].p1.y, ref.p1.y);
+				CU_ASSERT_EQUAL(dl[k].p2.x, ref.p2.x);
+				CU_ASSERT_EQUAL(dl[k].p2.y, ref.p2.y);
+				CU_ASSERT_EQUAL(dl[k].twisted, ref.twisted);
+			}
+		}
+
+		seg_tree_free(tree1);
+		seg_tree_free(tree2);
+		ptarray_free(pa1);
+		ptarray_free(pa2);
+	}
+}
+
+static void
+test_lwgeom_distance_tree(void)
+{
+	LWGEOM *g1, *g2, *l1, *l2;
+	LWDISTTREE *dtree;
+	POINTARRAY **rings;
+	double d1, d2;
+
+	rings = lwalloc(sizeof(POINTARRAY*) * 2);
+	rings[0] = star_ring(401, 0, 0, 10, 0.3, 0);
+	rings[1] = star_ring(101, 0, 0, 4, 0.2, 0);
+	g1 = (LWGEOM*)lwpoly_construct(SRID_UNKNOWN, NULL, 2, rings);
+	g2 = (LWGEOM*)lwline_construct(SRID_UNKNOWN, NULL, star_ring(251, 0.5, 0, 9, 0.4, 0.02));
+
+	dtree = lwgeom_distance_tree_new(g1);
+	CU_ASSERT(dtree != NULL);
+	CU_ASSERT(lw_dist_tree_lookup(dtree, rings[0]) != NULL);
+	CU_ASSERT(lw_dist_tree_lookup(dtree, rings[1]) != NULL);
+	CU_ASSERT_EQUAL(lw_dist_tree_lookup(dtree, ((LWLINE*)g2)->points), NULL);
+
+	/* Cached tree on either side of the calculation */
+	d1 = lwgeom_mindistance2d_tolerance(g1, g2, 0.0);
+	d2 = lwgeom_mindistance2d_tolerance_tree(g1, g2, 0.0, dtree);
+	CU_ASSERT_EQUAL(d1, d2);
+	d1 = lwgeom_mindistance2d_tolerance(g2, g1, 0.0);
+	d2 = lwgeom_mindistance2d_tolerance_tree(g2, g1, 0.0, dtree);
+	CU_ASSERT_EQUAL(d1, d2);
+	d2 = lwgeom_mindistance2d_tolerance_tree(g2, g1, 0.2, dtree);
+	CU_ASSERT(d2 <= 0.2);
+
+	l1 = lwgeom_closest_line(g2, g1);
+	l2 = lwgeom_closest_line_tree(g2, g1, dtree);
+	CU_ASSERT(lwgeom_same(l1, l2));
+	lwgeom_free(l1);
+	lwgeom_free(l2);
+
+	l1 = lwgeom_closest_point(g1, g2);
+	l2 = lwgeom_closest_point_tree(g1, g2, dtree);
+	CU_ASSERT(lwgeom_same(l1, l2));
+	lwgeom_free(l1);
+	lwgeom_free(l2);
+
+	lwgeom_distance_tree_free(dtree);
+	lwgeom_free(g1);
+	lwgeom_free(g2);
+
+	/* Nothing worth indexing */
+	g1 = lwgeom_from_wkt("POLYGON((0 0, 1 0, 1 1, 0 0))", LW_PARSER_CHECK_NONE);
+	CU_ASSERT_EQUAL(lwgeom_distance_tree_new(g1), NULL);
+	lwgeom_free(g1);
+}
+
 /*
 ** Used by test harness to register the tests in this file.
 */
@@ -1289,6 +1433,8 @@ void measures_suite_setup(void)
 	PG_ADD_TEST(suite, test_lw_arc_length);
 	PG_ADD_TEST(suite, test_lw_dist2d_pt_ptarrayarc);
 	PG_ADD_TEST(suite, test_lw_dist2d_ptarray_ptarrayarc);
+	PG_ADD_TEST(suite, test_lw_dist2d_segtree_ptarray_ptarray);
+	PG_ADD_TEST(suite, test_lwgeom_distance_tree);
 	PG_ADD_TEST(suite, test_lwgeom_tcpa);
 	PG_ADD_TEST(suite, test_lwgeom_is_trajectory);
 }
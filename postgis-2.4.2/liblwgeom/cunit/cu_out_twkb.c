@@ -273,6 +273,41 @@ static void test_twkb_out_idlist(void)
 
 }
 
+/*
+** The batch writer should match the idlist writer on the equivalent collection
+*/
+static void cu_twkb_batch(char *wkt, int64_t *idlist, uint8_t variant)
+{
+	LWGEOM *g = lwgeom_from_wkt(wkt, LW_PARSER_CHECK_NONE);
+	LWCOLLECTION *col = lwgeom_as_lwcollection(g);
+	size_t twkb_size;
+	uint8_t *twkb;
+	char *hex;
+
+	cu_twkb_idlist(wkt, idlist, 0, 0, 0, variant);
+	twkb = lwgeom_to_twkb_batch(col->geoms, idlist, col->ngeoms, variant, 0, 0, 0, &twkb_size);
+	CU_ASSERT_FATAL(twkb != NULL);
+	hex = hexbytes_from_bytes(twkb, twkb_size);
+	CU_ASSERT_STRING_EQUAL(hex, s);
+	lwfree(hex);
+	lwfree(twkb);
+	lwgeom_free(g);
+}
+
+static void test_twkb_out_batch(void)
+{
+	int64_t idlist[3] = {2, 4, 1099511627776};
+
+	cu_twkb_batch("MULTIPOINT(1 1, 0 0)", idlist, 0);
+	CU_ASSERT_STRING_EQUAL(s,"040402040802020101");
+	cu_twkb_batch("MULTIPOINT(1 1, 0 0)", idlist, TWKB_SIZE | TWKB_BBOX);
+	CU_ASSERT_STRING_EQUAL(s,"04070B0002000202040802020101");
+
+	/* Mixed types become a collection, sized or not */
+	cu_twkb_batch("GEOMETRYCOLLECTION(POINT(1 1),LINESTRING(0 0,1 1,1 1,2 2),POLYGON((0 0,0 1,1 1,0 0)))", idlist, 0);
+	cu_twkb_batch("GEOMETRYCOLLECTION(POINT(1 1),LINESTRING(0 0,1 1,1 1,2 2),POLYGON((0 0,0 1,1 1,0 0)))", idlist, TWKB_SIZE | TWKB_BBOX);
+	cu_twkb_batch("MULTILINESTRING((0 0 1,1 1 2),EMPTY,(5 5 5,6 6 6))", idlist, TWKB_BBOX);
+}
 
 /*
 ** Used by test harness to register the tests in this file.
@@ -289,4 +324,5 @@ void twkb_out_suite_setup(void)
 	PG_ADD_TEST(suite, test_twkb_out_multipolygon);
 	PG_ADD_TEST(suite, test_twkb_out_collection);
 	PG_ADD_TEST(suite, test_twkb_out_idlist);
+	PG_ADD_TEST(suite, test_twkb_out_batch);
 }
@@ -159,6 +159,74 @@ static void test_lwprint_bad_formats(void)
 	test_lwprint_assert_error("POINT(1.23456 7.89012)", "DD.DDD jjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjj");
 }
 
+static void test_lwprint_double_assert(double d, int maxdd, const char *expected)
+{
+	char buf[OUT_DOUBLE_BUFFER_SIZE];
+	int len = lwprint_double(d, maxdd, buf, sizeof(buf));
+	CU_ASSERT_STRING_EQUAL(buf, expected);
+	CU_ASSERT_EQUAL(len, strlen(expected));
+}
+
+static void test_lwprint_double(void)
+{
+	/* Shortest representation reading back to the same double */
+	test_lwprint_double_assert(120.123, 15, "120.123");
+	test_lwprint_double_assert(0.1, 15, "0.1");
+	test_lwprint_double_assert(-1.5, 15, "-1.5");
+	test_lwprint_double_assert(100, 15, "100");
+	test_lwprint_double_assert(1.0/3.0, 15, "0.333333333333333");
+	test_lwprint_double_assert(0.30000000000000004, 17, "0.30000000000000004");
+
+	/* Rounded like %.*f when out of decimals */
+	test_lwprint_double_assert(1.0/3.0, 5, "0.33333");
+	test_lwprint_double_assert(2.0/3.0, 0, "1");
+	test_lwprint_double_assert(0.125, 2, "0.12");
+	test_lwprint_double_assert(0.375, 2, "0.38");
+	test_lwprint_double_assert(1.99999, 3, "2");
+
+	/* Zeros and signs */
+	test_lwprint_double_assert(0.0, 15, "0");
+	test_lwprint_double_assert(-0.0, 15, "-0");
+	test_lwprint_double_assert(-0.0001, 2, "-0");
+
+	/* Large values */
+	test_lwprint_double_assert(123456789012345.6, 1, "123456789012345.6");
+	test_lwprint_double_assert(1e15, 15, "1e+15");
+	test_lwprint_double_assert(-3.5e20, 2, "-3.5e+20");
+}
+
+static void test_lwprint_double_sig_assert(double d, int maxsd)
+{
+	char buf[OUT_DOUBLE_BUFFER_SIZE];
+	char expected[OUT_DOUBLE_BUFFER_SIZE];
+	snprintf(expected, sizeof(expected), "%.*g", maxsd, d);
+	lwprint_double_sig(d, maxsd, buf, sizeof(buf));
+	CU_ASSERT_STRING_EQUAL(buf, expected);
+}
+
+static void test_lwprint_double_sig(void)
+{
+	int i;
+	double d = 0.123456789;
+
+	/* Same output as %.*g up to 15 significant digits */
+	test_lwprint_double_sig_assert(0.1, 15);
+	test_lwprint_double_sig_assert(120.123, 15);
+	test_lwprint_double_sig_assert(-0.0, 15);
+	test_lwprint_double_sig_assert(1e-5, 15);
+	test_lwprint_double_sig_assert(0.0001, 15);
+	test_lwprint_double_sig_assert(99.96, 3);
+	test_lwprint_double_sig_assert(9.9996, 4);
+	test_lwprint_double_sig_assert(123456789012345678.0, 15);
+	test_lwprint_double_sig_assert(5e-324, 15);
+	for ( i = 0; i < 40; i++ )
+	{
+		test_lwprint_double_sig_assert(d, 1 + i % 15);
+		test_lwprint_double_sig_assert(-d, 15);
+		d *= 3.7;
+	}
+}
+
 /*
 ** Callback used by the test harness to register the tests in this file.
 */
@@ -171,5 +239,7 @@ void print_suite_setup(void)
 	PG_ADD_TEST(suite, test_lwprint_optional_format);
 	PG_ADD_TEST(suite, test_lwprint_oddball_formats);
 	PG_ADD_TEST(suite, test_lwprint_bad_formats);
+	PG_ADD_TEST(suite, test_lwprint_double);
+	PG_ADD_TEST(suite, test_lwprint_double_sig);
 }
 
@@ -378,6 +378,49 @@ static void test_tree_circ_distance_threshold(void)
 
 }
 
+static void test_tree_circ_flatten(void)
+{
+	const char *wkt[] = {
+		"MULTIPOLYGON(((0 0,0 10,10 10,10 0,0 0),(2 2,2 4,4 4,4 2,2 2)),((20 20,20 30,30 30,30 20,20 20)))",
+		"MULTILINESTRING((-1 -1,0 -1,1 -1,1 0,1 1,0 0,-1 1,-1 0,-1 -1),(5 5,6 6,7 5,8 6,9 5))",
+		"MULTIPOINT(40 40,41 41,-40 -40)",
+		"POINT(5 5)",
+		"POINT(25 35)"
+	};
+	int nwkt = sizeof(wkt) / sizeof(wkt[0]);
+	SPHEROID s;
+	int i, j;
+
+	spheroid_init(&s, 1.0, 1.0);
+
+	for ( i = 0; i < nwkt; i++ )
+	{
+		for ( j = 0; j < nwkt; j++ )
+		{
+			LWGEOM *lwg1 = lwgeom_from_wkt(wkt[i], LW_PARSER_CHECK_NONE);
+			LWGEOM *lwg2 = lwgeom_from_wkt(wkt[j], LW_PARSER_CHECK_NONE);
+			CIRC_NODE *c1 = lwgeom_calculate_circ_tree(lwg1);
+			CIRC_NODE *c2 = lwgeom_calculate_circ_tree(lwg2);
+			CIRC_TREE *t1 = circ_tree_flatten(c1);
+			CIRC_TREE *t2 = circ_tree_flatten(c2);
+			double d1, d2;
+
+			/* The flat copy stands alone once the node tree is gone */
+			circ_tree_free(c1);
+			circ_tree_free(c2);
+
+			d1 = circ_tree_distance_tree(t1->nodes, t2->nodes, &s, 0.0);
+			d2 = lwgeom_distance_spheroid(lwg1, lwg2, &s, 0.0);
+			CU_ASSERT_DOUBLE_EQUAL(d1, d2, 0.00001);
+
+			circ_tree_flat_free(t1);
+			circ_tree_flat_free(t2);
+			lwgeom_free(lwg1);
+			lwgeom_free(lwg2);
+		}
+	}
+}
+
 /*
 ** Used by test harness to register the tests in this file.
 */
@@ -390,4 +433,5 @@ void tree_suite_setup(void)
 	PG_ADD_TEST(suite, test_tree_circ_pip2);
 	PG_ADD_TEST(suite, test_tree_circ_distance);
 	PG_ADD_TEST(suite, test_tree_circ_distance_threshold);
+	PG_ADD_TEST(suite, test_tree_circ_flatten);
 }
@@ -0,0 +1,567 @@
+/**********************************************************************
+ *
+ * PostGIS - Spatial Types for PostgreSQL
+ * http://postgis.net
+ *
+ * This is free software; you can redistribute and/or modify it under
+ * the terms of the GNU General Public Licence. See the COPYING file.
+ *
+ **********************************************************************/
+
+/*
+* Micro-benchmarks for the hot liblwgeom entry points.
+*
+* Each benchmark runs one operation repeatedly over a set of generated
+* fixtures (a point, a random walk, a coastline-like polygon with holes,
+* a parcel grid) and reports the throughput together with the number of
+* lwalloc/lwrealloc calls and bytes requested per operation, counted
+* through handlers installed with lwgeom_set_handlers().
+*
+* Usage: lwbench [-t seconds] [filter ...]
+*
+* Only the benchmarks whose name contains one of the filters are run.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "liblwgeom_internal.h"
+#include "lwgeom_geos.h"
+#include "../postgis_config.h"
+
+/*
+* Allocation tracking
+*/
+
+typedef struct
+{
+	uint64_t allocs;    /* lwalloc calls */
+	uint64_t reallocs;  /* lwrealloc calls */
+	uint64_t frees;     /* lwfree calls */
+	uint64_t bytes;     /* bytes requested by lwalloc and lwrealloc */
+} bench_alloc_stats;
+
+static bench_alloc_stats alloc_stats;
+
+static void *
+bench_allocator(size_t size)
+{
+	void *mem = malloc(size);
+	alloc_stats.allocs++;
+	alloc_stats.bytes += size;
+	if ( ! mem )
+	{
+		fprintf(stderr, "lwbench: out of memory allocating %zu bytes\n", size);
+		exit(1);
+	}
+	return mem;
+}
+
+static void *
+bench_reallocator(void *mem, size_t size)
+{
+	void *ret = realloc(mem, size);
+	alloc_stats.reallocs++;
+	alloc_stats.bytes += size;
+	if ( ! ret )
+	{
+		fprintf(stderr, "lwbench: out of memory reallocating %zu bytes\n", size);
+		exit(1);
+	}
+	return ret;
+}
+
+static void
+bench_freeor(void *mem)
+{
+	if ( mem ) alloc_stats.frees++;
+	free(mem);
+}
+
+static void
+bench_errorreporter(const char *fmt, va_list ap)
+{
+	fprintf(stderr, "lwbench: ");
+	vfprintf(stderr, fmt, ap);
+	fprintf(stderr, "\n");
+	exit(1);
+}
+
+static void
+bench_noticereporter(const char *fmt, va_list ap)
+{
+	return;
+}
+
+/*
+* Fixtures
+*/
+
+/* Repeatable pseudo-random sequence, so runs compare across builds */
+static uint32_t bench_rand_state = 12345;
+
+static double
+bench_rand(void)
+{
+	bench_rand_state = bench_rand_state * 1103515245u + 12345u;
+	return ((bench_rand_state >> 8) & 0xFFFFFF) / (double)0x1000000;
+}
+
+static POINTARRAY *
+bench_ring(double cx, double cy, double radius, double jitter, int npoints, int clockwise)
+{
+	POINTARRAY *pa = ptarray_construct_empty(LW_FALSE, LW_FALSE, npoints + 1);
+	POINT4D pt = {0, 0, 0, 0};
+	POINT4D first;
+	int i;
+
+	for ( i = 0; i < npoints; i++ )
+	{
+		double a = 2.0 * M_PI * i / npoints;
+		double r = radius * (1.0 + jitter * (bench_rand() - 0.5));
+		if ( clockwise ) a = -a;
+		pt.x = cx + r * cos(a);
+		pt.y = cy + r * sin(a);
+		if ( i == 0 ) first = pt;
+		ptarray_append_point(pa, &pt, LW_TRUE);
+	}
+	ptarray_append_point(pa, &first, LW_TRUE);
+	return pa;
+}
+
+static LWGEOM *
+bench_fixture_point(void)
+{
+	return lwpoint_as_lwgeom(lwpoint_make2d(4326, -123.1207, 49.2827));
+}
+
+/* GPS-track-like random walk */
+static LWGEOM *
+bench_fixture_line(int npoints)
+{
+	POINTARRAY *pa = ptarray_construct_empty(LW_FALSE, LW_FALSE, npoints);
+	POINT4D pt = {-123.1, 49.2, 0, 0};
+	double heading = 0.0;
+	int i;
+
+	for ( i = 0; i < npoints; i++ )
+	{
+		heading += (bench_rand() - 0.5) * 0.6;
+		pt.x += 0.0005 * cos(heading);
+		pt.y += 0.0005 * sin(heading);
+		ptarray_append_point(pa, &pt, LW_TRUE);
+	}
+	return lwline_as_lwgeom(lwline_construct(4326, NULL, pa));
+}
+
+/* Coastline-like shell with a handful of lakes */
+static LWGEOM *
+bench_fixture_polygon(int npoints, int nholes)
+{
+	POINTARRAY **rings = lwalloc(sizeof(POINTARRAY *) * (nholes + 1));
+	int i;
+
+	rings[0] = bench_ring(0, 0, 1000, 0.1, npoints, LW_TRUE);
+	for ( i = 0; i < nholes; i++ )
+	{
+		double a = 2.0 * M_PI * i / nholes;
+		rings[i + 1] = bench_ring(500 * cos(a), 500 * sin(a), 100, 0.1, npoints / 10, LW_FALSE);
+	}
+	return lwpoly_as_lwgeom(lwpoly_construct(3857, NULL, nholes + 1, rings));
+}
+
+/* Grid of small, slightly irregular parcels */
+static LWGEOM *
+bench_fixture_parcels(int side)
+{
+	LWMPOLY *mpoly = lwmpoly_construct_empty(3857, LW_FALSE, LW_FALSE);
+	int i, j;
+
+	for ( i = 0; i < side; i++ )
+	{
+		for ( j = 0; j < side; j++ )
+		{
+			POINTARRAY **rings = lwalloc(sizeof(POINTARRAY *));
+			rings[0] = bench_ring(i * 30.0 + 15, j * 30.0 + 15, 12, 0.2, 6, LW_TRUE);
+			mpoly = lwmpoly_add_lwpoly(mpoly, lwpoly_construct(3857, NULL, 1, rings));
+		}
+	}
+	return lwmpoly_as_lwgeom(mpoly);
+}
+
+typedef struct
+{
+	const char *name;
+	LWGEOM *geom;
+	/* Pre-built encodings, for the parsing benchmarks */
+	GSERIALIZED *gser;
+	char *wkt;
+	uint8_t *wkb;
+	size_t wkb_size;
+	uint8_t *twkb;
+	size_t twkb_size;
+	char *geojson;
+	GEOSGeometry *geos;
+} bench_fixture;
+
+#define BENCH_NFIXTURES 4
+static bench_fixture fixtures[BENCH_NFIXTURES];
+
+/* Points fed to the k-means benchmark */
+#define BENCH_KMEANS_NPOINTS 20000
+#define BENCH_KMEANS_K 50
+static LWGEOM *kmeans_points[BENCH_KMEANS_NPOINTS];
+
+static void
+bench_fixtures_init(void)
+{
+	int i;
+	size_t size;
+
+	fixtures[0].name = "point";
+	fixtures[0].geom = bench_fixture_point();
+	fixtures[1].name = "line_2k";
+	fixtures[1].geom = bench_fixture_line(2000);
+	fixtures[2].name = "poly_5k";
+	fixtures[2].geom = bench_fixture_polygon(5000, 8);
+	fixtures[3].name = "parcels_900";
+	fixtures[3].geom = bench_fixture_parcels(30);
+
+	for ( i = 0; i < BENCH_NFIXTURES; i++ )
+	{
+		bench_fixture *f = &fixtures[i];
+		lwgeom_add_bbox(f->geom);
+		f->gser = gserialized_from_lwgeom(f->geom, &size);
+		f->wkt = lwgeom_to_wkt(f->geom, WKT_EXTENDED, 15, NULL);
+		f->wkb = lwgeom_to_wkb(f->geom, WKB_EXTENDED, &f->wkb_size);
+		f->twkb = lwgeom_to_twkb(f->geom, 0, 6, 0, 0, &f->twkb_size);
+		f->geojson = lwgeom_to_geojson(f->geom, NULL, 15, 0);
+		f->geos = LWGEOM2GEOS(f->geom, 0);
+	}
+
+	/* Clustered point cloud, a few dense towns over a sparse background */
+	for ( i = 0; i < BENCH_KMEANS_NPOINTS; i++ )
+	{
+		double cx = 0, cy = 0, spread = 5000;
+		if ( i % 4 )
+		{
+			int town = i % 37;
+			cx = 1000.0 * (town % 7);
+			cy = 1000.0 * (town / 7);
+			spread = 150;
+		}
+		kmeans_points[i] = lwpoint_as_lwgeom(lwpoint_make2d(3857,
+		                   cx + spread * (bench_rand() - 0.5),
+		                   cy + spread * (bench_rand() - 0.5)));
+	}
+}
+
+static void
+bench_fixtures_free(void)
+{
+	int i;
+
+	for ( i = 0; i < BENCH_NFIXTURES; i++ )
+	{
+		bench_fixture *f = &fixtures[i];
+		lwgeom_free(f->geom);
+		lwfree(f->gser);
+		lwfree(f->wkt);
+		lwfree(f->wkb);
+		lwfree(f->twkb);
+		lwfree(f->geojson);
+		GEOSGeom_destroy(f->geos);
+	}
+	for ( i = 0; i < BENCH_KMEANS_NPOINTS; i++ )
+		lwgeom_free(kmeans_points[i]);
+}
+
+/*
+* Benchmarks. Each one performs a single operation on the fixture and
+* returns the number of bytes it read or produced, for the MB/s column.
+*/
+
+typedef size_t (*bench_func)(const bench_fixture *f);
+
+static size_t
+bench_serialize(const bench_fixture *f)
+{
+	size_t size;
+	GSERIALIZED *g = gserialized_from_lwgeom(f->geom, &size);
+	lwfree(g);
+	return size;
+}
+
+static size_t
+bench_deserialize(const bench_fixture *f)
+{
+	LWGEOM *geom = lwgeom_from_gserialized(f->gser);
+	lwgeom_free(geom);
+	return SIZE_GET(f->gser->size);
+}
+
+static size_t
+bench_wkt_out(const bench_fixture *f)
+{
+	size_t size;
+	char *wkt = lwgeom_to_wkt(f->geom, WKT_EXTENDED, 15, &size);
+	lwfree(wkt);
+	return size;
+}
+
+static size_t
+bench_wkt_in(const bench_fixture *f)
+{
+	LWGEOM *geom = lwgeom_from_wkt(f->wkt, LW_PARSER_CHECK_NONE);
+	lwgeom_free(geom);
+	return strlen(f->wkt);
+}
+
+static size_t
+bench_wkb_out(const bench_fixture *f)
+{
+	size_t size;
+	uint8_t *wkb = lwgeom_to_wkb(f->geom, WKB_EXTENDED, &size);
+	lwfree(wkb);
+	return size;
+}
+
+static size_t
+bench_wkb_in(const bench_fixture *f)
+{
+	LWGEOM *geom = lwgeom_from_wkb(f->wkb, f->wkb_size, LW_PARSER_CHECK_NONE);
+	lwgeom_free(geom);
+	return f->wkb_size;
+}
+
+static size_t
+bench_twkb_out(const bench_fixture *f)
+{
+	size_t size;
+	uint8_t *twkb = lwgeom_to_twkb(f->geom, 0, 6, 0, 0, &size);
+	lwfree(twkb);
+	return size;
+}
+
+static size_t
+bench_twkb_in(const bench_fixture *f)
+{
+	LWGEOM *geom = lwgeom_from_twkb(f->twkb, f->twkb_size, LW_PARSER_CHECK_NONE);
+	lwgeom_free(geom);
+	return f->twkb_size;
+}
+
+static size_t
+bench_geojson_out(const bench_fixture *f)
+{
+	char *json = lwgeom_to_geojson(f->geom, NULL, 15, 0);
+	size_t size = strlen(json);
+	lwfree(json);
+	return size;
+}
+
+#if HAVE_LIBJSON
+static size_t
+bench_geojson_in(const bench_fixture *f)
+{
+	char *srs = NULL;
+	LWGEOM *geom = lwgeom_from_geojson(f->geojson, &srs);
+	lwgeom_free(geom);
+	if ( srs ) lwfree(srs);
+	return strlen(f->geojson);
+}
+#endif
+
+static size_t
+bench_area(const bench_fixture *f)
+{
+	volatile double area = lwgeom_area(f->geom) + lwgeom_length(f->geom);
+	(void)area;
+	return f->wkb_size;
+}
+
+static size_t
+bench_distance(const bench_fixture *f)
+{
+	/* Distance to the next fixture, so every kind meets a real partner */
+	const bench_fixture *other = &fixtures[(f - fixtures + 1) % BENCH_NFIXTURES];
+	volatile double d = lwgeom_mindistance2d(f->geom, other->geom);
+	(void)d;
+	return f->wkb_size + other->wkb_size;
+}
+
+/* Nearest liblwgeom stand-in for the MVT tile preparation step */
+static size_t
+bench_clip(const bench_fixture *f)
+{
+	const GBOX *box = lwgeom_get_bbox(f->geom);
+	double dx = (box->xmax - box->xmin) / 4;
+	double dy = (box->ymax - box->ymin) / 4;
+	LWGEOM *clipped = lwgeom_clip_by_rect(f->geom, box->xmin + dx, box->ymin + dy,
+	                                      box->xmax - dx, box->ymax - dy);
+	if ( clipped ) lwgeom_free(clipped);
+	return f->wkb_size;
+}
+
+static size_t
+bench_geos_in(const bench_fixture *f)
+{
+	GEOSGeometry *g = LWGEOM2GEOS(f->geom, 0);
+	GEOSGeom_destroy(g);
+	return f->wkb_size;
+}
+
+static size_t
+bench_geos_out(const bench_fixture *f)
+{
+	LWGEOM *geom = GEOS2LWGEOM(f->geos, 0);
+	lwgeom_free(geom);
+	return f->wkb_size;
+}
+
+static size_t
+bench_kmeans(const bench_fixture *f)
+{
+	int *clusters = lwgeom_cluster_2d_kmeans((const LWGEOM **)kmeans_points,
+	                                         BENCH_KMEANS_NPOINTS, BENCH_KMEANS_K);
+	lwfree(clusters);
+	return BENCH_KMEANS_NPOINTS * sizeof(POINT2D);
+}
+
+typedef struct
+{
+	const char *name;
+	bench_func func;
+	int per_fixture; /* run once per fixture, or once overall */
+} bench_case;
+
+static const bench_case bench_cases[] =
+{
+	{ "serialize", bench_serialize, 1 },
+	{ "deserialize", bench_deserialize, 1 },
+	{ "wkt_out", bench_wkt_out, 1 },
+	{ "wkt_in", bench_wkt_in, 1 },
+	{ "wkb_out", bench_wkb_out, 1 },
+	{ "wkb_in", bench_wkb_in, 1 },
+	{ "twkb_out", bench_twkb_out, 1 },
+	{ "twkb_in", bench_twkb_in, 1 },
+	{ "geojson_out", bench_geojson_out, 1 },
+#if HAVE_LIBJSON
+	{ "geojson_in", bench_geojson_in, 1 },
+#endif
+	{ "area_length", bench_area, 1 },
+	{ "distance", bench_distance, 1 },
+	{ "clip_by_rect", bench_clip, 1 },
+	{ "geos_in", bench_geos_in, 1 },
+	{ "geos_out", bench_geos_out, 1 },
+	{ "kmeans", bench_kmeans, 0 },
+	{ NULL, NULL, 0 }
+};
+
+/*
+* Driver
+*/
+
+static double
+bench_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void
+bench_run(const char *name, const char *fixture, bench_func func,
+          const bench_fixture *f, double min_time)
+{
+	bench_alloc_stats before;
+	uint64_t ops = 0, bytes = 0;
+	double start, elapsed;
+
+	/* Warm up caches and any lazily built state */
+	func(f);
+
+	before = alloc_stats;
+	start = bench_now();
+	do
+	{
+		int i;
+		/* Check the clock only every few calls for the cheap operations */
+		for ( i = 0; i < 8; i++ )
+			bytes += func(f);
+		ops += 8;
+		elapsed = bench_now() - start;
+	}
+	while ( elapsed < min_time );
+
+	printf("%-13s %-12s %12.0f %10.1f %10.2f %12.0f\n",
+	       name, fixture,
+	       ops / elapsed,
+	       bytes / elapsed / (1024.0 * 1024.0),
+	       (double)(alloc_stats.allocs + alloc_stats.reallocs - before.allocs - before.reallocs) / ops,
+	       (double)(alloc_stats.bytes - before.bytes) / ops);
+	fflush(stdout);
+}
+
+static int
+bench_selected(const char *name, int nfilters, char **filters)
+{
+	int i;
+	if ( ! nfilters ) return LW_TRUE;
+	for ( i = 0; i < nfilters; i++ )
+	{
+		if ( strstr(name, filters[i]) )
+			return LW_TRUE;
+	}
+	return LW_FALSE;
+}
+
+int main(int argc, char **argv)
+{
+	double min_time = 0.2;
+	int argi = 1;
+	const bench_case *c;
+	int i;
+
+	if ( argc > 2 && strcmp(argv[1], "-t") == 0 )
+	{
+		min_time = atof(argv[2]);
+		argi = 3;
+	}
+
+	lwgeom_set_handlers(bench_allocator, bench_reallocator, bench_freeor,
+	                    bench_errorreporter, bench_noticereporter);
+	initGEOS(lwnotice, lwgeom_geos_error);
+
+	bench_fixtures_init();
+
+	printf("%-13s %-12s %12s %10s %10s %12s\n",
+	       "benchmark", "fixture", "ops/s", "MB/s", "allocs/op", "bytes/op");
+
+	for ( c = bench_cases; c->name; c++ )
+	{
+		if ( ! bench_selected(c->name, argc - argi, argv + argi) )
+			continue;
+
+		if ( ! c->per_fixture )
+		{
+			bench_run(c->name, "-", c->func, NULL, min_time);
+			continue;
+		}
+		for ( i = 0; i < BENCH_NFIXTURES; i++ )
+			bench_run(c->name, fixtures[i].name, c->func, &fixtures[i], min_time);
+	}
+
+	bench_fixtures_free();
+	finishGEOS();
+
+	if ( alloc_stats.allocs != alloc_stats.frees )
+	{
+		printf("\nleaked %lld of %lld allocations\n",
+		       (long long)(alloc_stats.allocs - alloc_stats.frees),
+		       (long long)alloc_stats.allocs);
+	}
+	return 0;
+}
@@ -32,36 +32,57 @@ initiate_effectivearea(const POINTARRAY *inpts)
 	LWDEBUG(2, "Entered  initiate_effectivearea");
 	EFFECTIVE_AREAS *ea;
 	ea=lwalloc(sizeof(EFFECTIVE_AREAS));
-	ea->initial_arealist = lwalloc(inpts->npoints*sizeof(areanode));
-	ea->res_arealist = lwalloc(inpts->npoints*sizeof(double));
-	ea->inpts=inpts;
+	ea->initial_arealist = NULL;
+	ea->res_arealist = NULL;
+	ea->tree.key_array = NULL;
+	ea->tree.maxSize=0;
+	ea->tree.usedSize=0;
+	ea->maxpoints=0;
+	ea->inpts=NULL;
+	if(inpts)
+		effectivearea_set_ptarray(ea, inpts);
 	return ea;
 }
 
 
-void destroy_effectivearea(EFFECTIVE_AREAS *ea)
-{
-	lwfree(ea->initial_arealist);
-	lwfree(ea->res_arealist);
-	lwfree(ea);
-}
-
+/**
 
-static MINHEAP
-initiate_minheap(int npoints)
+Point the workspace at a new pointarray, growing the lists only when it does not fit
+*/
+void effectivearea_set_ptarray(EFFECTIVE_AREAS *ea, const POINTARRAY *inpts)
 {
-	MINHEAP tree;
-	tree.key_array = lwalloc(npoints*sizeof(void*));
-	tree.maxSize=npoints;
-	tree.usedSize=0;
-	return tree;
+	int npoints=inpts->npoints;
+	if(npoints>ea->maxpoints)
+	{
+		int size=ea->maxpoints*2;
+		if(size<npoints)
+			size=npoints;
+		if(ea->maxpoints)
+		{
+			lwfree(ea->initial_arealist);
+			lwfree(ea->res_arealist);
+			lwfree(ea->tree.key_array);
+		}
+		ea->initial_arealist = lwalloc(size*sizeof(areanode));
+		ea->res_arealist = lwalloc(size*sizeof(double));
+		ea->tree.key_array = lwalloc(size*sizeof(heapnode));
+		ea->tree.maxSize=size;
+		ea->maxpoints=size;
+	}
+	ea->tree.usedSize=0;
+	ea->inpts=inpts;
 }
 
 
-static void
-destroy_minheap(MINHEAP tree)
+void destroy_effectivearea(EFFECTIVE_AREAS *ea)
 {
-	lwfree(tree.key_array);
+	if(ea->maxpoints)
+	{
+		lwfree(ea->initial_arealist);
+		lwfree(ea->res_arealist);
+		lwfree(ea->tree.key_array);
+	}
+	lwfree(ea);
 }
 
 
@@ -100,17 +121,17 @@ static double triarea3d(const double *P1, const double *P2, const double *P3)
 
 /**
 
-We create the minheap by ordering the minheap array by the areas in the areanode structs that the minheap keys refere to
+We create the minheap by ordering the minheap array by the areas copied into its keys
 */
 static int cmpfunc (const void * a, const void * b)
 {
-	double v1 =  (*(areanode**)a)->area;
-	double v2 = (*(areanode**)b)->area;
+	double v1 = ((const heapnode*)a)->area;
+	double v2 = ((const heapnode*)b)->area;
 	/*qsort gives unpredictable results when comaping identical values.
 	If two values is the same we force returning the last point in hte point array.
 	That way we get the same ordering on diffreent machines and pllatforms*/
 	if (v1==v2)
-		return (*(areanode**)a)-(*(areanode**)b);
+		return ((const heapnode*)a)->index-((const heapnode*)b)->index;
 	else
 		return  (v1>v2 ) ? 1 : -1;
 }
@@ -123,42 +144,44 @@ Sift Down
 static void down(MINHEAP *tree,areanode *arealist,int parent)
 {
 	LWDEBUG(2, "Entered  down");
-	areanode **treearray=tree->key_array;
-	int left=parent*2+1;
-	int right = left +1;
-	void *tmp;
-	int swap=parent;
-	double leftarea=0;
-	double rightarea=0;
+	heapnode *treearray=tree->key_array;
+	int usedSize=tree->usedSize;
+	heapnode tmp;
 
-	double parentarea=((areanode*) treearray[parent])->area;
-
-	if(left<tree->usedSize)
-	{
-		leftarea=((areanode*) treearray[left])->area;
-		if(parentarea>leftarea)
-			swap=left;
-	}
-	if(right<tree->usedSize)
-	{
-		rightarea=((areanode*) treearray[right])->area;
-		if(rightarea<parentarea&&rightarea<leftarea)
-			swap=right;
-	}
-	if(swap>parent)
+	for(;;)
 	{
-	/*ok, we have to swap something*/
+		int left=parent*2+1;
+		int right = left +1;
+		int swap=parent;
+		double leftarea=0;
+		double rightarea=0;
+		double parentarea=treearray[parent].area;
+
+		if(left<usedSize)
+		{
+			leftarea=treearray[left].area;
+			if(parentarea>leftarea)
+				swap=left;
+		}
+		if(right<usedSize)
+		{
+			rightarea=treearray[right].area;
+			if(rightarea<parentarea&&rightarea<leftarea)
+				swap=right;
+		}
+		if(swap==parent)
+			return;
+
+		/*ok, we have to swap something*/
 		tmp=treearray[parent];
 		treearray[parent]=treearray[swap];
 		/*Update reference*/
-		((areanode*) treearray[parent])->treeindex=parent;
+		arealist[treearray[parent].index].treeindex=parent;
 		treearray[swap]=tmp;
 		/*Update reference*/
-		((areanode*) treearray[swap])->treeindex=swap;
-		if(swap<tree->usedSize)
-			down(tree,arealist,swap);
+		arealist[tmp.index].treeindex=swap;
+		parent=swap;
 	}
-	return;
 }
 
 
@@ -169,24 +192,24 @@ Sift Up
 static void up(MINHEAP *tree,areanode *arealist,int c)
 {
 	LWDEBUG(2, "Entered  up");
-	void *tmp;
+	heapnode tmp;
 
-	areanode **treearray=tree->key_array;
+	heapnode *treearray=tree->key_array;
 
-	int parent=floor((c-1)/2);
+	int parent=(c-1)/2;
 
-	while(((areanode*) treearray[c])->area<((areanode*) treearray[parent])->area)
+	while(treearray[c].area<treearray[parent].area)
 	{
 		/*ok, we have to swap*/
 		tmp=treearray[parent];
 		treearray[parent]=treearray[c];
 		/*Update reference*/
-		((areanode*) treearray[parent])->treeindex=parent;
+		arealist[treearray[parent].index].treeindex=parent;
 		treearray[c]=tmp;
 		/*Update reference*/
-		((areanode*) treearray[c])->treeindex=c;
+		arealist[tmp.index].treeindex=c;
 		c=parent;
-		parent=floor((c-1)/2);
+		parent=(c-1)/2;
 	}
 	return;
 }
@@ -194,16 +217,16 @@ static void up(MINHEAP *tree,areanode *arealist,int c)
 
 /**
 
-Get a reference to the point with the smallest effective area from the root of the min heap
+Get the point with the smallest effective area from the root of the min heap
 */
-static 	areanode* minheap_pop(MINHEAP *tree,areanode *arealist )
+static int minheap_pop(MINHEAP *tree,areanode *arealist )
 {
 	LWDEBUG(2, "Entered  minheap_pop");
-	areanode *res = tree->key_array[0];
+	int res = tree->key_array[0].index;
 
 	/*put last value first*/
 	tree->key_array[0]=tree->key_array[(tree->usedSize)-1];
-	((areanode*) tree->key_array[0])->treeindex=0;
+	arealist[tree->key_array[0].index].treeindex=0;
 
 	tree->usedSize--;
 	down(tree,arealist,0);
@@ -213,17 +236,21 @@ static 	areanode* minheap_pop(MINHEAP *tree,areanode *arealist )
 
 /**
 
-The member of the minheap at index idx is changed. Update the tree and make restore the heap property
+The area of point idx is changed. Update its key and restore the heap property
 */
-static void minheap_update(MINHEAP *tree,areanode *arealist , int idx)
+static void minheap_update(MINHEAP *tree,areanode *arealist , int idx, double area)
 {
-	areanode **treearray=tree->key_array;
-	int 	parent=floor((idx-1)/2);
+	heapnode *treearray=tree->key_array;
+	int c=arealist[idx].treeindex;
+	int parent=(c-1)/2;
+
+	arealist[idx].area=area;
+	treearray[c].area=area;
 
-	if(((areanode*) treearray[idx])->area<((areanode*) treearray[parent])->area)
-		up(tree,arealist,idx);
+	if(treearray[c].area<treearray[parent].area)
+		up(tree,arealist,c);
 	else
-		down(tree,arealist,idx);
+		down(tree,arealist,c);
 	return;
 }
 
@@ -245,27 +272,28 @@ static void tune_areas(EFFECTIVE_AREAS *ea, int avoid_collaps, int set_area, dou
 	int i;
 	int current, before_current, after_current;
 
-	MINHEAP tree = initiate_minheap(npoints);
+	MINHEAP *tree = &ea->tree;
 
 	int is3d = FLAGS_GET_Z(ea->inpts->flags);
 
 
-	/*Add all keys (index in initial_arealist) into minheap array*/
+	/*Add all keys (area and index in initial_arealist) into minheap array*/
 	for (i=0;i<npoints;i++)
 	{
-		tree.key_array[i]=ea->initial_arealist+i;
-		LWDEBUGF(2, "add nr %d, with area %lf, and %lf",i,ea->initial_arealist[i].area, tree.key_array[i]->area );
+		tree->key_array[i].area=ea->initial_arealist[i].area;
+		tree->key_array[i].index=i;
+		LWDEBUGF(2, "add nr %d, with area %lf",i,ea->initial_arealist[i].area);
 	}
-	tree.usedSize=npoints;
+	tree->usedSize=npoints;
 
 	/*order the keys by area, small to big*/
-	qsort(tree.key_array, npoints, sizeof(void*), cmpfunc);
+	qsort(tree->key_array, npoints, sizeof(heapnode), cmpfunc);
 
 	/*We have to put references to our tree in our point-list*/
 	for (i=0;i<npoints;i++)
 	{
-		 ((areanode*) tree.key_array[i])->treeindex=i;
-		LWDEBUGF(4,"Check ordering qsort gives, area=%lf and belong to point %d",((areanode*) tree.key_array[i])->area, tree.key_array[i]-ea->initial_arealist);
+		ea->initial_arealist[tree->key_array[i].index].treeindex=i;
+		LWDEBUGF(4,"Check ordering qsort gives, area=%lf and belong to point %d",tree->key_array[i].area, tree->key_array[i].index);
 	}
 	/*Ok, now we have a minHeap, just need to keep it*/
 
@@ -274,7 +302,7 @@ static void tune_areas(EFFECTIVE_AREAS *ea, int avoid_collaps, int set_area, dou
 	while (go_on)
 	{
 		/*Get a reference to the point with the currently smallest effective area*/
-		current=minheap_pop(&tree, ea->initial_arealist)-ea->initial_arealist;
+		current=minheap_pop(tree, ea->initial_arealist);
 
 		/*We have found the smallest area. That is the resulting effective area for the "current" point*/
 		if (i<npoints-avoid_collaps)
@@ -306,8 +334,7 @@ static void tune_areas(EFFECTIVE_AREAS *ea, int avoid_collaps, int set_area, dou
 			else
 				area=triarea2d(P1, P2, P3);
 
-			ea->initial_arealist[before_current].area = FP_MAX(area,ea->res_arealist[current]);
-			minheap_update(&tree, ea->initial_arealist, ea->initial_arealist[before_current].treeindex);
+			minheap_update(tree, ea->initial_arealist, before_current, FP_MAX(area,ea->res_arealist[current]));
 		}
 		if(after_current<npoints-1)/*Check if point after current point is the last in the point array. */
 		{
@@ -323,8 +350,7 @@ static void tune_areas(EFFECTIVE_AREAS *ea, int avoid_collaps, int set_area, dou
 				area=triarea2d(P1, P2, P3);
 
 
-			ea->initial_arealist[after_current].area = FP_MAX(area,ea->res_arealist[current]);
-			minheap_update(&tree, ea->initial_arealist, ea->initial_arealist[after_current].treeindex);
+			minheap_update(tree, ea->initial_arealist, after_current, FP_MAX(area,ea->res_arealist[current]));
 		}
 
 		/*rearrange the nodes so the eliminated point will be ingored on the next run*/
@@ -337,7 +363,6 @@ static void tune_areas(EFFECTIVE_AREAS *ea, int avoid_collaps, int set_area, dou
 
 		i++;
 	};
-	destroy_minheap(tree);
 	return;
 }
 
@@ -352,46 +377,47 @@ void ptarray_calc_areas(EFFECTIVE_AREAS *ea, int avoid_collaps, int set_area, do
 	int i;
 	int npoints=ea->inpts->npoints;
 	int is3d = FLAGS_GET_Z(ea->inpts->flags);
-	double area;
-
-	const double *P1;
-	const double *P2;
-	const double *P3;
-
-	P1 = (double*)getPoint_internal(ea->inpts, 0);
-	P2 = (double*)getPoint_internal(ea->inpts, 1);
-
-	/*The first and last point shall always have the maximum effective area. We use float max to not make trouble for bbox*/
-	ea->initial_arealist[0].area=ea->initial_arealist[npoints-1].area=FLT_MAX;
-	ea->res_arealist[0]=ea->res_arealist[npoints-1]=FLT_MAX;
-
-	ea->initial_arealist[0].next=1;
-	ea->initial_arealist[0].prev=0;
-
-	for (i=1;i<(npoints)-1;i++)
+	int ndims = FLAGS_NDIMS(ea->inpts->flags);
+	const double *pts = (const double*)getPoint_internal(ea->inpts, 0);
+	double *areas = ea->res_arealist;
+	areanode *nodes = ea->initial_arealist;
+
+	/*The areas of all the triangles are independent of each other, so they are
+	calculated in one pass over the coordinates, with res_arealist as scratch space,
+	before the nodes are linked up*/
+	if(is3d)
 	{
-		ea->initial_arealist[i].next=i+1;
-		ea->initial_arealist[i].prev=i-1;
-		P3 = (double*)getPoint_internal(ea->inpts, i+1);
-
-		if(is3d)
-			area=triarea3d(P1, P2, P3);
-		else
-			area=triarea2d(P1, P2, P3);
+		for (i=1;i<(npoints)-1;i++)
+			areas[i]=triarea3d(pts+(i-1)*ndims, pts+i*ndims, pts+(i+1)*ndims);
+	}
+	else if(ndims==2)
+	{
+		for (i=1;i<(npoints)-1;i++)
+			areas[i]=triarea2d(pts+(i-1)*2, pts+i*2, pts+(i+1)*2);
+	}
+	else
+	{
+		for (i=1;i<(npoints)-1;i++)
+			areas[i]=triarea2d(pts+(i-1)*ndims, pts+i*ndims, pts+(i+1)*ndims);
+	}
 
-		LWDEBUGF(4,"Write area %lf to point %d on address %p",area,i,&(ea->initial_arealist[i].area));
-		ea->initial_arealist[i].area=area;
-		P1=P2;
-		P2=P3;
+	/*The first and last point shall always have the maximum effective area. We use float max to not make trouble for bbox*/
+	nodes[0].area=nodes[npoints-1].area=FLT_MAX;
+	areas[0]=areas[npoints-1]=FLT_MAX;
 
-	}
-		ea->initial_arealist[npoints-1].next=npoints-1;
-		ea->initial_arealist[npoints-1].prev=npoints-2;
+	nodes[0].next=1;
+	nodes[0].prev=0;
 
 	for (i=1;i<(npoints)-1;i++)
 	{
-		ea->res_arealist[i]=FLT_MAX;
+		nodes[i].next=i+1;
+		nodes[i].prev=i-1;
+		nodes[i].area=areas[i];
+		LWDEBUGF(4,"Write area %lf to point %d",areas[i],i);
+		areas[i]=FLT_MAX;
 	}
+	nodes[npoints-1].next=npoints-1;
+	nodes[npoints-1].prev=npoints-2;
 
 	tune_areas(ea,avoid_collaps,set_area, trshld);
 	return ;
@@ -399,19 +425,18 @@ void ptarray_calc_areas(EFFECTIVE_AREAS *ea, int avoid_collaps, int set_area, do
 
 
 
-static POINTARRAY * ptarray_set_effective_area(POINTARRAY *inpts,int avoid_collaps,int set_area, double trshld)
+static POINTARRAY * ptarray_set_effective_area(EFFECTIVE_AREAS *ea, POINTARRAY *inpts,int avoid_collaps,int set_area, double trshld)
 {
 	LWDEBUG(2, "Entered  ptarray_set_effective_area");
 	int p;
 	POINT4D pt;
-	EFFECTIVE_AREAS *ea;
 	POINTARRAY *opts;
 	int set_m;
 	if(set_area)
 		set_m=1;
 	else
 		set_m=FLAGS_GET_M(inpts->flags);
-	ea=initiate_effectivearea(inpts);
+	effectivearea_set_ptarray(ea, inpts);
 
 	opts = ptarray_construct_empty(FLAGS_GET_Z(inpts->flags), set_m, inpts->npoints);
 
@@ -442,31 +467,21 @@ static POINTARRAY * ptarray_set_effective_area(POINTARRAY *inpts,int avoid_colla
 			}
 		}
 	}
-	destroy_effectivearea(ea);
 
 	return opts;
 
 }
 
-static LWLINE* lwline_set_effective_area(const LWLINE *iline,int set_area, double trshld)
+static LWLINE* lwline_set_effective_area(EFFECTIVE_AREAS *ea, const LWLINE *iline,int set_area, double trshld)
 {
 	LWDEBUG(2, "Entered  lwline_set_effective_area");
+	LWLINE *oline;
 
 		/* Skip empty case or too small to simplify */
 	if( lwline_is_empty(iline) || iline->points->npoints<3)
 		return lwline_clone(iline);
 
-	int set_m;
-	if(set_area)
-		set_m=1;
-	else
-		set_m=FLAGS_GET_M(iline->flags);
-
-	LWLINE *oline = lwline_construct_empty(iline->srid, FLAGS_GET_Z(iline->flags), set_m);
-
-
-
-	oline = lwline_construct(iline->srid, NULL, ptarray_set_effective_area(iline->points,2,set_area,trshld));
+	oline = lwline_construct(iline->srid, NULL, ptarray_set_effective_area(ea, iline->points,2,set_area,trshld));
 
 	oline->type = iline->type;
 	return oline;
@@ -474,7 +489,7 @@ static LWLINE* lwline_set_effective_area(const LWLINE *iline,int set_area, doubl
 }
 
 
-static LWPOLY* lwpoly_set_effective_area(const LWPOLY *ipoly,int set_area, double trshld)
+static LWPOLY* lwpoly_set_effective_area(EFFECTIVE_AREAS *ea, const LWPOLY *ipoly,int set_area, double trshld)
 {
 	LWDEBUG(2, "Entered  lwpoly_set_effective_area");
 	int i;
@@ -491,13 +506,15 @@ static LWPOLY* lwpoly_set_effective_area(const LWPOLY *ipoly,int set_area, doubl
 
 	for (i = 0; i < ipoly->nrings; i++)
 	{
-		POINTARRAY *pa = ptarray_set_effective_area(ipoly->rings[i],avoid_collapse,set_area,trshld);
+		POINTARRAY *pa = ptarray_set_effective_area(ea, ipoly->rings[i],avoid_collapse,set_area,trshld);
 		/* Add ring to simplified polygon */
 		if(pa->npoints>=4)
 		{
 			if( lwpoly_add_ring(opoly,pa ) == LW_FAILURE )
 				return NULL;
 		}
+		else
+			ptarray_free(pa);
 		/*Inner rings we allow to ocollapse and then we remove them*/
 		avoid_collapse=0;
 	}
@@ -513,7 +530,9 @@ static LWPOLY* lwpoly_set_effective_area(const LWPOLY *ipoly,int set_area, doubl
 }
 
 
-static LWCOLLECTION* lwcollection_set_effective_area(const LWCOLLECTION *igeom,int set_area, double trshld)
+static LWGEOM* lwgeom_set_effective_area_ea(EFFECTIVE_AREAS *ea, const LWGEOM *igeom,int set_area, double trshld);
+
+static LWCOLLECTION* lwcollection_set_effective_area(EFFECTIVE_AREAS *ea, const LWCOLLECTION *igeom,int set_area, double trshld)
 {
 	LWDEBUG(2, "Entered  lwcollection_set_effective_area");
 	int i;
@@ -529,7 +548,7 @@ static LWCOLLECTION* lwcollection_set_effective_area(const LWCOLLECTION *igeom,i
 
 	for( i = 0; i < igeom->ngeoms; i++ )
 	{
-		LWGEOM *ngeom = lwgeom_set_effective_area(igeom->geoms[i],set_area,trshld);
+		LWGEOM *ngeom = lwgeom_set_effective_area_ea(ea, igeom->geoms[i],set_area,trshld);
 		if ( ngeom ) out = lwcollection_add_lwgeom(out, ngeom);
 	}
 
@@ -537,25 +556,562 @@ static LWCOLLECTION* lwcollection_set_effective_area(const LWCOLLECTION *igeom,i
 }
 
 
-LWGEOM* lwgeom_set_effective_area(const LWGEOM *igeom,int set_area, double trshld)
+static LWGEOM* lwgeom_set_effective_area_ea(EFFECTIVE_AREAS *ea, const LWGEOM *igeom,int set_area, double trshld)
 {
-	LWDEBUG(2, "Entered  lwgeom_set_effective_area");
 	switch (igeom->type)
 	{
 	case POINTTYPE:
 	case MULTIPOINTTYPE:
 		return lwgeom_clone(igeom);
 	case LINETYPE:
-		return (LWGEOM*)lwline_set_effective_area((LWLINE*)igeom,set_area, trshld);
+		return (LWGEOM*)lwline_set_effective_area(ea, (LWLINE*)igeom,set_area, trshld);
 	case POLYGONTYPE:
-		return (LWGEOM*)lwpoly_set_effective_area((LWPOLY*)igeom,set_area, trshld);
+		return (LWGEOM*)lwpoly_set_effective_area(ea, (LWPOLY*)igeom,set_area, trshld);
 	case MULTILINETYPE:
 	case MULTIPOLYGONTYPE:
 	case COLLECTIONTYPE:
-		return (LWGEOM*)lwcollection_set_effective_area((LWCOLLECTION *)igeom,set_area, trshld);
+		return (LWGEOM*)lwcollection_set_effective_area(ea, (LWCOLLECTION *)igeom,set_area, trshld);
 	default:
 		lwerror("lwgeom_simplify: unsupported geometry type: %s",lwtype_name(igeom->type));
 	}
 	return NULL;
 }
 
+
+LWGEOM* lwgeom_set_effective_area(const LWGEOM *igeom,int set_area, double trshld)
+{
+	LWDEBUG(2, "Entered  lwgeom_set_effective_area");
+	/*One workspace serves all the pointarrays of the geometry*/
+	EFFECTIVE_AREAS *ea = initiate_effectivearea(NULL);
+	LWGEOM *ogeom = lwgeom_set_effective_area_ea(ea, igeom, set_area, trshld);
+	destroy_effectivearea(ea);
+	return ogeom;
+}
+
+
+/**
+
+Simplification of a polygonal coverage.
+The rings are cut into chains at the vertices where they meet more than two
+other vertices, every distinct chain is simplified once and the rings are put
+together again from the simplified chains, so rings that share a boundary keep
+sharing it. Vertices are matched on their exact 2d coordinates.
+*/
+
+#define COV_NONE UINT32_MAX
+
+typedef struct
+{
+	POINTARRAY *pa;		/* the ring without repeated points */
+	uint32_t npoints;	/* distinct vertices, 0 for rings that are copied as they are */
+	uint32_t offset;	/* first vertex in the vertex id list */
+	uint32_t first_chain;
+	uint32_t nchains;
+	int hole;
+} cov_ring;
+
+typedef struct
+{
+	uint32_t ring;
+	uint32_t start;		/* ring position of the first vertex */
+	uint32_t len;		/* vertices, both ends included */
+	uint32_t key;		/* offset of the vertex ids in canonical order */
+	uint32_t uid;		/* the distinct chain */
+	int reversed;		/* canonical order runs against the ring */
+	int loop;			/* the whole ring, no vertex shared with other rings */
+} cov_chain;
+
+typedef struct
+{
+	double x;
+	double y;
+	uint32_t occ;
+} cov_vertex;
+
+typedef struct
+{
+	const uint32_t *seq;
+	uint32_t len;
+	uint32_t chain;
+} cov_key;
+
+
+static int cov_vertex_cmp(const void *a, const void *b)
+{
+	const cov_vertex *v1 = (const cov_vertex*)a;
+	const cov_vertex *v2 = (const cov_vertex*)b;
+	if (v1->x != v2->x)
+		return v1->x < v2->x ? -1 : 1;
+	if (v1->y != v2->y)
+		return v1->y < v2->y ? -1 : 1;
+	return v1->occ < v2->occ ? -1 : (v1->occ > v2->occ);
+}
+
+
+static int cov_key_cmp(const void *a, const void *b)
+{
+	const cov_key *k1 = (const cov_key*)a;
+	const cov_key *k2 = (const cov_key*)b;
+	uint32_t t;
+	if (k1->len != k2->len)
+		return k1->len < k2->len ? -1 : 1;
+	for (t = 0; t < k1->len; t++)
+	{
+		if (k1->seq[t] != k2->seq[t])
+			return k1->seq[t] < k2->seq[t] ? -1 : 1;
+	}
+	return 0;
+}
+
+
+/**
+
+The polygons of a coverage member, none for other types
+*/
+static uint32_t cov_polygons(LWGEOM * const *slot, LWPOLY * const **polys)
+{
+	const LWGEOM *geom = *slot;
+	if (!geom)
+		return 0;
+	if (geom->type == POLYGONTYPE)
+	{
+		*polys = (LWPOLY * const *)slot;
+		return 1;
+	}
+	if (geom->type == MULTIPOLYGONTYPE)
+	{
+		*polys = ((const LWMPOLY*)geom)->geoms;
+		return ((const LWMPOLY*)geom)->ngeoms;
+	}
+	return 0;
+}
+
+
+static void cov_neighbour(uint32_t *nb1, uint32_t *nb2, char *node, uint32_t v, uint32_t nb)
+{
+	if (nb == nb1[v] || nb == nb2[v])
+		return;
+	if (nb1[v] == COV_NONE)
+		nb1[v] = nb;
+	else if (nb2[v] == COV_NONE)
+		nb2[v] = nb;
+	else
+		node[v] = 1;
+}
+
+
+/**
+
+Put a ring together from the kept vertices of its chains
+*/
+static POINTARRAY* cov_ring_assemble(const cov_ring *cr, const cov_chain *chains, const char *keep, const uint32_t *keep_offset, const char *restored)
+{
+	POINTARRAY *pa;
+	POINT4D pt;
+	char *kept;
+	uint32_t c, t;
+
+	if (!cr->npoints)
+		return ptarray_clone_deep(cr->pa);
+
+	/* Mark the kept ring positions, then copy them out in the ring's own order */
+	kept = lwalloc(cr->npoints);
+	for (c = cr->first_chain; c < cr->first_chain + cr->nchains; c++)
+	{
+		const cov_chain *ch = chains + c;
+		const char *kp = keep + keep_offset[ch->uid];
+		int all = restored[ch->uid];
+
+		/* The last vertex of a chain is the first of the next one */
+		for (t = 0; t < ch->len - 1; t++)
+			kept[(ch->start + t) % cr->npoints] = all || kp[ch->reversed ? ch->len - 1 - t : t];
+	}
+
+	pa = ptarray_construct_empty(FLAGS_GET_Z(cr->pa->flags), FLAGS_GET_M(cr->pa->flags), cr->npoints + 1);
+	for (t = 0; t < cr->npoints; t++)
+	{
+		if (kept[t])
+		{
+			getPoint4d_p(cr->pa, t, &pt);
+			ptarray_append_point(pa, &pt, LW_TRUE);
+		}
+	}
+	lwfree(kept);
+	if (!pa->npoints)
+		return pa;
+	getPoint4d_p(pa, 0, &pt);
+	ptarray_append_point(pa, &pt, LW_TRUE);
+	return pa;
+}
+
+
+static LWPOLY* cov_polygon(const LWPOLY *ipoly, POINTARRAY **outpa, uint32_t *r)
+{
+	LWPOLY *opoly = lwpoly_construct_empty(ipoly->srid, FLAGS_GET_Z(ipoly->flags), FLAGS_GET_M(ipoly->flags));
+	uint32_t k;
+	for (k = 0; k < ipoly->nrings; k++, (*r)++)
+	{
+		if (!outpa[*r])
+			continue;
+		lwpoly_add_ring(opoly, outpa[*r]);
+		outpa[*r] = NULL;
+	}
+	return opoly;
+}
+
+
+LWGEOM** lwgeom_set_effective_area_coverage(LWGEOM * const *geoms, uint32_t ngeoms, double trshld)
+{
+	LWDEBUG(2, "Entered  lwgeom_set_effective_area_coverage");
+	LWGEOM **out = lwalloc(sizeof(LWGEOM*) * (ngeoms ? ngeoms : 1));
+	EFFECTIVE_AREAS *ea = initiate_effectivearea(NULL);
+	cov_ring *rings;
+	cov_chain *chains;
+	cov_vertex *verts;
+	cov_key *ckeys;
+	POINTARRAY **outpa;
+	uint32_t *vid, *nb1, *nb2, *keys, *uid_first, *uid_users, *keep_offset;
+	char *node, *keep, *restored;
+	uint32_t nrings = 0, nverts = 0, nids = 0, nchains = 0, nkeys = 0, nuids = 0, nkeep = 0;
+	uint32_t i, j, k, r, c, t;
+	int changed;
+
+	/* Collect the rings, without repeated points */
+	for (i = 0; i < ngeoms; i++)
+	{
+		LWPOLY * const *polys;
+		uint32_t npolys = cov_polygons(geoms + i, &polys);
+		for (j = 0; j < npolys; j++)
+			nrings += polys[j]->nrings;
+	}
+	rings = lwalloc(sizeof(cov_ring) * (nrings ? nrings : 1));
+	r = 0;
+	for (i = 0; i < ngeoms; i++)
+	{
+		LWPOLY * const *polys;
+		uint32_t npolys = cov_polygons(geoms + i, &polys);
+		for (j = 0; j < npolys; j++)
+		{
+			for (k = 0; k < polys[j]->nrings; k++, r++)
+			{
+				cov_ring *cr = rings + r;
+				cr->pa = ptarray_remove_repeated_points(polys[j]->rings[k], 0.0);
+				cr->hole = (k > 0);
+				/* Rings too small to simplify or not closed are left alone */
+				if (cr->pa->npoints > 3 && ptarray_is_closed_2d(cr->pa))
+					cr->npoints = cr->pa->npoints - 1;
+				else
+					cr->npoints = 0;
+				cr->offset = nverts;
+				nverts += cr->npoints;
+			}
+		}
+	}
+
+	/* Number the distinct vertices */
+	verts = lwalloc(sizeof(cov_vertex) * (nverts ? nverts : 1));
+	vid = lwalloc(sizeof(uint32_t) * (nverts ? nverts : 1));
+	for (r = 0; r < nrings; r++)
+	{
+		for (j = 0; j < rings[r].npoints; j++)
+		{
+			const POINT2D *p = getPoint2d_cp(rings[r].pa, j);
+			cov_vertex *v = verts + rings[r].offset + j;
+			v->x = p->x;
+			v->y = p->y;
+			v->occ = rings[r].offset + j;
+		}
+	}
+	qsort(verts, nverts, sizeof(cov_vertex), cov_vertex_cmp);
+	for (j = 0; j < nverts; j++)
+	{
+		if (j && (verts[j].x != verts[j-1].x || verts[j].y != verts[j-1].y))
+			nids++;
+		vid[verts[j].occ] = nids;
+	}
+	if (nverts)
+		nids++;
+	lwfree(verts);
+
+	/* Nodes are the vertices that do not have exactly two distinct neighbours */
+	nb1 = lwalloc(sizeof(uint32_t) * (nids ? nids : 1));
+	nb2 = lwalloc(sizeof(uint32_t) * (nids ? nids : 1));
+	node = lwalloc(nids ? nids : 1);
+	for (j = 0; j < nids; j++)
+	{
+		nb1[j] = nb2[j] = COV_NONE;
+		node[j] = 0;
+	}
+	for (r = 0; r < nrings; r++)
+	{
+		const uint32_t *rv = vid + rings[r].offset;
+		uint32_t n = rings[r].npoints;
+		for (j = 0; j < n; j++)
+		{
+			cov_neighbour(nb1, nb2, node, rv[j], rv[(j + n - 1) % n]);
+			cov_neighbour(nb1, nb2, node, rv[j], rv[(j + 1) % n]);
+		}
+	}
+	for (j = 0; j < nids; j++)
+	{
+		if (nb2[j] == COV_NONE)
+			node[j] = 1;
+	}
+	lwfree(nb1);
+	lwfree(nb2);
+
+	/* Cut the rings into chains from node to node */
+	for (r = 0; r < nrings; r++)
+	{
+		const uint32_t *rv = vid + rings[r].offset;
+		uint32_t m = 0;
+		for (j = 0; j < rings[r].npoints; j++)
+			m += node[rv[j]];
+		rings[r].first_chain = nchains;
+		rings[r].nchains = rings[r].npoints ? (m ? m : 1) : 0;
+		nchains += rings[r].nchains;
+		nkeys += rings[r].npoints + rings[r].nchains;
+	}
+	chains = lwalloc(sizeof(cov_chain) * (nchains ? nchains : 1));
+	keys = lwalloc(sizeof(uint32_t) * (nkeys ? nkeys : 1));
+	nkeys = 0;
+	for (r = 0; r < nrings; r++)
+	{
+		const uint32_t *rv = vid + rings[r].offset;
+		uint32_t n = rings[r].npoints;
+		uint32_t p = 0;
+		int loop = 1;
+
+		if (!n)
+			continue;
+
+		/* Start from a node, or from the smallest vertex id of a ring without nodes */
+		for (j = 0; j < n; j++)
+		{
+			if (node[rv[j]])
+			{
+				p = j;
+				loop = 0;
+				break;
+			}
+			if (rv[j] < rv[p])
+				p = j;
+		}
+
+		for (c = rings[r].first_chain; c < rings[r].first_chain + rings[r].nchains; c++)
+		{
+			cov_chain *ch = chains + c;
+			uint32_t *seq = keys + nkeys;
+			uint32_t d = n;
+
+			if (!loop)
+			{
+				for (d = 1; d < n; d++)
+				{
+					if (node[rv[(p + d) % n]])
+						break;
+				}
+			}
+			ch->ring = r;
+			ch->start = p;
+			ch->len = d + 1;
+			ch->key = nkeys;
+			ch->loop = loop;
+			for (t = 0; t < ch->len; t++)
+				seq[t] = rv[(p + t) % n];
+
+			/* The canonical order is the smaller of the two directions */
+			ch->reversed = 0;
+			for (t = 0; t < ch->len; t++)
+			{
+				if (seq[t] != seq[ch->len - 1 - t])
+				{
+					ch->reversed = seq[ch->len - 1 - t] < seq[t];
+					break;
+				}
+			}
+			if (ch->reversed)
+			{
+				for (t = 0; t < ch->len / 2; t++)
+				{
+					uint32_t tmp = seq[t];
+					seq[t] = seq[ch->len - 1 - t];
+					seq[ch->len - 1 - t] = tmp;
+				}
+			}
+			nkeys += ch->len;
+			p = (p + d) % n;
+		}
+	}
+	lwfree(node);
+
+	/* Find the distinct chains */
+	ckeys = lwalloc(sizeof(cov_key) * (nchains ? nchains : 1));
+	for (c = 0; c < nchains; c++)
+	{
+		ckeys[c].seq = keys + chains[c].key;
+		ckeys[c].len = chains[c].len;
+		ckeys[c].chain = c;
+	}
+	qsort(ckeys, nchains, sizeof(cov_key), cov_key_cmp);
+	uid_first = lwalloc(sizeof(uint32_t) * (nchains ? nchains : 1));
+	uid_users = lwalloc(sizeof(uint32_t) * (nchains ? nchains : 1));
+	for (c = 0; c < nchains; c++)
+	{
+		if (!c || cov_key_cmp(ckeys + c - 1, ckeys + c))
+		{
+			uid_first[nuids] = ckeys[c].chain;
+			uid_users[nuids] = 0;
+			nuids++;
+		}
+		chains[ckeys[c].chain].uid = nuids - 1;
+		uid_users[nuids - 1]++;
+	}
+	lwfree(ckeys);
+	lwfree(keys);
+	lwfree(vid);
+
+	/* Simplify every distinct chain once, in its canonical order */
+	keep_offset = lwalloc(sizeof(uint32_t) * (nuids ? nuids : 1));
+	for (k = 0; k < nuids; k++)
+	{
+		keep_offset[k] = nkeep;
+		nkeep += chains[uid_first[k]].len;
+	}
+	keep = lwalloc(nkeep ? nkeep : 1);
+	for (k = 0; k < nuids; k++)
+	{
+		cov_chain *ch = chains + uid_first[k];
+		const cov_ring *cr = rings + ch->ring;
+		char *kp = keep + keep_offset[k];
+		POINTARRAY *pa;
+		POINT4D pt = {0, 0, 0, 0};
+		int avoid_collaps;
+
+		if (ch->len < 3)
+		{
+			memset(kp, 1, ch->len);
+			continue;
+		}
+
+		if (ch->loop && uid_users[k] == 1)
+		{
+			/* A ring of its own is simplified like lwpoly_set_effective_area does it */
+			ch->start = 0;
+			ch->reversed = 0;
+			avoid_collaps = cr->hole ? 0 : 4;
+		}
+		else if (ch->loop)
+			avoid_collaps = 4;
+		else
+			avoid_collaps = 2;
+
+		pa = ptarray_construct_empty(0, 0, ch->len);
+		for (t = 0; t < ch->len; t++)
+		{
+			const POINT2D *p = getPoint2d_cp(cr->pa, (ch->start + (ch->reversed ? ch->len - 1 - t : t)) % cr->npoints);
+			pt.x = p->x;
+			pt.y = p->y;
+			ptarray_append_point(pa, &pt, LW_TRUE);
+		}
+		/* Chains closed at a node are rings as well */
+		if (avoid_collaps == 2 && ptarray_is_closed_2d(pa))
+			avoid_collaps = 4;
+
+		effectivearea_set_ptarray(ea, pa);
+		ptarray_calc_areas(ea, avoid_collaps, 0, trshld);
+		for (t = 0; t < ch->len; t++)
+			kp[t] = ea->res_arealist[t] > trshld;
+		ptarray_free(pa);
+	}
+
+	/* Put the rings together. Collapsed holes of their own are dropped,
+	the chains of other collapsed rings are put back as they were */
+	restored = lwalloc(nuids ? nuids : 1);
+	memset(restored, 0, nuids ? nuids : 1);
+	outpa = lwalloc(sizeof(POINTARRAY*) * (nrings ? nrings : 1));
+	for (r = 0; r < nrings; r++)
+		outpa[r] = NULL;
+	do
+	{
+		changed = 0;
+		for (r = 0; r < nrings; r++)
+		{
+			const cov_ring *cr = rings + r;
+			int own = 1;
+
+			if (outpa[r])
+				ptarray_free(outpa[r]);
+			outpa[r] = cov_ring_assemble(cr, chains, keep, keep_offset, restored);
+			if (!cr->npoints || outpa[r]->npoints >= 4)
+				continue;
+
+			for (c = cr->first_chain; c < cr->first_chain + cr->nchains; c++)
+				own = own && uid_users[chains[c].uid] == 1;
+			if (cr->hole && own)
+			{
+				ptarray_free(outpa[r]);
+				outpa[r] = NULL;
+				continue;
+			}
+			for (c = cr->first_chain; c < cr->first_chain + cr->nchains; c++)
+			{
+				if (!restored[chains[c].uid])
+				{
+					restored[chains[c].uid] = 1;
+					changed = 1;
+				}
+			}
+		}
+	}
+	while (changed);
+
+	/* Build the output geometries */
+	r = 0;
+	for (i = 0; i < ngeoms; i++)
+	{
+		const LWGEOM *geom = geoms[i];
+		LWPOLY * const *polys;
+		uint32_t npolys;
+
+		if (!geom)
+		{
+			out[i] = NULL;
+			continue;
+		}
+		npolys = cov_polygons(geoms + i, &polys);
+		if (geom->type == POLYGONTYPE)
+		{
+			out[i] = lwpoly_as_lwgeom(cov_polygon(polys[0], outpa, &r));
+		}
+		else if (geom->type == MULTIPOLYGONTYPE)
+		{
+			LWCOLLECTION *col = lwcollection_construct_empty(MULTIPOLYGONTYPE, geom->srid, FLAGS_GET_Z(geom->flags), FLAGS_GET_M(geom->flags));
+			for (j = 0; j < npolys; j++)
+				col = lwcollection_add_lwgeom(col, lwpoly_as_lwgeom(cov_polygon(polys[j], outpa, &r)));
+			out[i] = lwcollection_as_lwgeom(col);
+		}
+		else
+		{
+			/* Other members are simplified on their own */
+			out[i] = lwgeom_set_effective_area_ea(ea, geom, 0, trshld);
+		}
+	}
+
+	for (r = 0; r < nrings; r++)
+	{
+		if (outpa[r])
+			ptarray_free(outpa[r]);
+		ptarray_free(rings[r].pa);
+	}
+	lwfree(outpa);
+	lwfree(restored);
+	lwfree(keep);
+	lwfree(keep_offset);
+	lwfree(uid_first);
+	lwfree(uid_users);
+	lwfree(chains);
+	lwfree(rings);
+	destroy_effectivearea(ea);
+	return out;
+}
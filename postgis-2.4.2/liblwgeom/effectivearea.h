@@ -44,6 +44,18 @@ typedef struct
 } areanode;
 
 
+/**
+
+One key of the minheap: the effective area of a point is copied in next to the point number,
+so sifting the heap compares keys without going back to the arealist.
+*/
+typedef struct
+{
+	double area;
+	int index;
+} heapnode;
+
+
 /**
 
 This structure holds a minheap tree that is used to keep track of what points that has the smallest effective area.
@@ -53,24 +65,29 @@ typedef struct
 {
 	int maxSize;
 	int usedSize;
-	areanode **key_array;
+	heapnode *key_array;
 } MINHEAP;
 
 
 /**
 
-Structure to hold pointarray and it's arealist
+Structure to hold pointarray and it's arealist.
+The lists and the heap are sized for maxpoints, so one structure can be reused for many pointarrays.
 */
 typedef struct
 {
 	const POINTARRAY *inpts;
 	areanode *initial_arealist;
 	double *res_arealist;
+	MINHEAP tree;
+	int maxpoints;
 } EFFECTIVE_AREAS;
 
 
 EFFECTIVE_AREAS* initiate_effectivearea(const POINTARRAY *inpts);
 
+void effectivearea_set_ptarray(EFFECTIVE_AREAS *ea, const POINTARRAY *inpts);
+
 void destroy_effectivearea(EFFECTIVE_AREAS *ea);
 
 void ptarray_calc_areas(EFFECTIVE_AREAS *ea,int avoid_collaps, int set_area, double trshld);
@@ -290,6 +290,74 @@ uint64_t gbox_get_sortable_hash(const GBOX *g)
 	return uint32_interleave_2(x.u, y.u);
 }
 
+/*
+* Map the bits of an IEEE float onto an unsigned int that
+* sorts like the float itself, negative values included.
+*/
+static inline uint32_t float_sortable_bits(float f)
+{
+	union floatuint u;
+	u.f = f;
+	return (u.u & 0x80000000) ? ~u.u : (u.u | 0x80000000);
+}
+
+/*
+* Distance of (x, y) along a Hilbert curve covering the
+* full 2^32 x 2^32 grid. Unlike the Z-order interleave,
+* consecutive keys are always neighbouring cells.
+*/
+static uint64_t uint32_hilbert(uint32_t x, uint32_t y)
+{
+	uint64_t d = 0;
+	uint32_t s, rx, ry, t;
+
+	for ( s = 0x80000000; s > 0; s >>= 1 )
+	{
+		rx = (x & s) > 0;
+		ry = (y & s) > 0;
+		d += (uint64_t)s * s * ((3 * rx) ^ ry);
+
+		/* Rotate the quadrant so the curve stays continuous */
+		if ( ry == 0 )
+		{
+			if ( rx == 1 )
+			{
+				x = ~x;
+				y = ~y;
+			}
+			t = x;
+			x = y;
+			y = t;
+		}
+	}
+	return d;
+}
+
+uint64_t gbox_get_sortable_hilbert(const GBOX *g)
+{
+	float x, y;
+
+	if ( FLAGS_GET_GEODETIC(g->flags) )
+	{
+		GEOGRAPHIC_POINT gpt;
+		POINT3D p;
+		p.x = (g->xmax + g->xmin) / 2.0;
+		p.y = (g->ymax + g->ymin) / 2.0;
+		p.z = (g->zmax + g->zmin) / 2.0;
+		normalize(&p);
+		cart2geog(&p, &gpt);
+		x = gpt.lon;
+		y = gpt.lat;
+	}
+	else
+	{
+		/* As above, the division of the center is not needed for ordering */
+		x = g->xmax + g->xmin;
+		y = g->ymax + g->ymin;
+	}
+	return uint32_hilbert(float_sortable_bits(x), float_sortable_bits(y));
+}
+
 int gserialized_cmp(const GSERIALIZED *g1, const GSERIALIZED *g2)
 {
 	int g1_is_empty, g2_is_empty, cmp;
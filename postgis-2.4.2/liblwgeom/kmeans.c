@@ -1,7 +1,7 @@
 /*-------------------------------------------------------------------------
 *
 * kmeans.c
-*    Generic k-means implementation
+*    K-means implementation for 2d points
 *
 * Copyright (c) 2016, Paul Ramsey <pramsey@cleverelephant.ca>
 *
@@ -20,298 +20,573 @@
 #include <pthread.h>
 #endif
 
-static void
-update_r(kmeans_config *config)
+/*
+* Above this many objects, centers are seeded from a random
+* sample of the objects instead of from all of them.
+*/
+#define KMEANS_SEED_POOL 100000
+
+/* A center in the kd-tree, with its number */
+typedef struct
+{
+	double x, y;
+	int center;
+} kmeans_kdnode;
+
+/*
+* Everything the assignment step reads and writes. The kd-tree
+* is stored implicitly: the node of a range is its middle element,
+* split on x at even depths and on y at odd ones.
+*/
+typedef struct
 {
-	int i;
+	const POINT2D *objs;
+	const POINT2D *centers;
+	unsigned int k;
+	kmeans_kdnode *kdtree; /* NULL to scan all the centers */
+	int *clusters;
+	double *upper;  /* bound on the distance to the own center */
+	double *lower;  /* bound on the distance to any other center */
+	double *half;   /* half the distance from each center to the next closest */
+} kmeans_state;
+
+
+static inline double
+kmeans_distance2(const POINT2D *a, const POINT2D *b)
+{
+	double dx = a->x - b->x;
+	double dy = a->y - b->y;
+	return dx*dx + dy*dy;
+}
 
-	for (i = 0; i < config->num_objs; i++)
-	{
-		double distance, curr_distance;
-		int cluster, curr_cluster;
-		Pointer obj;
+/* splitmix64, small and good enough for sampling */
+static inline uint64_t
+kmeans_random(uint64_t *state)
+{
+	uint64_t z = (*state += UINT64_C(0x9E3779B97F4A7C15));
+	z = (z ^ (z >> 30)) * UINT64_C(0xBF58476D1CE4E5B9);
+	z = (z ^ (z >> 27)) * UINT64_C(0x94D049BB133111EB);
+	return z ^ (z >> 31);
+}
 
-		assert(config->objs != NULL);
-		assert(config->num_objs > 0);
-		assert(config->centers);
-		assert(config->clusters);
+/* Uniform in [0,1) */
+static inline double
+kmeans_random_unit(uint64_t *state)
+{
+	return (kmeans_random(state) >> 11) * (1.0 / 9007199254740992.0);
+}
 
-		obj = config->objs[i];
 
-		/*
-		* Don't try to cluster NULL objects, just add them
-		* to the "unclusterable cluster"
-		*/
-		if (!obj)
-		{
-			config->clusters[i] = KMEANS_NULL_CLUSTER;
-			continue;
-		}
+static int
+kmeans_kdnode_cmp_x(const void *a, const void *b)
+{
+	const kmeans_kdnode *na = (const kmeans_kdnode*)a;
+	const kmeans_kdnode *nb = (const kmeans_kdnode*)b;
+	if (na->x != nb->x) return na->x < nb->x ? -1 : 1;
+	return na->center - nb->center;
+}
 
-		/* Initialize with distance to first cluster */
-		curr_distance = (config->distance_method)(obj, config->centers[0]);
-		curr_cluster = 0;
+static int
+kmeans_kdnode_cmp_y(const void *a, const void *b)
+{
+	const kmeans_kdnode *na = (const kmeans_kdnode*)a;
+	const kmeans_kdnode *nb = (const kmeans_kdnode*)b;
+	if (na->y != nb->y) return na->y < nb->y ? -1 : 1;
+	return na->center - nb->center;
+}
 
-		/* Check all other cluster centers and find the nearest */
-		for (cluster = 1; cluster < config->k; cluster++)
-		{
-			distance = (config->distance_method)(obj, config->centers[cluster]);
-			if (distance < curr_distance)
-			{
-				curr_distance = distance;
-				curr_cluster = cluster;
-			}
-		}
+static void
+kmeans_kdtree_build(kmeans_kdnode *nodes, int lo, int hi, int depth)
+{
+	int mid;
+	if (hi - lo < 2) return;
+	qsort(nodes + lo, hi - lo, sizeof(kmeans_kdnode), depth % 2 ? kmeans_kdnode_cmp_y : kmeans_kdnode_cmp_x);
+	mid = (lo + hi) / 2;
+	kmeans_kdtree_build(nodes, lo, mid, depth + 1);
+	kmeans_kdtree_build(nodes, mid + 1, hi, depth + 1);
+}
+
+static void
+kmeans_kdtree_load(kmeans_kdnode *nodes, const POINT2D *centers, unsigned int k)
+{
+	unsigned int i;
+	for (i = 0; i < k; i++)
+	{
+		nodes[i].x = centers[i].x;
+		nodes[i].y = centers[i].y;
+		nodes[i].center = i;
+	}
+	kmeans_kdtree_build(nodes, 0, k, 0);
+}
 
-		/* Store the nearest cluster this object is in */
-		config->clusters[i] = curr_cluster;
+/*
+* Nearest and second nearest center, as squared distances. Ties on
+* the nearest go to the lowest center number, like a full scan.
+*/
+static inline void
+kmeans_consider(int center, double d, int *best, double *d_best, double *d_second)
+{
+	if (d < *d_best || (d == *d_best && center < *best))
+	{
+		if (*best >= 0) *d_second = *d_best;
+		*d_best = d;
+		*best = center;
+	}
+	else if (d < *d_second)
+	{
+		*d_second = d;
 	}
 }
 
 static void
-update_means(kmeans_config *config)
+kmeans_kdtree_closest(const kmeans_kdnode *nodes, int lo, int hi, int depth, const POINT2D *p,
+                      int *best, double *d_best, double *d_second)
 {
-	int i;
+	const kmeans_kdnode *node;
+	POINT2D q;
+	double diff;
+	int mid;
+
+	if (lo >= hi) return;
+	mid = (lo + hi) / 2;
+	node = nodes + mid;
+	q.x = node->x;
+	q.y = node->y;
+	kmeans_consider(node->center, kmeans_distance2(p, &q), best, d_best, d_second);
+
+	diff = depth % 2 ? p->y - node->y : p->x - node->x;
+	if (diff < 0)
+	{
+		kmeans_kdtree_closest(nodes, lo, mid, depth + 1, p, best, d_best, d_second);
+		if (diff * diff <= *d_second)
+			kmeans_kdtree_closest(nodes, mid + 1, hi, depth + 1, p, best, d_best, d_second);
+	}
+	else
+	{
+		kmeans_kdtree_closest(nodes, mid + 1, hi, depth + 1, p, best, d_best, d_second);
+		if (diff * diff <= *d_second)
+			kmeans_kdtree_closest(nodes, lo, mid, depth + 1, p, best, d_best, d_second);
+	}
+}
 
-	for (i = 0; i < config->k; i++)
+static int
+kmeans_closest(const kmeans_state *st, const POINT2D *p, double *d_best, double *d_second)
+{
+	int best = -1;
+	unsigned int i;
+
+	*d_best = *d_second = DBL_MAX;
+	if (st->kdtree)
+	{
+		kmeans_kdtree_closest(st->kdtree, 0, st->k, 0, p, &best, d_best, d_second);
+	}
+	else
+	{
+		for (i = 0; i < st->k; i++)
+			kmeans_consider(i, kmeans_distance2(p, &(st->centers[i])), &best, d_best, d_second);
+	}
+	return best;
+}
+
+/*
+* Assign the objects of [first, last) to their closest center,
+* returning how many changed cluster. Unless full is set, objects
+* whose bounds keep them in their cluster are not searched.
+*/
+static size_t
+update_r(const kmeans_state *st, size_t first, size_t last, int full)
+{
+	size_t i, changed = 0;
+
+	for (i = first; i < last; i++)
 	{
-		/* Update the centroid for this cluster */
-		(config->centroid_method)(config->objs, config->clusters, config->num_objs, i, config->centers[i]);
+		const POINT2D *obj = &(st->objs[i]);
+		int cluster = st->clusters[i];
+		double d_best, d_second;
+
+		if (!full)
+		{
+			double bound = FP_MAX(st->half[cluster], st->lower[i]);
+			if (st->upper[i] <= bound)
+				continue;
+
+			/* Tighten the upper bound, and try again */
+			st->upper[i] = sqrt(kmeans_distance2(obj, &(st->centers[cluster])));
+			if (st->upper[i] <= bound)
+				continue;
+		}
+
+		cluster = kmeans_closest(st, obj, &d_best, &d_second);
+		st->upper[i] = sqrt(d_best);
+		st->lower[i] = sqrt(d_second);
+		if (full || cluster != st->clusters[i])
+		{
+			changed++;
+			st->clusters[i] = cluster;
+		}
 	}
+	return changed;
 }
 
 #ifdef KMEANS_THREADED
 
-static void * update_r_threaded_main(void *args)
+typedef struct
+{
+	const kmeans_state *st;
+	size_t first, last;
+	int full;
+	size_t changed;
+} kmeans_thread_args;
+
+static void *
+update_r_threaded_main(void *arg)
 {
-	kmeans_config *config = (kmeans_config*)args;
-	update_r(config);
-	pthread_exit(args);
+	kmeans_thread_args *args = (kmeans_thread_args*)arg;
+	args->changed = update_r(args->st, args->first, args->last, args->full);
+	pthread_exit(arg);
 }
 
-static void update_r_threaded(kmeans_config *config)
+static size_t
+update_r_threaded(const kmeans_state *st, size_t num_objs, int full)
 {
 	/* Computational complexity is function of objs/clusters */
 	/* We only spin up threading infra if we need more than one core */
 	/* running. We keep the threshold high so the overhead of */
 	/* thread management is small compared to thread compute time */
-	int num_threads = config->num_objs * config->k / KMEANS_THR_THRESHOLD;
+	size_t num_threads = num_objs * st->k / KMEANS_THR_THRESHOLD;
+	pthread_t thread[KMEANS_THR_MAX];
+	int started[KMEANS_THR_MAX];
+	kmeans_thread_args args[KMEANS_THR_MAX];
+	pthread_attr_t thread_attr;
+	size_t i, changed = 0;
 
 	/* Can't run more threads than the maximum */
 	num_threads = (num_threads > KMEANS_THR_MAX ? KMEANS_THR_MAX : num_threads);
 
 	/* If the problem size is small, don't bother w/ threading */
-	if (num_threads < 1)
+	if (num_threads < 2)
+		return update_r(st, 0, num_objs, full);
+
+	pthread_attr_init(&thread_attr);
+	pthread_attr_setdetachstate(&thread_attr, PTHREAD_CREATE_JOINABLE);
+
+	/* Each thread assigns its own contiguous share of the objects */
+	for (i = 0; i < num_threads; i++)
 	{
-		update_r(config);
+		args[i].st = st;
+		args[i].first = num_objs * i / num_threads;
+		args[i].last = num_objs * (i + 1) / num_threads;
+		args[i].full = full;
+		args[i].changed = 0;
+		started[i] = (pthread_create(&thread[i], &thread_attr, update_r_threaded_main, (void *) &args[i]) == 0);
+
+		/* No thread to be had, do the share here */
+		if (!started[i])
+			args[i].changed = update_r(st, args[i].first, args[i].last, full);
 	}
-	else
-	{
-		pthread_t thread[KMEANS_THR_MAX];
-	    pthread_attr_t thread_attr;
-		kmeans_config thread_config[KMEANS_THR_MAX];
-		int obs_per_thread = config->num_objs / num_threads;
-	    int i, rc;
 
-		for (i = 0; i < num_threads; i++)
-		{
-			/*
-			* Each thread gets a copy of the config, but with the list pointers
-			* offest to the start of the batch the thread is responsible for, and the
-			* object count number adjusted similarly.
-			*/
-			memcpy(&(thread_config[i]), config, sizeof(kmeans_config));
-			thread_config[i].objs += i*obs_per_thread;
-			thread_config[i].clusters += i*obs_per_thread;
-			thread_config[i].num_objs = obs_per_thread;
-			if (i == num_threads-1)
-			{
-				thread_config[i].num_objs += config->num_objs - num_threads*obs_per_thread;
-			}
+	pthread_attr_destroy(&thread_attr);
+
+	for (i = 0; i < num_threads; i++)
+	{
+		void *status;
+		if (started[i])
+			pthread_join(thread[i], &status);
+		changed += args[i].changed;
+	}
+	return changed;
+}
 
-		    /* Initialize and set thread detached attribute */
-		    pthread_attr_init(&thread_attr);
-		    pthread_attr_setdetachstate(&thread_attr, PTHREAD_CREATE_JOINABLE);
+#endif /* KMEANS_THREADED */
 
-			/* Now we just run the thread, on its subset of the data */
-			rc = pthread_create(&thread[i], &thread_attr, update_r_threaded_main, (void *) &thread_config[i]);
-			if (rc)
-			{
-				printf("ERROR: return code from pthread_create() is %d\n", rc);
-				exit(-1);
-			}
-		}
+static size_t
+kmeans_assign(kmeans_state *st, size_t num_objs, int full)
+{
+	unsigned int c;
+	double d_best, d_second;
 
-	    /* Free attribute and wait for the other threads */
-	    pthread_attr_destroy(&thread_attr);
+	if (st->kdtree)
+		kmeans_kdtree_load(st->kdtree, st->centers, st->k);
 
-		/* Wait for all calculations to complete */
-		for (i = 0; i < num_threads; i++)
+	/* Half the distance to the next center: closer than that, nothing to search */
+	for (c = 0; c < st->k; c++)
+	{
+		if (st->kdtree)
 		{
-		    void *status;
-			rc = pthread_join(thread[i], &status);
-			if (rc)
-			{
-				printf("ERROR: return code from pthread_join() is %d\n", rc);
-				exit(-1);
-			}
+			/* The center itself comes out first */
+			kmeans_closest(st, &(st->centers[c]), &d_best, &d_second);
 		}
+		else
+		{
+			unsigned int j;
+			d_second = DBL_MAX;
+			for (j = 0; j < st->k; j++)
+				if (j != c)
+					d_second = FP_MIN(d_second, kmeans_distance2(&(st->centers[c]), &(st->centers[j])));
+		}
+		st->half[c] = sqrt(d_second) / 2;
 	}
-}
 
-int update_means_k;
-pthread_mutex_t update_means_k_mutex;
+#ifdef KMEANS_THREADED
+	return update_r_threaded(st, num_objs, full);
+#else
+	return update_r(st, 0, num_objs, full);
+#endif
+}
 
-static void *
-update_means_threaded_main(void *arg)
+/*
+* Move the centers to the mean of their objects, and return how
+* far each one moved. Centers without objects stay where they are.
+*/
+static void
+update_means(kmeans_config *config, double *moved)
 {
-	kmeans_config *config = (kmeans_config*)arg;
-	int i = 0;
+	double *sums = kmeans_malloc(sizeof(double) * 2 * config->k);
+	size_t *counts = kmeans_malloc(sizeof(size_t) * config->k);
+	unsigned int c;
+	size_t i;
+
+	memset(sums, 0, sizeof(double) * 2 * config->k);
+	memset(counts, 0, sizeof(size_t) * config->k);
 
-	do
+	for (i = 0; i < config->num_objs; i++)
 	{
-		pthread_mutex_lock (&update_means_k_mutex);
-		i = update_means_k;
-		update_means_k++;
-		pthread_mutex_unlock (&update_means_k_mutex);
+		c = config->clusters[i];
+		sums[2*c] += config->objs[i].x;
+		sums[2*c+1] += config->objs[i].y;
+		counts[c]++;
+	}
 
-		if (i < config->k)
-			(config->centroid_method)(config->objs, config->clusters, config->num_objs, i, config->centers[i]);
+	for (c = 0; c < config->k; c++)
+	{
+		POINT2D mean;
+		moved[c] = 0.0;
+		if (!counts[c]) continue;
+		mean.x = sums[2*c] / counts[c];
+		mean.y = sums[2*c+1] / counts[c];
+		moved[c] = sqrt(kmeans_distance2(&mean, &(config->centers[c])));
+		config->centers[c] = mean;
 	}
-	while (i < config->k);
 
-	pthread_exit(arg);
+	kmeans_free(sums);
+	kmeans_free(counts);
 }
 
+/*
+* Mini-batch passes (Sculley 2010): each pass assigns a random
+* sample of the objects, then pulls each of their centers towards
+* them by the inverse of the number of objects it has taken so far.
+*/
 static void
-update_means_threaded(kmeans_config *config)
+kmeans_minibatch(kmeans_config *config, kmeans_state *st, uint64_t *rstate)
 {
-	/* We only spin up threading infra if we need more than one core */
-	/* running. We keep the threshold high so the overhead of */
-	/* thread management is small compared to thread compute time */
-	int num_threads = config->num_objs / KMEANS_THR_THRESHOLD;
+	size_t *taken = kmeans_malloc(sizeof(size_t) * config->k);
+	size_t *batch = kmeans_malloc(sizeof(size_t) * config->batch_size);
+	int *batch_cluster = kmeans_malloc(sizeof(int) * config->batch_size);
+	unsigned int pass, b;
+	double d_best, d_second;
 
-	/* Can't run more threads than the maximum */
-	num_threads = (num_threads > KMEANS_THR_MAX ? KMEANS_THR_MAX : num_threads);
+	memset(taken, 0, sizeof(size_t) * config->k);
 
-	/* If the problem size is small, don't bother w/ threading */
-	if (num_threads < 1)
+	for (pass = 0; pass < config->batch_iterations; pass++)
 	{
-		update_means(config);
+		if (st->kdtree)
+			kmeans_kdtree_load(st->kdtree, st->centers, st->k);
+
+		for (b = 0; b < config->batch_size; b++)
+		{
+			batch[b] = kmeans_random(rstate) % config->num_objs;
+			batch_cluster[b] = kmeans_closest(st, &(config->objs[batch[b]]), &d_best, &d_second);
+		}
+
+		for (b = 0; b < config->batch_size; b++)
+		{
+			POINT2D *center = &(config->centers[batch_cluster[b]]);
+			const POINT2D *obj = &(config->objs[batch[b]]);
+			double eta = 1.0 / ++taken[batch_cluster[b]];
+			center->x += eta * (obj->x - center->x);
+			center->y += eta * (obj->y - center->y);
+		}
 	}
-	else
-	{
-		/* Mutex protected counter to drive threads */
-		pthread_t thread[KMEANS_THR_MAX];
-		pthread_attr_t thread_attr;
-		int i, rc;
 
-		pthread_mutex_init(&update_means_k_mutex, NULL);
-		update_means_k = 0;
+	kmeans_free(taken);
+	kmeans_free(batch);
+	kmeans_free(batch_cluster);
+}
 
-		pthread_attr_init(&thread_attr);
-		pthread_attr_setdetachstate(&thread_attr, PTHREAD_CREATE_JOINABLE);
+/*
+* k-means++ seeding (Arthur and Vassilvitskii 2007): the first
+* center is drawn at random, each next one with probability
+* proportional to its squared distance to the closest center
+* drawn so far. Large inputs are seeded from a sample.
+*/
+kmeans_result
+kmeans_seed(kmeans_config *config)
+{
+	uint64_t rstate = config->seed;
+	size_t num_pool = config->num_objs;
+	size_t *pool = NULL;
+	double *d2;
+	double total;
+	size_t i, chosen;
+	unsigned int c;
 
-		/* Create threads to perform computation  */
-		for (i = 0; i < num_threads; i++)
-		{
+	assert(config);
+	assert(config->objs);
+	assert(config->num_objs);
+	assert(config->centers);
+	assert(config->k);
+	assert(config->k <= config->num_objs);
 
-			/* Now we just run the thread, on its subset of the data */
-			rc = pthread_create(&thread[i], &thread_attr, update_means_threaded_main, (void *) config);
-			if (rc)
-			{
-				printf("ERROR: return code from pthread_create() is %d\n", rc);
-				exit(-1);
-			}
-		}
+	if (num_pool > KMEANS_SEED_POOL)
+	{
+		num_pool = FP_MAX(KMEANS_SEED_POOL, 16 * (size_t)config->k);
+		num_pool = FP_MIN(num_pool, config->num_objs);
+		pool = kmeans_malloc(sizeof(size_t) * num_pool);
+		for (i = 0; i < num_pool; i++)
+			pool[i] = kmeans_random(&rstate) % config->num_objs;
+	}
+#define KMEANS_POOL_OBJ(i) (&(config->objs[pool ? pool[i] : (i)]))
+
+	d2 = kmeans_malloc(sizeof(double) * num_pool);
+
+	chosen = kmeans_random(&rstate) % num_pool;
+	config->centers[0] = *KMEANS_POOL_OBJ(chosen);
+	total = 0.0;
+	for (i = 0; i < num_pool; i++)
+	{
+		d2[i] = kmeans_distance2(KMEANS_POOL_OBJ(i), &(config->centers[0]));
+		total += d2[i];
+	}
 
-		pthread_attr_destroy(&thread_attr);
+	for (c = 1; c < config->k; c++)
+	{
+		LW_ON_INTERRUPT(kmeans_free(d2); if (pool) kmeans_free(pool); return KMEANS_ERROR);
 
-		/* Watch until completion  */
-		for (i = 0; i < num_threads; i++)
+		if (total > 0.0)
 		{
-		    void *status;
-			rc = pthread_join(thread[i], &status);
-			if (rc)
+			double r = kmeans_random_unit(&rstate) * total;
+			for (chosen = 0; chosen < num_pool - 1; chosen++)
 			{
-				printf("ERROR: return code from pthread_join() is %d\n", rc);
-				exit(-1);
+				r -= d2[chosen];
+				if (r < 0.0 && d2[chosen] > 0.0) break;
 			}
+			/* Rounding can walk past the last candidate */
+			while (d2[chosen] == 0.0 && chosen > 0)
+				chosen--;
+		}
+		else
+		{
+			/* Every object sits on a center already */
+			chosen = c % num_pool;
 		}
+		config->centers[c] = *KMEANS_POOL_OBJ(chosen);
 
-		pthread_mutex_destroy(&update_means_k_mutex);
+		total = 0.0;
+		for (i = 0; i < num_pool; i++)
+		{
+			double d = kmeans_distance2(KMEANS_POOL_OBJ(i), &(config->centers[c]));
+			if (d < d2[i]) d2[i] = d;
+			total += d2[i];
+		}
 	}
-}
+#undef KMEANS_POOL_OBJ
 
-#endif /* KMEANS_THREADED */
+	kmeans_free(d2);
+	if (pool) kmeans_free(pool);
+	return KMEANS_OK;
+}
 
 kmeans_result
 kmeans(kmeans_config *config)
 {
-	int iterations = 0;
-	int *clusters_last;
-	size_t clusters_sz = sizeof(int)*config->num_objs;
+	kmeans_state st;
+	uint64_t rstate = config->seed ^ UINT64_C(0x5DEECE66D);
+	double *moved;
+	unsigned int c;
+	size_t i;
+	kmeans_result result = KMEANS_ERROR;
 
 	assert(config);
 	assert(config->objs);
 	assert(config->num_objs);
-	assert(config->distance_method);
-	assert(config->centroid_method);
 	assert(config->centers);
 	assert(config->k);
 	assert(config->clusters);
 	assert(config->k <= config->num_objs);
 
-	/* Zero out cluster numbers, just in case user forgets */
-	memset(config->clusters, 0, clusters_sz);
-
 	/* Set default max iterations if necessary */
 	if (!config->max_iterations)
 		config->max_iterations = KMEANS_MAX_ITERATIONS;
+	config->total_iterations = 0;
+
+	st.objs = config->objs;
+	st.centers = config->centers;
+	st.k = config->k;
+	st.kdtree = config->k > KMEANS_KDTREE_THRESHOLD ? kmeans_malloc(sizeof(kmeans_kdnode) * config->k) : NULL;
+	st.clusters = config->clusters;
+	st.upper = kmeans_malloc(sizeof(double) * config->num_objs);
+	st.lower = kmeans_malloc(sizeof(double) * config->num_objs);
+	st.half = kmeans_malloc(sizeof(double) * config->k);
+	moved = kmeans_malloc(sizeof(double) * config->k);
+
+	if (config->batch_iterations && config->batch_size)
+		kmeans_minibatch(config, &st, &rstate);
 
-	/*
-	 * Previous cluster state array. At this time, r doesn't mean anything
-	 * but it's ok
-	 */
-	clusters_last = kmeans_malloc(clusters_sz);
+	/* First assignment searches every object */
+	kmeans_assign(&st, config->num_objs, LW_TRUE);
 
 	while (1)
 	{
-		LW_ON_INTERRUPT(kmeans_free(clusters_last); return KMEANS_ERROR);
+		double max_moved = 0.0, second_moved = 0.0;
+		unsigned int max_center = 0;
 
-		/* Store the previous state of the clustering */
-		memcpy(clusters_last, config->clusters, clusters_sz);
+		LW_ON_INTERRUPT(break);
 
-#ifdef KMEANS_THREADED
-		update_r_threaded(config);
-		update_means_threaded(config);
-#else
-		update_r(config);
-		update_means(config);
-#endif
-		/*
-		 * if all the cluster numbers are unchanged since last time,
-		 * we are at a stable solution, so we can stop here
-		 */
-		if (memcmp(clusters_last, config->clusters, clusters_sz) == 0)
+		if (config->total_iterations++ > config->max_iterations)
 		{
-			kmeans_free(clusters_last);
-			config->total_iterations = iterations;
-			return KMEANS_OK;
+			result = KMEANS_EXCEEDED_MAX_ITERATIONS;
+			break;
 		}
 
-		if (iterations++ > config->max_iterations)
+		update_means(config, moved);
+
+		/* Centers moved, so loosen the bounds by as much */
+		for (c = 0; c < config->k; c++)
+		{
+			if (moved[c] > max_moved)
+			{
+				second_moved = max_moved;
+				max_moved = moved[c];
+				max_center = c;
+			}
+			else if (moved[c] > second_moved)
+			{
+				second_moved = moved[c];
+			}
+		}
+		for (i = 0; i < config->num_objs; i++)
 		{
-			kmeans_free(clusters_last);
-			config->total_iterations = iterations;
-			return KMEANS_EXCEEDED_MAX_ITERATIONS;
+			c = config->clusters[i];
+			st.upper[i] += moved[c];
+			st.lower[i] -= (c == max_center ? second_moved : max_moved);
 		}
 
+		/*
+		 * if all the cluster numbers are unchanged since last time,
+		 * we are at a stable solution, so we can stop here
+		 */
+		if (kmeans_assign(&st, config->num_objs, LW_FALSE) == 0)
+		{
+			result = KMEANS_OK;
+			break;
+		}
 	}
 
-	kmeans_free(clusters_last);
-	config->total_iterations = iterations;
-	return KMEANS_ERROR;
+	if (st.kdtree) kmeans_free(st.kdtree);
+	kmeans_free(st.upper);
+	kmeans_free(st.lower);
+	kmeans_free(st.half);
+	kmeans_free(moved);
+	return result;
 }
-
-
@@ -1,7 +1,7 @@
 /*-------------------------------------------------------------------------
 *
 * kmeans.h
-*    Generic k-means implementation
+*    K-means implementation for 2d points
 *
 * Copyright (c) 2016, Paul Ramsey <pramsey@cleverelephant.ca>
 *
@@ -12,20 +12,25 @@
 #include "liblwgeom_internal.h"
 
 /*
-* Simple k-means implementation for arbitrary data structures
+* K-means on a flat array of 2d points.
 *
-* Since k-means partitions based on inter-object "distance" the same
-* machinery can be used to support any object type that can calculate a
-* "distance" between pairs.
+* Centers are seeded k-means++ style (each one drawn with probability
+* proportional to the squared distance to the nearest center so far)
+* from a fixed random sequence, so results are repeatable. Large inputs
+* can first move the centers with a few mini-batch passes on samples.
+* Lloyd iterations then run to convergence, skipping the points whose
+* bounds (Hamerly) show they cannot change cluster, and searching a
+* kd-tree of the centers for the others when k is large.
 *
 * To use the k-means infrastructure, just fill out the kmeans_config
-* structure and invoke the kmeans() function.
+* structure and invoke kmeans_seed() and then kmeans().
 */
 
 /*
-* Threaded calculation is available using pthreads, which practically
+* Threaded assignment is available using pthreads, which practically
 * means UNIX platforms only, unless you're building with a posix
-* compatible environment.
+* compatible environment. Worker threads only read the centers and
+* write their own share of the assignments, they never allocate.
 *
 * #define KMEANS_THREADED
 */
@@ -42,6 +47,12 @@
 */
 #define KMEANS_MAX_ITERATIONS 1000
 
+/*
+* Above this number of centers, the points that need a full search
+* look their nearest centers up in a kd-tree instead of scanning.
+*/
+#define KMEANS_KDTREE_THRESHOLD 24
+
 /*
 * The code doesn't try to figure out how many threads to use, so
 * best to set this to the number of cores you expect to have
@@ -56,55 +67,26 @@
 #define kmeans_malloc(size) lwalloc(size)
 #define kmeans_free(ptr) lwfree(ptr)
 
-typedef void * Pointer;
-
 typedef enum {
 	KMEANS_OK,
 	KMEANS_EXCEEDED_MAX_ITERATIONS,
 	KMEANS_ERROR
 } kmeans_result;
 
-/*
-* Prototype for the distance calculating function
-*/
-typedef double (*kmeans_distance_method) (const Pointer a, const Pointer b);
-
-/*
-* Prototype for the centroid calculating function
-* @param objs the list of all objects in the calculation
-* @param clusters the list of cluster numbers for each object
-* @param num_objs the number of objects/cluster numbers in the previous arrays
-* @param cluster the cluster number we are actually generating a centroid for here
-* @param centroid the object to write the centroid result into (already allocated)
-*/
-typedef void (*kmeans_centroid_method) (const Pointer * objs, const int * clusters, size_t num_objs, int cluster, Pointer centroid);
-
 typedef struct kmeans_config
 {
-	/* Function returns the "distance" between any pair of objects */
-	kmeans_distance_method distance_method;
-
-	/* Function returns the "centroid" of a collection of objects */
-	kmeans_centroid_method centroid_method;
-
-	/* An array of objects to be analyzed. User allocates this array */
-	/* and is responsible for freeing it. */
-	/* For objects that are not capable of participating in the distance */
-	/* calculations, but for which you still want included in the process */
-	/* (for examples, database nulls, or geometry empties) use a NULL */
-	/* value in this list. All NULL values will be returned in the */
-	/* KMEANS_NULL_CLUSTER. */
-	Pointer * objs;
+	/* An array of points to be analyzed. User allocates this array */
+	/* and is responsible for freeing it. Objects that cannot take */
+	/* part (database nulls, empties) are left out by the caller. */
+	const POINT2D * objs;
 
 	/* Number of objects in the preceding array */
 	size_t num_objs;
 
-	/* An array of inital centers for the algorithm */
-	/* Can be randomly assigned, or using proportions, */
-	/* unfortunately the algorithm is sensitive to starting */
-	/* points, so using a "better" set of starting points */
-	/* might be wise. User allocates and is responsible for freeing. */
-	Pointer * centers;
+	/* An array of k centers, filled in by kmeans_seed() or by the */
+	/* user, and moved to the cluster means by kmeans(). */
+	/* User allocates and is responsible for freeing. */
+	POINT2D * centers;
 
 	/* Number of means we are calculating, length of preceding array */
 	unsigned int k;
@@ -116,11 +98,21 @@ typedef struct kmeans_config
 	/* Iteration counter */
 	unsigned int total_iterations;
 
+	/* Mini-batch warm start: number of passes, and points sampled */
+	/* per pass. Zero passes to go straight to the full iterations. */
+	unsigned int batch_iterations;
+	unsigned int batch_size;
+
+	/* Seed of the random sequence used for seeding and sampling */
+	unsigned int seed;
+
 	/* Array to fill in with cluster numbers. User allocates and frees. */
 	int * clusters;
 
 } kmeans_config;
 
+/* Pick the k initial centers, k-means++ style */
+kmeans_result kmeans_seed(kmeans_config *config);
+
 /* This is where the magic happens. */
 kmeans_result kmeans(kmeans_config *config);
-
@@ -149,6 +149,7 @@
 #define OUT_SHOW_DIGS_DOUBLE 20
 #define OUT_MAX_DOUBLE_PRECISION 15
 #define OUT_MAX_DIGS_DOUBLE (OUT_SHOW_DIGS_DOUBLE + 2) /* +2 mean add dot and sign */
+#define OUT_DOUBLE_BUFFER_SIZE (OUT_MAX_DIGS_DOUBLE + OUT_MAX_DOUBLE_PRECISION + 1)
 
 
 /**
@@ -307,6 +308,19 @@ double lwcurvepoly_perimeter_2d(const LWCURVEPOLY *poly);
 double lwtriangle_perimeter(const LWTRIANGLE *triangle);
 double lwtriangle_perimeter_2d(const LWTRIANGLE *triangle);
 
+/*
+* Segment trees for repeated 2d minimum distance calculations.
+* The trees are keyed on the point arrays of the geometry they
+* were built from, so only that very geometry benefits from them,
+* and it has to outlive the trees.
+*/
+typedef struct LWDISTTREE_T LWDISTTREE;
+LWDISTTREE* lwgeom_distance_tree_new(LWGEOM *geom);
+void lwgeom_distance_tree_free(LWDISTTREE *dtree);
+double lwgeom_mindistance2d_tolerance_tree(const LWGEOM *lw1, const LWGEOM *lw2, double tolerance, const LWDISTTREE *dtree);
+LWGEOM* lwgeom_closest_line_tree(const LWGEOM *lw1, const LWGEOM *lw2, const LWDISTTREE *dtree);
+LWGEOM* lwgeom_closest_point_tree(const LWGEOM *lw1, const LWGEOM *lw2, const LWDISTTREE *dtree);
+
 /*
 * Segmentization
 */
@@ -329,6 +343,7 @@ void ptarray_scale(POINTARRAY *pa, const POINT4D *factor);
 int ptarray_has_z(const POINTARRAY *pa);
 int ptarray_has_m(const POINTARRAY *pa);
 double ptarray_signed_area(const POINTARRAY *pa);
+void ptarray_reserve(POINTARRAY *pa, uint32_t npoints);
 
 /*
 * Clone support
@@ -458,6 +473,19 @@ int gbox_centroid(const GBOX* gbox, POINT2D* out);
 /* Utilities */
 extern void trim_trailing_zeros(char *num);
 
+/**
+* Print a double with at most maxdd decimals, in the shortest form that
+* reads back to the same double. Values of OUT_MAX_DOUBLE and over are
+* printed with %g. Returns the printed length, like snprintf.
+*/
+extern int lwprint_double(double d, int maxdd, char *buf, size_t bufsize);
+
+/**
+* Print a double with at most maxsd significant digits, like %.*g but in
+* the shortest form that reads back to the same double.
+*/
+extern int lwprint_double_sig(double d, int maxsd, char *buf, size_t bufsize);
+
 extern uint8_t MULTITYPE[NUMTYPES];
 
 extern THR_LOCAL lwinterrupt_callback *_lwgeom_interrupt_callback;
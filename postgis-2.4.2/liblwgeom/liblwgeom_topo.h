@@ -93,6 +93,11 @@ LWT_ISO_FACE;
 #define LWT_COL_FACE_MBR             1<<1
 #define LWT_COL_FACE_ALL            (1<<2)-1
 
+/** Primitive types, numbered as in TopoElement */
+#define LWT_ELEM_NODE 1
+#define LWT_ELEM_EDGE 2
+#define LWT_ELEM_FACE 3
+
 typedef enum LWT_SPATIALTYPE_T {
   LWT_PUNTAL = 0,
   LWT_LINEAL = 1,
@@ -864,6 +869,30 @@ typedef struct LWT_BE_CALLBACKS_T {
       int* numelems, int fields, int limit
   );
 
+  /**
+   * Reserve identifiers for primitives to be inserted later
+   *
+   * Identifiers returned by this function should not be considered
+   * available anymore.
+   *
+   * @param topo the topology to act upon
+   * @param elemtype type of the primitives, see LWT_ELEM_* macros
+   * @param ids output array receiving the reserved identifiers,
+   *            in the order automatic assignment would have used
+   * @param numelems number of identifiers to reserve
+   *
+   * @return 1 on success, 0 on error (@see lastErrorMessage)
+   *
+   * @note only needed by bulk loading (@see lwt_BeginBulkLoad),
+   *       backends not supporting it can leave this NULL.
+   */
+  int (*reserveElementIds) (
+      const LWT_BE_TOPOLOGY* topo,
+      int elemtype,
+      LWT_ELEMID* ids,
+      int numelems
+  );
+
 } LWT_BE_CALLBACKS;
 
 
@@ -975,6 +1004,45 @@ void lwt_DropTopology(LWT_TOPOLOGY* topo);
  */
 void lwt_FreeTopology(LWT_TOPOLOGY* topo);
 
+/**
+ * Start a bulk load session on a topology
+ *
+ * The whole topology is read into memory and a new handler is
+ * returned, to be passed to lwt_AddPoint, lwt_AddLine, lwt_AddPolygon
+ * or any other editing function. Those run against the in-memory copy,
+ * so that no backend round-trip is needed for snapping, noding and
+ * face splitting. The resulting primitives are the ones direct
+ * editing would produce, but their identifiers may differ: they are
+ * reserved from the backend in blocks, so some values can be skipped.
+ *
+ * Edits are only written to the backend by lwt_EndBulkLoad, along
+ * with the TopoGeometry updates of the splits they involved, except
+ * when an edit needs to read or heal TopoGeometry objects, which
+ * writes everything done so far first.
+ * Releasing the handler with lwt_FreeTopology discards the edits
+ * not written yet.
+ *
+ * @param topo the topology to load into, which must not be edited
+ *             otherwise until the session is over
+ *
+ * @return the in-memory topology handler, or NULL on error
+ *         (liblwgeom error handler will be invoked with error message)
+ */
+LWT_TOPOLOGY *lwt_BeginBulkLoad(LWT_TOPOLOGY *topo);
+
+/**
+ * Write the edits of a bulk load session to the backend
+ *
+ * Primitives are written with batched inserts, updates and deletes.
+ * The handler is released in any case.
+ *
+ * @param bulk the handler returned by lwt_BeginBulkLoad
+ *
+ * @return 0 on success, -1 on error
+ *         (liblwgeom error handler will be invoked with error message)
+ */
+int lwt_EndBulkLoad(LWT_TOPOLOGY *bulk);
+
 /**
  * Retrieve the id of a node at a point location
  *
@@ -2085,6 +2085,122 @@ double lwgeom_azumith_spheroid(const LWPOINT *r, const LWPOINT *s, const SPHEROI
 	return spheroid_direction(&g1, &g2, spheroid);
 }
 
+/**
+* Unpack the non-empty points of a POINT or MULTIPOINT into a newly
+* allocated array of geographic points.
+*/
+static GEOGRAPHIC_POINT* lwgeom_geographic_points(const LWGEOM *lwgeom, int *npoints)
+{
+	const LWGEOM * const *geoms = &lwgeom;
+	int ngeoms = 1;
+	GEOGRAPHIC_POINT *g;
+	const POINT2D *p;
+	int i;
+
+	if ( lwgeom->type == MULTIPOINTTYPE )
+	{
+		geoms = (const LWGEOM * const *)((const LWCOLLECTION*)lwgeom)->geoms;
+		ngeoms = ((const LWCOLLECTION*)lwgeom)->ngeoms;
+	}
+
+	g = lwalloc(FP_MAX(ngeoms, 1) * sizeof(GEOGRAPHIC_POINT));
+	*npoints = 0;
+	for ( i = 0; i < ngeoms; i++ )
+	{
+		if ( lwgeom_is_empty(geoms[i]) )
+			continue;
+		p = getPoint2d_cp(((const LWPOINT*)geoms[i])->point, 0);
+		geographic_point_init(p->x, p->y, &(g[(*npoints)++]));
+	}
+	return g;
+}
+
+#define POINTS_DISTANCE_BATCH 256
+
+/**
+* Minimum distance between two point sets. The sphere distance of every
+* pair is cheap, and the ratio of spheroidal to spherical length of any
+* path lies between the smallest and largest radii of curvature over the
+* mean radius, so only the pairs that could still be the nearest after
+* that distortion are sent, in batches, to the spheroid kernel.
+*/
+static double lwgeom_points_distance_spheroid(const LWGEOM *lwgeom1, const LWGEOM *lwgeom2, const SPHEROID *s, double tolerance)
+{
+	GEOGRAPHIC_POINT *g1, *g2;
+	GEOGRAPHIC_POINT ca[POINTS_DISTANCE_BATCH], cb[POINTS_DISTANCE_BATCH];
+	double cd[POINTS_DISTANCE_BATCH];
+	double min_sphere = FLT_MAX;
+	double distance = FLT_MAX;
+	double scale_min, scale_max, cutoff;
+	int n1, n2, nc = 0;
+	int i, j, k;
+
+	g1 = lwgeom_geographic_points(lwgeom1, &n1);
+	g2 = lwgeom_geographic_points(lwgeom2, &n2);
+
+	for ( i = 0; i < n1; i++ )
+	{
+		for ( j = 0; j < n2; j++ )
+		{
+			double d = sphere_distance(&(g1[i]), &(g2[j]));
+			if ( d < min_sphere )
+				min_sphere = d;
+		}
+	}
+
+	/* Sphere special case, or below tolerance where the exact answer isn't of interest */
+	if ( s->a == s->b || s->radius * min_sphere < 0.95 * tolerance )
+	{
+		lwfree(g1);
+		lwfree(g2);
+		return s->radius * min_sphere;
+	}
+
+	/* Meridian radius at the equator and polar radius of curvature */
+	scale_min = s->a * (1.0 - s->e_sq) / s->radius;
+	scale_max = s->a / sqrt(1.0 - s->e_sq) / s->radius;
+	cutoff = min_sphere * scale_max / scale_min * (1.0 + FP_TOLERANCE);
+
+	for ( i = 0; i < n1; i++ )
+	{
+		for ( j = 0; j < n2; j++ )
+		{
+			if ( sphere_distance(&(g1[i]), &(g2[j])) > cutoff )
+				continue;
+
+			ca[nc] = g1[i];
+			cb[nc] = g2[j];
+			nc++;
+
+			if ( nc == POINTS_DISTANCE_BATCH )
+			{
+				spheroid_distance_batch(ca, cb, nc, s, cd);
+				for ( k = 0; k < nc; k++ )
+				{
+					if ( cd[k] < distance )
+						distance = cd[k];
+				}
+				nc = 0;
+			}
+		}
+	}
+
+	/* Flush the last partial batch */
+	if ( nc )
+	{
+		spheroid_distance_batch(ca, cb, nc, s, cd);
+		for ( k = 0; k < nc; k++ )
+		{
+			if ( cd[k] < distance )
+				distance = cd[k];
+		}
+	}
+
+	lwfree(g1);
+	lwfree(g2);
+	return distance;
+}
+
 /**
 * Calculate the distance between two LWGEOMs, using the coordinates are
 * longitude and latitude. Return immediately when the calulated distance drops
@@ -2270,6 +2386,13 @@ double lwgeom_distance_spheroid(const LWGEOM *lwgeom1, const LWGEOM *lwgeom2, co
 		return distance;
 	}
 
+	/* Point set combinations are handled in one batch rather than pair by pair */
+	if ( ( type1 == POINTTYPE || type1 == MULTIPOINTTYPE ) &&
+	     ( type2 == POINTTYPE || type2 == MULTIPOINTTYPE ) )
+	{
+		return lwgeom_points_distance_spheroid(lwgeom1, lwgeom2, spheroid, tolerance);
+	}
+
 	/* Recurse into collections */
 	if ( lwtype_is_collection(type1) )
 	{
@@ -3135,15 +3258,21 @@ int lwgeom_force_geodetic(LWGEOM *geom)
 }
 
 
+/**
+* Length of a point array on the spheroid. All the vertices are converted
+* up front and the segment lengths computed in one batch, so the spheroid
+* set-up and per-vertex trigonometry are not repeated for every segment.
+*/
 double ptarray_length_spheroid(const POINTARRAY *pa, const SPHEROID *s)
 {
-	GEOGRAPHIC_POINT a, b;
+	GEOGRAPHIC_POINT *g;
+	double *seglengths;
+	const POINT2D *p;
+	POINT3DZ pz;
 	double za = 0.0, zb = 0.0;
-	POINT4D p;
-	int i;
+	int i, n;
 	int hasz = LW_FALSE;
 	double length = 0.0;
-	double seglength = 0.0;
 
 	/* Return zero on non-sensical inputs */
 	if ( ! pa || pa->npoints < 2 )
@@ -3152,39 +3281,53 @@ double ptarray_length_spheroid(const POINTARRAY *pa, const SPHEROID *s)
 	/* See if we have a third dimension */
 	hasz = FLAGS_GET_Z(pa->flags);
 
-	/* Initialize first point */
-	getPoint4d_p(pa, 0, &p);
-	geographic_point_init(p.x, p.y, &a);
-	if ( hasz )
-		za = p.z;
+	n = pa->npoints;
+	g = lwalloc(n * sizeof(GEOGRAPHIC_POINT));
+	seglengths = lwalloc((n - 1) * sizeof(double));
 
-	/* Loop and sum the length for each segment */
-	for ( i = 1; i < pa->npoints; i++ )
+	for ( i = 0; i < n; i++ )
 	{
-		seglength = 0.0;
-		getPoint4d_p(pa, i, &p);
-		geographic_point_init(p.x, p.y, &b);
-		if ( hasz )
-			zb = p.z;
+		p = getPoint2d_cp(pa, i);
+		geographic_point_init(p->x, p->y, &(g[i]));
+	}
 
-		/* Special sphere case */
-		if ( s->a == s->b )
-			seglength = s->radius * sphere_distance(&a, &b);
-		/* Spheroid case */
-		else
-			seglength = spheroid_distance(&a, &b, s);
+	/* Special sphere case */
+	if ( s->a == s->b )
+	{
+		for ( i = 0; i < n - 1; i++ )
+			seglengths[i] = s->radius * sphere_distance(&(g[i]), &(g[i+1]));
+	}
+	/* Spheroid case, segment i runs from g[i] to g[i+1] */
+	else
+	{
+		spheroid_distance_batch(g, g + 1, n - 1, s, seglengths);
+	}
+
+	if ( hasz )
+	{
+		getPoint3dz_p(pa, 0, &pz);
+		za = pz.z;
+	}
+
+	/* Sum the segment lengths */
+	for ( i = 0; i < n - 1; i++ )
+	{
+		double seglength = seglengths[i];
 
 		/* Add in the vertical displacement if we're in 3D */
 		if ( hasz )
+		{
+			getPoint3dz_p(pa, i + 1, &pz);
+			zb = pz.z;
 			seglength = sqrt( (zb-za)*(zb-za) + seglength*seglength );
+			za = zb;
+		}
 
-		/* Add this segment length to the total */
 		length += seglength;
-
-		/* B gets incremented in the next loop, so we save the value here */
-		a = b;
-		za = zb;
 	}
+
+	lwfree(seglengths);
+	lwfree(g);
 	return length;
 }
 
@@ -143,6 +143,7 @@ void ll2cart(const POINT2D *g, POINT3D *p);
 ** Prototypes for spheroid functions.
 */
 double spheroid_distance(const GEOGRAPHIC_POINT *a, const GEOGRAPHIC_POINT *b, const SPHEROID *spheroid);
+void spheroid_distance_batch(const GEOGRAPHIC_POINT *a, const GEOGRAPHIC_POINT *b, int n, const SPHEROID *spheroid, double *distances);
 double spheroid_direction(const GEOGRAPHIC_POINT *r, const GEOGRAPHIC_POINT *s, const SPHEROID *spheroid);
 int spheroid_project(const GEOGRAPHIC_POINT *r, const SPHEROID *spheroid, double distance, double azimuth, GEOGRAPHIC_POINT *g);
 
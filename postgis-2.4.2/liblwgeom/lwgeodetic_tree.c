@@ -59,6 +59,70 @@ circ_tree_free(CIRC_NODE* node)
 	lwfree(node);
 }
 
+static int
+circ_tree_count_nodes(const CIRC_NODE* node)
+{
+	int i, n = 1;
+	for ( i = 0; i < node->num_nodes; i++ )
+		n += circ_tree_count_nodes(node->nodes[i]);
+	return n;
+}
+
+/**
+* Copy a tree into a CIRC_TREE, laying the nodes out breadth first
+* so that siblings are adjacent. Point references are shared with
+* the input tree, which can be freed afterwards.
+*/
+CIRC_TREE*
+circ_tree_flatten(const CIRC_NODE* node)
+{
+	CIRC_TREE* tree;
+	const CIRC_NODE** queue;
+	int head, tail, i;
+
+	if ( ! node ) return NULL;
+
+	tree = lwalloc(sizeof(CIRC_TREE));
+	tree->num_nodes = circ_tree_count_nodes(node);
+	tree->nodes = lwalloc(sizeof(CIRC_NODE) * tree->num_nodes);
+	/* Every node but the root is somebody's child */
+	tree->children = tree->num_nodes > 1 ? lwalloc(sizeof(CIRC_NODE*) * (tree->num_nodes - 1)) : NULL;
+	queue = lwalloc(sizeof(CIRC_NODE*) * tree->num_nodes);
+
+	queue[0] = node;
+	head = 0;
+	tail = 1;
+	while ( head < tail )
+	{
+		const CIRC_NODE* src = queue[head];
+		CIRC_NODE* dst = &(tree->nodes[head]);
+		*dst = *src;
+		if ( src->num_nodes )
+		{
+			/* Children take the next free slots, in both blocks */
+			dst->nodes = tree->children + (tail - 1);
+			for ( i = 0; i < src->num_nodes; i++ )
+			{
+				dst->nodes[i] = &(tree->nodes[tail]);
+				queue[tail++] = src->nodes[i];
+			}
+		}
+		head++;
+	}
+
+	lwfree(queue);
+	return tree;
+}
+
+void
+circ_tree_flat_free(CIRC_TREE* tree)
+{
+	if ( ! tree ) return;
+	if ( tree->children ) lwfree(tree->children);
+	lwfree(tree->nodes);
+	lwfree(tree);
+}
+
 
 /**
 * Create a new leaf node, storing pointers back to the end points for later.
@@ -599,188 +663,258 @@ circ_tree_distance_tree(const CIRC_NODE* n1, const CIRC_NODE* n2, const SPHEROID
 	}
 }
 
+/**
+* Distance between two leaf nodes (edges or points), returning the
+* closest points on each.
+*/
 static double
-circ_tree_distance_tree_internal(const CIRC_NODE* n1, const CIRC_NODE* n2, double threshold, double* min_dist, double* max_dist, GEOGRAPHIC_POINT* closest1, GEOGRAPHIC_POINT* closest2)
+circ_leaf_distance(const CIRC_NODE* n1, const CIRC_NODE* n2, GEOGRAPHIC_POINT* close1, GEOGRAPHIC_POINT* close2)
 {
-	double max;
-	double d, d_min;
-	int i;
+	double d;
+	LWDEBUGF(4, "testing leaf pair [%d], [%d]", n1->edge_num, n2->edge_num);
+	/* One of the nodes is a point */
+	if ( n1->p1 == n1->p2 || n2->p1 == n2->p2 )
+	{
+		GEOGRAPHIC_EDGE e;
+		GEOGRAPHIC_POINT gp1, gp2;
+
+		/* Both nodes are points! */
+		if ( n1->p1 == n1->p2 && n2->p1 == n2->p2 )
+		{
+			geographic_point_init(n1->p1->x, n1->p1->y, &gp1);
+			geographic_point_init(n2->p1->x, n2->p1->y, &gp2);
+			*close1 = gp1; *close2 = gp2;
+			d = sphere_distance(&gp1, &gp2);
+		}
+		/* Node 1 is a point */
+		else if ( n1->p1 == n1->p2 )
+		{
+			geographic_point_init(n1->p1->x, n1->p1->y, &gp1);
+			geographic_point_init(n2->p1->x, n2->p1->y, &(e.start));
+			geographic_point_init(n2->p2->x, n2->p2->y, &(e.end));
+			*close1 = gp1;
+			d = edge_distance_to_point(&e, &gp1, close2);
+		}
+		/* Node 2 is a point */
+		else
+		{
+			geographic_point_init(n2->p1->x, n2->p1->y, &gp1);
+			geographic_point_init(n1->p1->x, n1->p1->y, &(e.start));
+			geographic_point_init(n1->p2->x, n1->p2->y, &(e.end));
+			*close1 = gp1;
+			d = edge_distance_to_point(&e, &gp1, close2);
+		}
+		LWDEBUGF(4, "  got distance %g", d);
+	}
+	/* Both nodes are edges */
+	else
+	{
+		GEOGRAPHIC_EDGE e1, e2;
+		GEOGRAPHIC_POINT g;
+		POINT3D A1, A2, B1, B2;
+		geographic_point_init(n1->p1->x, n1->p1->y, &(e1.start));
+		geographic_point_init(n1->p2->x, n1->p2->y, &(e1.end));
+		geographic_point_init(n2->p1->x, n2->p1->y, &(e2.start));
+		geographic_point_init(n2->p2->x, n2->p2->y, &(e2.end));
+		geog2cart(&(e1.start), &A1);
+		geog2cart(&(e1.end), &A2);
+		geog2cart(&(e2.start), &B1);
+		geog2cart(&(e2.end), &B2);
+		if ( edge_intersects(&A1, &A2, &B1, &B2) )
+		{
+			d = 0.0;
+			edge_intersection(&e1, &e2, &g);
+			*close1 = *close2 = g;
+		}
+		else
+		{
+			d = edge_distance_to_edge(&e1, &e2, close1, close2);
+		}
+		LWDEBUGF(4, "edge_distance_to_edge returned %g", d);
+	}
+	return d;
+}
 
-	LWDEBUGF(4, "entered, min_dist=%.8g max_dist=%.8g, type1=%d, type2=%d", *min_dist, *max_dist, n1->geom_type, n2->geom_type);
-/*
-	circ_tree_print(n1, 0);
-	circ_tree_print(n2, 0);
+/**
+* A pair of nodes waiting to be examined, keyed on the lower
+* bound of the distance between them.
 */
+typedef struct
+{
+	const CIRC_NODE* n1;
+	const CIRC_NODE* n2;
+	double d;
+} CIRC_NODE_PAIR;
+
+typedef struct
+{
+	CIRC_NODE_PAIR* pairs;
+	int num_pairs;
+	int max_pairs;
+} CIRC_PAIR_HEAP;
 
-	/* Short circuit if we've already hit the minimum */
-	if( *min_dist < threshold || *min_dist == 0.0 )
-		return *min_dist;
+static void
+circ_pair_heap_push(CIRC_PAIR_HEAP* heap, const CIRC_NODE* n1, const CIRC_NODE* n2, double d)
+{
+	int i, parent;
 
-	/* If your minimum is greater than anyone's maximum, you can't hold the winner */
-	if( circ_node_min_distance(n1, n2) > *max_dist )
+	if ( heap->num_pairs == heap->max_pairs )
 	{
-		LWDEBUGF(4, "pruning pair %p, %p", n1, n2);
-		return FLT_MAX;
+		heap->max_pairs *= 2;
+		heap->pairs = lwrealloc(heap->pairs, sizeof(CIRC_NODE_PAIR) * heap->max_pairs);
 	}
 
-	/* If your maximum is a new low, we'll use that as our new global tolerance */
-	max = circ_node_max_distance(n1, n2);
-	LWDEBUGF(5, "max %.8g", max);
-	if( max < *max_dist )
-		*max_dist = max;
+	/* Sift the new pair up from the bottom */
+	i = heap->num_pairs++;
+	while ( i > 0 )
+	{
+		parent = (i - 1) / 2;
+		if ( heap->pairs[parent].d <= d )
+			break;
+		heap->pairs[i] = heap->pairs[parent];
+		i = parent;
+	}
+	heap->pairs[i].n1 = n1;
+	heap->pairs[i].n2 = n2;
+	heap->pairs[i].d = d;
+}
+
+static CIRC_NODE_PAIR
+circ_pair_heap_pop(CIRC_PAIR_HEAP* heap)
+{
+	CIRC_NODE_PAIR top = heap->pairs[0];
+	CIRC_NODE_PAIR last = heap->pairs[--heap->num_pairs];
+	int i = 0, child;
 
-	/* Polygon on one side, primitive type on the other. Check for point-in-polygon */
-	/* short circuit. */
-	if ( n1->geom_type == POLYGONTYPE && n2->geom_type && ! lwtype_is_collection(n2->geom_type) )
+	/* Sift the last pair down from the top */
+	while ( (child = 2 * i + 1) < heap->num_pairs )
 	{
-		POINT2D pt;
-		circ_tree_get_point(n2, &pt);
-		LWDEBUGF(4, "n1 is polygon, testing if contains (%.5g,%.5g)", pt.x, pt.y);
-		if ( circ_tree_contains_point(n1, &pt, &(n1->pt_outside), NULL) )
-		{
-			LWDEBUG(4, "it does");
-			*min_dist = 0.0;
-			geographic_point_init(pt.x, pt.y, closest1);
-			geographic_point_init(pt.x, pt.y, closest2);
-			return *min_dist;
-		}
+		if ( child + 1 < heap->num_pairs && heap->pairs[child+1].d < heap->pairs[child].d )
+			child++;
+		if ( last.d <= heap->pairs[child].d )
+			break;
+		heap->pairs[i] = heap->pairs[child];
+		i = child;
 	}
-	/* Polygon on one side, primitive type on the other. Check for point-in-polygon */
-	/* short circuit. */
-	if ( n2->geom_type == POLYGONTYPE && n1->geom_type && ! lwtype_is_collection(n1->geom_type) )
+	if ( heap->num_pairs )
+		heap->pairs[i] = last;
+
+	return top;
+}
+
+/**
+* Polygon on one side, primitive type on the other. If the polygon
+* contains a vertex of the primitive the distance is zero.
+*/
+static int
+circ_node_pair_pip(const CIRC_NODE* poly, const CIRC_NODE* other, GEOGRAPHIC_POINT* closest1, GEOGRAPHIC_POINT* closest2)
+{
+	POINT2D pt;
+
+	if ( ! ( poly->geom_type == POLYGONTYPE && other->geom_type && ! lwtype_is_collection(other->geom_type) ) )
+		return LW_FALSE;
+
+	circ_tree_get_point(other, &pt);
+	LWDEBUGF(4, "polygon node, testing if contains (%.5g,%.5g)", pt.x, pt.y);
+	if ( circ_tree_contains_point(poly, &pt, &(poly->pt_outside), NULL) )
 	{
-		POINT2D pt;
-		circ_tree_get_point(n1, &pt);
-		LWDEBUGF(4, "n2 is polygon, testing if contains (%.5g,%.5g)", pt.x, pt.y);
-		if ( circ_tree_contains_point(n2, &pt, &(n2->pt_outside), NULL) )
-		{
-			LWDEBUG(4, "it does");
-			geographic_point_init(pt.x, pt.y, closest1);
-			geographic_point_init(pt.x, pt.y, closest2);
-			*min_dist = 0.0;
-			return *min_dist;
-		}
+		LWDEBUG(4, "it does");
+		geographic_point_init(pt.x, pt.y, closest1);
+		geographic_point_init(pt.x, pt.y, closest2);
+		return LW_TRUE;
 	}
+	return LW_FALSE;
+}
 
-	/* Both leaf nodes, do a real distance calculation */
-	if( circ_node_is_leaf(n1) && circ_node_is_leaf(n2) )
+/**
+* Best-first search over pairs of nodes. Pairs come off a min-heap
+* in order of the lower bound of their distance, so the search ends
+* as soon as the nearest remaining pair cannot beat the best leaf
+* distance found so far, and each node pair is visited at most once.
+*/
+static double
+circ_tree_distance_tree_internal(const CIRC_NODE* n1, const CIRC_NODE* n2, double threshold, double* min_dist, double* max_dist, GEOGRAPHIC_POINT* closest1, GEOGRAPHIC_POINT* closest2)
+{
+	CIRC_PAIR_HEAP heap;
+	CIRC_NODE_PAIR pair;
+	double d, max;
+	int i;
+
+	heap.max_pairs = 64;
+	heap.num_pairs = 0;
+	heap.pairs = lwalloc(sizeof(CIRC_NODE_PAIR) * heap.max_pairs);
+	circ_pair_heap_push(&heap, n1, n2, circ_node_min_distance(n1, n2));
+
+	while ( heap.num_pairs )
 	{
-		double d;
-		GEOGRAPHIC_POINT close1, close2;
-		LWDEBUGF(4, "testing leaf pair [%d], [%d]", n1->edge_num, n2->edge_num);
-		/* One of the nodes is a point */
-		if ( n1->p1 == n1->p2 || n2->p1 == n2->p2 )
-		{
-			GEOGRAPHIC_EDGE e;
-			GEOGRAPHIC_POINT gp1, gp2;
+		/* Short circuit if we've already hit the minimum */
+		if ( *min_dist < threshold || *min_dist == 0.0 )
+			break;
 
-			/* Both nodes are points! */
-			if ( n1->p1 == n1->p2 && n2->p1 == n2->p2 )
-			{
-				geographic_point_init(n1->p1->x, n1->p1->y, &gp1);
-				geographic_point_init(n2->p1->x, n2->p1->y, &gp2);
-				close1 = gp1; close2 = gp2;
-				d = sphere_distance(&gp1, &gp2);
-			}
-			/* Node 1 is a point */
-			else if ( n1->p1 == n1->p2 )
-			{
-				geographic_point_init(n1->p1->x, n1->p1->y, &gp1);
-				geographic_point_init(n2->p1->x, n2->p1->y, &(e.start));
-				geographic_point_init(n2->p2->x, n2->p2->y, &(e.end));
-				close1 = gp1;
-				d = edge_distance_to_point(&e, &gp1, &close2);
-			}
-			/* Node 2 is a point */
-			else
-			{
-				geographic_point_init(n2->p1->x, n2->p1->y, &gp1);
-				geographic_point_init(n1->p1->x, n1->p1->y, &(e.start));
-				geographic_point_init(n1->p2->x, n1->p2->y, &(e.end));
-				close1 = gp1;
-				d = edge_distance_to_point(&e, &gp1, &close2);
-			}
-			LWDEBUGF(4, "  got distance %g", d);
+		pair = circ_pair_heap_pop(&heap);
+		n1 = pair.n1;
+		n2 = pair.n2;
+
+		LWDEBUGF(4, "popped pair %p, %p at %.8g, min_dist=%.8g max_dist=%.8g", n1, n2, pair.d, *min_dist, *max_dist);
+
+		/* Nothing left on the heap can hold the winner */
+		if ( pair.d >= *min_dist || pair.d > *max_dist )
+			break;
+
+		/* If your maximum is a new low, we'll use that as our new global tolerance */
+		max = circ_node_max_distance(n1, n2);
+		if ( max < *max_dist )
+			*max_dist = max;
+
+		if ( circ_node_pair_pip(n1, n2, closest1, closest2) ||
+		     circ_node_pair_pip(n2, n1, closest1, closest2) )
+		{
+			*min_dist = 0.0;
+			break;
 		}
-		/* Both nodes are edges */
-		else
+
+		/* Both leaf nodes, do a real distance calculation */
+		if ( circ_node_is_leaf(n1) && circ_node_is_leaf(n2) )
 		{
-			GEOGRAPHIC_EDGE e1, e2;
-			GEOGRAPHIC_POINT g;
-			POINT3D A1, A2, B1, B2;
-			geographic_point_init(n1->p1->x, n1->p1->y, &(e1.start));
-			geographic_point_init(n1->p2->x, n1->p2->y, &(e1.end));
-			geographic_point_init(n2->p1->x, n2->p1->y, &(e2.start));
-			geographic_point_init(n2->p2->x, n2->p2->y, &(e2.end));
-			geog2cart(&(e1.start), &A1);
-			geog2cart(&(e1.end), &A2);
-			geog2cart(&(e2.start), &B1);
-			geog2cart(&(e2.end), &B2);
-			if ( edge_intersects(&A1, &A2, &B1, &B2) )
-			{
-				d = 0.0;
-				edge_intersection(&e1, &e2, &g);
-				close1 = close2 = g;
-			}
-			else
+			GEOGRAPHIC_POINT close1, close2;
+			d = circ_leaf_distance(n1, n2, &close1, &close2);
+			if ( d < *min_dist )
 			{
-				d = edge_distance_to_edge(&e1, &e2, &close1, &close2);
+				*min_dist = d;
+				*closest1 = close1;
+				*closest2 = close2;
 			}
-			LWDEBUGF(4, "edge_distance_to_edge returned %g", d);
+			continue;
 		}
-		if ( d < *min_dist )
-		{
-			*min_dist = d;
-			*closest1 = close1;
-			*closest2 = close2;
-		}
-		return d;
-	}
-	else
-	{
-		d_min = FLT_MAX;
-		/* Drive the recursion into the COLLECTION types first so we end up with */
+
+		/* Drive the search into the COLLECTION types first so we end up with */
 		/* pairings of primitive geometries that can be forced into the point-in-polygon */
 		/* tests above. */
-		if ( n1->geom_type && lwtype_is_collection(n1->geom_type) )
-		{
-			for ( i = 0; i < n1->num_nodes; i++ )
-			{
-				d = circ_tree_distance_tree_internal(n1->nodes[i], n2, threshold, min_dist, max_dist, closest1, closest2);
-				d_min = FP_MIN(d_min, d);
-			}
-		}
-		else if ( n2->geom_type && lwtype_is_collection(n2->geom_type) )
-		{
-			for ( i = 0; i < n2->num_nodes; i++ )
-			{
-				d = circ_tree_distance_tree_internal(n1, n2->nodes[i], threshold, min_dist, max_dist, closest1, closest2);
-				d_min = FP_MIN(d_min, d);
-			}
-		}
-		else if ( ! circ_node_is_leaf(n1) )
+		if ( circ_node_is_leaf(n2) ||
+		     ( ! circ_node_is_leaf(n1) &&
+		       ( ( n1->geom_type && lwtype_is_collection(n1->geom_type) ) ||
+		         ! ( n2->geom_type && lwtype_is_collection(n2->geom_type) ) ) ) )
 		{
 			for ( i = 0; i < n1->num_nodes; i++ )
 			{
-				d = circ_tree_distance_tree_internal(n1->nodes[i], n2, threshold, min_dist, max_dist, closest1, closest2);
-				d_min = FP_MIN(d_min, d);
+				d = circ_node_min_distance(n1->nodes[i], n2);
+				if ( d <= *max_dist )
+					circ_pair_heap_push(&heap, n1->nodes[i], n2, d);
 			}
 		}
-		else if ( ! circ_node_is_leaf(n2) )
+		else
 		{
 			for ( i = 0; i < n2->num_nodes; i++ )
 			{
-				d = circ_tree_distance_tree_internal(n1, n2->nodes[i], threshold, min_dist, max_dist, closest1, closest2);
-				d_min = FP_MIN(d_min, d);
+				d = circ_node_min_distance(n1, n2->nodes[i]);
+				if ( d <= *max_dist )
+					circ_pair_heap_push(&heap, n1, n2->nodes[i], d);
 			}
 		}
-		else
-		{
-			/* Never get here */
-		}
-
-		return d_min;
 	}
+
+	lwfree(heap.pairs);
+	return *min_dist;
 }
 
 
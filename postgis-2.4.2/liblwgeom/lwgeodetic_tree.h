@@ -46,6 +46,19 @@ typedef struct circ_node
 	POINT2D* p2;
 } CIRC_NODE;
 
+/**
+* A circ tree packed into two contiguous blocks, root first, so that
+* callers caching a tree can walk it with good locality and free it
+* in one go. The nodes are ordinary CIRC_NODEs, so every CIRC_NODE
+* function works on the root, (tree->nodes).
+*/
+typedef struct circ_tree
+{
+	CIRC_NODE* nodes;
+	CIRC_NODE** children;
+	int num_nodes;
+} CIRC_TREE;
+
 void circ_tree_print(const CIRC_NODE* node, int depth);
 CIRC_NODE* circ_tree_new(const POINTARRAY* pa);
 void circ_tree_free(CIRC_NODE* node);
@@ -53,6 +66,8 @@ int circ_tree_contains_point(const CIRC_NODE* node, const POINT2D* pt, const POI
 double circ_tree_distance_tree(const CIRC_NODE* n1, const CIRC_NODE* n2, const SPHEROID *spheroid, double threshold);
 CIRC_NODE* lwgeom_calculate_circ_tree(const LWGEOM* lwgeom);
 int circ_tree_get_point(const CIRC_NODE* node, POINT2D* pt);
+CIRC_TREE* circ_tree_flatten(const CIRC_NODE* node);
+void circ_tree_flat_free(CIRC_TREE* tree);
 
 #endif /* _LWGEODETIC_TREE_H */
 
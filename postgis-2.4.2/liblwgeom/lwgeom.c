@@ -1935,147 +1935,6 @@ lwgeom_grid(const LWGEOM *lwgeom, const gridspec *grid)
 }
 
 
-/* Prototype for recursion */
-static int
-lwgeom_subdivide_recursive(const LWGEOM *geom, int maxvertices, int depth, LWCOLLECTION *col, const GBOX *clip);
-
-static int
-lwgeom_subdivide_recursive(const LWGEOM *geom, int maxvertices, int depth, LWCOLLECTION *col, const GBOX *clip)
-{
-	const int maxdepth = 50;
-	int nvertices = 0;
-	int i, n = 0;
-	double width = clip->xmax - clip->xmin;
-	double height = clip->ymax - clip->ymin;
-	GBOX subbox1, subbox2;
-	LWGEOM *clipped1, *clipped2;
-
-	if ( geom->type == POLYHEDRALSURFACETYPE || geom->type == TINTYPE )
-	{
-		lwerror("%s: unsupported geometry type '%s'", __func__, lwtype_name(geom->type));
-	}
-
-	if ( width == 0.0 && height == 0.0 )
-	{
-		if ( geom->type == POINTTYPE )
-		{
-			lwcollection_add_lwgeom(col, lwgeom_clone_deep(geom));
-			return 1;
-		}
-		else
-		{
-			return 0;
-		}
-	}
-
-	/* Always just recurse into collections */
-	if ( lwgeom_is_collection(geom) && geom->type != MULTIPOINTTYPE )
-	{
-		LWCOLLECTION *incol = (LWCOLLECTION*)geom;
-		int n = 0;
-		for ( i = 0; i < incol->ngeoms; i++ )
-		{
-			/* Don't increment depth yet, since we aren't actually subdividing geomtries yet */
-			n += lwgeom_subdivide_recursive(incol->geoms[i], maxvertices, depth, col, clip);
-		}
-		return n;
-	}
-
-	/* But don't go too far. 2^50 ~= 10^15, that's enough subdivision */
-	/* Just add what's left */
-	if ( depth > maxdepth )
-	{
-		lwcollection_add_lwgeom(col, lwgeom_clone_deep(geom));
-		return 1;
-	}
-
-	nvertices = lwgeom_count_vertices(geom);
-	/* Skip empties entirely */
-	if ( nvertices == 0 )
-	{
-		return 0;
-	}
-
-	/* If it is under the vertex tolerance, just add it, we're done */
-	if ( nvertices < maxvertices )
-	{
-		lwcollection_add_lwgeom(col, lwgeom_clone_deep(geom));
-		return 1;
-	}
-
-	subbox1 = subbox2 = *clip;
-	if ( width > height )
-	{
-		subbox1.xmax = subbox2.xmin = (clip->xmin + clip->xmax)/2;
-	}
-	else
-	{
-		subbox1.ymax = subbox2.ymin = (clip->ymin + clip->ymax)/2;
-	}
-
-	if ( height == 0 )
-	{
-		subbox1.ymax += FP_TOLERANCE;
-		subbox2.ymax += FP_TOLERANCE;
-		subbox1.ymin -= FP_TOLERANCE;
-		subbox2.ymin -= FP_TOLERANCE;
-	}
-
-	if ( width == 0 )
-	{
-		subbox1.xmax += FP_TOLERANCE;
-		subbox2.xmax += FP_TOLERANCE;
-		subbox1.xmin -= FP_TOLERANCE;
-		subbox2.xmin -= FP_TOLERANCE;
-	}
-
-	clipped1 = lwgeom_clip_by_rect(geom, subbox1.xmin, subbox1.ymin, subbox1.xmax, subbox1.ymax);
-	clipped2 = lwgeom_clip_by_rect(geom, subbox2.xmin, subbox2.ymin, subbox2.xmax, subbox2.ymax);
-
-	++depth;
-
-	if ( clipped1 )
-	{
-		n += lwgeom_subdivide_recursive(clipped1, maxvertices, depth, col, &subbox1);
-		lwgeom_free(clipped1);
-	}
-
-	if ( clipped2 )
-	{
-		n += lwgeom_subdivide_recursive(clipped2, maxvertices, depth, col, &subbox2);
-		lwgeom_free(clipped2);
-	}
-
-	return n;
-
-}
-
-LWCOLLECTION *
-lwgeom_subdivide(const LWGEOM *geom, int maxvertices)
-{
-	static int startdepth = 0;
-	static int minmaxvertices = 8;
-	LWCOLLECTION *col;
-	GBOX clip;
-
-	col = lwcollection_construct_empty(COLLECTIONTYPE, geom->srid, lwgeom_has_z(geom), lwgeom_has_m(geom));
-
-	if ( lwgeom_is_empty(geom) )
-		return col;
-
-	if ( maxvertices < minmaxvertices )
-	{
-		lwcollection_free(col);
-		lwerror("%s: cannot subdivide to fewer than %d vertices per output", __func__, minmaxvertices);
-	}
-
-	clip = *(lwgeom_get_bbox(geom));
-	lwgeom_subdivide_recursive(geom, maxvertices, startdepth, col, &clip);
-	lwgeom_set_srid((LWGEOM*)col, geom->srid);
-	return col;
-}
-
-
 int
 lwgeom_is_trajectory(const LWGEOM *geom)
 {
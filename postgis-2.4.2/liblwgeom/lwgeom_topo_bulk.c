@@ -0,0 +1,2498 @@
+/**********************************************************************
+ *
+ * PostGIS - Spatial Types for PostgreSQL
+ * http://postgis.net
+ *
+ * PostGIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * PostGIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PostGIS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **********************************************************************/
+
+/*
+ * Bulk loading of topologies.
+ *
+ * A bulk load session reads the topology primitives into memory and
+ * exposes them through a backend of its own, indexed on identifiers,
+ * on node and face references and on a uniform grid. The editing
+ * functions of lwgeom_topo.c run unchanged against it, so the resulting
+ * topology is the one incremental editing would have produced, while
+ * the real backend is only used to reserve identifiers and, at the end,
+ * to write the primitives with batched inserts, updates and deletes.
+ *
+ * TopoGeometry objects live in the real backend, whose relations can
+ * only reference primitives it has. Splits are thus queued and replayed
+ * once the primitives are written, and the few callbacks reading or
+ * healing TopoGeometry objects write everything out first.
+ *
+ * The query callbacks mirror the semantic of the SQL backend
+ * (topology/postgis_topology.c), including the float rounding of the
+ * boxes compared by the && operator.
+ */
+
+#include "../postgis_config.h"
+
+/*#define POSTGIS_DEBUG_LEVEL 1*/
+#include "lwgeom_log.h"
+
+#include "liblwgeom_internal.h"
+#include "liblwgeom_topo_internal.h"
+#include "lwgeom_geos.h"
+
+#include <float.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h> /* for PRId64 */
+
+#ifdef WIN32
+# define LWTFMT_ELEMID "lld"
+#else
+# define LWTFMT_ELEMID PRId64
+#endif
+
+#define CHECKCB(be, method) do { \
+  if ( ! (be)->cb || ! (be)->cb->method ) \
+  lwerror("Callback " # method " not registered by backend"); \
+} while (0)
+
+/* Element flags */
+#define MT_NEW     0x01 /* not in the backend (yet, or anymore) */
+#define MT_DELETED 0x02
+#define MT_NOBOX   0x04 /* universe face */
+
+/* Boxes covering more grid cells than this go to the overflow list */
+#define MT_GRID_MAXCELLS 64
+
+/* Elements indexed when the grid was last sized, for regridding */
+#define MT_GRID_MINELEMS 1024
+
+/* Identifiers reserved per backend round-trip, the block doubles
+ * at each reservation up to the maximum */
+#define MT_IDBLOCK_MIN 16
+#define MT_IDBLOCK_MAX 4096
+
+/* Primitives written per backend call */
+#define MT_FLUSH_BATCH 1000
+
+#define MT_ERRMSG_LEN 256
+
+/*********************************************************************
+ *
+ * Index structures
+ *
+ ********************************************************************/
+
+static uint64_t
+mt_hash(LWT_ELEMID key)
+{
+  uint64_t x = (uint64_t)key;
+  x ^= x >> 33;
+  x *= UINT64_C(0xff51afd7ed558ccd);
+  x ^= x >> 33;
+  x *= UINT64_C(0xc4ceb9fe1a85ec53);
+  x ^= x >> 33;
+  return x;
+}
+
+/* Identifier to element slot */
+typedef struct
+{
+  LWT_ELEMID *keys;
+  int *vals; /* -1 for unused entries */
+  int size;
+  int capacity; /* power of two */
+}
+MT_IDMAP;
+
+static int
+mt_idmap_get(const MT_IDMAP *map, LWT_ELEMID key)
+{
+  uint64_t mask, i;
+  if ( ! map->capacity ) return -1;
+  mask = map->capacity - 1;
+  for ( i = mt_hash(key) & mask; map->vals[i] != -1; i = (i + 1) & mask )
+  {
+    if ( map->keys[i] == key ) return map->vals[i];
+  }
+  return -1;
+}
+
+static void mt_idmap_set(MT_IDMAP *map, LWT_ELEMID key, int val);
+
+static void
+mt_idmap_grow(MT_IDMAP *map)
+{
+  MT_IDMAP old = *map;
+  int i;
+
+  map->capacity = old.capacity ? old.capacity * 2 : 64;
+  map->size = 0;
+  map->keys = lwalloc(sizeof(LWT_ELEMID) * map->capacity);
+  map->vals = lwalloc(sizeof(int) * map->capacity);
+  for ( i = 0; i < map->capacity; ++i ) map->vals[i] = -1;
+  for ( i = 0; i < old.capacity; ++i )
+  {
+    if ( old.vals[i] != -1 ) mt_idmap_set(map, old.keys[i], old.vals[i]);
+  }
+  if ( old.capacity )
+  {
+    lwfree(old.keys);
+    lwfree(old.vals);
+  }
+}
+
+static void
+mt_idmap_set(MT_IDMAP *map, LWT_ELEMID key, int val)
+{
+  uint64_t mask, i;
+  if ( (map->size + 1) * 2 > map->capacity ) mt_idmap_grow(map);
+  mask = map->capacity - 1;
+  for ( i = mt_hash(key) & mask; map->vals[i] != -1; i = (i + 1) & mask )
+  {
+    if ( map->keys[i] == key )
+    {
+      map->vals[i] = val;
+      return;
+    }
+  }
+  map->keys[i] = key;
+  map->vals[i] = val;
+  map->size++;
+}
+
+static void
+mt_idmap_free(MT_IDMAP *map)
+{
+  if ( ! map->capacity ) return;
+  lwfree(map->keys);
+  lwfree(map->vals);
+}
+
+/* Key to a list of element slots */
+typedef struct
+{
+  LWT_ELEMID key;
+  int *slots;
+  int nslots;
+  int maxslots; /* 0 for unused entries */
+}
+MT_BUCKET;
+
+typedef struct
+{
+  MT_BUCKET *buckets;
+  int size;
+  int capacity; /* power of two */
+}
+MT_MULTIMAP;
+
+static MT_BUCKET *
+mt_mmap_find(const MT_MULTIMAP *mm, LWT_ELEMID key)
+{
+  uint64_t mask, i;
+  if ( ! mm->capacity ) return NULL;
+  mask = mm->capacity - 1;
+  for ( i = mt_hash(key) & mask; mm->buckets[i].maxslots; i = (i + 1) & mask )
+  {
+    if ( mm->buckets[i].key == key ) return &(mm->buckets[i]);
+  }
+  return NULL;
+}
+
+static MT_BUCKET *
+mt_mmap_insert(MT_MULTIMAP *mm, LWT_ELEMID key)
+{
+  uint64_t mask, i;
+
+  if ( (mm->size + 1) * 2 > mm->capacity )
+  {
+    MT_MULTIMAP old = *mm;
+    int j;
+    mm->capacity = old.capacity ? old.capacity * 2 : 64;
+    mm->buckets = lwalloc(sizeof(MT_BUCKET) * mm->capacity);
+    memset(mm->buckets, 0, sizeof(MT_BUCKET) * mm->capacity);
+    mask = mm->capacity - 1;
+    for ( j = 0; j < old.capacity; ++j )
+    {
+      if ( ! old.buckets[j].maxslots ) continue;
+      for ( i = mt_hash(old.buckets[j].key) & mask; mm->buckets[i].maxslots;
+            i = (i + 1) & mask ) ;
+      mm->buckets[i] = old.buckets[j];
+    }
+    if ( old.capacity ) lwfree(old.buckets);
+  }
+
+  mask = mm->capacity - 1;
+  for ( i = mt_hash(key) & mask; mm->buckets[i].maxslots; i = (i + 1) & mask )
+  {
+    if ( mm->buckets[i].key == key ) return &(mm->buckets[i]);
+  }
+  mm->buckets[i].key = key;
+  mm->buckets[i].maxslots = 4;
+  mm->buckets[i].nslots = 0;
+  mm->buckets[i].slots = lwalloc(sizeof(int) * 4);
+  mm->size++;
+  return &(mm->buckets[i]);
+}
+
+static void
+mt_mmap_add(MT_MULTIMAP *mm, LWT_ELEMID key, int slot)
+{
+  MT_BUCKET *b = mt_mmap_insert(mm, key);
+  if ( b->nslots == b->maxslots )
+  {
+    b->maxslots *= 2;
+    b->slots = lwrealloc(b->slots, sizeof(int) * b->maxslots);
+  }
+  b->slots[b->nslots++] = slot;
+}
+
+static void
+mt_mmap_remove(MT_MULTIMAP *mm, LWT_ELEMID key, int slot)
+{
+  MT_BUCKET *b = mt_mmap_find(mm, key);
+  int i;
+  if ( ! b ) return;
+  for ( i = 0; i < b->nslots; ++i )
+  {
+    if ( b->slots[i] == slot )
+    {
+      b->slots[i] = b->slots[--b->nslots];
+      return;
+    }
+  }
+}
+
+static void
+mt_mmap_free(MT_MULTIMAP *mm)
+{
+  int i;
+  for ( i = 0; i < mm->capacity; ++i )
+  {
+    if ( mm->buckets[i].maxslots ) lwfree(mm->buckets[i].slots);
+  }
+  if ( mm->capacity ) lwfree(mm->buckets);
+  memset(mm, 0, sizeof(MT_MULTIMAP));
+}
+
+/* Growable list of element slots */
+typedef struct
+{
+  int *slots;
+  int nslots;
+  int maxslots;
+}
+MT_SLOTS;
+
+static void
+mt_slots_add(MT_SLOTS *s, int slot)
+{
+  if ( s->nslots == s->maxslots )
+  {
+    s->maxslots = s->maxslots ? s->maxslots * 2 : 16;
+    s->slots = s->slots ? lwrealloc(s->slots, sizeof(int) * s->maxslots)
+                        : lwalloc(sizeof(int) * s->maxslots);
+  }
+  s->slots[s->nslots++] = slot;
+}
+
+static void
+mt_slots_remove(MT_SLOTS *s, int slot)
+{
+  int i;
+  for ( i = 0; i < s->nslots; ++i )
+  {
+    if ( s->slots[i] == slot )
+    {
+      s->slots[i] = s->slots[--s->nslots];
+      return;
+    }
+  }
+}
+
+static void
+mt_slots_free(MT_SLOTS *s)
+{
+  if ( s->slots ) lwfree(s->slots);
+  memset(s, 0, sizeof(MT_SLOTS));
+}
+
+static int
+mt_cmp_int(const void *a, const void *b)
+{
+  int ia = *((const int*)a);
+  int ib = *((const int*)b);
+  return ia < ib ? -1 : ia > ib ? 1 : 0;
+}
+
+/* Uniform grid of element boxes, hashed on cell coordinates */
+typedef struct
+{
+  MT_MULTIMAP cells;
+  MT_SLOTS big; /* boxes spanning too many cells, or all if not sized */
+}
+MT_GRID;
+
+/*
+ * Compute the range of cells covered by a box.
+ * Return 0 if the range is too large for the given number of cells,
+ * or cannot be represented.
+ */
+static int
+mt_grid_range(double cellsize, const GBOX *box, int maxcells,
+              int32_t *cx0, int32_t *cy0, int32_t *cx1, int32_t *cy1)
+{
+  double fx0, fy0, fx1, fy1;
+
+  if ( cellsize <= 0 ) return 0;
+  fx0 = floor(box->xmin / cellsize);
+  fy0 = floor(box->ymin / cellsize);
+  fx1 = floor(box->xmax / cellsize);
+  fy1 = floor(box->ymax / cellsize);
+  if ( ! ( fx0 > -1e9 && fy0 > -1e9 && fx1 < 1e9 && fy1 < 1e9 ) ) return 0;
+  if ( (fx1 - fx0 + 1) * (fy1 - fy0 + 1) > maxcells ) return 0;
+  *cx0 = (int32_t)fx0; *cy0 = (int32_t)fy0;
+  *cx1 = (int32_t)fx1; *cy1 = (int32_t)fy1;
+  return 1;
+}
+
+#define MT_CELLKEY(cx, cy) \
+  ((LWT_ELEMID)(((uint64_t)(uint32_t)(cx) << 32) | (uint32_t)(cy)))
+
+static void
+mt_grid_add(MT_GRID *grid, double cellsize, const GBOX *box, int slot)
+{
+  int32_t cx0, cy0, cx1, cy1, cx, cy;
+  if ( ! mt_grid_range(cellsize, box, MT_GRID_MAXCELLS, &cx0, &cy0, &cx1, &cy1) )
+  {
+    mt_slots_add(&(grid->big), slot);
+    return;
+  }
+  for ( cx = cx0; cx <= cx1; ++cx )
+    for ( cy = cy0; cy <= cy1; ++cy )
+      mt_mmap_add(&(grid->cells), MT_CELLKEY(cx, cy), slot);
+}
+
+static void
+mt_grid_remove(MT_GRID *grid, double cellsize, const GBOX *box, int slot)
+{
+  int32_t cx0, cy0, cx1, cy1, cx, cy;
+  if ( ! mt_grid_range(cellsize, box, MT_GRID_MAXCELLS, &cx0, &cy0, &cx1, &cy1) )
+  {
+    mt_slots_remove(&(grid->big), slot);
+    return;
+  }
+  for ( cx = cx0; cx <= cx1; ++cx )
+    for ( cy = cy0; cy <= cy1; ++cy )
+      mt_mmap_remove(&(grid->cells), MT_CELLKEY(cx, cy), slot);
+}
+
+static void
+mt_grid_free(MT_GRID *grid)
+{
+  mt_mmap_free(&(grid->cells));
+  mt_slots_free(&(grid->big));
+}
+
+/*********************************************************************
+ *
+ * In-memory topology
+ *
+ ********************************************************************/
+
+/* Elements of a type, with their bookkeeping */
+typedef struct
+{
+  void *elems; /* LWT_ISO_NODE, LWT_ISO_EDGE or LWT_ISO_FACE */
+  size_t elemsize;
+  GBOX *boxes; /* 2D boxes, rounded to float as the backend would */
+  int *flags;
+  int *dirty; /* LWT_COL_* fields changed since loaded */
+  unsigned int *stamps;
+  int num;
+  int max;
+  int alive;
+  MT_IDMAP ids;
+  MT_GRID grid;
+}
+MT_STORE;
+
+/* Split of a primitive, as signalled to updateTopoGeom*Split */
+typedef struct
+{
+  int elemtype; /* LWT_ELEM_EDGE or LWT_ELEM_FACE */
+  LWT_ELEMID split;
+  LWT_ELEMID new1;
+  LWT_ELEMID new2; /* -1 if split is kept */
+}
+MT_SPLIT;
+
+/* Pool of reserved identifiers */
+typedef struct
+{
+  LWT_ELEMID *ids;
+  int num;
+  int next;
+  int block;
+}
+MT_IDPOOL;
+
+typedef struct MEMTOPO_T
+{
+  LWT_TOPOLOGY *parent;
+  LWT_TOPOLOGY *topo; /* the handler running against us */
+  LWT_BE_IFACE *iface;
+  char lasterr[MT_ERRMSG_LEN];
+
+  MT_STORE nodes;
+  MT_STORE edges;
+  MT_STORE faces;
+
+  MT_MULTIMAP edges_by_node;
+  MT_MULTIMAP edges_by_face;
+  MT_MULTIMAP nodes_by_face; /* isolated nodes */
+
+  double cellsize;
+  int regrid_at;
+  unsigned int stamp;
+
+  MT_IDPOOL pools[3]; /* by LWT_ELEM_* - 1 */
+
+  /* Splits not yet reported to the backend */
+  MT_SPLIT *splits;
+  int nsplits;
+  int maxsplits;
+}
+MEMTOPO;
+
+#define MT_NODE(mt, i) (((LWT_ISO_NODE*)(mt)->nodes.elems)[i])
+#define MT_EDGE(mt, i) (((LWT_ISO_EDGE*)(mt)->edges.elems)[i])
+#define MT_FACE(mt, i) (((LWT_ISO_FACE*)(mt)->faces.elems)[i])
+
+#define MT_ALIVE(st, i) ( ! ((st)->flags[i] & MT_DELETED) )
+
+static void
+mt_error(MEMTOPO *mt, const char *fmt, ...)
+{
+  va_list ap;
+  va_start(ap, fmt);
+  vsnprintf(mt->lasterr, MT_ERRMSG_LEN, fmt, ap);
+  va_end(ap);
+  mt->lasterr[MT_ERRMSG_LEN-1] = '\0';
+}
+
+/* Record the last error of the real backend as ours */
+static void
+mt_parent_error(MEMTOPO *mt)
+{
+  const LWT_BE_IFACE *be = mt->parent->be_iface;
+  mt_error(mt, "%s", be->cb->lastErrorMessage(be->data));
+}
+
+static void
+mt_store_init(MT_STORE *st, size_t elemsize)
+{
+  memset(st, 0, sizeof(MT_STORE));
+  st->elemsize = elemsize;
+}
+
+/* Append a zeroed element, returning its slot */
+static int
+mt_store_append(MT_STORE *st)
+{
+  int slot;
+  if ( st->num == st->max )
+  {
+    st->max = st->max ? st->max * 2 : 64;
+    st->elems = st->elems ? lwrealloc(st->elems, st->elemsize * st->max)
+                          : lwalloc(st->elemsize * st->max);
+    st->boxes = st->boxes ? lwrealloc(st->boxes, sizeof(GBOX) * st->max)
+                          : lwalloc(sizeof(GBOX) * st->max);
+    st->flags = st->flags ? lwrealloc(st->flags, sizeof(int) * st->max)
+                          : lwalloc(sizeof(int) * st->max);
+    st->dirty = st->dirty ? lwrealloc(st->dirty, sizeof(int) * st->max)
+                          : lwalloc(sizeof(int) * st->max);
+    st->stamps = st->stamps ? lwrealloc(st->stamps, sizeof(unsigned int) * st->max)
+                            : lwalloc(sizeof(unsigned int) * st->max);
+  }
+  slot = st->num++;
+  memset((char*)st->elems + st->elemsize * slot, 0, st->elemsize);
+  memset(&(st->boxes[slot]), 0, sizeof(GBOX));
+  st->flags[slot] = 0;
+  st->dirty[slot] = 0;
+  st->stamps[slot] = 0;
+  st->alive++;
+  return slot;
+}
+
+static void
+mt_store_free(MT_STORE *st)
+{
+  if ( st->max )
+  {
+    lwfree(st->elems);
+    lwfree(st->boxes);
+    lwfree(st->flags);
+    lwfree(st->dirty);
+    lwfree(st->stamps);
+  }
+  mt_idmap_free(&(st->ids));
+  mt_grid_free(&(st->grid));
+}
+
+/* Slot of the live element with given id, or -1 */
+static int
+mt_store_lookup(const MT_STORE *st, LWT_ELEMID id)
+{
+  int slot = mt_idmap_get(&(st->ids), id);
+  if ( slot == -1 || ! MT_ALIVE(st, slot) ) return -1;
+  return slot;
+}
+
+static void
+mt_box_set(GBOX *box, const GBOX *from)
+{
+  box->flags = 0;
+  box->xmin = from->xmin;
+  box->xmax = from->xmax;
+  box->ymin = from->ymin;
+  box->ymax = from->ymax;
+  gbox_float_round(box);
+}
+
+static void
+mt_node_box(const LWT_ISO_NODE *node, GBOX *box)
+{
+  const POINT2D *p = getPoint2d_cp(node->geom->point, 0);
+  GBOX pbox;
+  pbox.xmin = pbox.xmax = p->x;
+  pbox.ymin = pbox.ymax = p->y;
+  mt_box_set(box, &pbox);
+}
+
+static void
+mt_edge_box(const LWT_ISO_EDGE *edge, GBOX *box)
+{
+  GBOX ebox;
+  ebox.flags = edge->geom->points->flags;
+  ptarray_calculate_gbox_cartesian(edge->geom->points, &ebox);
+  mt_box_set(box, &ebox);
+}
+
+/*
+ * Add/remove elements to/from the reference and spatial indexes.
+ * The box computed on linking is kept for unlinking, so the element
+ * can be modified in between.
+ */
+
+static void
+mt_node_link(MEMTOPO *mt, int slot)
+{
+  LWT_ISO_NODE *node = &(MT_NODE(mt, slot));
+  if ( node->containing_face != -1 )
+    mt_mmap_add(&(mt->nodes_by_face), node->containing_face, slot);
+  if ( node->geom && ! lwpoint_is_empty(node->geom) )
+  {
+    mt->nodes.flags[slot] &= ~MT_NOBOX;
+    mt_node_box(node, &(mt->nodes.boxes[slot]));
+    mt_grid_add(&(mt->nodes.grid), mt->cellsize, &(mt->nodes.boxes[slot]), slot);
+  }
+  else mt->nodes.flags[slot] |= MT_NOBOX;
+}
+
+static void
+mt_node_unlink(MEMTOPO *mt, int slot)
+{
+  LWT_ISO_NODE *node = &(MT_NODE(mt, slot));
+  if ( node->containing_face != -1 )
+    mt_mmap_remove(&(mt->nodes_by_face), node->containing_face, slot);
+  if ( ! (mt->nodes.flags[slot] & MT_NOBOX) )
+    mt_grid_remove(&(mt->nodes.grid), mt->cellsize, &(mt->nodes.boxes[slot]), slot);
+}
+
+static void
+mt_edge_link(MEMTOPO *mt, int slot)
+{
+  LWT_ISO_EDGE *edge = &(MT_EDGE(mt, slot));
+  mt_mmap_add(&(mt->edges_by_node), edge->start_node, slot);
+  if ( edge->end_node != edge->start_node )
+    mt_mmap_add(&(mt->edges_by_node), edge->end_node, slot);
+  mt_mmap_add(&(mt->edges_by_face), edge->face_left, slot);
+  if ( edge->face_right != edge->face_left )
+    mt_mmap_add(&(mt->edges_by_face), edge->face_right, slot);
+  if ( edge->geom && edge->geom->points->npoints )
+  {
+    mt->edges.flags[slot] &= ~MT_NOBOX;
+    mt_edge_box(edge, &(mt->edges.boxes[slot]));
+    mt_grid_add(&(mt->edges.grid), mt->cellsize, &(mt->edges.boxes[slot]), slot);
+  }
+  else mt->edges.flags[slot] |= MT_NOBOX;
+}
+
+static void
+mt_edge_unlink(MEMTOPO *mt, int slot)
+{
+  LWT_ISO_EDGE *edge = &(MT_EDGE(mt, slot));
+  mt_mmap_remove(&(mt->edges_by_node), edge->start_node, slot);
+  if ( edge->end_node != edge->start_node )
+    mt_mmap_remove(&(mt->edges_by_node), edge->end_node, slot);
+  mt_mmap_remove(&(mt->edges_by_face), edge->face_left, slot);
+  if ( edge->face_right != edge->face_left )
+    mt_mmap_remove(&(mt->edges_by_face), edge->face_right, slot);
+  if ( ! (mt->edges.flags[slot] & MT_NOBOX) )
+    mt_grid_remove(&(mt->edges.grid), mt->cellsize, &(mt->edges.boxes[slot]), slot);
+}
+
+static void
+mt_face_link(MEMTOPO *mt, int slot)
+{
+  LWT_ISO_FACE *face = &(MT_FACE(mt, slot));
+  if ( face->mbr )
+  {
+    mt->faces.flags[slot] &= ~MT_NOBOX;
+    mt_box_set(&(mt->faces.boxes[slot]), face->mbr);
+    mt_grid_add(&(mt->faces.grid), mt->cellsize, &(mt->faces.boxes[slot]), slot);
+  }
+  else mt->faces.flags[slot] |= MT_NOBOX;
+}
+
+static void
+mt_face_unlink(MEMTOPO *mt, int slot)
+{
+  if ( ! (mt->faces.flags[slot] & MT_NOBOX) )
+    mt_grid_remove(&(mt->faces.grid), mt->cellsize, &(mt->faces.boxes[slot]), slot);
+}
+
+/*
+ * Size the grid cells after the average edge extent (or after the
+ * node density if there are no edges) and re-index all boxes.
+ */
+static void
+mt_regrid(MEMTOPO *mt)
+{
+  double sum = 0, cellsize = 0;
+  int i, n = 0;
+  GBOX ext;
+
+  for ( i = 0; i < mt->edges.num; ++i )
+  {
+    const GBOX *b = &(mt->edges.boxes[i]);
+    if ( ! MT_ALIVE(&(mt->edges), i) || (mt->edges.flags[i] & MT_NOBOX) ) continue;
+    sum += FP_MAX(b->xmax - b->xmin, b->ymax - b->ymin);
+    n++;
+  }
+  if ( n ) cellsize = 2 * sum / n;
+
+  if ( cellsize <= 0 )
+  {
+    n = 0;
+    for ( i = 0; i < mt->nodes.num; ++i )
+    {
+      const GBOX *b = &(mt->nodes.boxes[i]);
+      if ( ! MT_ALIVE(&(mt->nodes), i) || (mt->nodes.flags[i] & MT_NOBOX) ) continue;
+      if ( n++ ) gbox_merge(b, &ext);
+      else ext = *b;
+    }
+    if ( n )
+      cellsize = 2 * sqrt((ext.xmax - ext.xmin) * (ext.ymax - ext.ymin) / n);
+  }
+
+  LWDEBUGF(1, "Regridding %d nodes, %d edges, %d faces with cell size %g",
+              mt->nodes.alive, mt->edges.alive, mt->faces.alive, cellsize);
+
+  mt_grid_free(&(mt->nodes.grid));
+  mt_grid_free(&(mt->edges.grid));
+  mt_grid_free(&(mt->faces.grid));
+  mt->cellsize = cellsize;
+
+  for ( i = 0; i < mt->nodes.num; ++i )
+  {
+    if ( ! MT_ALIVE(&(mt->nodes), i) || (mt->nodes.flags[i] & MT_NOBOX) ) continue;
+    mt_grid_add(&(mt->nodes.grid), cellsize, &(mt->nodes.boxes[i]), i);
+  }
+  for ( i = 0; i < mt->edges.num; ++i )
+  {
+    if ( ! MT_ALIVE(&(mt->edges), i) || (mt->edges.flags[i] & MT_NOBOX) ) continue;
+    mt_grid_add(&(mt->edges.grid), cellsize, &(mt->edges.boxes[i]), i);
+  }
+  for ( i = 0; i < mt->faces.num; ++i )
+  {
+    if ( ! MT_ALIVE(&(mt->faces), i) || (mt->faces.flags[i] & MT_NOBOX) ) continue;
+    mt_grid_add(&(mt->faces.grid), cellsize, &(mt->faces.boxes[i]), i);
+  }
+
+  mt->regrid_at = 2 * (mt->nodes.alive + mt->edges.alive + mt->faces.alive)
+                + MT_GRID_MINELEMS;
+}
+
+static void
+mt_check_regrid(MEMTOPO *mt)
+{
+  if ( mt->nodes.alive + mt->edges.alive + mt->faces.alive > mt->regrid_at )
+    mt_regrid(mt);
+}
+
+/*
+ * Collect, in slot order, the live elements of a store whose
+ * box overlaps the given one (all of them if box is NULL).
+ * The query box is rounded as the backend would.
+ */
+static void
+mt_store_query(MEMTOPO *mt, MT_STORE *st, const GBOX *box, MT_SLOTS *out)
+{
+  int32_t cx0, cy0, cx1, cy1, cx, cy;
+  GBOX qbox;
+  unsigned int stamp;
+  int i;
+
+  if ( ! box )
+  {
+    for ( i = 0; i < st->num; ++i )
+      if ( MT_ALIVE(st, i) ) mt_slots_add(out, i);
+    return;
+  }
+
+  mt_box_set(&qbox, box);
+
+  if ( ! mt_grid_range(mt->cellsize, &qbox, st->num + MT_GRID_MAXCELLS,
+                       &cx0, &cy0, &cx1, &cy1) )
+  {
+    for ( i = 0; i < st->num; ++i )
+    {
+      if ( ! MT_ALIVE(st, i) || (st->flags[i] & MT_NOBOX) ) continue;
+      if ( gbox_overlaps_2d(&(st->boxes[i]), &qbox) ) mt_slots_add(out, i);
+    }
+    return;
+  }
+
+  stamp = ++mt->stamp;
+  for ( cx = cx0; cx <= cx1; ++cx )
+  {
+    for ( cy = cy0; cy <= cy1; ++cy )
+    {
+      MT_BUCKET *b = mt_mmap_find(&(st->grid.cells), MT_CELLKEY(cx, cy));
+      if ( ! b ) continue;
+      for ( i = 0; i < b->nslots; ++i )
+      {
+        int slot = b->slots[i];
+        if ( st->stamps[slot] == stamp ) continue;
+        st->stamps[slot] = stamp;
+        if ( gbox_overlaps_2d(&(st->boxes[slot]), &qbox) )
+          mt_slots_add(out, slot);
+      }
+    }
+  }
+  for ( i = 0; i < st->grid.big.nslots; ++i )
+  {
+    int slot = st->grid.big.slots[i];
+    if ( gbox_overlaps_2d(&(st->boxes[slot]), &qbox) )
+      mt_slots_add(out, slot);
+  }
+  qsort(out->slots, out->nslots, sizeof(int), mt_cmp_int);
+}
+
+/* Collect, in slot order, the live elements with given ids */
+static void
+mt_store_query_ids(MEMTOPO *mt, MT_STORE *st, const LWT_ELEMID *ids, int num,
+                   MT_SLOTS *out)
+{
+  unsigned int stamp = ++mt->stamp;
+  int i;
+  for ( i = 0; i < num; ++i )
+  {
+    int slot = mt_store_lookup(st, ids[i]);
+    if ( slot == -1 || st->stamps[slot] == stamp ) continue;
+    st->stamps[slot] = stamp;
+    mt_slots_add(out, slot);
+  }
+  qsort(out->slots, out->nslots, sizeof(int), mt_cmp_int);
+}
+
+/* Collect, in slot order, the elements referenced by given keys */
+static void
+mt_store_query_refs(MEMTOPO *mt, MT_STORE *st, const MT_MULTIMAP *mm,
+                    const LWT_ELEMID *keys, int num, MT_SLOTS *out)
+{
+  unsigned int stamp = ++mt->stamp;
+  int i, j;
+  for ( i = 0; i < num; ++i )
+  {
+    MT_BUCKET *b = mt_mmap_find(mm, keys[i]);
+    if ( ! b ) continue;
+    for ( j = 0; j < b->nslots; ++j )
+    {
+      int slot = b->slots[j];
+      if ( st->stamps[slot] == stamp ) continue;
+      st->stamps[slot] = stamp;
+      mt_slots_add(out, slot);
+    }
+  }
+  qsort(out->slots, out->nslots, sizeof(int), mt_cmp_int);
+}
+
+/*
+ * Copy out elements, cloning geometries only when requested
+ * as the caller will release them.
+ */
+
+static LWT_ISO_NODE *
+mt_nodes_out(MEMTOPO *mt, const MT_SLOTS *s, int num, int fields)
+{
+  LWT_ISO_NODE *out = lwalloc(sizeof(LWT_ISO_NODE) * num);
+  int i;
+  for ( i = 0; i < num; ++i )
+  {
+    const LWT_ISO_NODE *n = &(MT_NODE(mt, s->slots[i]));
+    out[i] = *n;
+    out[i].geom = ( (fields & LWT_COL_NODE_GEOM) && n->geom ) ?
+      lwgeom_as_lwpoint(lwgeom_clone_deep(lwpoint_as_lwgeom(n->geom))) : NULL;
+  }
+  return out;
+}
+
+static LWT_ISO_EDGE *
+mt_edges_out(MEMTOPO *mt, const MT_SLOTS *s, int num, int fields)
+{
+  LWT_ISO_EDGE *out = lwalloc(sizeof(LWT_ISO_EDGE) * num);
+  int i;
+  for ( i = 0; i < num; ++i )
+  {
+    const LWT_ISO_EDGE *e = &(MT_EDGE(mt, s->slots[i]));
+    out[i] = *e;
+    out[i].geom = ( (fields & LWT_COL_EDGE_GEOM) && e->geom ) ?
+      lwline_clone_deep(e->geom) : NULL;
+  }
+  return out;
+}
+
+static LWT_ISO_FACE *
+mt_faces_out(MEMTOPO *mt, const MT_SLOTS *s, int num, int fields)
+{
+  LWT_ISO_FACE *out = lwalloc(sizeof(LWT_ISO_FACE) * num);
+  int i;
+  for ( i = 0; i < num; ++i )
+  {
+    const LWT_ISO_FACE *f = &(MT_FACE(mt, s->slots[i]));
+    out[i].face_id = f->face_id;
+    out[i].mbr = ( (fields & LWT_COL_FACE_MBR) && f->mbr ) ?
+      gbox_clone(f->mbr) : NULL;
+  }
+  return out;
+}
+
+/*
+ * Shared tail of the queries taking a limit: 0 for unlimited,
+ * -1 for an existence check.
+ */
+#define MT_RETURN_LIMITED(mt, s, numelems, fields, limit, outfunc) do { \
+  int num_ = (s).nslots; \
+  void *ret_ = NULL; \
+  if ( (limit) > 0 && num_ > (limit) ) num_ = (limit); \
+  if ( (limit) == -1 ) *(numelems) = num_ ? 1 : 0; \
+  else { \
+    *(numelems) = num_; \
+    if ( num_ ) ret_ = outfunc((mt), &(s), num_, (fields)); \
+  } \
+  mt_slots_free(&(s)); \
+  return ret_; \
+} while (0)
+
+/* The SQL backend prints distances with %g */
+static double
+mt_sql_distance(double dist)
+{
+  char buf[64];
+  snprintf(buf, 64, "%g", dist);
+  return atof(buf);
+}
+
+/* Next identifier for a new primitive, or -1 on error */
+static LWT_ELEMID
+mt_next_id(MEMTOPO *mt, int elemtype)
+{
+  MT_IDPOOL *pool = &(mt->pools[elemtype - 1]);
+  const LWT_BE_IFACE *be = mt->parent->be_iface;
+
+  if ( pool->next == pool->num )
+  {
+    pool->block = pool->block ? FP_MIN(pool->block * 2, MT_IDBLOCK_MAX)
+                              : MT_IDBLOCK_MIN;
+    pool->ids = pool->ids ? lwrealloc(pool->ids, sizeof(LWT_ELEMID) * pool->block)
+                          : lwalloc(sizeof(LWT_ELEMID) * pool->block);
+    if ( ! be->cb->reserveElementIds(mt->parent->be_topo, elemtype,
+                                     pool->ids, pool->block) )
+    {
+      mt_parent_error(mt);
+      pool->num = pool->next = 0;
+      return -1;
+    }
+    pool->num = pool->block;
+    pool->next = 0;
+  }
+  return pool->ids[pool->next++];
+}
+
+/*********************************************************************
+ *
+ * Element updates
+ *
+ ********************************************************************/
+
+static void
+mt_node_set(MEMTOPO *mt, int slot, const LWT_ISO_NODE *upd, int fields)
+{
+  LWT_ISO_NODE *node = &(MT_NODE(mt, slot));
+
+  mt_node_unlink(mt, slot);
+  if ( fields & LWT_COL_NODE_CONTAINING_FACE )
+    node->containing_face = upd->containing_face;
+  if ( fields & LWT_COL_NODE_GEOM )
+  {
+    if ( node->geom ) lwpoint_free(node->geom);
+    node->geom = upd->geom ?
+      lwgeom_as_lwpoint(lwgeom_clone_deep(lwpoint_as_lwgeom(upd->geom))) : NULL;
+  }
+  mt_node_link(mt, slot);
+  mt->nodes.dirty[slot] |= fields;
+}
+
+static void
+mt_edge_set(MEMTOPO *mt, int slot, const LWT_ISO_EDGE *upd, int fields)
+{
+  LWT_ISO_EDGE *edge = &(MT_EDGE(mt, slot));
+
+  mt_edge_unlink(mt, slot);
+  if ( fields & LWT_COL_EDGE_START_NODE ) edge->start_node = upd->start_node;
+  if ( fields & LWT_COL_EDGE_END_NODE ) edge->end_node = upd->end_node;
+  if ( fields & LWT_COL_EDGE_FACE_LEFT ) edge->face_left = upd->face_left;
+  if ( fields & LWT_COL_EDGE_FACE_RIGHT ) edge->face_right = upd->face_right;
+  if ( fields & LWT_COL_EDGE_NEXT_LEFT ) edge->next_left = upd->next_left;
+  if ( fields & LWT_COL_EDGE_NEXT_RIGHT ) edge->next_right = upd->next_right;
+  if ( fields & LWT_COL_EDGE_GEOM )
+  {
+    if ( edge->geom ) lwline_free(edge->geom);
+    edge->geom = upd->geom ? lwline_clone_deep(upd->geom) : NULL;
+  }
+  mt_edge_link(mt, slot);
+  mt->edges.dirty[slot] |= fields;
+}
+
+/*
+ * Match an edge against the fields of a selection (all equal) or
+ * of an exclusion (all different). As the backend also compares the
+ * absolute value of next edges, exclusion on those is by absolute value.
+ */
+static int
+mt_edge_match(const LWT_ISO_EDGE *e, const LWT_ISO_EDGE *ref, int fields,
+              int exclude)
+{
+#define MT_FIELD_MATCH(eq) if ( exclude ? (eq) : ! (eq) ) return 0
+  if ( fields & LWT_COL_EDGE_EDGE_ID )
+    MT_FIELD_MATCH(e->edge_id == ref->edge_id);
+  if ( fields & LWT_COL_EDGE_START_NODE )
+    MT_FIELD_MATCH(e->start_node == ref->start_node);
+  if ( fields & LWT_COL_EDGE_END_NODE )
+    MT_FIELD_MATCH(e->end_node == ref->end_node);
+  if ( fields & LWT_COL_EDGE_FACE_LEFT )
+    MT_FIELD_MATCH(e->face_left == ref->face_left);
+  if ( fields & LWT_COL_EDGE_FACE_RIGHT )
+    MT_FIELD_MATCH(e->face_right == ref->face_right);
+  if ( fields & LWT_COL_EDGE_NEXT_LEFT )
+    MT_FIELD_MATCH(exclude ? llabs(e->next_left) == llabs(ref->next_left)
+                           : e->next_left == ref->next_left);
+  if ( fields & LWT_COL_EDGE_NEXT_RIGHT )
+    MT_FIELD_MATCH(exclude ? llabs(e->next_right) == llabs(ref->next_right)
+                           : e->next_right == ref->next_right);
+  if ( fields & LWT_COL_EDGE_GEOM )
+    MT_FIELD_MATCH(e->geom && ref->geom &&
+                   lwgeom_same(lwline_as_lwgeom(e->geom),
+                               lwline_as_lwgeom(ref->geom)));
+  return 1;
+}
+
+/*
+ * As above for nodes. A missing containing face is a NULL in the
+ * backend, which neither equals nor differs from anything.
+ */
+static int
+mt_node_match(const LWT_ISO_NODE *n, const LWT_ISO_NODE *ref, int fields,
+              int exclude)
+{
+  if ( fields & LWT_COL_NODE_NODE_ID )
+    MT_FIELD_MATCH(n->node_id == ref->node_id);
+  if ( fields & LWT_COL_NODE_CONTAINING_FACE )
+  {
+    if ( n->containing_face == -1 || ref->containing_face == -1 ) return 0;
+    MT_FIELD_MATCH(n->containing_face == ref->containing_face);
+  }
+  if ( fields & LWT_COL_NODE_GEOM )
+    MT_FIELD_MATCH(n->geom && ref->geom &&
+                   lwgeom_same(lwpoint_as_lwgeom(n->geom),
+                               lwpoint_as_lwgeom(ref->geom)));
+  return 1;
+#undef MT_FIELD_MATCH
+}
+
+/* Candidate edges for a selection, narrowed by the indexed fields */
+static void
+mt_edge_candidates(MEMTOPO *mt, const LWT_ISO_EDGE *sel, int sel_fields,
+                   MT_SLOTS *out)
+{
+  if ( sel && (sel_fields & LWT_COL_EDGE_EDGE_ID) )
+    mt_store_query_ids(mt, &(mt->edges), &(sel->edge_id), 1, out);
+  else if ( sel && (sel_fields & LWT_COL_EDGE_START_NODE) )
+    mt_store_query_refs(mt, &(mt->edges), &(mt->edges_by_node),
+                        &(sel->start_node), 1, out);
+  else if ( sel && (sel_fields & LWT_COL_EDGE_END_NODE) )
+    mt_store_query_refs(mt, &(mt->edges), &(mt->edges_by_node),
+                        &(sel->end_node), 1, out);
+  else if ( sel && (sel_fields & LWT_COL_EDGE_FACE_LEFT) )
+    mt_store_query_refs(mt, &(mt->edges), &(mt->edges_by_face),
+                        &(sel->face_left), 1, out);
+  else if ( sel && (sel_fields & LWT_COL_EDGE_FACE_RIGHT) )
+    mt_store_query_refs(mt, &(mt->edges), &(mt->edges_by_face),
+                        &(sel->face_right), 1, out);
+  else
+    mt_store_query(mt, &(mt->edges), NULL, out);
+}
+
+static void
+mt_node_candidates(MEMTOPO *mt, const LWT_ISO_NODE *sel, int sel_fields,
+                   MT_SLOTS *out)
+{
+  if ( sel && (sel_fields & LWT_COL_NODE_NODE_ID) )
+    mt_store_query_ids(mt, &(mt->nodes), &(sel->node_id), 1, out);
+  else if ( sel && (sel_fields & LWT_COL_NODE_CONTAINING_FACE) )
+    mt_store_query_refs(mt, &(mt->nodes), &(mt->nodes_by_face),
+                        &(sel->containing_face), 1, out);
+  else
+    mt_store_query(mt, &(mt->nodes), NULL, out);
+}
+
+/*********************************************************************
+ *
+ * Backend callbacks
+ *
+ ********************************************************************/
+
+#define MT(topo) ((MEMTOPO*)(topo))
+
+static const char *
+mt_lastErrorMessage(const LWT_BE_DATA* be)
+{
+  return ((const MEMTOPO*)be)->lasterr;
+}
+
+static void mt_free(MEMTOPO *mt);
+
+static int
+mt_freeTopology(LWT_BE_TOPOLOGY* topo)
+{
+  mt_free(MT(topo));
+  return 1;
+}
+
+static LWT_ISO_NODE *
+mt_getNodeById(const LWT_BE_TOPOLOGY* topo,
+               const LWT_ELEMID* ids, int* numelems, int fields)
+{
+  MEMTOPO *mt = MT(topo);
+  MT_SLOTS s = {0};
+  mt_store_query_ids(mt, &(mt->nodes), ids, *numelems, &s);
+  MT_RETURN_LIMITED(mt, s, numelems, fields, 0, mt_nodes_out);
+}
+
+static LWT_ISO_NODE *
+mt_getNodeWithinDistance2D(const LWT_BE_TOPOLOGY* topo,
+                           const LWPOINT* pt, double dist, int* numelems,
+                           int fields, int limit)
+{
+  MEMTOPO *mt = MT(topo);
+  MT_SLOTS c = {0}, s = {0};
+  const POINT2D *p;
+  GBOX box;
+  int i;
+
+  if ( lwpoint_is_empty(pt) ) {
+    *numelems = 0;
+    return NULL;
+  }
+  p = getPoint2d_cp(pt->point, 0);
+  dist = mt_sql_distance(dist);
+  box.xmin = p->x - dist; box.xmax = p->x + dist;
+  box.ymin = p->y - dist; box.ymax = p->y + dist;
+  mt_store_query(mt, &(mt->nodes), &box, &c);
+
+  for ( i = 0; i < c.nslots; ++i )
+  {
+    const LWT_ISO_NODE *n = &(MT_NODE(mt, c.slots[i]));
+    if ( dist )
+    {
+      /* ST_DWithin */
+      if ( lwgeom_mindistance2d_tolerance(lwpoint_as_lwgeom(n->geom),
+                                          lwpoint_as_lwgeom(pt), dist) > dist )
+        continue;
+    }
+    else
+    {
+      /* ST_Equals */
+      const POINT2D *np = getPoint2d_cp(n->geom->point, 0);
+      if ( np->x != p->x || np->y != p->y ) continue;
+    }
+    mt_slots_add(&s, c.slots[i]);
+    if ( limit && s.nslots == abs(limit) ) break;
+  }
+  mt_slots_free(&c);
+
+  MT_RETURN_LIMITED(mt, s, numelems, fields, limit, mt_nodes_out);
+}
+
+static int
+mt_insertNodes(const LWT_BE_TOPOLOGY* topo, LWT_ISO_NODE* nodes, int numelems)
+{
+  MEMTOPO *mt = MT(topo);
+  int i;
+
+  for ( i = 0; i < numelems; ++i )
+  {
+    LWT_ISO_NODE *n = &(nodes[i]);
+    int slot;
+
+    if ( n->node_id == -1 )
+    {
+      n->node_id = mt_next_id(mt, LWT_ELEM_NODE);
+      if ( n->node_id == -1 ) return 0;
+    }
+    else if ( mt_store_lookup(&(mt->nodes), n->node_id) != -1 )
+    {
+      mt_error(mt, "duplicate node_id %" LWTFMT_ELEMID, n->node_id);
+      return 0;
+    }
+
+    slot = mt_store_append(&(mt->nodes));
+    MT_NODE(mt, slot).node_id = n->node_id;
+    MT_NODE(mt, slot).containing_face = n->containing_face;
+    MT_NODE(mt, slot).geom = n->geom ?
+      lwgeom_as_lwpoint(lwgeom_clone_deep(lwpoint_as_lwgeom(n->geom))) : NULL;
+    mt->nodes.flags[slot] = MT_NEW;
+    mt_idmap_set(&(mt->nodes.ids), n->node_id, slot);
+    mt_node_link(mt, slot);
+  }
+  mt_check_regrid(mt);
+
+  return 1;
+}
+
+static LWT_ISO_EDGE *
+mt_getEdgeById(const LWT_BE_TOPOLOGY* topo,
+               const LWT_ELEMID* ids, int* numelems, int fields)
+{
+  MEMTOPO *mt = MT(topo);
+  MT_SLOTS s = {0};
+  mt_store_query_ids(mt, &(mt->edges), ids, *numelems, &s);
+  MT_RETURN_LIMITED(mt, s, numelems, fields, 0, mt_edges_out);
+}
+
+static LWT_ISO_EDGE *
+mt_getEdgeWithinDistance2D(const LWT_BE_TOPOLOGY* topo,
+                           const LWPOINT* pt, double dist, int* numelems,
+                           int fields, int limit)
+{
+  MEMTOPO *mt = MT(topo);
+  MT_SLOTS c = {0}, s = {0};
+  GEOSGeometry *gpt = NULL;
+  const POINT2D *p;
+  GBOX box;
+  int i;
+
+  if ( lwpoint_is_empty(pt) ) {
+    *numelems = 0;
+    return NULL;
+  }
+  p = getPoint2d_cp(pt->point, 0);
+  dist = mt_sql_distance(dist);
+  box.xmin = p->x - dist; box.xmax = p->x + dist;
+  box.ymin = p->y - dist; box.ymax = p->y + dist;
+  mt_store_query(mt, &(mt->edges), &box, &c);
+
+  if ( ! dist && c.nslots )
+  {
+    initGEOS(lwnotice, lwgeom_geos_error);
+    gpt = LWGEOM2GEOS(lwpoint_as_lwgeom(pt), 0);
+    if ( ! gpt )
+    {
+      mt_slots_free(&c);
+      mt_error(mt, "Could not convert point to GEOS: %s", lwgeom_geos_errmsg);
+      *numelems = -1;
+      return NULL;
+    }
+  }
+
+  for ( i = 0; i < c.nslots; ++i )
+  {
+    const LWT_ISO_EDGE *e = &(MT_EDGE(mt, c.slots[i]));
+    if ( dist )
+    {
+      /* ST_DWithin */
+      if ( lwgeom_mindistance2d_tolerance(lwpoint_as_lwgeom(pt),
+                                          lwline_as_lwgeom(e->geom), dist) > dist )
+        continue;
+    }
+    else
+    {
+      /* ST_Within */
+      GEOSGeometry *gedge = LWGEOM2GEOS(lwline_as_lwgeom(e->geom), 0);
+      char within;
+      if ( ! gedge )
+      {
+        GEOSGeom_destroy(gpt);
+        mt_slots_free(&c);
+        mt_slots_free(&s);
+        mt_error(mt, "Could not convert edge geometry to GEOS: %s",
+                 lwgeom_geos_errmsg);
+        *numelems = -1;
+        return NULL;
+      }
+      within = GEOSWithin(gpt, gedge);
+      GEOSGeom_destroy(gedge);
+      if ( within == 2 )
+      {
+        GEOSGeom_destroy(gpt);
+        mt_slots_free(&c);
+        mt_slots_free(&s);
+        mt_error(mt, "GEOSWithin error: %s", lwgeom_geos_errmsg);
+        *numelems = -1;
+        return NULL;
+      }
+      if ( ! within ) continue;
+    }
+    mt_slots_add(&s, c.slots[i]);
+    if ( limit && s.nslots == abs(limit) ) break;
+  }
+  if ( gpt ) GEOSGeom_destroy(gpt);
+  mt_slots_free(&c);
+
+  MT_RETURN_LIMITED(mt, s, numelems, fields, limit, mt_edges_out);
+}
+
+static LWT_ELEMID
+mt_getNextEdgeId(const LWT_BE_TOPOLOGY* topo)
+{
+  return mt_next_id(MT(topo), LWT_ELEM_EDGE);
+}
+
+static int
+mt_insertEdges(const LWT_BE_TOPOLOGY* topo, LWT_ISO_EDGE* edges, int numelems)
+{
+  MEMTOPO *mt = MT(topo);
+  int i;
+
+  for ( i = 0; i < numelems; ++i )
+  {
+    LWT_ISO_EDGE *e = &(edges[i]);
+    int slot;
+
+    if ( e->edge_id == -1 )
+    {
+      e->edge_id = mt_next_id(mt, LWT_ELEM_EDGE);
+      if ( e->edge_id == -1 ) return -1;
+    }
+    else if ( mt_store_lookup(&(mt->edges), e->edge_id) != -1 )
+    {
+      mt_error(mt, "duplicate edge_id %" LWTFMT_ELEMID, e->edge_id);
+      return -1;
+    }
+
+    slot = mt_store_append(&(mt->edges));
+    MT_EDGE(mt, slot) = *e;
+    MT_EDGE(mt, slot).geom = e->geom ? lwline_clone_deep(e->geom) : NULL;
+    mt->edges.flags[slot] = MT_NEW;
+    mt_idmap_set(&(mt->edges.ids), e->edge_id, slot);
+    mt_edge_link(mt, slot);
+  }
+  mt_check_regrid(mt);
+
+  return numelems;
+}
+
+static int
+mt_updateEdges(const LWT_BE_TOPOLOGY* topo,
+               const LWT_ISO_EDGE* sel_edge, int sel_fields,
+               const LWT_ISO_EDGE* upd_edge, int upd_fields,
+               const LWT_ISO_EDGE* exc_edge, int exc_fields)
+{
+  MEMTOPO *mt = MT(topo);
+  MT_SLOTS c = {0};
+  int i, num = 0;
+
+  if ( upd_fields & LWT_COL_EDGE_EDGE_ID )
+  {
+    mt_error(mt, "updateEdges: edge_id cannot be updated in bulk mode");
+    return -1;
+  }
+
+  /* Select all first, as the backend would update a snapshot */
+  mt_edge_candidates(mt, sel_edge, sel_fields, &c);
+  for ( i = 0; i < c.nslots; ++i )
+  {
+    const LWT_ISO_EDGE *e = &(MT_EDGE(mt, c.slots[i]));
+    if ( sel_edge && ! mt_edge_match(e, sel_edge, sel_fields, 0) ) continue;
+    if ( exc_edge && ! mt_edge_match(e, exc_edge, exc_fields, 1) ) continue;
+    c.slots[num++] = c.slots[i];
+  }
+  for ( i = 0; i < num; ++i )
+    mt_edge_set(mt, c.slots[i], upd_edge, upd_fields);
+  mt_slots_free(&c);
+
+  return num;
+}
+
+static LWT_ISO_FACE *
+mt_getFaceById(const LWT_BE_TOPOLOGY* topo,
+               const LWT_ELEMID* ids, int* numelems, int fields)
+{
+  MEMTOPO *mt = MT(topo);
+  MT_SLOTS s = {0};
+  mt_store_query_ids(mt, &(mt->faces), ids, *numelems, &s);
+  MT_RETURN_LIMITED(mt, s, numelems, fields, 0, mt_faces_out);
+}
+
+typedef struct
+{
+  double area;
+  int slot;
+}
+MT_SCORED_SLOT;
+
+static int
+mt_cmp_scored_slot(const void *a, const void *b)
+{
+  const MT_SCORED_SLOT *sa = a;
+  const MT_SCORED_SLOT *sb = b;
+  if ( sa->area != sb->area ) return sa->area < sb->area ? -1 : 1;
+  return sa->slot < sb->slot ? -1 : sa->slot > sb->slot ? 1 : 0;
+}
+
+/* Smallest face (by mbr area) whose geometry contains the point */
+static LWT_ELEMID
+mt_getFaceContainingPoint(const LWT_BE_TOPOLOGY* topo, const LWPOINT* pt)
+{
+  MEMTOPO *mt = MT(topo);
+  MT_SLOTS c = {0};
+  MT_SCORED_SLOT *sorted;
+  const POINT2D *p;
+  LWT_ELEMID found = -1;
+  GBOX box;
+  int i;
+
+  if ( lwpoint_is_empty(pt) ) return -1;
+  p = getPoint2d_cp(pt->point, 0);
+  box.xmin = box.xmax = p->x;
+  box.ymin = box.ymax = p->y;
+  mt_store_query(mt, &(mt->faces), &box, &c);
+  if ( ! c.nslots ) return -1;
+
+  sorted = lwalloc(sizeof(MT_SCORED_SLOT) * c.nslots);
+  for ( i = 0; i < c.nslots; ++i )
+  {
+    const GBOX *mbr = MT_FACE(mt, c.slots[i]).mbr;
+    sorted[i].area = (mbr->xmax - mbr->xmin) * (mbr->ymax - mbr->ymin);
+    sorted[i].slot = c.slots[i];
+  }
+  qsort(sorted, c.nslots, sizeof(MT_SCORED_SLOT), mt_cmp_scored_slot);
+
+  for ( i = 0; i < c.nslots && found == -1; ++i )
+  {
+    LWT_ELEMID face_id = MT_FACE(mt, sorted[i].slot).face_id;
+    LWGEOM *fg = lwt_GetFaceGeometry(mt->topo, face_id);
+    LWCOLLECTION *col;
+    int j;
+
+    if ( ! fg )
+    {
+      lwfree(sorted);
+      mt_slots_free(&c);
+      mt_error(mt, "Could not get geometry of face %" LWTFMT_ELEMID, face_id);
+      return -2;
+    }
+    /* _ST_Contains */
+    if ( fg->type == POLYGONTYPE )
+    {
+      if ( lwpoly_contains_point((LWPOLY*)fg, p) == LW_INSIDE ) found = face_id;
+    }
+    else if ( (col = lwgeom_as_lwcollection(fg)) )
+    {
+      for ( j = 0; j < col->ngeoms; ++j )
+      {
+        if ( col->geoms[j]->type == POLYGONTYPE &&
+             lwpoly_contains_point((LWPOLY*)col->geoms[j], p) == LW_INSIDE )
+        {
+          found = face_id;
+          break;
+        }
+      }
+    }
+    lwgeom_free(fg);
+  }
+  lwfree(sorted);
+  mt_slots_free(&c);
+
+  return found;
+}
+
+/*
+ * TopoGeometry objects live in the real backend, whose relations
+ * cannot reference the primitives we did not write yet. Splits are
+ * queued until then (see mt_sync), the other callbacks write
+ * everything out first.
+ */
+
+static int mt_sync(MEMTOPO *mt);
+
+static void
+mt_queue_split(MEMTOPO *mt, int elemtype,
+  LWT_ELEMID split, LWT_ELEMID new1, LWT_ELEMID new2)
+{
+  MT_SPLIT *s;
+  if ( mt->nsplits == mt->maxsplits )
+  {
+    mt->maxsplits = mt->maxsplits ? mt->maxsplits * 2 : 64;
+    mt->splits = mt->splits ? lwrealloc(mt->splits, sizeof(MT_SPLIT) * mt->maxsplits)
+                            : lwalloc(sizeof(MT_SPLIT) * mt->maxsplits);
+  }
+  s = &(mt->splits[mt->nsplits++]);
+  s->elemtype = elemtype;
+  s->split = split;
+  s->new1 = new1;
+  s->new2 = new2;
+}
+
+static int
+mt_updateTopoGeomEdgeSplit(const LWT_BE_TOPOLOGY* topo,
+  LWT_ELEMID split_edge, LWT_ELEMID new_edge1, LWT_ELEMID new_edge2)
+{
+  MEMTOPO *mt = MT(topo);
+  const LWT_BE_IFACE *be = mt->parent->be_iface;
+  CHECKCB(be, updateTopoGeomEdgeSplit);
+  mt_queue_split(mt, LWT_ELEM_EDGE, split_edge, new_edge1, new_edge2);
+  return 1;
+}
+
+static int
+mt_deleteEdges(const LWT_BE_TOPOLOGY* topo,
+               const LWT_ISO_EDGE* sel_edge, int sel_fields)
+{
+  MEMTOPO *mt = MT(topo);
+  MT_SLOTS c = {0};
+  int i, num = 0;
+
+  mt_edge_candidates(mt, sel_edge, sel_fields, &c);
+  for ( i = 0; i < c.nslots; ++i )
+  {
+    int slot = c.slots[i];
+    LWT_ISO_EDGE *e = &(MT_EDGE(mt, slot));
+    if ( ! mt_edge_match(e, sel_edge, sel_fields, 0) ) continue;
+    mt_edge_unlink(mt, slot);
+    if ( e->geom ) lwline_free(e->geom);
+    e->geom = NULL;
+    mt->edges.flags[slot] |= MT_DELETED;
+    mt->edges.alive--;
+    num++;
+  }
+  mt_slots_free(&c);
+
+  return num;
+}
+
+static LWT_ISO_NODE *
+mt_getNodeWithinBox2D(const LWT_BE_TOPOLOGY* topo, const GBOX* box,
+                      int* numelems, int fields, int limit)
+{
+  MEMTOPO *mt = MT(topo);
+  MT_SLOTS s = {0};
+  mt_store_query(mt, &(mt->nodes), box, &s);
+  MT_RETURN_LIMITED(mt, s, numelems, fields, limit, mt_nodes_out);
+}
+
+static LWT_ISO_EDGE *
+mt_getEdgeWithinBox2D(const LWT_BE_TOPOLOGY* topo, const GBOX* box,
+                      int* numelems, int fields, int limit)
+{
+  MEMTOPO *mt = MT(topo);
+  MT_SLOTS s = {0};
+  mt_store_query(mt, &(mt->edges), box, &s);
+  MT_RETURN_LIMITED(mt, s, numelems, fields, limit, mt_edges_out);
+}
+
+static LWT_ISO_EDGE *
+mt_getEdgeByNode(const LWT_BE_TOPOLOGY* topo,
+                 const LWT_ELEMID* ids, int* numelems, int fields)
+{
+  MEMTOPO *mt = MT(topo);
+  MT_SLOTS s = {0};
+  mt_store_query_refs(mt, &(mt->edges), &(mt->edges_by_node), ids, *numelems, &s);
+  MT_RETURN_LIMITED(mt, s, numelems, fields, 0, mt_edges_out);
+}
+
+static int
+mt_updateNodes(const LWT_BE_TOPOLOGY* topo,
+               const LWT_ISO_NODE* sel_node, int sel_fields,
+               const LWT_ISO_NODE* upd_node, int upd_fields,
+               const LWT_ISO_NODE* exc_node, int exc_fields)
+{
+  MEMTOPO *mt = MT(topo);
+  MT_SLOTS c = {0};
+  int i, num = 0;
+
+  if ( upd_fields & LWT_COL_NODE_NODE_ID )
+  {
+    mt_error(mt, "updateNodes: node_id cannot be updated in bulk mode");
+    return -1;
+  }
+
+  mt_node_candidates(mt, sel_node, sel_fields, &c);
+  for ( i = 0; i < c.nslots; ++i )
+  {
+    const LWT_ISO_NODE *n = &(MT_NODE(mt, c.slots[i]));
+    if ( sel_node && ! mt_node_match(n, sel_node, sel_fields, 0) ) continue;
+    if ( exc_node && ! mt_node_match(n, exc_node, exc_fields, 1) ) continue;
+    c.slots[num++] = c.slots[i];
+  }
+  for ( i = 0; i < num; ++i )
+    mt_node_set(mt, c.slots[i], upd_node, upd_fields);
+  mt_slots_free(&c);
+
+  return num;
+}
+
+static int
+mt_updateTopoGeomFaceSplit(const LWT_BE_TOPOLOGY* topo,
+  LWT_ELEMID split_face, LWT_ELEMID new_face1, LWT_ELEMID new_face2)
+{
+  MEMTOPO *mt = MT(topo);
+  const LWT_BE_IFACE *be = mt->parent->be_iface;
+  CHECKCB(be, updateTopoGeomFaceSplit);
+  mt_queue_split(mt, LWT_ELEM_FACE, split_face, new_face1, new_face2);
+  return 1;
+}
+
+static int
+mt_insertFaces(const LWT_BE_TOPOLOGY* topo, LWT_ISO_FACE* faces, int numelems)
+{
+  MEMTOPO *mt = MT(topo);
+  int i;
+
+  for ( i = 0; i < numelems; ++i )
+  {
+    LWT_ISO_FACE *f = &(faces[i]);
+    int slot;
+
+    if ( f->face_id == -1 )
+    {
+      f->face_id = mt_next_id(mt, LWT_ELEM_FACE);
+      if ( f->face_id == -1 ) return -1;
+    }
+    else if ( mt_store_lookup(&(mt->faces), f->face_id) != -1 )
+    {
+      mt_error(mt, "duplicate face_id %" LWTFMT_ELEMID, f->face_id);
+      return -1;
+    }
+
+    slot = mt_store_append(&(mt->faces));
+    MT_FACE(mt, slot).face_id = f->face_id;
+    MT_FACE(mt, slot).mbr = f->mbr ? gbox_clone(f->mbr) : NULL;
+    mt->faces.flags[slot] = MT_NEW;
+    mt_idmap_set(&(mt->faces.ids), f->face_id, slot);
+    mt_face_link(mt, slot);
+  }
+  mt_check_regrid(mt);
+
+  return numelems;
+}
+
+static int
+mt_updateFacesById(const LWT_BE_TOPOLOGY* topo,
+                   const LWT_ISO_FACE* faces, int numfaces)
+{
+  MEMTOPO *mt = MT(topo);
+  int i, num = 0;
+
+  for ( i = 0; i < numfaces; ++i )
+  {
+    int slot = mt_store_lookup(&(mt->faces), faces[i].face_id);
+    LWT_ISO_FACE *f;
+    if ( slot == -1 ) continue;
+    f = &(MT_FACE(mt, slot));
+    mt_face_unlink(mt, slot);
+    if ( f->mbr ) lwfree(f->mbr);
+    f->mbr = faces[i].mbr ? gbox_clone(faces[i].mbr) : NULL;
+    mt_face_link(mt, slot);
+    mt->faces.dirty[slot] |= LWT_COL_FACE_MBR;
+    num++;
+  }
+
+  return num;
+}
+
+/* Walk the ring as the recursive query of the backend does */
+static LWT_ELEMID *
+mt_getRingEdges(const LWT_BE_TOPOLOGY* topo,
+                LWT_ELEMID edge, int *numedges, int limit)
+{
+  MEMTOPO *mt = MT(topo);
+  LWT_ELEMID *edges = NULL;
+  LWT_ELEMID signed_id = edge;
+  MT_IDMAP visited = {0};
+  int num = 0, max = 0;
+
+  if ( limit ) ++limit; /* so we know if we hit it */
+
+  while ( 1 )
+  {
+    int slot = mt_store_lookup(&(mt->edges), llabs(signed_id));
+    const LWT_ISO_EDGE *e;
+    if ( slot == -1 || mt_idmap_get(&visited, signed_id) != -1 ) break;
+    if ( limit && num == limit ) break;
+    mt_idmap_set(&visited, signed_id, num);
+    if ( num == max )
+    {
+      max = max ? max * 2 : 16;
+      edges = edges ? lwrealloc(edges, sizeof(LWT_ELEMID) * max)
+                    : lwalloc(sizeof(LWT_ELEMID) * max);
+    }
+    edges[num++] = signed_id;
+    e = &(MT_EDGE(mt, slot));
+    signed_id = signed_id < 0 ? e->next_right : e->next_left;
+  }
+  mt_idmap_free(&visited);
+
+  *numedges = num;
+  if ( limit && num == limit )
+  {
+    lwfree(edges);
+    mt_error(mt, "Max traversing limit hit: %d", limit-1);
+    *numedges = -1;
+    return NULL;
+  }
+  return edges;
+}
+
+static int
+mt_updateEdgesById(const LWT_BE_TOPOLOGY* topo,
+                   const LWT_ISO_EDGE* edges, int numedges, int upd_fields)
+{
+  MEMTOPO *mt = MT(topo);
+  int i, num = 0;
+
+  if ( ! upd_fields ) {
+    mt_error(mt, "updateEdgesById callback called with no update fields!");
+    return -1;
+  }
+
+  upd_fields &= ~(LWT_COL_EDGE_EDGE_ID);
+  for ( i = 0; i < numedges; ++i )
+  {
+    int slot = mt_store_lookup(&(mt->edges), edges[i].edge_id);
+    if ( slot == -1 ) continue;
+    mt_edge_set(mt, slot, &(edges[i]), upd_fields);
+    num++;
+  }
+
+  return num;
+}
+
+static LWT_ISO_EDGE *
+mt_getEdgeByFace(const LWT_BE_TOPOLOGY* topo,
+                 const LWT_ELEMID* ids, int* numelems, int fields,
+                 const GBOX *box)
+{
+  MEMTOPO *mt = MT(topo);
+  MT_SLOTS s = {0};
+  mt_store_query_refs(mt, &(mt->edges), &(mt->edges_by_face), ids, *numelems, &s);
+  if ( box )
+  {
+    GBOX qbox;
+    int i, num = 0;
+    mt_box_set(&qbox, box);
+    for ( i = 0; i < s.nslots; ++i )
+    {
+      int slot = s.slots[i];
+      if ( (mt->edges.flags[slot] & MT_NOBOX) ||
+           ! gbox_overlaps_2d(&(mt->edges.boxes[slot]), &qbox) ) continue;
+      s.slots[num++] = slot;
+    }
+    s.nslots = num;
+  }
+  MT_RETURN_LIMITED(mt, s, numelems, fields, 0, mt_edges_out);
+}
+
+static LWT_ISO_NODE *
+mt_getNodeByFace(const LWT_BE_TOPOLOGY* topo,
+                 const LWT_ELEMID* faces, int* numelems, int fields,
+                 const GBOX *box)
+{
+  MEMTOPO *mt = MT(topo);
+  MT_SLOTS s = {0};
+  mt_store_query_refs(mt, &(mt->nodes), &(mt->nodes_by_face), faces, *numelems, &s);
+  if ( box )
+  {
+    GBOX qbox;
+    int i, num = 0;
+    mt_box_set(&qbox, box);
+    for ( i = 0; i < s.nslots; ++i )
+    {
+      int slot = s.slots[i];
+      if ( (mt->nodes.flags[slot] & MT_NOBOX) ||
+           ! gbox_overlaps_2d(&(mt->nodes.boxes[slot]), &qbox) ) continue;
+      s.slots[num++] = slot;
+    }
+    s.nslots = num;
+  }
+  MT_RETURN_LIMITED(mt, s, numelems, fields, 0, mt_nodes_out);
+}
+
+static int
+mt_updateNodesById(const LWT_BE_TOPOLOGY* topo,
+                   const LWT_ISO_NODE* nodes, int numnodes, int upd_fields)
+{
+  MEMTOPO *mt = MT(topo);
+  int i, num = 0;
+
+  if ( ! upd_fields ) {
+    mt_error(mt, "updateNodesById callback called with no update fields!");
+    return -1;
+  }
+
+  upd_fields &= ~(LWT_COL_NODE_NODE_ID);
+  for ( i = 0; i < numnodes; ++i )
+  {
+    int slot = mt_store_lookup(&(mt->nodes), nodes[i].node_id);
+    if ( slot == -1 ) continue;
+    mt_node_set(mt, slot, &(nodes[i]), upd_fields);
+    num++;
+  }
+
+  return num;
+}
+
+static int
+mt_deleteFacesById(const LWT_BE_TOPOLOGY* topo,
+                   const LWT_ELEMID* ids, int numelems)
+{
+  MEMTOPO *mt = MT(topo);
+  int i, num = 0;
+
+  for ( i = 0; i < numelems; ++i )
+  {
+    int slot = mt_store_lookup(&(mt->faces), ids[i]);
+    LWT_ISO_FACE *f;
+    if ( slot == -1 ) continue;
+    f = &(MT_FACE(mt, slot));
+    mt_face_unlink(mt, slot);
+    if ( f->mbr ) lwfree(f->mbr);
+    f->mbr = NULL;
+    mt->faces.flags[slot] |= MT_DELETED;
+    mt->faces.alive--;
+    num++;
+  }
+
+  return num;
+}
+
+static int
+mt_topoGetSRID(const LWT_BE_TOPOLOGY* topo)
+{
+  return MT(topo)->parent->srid;
+}
+
+static double
+mt_topoGetPrecision(const LWT_BE_TOPOLOGY* topo)
+{
+  return MT(topo)->parent->precision;
+}
+
+static int
+mt_topoHasZ(const LWT_BE_TOPOLOGY* topo)
+{
+  return MT(topo)->parent->hasZ;
+}
+
+static int
+mt_deleteNodesById(const LWT_BE_TOPOLOGY* topo,
+                   const LWT_ELEMID* ids, int numelems)
+{
+  MEMTOPO *mt = MT(topo);
+  int i, num = 0;
+
+  for ( i = 0; i < numelems; ++i )
+  {
+    int slot = mt_store_lookup(&(mt->nodes), ids[i]);
+    LWT_ISO_NODE *n;
+    if ( slot == -1 ) continue;
+    n = &(MT_NODE(mt, slot));
+    mt_node_unlink(mt, slot);
+    if ( n->geom ) lwpoint_free(n->geom);
+    n->geom = NULL;
+    mt->nodes.flags[slot] |= MT_DELETED;
+    mt->nodes.alive--;
+    num++;
+  }
+
+  return num;
+}
+
+static int
+mt_checkTopoGeomRemEdge(const LWT_BE_TOPOLOGY* topo,
+  LWT_ELEMID rem_edge, LWT_ELEMID face_left, LWT_ELEMID face_right)
+{
+  MEMTOPO *mt = MT(topo);
+  const LWT_BE_IFACE *be = mt->parent->be_iface;
+  int ret;
+  CHECKCB(be, checkTopoGeomRemEdge);
+  if ( mt->nsplits && mt_sync(mt) != 0 ) return 0;
+  ret = be->cb->checkTopoGeomRemEdge(mt->parent->be_topo,
+                                     rem_edge, face_left, face_right);
+  if ( ! ret ) mt_parent_error(mt);
+  return ret;
+}
+
+static int
+mt_updateTopoGeomFaceHeal(const LWT_BE_TOPOLOGY* topo,
+  LWT_ELEMID face1, LWT_ELEMID face2, LWT_ELEMID newface)
+{
+  MEMTOPO *mt = MT(topo);
+  const LWT_BE_IFACE *be = mt->parent->be_iface;
+  int ret;
+  CHECKCB(be, updateTopoGeomFaceHeal);
+  /* newface may not be written yet */
+  if ( mt_sync(mt) != 0 ) return 0;
+  ret = be->cb->updateTopoGeomFaceHeal(mt->parent->be_topo,
+                                       face1, face2, newface);
+  if ( ! ret ) mt_parent_error(mt);
+  return ret;
+}
+
+static int
+mt_checkTopoGeomRemNode(const LWT_BE_TOPOLOGY* topo,
+  LWT_ELEMID rem_node, LWT_ELEMID e1, LWT_ELEMID e2)
+{
+  MEMTOPO *mt = MT(topo);
+  const LWT_BE_IFACE *be = mt->parent->be_iface;
+  int ret;
+  CHECKCB(be, checkTopoGeomRemNode);
+  if ( mt->nsplits && mt_sync(mt) != 0 ) return 0;
+  ret = be->cb->checkTopoGeomRemNode(mt->parent->be_topo, rem_node, e1, e2);
+  if ( ! ret ) mt_parent_error(mt);
+  return ret;
+}
+
+static int
+mt_updateTopoGeomEdgeHeal(const LWT_BE_TOPOLOGY* topo,
+  LWT_ELEMID edge1, LWT_ELEMID edge2, LWT_ELEMID newedge)
+{
+  MEMTOPO *mt = MT(topo);
+  const LWT_BE_IFACE *be = mt->parent->be_iface;
+  int ret;
+  CHECKCB(be, updateTopoGeomEdgeHeal);
+  /* newedge may not be written yet */
+  if ( mt_sync(mt) != 0 ) return 0;
+  ret = be->cb->updateTopoGeomEdgeHeal(mt->parent->be_topo,
+                                       edge1, edge2, newedge);
+  if ( ! ret ) mt_parent_error(mt);
+  return ret;
+}
+
+static LWT_ISO_FACE *
+mt_getFaceWithinBox2D(const LWT_BE_TOPOLOGY* topo, const GBOX* box,
+                      int* numelems, int fields, int limit)
+{
+  MEMTOPO *mt = MT(topo);
+  MT_SLOTS s = {0};
+  int i, num = 0;
+  mt_store_query(mt, &(mt->faces), box, &s);
+  /* The universe face has no mbr to overlap */
+  for ( i = 0; i < s.nslots; ++i )
+  {
+    if ( ! MT_FACE(mt, s.slots[i]).mbr ) continue;
+    s.slots[num++] = s.slots[i];
+  }
+  s.nslots = num;
+  MT_RETURN_LIMITED(mt, s, numelems, fields, limit, mt_faces_out);
+}
+
+static int
+mt_reserveElementIds(const LWT_BE_TOPOLOGY* topo, int elemtype,
+                     LWT_ELEMID* ids, int numelems)
+{
+  int i;
+  for ( i = 0; i < numelems; ++i )
+  {
+    ids[i] = mt_next_id(MT(topo), elemtype);
+    if ( ids[i] == -1 ) return 0;
+  }
+  return 1;
+}
+
+static const LWT_BE_CALLBACKS mt_callbacks = {
+    mt_lastErrorMessage,
+    NULL, /* createTopology */
+    NULL, /* loadTopologyByName */
+    mt_freeTopology,
+    mt_getNodeById,
+    mt_getNodeWithinDistance2D,
+    mt_insertNodes,
+    mt_getEdgeById,
+    mt_getEdgeWithinDistance2D,
+    mt_getNextEdgeId,
+    mt_insertEdges,
+    mt_updateEdges,
+    mt_getFaceById,
+    mt_getFaceContainingPoint,
+    mt_updateTopoGeomEdgeSplit,
+    mt_deleteEdges,
+    mt_getNodeWithinBox2D,
+    mt_getEdgeWithinBox2D,
+    mt_getEdgeByNode,
+    mt_updateNodes,
+    mt_updateTopoGeomFaceSplit,
+    mt_insertFaces,
+    mt_updateFacesById,
+    mt_getRingEdges,
+    mt_updateEdgesById,
+    mt_getEdgeByFace,
+    mt_getNodeByFace,
+    mt_updateNodesById,
+    mt_deleteFacesById,
+    mt_topoGetSRID,
+    mt_topoGetPrecision,
+    mt_topoHasZ,
+    mt_deleteNodesById,
+    mt_checkTopoGeomRemEdge,
+    mt_updateTopoGeomFaceHeal,
+    mt_checkTopoGeomRemNode,
+    mt_updateTopoGeomEdgeHeal,
+    mt_getFaceWithinBox2D,
+    mt_reserveElementIds
+};
+
+static void
+mt_free(MEMTOPO *mt)
+{
+  int i;
+
+  for ( i = 0; i < mt->nodes.num; ++i )
+    if ( MT_NODE(mt, i).geom ) lwpoint_free(MT_NODE(mt, i).geom);
+  for ( i = 0; i < mt->edges.num; ++i )
+    if ( MT_EDGE(mt, i).geom ) lwline_free(MT_EDGE(mt, i).geom);
+  for ( i = 0; i < mt->faces.num; ++i )
+    if ( MT_FACE(mt, i).mbr ) lwfree(MT_FACE(mt, i).mbr);
+  mt_store_free(&(mt->nodes));
+  mt_store_free(&(mt->edges));
+  mt_store_free(&(mt->faces));
+  mt_mmap_free(&(mt->edges_by_node));
+  mt_mmap_free(&(mt->edges_by_face));
+  mt_mmap_free(&(mt->nodes_by_face));
+  for ( i = 0; i < 3; ++i )
+    if ( mt->pools[i].ids ) lwfree(mt->pools[i].ids);
+  if ( mt->splits ) lwfree(mt->splits);
+  lwt_FreeBackendIface(mt->iface);
+  lwfree(mt);
+}
+
+/*********************************************************************
+ *
+ * Public API
+ *
+ ********************************************************************/
+
+LWT_TOPOLOGY *
+lwt_BeginBulkLoad(LWT_TOPOLOGY *topo)
+{
+  const LWT_BE_IFACE *be = topo->be_iface;
+  MEMTOPO *mt;
+  LWT_TOPOLOGY *bulk;
+  LWT_ISO_NODE *nodes;
+  LWT_ISO_EDGE *edges;
+  LWT_ISO_FACE *faces;
+  GBOX plane;
+  int num, i, slot;
+
+  CHECKCB(be, reserveElementIds);
+  CHECKCB(be, getNodeWithinBox2D);
+  CHECKCB(be, getEdgeWithinBox2D);
+  CHECKCB(be, getFaceWithinBox2D);
+
+  mt = lwalloc(sizeof(MEMTOPO));
+  memset(mt, 0, sizeof(MEMTOPO));
+  mt->parent = topo;
+  mt_store_init(&(mt->nodes), sizeof(LWT_ISO_NODE));
+  mt_store_init(&(mt->edges), sizeof(LWT_ISO_EDGE));
+  mt_store_init(&(mt->faces), sizeof(LWT_ISO_FACE));
+  mt->iface = lwt_CreateBackendIface((const LWT_BE_DATA *)mt);
+  lwt_BackendIfaceRegisterCallbacks(mt->iface, &mt_callbacks);
+
+  bulk = lwalloc(sizeof(LWT_TOPOLOGY));
+  bulk->be_iface = mt->iface;
+  bulk->be_topo = (LWT_BE_TOPOLOGY *)mt;
+  bulk->srid = topo->srid;
+  bulk->precision = topo->precision;
+  bulk->hasZ = topo->hasZ;
+  mt->topo = bulk;
+
+  /* Nodes and faces can only be queried by box, use the whole plane */
+  plane.flags = 0;
+  plane.xmin = plane.ymin = -FLT_MAX;
+  plane.xmax = plane.ymax = FLT_MAX;
+
+  /* The universe face has no mbr */
+  slot = mt_store_append(&(mt->faces));
+  MT_FACE(mt, slot).face_id = 0;
+  MT_FACE(mt, slot).mbr = NULL;
+  mt_idmap_set(&(mt->faces.ids), 0, slot);
+  mt_face_link(mt, slot);
+
+  faces = be->cb->getFaceWithinBox2D(topo->be_topo, &plane, &num,
+                                     LWT_COL_FACE_ALL, 0);
+  if ( num == -1 )
+  {
+    lwt_FreeTopology(bulk);
+    lwerror("Backend error: %s", be->cb->lastErrorMessage(be->data));
+    return NULL;
+  }
+  for ( i = 0; i < num; ++i )
+  {
+    slot = mt_store_append(&(mt->faces));
+    MT_FACE(mt, slot) = faces[i];
+    mt_idmap_set(&(mt->faces.ids), faces[i].face_id, slot);
+    mt_face_link(mt, slot);
+  }
+  if ( num ) lwfree(faces);
+
+  nodes = be->cb->getNodeWithinBox2D(topo->be_topo, &plane, &num,
+                                     LWT_COL_NODE_ALL, 0);
+  if ( num == -1 )
+  {
+    lwt_FreeTopology(bulk);
+    lwerror("Backend error: %s", be->cb->lastErrorMessage(be->data));
+    return NULL;
+  }
+  for ( i = 0; i < num; ++i )
+  {
+    slot = mt_store_append(&(mt->nodes));
+    MT_NODE(mt, slot) = nodes[i];
+    mt_idmap_set(&(mt->nodes.ids), nodes[i].node_id, slot);
+    mt_node_link(mt, slot);
+  }
+  if ( num ) lwfree(nodes);
+
+  edges = be->cb->getEdgeWithinBox2D(topo->be_topo, NULL, &num,
+                                     LWT_COL_EDGE_ALL, 0);
+  if ( num == -1 )
+  {
+    lwt_FreeTopology(bulk);
+    lwerror("Backend error: %s", be->cb->lastErrorMessage(be->data));
+    return NULL;
+  }
+  for ( i = 0; i < num; ++i )
+  {
+    slot = mt_store_append(&(mt->edges));
+    MT_EDGE(mt, slot) = edges[i];
+    mt_idmap_set(&(mt->edges.ids), edges[i].edge_id, slot);
+    mt_edge_link(mt, slot);
+  }
+  if ( num ) lwfree(edges);
+
+  LWDEBUGF(1, "Bulk load started with %d nodes, %d edges, %d faces",
+              mt->nodes.num, mt->edges.num, mt->faces.num);
+
+  mt_regrid(mt);
+
+  return bulk;
+}
+
+/*
+ * Write the primitives to the backend: inserts first, as updated
+ * elements may reference new ones, then updates and finally deletes,
+ * edges before the nodes and faces they referenced.
+ */
+static int
+mt_flush(MEMTOPO *mt)
+{
+  LWT_TOPOLOGY *topo = mt->parent;
+  const LWT_BE_IFACE *be = topo->be_iface;
+  int i, num, fields;
+  LWT_ISO_NODE *nodes;
+  LWT_ISO_EDGE *edges;
+  LWT_ISO_FACE *faces;
+  LWT_ELEMID *ids;
+  int batchsize = MT_FLUSH_BATCH;
+
+  CHECKCB(be, insertFaces);
+  CHECKCB(be, insertNodes);
+  CHECKCB(be, insertEdges);
+  CHECKCB(be, updateFacesById);
+  CHECKCB(be, updateNodesById);
+  CHECKCB(be, updateEdgesById);
+  CHECKCB(be, deleteEdges);
+  CHECKCB(be, deleteNodesById);
+  CHECKCB(be, deleteFacesById);
+
+  nodes = lwalloc(sizeof(LWT_ISO_NODE) * batchsize);
+  edges = lwalloc(sizeof(LWT_ISO_EDGE) * batchsize);
+  faces = lwalloc(sizeof(LWT_ISO_FACE) * batchsize);
+  ids = lwalloc(sizeof(LWT_ELEMID) * batchsize);
+
+#define MT_FLUSH_FAIL do { \
+    lwfree(nodes); lwfree(edges); lwfree(faces); lwfree(ids); \
+    lwerror("Backend error: %s", be->cb->lastErrorMessage(be->data)); \
+    return -1; \
+  } while (0)
+
+  /* Inserts, the geometries are shared with the store */
+
+  for ( num = 0, i = 0; i <= mt->faces.num; ++i )
+  {
+    if ( i < mt->faces.num )
+    {
+      if ( mt->faces.flags[i] != MT_NEW && mt->faces.flags[i] != (MT_NEW|MT_NOBOX) )
+        continue;
+      faces[num++] = MT_FACE(mt, i);
+      if ( num < batchsize ) continue;
+    }
+    if ( num && be->cb->insertFaces(topo->be_topo, faces, num) != num )
+      MT_FLUSH_FAIL;
+    num = 0;
+  }
+
+  for ( num = 0, i = 0; i <= mt->nodes.num; ++i )
+  {
+    if ( i < mt->nodes.num )
+    {
+      if ( ! (mt->nodes.flags[i] & MT_NEW) || (mt->nodes.flags[i] & MT_DELETED) )
+        continue;
+      nodes[num++] = MT_NODE(mt, i);
+      if ( num < batchsize ) continue;
+    }
+    if ( num && ! be->cb->insertNodes(topo->be_topo, nodes, num) )
+      MT_FLUSH_FAIL;
+    num = 0;
+  }
+
+  for ( num = 0, i = 0; i <= mt->edges.num; ++i )
+  {
+    if ( i < mt->edges.num )
+    {
+      if ( ! (mt->edges.flags[i] & MT_NEW) || (mt->edges.flags[i] & MT_DELETED) )
+        continue;
+      edges[num++] = MT_EDGE(mt, i);
+      if ( num < batchsize ) continue;
+    }
+    if ( num && be->cb->insertEdges(topo->be_topo, edges, num) != num )
+      MT_FLUSH_FAIL;
+    num = 0;
+  }
+
+  /* Updates of loaded primitives, with all fields changed in the batch */
+
+  for ( num = 0, i = 0; i <= mt->faces.num; ++i )
+  {
+    if ( i < mt->faces.num )
+    {
+      if ( (mt->faces.flags[i] & (MT_NEW|MT_DELETED)) || ! mt->faces.dirty[i] ||
+           ! MT_FACE(mt, i).mbr ) continue;
+      faces[num++] = MT_FACE(mt, i);
+      if ( num < batchsize ) continue;
+    }
+    if ( num && be->cb->updateFacesById(topo->be_topo, faces, num) == -1 )
+      MT_FLUSH_FAIL;
+    num = 0;
+  }
+
+  for ( num = 0, fields = 0, i = 0; i <= mt->nodes.num; ++i )
+  {
+    if ( i < mt->nodes.num )
+    {
+      if ( (mt->nodes.flags[i] & (MT_NEW|MT_DELETED)) || ! mt->nodes.dirty[i] )
+        continue;
+      nodes[num++] = MT_NODE(mt, i);
+      fields |= mt->nodes.dirty[i];
+      if ( num < batchsize ) continue;
+    }
+    if ( num && be->cb->updateNodesById(topo->be_topo, nodes, num, fields) == -1 )
+      MT_FLUSH_FAIL;
+    num = 0;
+    fields = 0;
+  }
+
+  for ( num = 0, fields = 0, i = 0; i <= mt->edges.num; ++i )
+  {
+    if ( i < mt->edges.num )
+    {
+      if ( (mt->edges.flags[i] & (MT_NEW|MT_DELETED)) || ! mt->edges.dirty[i] )
+        continue;
+      edges[num++] = MT_EDGE(mt, i);
+      fields |= mt->edges.dirty[i];
+      if ( num < batchsize ) continue;
+    }
+    if ( num && be->cb->updateEdgesById(topo->be_topo, edges, num, fields) == -1 )
+      MT_FLUSH_FAIL;
+    num = 0;
+    fields = 0;
+  }
+
+  /* Deletes of loaded primitives */
+
+  for ( i = 0; i < mt->edges.num; ++i )
+  {
+    LWT_ISO_EDGE sel;
+    if ( mt->edges.flags[i] != MT_DELETED &&
+         mt->edges.flags[i] != (MT_DELETED|MT_NOBOX) ) continue;
+    sel.edge_id = MT_EDGE(mt, i).edge_id;
+    if ( be->cb->deleteEdges(topo->be_topo, &sel, LWT_COL_EDGE_EDGE_ID) == -1 )
+      MT_FLUSH_FAIL;
+  }
+
+  for ( num = 0, i = 0; i <= mt->nodes.num; ++i )
+  {
+    if ( i < mt->nodes.num )
+    {
+      if ( (mt->nodes.flags[i] & (MT_NEW|MT_DELETED)) != MT_DELETED ) continue;
+      ids[num++] = MT_NODE(mt, i).node_id;
+      if ( num < batchsize ) continue;
+    }
+    if ( num && be->cb->deleteNodesById(topo->be_topo, ids, num) == -1 )
+      MT_FLUSH_FAIL;
+    num = 0;
+  }
+
+  for ( num = 0, i = 0; i <= mt->faces.num; ++i )
+  {
+    if ( i < mt->faces.num )
+    {
+      if ( (mt->faces.flags[i] & (MT_NEW|MT_DELETED)) != MT_DELETED ) continue;
+      ids[num++] = MT_FACE(mt, i).face_id;
+      if ( num < batchsize ) continue;
+    }
+    if ( num && be->cb->deleteFacesById(topo->be_topo, ids, num) == -1 )
+      MT_FLUSH_FAIL;
+    num = 0;
+  }
+
+#undef MT_FLUSH_FAIL
+
+  lwfree(nodes);
+  lwfree(edges);
+  lwfree(faces);
+  lwfree(ids);
+
+  return 0;
+}
+
+/* A primitive of the backend and the live ones it was split into */
+typedef struct
+{
+  LWT_ELEMID id;
+  int kept;
+  LWT_ELEMID *parts;
+  int nparts;
+  int maxparts;
+}
+MT_LINEAGE;
+
+static void
+mt_lineage_add(MT_LINEAGE *l, LWT_ELEMID id)
+{
+  if ( l->nparts == l->maxparts )
+  {
+    l->maxparts = l->maxparts ? l->maxparts * 2 : 4;
+    l->parts = l->parts ? lwrealloc(l->parts, sizeof(LWT_ELEMID) * l->maxparts)
+                        : lwalloc(sizeof(LWT_ELEMID) * l->maxparts);
+  }
+  l->parts[l->nparts++] = id;
+}
+
+static void
+mt_lineage_remove(MT_LINEAGE *l, LWT_ELEMID id)
+{
+  int i;
+  for ( i = 0; i < l->nparts; ++i )
+  {
+    if ( l->parts[i] != id ) continue;
+    memmove(l->parts + i, l->parts + i + 1, sizeof(LWT_ELEMID) * (l->nparts - i - 1));
+    l->nparts--;
+    return;
+  }
+}
+
+/*
+ * Report the queued splits of edges or faces to the backend, once
+ * the primitives are written but before the flags are reset.
+ *
+ * A new primitive is often split again before it is ever written, and
+ * the backend cannot reference it, so the chains of splits are first
+ * folded into what each primitive of the backend ended up split into.
+ * Its TopoGeometry references are then copied to all of those parts,
+ * and dropped if it is gone, which is what the chain of splits does
+ * when editing directly.
+ *
+ * Return 1 on success, 0 on error (see lasterr)
+ */
+static int
+mt_replay_splits(MEMTOPO *mt, int elemtype)
+{
+  const LWT_BE_IFACE *be = mt->parent->be_iface;
+  const MT_STORE *st = elemtype == LWT_ELEM_EDGE ? &(mt->edges) : &(mt->faces);
+  int (*update)(const LWT_BE_TOPOLOGY*, LWT_ELEMID, LWT_ELEMID, LWT_ELEMID) =
+    elemtype == LWT_ELEM_EDGE ? be->cb->updateTopoGeomEdgeSplit
+                              : be->cb->updateTopoGeomFaceSplit;
+  MT_IDMAP owner = {0}; /* primitive id to lineage */
+  MT_LINEAGE *lins = NULL;
+  int nlins = 0, maxlins = 0;
+  int i, j, ret = 1;
+
+  for ( i = 0; i < mt->nsplits; ++i )
+  {
+    const MT_SPLIT *s = &(mt->splits[i]);
+    MT_LINEAGE *l;
+    int li;
+
+    if ( s->elemtype != elemtype ) continue;
+
+    li = mt_idmap_get(&owner, s->split);
+    if ( li == -1 )
+    {
+      /* Only the primitives of the backend can have references */
+      int slot = mt_idmap_get(&(st->ids), s->split);
+      if ( slot == -1 || (st->flags[slot] & MT_NEW) ) continue;
+      if ( nlins == maxlins )
+      {
+        maxlins = maxlins ? maxlins * 2 : 64;
+        lins = lins ? lwrealloc(lins, sizeof(MT_LINEAGE) * maxlins)
+                    : lwalloc(sizeof(MT_LINEAGE) * maxlins);
+      }
+      li = nlins++;
+      memset(&(lins[li]), 0, sizeof(MT_LINEAGE));
+      lins[li].id = s->split;
+      lins[li].kept = 1;
+      mt_idmap_set(&owner, s->split, li);
+    }
+    l = &(lins[li]);
+
+    mt_lineage_add(l, s->new1);
+    mt_idmap_set(&owner, s->new1, li);
+    if ( s->new2 != -1 )
+    {
+      mt_lineage_add(l, s->new2);
+      mt_idmap_set(&owner, s->new2, li);
+      if ( s->split == l->id ) l->kept = 0;
+      else mt_lineage_remove(l, s->split);
+    }
+  }
+
+  for ( i = 0; i < nlins && ret; ++i )
+  {
+    MT_LINEAGE *l = &(lins[i]);
+    int n = 0;
+
+    for ( j = 0; j < l->nparts; ++j )
+    {
+      if ( mt_store_lookup(st, l->parts[j]) != -1 )
+        l->parts[n++] = l->parts[j];
+    }
+    if ( ! l->kept && n < 2 )
+    {
+      mt_error(mt, "Split %s %" LWTFMT_ELEMID " lost its parts",
+               elemtype == LWT_ELEM_EDGE ? "edge" : "face", l->id);
+      ret = 0;
+      break;
+    }
+
+    for ( j = 0; ret && j < n - (l->kept ? 0 : 2); ++j )
+      ret = update(mt->parent->be_topo, l->id, l->parts[j], -1);
+    if ( ret && ! l->kept )
+      ret = update(mt->parent->be_topo, l->id, l->parts[n-2], l->parts[n-1]);
+    if ( ! ret ) mt_parent_error(mt);
+  }
+
+  for ( i = 0; i < nlins; ++i )
+    if ( lins[i].parts ) lwfree(lins[i].parts);
+  if ( lins ) lwfree(lins);
+  mt_idmap_free(&owner);
+
+  return ret;
+}
+
+/* After a flush the backend has what the store has */
+static void
+mt_store_flushed(MT_STORE *st)
+{
+  int i;
+  for ( i = 0; i < st->num; ++i )
+  {
+    if ( st->flags[i] & MT_DELETED ) st->flags[i] |= MT_NEW;
+    else st->flags[i] &= ~MT_NEW;
+    st->dirty[i] = 0;
+  }
+}
+
+/*
+ * Write the primitives and report the queued splits to the backend.
+ * The session can go on afterwards.
+ *
+ * Return 0 on success, -1 on error
+ * (liblwgeom error handler will be invoked with error message)
+ */
+static int
+mt_sync(MEMTOPO *mt)
+{
+  LWDEBUGF(1, "Bulk load sync with %d queued splits", mt->nsplits);
+
+  if ( mt_flush(mt) != 0 ) return -1;
+
+  if ( ! mt_replay_splits(mt, LWT_ELEM_EDGE) ||
+       ! mt_replay_splits(mt, LWT_ELEM_FACE) )
+  {
+    lwerror("Backend error: %s", mt->lasterr);
+    return -1;
+  }
+  mt->nsplits = 0;
+
+  mt_store_flushed(&(mt->nodes));
+  mt_store_flushed(&(mt->edges));
+  mt_store_flushed(&(mt->faces));
+
+  return 0;
+}
+
+int
+lwt_EndBulkLoad(LWT_TOPOLOGY *bulk)
+{
+  MEMTOPO *mt;
+  int ret;
+
+  if ( bulk->be_iface->cb != &mt_callbacks )
+  {
+    lwerror("lwt_EndBulkLoad: not a bulk load topology");
+    return -1;
+  }
+  mt = MT(bulk->be_topo);
+
+  LWDEBUGF(1, "Bulk load ending with %d nodes, %d edges, %d faces",
+              mt->nodes.alive, mt->edges.alive, mt->faces.alive);
+
+  ret = mt_sync(mt);
+  lwt_FreeTopology(bulk);
+
+  return ret;
+}
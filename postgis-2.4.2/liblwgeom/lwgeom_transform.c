@@ -46,32 +46,149 @@ to_dec(POINT4D *pt)
 }
 
 /**
- * Transform given POINTARRAY
- * from inpj projection to outpj projection
+ * Transform the points of the given POINTARRAYs one at a time, as
+ * point4d_transform does.  Used to report the first failing point
+ * when the batched transform could not be applied cleanly.
  */
-int
-ptarray_transform(POINTARRAY *pa, projPJ inpj, projPJ outpj)
+static int
+ptarrays_transform_points(POINTARRAY **pas, int npas, projPJ inpj, projPJ outpj)
 {
-  int i;
+	int i, j;
 	POINT4D p;
 
-  for ( i = 0; i < pa->npoints; i++ )
-  {
-    getPoint4d_p(pa, i, &p);
-    if ( ! point4d_transform(&p, inpj, outpj) ) return LW_FAILURE;
-    ptarray_set_point4d(pa, i, &p);
-  }
+	for ( j = 0; j < npas; j++ )
+	{
+		POINTARRAY *pa = pas[j];
+		for ( i = 0; i < pa->npoints; i++ )
+		{
+			getPoint4d_p(pa, i, &p);
+			if ( ! point4d_transform(&p, inpj, outpj) ) return LW_FAILURE;
+			ptarray_set_point4d(pa, i, &p);
+		}
+	}
 
 	return LW_SUCCESS;
 }
 
+/**
+ * Transform all the given POINTARRAYs with a single pj_transform call.
+ * The coordinates are gathered into one x/y/z buffer, so that PROJ
+ * sets up the datum and grid-shift machinery once for the whole set.
+ * Should PROJ report an error, or leave any point unprojected, the
+ * arrays are transformed point by point instead so that the error
+ * (and the state of the arrays) matches point4d_transform.
+ */
+static int
+ptarrays_transform(POINTARRAY **pas, int npas, projPJ inpj, projPJ outpj)
+{
+	int i, j, k;
+	int npoints = 0;
+	int failed = LW_FALSE;
+	double *buf, *xyz;
+	POINT4D p;
+
+	for ( j = 0; j < npas; j++ )
+		npoints += pas[j]->npoints;
+
+	if ( npoints == 0 )
+		return LW_SUCCESS;
+
+	buf = lwalloc(sizeof(double) * 3 * npoints);
+
+	/* Gather, converting to radians up front for geographic input */
+	xyz = buf;
+	for ( j = 0; j < npas; j++ )
+	{
+		POINTARRAY *pa = pas[j];
+		int hasz = FLAGS_GET_Z(pa->flags);
+		int ndims = FLAGS_NDIMS(pa->flags);
+		const double *dp = (const double*)getPoint_internal(pa, 0);
+
+		for ( i = 0; i < pa->npoints; i++, dp += ndims, xyz += 3 )
+		{
+			xyz[0] = dp[0];
+			xyz[1] = dp[1];
+			xyz[2] = hasz ? dp[2] : 0.0;
+		}
+	}
+	if ( pj_is_latlong(inpj) )
+	{
+		for ( k = 0; k < npoints; k++ )
+		{
+			buf[3*k] *= M_PI/180.0;
+			buf[3*k+1] *= M_PI/180.0;
+		}
+	}
+
+	LWDEBUGF(4, "transforming %d points from '%s' to '%s'", npoints, pj_get_def(inpj,0), pj_get_def(outpj,0));
+
+	if ( pj_transform(inpj, outpj, npoints, 3, buf, buf+1, buf+2) != 0 ||
+	     *pj_get_errno_ref() != 0 )
+	{
+		failed = LW_TRUE;
+	}
+	else
+	{
+		/* Points PROJ could not project in a batch are left at HUGE_VAL */
+		for ( k = 0; k < npoints; k++ )
+		{
+			if ( buf[3*k] == HUGE_VAL || buf[3*k+1] == HUGE_VAL )
+			{
+				failed = LW_TRUE;
+				break;
+			}
+		}
+	}
+
+	if ( failed )
+	{
+		lwfree(buf);
+		return ptarrays_transform_points(pas, npas, inpj, outpj);
+	}
+
+	if ( pj_is_latlong(outpj) )
+	{
+		for ( k = 0; k < npoints; k++ )
+		{
+			buf[3*k] *= 180.0/M_PI;
+			buf[3*k+1] *= 180.0/M_PI;
+		}
+	}
+
+	/* Scatter back, leaving M untouched */
+	xyz = buf;
+	for ( j = 0; j < npas; j++ )
+	{
+		POINTARRAY *pa = pas[j];
+		for ( i = 0; i < pa->npoints; i++, xyz += 3 )
+		{
+			getPoint4d_p(pa, i, &p);
+			p.x = xyz[0];
+			p.y = xyz[1];
+			p.z = xyz[2];
+			ptarray_set_point4d(pa, i, &p);
+		}
+	}
+
+	lwfree(buf);
+	return LW_SUCCESS;
+}
 
 /**
- * Transform given SERIALIZED geometry
+ * Transform given POINTARRAY
  * from inpj projection to outpj projection
  */
 int
-lwgeom_transform(LWGEOM *geom, projPJ inpj, projPJ outpj)
+ptarray_transform(POINTARRAY *pa, projPJ inpj, projPJ outpj)
+{
+	return ptarrays_transform(&pa, 1, inpj, outpj);
+}
+
+/**
+ * Append the POINTARRAYs of geom to the pas list, growing it as needed.
+ */
+static int
+lwgeom_collect_ptarrays(LWGEOM *geom, POINTARRAY ***pas, int *npas, int *maxpas)
 {
 	int i;
 
@@ -87,7 +204,12 @@ lwgeom_transform(LWGEOM *geom, projPJ inpj, projPJ outpj)
 		case TRIANGLETYPE:
 		{
 			LWLINE *g = (LWLINE*)geom;
-      if ( ! ptarray_transform(g->points, inpj, outpj) ) return LW_FAILURE;
+			if ( *npas == *maxpas )
+			{
+				*maxpas *= 2;
+				*pas = lwrealloc(*pas, sizeof(POINTARRAY*) * *maxpas);
+			}
+			(*pas)[(*npas)++] = g->points;
 			break;
 		}
 		case POLYGONTYPE:
@@ -95,7 +217,12 @@ lwgeom_transform(LWGEOM *geom, projPJ inpj, projPJ outpj)
 			LWPOLY *g = (LWPOLY*)geom;
 			for ( i = 0; i < g->nrings; i++ )
 			{
-        if ( ! ptarray_transform(g->rings[i], inpj, outpj) ) return LW_FAILURE;
+				if ( *npas == *maxpas )
+				{
+					*maxpas *= 2;
+					*pas = lwrealloc(*pas, sizeof(POINTARRAY*) * *maxpas);
+				}
+				(*pas)[(*npas)++] = g->rings[i];
 			}
 			break;
 		}
@@ -113,7 +240,7 @@ lwgeom_transform(LWGEOM *geom, projPJ inpj, projPJ outpj)
 			LWCOLLECTION *g = (LWCOLLECTION*)geom;
 			for ( i = 0; i < g->ngeoms; i++ )
 			{
-				if ( ! lwgeom_transform(g->geoms[i], inpj, outpj) ) return LW_FAILURE;
+				if ( ! lwgeom_collect_ptarrays(g->geoms[i], pas, npas, maxpas) ) return LW_FAILURE;
 			}
 			break;
 		}
@@ -127,6 +254,32 @@ lwgeom_transform(LWGEOM *geom, projPJ inpj, projPJ outpj)
 	return LW_SUCCESS;
 }
 
+/**
+ * Transform given SERIALIZED geometry
+ * from inpj projection to outpj projection
+ */
+int
+lwgeom_transform(LWGEOM *geom, projPJ inpj, projPJ outpj)
+{
+	POINTARRAY **pas;
+	int npas = 0;
+	int maxpas = 8;
+	int rv;
+
+	/* No points to transform in an empty! */
+	if ( lwgeom_is_empty(geom) )
+		return LW_SUCCESS;
+
+	/* All the point arrays go through PROJ in one call */
+	pas = lwalloc(sizeof(POINTARRAY*) * maxpas);
+	rv = lwgeom_collect_ptarrays(geom, &pas, &npas, &maxpas);
+	if ( rv )
+		rv = ptarrays_transform(pas, npas, inpj, outpj);
+	lwfree(pas);
+
+	return rv;
+}
+
 int
 point4d_transform(POINT4D *pt, projPJ srcpj, projPJ dstpj)
 {
@@ -93,7 +93,17 @@ static inline void twkb_parse_state_advance(twkb_parse_state *s, size_t next)
 static inline int64_t twkb_parse_state_varint(twkb_parse_state *s)
 {
 	size_t size;
-	int64_t val = varint_s64_decode(s->pos, s->twkb_end, &size);
+	int64_t val;
+
+	/* Most deltas fit in a single byte, unzigzag those in place */
+	if ( s->pos < s->twkb_end && ! (*(s->pos) & 0x80) )
+	{
+		uint8_t b = *(s->pos);
+		s->pos++;
+		return (int64_t)(b >> 1) ^ -(int64_t)(b & 0x01);
+	}
+
+	val = varint_s64_decode(s->pos, s->twkb_end, &size);
 	twkb_parse_state_advance(s, size);
 	return val;
 }
@@ -175,6 +185,10 @@ static POINTARRAY* ptarray_from_twkb_state(twkb_parse_state *s, uint32_t npoints
 	uint32_t ndims = s->ndims;
 	int i;
 	double *dlist;
+	int64_t x, y, z, m;
+	double factor = s->factor;
+	double factor_z = s->factor_z;
+	double factor_m = s->factor_m;
 
 	LWDEBUG(2,"Entering ptarray_from_twkb_state");
 	LWDEBUGF(4,"Pointarray has %d points", npoints);
@@ -183,34 +197,43 @@ static POINTARRAY* ptarray_from_twkb_state(twkb_parse_state *s, uint32_t npoints
 	if( npoints == 0 )
 		return ptarray_construct_empty(s->has_z, s->has_m, 0);
 
+	/* Every point takes at least one byte per dimension */
+	if( (size_t)(s->twkb_end - s->pos) < (size_t)npoints * ndims )
+		lwerror("%s: TWKB structure does not match expected size!", __func__);
+
 	pa = ptarray_construct(s->has_z, s->has_m, npoints);
 	dlist = (double*)(pa->serialized_pointlist);
+
+	/* Keep the running totals in locals for the length of the array */
+	x = s->coords[0];
+	y = s->coords[1];
+	z = s->coords[2];
+	m = s->coords[3];
 	for( i = 0; i < npoints; i++ )
 	{
-		int j = 0;
 		/* X */
-		s->coords[j] += twkb_parse_state_varint(s);
-		dlist[ndims*i + j] = s->coords[j] / s->factor;
-		j++;
+		x += twkb_parse_state_varint(s);
+		*dlist++ = x / factor;
 		/* Y */
-		s->coords[j] += twkb_parse_state_varint(s);
-		dlist[ndims*i + j] = s->coords[j] / s->factor;
-		j++;
+		y += twkb_parse_state_varint(s);
+		*dlist++ = y / factor;
 		/* Z */
 		if ( s->has_z )
 		{
-			s->coords[j] += twkb_parse_state_varint(s);
-			dlist[ndims*i + j] = s->coords[j] / s->factor_z;
-			j++;
+			z += twkb_parse_state_varint(s);
+			*dlist++ = z / factor_z;
 		}
 		/* M */
 		if ( s->has_m )
 		{
-			s->coords[j] += twkb_parse_state_varint(s);
-			dlist[ndims*i + j] = s->coords[j] / s->factor_m;
-			j++;
+			m += twkb_parse_state_varint(s);
+			*dlist++ = m / factor_m;
 		}
 	}
+	s->coords[0] = x;
+	s->coords[1] = y;
+	s->coords[2] = z;
+	s->coords[3] = m;
 
 	return pa;
 }
@@ -598,7 +621,7 @@ LWGEOM* lwgeom_from_twkb_state(twkb_parse_state *s)
 			bbox.zmax = bbox.zmin + twkb_parse_state_double(s, s->factor_z);
 		}
 		/* M */
-		if ( s->has_z )
+		if ( s->has_m )
 		{
 			bbox.mmin = twkb_parse_state_double(s, s->factor_m);
 			bbox.mmax = bbox.mmin + twkb_parse_state_double(s, s->factor_m);
@@ -680,3 +703,123 @@ LWGEOM* lwgeom_from_twkb(uint8_t *twkb, size_t twkb_size, char check)
 	/* Read the rest of the geometry */
 	return lwgeom_from_twkb_state(&s);
 }
+
+
+/**
+* Read a TWKB multi-geometry or collection straight into an array of
+* its members, along with the ids if the TWKB carries an idlist. The
+* members of a multi-geometry share the parent header, collection
+* members each carry their own. Anything that is not a collection comes
+* back as an array of one.
+*/
+LWGEOM** lwgeom_from_twkb_batch(uint8_t *twkb, size_t twkb_size, char check, int64_t **idlist, int *ngeoms)
+{
+	int64_t coords[TWKB_IN_MAXCOORDS] = {0, 0, 0, 0};
+	twkb_parse_state s;
+	LWGEOM **geoms = NULL;
+	uint32_t memberlwtype = 0;
+	int i, n;
+
+	LWDEBUG(2,"Entering lwgeom_from_twkb_batch");
+
+	*ngeoms = 0;
+	if ( idlist )
+		*idlist = NULL;
+
+	/* Zero out the state */
+	memset(&s, 0, sizeof(twkb_parse_state));
+
+	/* Initialize the state appropriately */
+	s.twkb = s.pos = twkb;
+	s.twkb_end = twkb + twkb_size;
+	s.coords = coords;
+
+	/* Handle the check catch-all values */
+	if ( check & LW_PARSER_CHECK_NONE )
+		s.check = 0;
+	else
+		s.check = check;
+
+	/* Peek at the header to see what we are dealing with */
+	header_from_twkb_state(&s);
+
+	switch( s.lwtype )
+	{
+		case MULTIPOINTTYPE:
+			memberlwtype = POINTTYPE;
+			break;
+		case MULTILINETYPE:
+			memberlwtype = LINETYPE;
+			break;
+		case MULTIPOLYGONTYPE:
+			memberlwtype = POLYGONTYPE;
+			break;
+		case COLLECTIONTYPE:
+			break;
+		default:
+		{
+			/* Not a collection, so read it again in full */
+			s.pos = twkb;
+			geoms = lwalloc(sizeof(LWGEOM*));
+			geoms[0] = lwgeom_from_twkb_state(&s);
+			*ngeoms = 1;
+			return geoms;
+		}
+	}
+
+	if ( s.is_empty )
+		return NULL;
+
+	/* The collection box is of no use to us */
+	if ( s.has_bbox )
+	{
+		for ( i = 0; i < 2 * s.ndims; i++ )
+			twkb_parse_state_varint_skip(&s);
+	}
+
+	/* Read number of geometries, each takes a byte at least */
+	n = twkb_parse_state_uvarint(&s);
+	if ( n < 0 || (size_t)n > (size_t)(s.twkb_end - s.pos) )
+		lwerror("%s: TWKB structure does not match expected size!", __func__);
+
+	LWDEBUGF(4,"Number of geometries %d", n);
+
+	if ( s.has_idlist )
+	{
+		if ( idlist )
+		{
+			*idlist = lwalloc(sizeof(int64_t) * (n ? n : 1));
+			for ( i = 0; i < n; i++ )
+				(*idlist)[i] = twkb_parse_state_varint(&s);
+		}
+		else
+		{
+			for ( i = 0; i < n; i++ )
+				twkb_parse_state_varint_skip(&s);
+		}
+	}
+
+	if ( n == 0 )
+		return NULL;
+
+	geoms = lwalloc(sizeof(LWGEOM*) * n);
+	for ( i = 0; i < n; i++ )
+	{
+		switch( memberlwtype )
+		{
+			case POINTTYPE:
+				geoms[i] = lwpoint_as_lwgeom(lwpoint_from_twkb_state(&s));
+				break;
+			case LINETYPE:
+				geoms[i] = lwline_as_lwgeom(lwline_from_twkb_state(&s));
+				break;
+			case POLYGONTYPE:
+				geoms[i] = lwpoly_as_lwgeom(lwpoly_from_twkb_state(&s));
+				break;
+			default:
+				geoms[i] = lwgeom_from_twkb_state(&s);
+		}
+	}
+	*ngeoms = n;
+	return geoms;
+}
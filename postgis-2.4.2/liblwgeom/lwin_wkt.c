@@ -876,6 +876,608 @@ void wkt_parser_geometry_new(LWGEOM *geom, int srid)
 	global_parser_result.geom = geom;
 }
 
+/*
+* Hand-written reader for WKT and EWKT.
+*
+* Bulk loads are dominated by plain (multi)points, lines and polygons,
+* for which the flex scanner and bison tables cost more than building
+* the geometry. The reader below walks those directly, converts the
+* ordinates without going through atof() and sizes each point array
+* from a comma count before filling it. It calls the same constructors
+* as the grammar, so the checks and the resulting geometry are the same.
+*
+* Curves, unusual token spacing (eg. "POINT(1-2)") and every kind of
+* error are not handled here: the reader gives up and the caller runs
+* the bison parser over the input, which also reports the error
+* message and location.
+*/
+
+/* Nesting deeper than this is left to the grammar */
+#define WKT_FAST_MAX_DEPTH 32
+
+/* Largest integer mantissa converted exactly by a single multiply or divide */
+#define WKT_FAST_MAX_MANTISSA 9007199254740992ULL /* 2^53 */
+
+static const double wkt_fast_pow10[] =
+{
+	1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+#define WKT_FAST_ERROR() (global_parser_result.errcode != 0)
+
+static inline int wkt_fast_isspace(char c)
+{
+	return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static inline const char* wkt_fast_skip(const char *c)
+{
+	while ( wkt_fast_isspace(*c) ) c++;
+	return c;
+}
+
+static inline int wkt_fast_isalpha(char c)
+{
+	return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z');
+}
+
+/*
+* Case insensitive comparison of a word of len characters against an
+* upper case keyword.
+*/
+static int wkt_fast_word_is(const char *word, size_t len, const char *kw)
+{
+	size_t i;
+	for ( i = 0; i < len; i++ )
+	{
+		if ( ! kw[i] || toupper((unsigned char)word[i]) != kw[i] )
+			return LW_FALSE;
+	}
+	return kw[len] == '\0';
+}
+
+/*
+* Read a number with the syntax accepted by the lexer. The number must
+* be followed by a separator, otherwise the grammar is left to split it.
+* Mantissas of up to 2^53 with a decimal exponent of up to 22 are
+* converted with one correctly rounded operation, which gives the same
+* result as atof(). The rest goes through strtod().
+*/
+static int wkt_fast_double(const char **s, double *d)
+{
+	const char *start = *s;
+	const char *c = start;
+	uint64_t mantissa = 0;
+	int ndigits = 0;
+	int nsignificant = 0;
+	int exponent = 0;
+	int inexact = LW_FALSE;
+	int negative = LW_FALSE;
+
+	if ( *c == '-' )
+	{
+		negative = LW_TRUE;
+		c++;
+	}
+
+	for ( ; *c >= '0' && *c <= '9'; c++, ndigits++ )
+	{
+		if ( nsignificant < 19 )
+		{
+			mantissa = 10 * mantissa + (*c - '0');
+			if ( mantissa ) nsignificant++;
+		}
+		else
+		{
+			inexact = LW_TRUE;
+		}
+	}
+
+	if ( *c == '.' )
+	{
+		c++;
+		for ( ; *c >= '0' && *c <= '9'; c++, ndigits++ )
+		{
+			if ( nsignificant < 19 )
+			{
+				mantissa = 10 * mantissa + (*c - '0');
+				if ( mantissa ) nsignificant++;
+				exponent--;
+			}
+			else
+			{
+				inexact = LW_TRUE;
+			}
+		}
+	}
+
+	if ( ! ndigits )
+		return LW_FAILURE;
+
+	/* The lexer only takes an exponent right after a digit */
+	if ( (*c == 'e' || *c == 'E') && c[-1] != '.' )
+	{
+		int expsign = 1;
+		int expval = 0;
+		c++;
+		if ( *c == '-' || *c == '+' )
+		{
+			if ( *c == '-' ) expsign = -1;
+			c++;
+		}
+		if ( ! (*c >= '0' && *c <= '9') )
+			return LW_FAILURE;
+		for ( ; *c >= '0' && *c <= '9'; c++ )
+		{
+			if ( expval < 100000 )
+				expval = 10 * expval + (*c - '0');
+		}
+		exponent += expsign * expval;
+	}
+
+	if ( ! (wkt_fast_isspace(*c) || *c == ',' || *c == ')') )
+		return LW_FAILURE;
+
+	if ( ! inexact && mantissa <= WKT_FAST_MAX_MANTISSA && exponent >= -22 && exponent <= 22 )
+	{
+		*d = exponent < 0 ? (double)mantissa / wkt_fast_pow10[-exponent] : (double)mantissa * wkt_fast_pow10[exponent];
+		if ( negative )
+			*d = -*d;
+	}
+	else if ( mantissa == 0 && ! inexact )
+	{
+		*d = negative ? -0.0 : 0.0;
+	}
+	else
+	{
+		*d = strtod(start, NULL);
+	}
+
+	*s = c;
+	return LW_SUCCESS;
+}
+
+/*
+* Read the 2 to 4 ordinates of one coordinate, return how many were read
+* or zero on failure.
+*/
+static int wkt_fast_coordinate(const char **s, double *ord)
+{
+	const char *c = wkt_fast_skip(*s);
+	int n = 0;
+
+	while ( n < 4 )
+	{
+		if ( ! wkt_fast_double(&c, ord + n) )
+			return 0;
+		n++;
+		c = wkt_fast_skip(c);
+		if ( *c == ',' || *c == ')' )
+			break;
+	}
+
+	if ( n < 2 || ! (*c == ',' || *c == ')') )
+		return 0;
+
+	*s = c;
+	return n;
+}
+
+/*
+* Read "coord, coord, ... )", the opening bracket having been consumed.
+* The array is allocated once, sized from the number of commas before
+* the closing bracket, and filled in place. Mixed dimensionality is left
+* to the grammar to report.
+*/
+static POINTARRAY* wkt_fast_ptarray(const char **s)
+{
+	const char *c = *s;
+	uint32_t npoints = 1;
+	uint32_t i;
+	double ord[4];
+	double *dst;
+	int ndims;
+	POINTARRAY *pa;
+
+	for ( ; *c != ')'; c++ )
+	{
+		if ( *c == ',' )
+			npoints++;
+		else if ( *c == '\0' || *c == '(' )
+			return NULL;
+	}
+
+	c = *s;
+	ndims = wkt_fast_coordinate(&c, ord);
+	if ( ! ndims )
+		return NULL;
+
+	pa = ptarray_construct(ndims > 2, ndims > 3, npoints);
+	dst = (double*)(pa->serialized_pointlist);
+	memcpy(dst, ord, ndims * sizeof(double));
+	dst += ndims;
+
+	for ( i = 1; i < npoints; i++ )
+	{
+		/* The separator was checked by wkt_fast_coordinate */
+		c++;
+		if ( wkt_fast_coordinate(&c, ord) != ndims )
+		{
+			ptarray_free(pa);
+			return NULL;
+		}
+		memcpy(dst, ord, ndims * sizeof(double));
+		dst += ndims;
+	}
+
+	if ( *c != ')' )
+	{
+		ptarray_free(pa);
+		return NULL;
+	}
+
+	/* Consume the closing bracket */
+	*s = c + 1;
+	return pa;
+}
+
+/*
+* Read a type keyword and the optional dimensionality that follows it,
+* either as its own word ("POINT Z") or glued on ("POINTM"), as the
+* lexer accepts both. Curve types return LW_FAILURE.
+*/
+static int wkt_fast_tag(const char **s, int *type, char **dimensionality)
+{
+	static const struct
+	{
+		const char *name;
+		int type;
+	}
+	tags[] =
+	{
+		{ "POINT", POINTTYPE },
+		{ "LINESTRING", LINETYPE },
+		{ "POLYGON", POLYGONTYPE },
+		{ "MULTIPOINT", MULTIPOINTTYPE },
+		{ "MULTILINESTRING", MULTILINETYPE },
+		{ "MULTIPOLYGON", MULTIPOLYGONTYPE },
+		{ "GEOMETRYCOLLECTION", COLLECTIONTYPE },
+		{ "TRIANGLE", TRIANGLETYPE },
+		{ "TIN", TINTYPE },
+		{ "POLYHEDRALSURFACE", POLYHEDRALSURFACETYPE }
+	};
+	const char *c = wkt_fast_skip(*s);
+	const char *word = c;
+	size_t len, i;
+	int glued = LW_FALSE;
+
+	while ( wkt_fast_isalpha(*c) ) c++;
+	len = c - word;
+
+	*dimensionality = NULL;
+	for ( i = 0; i < sizeof(tags) / sizeof(tags[0]); i++ )
+	{
+		size_t n = strlen(tags[i].name);
+		if ( len < n || len > n + 2 || ! wkt_fast_word_is(word, n, tags[i].name) )
+			continue;
+		if ( len == n )
+			break;
+		if ( wkt_fast_word_is(word + n, len - n, "ZM") )
+			*dimensionality = "ZM";
+		else if ( wkt_fast_word_is(word + n, len - n, "Z") )
+			*dimensionality = "Z";
+		else if ( wkt_fast_word_is(word + n, len - n, "M") )
+			*dimensionality = "M";
+		else
+			continue;
+		glued = LW_TRUE;
+		break;
+	}
+	if ( i == sizeof(tags) / sizeof(tags[0]) )
+		return LW_FAILURE;
+	*type = tags[i].type;
+
+	if ( ! glued )
+	{
+		c = wkt_fast_skip(c);
+		word = c;
+		while ( wkt_fast_isalpha(*c) ) c++;
+		len = c - word;
+		if ( wkt_fast_word_is(word, len, "ZM") )
+			*dimensionality = "ZM";
+		else if ( wkt_fast_word_is(word, len, "Z") )
+			*dimensionality = "Z";
+		else if ( wkt_fast_word_is(word, len, "M") )
+			*dimensionality = "M";
+		else
+			c = word;
+	}
+
+	*s = c;
+	return LW_SUCCESS;
+}
+
+/*
+* Consume an EMPTY keyword if there is one.
+*/
+static int wkt_fast_empty(const char **s)
+{
+	const char *c = wkt_fast_skip(*s);
+	const char *word = c;
+
+	while ( wkt_fast_isalpha(*c) ) c++;
+	if ( ! wkt_fast_word_is(word, c - word, "EMPTY") )
+		return LW_FALSE;
+
+	*s = c;
+	return LW_TRUE;
+}
+
+/*
+* Consume the given punctuation character, after optional whitespace.
+*/
+static int wkt_fast_char(const char **s, char ch)
+{
+	const char *c = wkt_fast_skip(*s);
+	if ( *c != ch )
+		return LW_FALSE;
+	*s = c + 1;
+	return LW_TRUE;
+}
+
+/*
+* Read "ring, ring, ... )" into a polygon, the opening bracket having
+* been consumed. dimcheck is passed on to the ring closure check.
+*/
+static LWGEOM* wkt_fast_ring_list(const char **s, char dimcheck)
+{
+	LWGEOM *poly = NULL;
+	POINTARRAY *pa;
+
+	do
+	{
+		if ( ! wkt_fast_char(s, '(') || ! (pa = wkt_fast_ptarray(s)) )
+		{
+			if ( poly ) lwgeom_free(poly);
+			return NULL;
+		}
+		/* On failure these free the ring and the polygon */
+		if ( ! poly )
+			poly = wkt_parser_polygon_new(pa, dimcheck);
+		else
+			poly = wkt_parser_polygon_add_ring(poly, pa, dimcheck);
+		if ( WKT_FAST_ERROR() )
+			return NULL;
+	}
+	while ( wkt_fast_char(s, ',') );
+
+	if ( ! wkt_fast_char(s, ')') )
+	{
+		lwgeom_free(poly);
+		return NULL;
+	}
+	return poly;
+}
+
+/*
+* Read "(( coord, ... ))" into a triangle.
+*/
+static LWGEOM* wkt_fast_triangle(const char **s, char *dimensionality)
+{
+	POINTARRAY *pa;
+	LWGEOM *geom;
+
+	if ( ! wkt_fast_char(s, '(') || ! wkt_fast_char(s, '(') || ! (pa = wkt_fast_ptarray(s)) )
+		return NULL;
+	geom = wkt_parser_triangle_new(pa, dimensionality);
+	if ( WKT_FAST_ERROR() )
+		return NULL;
+	if ( ! wkt_fast_char(s, ')') )
+	{
+		lwgeom_free(geom);
+		return NULL;
+	}
+	return geom;
+}
+
+static LWGEOM* wkt_fast_geometry(const char **s, int depth);
+
+/*
+* Read one member of a collection of the given type, in the untagged
+* form the grammar expects for that type.
+*/
+static LWGEOM* wkt_fast_member(const char **s, int type, int depth)
+{
+	POINTARRAY *pa;
+	LWGEOM *geom;
+
+	switch ( type )
+	{
+		case MULTIPOINTTYPE:
+		{
+			double ord[4];
+			int ndims;
+
+			if ( wkt_fast_empty(s) )
+				return wkt_parser_point_new(NULL, NULL);
+			if ( wkt_fast_char(s, '(') )
+			{
+				if ( ! (pa = wkt_fast_ptarray(s)) )
+					return NULL;
+			}
+			else
+			{
+				if ( ! (ndims = wkt_fast_coordinate(s, ord)) )
+					return NULL;
+				pa = ptarray_construct(ndims > 2, ndims > 3, 1);
+				memcpy(pa->serialized_pointlist, ord, ndims * sizeof(double));
+			}
+			geom = wkt_parser_point_new(pa, NULL);
+			break;
+		}
+		case MULTILINETYPE:
+			if ( wkt_fast_empty(s) )
+				return wkt_parser_linestring_new(NULL, NULL);
+			if ( ! wkt_fast_char(s, '(') || ! (pa = wkt_fast_ptarray(s)) )
+				return NULL;
+			geom = wkt_parser_linestring_new(pa, NULL);
+			break;
+		case MULTIPOLYGONTYPE:
+			if ( wkt_fast_empty(s) )
+				return wkt_parser_polygon_finalize(NULL, NULL);
+			if ( ! wkt_fast_char(s, '(') )
+				return NULL;
+			return wkt_fast_ring_list(s, '2');
+		case POLYHEDRALSURFACETYPE:
+			if ( ! wkt_fast_char(s, '(') )
+				return NULL;
+			return wkt_fast_ring_list(s, 'Z');
+		case TINTYPE:
+			return wkt_fast_triangle(s, NULL);
+		default:
+			return wkt_fast_geometry(s, depth + 1);
+	}
+
+	if ( WKT_FAST_ERROR() )
+		return NULL;
+	return geom;
+}
+
+/*
+* Read "member, member, ... )" into a collection of the given type,
+* the opening bracket having been consumed.
+*/
+static LWGEOM* wkt_fast_collection(const char **s, int type, char *dimensionality, int depth)
+{
+	LWGEOM *col = NULL;
+	LWGEOM *geom;
+
+	do
+	{
+		if ( ! (geom = wkt_fast_member(s, type, depth)) )
+		{
+			if ( col ) lwgeom_free(col);
+			return NULL;
+		}
+		if ( ! col )
+			col = wkt_parser_collection_new(geom);
+		else
+			col = wkt_parser_collection_add_geom(col, geom);
+	}
+	while ( wkt_fast_char(s, ',') );
+
+	if ( ! wkt_fast_char(s, ')') )
+	{
+		lwgeom_free(col);
+		return NULL;
+	}
+
+	/* On failure this frees the collection */
+	col = wkt_parser_collection_finalize(type, col, dimensionality);
+	if ( WKT_FAST_ERROR() )
+		return NULL;
+	return col;
+}
+
+/*
+* Read one tagged geometry.
+*/
+static LWGEOM* wkt_fast_geometry(const char **s, int depth)
+{
+	char *dimensionality;
+	POINTARRAY *pa;
+	LWGEOM *geom;
+	int type;
+
+	if ( depth > WKT_FAST_MAX_DEPTH || ! wkt_fast_tag(s, &type, &dimensionality) )
+		return NULL;
+
+	switch ( type )
+	{
+		case POINTTYPE:
+		case LINETYPE:
+			pa = NULL;
+			if ( ! wkt_fast_empty(s) )
+			{
+				if ( ! wkt_fast_char(s, '(') || ! (pa = wkt_fast_ptarray(s)) )
+					return NULL;
+			}
+			if ( type == POINTTYPE )
+				geom = wkt_parser_point_new(pa, dimensionality);
+			else
+				geom = wkt_parser_linestring_new(pa, dimensionality);
+			break;
+		case TRIANGLETYPE:
+			if ( wkt_fast_empty(s) )
+				geom = wkt_parser_triangle_new(NULL, dimensionality);
+			else
+				return wkt_fast_triangle(s, dimensionality);
+			break;
+		case POLYGONTYPE:
+			geom = NULL;
+			if ( ! wkt_fast_empty(s) )
+			{
+				if ( ! wkt_fast_char(s, '(') || ! (geom = wkt_fast_ring_list(s, '2')) )
+					return NULL;
+			}
+			geom = wkt_parser_polygon_finalize(geom, dimensionality);
+			break;
+		default:
+			if ( wkt_fast_empty(s) )
+				geom = wkt_parser_collection_finalize(type, NULL, dimensionality);
+			else if ( wkt_fast_char(s, '(') )
+				return wkt_fast_collection(s, type, dimensionality, depth);
+			else
+				return NULL;
+			break;
+	}
+
+	if ( WKT_FAST_ERROR() )
+		return NULL;
+	return geom;
+}
+
+/**
+* Try to read the input without the grammar. On success the geometry is
+* set in global_parser_result and LW_SUCCESS is returned. LW_FAILURE means
+* the input is to be run through wkt_yyparse(); the global parser result
+* may then hold a partial error state and must be reset first.
+*/
+int wkt_fast_parse(const char *wktstr)
+{
+	const char *c = wkt_fast_skip(wktstr);
+	int srid = SRID_UNKNOWN;
+	LWGEOM *geom;
+
+	/* SRID=<int>; prefix */
+	if ( wkt_fast_word_is(c, 4, "SRID") && c[4] == '=' )
+	{
+		const char *digits = c + 5;
+		if ( *digits == '-' ) digits++;
+		if ( ! (*digits >= '0' && *digits <= '9') )
+			return LW_FAILURE;
+		srid = wkt_lexer_read_srid((char*)c);
+		while ( *digits >= '0' && *digits <= '9' ) digits++;
+		c = digits;
+		if ( ! wkt_fast_char(&c, ';') )
+			return LW_FAILURE;
+	}
+
+	geom = wkt_fast_geometry(&c, 0);
+	if ( ! geom )
+		return LW_FAILURE;
+
+	if ( *wkt_fast_skip(c) != '\0' )
+	{
+		lwgeom_free(geom);
+		return LW_FAILURE;
+	}
+
+	wkt_parser_geometry_new(geom, srid);
+	return LW_SUCCESS;
+}
+
 void lwgeom_parser_result_init(LWGEOM_PARSER_RESULT *parser_result)
 {
 	memset(parser_result, 0, sizeof(LWGEOM_PARSER_RESULT));
@@ -79,3 +79,7 @@ LWGEOM* wkt_parser_collection_add_geom(LWGEOM *col, LWGEOM *geom);
 LWGEOM* wkt_parser_collection_finalize(int lwtype, LWGEOM *col, char *dimensionality);
 void    wkt_parser_geometry_new(LWGEOM *geom, int srid);
 
+/*
+* Hand-written reader for the common cases, tried before the bison parser.
+*/
+int wkt_fast_parse(const char *wktstr);
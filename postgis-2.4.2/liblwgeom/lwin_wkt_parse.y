@@ -63,6 +63,18 @@ int lwgeom_parse_wkt(LWGEOM_PARSER_RESULT *parser_result, char *wktstr, int pars
 	/* Set the input text string, and parse checks. */
 	global_parser_result.wkinput = wktstr;
 	global_parser_result.parser_check_flags = parser_check_flags;
+
+	/* Most input is plain WKT/EWKT, try reading it without the grammar */
+	if ( wkt_fast_parse(wktstr) == LW_SUCCESS )
+	{
+		*parser_result = global_parser_result;
+		return LW_SUCCESS;
+	}
+
+	/* Otherwise start over with the bison parser, which also reports errors */
+	lwgeom_parser_result_init(&global_parser_result);
+	global_parser_result.wkinput = wktstr;
+	global_parser_result.parser_check_flags = parser_check_flags;
 		
 	wkt_lexer_init(wktstr); /* Lexer ready */
 	parse_rv = wkt_yyparse(); /* Run the parse */
@@ -33,121 +33,95 @@
 
 #include <string.h>
 #include "liblwgeom_internal.h"
-
-
-static size_t asgml2_point_size(const LWPOINT *point, const char *srs, int precision, const char *prefix);
-static char *asgml2_point(const LWPOINT *point, const char *srs, int precision, const char *prefix);
-static size_t asgml2_line_size(const LWLINE *line, const char *srs, int precision, const char *prefix);
-static char *asgml2_line(const LWLINE *line, const char *srs, int precision, const char *prefix);
-static size_t asgml2_poly_size(const LWPOLY *poly, const char *srs, int precision, const char *prefix);
-static char *asgml2_poly(const LWPOLY *poly, const char *srs, int precision, const char *prefix);
-static size_t asgml2_multi_size(const LWCOLLECTION *col, const char *srs, int precision, const char *prefix);
-static char *asgml2_multi(const LWCOLLECTION *col, const char *srs, int precision, const char *prefix);
-static size_t asgml2_collection_size(const LWCOLLECTION *col, const char *srs, int precision, const char *prefix);
-static char *asgml2_collection(const LWCOLLECTION *col, const char *srs, int precision, const char *prefix);
-static size_t pointArray_toGML2(POINTARRAY *pa, char *buf, int precision);
-
-static size_t asgml3_point_size(const LWPOINT *point, const char *srs, int precision, int opts, const char *prefix, const char *id);
-static char *asgml3_point(const LWPOINT *point, const char *srs, int precision, int opts, const char *prefix, const char *id);
-static size_t asgml3_line_size(const LWLINE *line, const char *srs, int precision, int opts, const char *prefix, const char *id);
-static char *asgml3_line(const LWLINE *line, const char *srs, int precision, int opts, const char *prefix, const char *id);
-static char *asgml3_circstring( const LWCIRCSTRING *circ, const char *srs, int precision, int opts, const char *prefix, const char *id );
-static size_t asgml3_poly_size(const LWPOLY *poly, const char *srs, int precision, int opts, const char *prefix, const char *id);
-static char *asgml3_poly(const LWPOLY *poly, const char *srs, int precision, int opts, int is_patch, const char *prefix, const char *id);
-static char * asgml3_curvepoly(const LWCURVEPOLY* poly, const char *srs, int precision, int opts, const char *prefix, const char *id);
-static size_t asgml3_triangle_size(const LWTRIANGLE *triangle, const char *srs, int precision, int opts, const char *prefix, const char *id);
-static char *asgml3_triangle(const LWTRIANGLE *triangle, const char *srs, int precision, int opts, const char *prefix, const char *id);
-static size_t asgml3_multi_size(const LWCOLLECTION *col, const char *srs, int precision, int opts, const char *prefix, const char *id);
-static char *asgml3_multi(const LWCOLLECTION *col, const char *srs, int precision, int opts, const char *prefix, const char *id);
-static char *asgml3_psurface(const LWPSURFACE *psur, const char *srs, int precision, int opts, const char *prefix, const char *id);
-static char *asgml3_tin(const LWTIN *tin, const char *srs, int precision, int opts, const char *prefix, const char *id);
-static size_t asgml3_collection_size(const LWCOLLECTION *col, const char *srs, int precision, int opts, const char *prefix, const char *id);
-static char *asgml3_collection(const LWCOLLECTION *col, const char *srs, int precision, int opts, const char *prefix, const char *id);
-static char *asgml3_compound(const LWCOMPOUND *col, const char *srs, int precision, int opts, const char *prefix, const char *id );
-static char *asgml3_multicurve( const LWMCURVE* cur, const char *srs, int precision, int opts, const char *prefix, const char *id );
-static char *asgml3_multisurface(const LWMSURFACE *sur, const char *srs, int precision, int opts, const char *prefix, const char *id);
-static size_t pointArray_toGML3(POINTARRAY *pa, char *buf, int precision, int opts);
-
-
-static size_t pointArray_GMLsize(POINTARRAY *pa, int precision);
+#include "stringbuffer.h"
+
+
+static void asgml2_point(stringbuffer_t *sb, const LWPOINT *point, const char *srs, int precision, const char *prefix);
+static void asgml2_line(stringbuffer_t *sb, const LWLINE *line, const char *srs, int precision, const char *prefix);
+static void asgml2_poly(stringbuffer_t *sb, const LWPOLY *poly, const char *srs, int precision, const char *prefix);
+static void asgml2_multi(stringbuffer_t *sb, const LWCOLLECTION *col, const char *srs, int precision, const char *prefix);
+static void asgml2_collection(stringbuffer_t *sb, const LWCOLLECTION *col, const char *srs, int precision, const char *prefix);
+static void pointArray_toGML2(stringbuffer_t *sb, POINTARRAY *pa, int precision);
+
+static void asgml3_point(stringbuffer_t *sb, const LWPOINT *point, const char *srs, int precision, int opts, const char *prefix, const char *id);
+static void asgml3_line(stringbuffer_t *sb, const LWLINE *line, const char *srs, int precision, int opts, const char *prefix, const char *id);
+static void asgml3_circstring(stringbuffer_t *sb, const LWCIRCSTRING *circ, const char *srs, int precision, int opts, const char *prefix, const char *id );
+static void asgml3_poly(stringbuffer_t *sb, const LWPOLY *poly, const char *srs, int precision, int opts, int is_patch, const char *prefix, const char *id);
+static void asgml3_curvepoly(stringbuffer_t *sb, const LWCURVEPOLY* poly, const char *srs, int precision, int opts, const char *prefix, const char *id);
+static void asgml3_triangle(stringbuffer_t *sb, const LWTRIANGLE *triangle, const char *srs, int precision, int opts, const char *prefix, const char *id);
+static void asgml3_multi(stringbuffer_t *sb, const LWCOLLECTION *col, const char *srs, int precision, int opts, const char *prefix, const char *id);
+static void asgml3_psurface(stringbuffer_t *sb, const LWPSURFACE *psur, const char *srs, int precision, int opts, const char *prefix, const char *id);
+static void asgml3_tin(stringbuffer_t *sb, const LWTIN *tin, const char *srs, int precision, int opts, const char *prefix, const char *id);
+static void asgml3_collection(stringbuffer_t *sb, const LWCOLLECTION *col, const char *srs, int precision, int opts, const char *prefix, const char *id);
+static void asgml3_compound(stringbuffer_t *sb, const LWCOMPOUND *col, const char *srs, int precision, int opts, const char *prefix, const char *id );
+static void asgml3_multicurve(stringbuffer_t *sb, const LWMCURVE* cur, const char *srs, int precision, int opts, const char *prefix, const char *id );
+static void asgml3_multisurface(stringbuffer_t *sb, const LWMSURFACE *sur, const char *srs, int precision, int opts, const char *prefix, const char *id);
+static void pointArray_toGML3(stringbuffer_t *sb, POINTARRAY *pa, int precision, int opts);
 
 static char *
 gbox_to_gml2(const GBOX *bbox, const char *srs, int precision, const char *prefix)
 {
-	int size;
+	stringbuffer_t sb;
 	POINT4D pt;
 	POINTARRAY *pa;
-	char *ptr, *output;
-	size_t prefixlen = strlen(prefix);
+	char *output;
+
+	stringbuffer_init(&sb);
 
 	if ( ! bbox )
 	{
-		size = ( sizeof("<Box>/") + (prefixlen*2) ) * 2;
-		if ( srs ) size += strlen(srs) + sizeof(" srsName=..");
-
-		ptr = output = lwalloc(size);
-
-		ptr += sprintf(ptr, "<%sBox", prefix);
-
-		if ( srs ) ptr += sprintf(ptr, " srsName=\"%s\"", srs);
-
-		ptr += sprintf(ptr, "/>");
-
-		return output;
+		stringbuffer_aprintf(&sb, "<%sBox", prefix);
+		if ( srs ) stringbuffer_aprintf(&sb, " srsName=\"%s\"", srs);
+		stringbuffer_append(&sb, "/>");
 	}
+	else
+	{
+		pa = ptarray_construct_empty(FLAGS_GET_Z(bbox->flags), 0, 2);
 
-	pa = ptarray_construct_empty(FLAGS_GET_Z(bbox->flags), 0, 2);
-
-	pt.x = bbox->xmin;
-	pt.y = bbox->ymin;
-	if (FLAGS_GET_Z(bbox->flags)) pt.z = bbox->zmin;
-	ptarray_append_point(pa, &pt, LW_TRUE);
-
-	pt.x = bbox->xmax;
-	pt.y = bbox->ymax;
-	if (FLAGS_GET_Z(bbox->flags)) pt.z = bbox->zmax;
-	ptarray_append_point(pa, &pt, LW_TRUE);
-
-	size = pointArray_GMLsize(pa, precision);
-	size += ( sizeof("<Box><coordinates>/") + (prefixlen*2) ) * 2;
-	if ( srs ) size += strlen(srs) + sizeof(" srsName=..");
+		pt.x = bbox->xmin;
+		pt.y = bbox->ymin;
+		if (FLAGS_GET_Z(bbox->flags)) pt.z = bbox->zmin;
+		ptarray_append_point(pa, &pt, LW_TRUE);
 
-	ptr = output = lwalloc(size);
+		pt.x = bbox->xmax;
+		pt.y = bbox->ymax;
+		if (FLAGS_GET_Z(bbox->flags)) pt.z = bbox->zmax;
+		ptarray_append_point(pa, &pt, LW_TRUE);
 
-	if ( srs ) ptr += sprintf(ptr, "<%sBox srsName=\"%s\">", prefix, srs);
-	else       ptr += sprintf(ptr, "<%sBox>", prefix);
+		if ( srs ) stringbuffer_aprintf(&sb, "<%sBox srsName=\"%s\">", prefix, srs);
+		else       stringbuffer_aprintf(&sb, "<%sBox>", prefix);
 
-	ptr += sprintf(ptr, "<%scoordinates>", prefix);
-	ptr += pointArray_toGML2(pa, ptr, precision);
-	ptr += sprintf(ptr, "</%scoordinates></%sBox>", prefix, prefix);
+		stringbuffer_aprintf(&sb, "<%scoordinates>", prefix);
+		pointArray_toGML2(&sb, pa, precision);
+		stringbuffer_aprintf(&sb, "</%scoordinates></%sBox>", prefix, prefix);
 
-	ptarray_free(pa);
+		ptarray_free(pa);
+	}
 
+	output = stringbuffer_getstringcopy(&sb);
+	stringbuffer_release(&sb);
 	return output;
 }
 
 static char *
 gbox_to_gml3(const GBOX *bbox, const char *srs, int precision, int opts, const char *prefix)
 {
-	int size;
+	stringbuffer_t sb;
 	POINT4D pt;
 	POINTARRAY *pa;
-	char *ptr, *output;
-	size_t prefixlen = strlen(prefix);
+	char *output;
 	int dimension = 2;
 
+	stringbuffer_init(&sb);
+
 	if ( ! bbox )
 	{
-		size = ( sizeof("<Envelope>/") + (prefixlen*2) ) * 2;
-		if ( srs ) size += strlen(srs) + sizeof(" srsName=..");
-
-		ptr = output = lwalloc(size);
-
-		ptr += sprintf(ptr, "<%sEnvelope", prefix);
-		if ( srs ) ptr += sprintf(ptr, " srsName=\"%s\"", srs);
-
-		ptr += sprintf(ptr, "/>");
+		stringbuffer_aprintf(&sb, "<%sEnvelope", prefix);
+		if ( srs ) stringbuffer_aprintf(&sb, " srsName=\"%s\"", srs);
+		stringbuffer_append(&sb, "/>");
 
+		output = stringbuffer_getstringcopy(&sb);
+		stringbuffer_release(&sb);
 		return output;
 	}
 
@@ -160,21 +134,14 @@ gbox_to_gml3(const GBOX *bbox, const char *srs, int precision, int opts, const c
 	if (FLAGS_GET_Z(bbox->flags)) pt.z = bbox->zmin;
 	ptarray_append_point(pa, &pt, LW_TRUE);
 
-	size = pointArray_GMLsize(pa, precision) * 2;
-	size += ( sizeof("<Envelope><lowerCorner><upperCorner>//") + (prefixlen*3) ) * 2;
-	if ( srs ) size += strlen(srs) + sizeof(" srsName=..");
-	if ( IS_DIMS(opts) ) size += sizeof(" srsDimension=. .");
-
-	ptr = output = lwalloc(size);
+	stringbuffer_aprintf(&sb, "<%sEnvelope", prefix);
+	if ( srs ) stringbuffer_aprintf(&sb, " srsName=\"%s\"", srs);
+	if ( IS_DIMS(opts) ) stringbuffer_aprintf(&sb, " srsDimension=\"%d\"", dimension);
+	stringbuffer_append(&sb, ">");
 
-	ptr += sprintf(ptr, "<%sEnvelope", prefix);
-	if ( srs ) ptr += sprintf(ptr, " srsName=\"%s\"", srs);
-	if ( IS_DIMS(opts) ) ptr += sprintf(ptr, " srsDimension=\"%d\"", dimension);
-	ptr += sprintf(ptr, ">");
-
-	ptr += sprintf(ptr, "<%slowerCorner>", prefix);
-	ptr += pointArray_toGML3(pa, ptr, precision, opts);
-	ptr += sprintf(ptr, "</%slowerCorner>", prefix);
+	stringbuffer_aprintf(&sb, "<%slowerCorner>", prefix);
+	pointArray_toGML3(&sb, pa, precision, opts);
+	stringbuffer_aprintf(&sb, "</%slowerCorner>", prefix);
 
 	ptarray_remove_point(pa, 0);
 	pt.x = bbox->xmax;
@@ -182,14 +149,16 @@ gbox_to_gml3(const GBOX *bbox, const char *srs, int precision, int opts, const c
 	if (FLAGS_GET_Z(bbox->flags)) pt.z = bbox->zmax;
 	ptarray_append_point(pa, &pt, LW_TRUE);
 
-	ptr += sprintf(ptr, "<%supperCorner>", prefix);
-	ptr += pointArray_toGML3(pa, ptr, precision, opts);
-	ptr += sprintf(ptr, "</%supperCorner>", prefix);
+	stringbuffer_aprintf(&sb, "<%supperCorner>", prefix);
+	pointArray_toGML3(&sb, pa, precision, opts);
+	stringbuffer_aprintf(&sb, "</%supperCorner>", prefix);
 
-	ptr += sprintf(ptr, "</%sEnvelope>", prefix);
+	stringbuffer_aprintf(&sb, "</%sEnvelope>", prefix);
 
 	ptarray_free(pa);
 
+	output = stringbuffer_getstringcopy(&sb);
+	stringbuffer_release(&sb);
 	return output;
 }
 
@@ -231,6 +200,8 @@ extern char *
 lwgeom_to_gml2(const LWGEOM *geom, const char *srs, int precision, const char* prefix)
 {
 	int type = geom->type;
+	stringbuffer_t sb;
+	char *output;
 
 	/* Return null for empty (#1377) */
 	if ( lwgeom_is_empty(geom) )
@@ -239,21 +210,13 @@ lwgeom_to_gml2(const LWGEOM *geom, const char *srs, int precision, const char* p
 	switch (type)
 	{
 	case POINTTYPE:
-		return asgml2_point((LWPOINT*)geom, srs, precision, prefix);
-
 	case LINETYPE:
-		return asgml2_line((LWLINE*)geom, srs, precision, prefix);
-
 	case POLYGONTYPE:
-		return asgml2_poly((LWPOLY*)geom, srs, precision, prefix);
-
 	case MULTIPOINTTYPE:
 	case MULTILINETYPE:
 	case MULTIPOLYGONTYPE:
-		return asgml2_multi((LWCOLLECTION*)geom, srs, precision, prefix);
-
 	case COLLECTIONTYPE:
-		return asgml2_collection((LWCOLLECTION*)geom, srs, precision, prefix);
+		break;
 
 	case TRIANGLETYPE:
 	case POLYHEDRALSURFACETYPE:
@@ -265,217 +228,111 @@ lwgeom_to_gml2(const LWGEOM *geom, const char *srs, int precision, const char* p
 		lwerror("lwgeom_to_gml2: '%s' geometry type not supported", lwtype_name(type));
 		return NULL;
 	}
-}
 
-static size_t
-asgml2_point_size(const LWPOINT *point, const char *srs, int precision, const char* prefix)
-{
-	int size;
-	size_t prefixlen = strlen(prefix);
+	/* Single pass, straight into the output buffer */
+	stringbuffer_init(&sb);
 
-	size = pointArray_GMLsize(point->point, precision);
-	size += ( sizeof("<point><coordinates>/") + (prefixlen*2) ) * 2;
-	if ( srs ) size += strlen(srs) + sizeof(" srsName=..");
-	return size;
-}
+	switch (type)
+	{
+	case POINTTYPE:
+		asgml2_point(&sb, (LWPOINT*)geom, srs, precision, prefix);
+		break;
 
-static size_t
-asgml2_point_buf(const LWPOINT *point, const char *srs, char *output, int precision, const char* prefix)
-{
-	char *ptr = output;
+	case LINETYPE:
+		asgml2_line(&sb, (LWLINE*)geom, srs, precision, prefix);
+		break;
 
-	ptr += sprintf(ptr, "<%sPoint", prefix);
-	if ( srs ) ptr += sprintf(ptr, " srsName=\"%s\"", srs);
-	if ( lwpoint_is_empty(point) )
-	{
-		ptr += sprintf(ptr, "/>");
-		return (ptr-output);
-	}
-	ptr += sprintf(ptr, ">");
-	ptr += sprintf(ptr, "<%scoordinates>", prefix);
-	ptr += pointArray_toGML2(point->point, ptr, precision);
-	ptr += sprintf(ptr, "</%scoordinates></%sPoint>", prefix, prefix);
+	case POLYGONTYPE:
+		asgml2_poly(&sb, (LWPOLY*)geom, srs, precision, prefix);
+		break;
 
-	return (ptr-output);
-}
+	case COLLECTIONTYPE:
+		asgml2_collection(&sb, (LWCOLLECTION*)geom, srs, precision, prefix);
+		break;
 
-static char *
-asgml2_point(const LWPOINT *point, const char *srs, int precision, const char *prefix)
-{
-	char *output;
-	int size;
+	default:
+		asgml2_multi(&sb, (LWCOLLECTION*)geom, srs, precision, prefix);
+	}
 
-	size = asgml2_point_size(point, srs, precision, prefix);
-	output = lwalloc(size);
-	asgml2_point_buf(point, srs, output, precision, prefix);
+	output = stringbuffer_getstringcopy(&sb);
+	stringbuffer_release(&sb);
 	return output;
 }
 
-static size_t
-asgml2_line_size(const LWLINE *line, const char *srs, int precision, const char *prefix)
+static void
+asgml2_point(stringbuffer_t *sb, const LWPOINT *point, const char *srs, int precision, const char* prefix)
 {
-	int size;
-	size_t prefixlen = strlen(prefix);
-
-	size = pointArray_GMLsize(line->points, precision);
-	size += ( sizeof("<linestring><coordinates>/") + (prefixlen*2) ) * 2;
-	if ( srs ) size += strlen(srs) + sizeof(" srsName=..");
-	return size;
+	stringbuffer_aprintf(sb, "<%sPoint", prefix);
+	if ( srs ) stringbuffer_aprintf(sb, " srsName=\"%s\"", srs);
+	if ( lwpoint_is_empty(point) )
+	{
+		stringbuffer_append(sb, "/>");
+		return;
+	}
+	stringbuffer_append(sb, ">");
+	stringbuffer_aprintf(sb, "<%scoordinates>", prefix);
+	pointArray_toGML2(sb, point->point, precision);
+	stringbuffer_aprintf(sb, "</%scoordinates></%sPoint>", prefix, prefix);
 }
 
-static size_t
-asgml2_line_buf(const LWLINE *line, const char *srs, char *output, int precision,
-                const char *prefix)
+static void
+asgml2_line(stringbuffer_t *sb, const LWLINE *line, const char *srs, int precision,
+            const char *prefix)
 {
-	char *ptr=output;
-
-	ptr += sprintf(ptr, "<%sLineString", prefix);
-	if ( srs ) ptr += sprintf(ptr, " srsName=\"%s\"", srs);
+	stringbuffer_aprintf(sb, "<%sLineString", prefix);
+	if ( srs ) stringbuffer_aprintf(sb, " srsName=\"%s\"", srs);
 
 	if ( lwline_is_empty(line) )
 	{
-		ptr += sprintf(ptr, "/>");
-		return (ptr-output);
+		stringbuffer_append(sb, "/>");
+		return;
 	}
-	ptr += sprintf(ptr, ">");
-
-	ptr += sprintf(ptr, "<%scoordinates>", prefix);
-	ptr += pointArray_toGML2(line->points, ptr, precision);
-	ptr += sprintf(ptr, "</%scoordinates></%sLineString>", prefix, prefix);
+	stringbuffer_append(sb, ">");
 
-	return (ptr-output);
+	stringbuffer_aprintf(sb, "<%scoordinates>", prefix);
+	pointArray_toGML2(sb, line->points, precision);
+	stringbuffer_aprintf(sb, "</%scoordinates></%sLineString>", prefix, prefix);
 }
 
-static char *
-asgml2_line(const LWLINE *line, const char *srs, int precision, const char *prefix)
-{
-	char *output;
-	int size;
-
-	size = asgml2_line_size(line, srs, precision, prefix);
-	output = lwalloc(size);
-	asgml2_line_buf(line, srs, output, precision, prefix);
-	return output;
-}
-
-static size_t
-asgml2_poly_size(const LWPOLY *poly, const char *srs, int precision, const char *prefix)
-{
-	size_t size;
-	int i;
-	size_t prefixlen = strlen(prefix);
-
-	size = sizeof("<polygon></polygon>") + prefixlen*2;
-	if ( srs ) size += strlen(srs) + sizeof(" srsName=..");
-	if ( lwpoly_is_empty(poly) )
-		return size;
-	size += ( sizeof("<outerboundaryis><linearring><coordinates>/") + ( prefixlen*3) ) * 2;
-	size += ( sizeof("<innerboundaryis><linearring><coordinates>/") + ( prefixlen*2) ) * 2 * poly->nrings;
-
-	for (i=0; i<poly->nrings; i++)
-		size += pointArray_GMLsize(poly->rings[i], precision);
-
-	return size;
-}
-
-static size_t
-asgml2_poly_buf(const LWPOLY *poly, const char *srs, char *output, int precision,
-                const char *prefix)
+static void
+asgml2_poly(stringbuffer_t *sb, const LWPOLY *poly, const char *srs, int precision,
+            const char *prefix)
 {
 	int i;
-	char *ptr=output;
 
-	ptr += sprintf(ptr, "<%sPolygon", prefix);
-	if ( srs ) ptr += sprintf(ptr, " srsName=\"%s\"", srs);
+	stringbuffer_aprintf(sb, "<%sPolygon", prefix);
+	if ( srs ) stringbuffer_aprintf(sb, " srsName=\"%s\"", srs);
 	if ( lwpoly_is_empty(poly) )
 	{
-		ptr += sprintf(ptr, "/>");
-		return (ptr-output);
+		stringbuffer_append(sb, "/>");
+		return;
 	}
-	ptr += sprintf(ptr, ">");
-	ptr += sprintf(ptr, "<%souterBoundaryIs><%sLinearRing><%scoordinates>",
-	               prefix, prefix, prefix);
-	ptr += pointArray_toGML2(poly->rings[0], ptr, precision);
-	ptr += sprintf(ptr, "</%scoordinates></%sLinearRing></%souterBoundaryIs>", prefix, prefix, prefix);
+	stringbuffer_append(sb, ">");
+	stringbuffer_aprintf(sb, "<%souterBoundaryIs><%sLinearRing><%scoordinates>",
+	                     prefix, prefix, prefix);
+	pointArray_toGML2(sb, poly->rings[0], precision);
+	stringbuffer_aprintf(sb, "</%scoordinates></%sLinearRing></%souterBoundaryIs>", prefix, prefix, prefix);
 	for (i=1; i<poly->nrings; i++)
 	{
-		ptr += sprintf(ptr, "<%sinnerBoundaryIs><%sLinearRing><%scoordinates>", prefix, prefix, prefix);
-		ptr += pointArray_toGML2(poly->rings[i], ptr, precision);
-		ptr += sprintf(ptr, "</%scoordinates></%sLinearRing></%sinnerBoundaryIs>", prefix, prefix, prefix);
+		stringbuffer_aprintf(sb, "<%sinnerBoundaryIs><%sLinearRing><%scoordinates>", prefix, prefix, prefix);
+		pointArray_toGML2(sb, poly->rings[i], precision);
+		stringbuffer_aprintf(sb, "</%scoordinates></%sLinearRing></%sinnerBoundaryIs>", prefix, prefix, prefix);
 	}
-	ptr += sprintf(ptr, "</%sPolygon>", prefix);
-
-	return (ptr-output);
-}
-
-static char *
-asgml2_poly(const LWPOLY *poly, const char *srs, int precision, const char *prefix)
-{
-	char *output;
-	int size;
-
-	size = asgml2_poly_size(poly, srs, precision, prefix);
-	output = lwalloc(size);
-	asgml2_poly_buf(poly, srs, output, precision, prefix);
-	return output;
-}
-
-/*
- * Compute max size required for GML version of this
- * inspected geometry. Will recurse when needed.
- * Don't call this with single-geoms inspected.
- */
-static size_t
-asgml2_multi_size(const LWCOLLECTION *col, const char *srs, int precision,
-                  const char *prefix)
-{
-	int i;
-	size_t size;
-	size_t prefixlen = strlen(prefix);
-	LWGEOM *subgeom;
-
-	/* the longest possible multi version */
-	size = sizeof("<MultiLineString></MultiLineString>");
-	size += 2*prefixlen;
-
-	if ( srs ) size += strlen(srs) + sizeof(" srsName=..");
-
-	for (i=0; i<col->ngeoms; i++)
-	{
-		subgeom = col->geoms[i];
-		if (subgeom->type == POINTTYPE)
-		{
-			size += ( sizeof("<pointMember>/") + prefixlen ) * 2;
-			size += asgml2_point_size((LWPOINT*)subgeom, 0, precision, prefix);
-		}
-		else if (subgeom->type == LINETYPE)
-		{
-			size += ( sizeof("<lineStringMember>/") + prefixlen ) * 2;
-			size += asgml2_line_size((LWLINE*)subgeom, 0, precision, prefix);
-		}
-		else if (subgeom->type == POLYGONTYPE)
-		{
-			size += ( sizeof("<polygonMember>/") + prefixlen ) * 2;
-			size += asgml2_poly_size((LWPOLY*)subgeom, 0, precision, prefix);
-		}
-	}
-
-	return size;
+	stringbuffer_aprintf(sb, "</%sPolygon>", prefix);
 }
 
 /*
  * Don't call this with single-geoms inspected!
  */
-static size_t
-asgml2_multi_buf(const LWCOLLECTION *col, const char *srs, char *output,
-                 int precision, const char *prefix)
+static void
+asgml2_multi(stringbuffer_t *sb, const LWCOLLECTION *col, const char *srs,
+             int precision, const char *prefix)
 {
 	int type = col->type;
-	char *ptr, *gmltype;
+	char *gmltype;
 	int i;
 	LWGEOM *subgeom;
 
-	ptr = output;
 	gmltype="";
 
 	if 	(type == MULTIPOINTTYPE)   gmltype = "MultiPoint";
@@ -483,246 +340,115 @@ asgml2_multi_buf(const LWCOLLECTION *col, const char *srs, char *output,
 	else if (type == MULTIPOLYGONTYPE) gmltype = "MultiPolygon";
 
 	/* Open outmost tag */
-	ptr += sprintf(ptr, "<%s%s", prefix, gmltype);
-	if ( srs ) ptr += sprintf(ptr, " srsName=\"%s\"", srs);
+	stringbuffer_aprintf(sb, "<%s%s", prefix, gmltype);
+	if ( srs ) stringbuffer_aprintf(sb, " srsName=\"%s\"", srs);
 
 	if (!col->ngeoms)
 	{
-		ptr += sprintf(ptr, "/>");
-		return (ptr-output);
+		stringbuffer_append(sb, "/>");
+		return;
 	}
-	ptr += sprintf(ptr, ">");
+	stringbuffer_append(sb, ">");
 
 	for (i=0; i<col->ngeoms; i++)
 	{
 		subgeom = col->geoms[i];
 		if (subgeom->type == POINTTYPE)
 		{
-			ptr += sprintf(ptr, "<%spointMember>", prefix);
-			ptr += asgml2_point_buf((LWPOINT*)subgeom, 0, ptr, precision, prefix);
-			ptr += sprintf(ptr, "</%spointMember>", prefix);
+			stringbuffer_aprintf(sb, "<%spointMember>", prefix);
+			asgml2_point(sb, (LWPOINT*)subgeom, 0, precision, prefix);
+			stringbuffer_aprintf(sb, "</%spointMember>", prefix);
 		}
 		else if (subgeom->type == LINETYPE)
 		{
-			ptr += sprintf(ptr, "<%slineStringMember>", prefix);
-			ptr += asgml2_line_buf((LWLINE*)subgeom, 0, ptr, precision, prefix);
-			ptr += sprintf(ptr, "</%slineStringMember>", prefix);
+			stringbuffer_aprintf(sb, "<%slineStringMember>", prefix);
+			asgml2_line(sb, (LWLINE*)subgeom, 0, precision, prefix);
+			stringbuffer_aprintf(sb, "</%slineStringMember>", prefix);
 		}
 		else if (subgeom->type == POLYGONTYPE)
 		{
-			ptr += sprintf(ptr, "<%spolygonMember>", prefix);
-			ptr += asgml2_poly_buf((LWPOLY*)subgeom, 0, ptr, precision, prefix);
-			ptr += sprintf(ptr, "</%spolygonMember>", prefix);
+			stringbuffer_aprintf(sb, "<%spolygonMember>", prefix);
+			asgml2_poly(sb, (LWPOLY*)subgeom, 0, precision, prefix);
+			stringbuffer_aprintf(sb, "</%spolygonMember>", prefix);
 		}
 	}
 
 	/* Close outmost tag */
-	ptr += sprintf(ptr, "</%s%s>", prefix, gmltype);
-
-	return (ptr-output);
-}
-
-/*
- * Don't call this with single-geoms inspected!
- */
-static char *
-asgml2_multi(const LWCOLLECTION *col, const char *srs, int precision,
-             const char *prefix)
-{
-	char *gml;
-	size_t size;
-
-	size = asgml2_multi_size(col, srs, precision, prefix);
-	gml = lwalloc(size);
-	asgml2_multi_buf(col, srs, gml, precision, prefix);
-	return gml;
-}
-
-
-/*
- * Don't call this with single-geoms!
- */
-static size_t
-asgml2_collection_size(const LWCOLLECTION *col, const char *srs, int precision,
-                       const char *prefix)
-{
-	int i;
-	size_t size;
-	size_t prefixlen = strlen(prefix);
-	LWGEOM *subgeom;
-
-	size = sizeof("<MultiGeometry></MultiGeometry>");
-	size += (prefixlen * 2);
-
-	if ( srs ) size += strlen(srs) + sizeof(" srsName=..");
-
-	for (i=0; i<col->ngeoms; i++)
-	{
-		subgeom = col->geoms[i];
-
-		size += ( sizeof("<geometryMember>/") + prefixlen ) * 2;
-		if ( subgeom->type == POINTTYPE)
-		{
-			size += asgml2_point_size((LWPOINT*)subgeom, 0, precision, prefix);
-		}
-		else if ( subgeom->type == LINETYPE)
-		{
-			size += asgml2_line_size((LWLINE*)subgeom, 0, precision, prefix);
-		}
-		else if ( subgeom->type == POLYGONTYPE)
-		{
-			size += asgml2_poly_size((LWPOLY*)subgeom, 0, precision, prefix);
-		}
-		else if ( lwgeom_is_collection(subgeom) )
-		{
-			size += asgml2_collection_size((LWCOLLECTION*)subgeom, 0, precision, prefix);
-		}
-		else
-			lwerror("asgml2_collection_size: Unable to process geometry type!");
-	}
-
-
-	return size;
+	stringbuffer_aprintf(sb, "</%s%s>", prefix, gmltype);
 }
 
 /*
  * Don't call this with single-geoms inspected!
  */
-static size_t
-asgml2_collection_buf(const LWCOLLECTION *col, const char *srs, char *output, int precision, const char *prefix)
+static void
+asgml2_collection(stringbuffer_t *sb, const LWCOLLECTION *col, const char *srs, int precision, const char *prefix)
 {
-	char *ptr;
 	int i;
 	LWGEOM *subgeom;
 
-	ptr = output;
-
 	/* Open outmost tag */
-	ptr += sprintf(ptr, "<%sMultiGeometry", prefix);
-	if ( srs ) ptr += sprintf(ptr, " srsName=\"%s\"", srs);
+	stringbuffer_aprintf(sb, "<%sMultiGeometry", prefix);
+	if ( srs ) stringbuffer_aprintf(sb, " srsName=\"%s\"", srs);
 
 	if (!col->ngeoms)
 	{
-		ptr += sprintf(ptr, "/>");
-		return (ptr-output);
+		stringbuffer_append(sb, "/>");
+		return;
 	}
-	ptr += sprintf(ptr, ">");
+	stringbuffer_append(sb, ">");
 
 	for (i=0; i<col->ngeoms; i++)
 	{
 		subgeom = col->geoms[i];
 
-		ptr += sprintf(ptr, "<%sgeometryMember>", prefix);
+		stringbuffer_aprintf(sb, "<%sgeometryMember>", prefix);
 		if (subgeom->type == POINTTYPE)
 		{
-			ptr += asgml2_point_buf((LWPOINT*)subgeom, 0, ptr, precision, prefix);
+			asgml2_point(sb, (LWPOINT*)subgeom, 0, precision, prefix);
 		}
 		else if (subgeom->type == LINETYPE)
 		{
-			ptr += asgml2_line_buf((LWLINE*)subgeom, 0, ptr, precision, prefix);
+			asgml2_line(sb, (LWLINE*)subgeom, 0, precision, prefix);
 		}
 		else if (subgeom->type == POLYGONTYPE)
 		{
-			ptr += asgml2_poly_buf((LWPOLY*)subgeom, 0, ptr, precision, prefix);
+			asgml2_poly(sb, (LWPOLY*)subgeom, 0, precision, prefix);
 		}
 		else if (lwgeom_is_collection(subgeom))
 		{
 			if (subgeom->type == COLLECTIONTYPE)
-				ptr += asgml2_collection_buf((LWCOLLECTION*)subgeom, 0, ptr, precision, prefix);
+				asgml2_collection(sb, (LWCOLLECTION*)subgeom, 0, precision, prefix);
 			else
-				ptr += asgml2_multi_buf((LWCOLLECTION*)subgeom, 0, ptr, precision, prefix);
+				asgml2_multi(sb, (LWCOLLECTION*)subgeom, 0, precision, prefix);
 		}
-		ptr += sprintf(ptr, "</%sgeometryMember>", prefix);
+		stringbuffer_aprintf(sb, "</%sgeometryMember>", prefix);
 	}
 
 	/* Close outmost tag */
-	ptr += sprintf(ptr, "</%sMultiGeometry>", prefix);
-
-	return (ptr-output);
-}
-
-/*
- * Don't call this with single-geoms inspected!
- */
-static char *
-asgml2_collection(const LWCOLLECTION *col, const char *srs, int precision,
-                  const char *prefix)
-{
-	char *gml;
-	size_t size;
-
-	size = asgml2_collection_size(col, srs, precision, prefix);
-	gml = lwalloc(size);
-	asgml2_collection_buf(col, srs, gml, precision, prefix);
-	return gml;
+	stringbuffer_aprintf(sb, "</%sMultiGeometry>", prefix);
 }
 
 
-static size_t
-pointArray_toGML2(POINTARRAY *pa, char *output, int precision)
+static void
+pointArray_toGML2(stringbuffer_t *sb, POINTARRAY *pa, int precision)
 {
 	int i;
-	char *ptr;
-	char x[OUT_MAX_DIGS_DOUBLE+OUT_MAX_DOUBLE_PRECISION+1];
-	char y[OUT_MAX_DIGS_DOUBLE+OUT_MAX_DOUBLE_PRECISION+1];
-	char z[OUT_MAX_DIGS_DOUBLE+OUT_MAX_DOUBLE_PRECISION+1];
+	int hasz = FLAGS_GET_Z(pa->flags);
 
-	ptr = output;
-
-	if ( ! FLAGS_GET_Z(pa->flags) )
+	for (i=0; i<pa->npoints; i++)
 	{
-		for (i=0; i<pa->npoints; i++)
-		{
-			const POINT2D *pt;
-			pt = getPoint2d_cp(pa, i);
-
-			if (fabs(pt->x) < OUT_MAX_DOUBLE)
-				sprintf(x, "%.*f", precision, pt->x);
-			else
-				sprintf(x, "%g", pt->x);
-			trim_trailing_zeros(x);
-
-			if (fabs(pt->y) < OUT_MAX_DOUBLE)
-				sprintf(y, "%.*f", precision, pt->y);
-			else
-				sprintf(y, "%g", pt->y);
-			trim_trailing_zeros(y);
+		const POINT3DZ *pt = (const POINT3DZ *) getPoint_internal(pa, i);
 
-			if ( i ) ptr += sprintf(ptr, " ");
-			ptr += sprintf(ptr, "%s,%s", x, y);
-		}
-	}
-	else
-	{
-		for (i=0; i<pa->npoints; i++)
+		if ( i ) stringbuffer_append(sb, " ");
+		stringbuffer_append_double(sb, pt->x, precision);
+		stringbuffer_append(sb, ",");
+		stringbuffer_append_double(sb, pt->y, precision);
+		if ( hasz )
 		{
-			const POINT3DZ *pt;
-			pt = getPoint3dz_cp(pa, i);
-
-			if (fabs(pt->x) < OUT_MAX_DOUBLE)
-				sprintf(x, "%.*f", precision, pt->x);
-			else
-				sprintf(x, "%g", pt->x);
-			trim_trailing_zeros(x);
-
-			if (fabs(pt->y) < OUT_MAX_DOUBLE)
-				sprintf(y, "%.*f", precision, pt->y);
-			else
-				sprintf(y, "%g", pt->y);
-			trim_trailing_zeros(y);
-
-			if (fabs(pt->z) < OUT_MAX_DOUBLE)
-				sprintf(z, "%.*f", precision, pt->z);
-			else
-				sprintf(z, "%g", pt->z);
-			trim_trailing_zeros(z);
-
-			if ( i ) ptr += sprintf(ptr, " ");
-			ptr += sprintf(ptr, "%s,%s,%s", x, y, z);
+			stringbuffer_append(sb, ",");
+			stringbuffer_append_double(sb, pt->z, precision);
 		}
 	}
-
-	return ptr-output;
 }
 
 
@@ -736,144 +462,108 @@ extern char *
 lwgeom_to_gml3(const LWGEOM *geom, const char *srs, int precision, int opts, const char *prefix, const char *id)
 {
 	int type = geom->type;
+	stringbuffer_t sb;
+	char *output;
 
 	/* Return null for empty (#1377) */
 	if ( lwgeom_is_empty(geom) )
 		return NULL;
 
+	stringbuffer_init(&sb);
+
 	switch (type)
 	{
 	case POINTTYPE:
-		return asgml3_point((LWPOINT*)geom, srs, precision, opts, prefix, id);
+		asgml3_point(&sb, (LWPOINT*)geom, srs, precision, opts, prefix, id);
+		break;
 
 	case LINETYPE:
-		return asgml3_line((LWLINE*)geom, srs, precision, opts, prefix, id);
+		asgml3_line(&sb, (LWLINE*)geom, srs, precision, opts, prefix, id);
+		break;
 
 	case CIRCSTRINGTYPE:
-		return asgml3_circstring((LWCIRCSTRING*)geom, srs, precision, opts, prefix, id );
+		asgml3_circstring(&sb, (LWCIRCSTRING*)geom, srs, precision, opts, prefix, id );
+		break;
 
 	case POLYGONTYPE:
-		return asgml3_poly((LWPOLY*)geom, srs, precision, opts, 0, prefix, id);
+		asgml3_poly(&sb, (LWPOLY*)geom, srs, precision, opts, 0, prefix, id);
+		break;
 
 	case CURVEPOLYTYPE:
-		return asgml3_curvepoly((LWCURVEPOLY*)geom, srs, precision, opts, prefix, id);
+		asgml3_curvepoly(&sb, (LWCURVEPOLY*)geom, srs, precision, opts, prefix, id);
+		break;
 
 	case TRIANGLETYPE:
-		return asgml3_triangle((LWTRIANGLE*)geom, srs, precision, opts, prefix, id);
+		asgml3_triangle(&sb, (LWTRIANGLE*)geom, srs, precision, opts, prefix, id);
+		break;
 
 	case MULTIPOINTTYPE:
 	case MULTILINETYPE:
 	case MULTIPOLYGONTYPE:
-		return asgml3_multi((LWCOLLECTION*)geom, srs, precision, opts, prefix, id);
+		asgml3_multi(&sb, (LWCOLLECTION*)geom, srs, precision, opts, prefix, id);
+		break;
 
 	case POLYHEDRALSURFACETYPE:
-		return asgml3_psurface((LWPSURFACE*)geom, srs, precision, opts, prefix, id);
+		asgml3_psurface(&sb, (LWPSURFACE*)geom, srs, precision, opts, prefix, id);
+		break;
 
 	case TINTYPE:
-		return asgml3_tin((LWTIN*)geom, srs, precision, opts, prefix, id);
+		asgml3_tin(&sb, (LWTIN*)geom, srs, precision, opts, prefix, id);
+		break;
 
 	case COLLECTIONTYPE:
-		return asgml3_collection((LWCOLLECTION*)geom, srs, precision, opts, prefix, id);
+		asgml3_collection(&sb, (LWCOLLECTION*)geom, srs, precision, opts, prefix, id);
+		break;
 
 	case COMPOUNDTYPE:
-		return asgml3_compound( (LWCOMPOUND*)geom, srs, precision, opts, prefix, id );
+		asgml3_compound(&sb, (LWCOMPOUND*)geom, srs, precision, opts, prefix, id );
+		break;
 
 	case MULTICURVETYPE:
-		return asgml3_multicurve( (LWMCURVE*)geom, srs, precision, opts, prefix, id );
+		asgml3_multicurve(&sb, (LWMCURVE*)geom, srs, precision, opts, prefix, id );
+		break;
 
 	case MULTISURFACETYPE:
-		return asgml3_multisurface( (LWMSURFACE*)geom, srs, precision, opts, prefix, id );
+		asgml3_multisurface(&sb, (LWMSURFACE*)geom, srs, precision, opts, prefix, id );
+		break;
 
 	default:
+		stringbuffer_release(&sb);
 		lwerror("lwgeom_to_gml3: '%s' geometry type not supported", lwtype_name(type));
 		return NULL;
 	}
-}
 
-static size_t
-asgml3_point_size(const LWPOINT *point, const char *srs, int precision, int opts, const char *prefix, const char *id)
-{
-	int size;
-	size_t prefixlen = strlen(prefix);
-
-	size = pointArray_GMLsize(point->point, precision);
-	size += ( sizeof("<point><pos>/") + (prefixlen*2) ) * 2;
-	if (srs) size += strlen(srs) + sizeof(" srsName=..");
-	if (id)  size += strlen(id) + strlen(prefix) + sizeof(" id=..");
-	if (IS_DIMS(opts)) size += sizeof(" srsDimension='x'");
-	return size;
+	output = stringbuffer_getstringcopy(&sb);
+	stringbuffer_release(&sb);
+	return output;
 }
 
-static size_t
-asgml3_point_buf(const LWPOINT *point, const char *srs, char *output, int precision, int opts, const char *prefix, const char *id)
+static void
+asgml3_point(stringbuffer_t *sb, const LWPOINT *point, const char *srs, int precision, int opts, const char *prefix, const char *id)
 {
-	char *ptr = output;
 	int dimension=2;
 
 	if (FLAGS_GET_Z(point->flags)) dimension = 3;
 
-	ptr += sprintf(ptr, "<%sPoint", prefix);
-	if ( srs ) ptr += sprintf(ptr, " srsName=\"%s\"", srs);
-	if ( id )  ptr += sprintf(ptr, " %sid=\"%s\"", prefix, id);
+	stringbuffer_aprintf(sb, "<%sPoint", prefix);
+	if ( srs ) stringbuffer_aprintf(sb, " srsName=\"%s\"", srs);
+	if ( id )  stringbuffer_aprintf(sb, " %sid=\"%s\"", prefix, id);
 	if ( lwpoint_is_empty(point) )
 	{
-		ptr += sprintf(ptr, "/>");
-		return (ptr-output);
+		stringbuffer_append(sb, "/>");
+		return;
 	}
 
-	ptr += sprintf(ptr, ">");
-	if (IS_DIMS(opts)) ptr += sprintf(ptr, "<%spos srsDimension=\"%d\">", prefix, dimension);
-	else         ptr += sprintf(ptr, "<%spos>", prefix);
-	ptr += pointArray_toGML3(point->point, ptr, precision, opts);
-	ptr += sprintf(ptr, "</%spos></%sPoint>", prefix, prefix);
-
-	return (ptr-output);
+	stringbuffer_append(sb, ">");
+	if (IS_DIMS(opts)) stringbuffer_aprintf(sb, "<%spos srsDimension=\"%d\">", prefix, dimension);
+	else         stringbuffer_aprintf(sb, "<%spos>", prefix);
+	pointArray_toGML3(sb, point->point, precision, opts);
+	stringbuffer_aprintf(sb, "</%spos></%sPoint>", prefix, prefix);
 }
 
-static char *
-asgml3_point(const LWPOINT *point, const char *srs, int precision, int opts, const char *prefix, const char *id)
+static void
+asgml3_line(stringbuffer_t *sb, const LWLINE *line, const char *srs, int precision, int opts, const char *prefix, const char *id)
 {
-	char *output;
-	int size;
-
-	size = asgml3_point_size(point, srs, precision, opts, prefix, id);
-	output = lwalloc(size);
-	asgml3_point_buf(point, srs, output, precision, opts, prefix, id);
-	return output;
-}
-
-
-static size_t
-asgml3_line_size(const LWLINE *line, const char *srs, int precision, int opts, const char *prefix, const char *id)
-{
-	int size;
-	size_t prefixlen = strlen(prefix);
-
-	size = pointArray_GMLsize(line->points, precision);
-	if ( opts & LW_GML_SHORTLINE )
-	{
-		size += (
-		            sizeof("<LineString><posList>/") +
-		            ( prefixlen * 2 )
-		        ) * 2;
-	}
-	else
-	{
-		size += (
-		            sizeof("<Curve><segments><LineStringSegment><posList>/") +
-		            ( prefixlen * 4 )
-		        ) * 2;
-	}
-	if (srs) size += strlen(srs) + sizeof(" srsName=..");
-	if (id)  size += strlen(id) + strlen(prefix) + sizeof(" id=..");
-	if (IS_DIMS(opts)) size += sizeof(" srsDimension='x'");
-	return size;
-}
-
-static size_t
-asgml3_line_buf(const LWLINE *line, const char *srs, char *output, int precision, int opts, const char *prefix, const char *id)
-{
-	char *ptr=output;
 	int dimension=2;
 	int shortline = ( opts & LW_GML_SHORTLINE );
 
@@ -881,87 +571,58 @@ asgml3_line_buf(const LWLINE *line, const char *srs, char *output, int precision
 
 	if ( shortline )
 	{
-		ptr += sprintf(ptr, "<%sLineString", prefix);
+		stringbuffer_aprintf(sb, "<%sLineString", prefix);
 	}
 	else
 	{
-		ptr += sprintf(ptr, "<%sCurve", prefix);
+		stringbuffer_aprintf(sb, "<%sCurve", prefix);
 	}
 
-	if (srs) ptr += sprintf(ptr, " srsName=\"%s\"", srs);
-	if (id)  ptr += sprintf(ptr, " %sid=\"%s\"", prefix, id);
+	if (srs) stringbuffer_aprintf(sb, " srsName=\"%s\"", srs);
+	if (id)  stringbuffer_aprintf(sb, " %sid=\"%s\"", prefix, id);
 
 	if ( lwline_is_empty(line) )
 	{
-		ptr += sprintf(ptr, "/>");
-		return (ptr-output);
+		stringbuffer_append(sb, "/>");
+		return;
 	}
-	ptr += sprintf(ptr, ">");
+	stringbuffer_append(sb, ">");
 
 	if ( ! shortline )
 	{
-		ptr += sprintf(ptr, "<%ssegments>", prefix);
-		ptr += sprintf(ptr, "<%sLineStringSegment>", prefix);
+		stringbuffer_aprintf(sb, "<%ssegments>", prefix);
+		stringbuffer_aprintf(sb, "<%sLineStringSegment>", prefix);
 	}
 
 	if (IS_DIMS(opts))
 	{
-		ptr += sprintf(ptr, "<%sposList srsDimension=\"%d\">",
-		               prefix, dimension);
+		stringbuffer_aprintf(sb, "<%sposList srsDimension=\"%d\">",
+		                     prefix, dimension);
 	}
 	else
 	{
-		ptr += sprintf(ptr, "<%sposList>", prefix);
+		stringbuffer_aprintf(sb, "<%sposList>", prefix);
 	}
 
-	ptr += pointArray_toGML3(line->points, ptr, precision, opts);
+	pointArray_toGML3(sb, line->points, precision, opts);
 
-	ptr += sprintf(ptr, "</%sposList>", prefix);
+	stringbuffer_aprintf(sb, "</%sposList>", prefix);
 
 	if ( shortline )
 	{
-		ptr += sprintf(ptr, "</%sLineString>", prefix);
+		stringbuffer_aprintf(sb, "</%sLineString>", prefix);
 	}
 	else
 	{
-		ptr += sprintf(ptr, "</%sLineStringSegment>", prefix);
-		ptr += sprintf(ptr, "</%ssegments>", prefix);
-		ptr += sprintf(ptr, "</%sCurve>", prefix);
+		stringbuffer_aprintf(sb, "</%sLineStringSegment>", prefix);
+		stringbuffer_aprintf(sb, "</%ssegments>", prefix);
+		stringbuffer_aprintf(sb, "</%sCurve>", prefix);
 	}
-
-	return (ptr-output);
 }
 
-static char *
-asgml3_line(const LWLINE *line, const char *srs, int precision, int opts, const char *prefix, const char *id)
+static void
+asgml3_circstring(stringbuffer_t *sb, const LWCIRCSTRING *circ, const char *srs, int precision, int opts, const char *prefix, const char *id)
 {
-	char *output;
-	int size;
-
-	size = asgml3_line_size(line, srs, precision, opts, prefix, id);
-	output = lwalloc(size);
-	asgml3_line_buf(line, srs, output, precision, opts, prefix, id);
-	return output;
-}
-
-
-static size_t
-asgml3_circstring_size(const LWCIRCSTRING *circ, const char *srs, int precision, int opts, const char *prefix, const char *id)
-{
-	int size = pointArray_GMLsize( circ->points, precision );
-	size_t prefixlen = strlen(prefix);
-	size += 2 * ( sizeof( "<Curve><segments>/" ) + 2 * prefixlen );
-	size += 2 * ( sizeof( "<ArcString><posList>/" ) + 2 * prefixlen );
-	if (srs) size += strlen(srs) + sizeof(" srsName=..");
-	if (id)  size += strlen(id) + strlen(prefix) + sizeof(" id=..");
-	if (IS_DIMS(opts)) size += sizeof(" srsDimension='x'");
-	return size;
-}
-
-static size_t
-asgml3_circstring_buf(const LWCIRCSTRING *circ, const char *srs, char *output, int precision, int opts, const char *prefix, const char *id)
-{
-	char* ptr = output;
 	int dimension=2;
 
 	if (FLAGS_GET_Z(circ->flags))
@@ -969,177 +630,85 @@ asgml3_circstring_buf(const LWCIRCSTRING *circ, const char *srs, char *output, i
 		dimension = 3;
 	}
 
-	ptr += sprintf(ptr, "<%sCurve", prefix);
+	stringbuffer_aprintf(sb, "<%sCurve", prefix);
 	if (srs)
 	{
-		ptr += sprintf(ptr, " srsName=\"%s\"", srs);
+		stringbuffer_aprintf(sb, " srsName=\"%s\"", srs);
 	}
 	if (id)
 	{
-		ptr += sprintf(ptr, " %sid=\"%s\"", prefix, id);
+		stringbuffer_aprintf(sb, " %sid=\"%s\"", prefix, id);
 	}
-	ptr += sprintf(ptr, ">");
-	ptr += sprintf(ptr, "<%ssegments>", prefix);
-	ptr += sprintf(ptr, "<%sArcString>", prefix);
-	ptr += sprintf(ptr, "<%sposList", prefix);
+	stringbuffer_append(sb, ">");
+	stringbuffer_aprintf(sb, "<%ssegments>", prefix);
+	stringbuffer_aprintf(sb, "<%sArcString>", prefix);
+	stringbuffer_aprintf(sb, "<%sposList", prefix);
 
 	if (IS_DIMS(opts))
 	{
-		ptr += sprintf(ptr, " srsDimension=\"%d\"", dimension);
+		stringbuffer_aprintf(sb, " srsDimension=\"%d\"", dimension);
 	}
-	ptr += sprintf(ptr, ">");
-
-	ptr += pointArray_toGML3(circ->points, ptr, precision, opts);
-	ptr += sprintf(ptr, "</%sposList>", prefix);
-	ptr += sprintf(ptr, "</%sArcString>", prefix);
-	ptr += sprintf(ptr, "</%ssegments>", prefix);
-	ptr += sprintf(ptr, "</%sCurve>", prefix);
-	return (ptr-output);
-}
+	stringbuffer_append(sb, ">");
 
-static char *
-asgml3_circstring( const LWCIRCSTRING *circ, const char *srs, int precision, int opts, const char *prefix, const char *id )
-{
-	char *output;
-	int size;
-
-	size = asgml3_circstring_size(circ, srs, precision, opts, prefix, id);
-	output = lwalloc( size );
-	asgml3_circstring_buf(circ, srs, output, precision, opts, prefix, id);
-	return output;
+	pointArray_toGML3(sb, circ->points, precision, opts);
+	stringbuffer_aprintf(sb, "</%sposList>", prefix);
+	stringbuffer_aprintf(sb, "</%sArcString>", prefix);
+	stringbuffer_aprintf(sb, "</%ssegments>", prefix);
+	stringbuffer_aprintf(sb, "</%sCurve>", prefix);
 }
 
-
-static size_t
-asgml3_poly_size(const LWPOLY *poly, const char *srs, int precision, int opts, const char *prefix, const char *id)
+static void
+asgml3_poly(stringbuffer_t *sb, const LWPOLY *poly, const char *srs, int precision, int opts, int is_patch, const char *prefix, const char *id)
 {
-	size_t size;
-	size_t prefixlen = strlen(prefix);
 	int i;
-
-	size = ( sizeof("<PolygonPatch><exterior><LinearRing>///") + (prefixlen*3) ) * 2;
-	size += ( sizeof("<interior><LinearRing>//") + (prefixlen*2) ) * 2 * (poly->nrings - 1);
-	size += ( sizeof("<posList></posList>") + (prefixlen*2) ) * poly->nrings;
-	if (srs) size += strlen(srs) + sizeof(" srsName=..");
-	if (id)  size += strlen(id) + strlen(prefix) + sizeof(" id=..");
-	if (IS_DIMS(opts)) size += sizeof(" srsDimension='x'") * poly->nrings;
-
-	for (i=0; i<poly->nrings; i++)
-		size += pointArray_GMLsize(poly->rings[i], precision);
-
-	return size;
-}
-
-static size_t
-asgml3_poly_buf(const LWPOLY *poly, const char *srs, char *output, int precision, int opts, int is_patch, const char *prefix, const char *id)
-{
-	int i;
-	char *ptr=output;
 	int dimension=2;
 
 	if (FLAGS_GET_Z(poly->flags)) dimension = 3;
 	if (is_patch)
 	{
-		ptr += sprintf(ptr, "<%sPolygonPatch", prefix);
+		stringbuffer_aprintf(sb, "<%sPolygonPatch", prefix);
 
 	}
 	else
 	{
-		ptr += sprintf(ptr, "<%sPolygon", prefix);
+		stringbuffer_aprintf(sb, "<%sPolygon", prefix);
 	}
 
-	if (srs) ptr += sprintf(ptr, " srsName=\"%s\"", srs);
-	if (id)  ptr += sprintf(ptr, " %sid=\"%s\"", prefix, id);
+	if (srs) stringbuffer_aprintf(sb, " srsName=\"%s\"", srs);
+	if (id)  stringbuffer_aprintf(sb, " %sid=\"%s\"", prefix, id);
 
 	if ( lwpoly_is_empty(poly) )
 	{
-		ptr += sprintf(ptr, "/>");
-		return (ptr-output);
+		stringbuffer_append(sb, "/>");
+		return;
 	}
-	ptr += sprintf(ptr, ">");
+	stringbuffer_append(sb, ">");
 
-	ptr += sprintf(ptr, "<%sexterior><%sLinearRing>", prefix, prefix);
-	if (IS_DIMS(opts)) ptr += sprintf(ptr, "<%sposList srsDimension=\"%d\">", prefix, dimension);
-	else         ptr += sprintf(ptr, "<%sposList>", prefix);
+	stringbuffer_aprintf(sb, "<%sexterior><%sLinearRing>", prefix, prefix);
+	if (IS_DIMS(opts)) stringbuffer_aprintf(sb, "<%sposList srsDimension=\"%d\">", prefix, dimension);
+	else         stringbuffer_aprintf(sb, "<%sposList>", prefix);
 
-	ptr += pointArray_toGML3(poly->rings[0], ptr, precision, opts);
-	ptr += sprintf(ptr, "</%sposList></%sLinearRing></%sexterior>",
-	               prefix, prefix, prefix);
+	pointArray_toGML3(sb, poly->rings[0], precision, opts);
+	stringbuffer_aprintf(sb, "</%sposList></%sLinearRing></%sexterior>",
+	                     prefix, prefix, prefix);
 	for (i=1; i<poly->nrings; i++)
 	{
-		ptr += sprintf(ptr, "<%sinterior><%sLinearRing>", prefix, prefix);
-		if (IS_DIMS(opts)) ptr += sprintf(ptr, "<%sposList srsDimension=\"%d\">", prefix, dimension);
-		else         ptr += sprintf(ptr, "<%sposList>", prefix);
-		ptr += pointArray_toGML3(poly->rings[i], ptr, precision, opts);
-		ptr += sprintf(ptr, "</%sposList></%sLinearRing></%sinterior>",
-		               prefix, prefix, prefix);
-	}
-	if (is_patch) ptr += sprintf(ptr, "</%sPolygonPatch>", prefix);
-	else ptr += sprintf(ptr, "</%sPolygon>", prefix);
-
-	return (ptr-output);
-}
-
-static char *
-asgml3_poly(const LWPOLY *poly, const char *srs, int precision, int opts, int is_patch, const char *prefix, const char *id)
-{
-	char *output;
-	int size;
-
-	size = asgml3_poly_size(poly, srs, precision, opts, prefix, id);
-	output = lwalloc(size);
-	asgml3_poly_buf(poly, srs, output, precision, opts, is_patch, prefix, id);
-	return output;
-}
-
-static size_t
-asgml3_compound_size(const LWCOMPOUND *col, const char *srs, int precision, int opts, const char *prefix, const char *id )
-{
-	int i;
-	size_t size;
-	LWGEOM *subgeom;
-	size_t prefixlen = strlen(prefix);
-
-	size = ( sizeof( "<Curve></Curve>" ) + 2 * prefixlen );
-
-	if (srs) size += strlen(srs) + sizeof(" srsName=..");
-	if (id)  size += strlen(id) + strlen(prefix) + sizeof(" id=..");
-
-	size += ( sizeof("<segments></segments>") + 2 * prefixlen );
-
-	for(i= 0; i < col->ngeoms; ++i )
-	{
-		subgeom = col->geoms[i];
-		if ( subgeom->type == LINETYPE )
-		{
-
-			size += sizeof( "<LineStringSegment></LineStringSegment" ) + 2 * prefixlen;
-			size += sizeof( "<posList></posList" ) + 2 * prefixlen;
-			size += pointArray_GMLsize( ((LWLINE*)subgeom)->points, precision );
-		}
-		else if( subgeom->type == CIRCSTRINGTYPE )
-		{
-			size += sizeof( "<ArcString><posList></ArcString></posList>") + 4 * prefixlen;
-			size += pointArray_GMLsize( ((LWCIRCSTRING*)subgeom)->points, precision );
-		}
-		else
-		{
-			continue;
-		}
-		if (IS_DIMS(opts))
-		{
-			size += sizeof(" srsDimension='x'");
-		}
+		stringbuffer_aprintf(sb, "<%sinterior><%sLinearRing>", prefix, prefix);
+		if (IS_DIMS(opts)) stringbuffer_aprintf(sb, "<%sposList srsDimension=\"%d\">", prefix, dimension);
+		else         stringbuffer_aprintf(sb, "<%sposList>", prefix);
+		pointArray_toGML3(sb, poly->rings[i], precision, opts);
+		stringbuffer_aprintf(sb, "</%sposList></%sLinearRing></%sinterior>",
+		                     prefix, prefix, prefix);
 	}
-	return size;
+	if (is_patch) stringbuffer_aprintf(sb, "</%sPolygonPatch>", prefix);
+	else stringbuffer_aprintf(sb, "</%sPolygon>", prefix);
 }
 
-static size_t
-asgml3_compound_buf(const LWCOMPOUND *col, const char *srs, char *output, int precision, int opts, const char *prefix, const char *id)
+static void
+asgml3_compound(stringbuffer_t *sb, const LWCOMPOUND *col, const char *srs, int precision, int opts, const char *prefix, const char *id)
 {
 	LWGEOM *subgeom;
 	int i;
-	char* ptr = output;
 	int dimension=2;
 
 	if (FLAGS_GET_Z(col->flags))
@@ -1147,17 +716,17 @@ asgml3_compound_buf(const LWCOMPOUND *col, const char *srs, char *output, int pr
 		dimension = 3;
 	}
 
-	ptr += sprintf( ptr, "<%sCurve", prefix );
+	stringbuffer_aprintf(sb, "<%sCurve", prefix );
 	if (srs)
 	{
-		ptr += sprintf(ptr, " srsName=\"%s\"", srs);
+		stringbuffer_aprintf(sb, " srsName=\"%s\"", srs);
 	}
 	if (id)
 	{
-		ptr += sprintf(ptr, " %sid=\"%s\"", prefix, id );
+		stringbuffer_aprintf(sb, " %sid=\"%s\"", prefix, id );
 	}
-	ptr += sprintf( ptr, ">" );
-	ptr += sprintf( ptr, "<%ssegments>", prefix );
+	stringbuffer_append(sb, ">");
+	stringbuffer_aprintf(sb, "<%ssegments>", prefix );
 
 	for( i = 0; i < col->ngeoms; ++i )
 	{
@@ -1169,97 +738,37 @@ asgml3_compound_buf(const LWCOMPOUND *col, const char *srs, char *output, int pr
 
 		if ( subgeom->type == LINETYPE )
 		{
-			ptr += sprintf( ptr, "<%sLineStringSegment><%sposList", prefix, prefix );
+			stringbuffer_aprintf(sb, "<%sLineStringSegment><%sposList", prefix, prefix );
 			if (IS_DIMS(opts))
 			{
-				ptr += sprintf(ptr, " srsDimension=\"%d\"", dimension);
+				stringbuffer_aprintf(sb, " srsDimension=\"%d\"", dimension);
 			}
-			ptr += sprintf(ptr, ">");
-			ptr += pointArray_toGML3(((LWCIRCSTRING*)subgeom)->points, ptr, precision, opts);
-			ptr += sprintf( ptr, "</%sposList></%sLineStringSegment>", prefix, prefix );
+			stringbuffer_append(sb, ">");
+			pointArray_toGML3(sb, ((LWCIRCSTRING*)subgeom)->points, precision, opts);
+			stringbuffer_aprintf(sb, "</%sposList></%sLineStringSegment>", prefix, prefix );
 		}
 		else if( subgeom->type == CIRCSTRINGTYPE )
 		{
-			ptr += sprintf( ptr, "<%sArcString><%sposList" , prefix, prefix );
+			stringbuffer_aprintf(sb, "<%sArcString><%sposList" , prefix, prefix );
 			if (IS_DIMS(opts))
 			{
-				ptr += sprintf(ptr, " srsDimension=\"%d\"", dimension);
+				stringbuffer_aprintf(sb, " srsDimension=\"%d\"", dimension);
 			}
-			ptr += sprintf(ptr, ">");
-			ptr += pointArray_toGML3(((LWLINE*)subgeom)->points, ptr, precision, opts);
-			ptr += sprintf( ptr, "</%sposList></%sArcString>", prefix, prefix );
+			stringbuffer_append(sb, ">");
+			pointArray_toGML3(sb, ((LWLINE*)subgeom)->points, precision, opts);
+			stringbuffer_aprintf(sb, "</%sposList></%sArcString>", prefix, prefix );
 		}
 	}
 
-	ptr += sprintf( ptr, "</%ssegments>", prefix );
-	ptr += sprintf( ptr, "</%sCurve>", prefix );
-	return ( ptr - output );
-}
-
-static char *
-asgml3_compound(const LWCOMPOUND *col, const char *srs, int precision, int opts, const char *prefix, const char *id )
-{
-	char* gml;
-	size_t size;
-
-	size = asgml3_compound_size( col, srs, precision, opts, prefix, id );
-	gml = lwalloc( size );
-	asgml3_compound_buf( col, srs, gml, precision, opts, prefix, id );
-	return gml;
-}
-
-static size_t asgml3_curvepoly_size(const LWCURVEPOLY* poly, const char *srs, int precision, int opts, const char *prefix, const char *id)
-{
-	size_t prefixlen = strlen(prefix);
-	LWGEOM* subgeom;
-	size_t size = sizeof( "<Polygon></Polygon" ) + 2 * prefixlen;
-	if (srs) size += strlen(srs) + sizeof(" srsName=..");
-	if (id)  size += strlen(id) + strlen(prefix) + sizeof(" id=..");
-	int i;
-
-	for( i = 0; i < poly->nrings; ++i )
-	{
-		if( i == 0 )
-		{
-			size += sizeof( "<exterior></exterior>" ) + 2 * prefixlen;
-		}
-		else
-		{
-			size += sizeof( "<interior></interior>" ) + 2 * prefixlen;
-		}
-		subgeom = poly->rings[i];
-
-		if ( subgeom->type == LINETYPE )
-		{
-			size += sizeof("<LinearRing></LinearRing>") + 2 * prefixlen;
-			size += sizeof("<posList></posList") + 2 * prefixlen;
-			if (IS_DIMS(opts))
-			{
-				size += sizeof(" srsDimension='x'");
-			}
-			size += pointArray_GMLsize( ((LWLINE*)subgeom)->points, precision );
-		}
-		else if( subgeom->type == CIRCSTRINGTYPE )
-		{
-			size += sizeof("<Ring></Ring>") + 2 * prefixlen;
-			size += sizeof("<CurveMember></CurveMember>") + 2 * prefixlen;
-			size += asgml3_circstring_size((LWCIRCSTRING*)subgeom, srs, precision, opts, prefix, id);
-		}
-		else if( subgeom->type == COMPOUNDTYPE )
-		{
-			size += sizeof("<Ring></Ring>") + 2 * prefixlen;
-			size += sizeof("<curveMember></curveMember>") + 2 * prefixlen;
-			size += asgml3_compound_size( (LWCOMPOUND*)subgeom, srs, precision, opts, prefix, id );
-		}
-	}
-	return size;
+	stringbuffer_aprintf(sb, "</%ssegments>", prefix );
+	stringbuffer_aprintf(sb, "</%sCurve>", prefix );
 }
 
-static size_t asgml3_curvepoly_buf(const LWCURVEPOLY* poly, const char *srs, char *output, int precision, int opts, const char *prefix, const char *id)
+static void
+asgml3_curvepoly(stringbuffer_t *sb, const LWCURVEPOLY* poly, const char *srs, int precision, int opts, const char *prefix, const char *id)
 {
 	int i;
 	LWGEOM* subgeom;
-	char *ptr=output;
 	int dimension=2;
 
 	if (FLAGS_GET_Z(poly->flags))
@@ -1267,194 +776,105 @@ static size_t asgml3_curvepoly_buf(const LWCURVEPOLY* poly, const char *srs, cha
 		dimension = 3;
 	}
 
-	ptr += sprintf( ptr, "<%sPolygon", prefix );
+	stringbuffer_aprintf(sb, "<%sPolygon", prefix );
 	if (srs)
 	{
-		ptr += sprintf(ptr, " srsName=\"%s\"", srs);
+		stringbuffer_aprintf(sb, " srsName=\"%s\"", srs);
 	}
 	if (id)
 	{
-		ptr += sprintf(ptr, " %sid=\"%s\"", prefix, id );
+		stringbuffer_aprintf(sb, " %sid=\"%s\"", prefix, id );
 	}
-	ptr += sprintf(ptr, ">");
+	stringbuffer_append(sb, ">");
 
 	for( i = 0; i < poly->nrings; ++i )
 	{
 		if( i == 0 )
 		{
-			ptr += sprintf( ptr, "<%sexterior>", prefix);
+			stringbuffer_aprintf(sb, "<%sexterior>", prefix);
 		}
 		else
 		{
-			ptr += sprintf( ptr, "<%sinterior>", prefix);
+			stringbuffer_aprintf(sb, "<%sinterior>", prefix);
 		}
 
 		subgeom = poly->rings[i];
 		if ( subgeom->type == LINETYPE )
 		{
-			ptr += sprintf( ptr, "<%sLinearRing>", prefix );
-			ptr += sprintf( ptr, "<%sposList", prefix );
+			stringbuffer_aprintf(sb, "<%sLinearRing>", prefix );
+			stringbuffer_aprintf(sb, "<%sposList", prefix );
 			if (IS_DIMS(opts))
 			{
-				ptr += sprintf(ptr, " srsDimension=\"%d\"", dimension);
+				stringbuffer_aprintf(sb, " srsDimension=\"%d\"", dimension);
 			}
-			ptr += sprintf( ptr, ">" );
-			ptr += pointArray_toGML3(((LWLINE*)subgeom)->points, ptr, precision, opts);
-			ptr += sprintf( ptr, "</%sposList>", prefix );
-			ptr += sprintf( ptr, "</%sLinearRing>", prefix );
+			stringbuffer_append(sb, ">");
+			pointArray_toGML3(sb, ((LWLINE*)subgeom)->points, precision, opts);
+			stringbuffer_aprintf(sb, "</%sposList>", prefix );
+			stringbuffer_aprintf(sb, "</%sLinearRing>", prefix );
 		}
 		else if( subgeom->type == CIRCSTRINGTYPE )
 		{
-			ptr += sprintf( ptr, "<%sRing>", prefix );
-			ptr += sprintf( ptr, "<%scurveMember>", prefix );
-			ptr += asgml3_circstring_buf( (LWCIRCSTRING*)subgeom, srs, ptr, precision, opts, prefix, id );
-			ptr += sprintf( ptr, "</%scurveMember>", prefix );
-			ptr += sprintf( ptr, "</%sRing>", prefix );
+			stringbuffer_aprintf(sb, "<%sRing>", prefix );
+			stringbuffer_aprintf(sb, "<%scurveMember>", prefix );
+			asgml3_circstring(sb, (LWCIRCSTRING*)subgeom, srs, precision, opts, prefix, id );
+			stringbuffer_aprintf(sb, "</%scurveMember>", prefix );
+			stringbuffer_aprintf(sb, "</%sRing>", prefix );
 		}
 		else if( subgeom->type == COMPOUNDTYPE )
 		{
-			ptr += sprintf( ptr, "<%sRing>", prefix );
-			ptr += sprintf( ptr, "<%scurveMember>", prefix );
-			ptr += asgml3_compound_buf( (LWCOMPOUND*)subgeom, srs, ptr, precision, opts, prefix, id );
-			ptr += sprintf( ptr, "</%scurveMember>", prefix );
-			ptr += sprintf( ptr, "</%sRing>", prefix );
+			stringbuffer_aprintf(sb, "<%sRing>", prefix );
+			stringbuffer_aprintf(sb, "<%scurveMember>", prefix );
+			asgml3_compound(sb, (LWCOMPOUND*)subgeom, srs, precision, opts, prefix, id );
+			stringbuffer_aprintf(sb, "</%scurveMember>", prefix );
+			stringbuffer_aprintf(sb, "</%sRing>", prefix );
 		}
 
 		if( i == 0 )
 		{
-			ptr += sprintf( ptr, "</%sexterior>", prefix);
+			stringbuffer_aprintf(sb, "</%sexterior>", prefix);
 		}
 		else
 		{
-			ptr += sprintf( ptr, "</%sinterior>", prefix);
+			stringbuffer_aprintf(sb, "</%sinterior>", prefix);
 		}
 	}
 
-	ptr += sprintf( ptr, "</%sPolygon>", prefix );
-	return (ptr - output);
+	stringbuffer_aprintf(sb, "</%sPolygon>", prefix );
 }
 
-static char* asgml3_curvepoly(const LWCURVEPOLY* poly, const char *srs, int precision, int opts, const char *prefix, const char *id)
+static void
+asgml3_triangle(stringbuffer_t *sb, const LWTRIANGLE *triangle, const char *srs, int precision, int opts, const char *prefix, const char *id)
 {
-	char* gml;
-	size_t size;
-
-	size = asgml3_curvepoly_size( poly, srs, precision, opts, prefix, id );
-	gml = lwalloc( size );
-	asgml3_curvepoly_buf( poly, srs, gml, precision, opts, prefix, id );
-	return gml;
-}
-
-
-static size_t
-asgml3_triangle_size(const LWTRIANGLE *triangle, const char *srs, int precision, int opts, const char *prefix, const char *id)
-{
-	size_t size;
-	size_t prefixlen = strlen(prefix);
-
-	size =  ( sizeof("<Triangle><exterior><LinearRing>///") + (prefixlen*3) ) * 2;
-	size +=   sizeof("<posList></posList>") + (prefixlen*2);
-	if (srs) size += strlen(srs) + sizeof(" srsName=..");
-	if (id)  size += strlen(prefix) + strlen(id) + sizeof(" id=..");
-	if (IS_DIMS(opts)) size += sizeof(" srsDimension='x'");
-
-	size += pointArray_GMLsize(triangle->points, precision);
-
-	return size;
-}
-
-static size_t
-asgml3_triangle_buf(const LWTRIANGLE *triangle, const char *srs, char *output, int precision, int opts, const char *prefix, const char *id)
-{
-	char *ptr=output;
 	int dimension=2;
 
 	if (FLAGS_GET_Z(triangle->flags)) dimension = 3;
-	ptr += sprintf(ptr, "<%sTriangle", prefix);
-	if (srs) ptr += sprintf(ptr, " srsName=\"%s\"", srs);
-	if (id)  ptr += sprintf(ptr, " %sid=\"%s\"", prefix, id);
-	ptr += sprintf(ptr, ">");
+	stringbuffer_aprintf(sb, "<%sTriangle", prefix);
+	if (srs) stringbuffer_aprintf(sb, " srsName=\"%s\"", srs);
+	if (id)  stringbuffer_aprintf(sb, " %sid=\"%s\"", prefix, id);
+	stringbuffer_append(sb, ">");
 
-	ptr += sprintf(ptr, "<%sexterior><%sLinearRing>", prefix, prefix);
-	if (IS_DIMS(opts)) ptr += sprintf(ptr, "<%sposList srsDimension=\"%d\">", prefix, dimension);
-	else         ptr += sprintf(ptr, "<%sposList>", prefix);
+	stringbuffer_aprintf(sb, "<%sexterior><%sLinearRing>", prefix, prefix);
+	if (IS_DIMS(opts)) stringbuffer_aprintf(sb, "<%sposList srsDimension=\"%d\">", prefix, dimension);
+	else         stringbuffer_aprintf(sb, "<%sposList>", prefix);
 
-	ptr += pointArray_toGML3(triangle->points, ptr, precision, opts);
-	ptr += sprintf(ptr, "</%sposList></%sLinearRing></%sexterior>",
-	               prefix, prefix, prefix);
+	pointArray_toGML3(sb, triangle->points, precision, opts);
+	stringbuffer_aprintf(sb, "</%sposList></%sLinearRing></%sexterior>",
+	                     prefix, prefix, prefix);
 
-	ptr += sprintf(ptr, "</%sTriangle>", prefix);
-
-	return (ptr-output);
-}
-
-static char *
-asgml3_triangle(const LWTRIANGLE *triangle, const char *srs, int precision, int opts, const char *prefix, const char *id)
-{
-	char *output;
-	int size;
-
-	size = asgml3_triangle_size(triangle, srs, precision, opts, prefix, id);
-	output = lwalloc(size);
-	asgml3_triangle_buf(triangle, srs, output, precision, opts, prefix, id);
-	return output;
-}
-
-
-/*
- * Compute max size required for GML version of this
- * inspected geometry. Will recurse when needed.
- * Don't call this with single-geoms inspected.
- */
-static size_t
-asgml3_multi_size(const LWCOLLECTION *col, const char *srs, int precision, int opts, const char *prefix, const char *id)
-{
-	int i;
-	size_t size;
-	size_t prefixlen = strlen(prefix);
-	LWGEOM *subgeom;
-
-	/* the longest possible multi version */
-	size = sizeof("<MultiLineString></MultiLineString>") + prefixlen*2;
-
-	if (srs) size += strlen(srs) + sizeof(" srsName=..");
-	if (id)  size += strlen(id) + strlen(prefix) + sizeof(" id=..");
-
-	for (i=0; i<col->ngeoms; i++)
-	{
-		subgeom = col->geoms[i];
-		if (subgeom->type == POINTTYPE)
-		{
-			size += ( sizeof("<pointMember>/") + prefixlen ) * 2;
-			size += asgml3_point_size((LWPOINT*)subgeom, 0, precision, opts, prefix, id);
-		}
-		else if (subgeom->type == LINETYPE)
-		{
-			size += ( sizeof("<curveMember>/") + prefixlen ) * 2;
-			size += asgml3_line_size((LWLINE*)subgeom, 0, precision, opts, prefix, id);
-		}
-		else if (subgeom->type == POLYGONTYPE)
-		{
-			size += ( sizeof("<surfaceMember>/") + prefixlen ) * 2;
-			size += asgml3_poly_size((LWPOLY*)subgeom, 0, precision, opts, prefix, id);
-		}
-	}
-
-	return size;
+	stringbuffer_aprintf(sb, "</%sTriangle>", prefix);
 }
 
 /*
  * Don't call this with single-geoms inspected!
  */
-static size_t
-asgml3_multi_buf(const LWCOLLECTION *col, const char *srs, char *output, int precision, int opts, const char *prefix, const char *id)
+static void
+asgml3_multi(stringbuffer_t *sb, const LWCOLLECTION *col, const char *srs, int precision, int opts, const char *prefix, const char *id)
 {
 	int type = col->type;
-	char *ptr, *gmltype;
+	char *gmltype;
 	int i;
 	LWGEOM *subgeom;
 
-	ptr = output;
 	gmltype="";
 
 	if 	(type == MULTIPOINTTYPE)   gmltype = "MultiPoint";
@@ -1462,532 +882,246 @@ asgml3_multi_buf(const LWCOLLECTION *col, const char *srs, char *output, int pre
 	else if (type == MULTIPOLYGONTYPE) gmltype = "MultiSurface";
 
 	/* Open outmost tag */
-	ptr += sprintf(ptr, "<%s%s", prefix, gmltype);
-	if (srs) ptr += sprintf(ptr, " srsName=\"%s\"", srs);
-	if (id)  ptr += sprintf(ptr, " %sid=\"%s\"", prefix, id);
+	stringbuffer_aprintf(sb, "<%s%s", prefix, gmltype);
+	if (srs) stringbuffer_aprintf(sb, " srsName=\"%s\"", srs);
+	if (id)  stringbuffer_aprintf(sb, " %sid=\"%s\"", prefix, id);
 
 	if (!col->ngeoms)
 	{
-		ptr += sprintf(ptr, "/>");
-		return (ptr-output);
+		stringbuffer_append(sb, "/>");
+		return;
 	}
-	ptr += sprintf(ptr, ">");
+	stringbuffer_append(sb, ">");
 
 	for (i=0; i<col->ngeoms; i++)
 	{
 		subgeom = col->geoms[i];
 		if (subgeom->type == POINTTYPE)
 		{
-			ptr += sprintf(ptr, "<%spointMember>", prefix);
-			ptr += asgml3_point_buf((LWPOINT*)subgeom, 0, ptr, precision, opts, prefix, id);
-			ptr += sprintf(ptr, "</%spointMember>", prefix);
+			stringbuffer_aprintf(sb, "<%spointMember>", prefix);
+			asgml3_point(sb, (LWPOINT*)subgeom, 0, precision, opts, prefix, id);
+			stringbuffer_aprintf(sb, "</%spointMember>", prefix);
 		}
 		else if (subgeom->type == LINETYPE)
 		{
-			ptr += sprintf(ptr, "<%scurveMember>", prefix);
-			ptr += asgml3_line_buf((LWLINE*)subgeom, 0, ptr, precision, opts, prefix, id);
-			ptr += sprintf(ptr, "</%scurveMember>", prefix);
+			stringbuffer_aprintf(sb, "<%scurveMember>", prefix);
+			asgml3_line(sb, (LWLINE*)subgeom, 0, precision, opts, prefix, id);
+			stringbuffer_aprintf(sb, "</%scurveMember>", prefix);
 		}
 		else if (subgeom->type == POLYGONTYPE)
 		{
-			ptr += sprintf(ptr, "<%ssurfaceMember>", prefix);
-			ptr += asgml3_poly_buf((LWPOLY*)subgeom, 0, ptr, precision, opts, 0, prefix, id);
-			ptr += sprintf(ptr, "</%ssurfaceMember>", prefix);
+			stringbuffer_aprintf(sb, "<%ssurfaceMember>", prefix);
+			asgml3_poly(sb, (LWPOLY*)subgeom, 0, precision, opts, 0, prefix, id);
+			stringbuffer_aprintf(sb, "</%ssurfaceMember>", prefix);
 		}
 	}
 
 	/* Close outmost tag */
-	ptr += sprintf(ptr, "</%s%s>", prefix, gmltype);
-
-	return (ptr-output);
-}
-
-/*
- * Don't call this with single-geoms inspected!
- */
-static char *
-asgml3_multi(const LWCOLLECTION *col, const char *srs, int precision, int opts, const char *prefix, const char *id)
-{
-	char *gml;
-	size_t size;
-
-	size = asgml3_multi_size(col, srs, precision, opts, prefix, id);
-	gml = lwalloc(size);
-	asgml3_multi_buf(col, srs, gml, precision, opts, prefix, id);
-	return gml;
-}
-
-
-static size_t
-asgml3_psurface_size(const LWPSURFACE *psur, const char *srs, int precision, int opts, const char *prefix, const char *id)
-{
-	int i;
-	size_t size;
-	size_t prefixlen = strlen(prefix);
-
-	size = (sizeof("<PolyhedralSurface><polygonPatches>/") + prefixlen*2) * 2;
-	if (srs) size += strlen(srs) + sizeof(" srsName=..");
-	if (id)  size += strlen(id) + strlen(prefix) + sizeof(" id=..");
-
-	for (i=0; i<psur->ngeoms; i++)
-	{
-		size += asgml3_poly_size(psur->geoms[i], 0, precision, opts, prefix, id);
-	}
-
-	return size;
+	stringbuffer_aprintf(sb, "</%s%s>", prefix, gmltype);
 }
 
 
 /*
  * Don't call this with single-geoms inspected!
  */
-static size_t
-asgml3_psurface_buf(const LWPSURFACE *psur, const char *srs, char *output, int precision, int opts, const char *prefix, const char *id)
+static void
+asgml3_psurface(stringbuffer_t *sb, const LWPSURFACE *psur, const char *srs, int precision, int opts, const char *prefix, const char *id)
 {
-	char *ptr;
 	int i;
 
-	ptr = output;
-
 	/* Open outmost tag */
-	ptr += sprintf(ptr, "<%sPolyhedralSurface", prefix);
-	if (srs) ptr += sprintf(ptr, " srsName=\"%s\"", srs);
-	if (id)  ptr += sprintf(ptr, " %sid=\"%s\"", prefix, id);
-	ptr += sprintf(ptr, "><%spolygonPatches>", prefix);
+	stringbuffer_aprintf(sb, "<%sPolyhedralSurface", prefix);
+	if (srs) stringbuffer_aprintf(sb, " srsName=\"%s\"", srs);
+	if (id)  stringbuffer_aprintf(sb, " %sid=\"%s\"", prefix, id);
+	stringbuffer_aprintf(sb, "><%spolygonPatches>", prefix);
 
 	for (i=0; i<psur->ngeoms; i++)
 	{
-		ptr += asgml3_poly_buf(psur->geoms[i], 0, ptr, precision, opts, 1, prefix, id);
+		asgml3_poly(sb, psur->geoms[i], 0, precision, opts, 1, prefix, id);
 	}
 
 	/* Close outmost tag */
-	ptr += sprintf(ptr, "</%spolygonPatches></%sPolyhedralSurface>",
-	               prefix, prefix);
-
-	return (ptr-output);
-}
-
-/*
- * Don't call this with single-geoms inspected!
- */
-static char *
-asgml3_psurface(const LWPSURFACE *psur, const char *srs, int precision, int opts, const char *prefix, const char *id)
-{
-	char *gml;
-	size_t size;
-
-	size = asgml3_psurface_size(psur, srs, precision, opts, prefix, id);
-	gml = lwalloc(size);
-	asgml3_psurface_buf(psur, srs, gml, precision, opts, prefix, id);
-	return gml;
-}
-
-
-static size_t
-asgml3_tin_size(const LWTIN *tin, const char *srs, int precision, int opts, const char *prefix, const char *id)
-{
-	int i;
-	size_t size;
-	size_t prefixlen = strlen(prefix);
-
-	size = (sizeof("<Tin><trianglePatches>/") + prefixlen*2) * 2;
-	if (srs) size += strlen(srs) + sizeof(" srsName=..");
-	if (id)  size += strlen(id) + strlen(prefix) + sizeof(" id=..");
-
-	for (i=0; i<tin->ngeoms; i++)
-	{
-		size += asgml3_triangle_size(tin->geoms[i], 0, precision, opts, prefix, id);
-	}
-
-	return size;
+	stringbuffer_aprintf(sb, "</%spolygonPatches></%sPolyhedralSurface>",
+	                     prefix, prefix);
 }
 
 
 /*
  * Don't call this with single-geoms inspected!
  */
-static size_t
-asgml3_tin_buf(const LWTIN *tin, const char *srs, char *output, int precision, int opts, const char *prefix, const char *id)
+static void
+asgml3_tin(stringbuffer_t *sb, const LWTIN *tin, const char *srs, int precision, int opts, const char *prefix, const char *id)
 {
-	char *ptr;
 	int i;
 
-	ptr = output;
-
 	/* Open outmost tag */
-	ptr += sprintf(ptr, "<%sTin", prefix);
-	if (srs) ptr += sprintf(ptr, " srsName=\"%s\"", srs);
-	if (id)  ptr += sprintf(ptr, " %sid=\"%s\"", prefix, id);
-	else	 ptr += sprintf(ptr, "><%strianglePatches>", prefix);
+	stringbuffer_aprintf(sb, "<%sTin", prefix);
+	if (srs) stringbuffer_aprintf(sb, " srsName=\"%s\"", srs);
+	if (id)  stringbuffer_aprintf(sb, " %sid=\"%s\"", prefix, id);
+	else	 stringbuffer_aprintf(sb, "><%strianglePatches>", prefix);
 
 	for (i=0; i<tin->ngeoms; i++)
 	{
-		ptr += asgml3_triangle_buf(tin->geoms[i], 0, ptr, precision,
-		                           opts, prefix, id);
+		asgml3_triangle(sb, tin->geoms[i], 0, precision, opts, prefix, id);
 	}
 
 	/* Close outmost tag */
-	ptr += sprintf(ptr, "</%strianglePatches></%sTin>", prefix, prefix);
-
-	return (ptr-output);
-}
-
-/*
- * Don't call this with single-geoms inspected!
- */
-static char *
-asgml3_tin(const LWTIN *tin, const char *srs, int precision, int opts, const char *prefix, const char *id)
-{
-	char *gml;
-	size_t size;
-
-	size = asgml3_tin_size(tin, srs, precision, opts, prefix, id);
-	gml = lwalloc(size);
-	asgml3_tin_buf(tin, srs, gml, precision, opts, prefix, id);
-	return gml;
-}
-
-static size_t
-asgml3_collection_size(const LWCOLLECTION *col, const char *srs, int precision, int opts, const char *prefix, const char *id)
-{
-	int i;
-	size_t size;
-	size_t prefixlen = strlen(prefix);
-	LWGEOM *subgeom;
-
-	size = sizeof("<MultiGeometry></MultiGeometry>") + prefixlen*2;
-
-	if (srs) size += strlen(srs) + sizeof(" srsName=..");
-	if (id)  size += strlen(id) + strlen(prefix) + sizeof(" id=..");
-
-	for (i=0; i<col->ngeoms; i++)
-	{
-		subgeom = col->geoms[i];
-		size += ( sizeof("<geometryMember>/") + prefixlen ) * 2;
-		if ( subgeom->type == POINTTYPE )
-		{
-			size += asgml3_point_size((LWPOINT*)subgeom, 0, precision, opts, prefix, id);
-		}
-		else if ( subgeom->type == LINETYPE )
-		{
-			size += asgml3_line_size((LWLINE*)subgeom, 0, precision, opts, prefix, id);
-		}
-		else if ( subgeom->type == POLYGONTYPE )
-		{
-			size += asgml3_poly_size((LWPOLY*)subgeom, 0, precision, opts, prefix, id);
-		}
-		else if ( lwgeom_is_collection(subgeom) )
-		{
-			size += asgml3_multi_size((LWCOLLECTION*)subgeom, 0, precision, opts, prefix, id);
-		}
-		else
-			lwerror("asgml3_collection_size: unknown geometry type");
-	}
-
-	return size;
+	stringbuffer_aprintf(sb, "</%strianglePatches></%sTin>", prefix, prefix);
 }
 
-static size_t
-asgml3_collection_buf(const LWCOLLECTION *col, const char *srs, char *output, int precision, int opts, const char *prefix, const char *id)
+static void
+asgml3_collection(stringbuffer_t *sb, const LWCOLLECTION *col, const char *srs, int precision, int opts, const char *prefix, const char *id)
 {
-	char *ptr;
 	int i;
 	LWGEOM *subgeom;
 
-	ptr = output;
-
 	/* Open outmost tag */
-	ptr += sprintf(ptr, "<%sMultiGeometry", prefix);
-	if (srs) ptr += sprintf(ptr, " srsName=\"%s\"", srs);
-	if (id)  ptr += sprintf(ptr, " %sid=\"%s\"", prefix, id);
+	stringbuffer_aprintf(sb, "<%sMultiGeometry", prefix);
+	if (srs) stringbuffer_aprintf(sb, " srsName=\"%s\"", srs);
+	if (id)  stringbuffer_aprintf(sb, " %sid=\"%s\"", prefix, id);
 
 	if (!col->ngeoms)
 	{
-		ptr += sprintf(ptr, "/>");
-		return (ptr-output);
+		stringbuffer_append(sb, "/>");
+		return;
 	}
-	ptr += sprintf(ptr, ">");
+	stringbuffer_append(sb, ">");
 
 	for (i=0; i<col->ngeoms; i++)
 	{
 		subgeom = col->geoms[i];
-		ptr += sprintf(ptr, "<%sgeometryMember>", prefix);
+		stringbuffer_aprintf(sb, "<%sgeometryMember>", prefix);
 		if ( subgeom->type == POINTTYPE )
 		{
-			ptr += asgml3_point_buf((LWPOINT*)subgeom, 0, ptr, precision, opts, prefix, id);
+			asgml3_point(sb, (LWPOINT*)subgeom, 0, precision, opts, prefix, id);
 		}
 		else if ( subgeom->type == LINETYPE )
 		{
-			ptr += asgml3_line_buf((LWLINE*)subgeom, 0, ptr, precision, opts, prefix, id);
+			asgml3_line(sb, (LWLINE*)subgeom, 0, precision, opts, prefix, id);
 		}
 		else if ( subgeom->type == POLYGONTYPE )
 		{
-			ptr += asgml3_poly_buf((LWPOLY*)subgeom, 0, ptr, precision, opts, 0, prefix, id);
+			asgml3_poly(sb, (LWPOLY*)subgeom, 0, precision, opts, 0, prefix, id);
 		}
 		else if ( lwgeom_is_collection(subgeom) )
 		{
 			if ( subgeom->type == COLLECTIONTYPE )
-				ptr += asgml3_collection_buf((LWCOLLECTION*)subgeom, 0, ptr, precision, opts, prefix, id);
+				asgml3_collection(sb, (LWCOLLECTION*)subgeom, 0, precision, opts, prefix, id);
 			else
-				ptr += asgml3_multi_buf((LWCOLLECTION*)subgeom, 0, ptr, precision, opts, prefix, id);
+				asgml3_multi(sb, (LWCOLLECTION*)subgeom, 0, precision, opts, prefix, id);
 		}
 		else
-			lwerror("asgml3_collection_buf: unknown geometry type");
+			lwerror("asgml3_collection: unknown geometry type");
 
-		ptr += sprintf(ptr, "</%sgeometryMember>", prefix);
+		stringbuffer_aprintf(sb, "</%sgeometryMember>", prefix);
 	}
 
 	/* Close outmost tag */
-	ptr += sprintf(ptr, "</%sMultiGeometry>", prefix);
-
-	return (ptr-output);
+	stringbuffer_aprintf(sb, "</%sMultiGeometry>", prefix);
 }
 
-/*
- * Don't call this with single-geoms inspected!
- */
-static char *
-asgml3_collection(const LWCOLLECTION *col, const char *srs, int precision, int opts, const char *prefix, const char *id)
-{
-	char *gml;
-	size_t size;
-
-	size = asgml3_collection_size(col, srs, precision, opts, prefix, id);
-	gml = lwalloc(size);
-	asgml3_collection_buf(col, srs, gml, precision, opts, prefix, id);
-	return gml;
-}
-
-static size_t asgml3_multicurve_size( const LWMCURVE* cur, const char *srs, int precision, int opts, const char *prefix, const char *id )
+static void
+asgml3_multicurve(stringbuffer_t *sb, const LWMCURVE* cur, const char *srs, int precision, int opts, const char *prefix, const char *id )
 {
-	size_t prefixlen = strlen(prefix);
-	size_t size = sizeof( "<MultiCurve></MultiCurve>" ) + 2 * prefixlen;
-	if (srs) size += strlen(srs) + sizeof(" srsName=..");
-	if (id)  size += strlen(id) + strlen(prefix) + sizeof(" id=..");
 	LWGEOM* subgeom;
 	int i;
 
-	for( i = 0; i < cur->ngeoms; ++i )
-	{
-		size += sizeof( "<curveMember></curveMember>" ) + 2 * prefixlen;
-		subgeom = cur->geoms[i];
-		if ( subgeom->type == LINETYPE )
-		{
-			size += asgml3_line_size( (LWLINE*)subgeom, srs, precision, opts, prefix, id );
-		}
-		else if( subgeom->type == CIRCSTRINGTYPE )
-		{
-			size += asgml3_circstring_size( (LWCIRCSTRING*)subgeom, srs, precision, opts, prefix, id );
-		}
-		else if( subgeom->type == COMPOUNDTYPE )
-		{
-			size += asgml3_compound_size( (LWCOMPOUND*)subgeom, srs, precision, opts, prefix, id );
-		}
-	}
-	return size;
-}
-
-static size_t asgml3_multicurve_buf( const LWMCURVE* cur, const char *srs, char *output, int precision, int opts, const char *prefix, const char *id )
-{
-	char* ptr = output;
-	LWGEOM* subgeom;
-	int i;
-
-	ptr += sprintf(ptr, "<%sMultiCurve", prefix );
+	stringbuffer_aprintf(sb, "<%sMultiCurve", prefix );
 	if (srs)
 	{
-		ptr += sprintf(ptr, " srsName=\"%s\"", srs);
+		stringbuffer_aprintf(sb, " srsName=\"%s\"", srs);
 	}
 	if (id)
 	{
-		ptr += sprintf(ptr, " %sid=\"%s\"", prefix, id );
+		stringbuffer_aprintf(sb, " %sid=\"%s\"", prefix, id );
 	}
-	ptr += sprintf( ptr, ">");
+	stringbuffer_append(sb, ">");
 
 	for( i = 0; i < cur->ngeoms; ++i )
 	{
-		ptr += sprintf(ptr, "<%scurveMember>", prefix );
+		stringbuffer_aprintf(sb, "<%scurveMember>", prefix );
 		subgeom = cur->geoms[i];
 		if ( subgeom->type == LINETYPE )
 		{
-			ptr += asgml3_line_buf( (LWLINE*)subgeom, srs, ptr, precision, opts, prefix, id );
+			asgml3_line(sb, (LWLINE*)subgeom, srs, precision, opts, prefix, id );
 		}
 		else if( subgeom->type == CIRCSTRINGTYPE )
 		{
-			ptr += asgml3_circstring_buf( (LWCIRCSTRING*)subgeom, srs, ptr, precision, opts, prefix, id );
+			asgml3_circstring(sb, (LWCIRCSTRING*)subgeom, srs, precision, opts, prefix, id );
 		}
 		else if( subgeom->type == COMPOUNDTYPE )
 		{
-			ptr += asgml3_compound_buf( (LWCOMPOUND*)subgeom, srs, ptr, precision, opts, prefix, id );
+			asgml3_compound(sb, (LWCOMPOUND*)subgeom, srs, precision, opts, prefix, id );
 		}
-		ptr += sprintf(ptr, "</%scurveMember>", prefix );
+		stringbuffer_aprintf(sb, "</%scurveMember>", prefix );
 	}
-	ptr += sprintf(ptr, "</%sMultiCurve>", prefix );
-	return (ptr - output);
-}
-
-static char *asgml3_multicurve( const LWMCURVE* cur, const char *srs, int precision, int opts, const char *prefix, const char *id )
-{
-	char* gml;
-	size_t size =asgml3_multicurve_size( cur, srs, precision, opts, prefix, id );
-	gml = lwalloc( size );
-	asgml3_multicurve_buf( cur, srs, gml, precision, opts, prefix, id );
-	return gml;
+	stringbuffer_aprintf(sb, "</%sMultiCurve>", prefix );
 }
 
-static size_t asgml3_multisurface_size(const LWMSURFACE *sur, const char *srs, int precision, int opts, const char *prefix, const char *id)
+static void
+asgml3_multisurface(stringbuffer_t *sb, const LWMSURFACE *sur, const char *srs, int precision, int opts, const char *prefix, const char *id)
 {
-	size_t prefixlen = strlen(prefix);
-	size_t size = sizeof( "<MultiSurface></MultiSurface>" ) + 2 * prefixlen;
-	if (srs) size += strlen(srs) + sizeof(" srsName=..");
-	if (id)  size += strlen(id) + strlen(prefix) + sizeof(" id=..");
-	LWGEOM* subgeom;
-	int i;
-
-	for( i = 0; i < sur->ngeoms; ++i )
-	{
-		subgeom = sur->geoms[i];
-		if( subgeom->type == POLYGONTYPE )
-		{
-			size += asgml3_poly_size( (LWPOLY*)sur->geoms[i], srs, precision, opts, prefix, id );
-		}
-		else if( subgeom->type == CURVEPOLYTYPE )
-		{
-			size += asgml3_curvepoly_size( (LWCURVEPOLY*)sur->geoms[i], srs, precision, opts, prefix, id );
-		}
-	}
-	return size;
-}
-
-static size_t asgml3_multisurface_buf(const LWMSURFACE *sur, const char *srs, char *output, int precision, int opts, const char *prefix, const char *id)
-{
-	char* ptr = output;
 	int i;
 	LWGEOM* subgeom;
 
-	ptr += sprintf( ptr, "<%sMultiSurface", prefix );
+	stringbuffer_aprintf(sb, "<%sMultiSurface", prefix );
 	if (srs)
 	{
-		ptr += sprintf(ptr, " srsName=\"%s\"", srs);
+		stringbuffer_aprintf(sb, " srsName=\"%s\"", srs);
 	}
 	if (id)
 	{
-		ptr += sprintf(ptr, " %sid=\"%s\"", prefix, id );
+		stringbuffer_aprintf(sb, " %sid=\"%s\"", prefix, id );
 	}
-	ptr += sprintf( ptr, ">" );
+	stringbuffer_append(sb, ">");
 
 	for( i = 0; i < sur->ngeoms; ++i )
 	{
 		subgeom = sur->geoms[i];
 		if( subgeom->type == POLYGONTYPE )
 		{
-			ptr += asgml3_poly_buf( (LWPOLY*)sur->geoms[i], srs, ptr, precision, opts, 0, prefix, id );
+			asgml3_poly(sb, (LWPOLY*)sur->geoms[i], srs, precision, opts, 0, prefix, id );
 		}
 		else if( subgeom->type == CURVEPOLYTYPE )
 		{
-			ptr += asgml3_curvepoly_buf( (LWCURVEPOLY*)sur->geoms[i], srs, ptr, precision, opts, prefix, id );
+			asgml3_curvepoly(sb, (LWCURVEPOLY*)sur->geoms[i], srs, precision, opts, prefix, id );
 		}
 	}
-	ptr += sprintf( ptr, "</%sMultiSurface>", prefix );
-	return ptr - output;
-}
-
-static char *asgml3_multisurface(const LWMSURFACE *sur, const char *srs, int precision, int opts, const char *prefix, const char *id)
-{
-	char* gml;
-	size_t size = asgml3_multisurface_size( sur, srs, precision, opts, prefix, id );
-	gml = lwalloc( size );
-	asgml3_multisurface_buf( sur, srs, gml, precision, opts, prefix, id );
-	return gml;
+	stringbuffer_aprintf(sb, "</%sMultiSurface>", prefix );
 }
 
 
 /* In GML3, inside <posList> or <pos>, coordinates are separated by a space separator
  * In GML3 also, lat/lon are reversed for geocentric data
  */
-static size_t
-pointArray_toGML3(POINTARRAY *pa, char *output, int precision, int opts)
+static void
+pointArray_toGML3(stringbuffer_t *sb, POINTARRAY *pa, int precision, int opts)
 {
 	int i;
-	char *ptr;
-	char x[OUT_MAX_DIGS_DOUBLE+OUT_MAX_DOUBLE_PRECISION+1];
-	char y[OUT_MAX_DIGS_DOUBLE+OUT_MAX_DOUBLE_PRECISION+1];
-	char z[OUT_MAX_DIGS_DOUBLE+OUT_MAX_DOUBLE_PRECISION+1];
+	int hasz = FLAGS_GET_Z(pa->flags);
 
-	ptr = output;
-
-	if ( ! FLAGS_GET_Z(pa->flags) )
+	for (i=0; i<pa->npoints; i++)
 	{
-		for (i=0; i<pa->npoints; i++)
-		{
-			const POINT2D *pt;
-			pt = getPoint2d_cp(pa, i);
-
-			if (fabs(pt->x) < OUT_MAX_DOUBLE)
-				sprintf(x, "%.*f", precision, pt->x);
-			else
-				sprintf(x, "%g", pt->x);
-			trim_trailing_zeros(x);
+		const POINT3DZ *pt = (const POINT3DZ *) getPoint_internal(pa, i);
 
-			if (fabs(pt->y) < OUT_MAX_DOUBLE)
-				sprintf(y, "%.*f", precision, pt->y);
-			else
-				sprintf(y, "%g", pt->y);
-			trim_trailing_zeros(y);
-
-			if ( i ) ptr += sprintf(ptr, " ");
-			if (IS_DEGREE(opts))
-				ptr += sprintf(ptr, "%s %s", y, x);
-			else
-				ptr += sprintf(ptr, "%s %s", x, y);
+		if ( i ) stringbuffer_append(sb, " ");
+		if (IS_DEGREE(opts))
+		{
+			stringbuffer_append_double(sb, pt->y, precision);
+			stringbuffer_append(sb, " ");
+			stringbuffer_append_double(sb, pt->x, precision);
 		}
-	}
-	else
-	{
-		for (i=0; i<pa->npoints; i++)
+		else
 		{
-			const POINT3DZ *pt;
-			pt = getPoint3dz_cp(pa, i);
-
-			if (fabs(pt->x) < OUT_MAX_DOUBLE)
-				sprintf(x, "%.*f", precision, pt->x);
-			else
-				sprintf(x, "%g", pt->x);
-			trim_trailing_zeros(x);
-
-			if (fabs(pt->y) < OUT_MAX_DOUBLE)
-				sprintf(y, "%.*f", precision, pt->y);
-			else
-				sprintf(y, "%g", pt->y);
-			trim_trailing_zeros(y);
-
-			if (fabs(pt->z) < OUT_MAX_DOUBLE)
-				sprintf(z, "%.*f", precision, pt->z);
-			else
-				sprintf(z, "%g", pt->z);
-			trim_trailing_zeros(z);
-
-			if ( i ) ptr += sprintf(ptr, " ");
-			if (IS_DEGREE(opts))
-				ptr += sprintf(ptr, "%s %s %s", y, x, z);
-			else
-				ptr += sprintf(ptr, "%s %s %s", x, y, z);
+			stringbuffer_append_double(sb, pt->x, precision);
+			stringbuffer_append(sb, " ");
+			stringbuffer_append_double(sb, pt->y, precision);
+		}
+		if ( hasz )
+		{
+			stringbuffer_append(sb, " ");
+			stringbuffer_append_double(sb, pt->z, precision);
 		}
 	}
-
-	return ptr-output;
 }
 
-
-
-/*
- * Returns maximum size of rendered pointarray in bytes.
- */
-static size_t
-pointArray_GMLsize(POINTARRAY *pa, int precision)
-{
-	if (FLAGS_NDIMS(pa->flags) == 2)
-		return (OUT_MAX_DIGS_DOUBLE + precision + sizeof(", ")) * 2 * pa->npoints;
-
-	return (OUT_MAX_DIGS_DOUBLE + precision + sizeof(", ")) * 3 * pa->npoints;
-}
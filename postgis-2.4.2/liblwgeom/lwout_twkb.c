@@ -107,58 +107,35 @@ static int ptarray_to_twkb_buf(const POINTARRAY *pa, TWKB_GLOBALS *globals, TWKB
 {
 	int ndims = FLAGS_NDIMS(pa->flags);
 	int i, j;
-	bytebuffer_t b;
-	bytebuffer_t *b_p;
-	int64_t nextdelta[MAX_N_DIMS];
+	int64_t deltas_static[TWKB_DELTAS_STATICSIZE];
+	int64_t *deltas = deltas_static;
+	int64_t *nextdelta;
 	int npoints = 0;
-	size_t npoints_offset = 0;
 
 	LWDEBUGF(2, "Entered %s", __func__);
 
-	/* Dispense with the empty case right away */
-	if ( pa->npoints == 0 && register_npoints )
+	/* Dispense with the empty case right away, so that the deltas */
+	/* below always hold at least the first point */
+	if ( pa->npoints == 0 )
 	{
 		LWDEBUGF(4, "Register npoints:%d", pa->npoints);
-		bytebuffer_append_uvarint(ts->geom_buf, pa->npoints);
+		if ( register_npoints )
+			bytebuffer_append_uvarint(ts->geom_buf, pa->npoints);
 		return 0;
 	}
 
-	/* If npoints is more than 127 it is unpredictable how many bytes npoints will need */
-	/* Then we have to store the deltas in a temp buffer to later add them after npoints */
-	/* If noints is below 128 we know 1 byte will be needed */
-	/* Then we can make room for that 1 byte at once and write to */
-	/* ordinary buffer */
-	if( pa->npoints > 127 )
-	{
-		/* Independent buffer to hold the coordinates, so we can put the npoints */
-		/* into the stream once we know how many points we actually have */
-		bytebuffer_init_with_size(&b, 3 * ndims * pa->npoints);
-		b_p = &b;
-	}
-	else
-	{
-		/* We give an alias to our ordinary buffer */
-		b_p = ts->geom_buf;
-		if ( register_npoints )
-		{
-			/* We do not store a pointer to the place where we want the npoints value */
-			/* Instead we store how far from the beginning of the buffer we want the value */
-			/* That is because we otherwise will get in trouble if the buffer is reallocated */
-			npoints_offset = b_p->writecursor - b_p->buf_start;
-
-			/* We just move the cursor 1 step to make room for npoints byte */
-			/* We use the function append_byte even if we have no value yet, */
-			/* since that gives us the check for big enough buffer and moves the cursor */
-			bytebuffer_append_byte(b_p, 0);
-		}
-	}
+	/* We cannot know npoints until the duplicates are dropped, so */
+	/* the deltas are worked out first and then written in one go */
+	/* right after the npoints */
+	if ( (size_t)pa->npoints * ndims > TWKB_DELTAS_STATICSIZE )
+		deltas = lwalloc(sizeof(int64_t) * pa->npoints * ndims);
 
+	nextdelta = deltas;
 	for ( i = 0; i < pa->npoints; i++ )
 	{
 		double *dbl_ptr = (double*)getPoint_internal(pa, i);
 		int diff = 0;
 
-		/* Write this coordinate to the buffer as a varint */
 		for ( j = 0; j < ndims; j++ )
 		{
 			/* To get the relative coordinate we don't get the distance */
@@ -176,15 +153,11 @@ static int ptarray_to_twkb_buf(const POINTARRAY *pa, TWKB_GLOBALS *globals, TWKB
 		if ( i > minpoints && diff == 0 )
 			continue;
 
-		/* We really added a point, so... */
+		/* We really added a point, so keep its deltas */
 		npoints++;
-
-		/* Write this vertex to the temporary buffer as varints */
 		for ( j = 0; j < ndims; j++ )
-		{
 			ts->accum_rels[j] += nextdelta[j];
-			bytebuffer_append_varint(b_p, nextdelta[j]);
-		}
+		nextdelta += ndims;
 
 		/* See if this coordinate expands the bounding box */
 		if( globals->variant & TWKB_BBOX )
@@ -198,28 +171,15 @@ static int ptarray_to_twkb_buf(const POINTARRAY *pa, TWKB_GLOBALS *globals, TWKB
 					ts->bbox_min[j] = ts->accum_rels[j];
 			}
 		}
-
 	}
 
-	if ( pa->npoints > 127 )
-	{
-		/* Now write the temporary results into the main buffer */
-		/* First the npoints */
-		if ( register_npoints )
-			bytebuffer_append_uvarint(ts->geom_buf, npoints);
-		/* Now the coordinates */
-		bytebuffer_append_bytebuffer(ts->geom_buf, b_p);
+	if ( register_npoints )
+		bytebuffer_append_uvarint(ts->geom_buf, npoints);
 
-		/* Clear our temporary buffer */
-		bytebuffer_destroy_buffer(&b);
-	}
-	else
-	{
-		/* If we didn't use a temp buffer, we just write that npoints value */
-		/* to where it belongs*/
-		if ( register_npoints )
-			varint_u64_encode_buf(npoints, b_p->buf_start + npoints_offset);
-	}
+	bytebuffer_append_varint_array(ts->geom_buf, deltas, (size_t)npoints * ndims);
+
+	if ( deltas != deltas_static )
+		lwfree(deltas);
 
 	return 0;
 }
@@ -339,8 +299,7 @@ static int lwcollection_to_twkb_buf(const LWCOLLECTION *col, TWKB_GLOBALS *globa
 	/* We've been handed an idlist, so write it in */
 	if ( ts->idlist )
 	{
-		for ( i = 0; i < col->ngeoms; i++ )
-			bytebuffer_append_varint(ts->geom_buf, ts->idlist[i]);
+		bytebuffer_append_varint_array(ts->geom_buf, ts->idlist, col->ngeoms);
 
 		/* Empty it out to nobody else uses it now */
 		ts->idlist = NULL;
@@ -410,15 +369,26 @@ static int lwgeom_write_to_buffer(const LWGEOM *geom, TWKB_GLOBALS *globals, TWK
 	size_t bbox_size = 0, optional_precision_byte = 0;
 	uint8_t flag = 0, type_prec = 0;
 	bytebuffer_t header_bytebuffer, geom_bytebuffer;
+	/* Sizes and boxes are only known once the geometry is written, */
+	/* without them the header and body go straight to the parent */
+	int direct = ! (globals->variant & (TWKB_SIZE | TWKB_BBOX));
 
 	TWKB_STATE child_state;
 	memset(&child_state, 0, sizeof(TWKB_STATE));
-	child_state.header_buf = &header_bytebuffer;
-	child_state.geom_buf = &geom_bytebuffer;
 	child_state.idlist = parent_state->idlist;
 
-	bytebuffer_init_with_size(child_state.header_buf, 16);
-	bytebuffer_init_with_size(child_state.geom_buf, 64);
+	if ( direct )
+	{
+		child_state.header_buf = parent_state->geom_buf;
+		child_state.geom_buf = parent_state->geom_buf;
+	}
+	else
+	{
+		child_state.header_buf = &header_bytebuffer;
+		child_state.geom_buf = &geom_bytebuffer;
+		bytebuffer_init_with_size(child_state.header_buf, 16);
+		bytebuffer_init_with_size(child_state.geom_buf, 64);
+	}
 
 	/* Read dimensionality from input */
 	has_z = lwgeom_has_z(geom);
@@ -502,6 +472,9 @@ static int lwgeom_write_to_buffer(const LWGEOM *geom, TWKB_GLOBALS *globals, TWK
 		if ( globals->variant & TWKB_SIZE )
 			bytebuffer_append_byte(child_state.header_buf, 0);
 
+		if ( direct )
+			return 0;
+
 		bytebuffer_append_bytebuffer(parent_state->geom_buf, child_state.header_buf);
 		bytebuffer_destroy_buffer(child_state.header_buf);
 		bytebuffer_destroy_buffer(child_state.geom_buf);
@@ -511,6 +484,9 @@ static int lwgeom_write_to_buffer(const LWGEOM *geom, TWKB_GLOBALS *globals, TWK
 	/* Write the TWKB into the output buffer */
 	lwgeom_to_twkb_buf(geom, globals, &child_state);
 
+	if ( direct )
+		return 0;
+
 	/*If we have a header_buf, we know that this function is called inside a collection*/
 	/*and then we have to merge the bboxes of the included geometries*/
 	/*and put the result to the parent (the collection)*/
@@ -601,7 +577,108 @@ lwgeom_to_twkb_with_idlist(const LWGEOM *geom, int64_t *idlist, uint8_t variant,
 	bytebuffer_init_with_size(ts.geom_buf, 512);
 	lwgeom_write_to_buffer(geom, &tg, &ts);
 
-	twkb = bytebuffer_get_buffer_copy(ts.geom_buf, twkb_size);
+	twkb = bytebuffer_release_buffer(ts.geom_buf, twkb_size);
+	bytebuffer_destroy_buffer(ts.geom_buf);
+	return twkb;
+}
+
+
+/**
+* Convert an array of LWGEOMs into a single TWKB collection, with
+* idlist (which may be NULL) holding one id per geometry. If all the
+* geometries are points, lines or polygons of the same type the output
+* is the matching multi-type, otherwise a geometry collection. The
+* geometries are written in place, without being gathered into a
+* collection first, into a buffer sized up front from the vertex count.
+* Caller is responsible for freeing the returned array.
+*/
+uint8_t*
+lwgeom_to_twkb_batch(LWGEOM **geoms, const int64_t *idlist, int ngeoms, uint8_t variant,
+               int8_t precision_xy, int8_t precision_z, int8_t precision_m,
+               size_t *twkb_size)
+{
+	TWKB_GLOBALS tg;
+	TWKB_STATE ts;
+	bytebuffer_t geom_bytebuffer;
+	LWCOLLECTION col;
+	uint8_t *twkb;
+	uint8_t type = 0;
+	int has_z = 0, has_m = 0;
+	size_t nvertices = 0;
+	int i;
+
+	LWDEBUGF(2, "Entered %s", __func__);
+
+	if ( ngeoms < 0 || ( ngeoms > 0 && ! geoms ) )
+	{
+		lwerror("Cannot convert NULL into TWKB");
+		return NULL;
+	}
+
+	/* Work out the collection type and check the dimensionality */
+	for ( i = 0; i < ngeoms; i++ )
+	{
+		const LWGEOM *geom = geoms[i];
+
+		if ( i == 0 )
+			type = geom->type;
+		else if ( geom->type != type )
+			type = COLLECTIONTYPE;
+
+		/* Empties have no coordinates, whatever dimensions they claim */
+		if ( lwgeom_is_empty(geom) )
+			continue;
+
+		if ( ! nvertices )
+		{
+			has_z = lwgeom_has_z(geom);
+			has_m = lwgeom_has_m(geom);
+		}
+		else if ( lwgeom_has_z(geom) != has_z || lwgeom_has_m(geom) != has_m )
+		{
+			lwerror("Geometries have different dimensionality");
+			return NULL;
+		}
+		nvertices += lwgeom_count_vertices(geom);
+	}
+
+	switch ( type )
+	{
+		case POINTTYPE:
+		case LINETYPE:
+		case POLYGONTYPE:
+			type = lwtype_get_collectiontype(type);
+			break;
+		default:
+			type = COLLECTIONTYPE;
+	}
+
+	/* The collection only borrows the geometries, so it is never freed */
+	memset(&col, 0, sizeof(LWCOLLECTION));
+	col.type = type;
+	col.flags = gflags(has_z, has_m, 0);
+	col.srid = SRID_UNKNOWN;
+	col.ngeoms = col.maxgeoms = ngeoms;
+	col.geoms = geoms;
+
+	memset(&ts, 0, sizeof(TWKB_STATE));
+	memset(&tg, 0, sizeof(TWKB_GLOBALS));
+
+	tg.variant = variant;
+	tg.prec_xy = precision_xy;
+	tg.prec_z = precision_z;
+	tg.prec_m = precision_m;
+
+	/* Deltas mostly take a byte or two, and each member has */
+	/* its own header, id and counts */
+	ts.idlist = idlist;
+	ts.header_buf = NULL;
+	ts.geom_buf = &geom_bytebuffer;
+	bytebuffer_init_with_size(ts.geom_buf,
+		64 + (size_t)ngeoms * 8 + nvertices * (2 + has_z + has_m) * 2);
+	lwgeom_write_to_buffer(lwcollection_as_lwgeom(&col), &tg, &ts);
+
+	twkb = bytebuffer_release_buffer(ts.geom_buf, twkb_size);
 	bytebuffer_destroy_buffer(ts.geom_buf);
 	return twkb;
 }
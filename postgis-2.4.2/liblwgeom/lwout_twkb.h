@@ -45,6 +45,9 @@
 #define MAX_BBOX_SIZE 64
 #define MAX_SIZE_SIZE 8
 
+/* Number of deltas a pointarray can have before they go on the heap */
+#define TWKB_DELTAS_STATICSIZE 256
+
 
 /**
 * Header true/false flags
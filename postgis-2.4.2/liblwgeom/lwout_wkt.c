@@ -84,7 +84,8 @@ static void ptarray_to_wkt_sb(const POINTARRAY *ptarray, stringbuffer_t *sb, int
 {
 	/* OGC only includes X/Y */
 	int dimensions = 2;
-	int i, j;
+	int i, j, len;
+	char buf[OUT_DOUBLE_BUFFER_SIZE];
 
 	/* ISO and extended formats include all dimensions */
 	if ( variant & ( WKT_ISO | WKT_EXTENDED ) )
@@ -108,7 +109,11 @@ static void ptarray_to_wkt_sb(const POINTARRAY *ptarray, stringbuffer_t *sb, int
 			/* Spaces before every ordinate but the first */
 			if ( j > 0 )
 				stringbuffer_append(sb, " ");
-			stringbuffer_aprintf(sb, "%.*g", precision, dbl_ptr[j]);
+			len = lwprint_double_sig(dbl_ptr[j], precision, buf, sizeof(buf));
+			if ( len < (int) sizeof(buf) )
+				stringbuffer_append_len(sb, buf, len);
+			else
+				stringbuffer_aprintf(sb, "%.*g", precision, dbl_ptr[j]);
 		}
 	}
 
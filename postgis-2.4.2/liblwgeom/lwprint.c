@@ -27,6 +27,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <math.h>
+#include <float.h>
 #include "liblwgeom_internal.h"
 
 /* Ensures the given lat and lon are in the "normal" range:
@@ -435,3 +436,255 @@ char* lwpoint_to_latlon(const LWPOINT * pt, const char *format)
 	p = getPoint2d_cp(pt->point, 0);
 	return lwdoubles_to_latlon(p->y, p->x, format);
 }
+
+/*
+ * Double printing for the text outputs.
+ *
+ * A double d is m * 2^-e with an integer m. The shortest decimal that
+ * reads back to d is found by trying N / 10^q for growing q, with N the
+ * correctly rounded value of d * 10^q, and testing it against the
+ * rounding interval of d. Scaled by 2^(e+2) * 10^q every term of that
+ * test is an integer, and for the digit counts printed here they all fit
+ * in 128 bits, so there are no floating point roundings and no big
+ * numbers involved. Values outside of that range go to snprintf.
+ */
+#ifdef __SIZEOF_INT128__
+
+typedef unsigned __int128 lwuint128;
+
+static const uint64_t lwpow10[] =
+{
+	1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL,
+	10000000ULL, 100000000ULL, 1000000000ULL, 10000000000ULL,
+	100000000000ULL, 1000000000000ULL, 10000000000000ULL,
+	100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL,
+	100000000000000000ULL, 1000000000000000000ULL,
+	10000000000000000000ULL
+};
+#define LWPOW10_MAX 19
+
+/* Largest e such that all the scaled terms still fit in 128 bits */
+#define LWDTOA_MAX_EXP 120
+
+/*
+ * Split a finite, positive, normal double into m * 2^-e, m on 53 bits.
+ * Returns LW_FALSE if e is out of the range handled here.
+ */
+static int
+lwdtoa_split(double x, uint64_t *m, int *e)
+{
+	int exp2;
+	double f;
+
+	if ( x < DBL_MIN )
+		return LW_FALSE;
+
+	f = frexp(x, &exp2);
+	*m = (uint64_t) ldexp(f, 53);
+	*e = 53 - exp2;
+
+	return *e >= 1 && *e <= LWDTOA_MAX_EXP;
+}
+
+/*
+ * Compute the digits of m * 2^-e with at most maxdd decimals: the
+ * shortest decimal reading back to the same double if there is one,
+ * or else the value correctly rounded to maxdd decimals, as printf %.*f
+ * does. Returns the number of decimals, or -1 when out of range.
+ */
+static int
+lwdtoa_fixed(uint64_t m, int e, int maxdd, uint64_t *digits)
+{
+	lwuint128 p, rem, half, cand, lo, hi;
+	uint64_t n, lo_m, hi_m;
+	int q, inclusive;
+	/* Past the table only the shortest representation can be used */
+	int qmax = maxdd > LWPOW10_MAX ? LWPOW10_MAX : maxdd;
+
+	/* Bounds of the interval reading back to m, scaled by 4 */
+	hi_m = 4 * m + 2;
+	lo_m = (m == ((uint64_t)1 << 52)) ? 4 * m - 1 : 4 * m - 2;
+	/* Round-half-even on input keeps the bounds for even m */
+	inclusive = !(m & 1);
+	half = (lwuint128)1 << (e - 1);
+
+	for ( q = 0; q <= qmax; q++ )
+	{
+		p = (lwuint128)m * lwpow10[q];
+		if ( (p >> e) >= ((lwuint128)1 << 63) )
+			return -1;
+
+		n = (uint64_t)(p >> e);
+		rem = p & (((lwuint128)1 << e) - 1);
+		if ( rem > half || (rem == half && (n & 1)) )
+			n++;
+
+		if ( q == maxdd )
+			break;
+
+		cand = (lwuint128)n << (e + 2);
+		lo = (lwuint128)lo_m * lwpow10[q];
+		hi = (lwuint128)hi_m * lwpow10[q];
+		if ( inclusive ? (cand >= lo && cand <= hi) : (cand > lo && cand < hi) )
+			break;
+
+		if ( q == qmax )
+			return -1;
+	}
+
+	*digits = n;
+	return q;
+}
+
+/* Is m * 2^-e >= 10^k ? For -LWPOW10_MAX <= k < LWPOW10_MAX and m * 2^-e < 2^52 */
+static int
+lwdtoa_ge_pow10(uint64_t m, int e, int k)
+{
+	if ( k >= 0 )
+		return m >= ((lwuint128)lwpow10[k] << e);
+	return (lwuint128)m * lwpow10[-k] >= ((lwuint128)1 << e);
+}
+
+/*
+ * Decimal exponent of x = m * 2^-e, floor(log10(x)) computed exactly.
+ * Only for 1e-5 <= x < 1e15.
+ */
+static int
+lwdtoa_exp10(double x, uint64_t m, int e)
+{
+	int k = (int) floor(log10(x));
+
+	/* log10 can be off by one next to the powers of ten */
+	if ( ! lwdtoa_ge_pow10(m, e, k) )
+		return k - 1;
+	if ( lwdtoa_ge_pow10(m, e, k + 1) )
+		return k + 1;
+	return k;
+}
+
+/* Write sign, integer part and decimals, without trailing zeros */
+static int
+lwdtoa_write(int negative, uint64_t digits, int decimals, char *buf)
+{
+	char tmp[24];
+	char *ptr = buf;
+	uint64_t ipart = digits / lwpow10[decimals];
+	uint64_t fpart = digits % lwpow10[decimals];
+	int i, len = 0;
+
+	if ( negative )
+		*ptr++ = '-';
+
+	do
+	{
+		tmp[len++] = '0' + (ipart % 10);
+		ipart /= 10;
+	}
+	while ( ipart );
+	while ( len )
+		*ptr++ = tmp[--len];
+
+	if ( fpart )
+	{
+		while ( fpart % 10 == 0 )
+		{
+			fpart /= 10;
+			decimals--;
+		}
+		*ptr++ = '.';
+		for ( i = decimals - 1; i >= 0; i-- )
+		{
+			ptr[i] = '0' + (fpart % 10);
+			fpart /= 10;
+		}
+		ptr += decimals;
+	}
+
+	*ptr = '\0';
+	return ptr - buf;
+}
+
+#endif /* __SIZEOF_INT128__ */
+
+/*
+ * Print a double with at most maxdd decimals, using the shortest
+ * representation that reads back to the same value. When maxdd
+ * decimals are not enough, the value is rounded as with %.*f. Values
+ * of OUT_MAX_DOUBLE and over are printed with %g. Trailing zeros are
+ * never printed. The shortest representation is looked for within 19
+ * decimals at most, well over OUT_MAX_DOUBLE_PRECISION.
+ *
+ * Returns the length of the output, which is truncated to bufsize-1
+ * characters like with snprintf. OUT_DOUBLE_BUFFER_SIZE is always enough.
+ */
+int
+lwprint_double(double d, int maxdd, char *buf, size_t bufsize)
+{
+	double ad = fabs(d);
+	int len;
+
+	if ( maxdd < 0 ) maxdd = 0;
+
+	if ( ! (ad < OUT_MAX_DOUBLE) )
+		return snprintf(buf, bufsize, "%g", d);
+
+#ifdef __SIZEOF_INT128__
+	if ( bufsize >= OUT_DOUBLE_BUFFER_SIZE )
+	{
+		uint64_t m, digits;
+		int e, decimals;
+
+		if ( ad == 0.0 )
+			return lwdtoa_write(signbit(d), 0, 0, buf);
+
+		if ( lwdtoa_split(ad, &m, &e) &&
+		     (decimals = lwdtoa_fixed(m, e, maxdd, &digits)) >= 0 )
+			return lwdtoa_write(signbit(d), digits, decimals, buf);
+	}
+#endif
+
+	len = snprintf(buf, bufsize, "%.*f", maxdd, d);
+	if ( len < (int) bufsize )
+	{
+		trim_trailing_zeros(buf);
+		len = strlen(buf);
+	}
+	return len;
+}
+
+/*
+ * Print a double with at most maxsd significant digits, like printf
+ * %.*g, but using the shortest representation that reads back to the
+ * same value when there is one with maxsd digits or less.
+ *
+ * Returns the length of the output, see lwprint_double.
+ */
+int
+lwprint_double_sig(double d, int maxsd, char *buf, size_t bufsize)
+{
+#ifdef __SIZEOF_INT128__
+	double ad = fabs(d);
+
+	if ( maxsd < 1 ) maxsd = 1;
+
+	if ( bufsize >= OUT_DOUBLE_BUFFER_SIZE && isfinite(d) )
+	{
+		uint64_t m, digits;
+		int e, k, decimals;
+
+		if ( ad == 0.0 )
+			return lwdtoa_write(signbit(d), 0, 0, buf);
+
+		/* Only the fixed notation range of %g, with room for a carry */
+		if ( ad >= 1e-5 && ad < OUT_MAX_DOUBLE && lwdtoa_split(ad, &m, &e) )
+		{
+			k = lwdtoa_exp10(ad, m, e);
+			if ( k >= -4 && k < maxsd - 1 &&
+			     (decimals = lwdtoa_fixed(m, e, maxsd - 1 - k, &digits)) >= 0 )
+				return lwdtoa_write(signbit(d), digits, decimals, buf);
+		}
+	}
+#endif
+
+	return snprintf(buf, bufsize, "%.*g", maxsd, d);
+}
@@ -134,34 +134,54 @@ int spheroid_project(const GEOGRAPHIC_POINT *r, const SPHEROID *spheroid, double
 }
 
 
-static double ptarray_area_spheroid(const POINTARRAY *pa, const SPHEROID *spheroid)
+/**
+* Computes the spheroidal distances between n pairs of points, a[i] to
+* b[i], into distances[i], initializing the geodesic once for the whole
+* batch rather than once per pair.
+*/
+void spheroid_distance_batch(const GEOGRAPHIC_POINT *a, const GEOGRAPHIC_POINT *b, int n, const SPHEROID *spheroid, double *distances)
 {
-	/* Return zero on non-sensical inputs */
-	if ( ! pa || pa->npoints < 4 )
-		return 0.0;
-
 	struct geod_geodesic gd;
-	geod_init(&gd, spheroid->a, spheroid->f);
-	struct geod_polygon poly;
-	geod_polygon_init(&poly, 0);
 	int i;
-	double area; /* returned polygon area */
-	POINT2D p; /* long/lat units are degrees */
 
-	/* Pass points from point array; don't close the linearring */
-	for ( i = 0; i < pa->npoints - 1; i++ )
+	geod_init(&gd, spheroid->a, spheroid->f);
+	for ( i = 0; i < n; i++ )
 	{
-		getPoint2d_p(pa, i, &p);
-		geod_polygon_addpoint(&gd, &poly, p.y, p.x);
-		LWDEBUGF(4, "geod_polygon_addpoint %d: %.12g %.12g", i, p.y, p.x);
+		geod_inverse(&gd, a[i].lat * 180.0 / M_PI, a[i].lon * 180.0 / M_PI,
+		                  b[i].lat * 180.0 / M_PI, b[i].lon * 180.0 / M_PI,
+		             &(distances[i]), 0, 0);
 	}
-	i = geod_polygon_compute(&gd, &poly, 0, 1, &area, 0);
-	if ( i != pa->npoints - 1 )
+}
+
+
+static double ptarray_area_spheroid(const POINTARRAY *pa, const SPHEROID *spheroid)
+{
+	struct geod_geodesic gd;
+	double *lats, *lons;
+	const POINT2D *p; /* long/lat units are degrees */
+	double area; /* returned polygon area */
+	int i, n;
+
+	/* Return zero on non-sensical inputs */
+	if ( ! pa || pa->npoints < 4 )
+		return 0.0;
+
+	/* Unpack the ring into coordinate arrays; don't close the linearring */
+	n = pa->npoints - 1;
+	lats = lwalloc(2 * n * sizeof(double));
+	lons = lats + n;
+	for ( i = 0; i < n; i++ )
 	{
-		lwerror("ptarray_area_spheroid: different number of points %d vs %d",
-				i, pa->npoints - 1);
+		p = getPoint2d_cp(pa, i);
+		lats[i] = p->y;
+		lons[i] = p->x;
 	}
-	LWDEBUGF(4, "geod_polygon_compute area: %.12g", area);
+
+	geod_init(&gd, spheroid->a, spheroid->f);
+	geod_polygonarea(&gd, lats, lons, n, &area, 0);
+	lwfree(lats);
+
+	LWDEBUGF(4, "geod_polygonarea area: %.12g", area);
 	return fabs(area);
 }
 
@@ -170,27 +190,18 @@ static double ptarray_area_spheroid(const POINTARRAY *pa, const SPHEROID *sphero
 /* Below use pre-version 2.2 geodesic functions */
 
 /**
-* Computes the shortest distance along the surface of the spheroid
-* between two points. Based on Vincenty's formula for the geodetic
-* inverse problem as described in "Geocentric Datum of Australia
-* Technical Manual", Chapter 4. Tested against:
-* http://mascot.gdbc.gov.bc.ca/mascot/util1a.html
-* and
-* http://www.ga.gov.au/nmd/geodesy/datums/vincenty_inverse.jsp
-*
-* @param a - location of first point.
-* @param b - location of second point.
-* @param s - spheroid to calculate on
-* @return spheroidal distance between a and b in spheroid units.
+* Vincenty inverse iteration for two points whose reduced latitudes
+* have already been computed. Shared by the single-pair and batch
+* distance functions so the batch can do the per-vertex trigonometry
+* once.
 */
-double spheroid_distance(const GEOGRAPHIC_POINT *a, const GEOGRAPHIC_POINT *b, const SPHEROID *spheroid)
+static double spheroid_distance_reduced(const GEOGRAPHIC_POINT *a, const GEOGRAPHIC_POINT *b,
+                                        double sin_u1, double cos_u1, double sin_u2, double cos_u2,
+                                        const SPHEROID *spheroid)
 {
 	double lambda = (b->lon - a->lon);
 	double f = spheroid->f;
-	double omf = 1 - spheroid->f;
-	double u1, u2;
-	double cos_u1, cos_u2;
-	double sin_u1, sin_u2;
+	double u2;
 	double big_a, big_b, delta_sigma;
 	double alpha, sin_alpha, cos_alphasq, c;
 	double sigma, sin_sigma, cos_sigma, cos2_sigma_m, sqrsin_sigma, last_lambda, omega;
@@ -204,13 +215,6 @@ double spheroid_distance(const GEOGRAPHIC_POINT *a, const GEOGRAPHIC_POINT *b, c
 		return 0.0;
 	}
 
-	u1 = atan(omf * tan(a->lat));
-	cos_u1 = cos(u1);
-	sin_u1 = sin(u1);
-	u2 = atan(omf * tan(b->lat));
-	cos_u2 = cos(u2);
-	sin_u2 = sin(u2);
-
 	omega = lambda;
 	do
 	{
@@ -266,6 +270,71 @@ double spheroid_distance(const GEOGRAPHIC_POINT *a, const GEOGRAPHIC_POINT *b, c
 	return distance;
 }
 
+/**
+* Computes the shortest distance along the surface of the spheroid
+* between two points. Based on Vincenty's formula for the geodetic
+* inverse problem as described in "Geocentric Datum of Australia
+* Technical Manual", Chapter 4. Tested against:
+* http://mascot.gdbc.gov.bc.ca/mascot/util1a.html
+* and
+* http://www.ga.gov.au/nmd/geodesy/datums/vincenty_inverse.jsp
+*
+* @param a - location of first point.
+* @param b - location of second point.
+* @param s - spheroid to calculate on
+* @return spheroidal distance between a and b in spheroid units.
+*/
+double spheroid_distance(const GEOGRAPHIC_POINT *a, const GEOGRAPHIC_POINT *b, const SPHEROID *spheroid)
+{
+	double omf = 1 - spheroid->f;
+	double u1 = atan(omf * tan(a->lat));
+	double u2 = atan(omf * tan(b->lat));
+
+	return spheroid_distance_reduced(a, b, sin(u1), cos(u1), sin(u2), cos(u2), spheroid);
+}
+
+/**
+* Computes the spheroidal distances between n pairs of points, a[i] to
+* b[i], into distances[i]. Reduced latitudes are computed in one pass
+* before the iterations; when b is a + 1 (the segments of a point
+* array) each vertex is only reduced once.
+*/
+void spheroid_distance_batch(const GEOGRAPHIC_POINT *a, const GEOGRAPHIC_POINT *b, int n, const SPHEROID *spheroid, double *distances)
+{
+	double omf = 1 - spheroid->f;
+	double *sin_u, *cos_u;
+	int chained = (b == a + 1);
+	int nu, i;
+
+	if ( n < 1 )
+		return;
+
+	nu = chained ? n + 1 : 2 * n;
+	sin_u = lwalloc(2 * nu * sizeof(double));
+	cos_u = sin_u + nu;
+
+	for ( i = 0; i < n; i++ )
+	{
+		double u = atan(omf * tan(a[i].lat));
+		sin_u[i] = sin(u);
+		cos_u[i] = cos(u);
+	}
+	for ( i = (chained ? n - 1 : 0); i < n; i++ )
+	{
+		double u = atan(omf * tan(b[i].lat));
+		sin_u[nu - n + i] = sin(u);
+		cos_u[nu - n + i] = cos(u);
+	}
+
+	for ( i = 0; i < n; i++ )
+	{
+		int j = nu - n + i;
+		distances[i] = spheroid_distance_reduced(&a[i], &b[i], sin_u[i], cos_u[i], sin_u[j], cos_u[j], spheroid);
+	}
+
+	lwfree(sin_u);
+}
+
 /**
 * Computes the direction of the geodesic joining two points on
 * the spheroid. Based on Vincenty's formula for the geodetic
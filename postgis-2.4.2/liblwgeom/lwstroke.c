@@ -46,6 +46,9 @@ LWGEOM* lwmpolygon_unstroke(const LWMPOLY *mpoly);
 LWGEOM* lwgeom_unstroke(const LWGEOM *geom);
 
 
+/* Linearization cache, if the host installed one */
+static lwlinearizecache lwlinearize_cache_var = NULL;
+
 /*
  * Determines (recursively in the case of collections) whether the geometry
  * contains at least on arc geometry or segment.
@@ -113,6 +116,37 @@ static double interpolate_arc(double angle, double a1, double a2, double a3, dou
 	}
 }
 
+/*
+ * Beyond this many vertices for a single arc, let the array grow as
+ * it goes rather than trusting the estimate.
+ */
+#define LW_ARC_MAX_RESERVE 16777216
+
+/*
+ * Append a vertex generated along an arc, unless it repeats the last
+ * one. Room is normally reserved beforehand.
+ */
+static inline void
+lwarc_push_point(POINTARRAY *pa, const POINT4D *pt)
+{
+	if ( pa->npoints > 0 )
+	{
+		const POINT2D *last = getPoint2d_cp(pa, pa->npoints - 1);
+		if ( last->x == pt->x && last->y == pt->y )
+		{
+			POINT4D tmp;
+			getPoint4d_p(pa, pa->npoints - 1, &tmp);
+			if ( (FLAGS_GET_Z(pa->flags) ? pt->z == tmp.z : 1) &&
+			     (FLAGS_GET_M(pa->flags) ? pt->m == tmp.m : 1) )
+				return;
+		}
+	}
+	if ( pa->npoints == pa->maxpoints )
+		ptarray_reserve(pa, pa->npoints + 1);
+	pa->npoints++;
+	ptarray_set_point4d(pa, pa->npoints - 1, pt);
+}
+
 /**
  * Segmentize an arc
  *
@@ -151,6 +185,10 @@ lwarc_linearize(POINTARRAY *to,
 	int is_circle = LW_FALSE;
 	int points_added = 0;
 	int reverse = 0;
+	int hasz = ptarray_has_z(to);
+	int hasm = ptarray_has_m(to);
+	uint32_t first = 0;
+	double steps;
 
 	LWDEBUG(2, "lwarc_linearize called.");
 
@@ -308,13 +346,23 @@ lwarc_linearize(POINTARRAY *to,
 	LWDEBUGF(2, "lwarc_linearize angle_shift:%g, increment:%g",
 		angle_shift * 180/M_PI, increment * 180/M_PI);
 
-	if ( reverse ) {{
-		const int capacity = 8; /* TODO: compute exactly ? */
-		pa = ptarray_construct_empty(ptarray_has_z(to), ptarray_has_m(to), capacity);
-	}}
+	/*
+	* The number of steps is known up front, give or take one for
+	* rounding, so make room for them all at once and write the
+	* vertices straight into place.
+	*/
+	steps = fabs((a3 - a1) / increment);
+	if ( steps < LW_ARC_MAX_RESERVE )
+		ptarray_reserve(pa, pa->npoints + (uint32_t)steps + 3);
 
 	/* Sweep from a1 to a3 */
-	if ( ! reverse )
+	if ( reverse )
+	{
+		/* Swept backwards from p3, turned around once done */
+		ptarray_append_point(pa, p3, LW_FALSE);
+		first = pa->npoints;
+	}
+	else
 	{
 		ptarray_append_point(pa, p1, LW_FALSE);
 	}
@@ -322,66 +370,84 @@ lwarc_linearize(POINTARRAY *to,
 	if ( angle_shift ) angle_shift -= increment;
 	LWDEBUGF(2, "a1:%g (%g deg), a3:%g (%g deg), inc:%g, shi:%g, cw:%d",
 		a1, a1 * 180 / M_PI, a3, a3 * 180 / M_PI, increment, angle_shift, clockwise);
+	pt.z = pt.m = 0.0;
 	for ( angle = a1 + increment + angle_shift; clockwise ? angle > a3 : angle < a3; angle += increment )
 	{
 		LWDEBUGF(2, " SA: %g ( %g deg )", angle, angle*180/M_PI);
 		pt.x = center.x + radius * cos(angle);
 		pt.y = center.y + radius * sin(angle);
-		pt.z = interpolate_arc(angle, a1, a2, a3, p1->z, p2->z, p3->z);
-		pt.m = interpolate_arc(angle, a1, a2, a3, p1->m, p2->m, p3->m);
-		ptarray_append_point(pa, &pt, LW_FALSE);
+		if ( hasz )
+			pt.z = interpolate_arc(angle, a1, a2, a3, p1->z, p2->z, p3->z);
+		if ( hasm )
+			pt.m = interpolate_arc(angle, a1, a2, a3, p1->m, p2->m, p3->m);
+		/* Backwards, p3 only becomes a neighbour once turned around */
+		if ( reverse && pa->npoints == first )
+			ptarray_append_point(pa, &pt, LW_TRUE);
+		else
+			lwarc_push_point(pa, &pt);
 		++points_added;
 		angle_shift = 0;
 	}
 
-	if ( reverse ) {{
-		int i;
-		ptarray_append_point(to, p3, LW_FALSE);
-		for ( i=pa->npoints; i>0; i-- ) {
-			getPoint4d_p(pa, i-1, &pt);
-			ptarray_append_point(to, &pt, LW_FALSE);
+	if ( reverse )
+	{
+		/* Turn the swept vertices around, leaving p3 in front */
+		uint32_t lo = first, hi = pa->npoints - 1;
+		POINT4D tmp;
+		while ( lo < hi )
+		{
+			getPoint4d_p(pa, lo, &pt);
+			getPoint4d_p(pa, hi, &tmp);
+			ptarray_set_point4d(pa, lo++, &tmp);
+			ptarray_set_point4d(pa, hi--, &pt);
 		}
-		ptarray_free(pa);
-	}}
+		/* Now the vertex next to p3 can be checked against it */
+		if ( first > 0 && pa->npoints > first )
+		{
+			getPoint4d_p(pa, first - 1, &pt);
+			getPoint4d_p(pa, first, &tmp);
+			if ( pt.x == tmp.x && pt.y == tmp.y &&
+			     (FLAGS_GET_Z(pa->flags) ? pt.z == tmp.z : 1) &&
+			     (FLAGS_GET_M(pa->flags) ? pt.m == tmp.m : 1) )
+				ptarray_remove_point(pa, first);
+		}
+	}
 
 	return points_added;
 }
 
 /*
- * @param icurve input curve
+ * Append the linear form of a sequence of arcs to a point array
+ *
+ * @param to POINTARRAY to append to
+ * @param points arc vertices, as in a CIRCULARSTRING
  * @param tol tolerance, semantic driven by tolerance_type
  * @param tolerance_type see LW_LINEARIZE_TOLERANCE_TYPE
  * @param flags see flags in lwarc_linearize
  *
- * @return a newly allocated LWLINE
+ * @return LW_SUCCESS, or LW_FAILURE on error (lwerror would be called)
  */
-static LWLINE *
-lwcircstring_linearize(const LWCIRCSTRING *icurve, double tol,
-                        LW_LINEARIZE_TOLERANCE_TYPE tolerance_type,
-                        int flags)
+static int
+ptarray_linearize_arcs(POINTARRAY *to, const POINTARRAY *points, double tol,
+                       LW_LINEARIZE_TOLERANCE_TYPE tolerance_type,
+                       int flags)
 {
-	LWLINE *oline;
-	POINTARRAY *ptarray;
 	uint32_t i, j;
 	POINT4D p1, p2, p3, p4;
 	int ret;
 
-	LWDEBUGF(2, "lwcircstring_linearize called., dim = %d", icurve->points->flags);
-
-	ptarray = ptarray_construct_empty(FLAGS_GET_Z(icurve->points->flags), FLAGS_GET_M(icurve->points->flags), 64);
-
-	for (i = 2; i < icurve->points->npoints; i+=2)
+	for (i = 2; i < points->npoints; i+=2)
 	{
 		LWDEBUGF(3, "lwcircstring_linearize: arc ending at point %d", i);
 
-		getPoint4d_p(icurve->points, i - 2, &p1);
-		getPoint4d_p(icurve->points, i - 1, &p2);
-		getPoint4d_p(icurve->points, i, &p3);
+		getPoint4d_p(points, i - 2, &p1);
+		getPoint4d_p(points, i - 1, &p2);
+		getPoint4d_p(points, i, &p3);
 
-		ret = lwarc_linearize(ptarray, &p1, &p2, &p3, tol, tolerance_type, flags);
+		ret = lwarc_linearize(to, &p1, &p2, &p3, tol, tolerance_type, flags);
 		if ( ret > 0 )
 		{
-			LWDEBUGF(3, "lwcircstring_linearize: generated %d points", ptarray->npoints);
+			LWDEBUGF(3, "lwcircstring_linearize: generated %d points", to->npoints);
 		}
 		else if ( ret == 0 )
 		{
@@ -389,22 +455,47 @@ lwcircstring_linearize(const LWCIRCSTRING *icurve, double tol,
 
 			for (j = i - 2 ; j < i ; j++)
 			{
-				getPoint4d_p(icurve->points, j, &p4);
-				ptarray_append_point(ptarray, &p4, LW_TRUE);
+				getPoint4d_p(points, j, &p4);
+				ptarray_append_point(to, &p4, LW_TRUE);
 			}
 		}
 		else
 		{
 			/* An error occurred, lwerror should have been called by now */
-			ptarray_free(ptarray);
-			return NULL;
+			return LW_FAILURE;
 		}
 	}
-	getPoint4d_p(icurve->points, icurve->points->npoints-1, &p1);
-	ptarray_append_point(ptarray, &p1, LW_TRUE);
+	getPoint4d_p(points, points->npoints-1, &p1);
+	ptarray_append_point(to, &p1, LW_TRUE);
+	return LW_SUCCESS;
+}
 
-	oline = lwline_construct(icurve->srid, NULL, ptarray);
-	return oline;
+/*
+ * @param icurve input curve
+ * @param tol tolerance, semantic driven by tolerance_type
+ * @param tolerance_type see LW_LINEARIZE_TOLERANCE_TYPE
+ * @param flags see flags in lwarc_linearize
+ *
+ * @return a newly allocated LWLINE
+ */
+static LWLINE *
+lwcircstring_linearize(const LWCIRCSTRING *icurve, double tol,
+                        LW_LINEARIZE_TOLERANCE_TYPE tolerance_type,
+                        int flags)
+{
+	POINTARRAY *ptarray;
+
+	LWDEBUGF(2, "lwcircstring_linearize called., dim = %d", icurve->points->flags);
+
+	ptarray = ptarray_construct_empty(FLAGS_GET_Z(icurve->points->flags), FLAGS_GET_M(icurve->points->flags), 64);
+
+	if ( ptarray_linearize_arcs(ptarray, icurve->points, tol, tolerance_type, flags) == LW_FAILURE )
+	{
+		ptarray_free(ptarray);
+		return NULL;
+	}
+
+	return lwline_construct(icurve->srid, NULL, ptarray);
 }
 
 /*
@@ -435,13 +526,12 @@ lwcompound_linearize(const LWCOMPOUND *icompound, double tol,
 		geom = icompound->geoms[i];
 		if (geom->type == CIRCSTRINGTYPE)
 		{
-			tmp = lwcircstring_linearize((LWCIRCSTRING *)geom, tol, tolerance_type, flags);
-			for (j = 0; j < tmp->points->npoints; j++)
+			/* Straight in, repeats at the joins go below */
+			if ( ptarray_linearize_arcs(ptarray, ((LWCIRCSTRING *)geom)->points, tol, tolerance_type, flags) == LW_FAILURE )
 			{
-				getPoint4d_p(tmp->points, j, &p);
-				ptarray_append_point(ptarray, &p, LW_TRUE);
+				ptarray_free(ptarray);
+				return NULL;
 			}
-			lwline_free(tmp);
 		}
 		else if (geom->type == LINETYPE)
 		{
@@ -468,7 +558,7 @@ lwcompound_linearize(const LWCOMPOUND *icompound, double tol,
 LWLINE *
 lwcompound_stroke(const LWCOMPOUND *icompound, uint32_t perQuad)
 {
-		return lwcompound_linearize(icompound, perQuad, LW_LINEARIZE_TOLERANCE_TYPE_SEGS_PER_QUAD, 0);
+		return (LWLINE *)lwcurve_linearize((LWGEOM *)icompound, perQuad, LW_LINEARIZE_TOLERANCE_TYPE_SEGS_PER_QUAD, 0);
 }
 
 
@@ -501,7 +591,9 @@ lwcurvepoly_linearize(const LWCURVEPOLY *curvepoly, double tol,
 		if (tmp->type == CIRCSTRINGTYPE)
 		{
 			line = lwcircstring_linearize((LWCIRCSTRING *)tmp, tol, tolerance_type, flags);
-			ptarray[i] = ptarray_clone_deep(line->points);
+			/* Take the points over rather than copying them */
+			ptarray[i] = line->points;
+			line->points = NULL;
 			lwline_free(line);
 		}
 		else if (tmp->type == LINETYPE)
@@ -512,7 +604,8 @@ lwcurvepoly_linearize(const LWCURVEPOLY *curvepoly, double tol,
 		else if (tmp->type == COMPOUNDTYPE)
 		{
 			line = lwcompound_linearize((LWCOMPOUND *)tmp, tol, tolerance_type, flags);
-			ptarray[i] = ptarray_clone_deep(line->points);
+			ptarray[i] = line->points;
+			line->points = NULL;
 			lwline_free(line);
 		}
 		else
@@ -530,7 +623,7 @@ lwcurvepoly_linearize(const LWCURVEPOLY *curvepoly, double tol,
 LWPOLY *
 lwcurvepoly_stroke(const LWCURVEPOLY *curvepoly, uint32_t perQuad)
 {
-		return lwcurvepoly_linearize(curvepoly, perQuad, LW_LINEARIZE_TOLERANCE_TYPE_SEGS_PER_QUAD, 0);
+		return (LWPOLY *)lwcurve_linearize((LWGEOM *)curvepoly, perQuad, LW_LINEARIZE_TOLERANCE_TYPE_SEGS_PER_QUAD, 0);
 }
 
 
@@ -677,10 +770,10 @@ lwcollection_linearize(const LWCOLLECTION *collection, double tol,
 	return ocol;
 }
 
-LWGEOM *
-lwcurve_linearize(const LWGEOM *geom, double tol,
-                  LW_LINEARIZE_TOLERANCE_TYPE type,
-                  int flags)
+static LWGEOM *
+lwcurve_linearize_direct(const LWGEOM *geom, double tol,
+                         LW_LINEARIZE_TOLERANCE_TYPE type,
+                         int flags)
 {
 	LWGEOM * ogeom = NULL;
 	switch (geom->type)
@@ -709,6 +802,23 @@ lwcurve_linearize(const LWGEOM *geom, double tol,
 	return ogeom;
 }
 
+LWGEOM *
+lwcurve_linearize(const LWGEOM *geom, double tol,
+                  LW_LINEARIZE_TOLERANCE_TYPE type,
+                  int flags)
+{
+	/* Only curves are worth remembering, the rest is a plain copy */
+	if ( lwlinearize_cache_var && lwgeom_has_arc(geom) )
+		return lwlinearize_cache_var(geom, tol, type, flags, lwcurve_linearize_direct);
+	return lwcurve_linearize_direct(geom, tol, type, flags);
+}
+
+void
+lwgeom_set_linearize_cache(lwlinearizecache cache)
+{
+	lwlinearize_cache_var = cache;
+}
+
 /* Kept for backward compatibility - TODO: drop */
 LWGEOM *
 lwgeom_stroke(const LWGEOM *geom, uint32_t perQuad)
@@ -0,0 +1,890 @@
+/**********************************************************************
+ *
+ * PostGIS - Spatial Types for PostgreSQL
+ * http://postgis.net
+ *
+ * PostGIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * PostGIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PostGIS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **********************************************************************
+ *
+ * Copyright 2015 Paul Ramsey <pramsey@cleverelephant.ca>
+ *
+ **********************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "liblwgeom_internal.h"
+#include "lwgeom_log.h"
+
+/*
+* Subdivision works off an explicit stack of pieces still to look at.
+* A piece under the vertex limit is handed out as it is, a collection
+* is replaced by its members, and anything else is cut in two at the
+* median vertex ordinate along its longer side. Cutting at the median
+* keeps the two halves balanced in vertex count whatever the density
+* of the data, so the number of passes stays logarithmic.
+*
+* Points, lines and polygons are cut natively against the half-plane,
+* in one pass per side and without leaving liblwgeom. Other types, and
+* polygons whose rings don't line up as a valid polygon's should, fall
+* back on GEOS rectangle clipping.
+*/
+
+#define SUBDIVIDE_MAX_DEPTH 50
+#define SUBDIVIDE_MIN_VERTICES 8
+
+typedef struct
+{
+	LWGEOM *geom;
+	int depth;
+	int owned; /* Piece was produced by us, free it once it's used */
+} SUBDIVIDE_ITEM;
+
+struct LWSUBDIVIDEITERATOR
+{
+	SUBDIVIDE_ITEM *stack;
+	int nstack;
+	int maxstack;
+	int maxvertices;
+	int srid;
+	double *ords; /* Scratch space for median finding */
+	size_t maxords;
+};
+
+/* Crossing of a ring with the cut, for chaining the pieces up */
+typedef struct
+{
+	double key;  /* Position along the cut, in travel direction */
+	int chain;
+	int is_exit;
+} SUBDIVIDE_CROSSING;
+
+static inline double
+subdivide_ord(const POINT4D *p, int axis)
+{
+	return axis ? p->y : p->x;
+}
+
+/*
+* A point is below the cut when its ordinate is strictly less than
+* the cut value. Points on the cut go above, so that both sides agree
+* on every classification and every crossing.
+*/
+static inline int
+subdivide_in(const POINT4D *p, int axis, double cut, int side)
+{
+	int below = subdivide_ord(p, axis) < cut;
+	return side ? ! below : below;
+}
+
+/*
+* Polygon rings are cut on the open sides instead: a vertex on the cut
+* belongs to neither, and the boundary along the cut is rebuilt from
+* the crossings, the same way for both sides.
+*/
+static inline int
+subdivide_strictly_in(const POINT4D *p, int axis, double cut, int side)
+{
+	double ord = subdivide_ord(p, axis);
+	return side ? ord > cut : ord < cut;
+}
+
+/*
+* Point where the edge p-q meets the cut. It is always computed from
+* the endpoint below the cut, so that both sides, and both directions
+* of travel, get exactly the same point.
+*/
+static void
+subdivide_crossing(const POINT4D *p, const POINT4D *q, int axis, double cut, POINT4D *r)
+{
+	const POINT4D *b, *a;
+	double t;
+
+	if ( subdivide_ord(p, axis) < cut )
+	{
+		b = p; a = q;
+	}
+	else
+	{
+		b = q; a = p;
+	}
+
+	if ( subdivide_ord(a, axis) == cut )
+	{
+		*r = *a;
+		return;
+	}
+
+	t = (cut - subdivide_ord(b, axis)) / (subdivide_ord(a, axis) - subdivide_ord(b, axis));
+	r->x = b->x + t * (a->x - b->x);
+	r->y = b->y + t * (a->y - b->y);
+	r->z = b->z + t * (a->z - b->z);
+	r->m = b->m + t * (a->m - b->m);
+	if ( axis )
+		r->y = cut;
+	else
+		r->x = cut;
+}
+
+/*
+* Nth element selection on a scratch array, returns the median value.
+*/
+static double
+subdivide_median(double *v, long n)
+{
+	long lo = 0, hi = n - 1, k = n / 2;
+
+	while ( hi > lo )
+	{
+		double pivot = v[lo + (hi - lo) / 2];
+		long i = lo, j = hi;
+
+		while ( i <= j )
+		{
+			while ( v[i] < pivot ) i++;
+			while ( v[j] > pivot ) j--;
+			if ( i <= j )
+			{
+				double tmp = v[i];
+				v[i] = v[j];
+				v[j] = tmp;
+				i++;
+				j--;
+			}
+		}
+
+		if ( k <= j )
+			hi = j;
+		else if ( k >= i )
+			lo = i;
+		else
+			break;
+	}
+	return v[k];
+}
+
+static void
+subdivide_gather_ptarray(LWSUBDIVIDEITERATOR *it, const POINTARRAY *pa, int axis, size_t *n)
+{
+	int i;
+
+	if ( *n + pa->npoints > it->maxords )
+	{
+		it->maxords = 2 * (*n + pa->npoints);
+		it->ords = lwrealloc(it->ords, sizeof(double) * it->maxords);
+	}
+	for ( i = 0; i < pa->npoints; i++ )
+	{
+		const POINT2D *p = getPoint2d_cp(pa, i);
+		it->ords[(*n)++] = axis ? p->y : p->x;
+	}
+}
+
+/*
+* Pick the cut for a piece: the longer side of its box, at the median
+* of the vertex ordinates along that side. Returns LW_FALSE when the
+* piece has no extent to cut.
+*/
+static int
+subdivide_pick_cut(LWSUBDIVIDEITERATOR *it, const LWGEOM *geom, const GBOX *box, int *axis, double *cut)
+{
+	double width = box->xmax - box->xmin;
+	double height = box->ymax - box->ymin;
+	double omin, omax, median;
+	size_t n = 0;
+	int i;
+
+	if ( width == 0.0 && height == 0.0 )
+		return LW_FALSE;
+
+	*axis = width > height ? 0 : 1;
+	omin = *axis ? box->ymin : box->xmin;
+	omax = *axis ? box->ymax : box->xmax;
+	*cut = (omin + omax) / 2;
+
+	switch ( geom->type )
+	{
+		case LINETYPE:
+			subdivide_gather_ptarray(it, ((LWLINE*)geom)->points, *axis, &n);
+			break;
+		case POLYGONTYPE:
+		{
+			const LWPOLY *poly = (const LWPOLY*)geom;
+			for ( i = 0; i < poly->nrings; i++ )
+				subdivide_gather_ptarray(it, poly->rings[i], *axis, &n);
+			break;
+		}
+		case MULTIPOINTTYPE:
+		{
+			const LWMPOINT *mpoint = (const LWMPOINT*)geom;
+			for ( i = 0; i < mpoint->ngeoms; i++ )
+				subdivide_gather_ptarray(it, mpoint->geoms[i]->point, *axis, &n);
+			break;
+		}
+		default:
+			/* Box middle for everything else */
+			return LW_TRUE;
+	}
+
+	if ( n > 0 )
+	{
+		median = subdivide_median(it->ords, n);
+		/*
+		* Vertices piled up on the edge of the box, typically where earlier
+		* cuts went, would leave one side of a median cut without any.
+		*/
+		if ( median > omin && median < omax )
+			*cut = median;
+	}
+	return LW_TRUE;
+}
+
+static LWGEOM *
+subdivide_finish(LWCOLLECTION *col)
+{
+	if ( col->ngeoms == 0 )
+	{
+		lwcollection_free(col);
+		return NULL;
+	}
+	if ( col->ngeoms == 1 )
+	{
+		LWGEOM *g = col->geoms[0];
+		lwfree(col->geoms);
+		lwcollection_release(col);
+		return g;
+	}
+	return lwcollection_as_lwgeom(col);
+}
+
+static void
+lwmpoint_split(const LWMPOINT *mpoint, int axis, double cut, LWGEOM **below, LWGEOM **above)
+{
+	int hasz = FLAGS_GET_Z(mpoint->flags);
+	int hasm = FLAGS_GET_M(mpoint->flags);
+	LWCOLLECTION *out[2];
+	int i;
+
+	out[0] = lwcollection_construct_empty(MULTIPOINTTYPE, mpoint->srid, hasz, hasm);
+	out[1] = lwcollection_construct_empty(MULTIPOINTTYPE, mpoint->srid, hasz, hasm);
+	for ( i = 0; i < mpoint->ngeoms; i++ )
+	{
+		const LWPOINT *pt = mpoint->geoms[i];
+		POINT4D p;
+		if ( lwpoint_is_empty(pt) ) continue;
+		getPoint4d_p(pt->point, 0, &p);
+		lwcollection_add_lwgeom(out[subdivide_in(&p, axis, cut, 1)], lwgeom_clone_deep(lwpoint_as_lwgeom(pt)));
+	}
+	*below = subdivide_finish(out[0]);
+	*above = subdivide_finish(out[1]);
+}
+
+/*
+* Lines just fall apart into runs of vertices on either side, each
+* run carrying the crossing points at its ends.
+*/
+static void
+lwline_split(const LWLINE *line, int axis, double cut, LWGEOM **below, LWGEOM **above)
+{
+	const POINTARRAY *pa = line->points;
+	int hasz = FLAGS_GET_Z(line->flags);
+	int hasm = FLAGS_GET_M(line->flags);
+	LWCOLLECTION *out[2];
+	POINTARRAY *run;
+	POINT4D p, q, r;
+	int i, side;
+
+	out[0] = lwcollection_construct_empty(MULTILINETYPE, line->srid, hasz, hasm);
+	out[1] = lwcollection_construct_empty(MULTILINETYPE, line->srid, hasz, hasm);
+
+	getPoint4d_p(pa, 0, &p);
+	side = subdivide_in(&p, axis, cut, 1);
+	run = ptarray_construct_empty(hasz, hasm, 8);
+	ptarray_append_point(run, &p, LW_FALSE);
+
+	for ( i = 1; i < pa->npoints; i++ )
+	{
+		getPoint4d_p(pa, i, &q);
+		if ( subdivide_in(&q, axis, cut, 1) != side )
+		{
+			subdivide_crossing(&p, &q, axis, cut, &r);
+			ptarray_append_point(run, &r, LW_FALSE);
+			if ( run->npoints > 1 )
+				lwcollection_add_lwgeom(out[side], lwline_as_lwgeom(lwline_construct(line->srid, NULL, run)));
+			else
+				ptarray_free(run);
+			side = ! side;
+			run = ptarray_construct_empty(hasz, hasm, 8);
+			ptarray_append_point(run, &r, LW_FALSE);
+		}
+		ptarray_append_point(run, &q, LW_FALSE);
+		p = q;
+	}
+
+	if ( run->npoints > 1 )
+		lwcollection_add_lwgeom(out[side], lwline_as_lwgeom(lwline_construct(line->srid, NULL, run)));
+	else
+		ptarray_free(run);
+
+	*below = subdivide_finish(out[0]);
+	*above = subdivide_finish(out[1]);
+}
+
+static int
+subdivide_crossing_cmp(const void *a, const void *b)
+{
+	const SUBDIVIDE_CROSSING *ca = (const SUBDIVIDE_CROSSING*)a;
+	const SUBDIVIDE_CROSSING *cb = (const SUBDIVIDE_CROSSING*)b;
+	if ( ca->key < cb->key ) return -1;
+	if ( ca->key > cb->key ) return 1;
+	return 0;
+}
+
+/*
+* One side of a polygon cut by an axis-parallel line.
+*
+* Rings are walked with the interior on their left (shell counter
+* clockwise, holes clockwise), and cut into chains that enter the side
+* at one crossing and leave it at another. Along the cut the boundary
+* of the side then runs in one fixed direction, so sorting crossings in
+* that direction gives exit, entry, exit, entry... and each exit joins
+* the entry that follows it. Walking chains through these joins closes
+* the shells of the output; holes wholly on the side are then handed to
+* the shell containing them.
+*
+* Returns LW_FAILURE when the crossings don't pair up, which only
+* happens on invalid input, leaving the caller to clip some other way.
+*/
+static int
+lwpoly_split_side(const LWPOLY *poly, int axis, double cut, int side, LWGEOM **out)
+{
+	int hasz = FLAGS_GET_Z(poly->flags);
+	int hasm = FLAGS_GET_M(poly->flags);
+	/* Direction of travel along the cut, keeping this side on the left */
+	double dir = ((axis == 0) == (side == 0)) ? 1.0 : -1.0;
+	int shell_cw, shell_whole = LW_FALSE;
+	POINTARRAY **chains = NULL;
+	POINTARRAY **holes = NULL;
+	POINTARRAY **shells = NULL;
+	SUBDIVIDE_CROSSING *crossings = NULL;
+	int *next = NULL;
+	int nchains = 0, nholes = 0, nshells = 0, ncrossings = 0;
+	int maxchains = 0;
+	int i, j, rv = LW_SUCCESS;
+	LWCOLLECTION *col;
+
+	*out = NULL;
+	if ( poly->nrings < 1 || poly->rings[0]->npoints < 4 )
+		return LW_SUCCESS;
+
+	shell_cw = ! ptarray_isccw(poly->rings[0]);
+	holes = lwalloc(sizeof(POINTARRAY*) * poly->nrings);
+
+	for ( i = 0; i < poly->nrings; i++ )
+	{
+		const POINTARRAY *pa = poly->rings[i];
+		int n = pa->npoints;
+		int reverse, start = -1, nin = 0;
+		POINTARRAY *chain = NULL;
+		POINT4D p, q, r;
+
+		if ( n < 4 ) continue;
+
+		for ( j = 0; j < n - 1; j++ )
+		{
+			getPoint4d_p(pa, j, &p);
+			if ( subdivide_strictly_in(&p, axis, cut, side) )
+				nin++;
+			else if ( start < 0 )
+				start = j;
+		}
+
+		/* Ring wholly on the other side, or on the cut */
+		if ( nin == 0 )
+		{
+			if ( i == 0 ) goto done;
+			continue;
+		}
+
+		/* Ring wholly on this side */
+		if ( start < 0 )
+		{
+			if ( i == 0 )
+				shell_whole = LW_TRUE;
+			else
+				holes[nholes++] = ptarray_clone_deep(pa);
+			continue;
+		}
+
+		/* Walk the distinct vertices in interior-left order, from one outside */
+		reverse = (i == 0) ? shell_cw : ptarray_isccw(pa);
+		if ( reverse )
+			start = n - 1 - start;
+#define RING_VERTEX(k) (reverse ? (n - 1 - ((k) % (n - 1))) % (n - 1) : (k) % (n - 1))
+
+		getPoint4d_p(pa, RING_VERTEX(start), &p);
+		for ( j = 1; j < n; j++ )
+		{
+			int pin, qin;
+			getPoint4d_p(pa, RING_VERTEX(start + j), &q);
+			pin = subdivide_strictly_in(&p, axis, cut, side);
+			qin = subdivide_strictly_in(&q, axis, cut, side);
+
+			if ( pin && qin )
+			{
+				ptarray_append_point(chain, &q, LW_FALSE);
+				p = q;
+				continue;
+			}
+
+			/*
+			* Edges along the cut, or wholly outside, are left out: the
+			* joins between crossings stand in for them, so a vertex on the
+			* cut is an exit or an entry point itself.
+			*/
+			if ( pin )
+			{
+				if ( subdivide_ord(&q, axis) == cut )
+					r = q;
+				else
+					subdivide_crossing(&p, &q, axis, cut, &r);
+				ptarray_append_point(chain, &r, LW_FALSE);
+				chains[nchains] = chain;
+				crossings[ncrossings].key = dir * (axis ? r.x : r.y);
+				crossings[ncrossings].chain = nchains;
+				crossings[ncrossings].is_exit = LW_TRUE;
+				ncrossings++;
+				nchains++;
+				chain = NULL;
+			}
+
+			if ( qin )
+			{
+				if ( subdivide_ord(&p, axis) == cut )
+					r = p;
+				else
+					subdivide_crossing(&p, &q, axis, cut, &r);
+				if ( nchains == maxchains )
+				{
+					maxchains = maxchains ? 2 * maxchains : 8;
+					chains = lwrealloc(chains, sizeof(POINTARRAY*) * maxchains);
+					crossings = lwrealloc(crossings, sizeof(SUBDIVIDE_CROSSING) * 2 * maxchains);
+				}
+				chain = ptarray_construct_empty(hasz, hasm, 8);
+				ptarray_append_point(chain, &r, LW_FALSE);
+				ptarray_append_point(chain, &q, LW_FALSE);
+				crossings[ncrossings].key = dir * (axis ? r.x : r.y);
+				crossings[ncrossings].chain = nchains;
+				crossings[ncrossings].is_exit = LW_FALSE;
+				ncrossings++;
+			}
+			p = q;
+		}
+#undef RING_VERTEX
+	}
+
+	if ( shell_whole )
+	{
+		/* Shell untouched, so only holes can be, and they can't cross it */
+		if ( nchains > 0 )
+		{
+			rv = LW_FAILURE;
+			goto done;
+		}
+		shells = lwalloc(sizeof(POINTARRAY*));
+		shells[nshells++] = ptarray_clone_deep(poly->rings[0]);
+	}
+	else
+	{
+		int *seen;
+
+		/*
+		* Sort the crossings along the cut, they have to alternate exit,
+		* entry. Coincident crossings are put in the order that makes it so.
+		*/
+		qsort(crossings, ncrossings, sizeof(SUBDIVIDE_CROSSING), subdivide_crossing_cmp);
+		for ( i = 0; i < ncrossings; i++ )
+		{
+			int want_exit = ! (i % 2);
+			if ( crossings[i].is_exit == want_exit ) continue;
+			for ( j = i + 1; j < ncrossings && crossings[j].key == crossings[i].key; j++ )
+			{
+				if ( crossings[j].is_exit == want_exit )
+				{
+					SUBDIVIDE_CROSSING tmp = crossings[i];
+					crossings[i] = crossings[j];
+					crossings[j] = tmp;
+					break;
+				}
+			}
+			if ( crossings[i].is_exit != want_exit )
+			{
+				rv = LW_FAILURE;
+				goto done;
+			}
+		}
+
+		next = lwalloc(sizeof(int) * (nchains + 1));
+		for ( i = 0; i < ncrossings; i += 2 )
+			next[crossings[i].chain] = crossings[i+1].chain;
+
+		/* Follow the joins round into closed rings */
+		seen = lwalloc(sizeof(int) * (nchains + 1));
+		memset(seen, 0, sizeof(int) * (nchains + 1));
+		shells = lwalloc(sizeof(POINTARRAY*) * (nchains + 1));
+		for ( i = 0; i < nchains; i++ )
+		{
+			POINTARRAY *ring;
+			POINT4D first;
+			int c = i;
+
+			if ( seen[i] ) continue;
+			ring = ptarray_construct_empty(hasz, hasm, chains[i]->npoints + 1);
+			do
+			{
+				if ( seen[c] )
+				{
+					ptarray_free(ring);
+					lwfree(seen);
+					rv = LW_FAILURE;
+					goto done;
+				}
+				seen[c] = LW_TRUE;
+				for ( j = 0; j < chains[c]->npoints; j++ )
+				{
+					getPoint4d_p(chains[c], j, &first);
+					ptarray_append_point(ring, &first, LW_FALSE);
+				}
+				c = next[c];
+			}
+			while ( c != i );
+
+			/* Close it, unless the last join already came back to the start */
+			getPoint4d_p(ring, 0, &first);
+			ptarray_append_point(ring, &first, LW_FALSE);
+
+			/* Slivers along the cut have nothing inside */
+			if ( ring->npoints < 4 || ptarray_signed_area(ring) == 0.0 )
+			{
+				ptarray_free(ring);
+				continue;
+			}
+			/* Built counter clockwise, give it the input orientation */
+			if ( shell_cw )
+				ptarray_reverse(ring);
+			shells[nshells++] = ring;
+		}
+		lwfree(seen);
+	}
+
+	if ( nshells == 0 )
+		goto done;
+
+	/* Hand out the untouched holes */
+	{
+		LWPOLY **polys = lwalloc(sizeof(LWPOLY*) * nshells);
+
+		for ( i = 0; i < nshells; i++ )
+		{
+			polys[i] = lwpoly_construct_empty(poly->srid, hasz, hasm);
+			lwpoly_add_ring(polys[i], shells[i]);
+		}
+		for ( i = 0; i < nholes; i++ )
+		{
+			int owner = -1;
+
+			if ( nshells == 1 )
+			{
+				owner = 0;
+			}
+			else
+			{
+				int k, s;
+				/* First vertex that is clearly inside or outside decides */
+				for ( k = 0; k < holes[i]->npoints && owner < 0; k++ )
+				{
+					const POINT2D *pt = getPoint2d_cp(holes[i], k);
+					for ( s = 0; s < nshells; s++ )
+					{
+						int loc = ptarray_contains_point(shells[s], pt);
+						if ( loc == LW_INSIDE )
+						{
+							owner = s;
+							break;
+						}
+						if ( loc == LW_BOUNDARY )
+							break;
+					}
+					if ( s == nshells && owner < 0 )
+						break;
+				}
+			}
+
+			if ( owner < 0 )
+				ptarray_free(holes[i]);
+			else
+				lwpoly_add_ring(polys[owner], holes[i]);
+		}
+		nholes = 0;
+
+		if ( nshells == 1 )
+		{
+			*out = lwpoly_as_lwgeom(polys[0]);
+		}
+		else
+		{
+			col = lwcollection_construct_empty(MULTIPOLYGONTYPE, poly->srid, hasz, hasm);
+			for ( i = 0; i < nshells; i++ )
+				lwcollection_add_lwgeom(col, lwpoly_as_lwgeom(polys[i]));
+			*out = lwcollection_as_lwgeom(col);
+		}
+		lwfree(polys);
+		nshells = 0;
+	}
+
+done:
+	for ( i = 0; i < nchains; i++ )
+		ptarray_free(chains[i]);
+	for ( i = 0; i < nholes; i++ )
+		ptarray_free(holes[i]);
+	for ( i = 0; i < nshells; i++ )
+		ptarray_free(shells[i]);
+	if ( chains ) lwfree(chains);
+	if ( crossings ) lwfree(crossings);
+	if ( next ) lwfree(next);
+	if ( shells ) lwfree(shells);
+	lwfree(holes);
+	return rv;
+}
+
+/*
+* Cut a geometry in two along the given axis, into the parts below
+* and above the cut value. Either part may come back NULL if empty.
+*/
+static int
+subdivide_split(const LWGEOM *geom, const GBOX *box, int axis, double cut, LWGEOM **below, LWGEOM **above)
+{
+	GBOX subbox1, subbox2;
+
+	*below = *above = NULL;
+
+	switch ( geom->type )
+	{
+		case MULTIPOINTTYPE:
+			lwmpoint_split((LWMPOINT*)geom, axis, cut, below, above);
+			return LW_SUCCESS;
+		case LINETYPE:
+			lwline_split((LWLINE*)geom, axis, cut, below, above);
+			return LW_SUCCESS;
+		case POLYGONTYPE:
+			if ( lwpoly_split_side((LWPOLY*)geom, axis, cut, 0, below) == LW_SUCCESS &&
+			     lwpoly_split_side((LWPOLY*)geom, axis, cut, 1, above) == LW_SUCCESS )
+				return LW_SUCCESS;
+			if ( *below ) lwgeom_free(*below);
+			if ( *above ) lwgeom_free(*above);
+			*below = *above = NULL;
+			LWDEBUG(3, "native polygon cut failed, clipping with GEOS");
+			break;
+		default:
+			break;
+	}
+
+	subbox1 = subbox2 = *box;
+	if ( axis )
+		subbox1.ymax = subbox2.ymin = cut;
+	else
+		subbox1.xmax = subbox2.xmin = cut;
+
+	if ( box->ymax == box->ymin )
+	{
+		subbox1.ymax += FP_TOLERANCE;
+		subbox2.ymax += FP_TOLERANCE;
+		subbox1.ymin -= FP_TOLERANCE;
+		subbox2.ymin -= FP_TOLERANCE;
+	}
+
+	if ( box->xmax == box->xmin )
+	{
+		subbox1.xmax += FP_TOLERANCE;
+		subbox2.xmax += FP_TOLERANCE;
+		subbox1.xmin -= FP_TOLERANCE;
+		subbox2.xmin -= FP_TOLERANCE;
+	}
+
+	*below = lwgeom_clip_by_rect(geom, subbox1.xmin, subbox1.ymin, subbox1.xmax, subbox1.ymax);
+	*above = lwgeom_clip_by_rect(geom, subbox2.xmin, subbox2.ymin, subbox2.xmax, subbox2.ymax);
+	return LW_SUCCESS;
+}
+
+static void
+subdivide_push(LWSUBDIVIDEITERATOR *it, LWGEOM *geom, int depth, int owned)
+{
+	if ( it->nstack == it->maxstack )
+	{
+		it->maxstack *= 2;
+		it->stack = lwrealloc(it->stack, sizeof(SUBDIVIDE_ITEM) * it->maxstack);
+	}
+	it->stack[it->nstack].geom = geom;
+	it->stack[it->nstack].depth = depth;
+	it->stack[it->nstack].owned = owned;
+	it->nstack++;
+}
+
+static LWGEOM *
+subdivide_emit(LWSUBDIVIDEITERATOR *it, SUBDIVIDE_ITEM *item)
+{
+	LWGEOM *out = item->owned ? item->geom : lwgeom_clone_deep(item->geom);
+	lwgeom_set_srid(out, it->srid);
+	return out;
+}
+
+static void
+subdivide_discard(SUBDIVIDE_ITEM *item)
+{
+	if ( item->owned )
+		lwgeom_free(item->geom);
+}
+
+LWSUBDIVIDEITERATOR *
+lwsubdivideiterator_create(const LWGEOM *geom, int maxvertices)
+{
+	LWSUBDIVIDEITERATOR *it;
+	const GBOX *box;
+
+	it = lwalloc(sizeof(LWSUBDIVIDEITERATOR));
+	it->maxstack = 64;
+	it->nstack = 0;
+	it->stack = lwalloc(sizeof(SUBDIVIDE_ITEM) * it->maxstack);
+	it->maxvertices = maxvertices;
+	it->srid = geom->srid;
+	it->maxords = 0;
+	it->ords = NULL;
+
+	if ( lwgeom_is_empty(geom) )
+		return it;
+
+	if ( maxvertices < SUBDIVIDE_MIN_VERTICES )
+	{
+		lwsubdivideiterator_destroy(it);
+		lwerror("%s: cannot subdivide to fewer than %d vertices per output", "lwgeom_subdivide", SUBDIVIDE_MIN_VERTICES);
+		return NULL;
+	}
+
+	/* Nothing but a point can be cut from a single location */
+	box = lwgeom_get_bbox(geom);
+	if ( box->xmax == box->xmin && box->ymax == box->ymin && geom->type != POINTTYPE )
+		return it;
+
+	subdivide_push(it, (LWGEOM*)geom, 0, LW_FALSE);
+	return it;
+}
+
+LWGEOM *
+lwsubdivideiterator_next(LWSUBDIVIDEITERATOR *it)
+{
+	while ( it->nstack > 0 )
+	{
+		SUBDIVIDE_ITEM item = it->stack[--it->nstack];
+		LWGEOM *geom = item.geom;
+		LWGEOM *below, *above;
+		GBOX box;
+		int nvertices, axis, i;
+		double cut;
+
+		if ( geom->type == POLYHEDRALSURFACETYPE || geom->type == TINTYPE )
+		{
+			lwerror("%s: unsupported geometry type '%s'", "lwgeom_subdivide", lwtype_name(geom->type));
+			return NULL;
+		}
+
+		/* Always just recurse into collections */
+		if ( lwgeom_is_collection(geom) && geom->type != MULTIPOINTTYPE )
+		{
+			LWCOLLECTION *col = (LWCOLLECTION*)geom;
+			/* Pushed backwards to come out in order, depth doesn't grow yet */
+			for ( i = col->ngeoms - 1; i >= 0; i-- )
+				subdivide_push(it, col->geoms[i], item.depth, item.owned);
+			/* The members now belong to the stack */
+			if ( item.owned )
+			{
+				if ( col->geoms ) lwfree(col->geoms);
+				lwcollection_release(col);
+			}
+			continue;
+		}
+
+		/* But don't go too far. 2^50 ~= 10^15, that's enough subdivision */
+		/* Just add what's left */
+		if ( item.depth > SUBDIVIDE_MAX_DEPTH )
+			return subdivide_emit(it, &item);
+
+		nvertices = lwgeom_count_vertices(geom);
+		/* Skip empties entirely */
+		if ( nvertices == 0 )
+		{
+			subdivide_discard(&item);
+			continue;
+		}
+
+		/* If it is under the vertex tolerance, just add it, we're done */
+		if ( nvertices < it->maxvertices )
+			return subdivide_emit(it, &item);
+
+		if ( lwgeom_calculate_gbox(geom, &box) == LW_FAILURE ||
+		     ! subdivide_pick_cut(it, geom, &box, &axis, &cut) )
+			return subdivide_emit(it, &item);
+
+		subdivide_split(geom, &box, axis, cut, &below, &above);
+		subdivide_discard(&item);
+
+		/* Below is looked at first */
+		if ( above )
+			subdivide_push(it, above, item.depth + 1, LW_TRUE);
+		if ( below )
+			subdivide_push(it, below, item.depth + 1, LW_TRUE);
+	}
+	return NULL;
+}
+
+void
+lwsubdivideiterator_destroy(LWSUBDIVIDEITERATOR *it)
+{
+	int i;
+	for ( i = 0; i < it->nstack; i++ )
+		subdivide_discard(&it->stack[i]);
+	if ( it->ords )
+		lwfree(it->ords);
+	lwfree(it->stack);
+	lwfree(it);
+}
+
+LWCOLLECTION *
+lwgeom_subdivide(const LWGEOM *geom, int maxvertices)
+{
+	LWSUBDIVIDEITERATOR *it;
+	LWCOLLECTION *col;
+	LWGEOM *piece;
+
+	it = lwsubdivideiterator_create(geom, maxvertices);
+	if ( ! it )
+		return NULL;
+
+	col = lwcollection_construct_empty(COLLECTIONTYPE, geom->srid, lwgeom_has_z(geom), lwgeom_has_m(geom));
+	while ( (piece = lwsubdivideiterator_next(it)) )
+		lwcollection_add_lwgeom(col, piece);
+	lwsubdivideiterator_destroy(it);
+
+	return col;
+}
@@ -63,6 +63,19 @@ lwgeom_furthest_point(const LWGEOM *lw1, const LWGEOM *lw2)
 }
 
 
+LWGEOM *
+lwgeom_closest_line_tree(const LWGEOM *lw1, const LWGEOM *lw2, const LWDISTTREE *dtree)
+{
+  return lw_dist2d_distanceline_tree(lw1, lw2, lw1->srid, DIST_MIN, dtree);
+}
+
+LWGEOM *
+lwgeom_closest_point_tree(const LWGEOM *lw1, const LWGEOM *lw2, const LWDISTTREE *dtree)
+{
+  return lw_dist2d_distancepoint_tree(lw1, lw2, lw1->srid, DIST_MIN, dtree);
+}
+
+
 void
 lw_dist2d_distpts_init(DISTPTS *dl, int mode)
 {
@@ -71,6 +84,7 @@ lw_dist2d_distpts_init(DISTPTS *dl, int mode)
 	dl->p2.x = dl->p2.y = 0.0;
 	dl->mode = mode;
 	dl->tolerance = 0.0;
+	dl->tree = NULL;
 	if ( mode == DIST_MIN )
 		dl->distance = FLT_MAX;
 	else
@@ -82,6 +96,16 @@ Function initializing shortestline and longestline calculations.
 */
 LWGEOM *
 lw_dist2d_distanceline(const LWGEOM *lw1, const LWGEOM *lw2, int srid, int mode)
+{
+	return lw_dist2d_distanceline_tree(lw1, lw2, srid, mode, NULL);
+}
+
+/**
+Function initializing shortestline and longestline calculations,
+using the segment trees in dtree where they apply.
+*/
+LWGEOM *
+lw_dist2d_distanceline_tree(const LWGEOM *lw1, const LWGEOM *lw2, int srid, int mode, const LWDISTTREE *dtree)
 {
 	double x1,x2,y1,y2;
 
@@ -90,9 +114,9 @@ lw_dist2d_distanceline(const LWGEOM *lw1, const LWGEOM *lw2, int srid, int mode)
 	LWPOINT *lwpoints[2];
 	LWGEOM *result;
 
-	thedl.mode = mode;
+	lw_dist2d_distpts_init(&thedl, mode);
 	thedl.distance = initdistance;
-	thedl.tolerance = 0.0;
+	thedl.tree = dtree;
 
 	LWDEBUG(2, "lw_dist2d_distanceline is called");
 
@@ -129,15 +153,25 @@ Function initializing closestpoint calculations.
 */
 LWGEOM *
 lw_dist2d_distancepoint(const LWGEOM *lw1, const LWGEOM *lw2,int srid,int mode)
+{
+	return lw_dist2d_distancepoint_tree(lw1, lw2, srid, mode, NULL);
+}
+
+/**
+Function initializing closestpoint calculations,
+using the segment trees in dtree where they apply.
+*/
+LWGEOM *
+lw_dist2d_distancepoint_tree(const LWGEOM *lw1, const LWGEOM *lw2, int srid, int mode, const LWDISTTREE *dtree)
 {
 	double x,y;
 	DISTPTS thedl;
 	double initdistance = FLT_MAX;
 	LWGEOM *result;
 
-	thedl.mode = mode;
+	lw_dist2d_distpts_init(&thedl, mode);
 	thedl.distance= initdistance;
-	thedl.tolerance = 0;
+	thedl.tree = dtree;
 
 	LWDEBUG(2, "lw_dist2d_distancepoint is called");
 
@@ -183,7 +217,7 @@ lwgeom_maxdistance2d_tolerance(const LWGEOM *lw1, const LWGEOM *lw2, double tole
 	/*double thedist;*/
 	DISTPTS thedl;
 	LWDEBUG(2, "lwgeom_maxdistance2d_tolerance is called");
-	thedl.mode = DIST_MAX;
+	lw_dist2d_distpts_init(&thedl, DIST_MAX);
 	thedl.distance= -1;
 	thedl.tolerance = tolerance;
 	if (lw_dist2d_comp( lw1,lw2,&thedl))
@@ -211,12 +245,22 @@ lwgeom_mindistance2d(const LWGEOM *lw1, const LWGEOM *lw2)
 */
 double
 lwgeom_mindistance2d_tolerance(const LWGEOM *lw1, const LWGEOM *lw2, double tolerance)
+{
+	return lwgeom_mindistance2d_tolerance_tree(lw1, lw2, tolerance, NULL);
+}
+
+/**
+	Min distance and dwithin calculations using the
+	segment trees in dtree where they apply.
+*/
+double
+lwgeom_mindistance2d_tolerance_tree(const LWGEOM *lw1, const LWGEOM *lw2, double tolerance, const LWDISTTREE *dtree)
 {
 	DISTPTS thedl;
 	LWDEBUG(2, "lwgeom_mindistance2d_tolerance is called");
-	thedl.mode = DIST_MIN;
-	thedl.distance= FLT_MAX;
+	lw_dist2d_distpts_init(&thedl, DIST_MIN);
 	thedl.tolerance = tolerance;
+	thedl.tree = dtree;
 	if (lw_dist2d_comp( lw1,lw2,&thedl))
 	{
 		return thedl.distance;
@@ -1154,6 +1198,35 @@ lw_dist2d_ptarray_ptarray(POINTARRAY *l1, POINTARRAY *l2,DISTPTS *dl)
 	}
 	else
 	{
+		/*Large arrays, or arrays with a prebuilt tree, are searched through a segment tree*/
+		if (dl->distance > dl->tolerance && l1->npoints > 1 && l2->npoints > 1)
+		{
+			const SEG_TREE *tree1 = NULL;
+			const SEG_TREE *tree2 = lw_dist_tree_lookup(dl->tree, l2);
+			SEG_TREE *tmptree = NULL;
+			int rv;
+
+			if (!tree2)
+				tree1 = lw_dist_tree_lookup(dl->tree, l1);
+			if (!tree1 && !tree2 &&
+			    l1->npoints > SEG_TREE_MIN_SEGS && l2->npoints > SEG_TREE_MIN_SEGS &&
+			    (double)(l1->npoints - 1) * (l2->npoints - 1) >= SEG_TREE_MIN_PAIRS)
+			{
+				/*Index the larger array, and probe it with the segments of the smaller one*/
+				tmptree = seg_tree_new(l2->npoints >= l1->npoints ? l2 : l1);
+				if (l2->npoints >= l1->npoints)
+					tree2 = tmptree;
+				else
+					tree1 = tmptree;
+			}
+			if (tree1 || tree2)
+			{
+				rv = lw_dist2d_segtree_ptarray_ptarray(l1, l2, tree1, tree2, dl);
+				seg_tree_free(tmptree);
+				return rv;
+			}
+		}
+
 		start = getPoint2d_cp(l1, 0);
 		for (t=1; t<l1->npoints; t++) /*for each segment in L1 */
 		{
@@ -2188,6 +2261,440 @@ End of New faster distance calculations
 --------------------------------------------------------------------------------------------------------------*/
 
 
+/*------------------------------------------------------------------------------------------------------------
+Indexed distance calculations
+Segment trees for large, overlapping point arrays
+--------------------------------------------------------------------------------------------------------------*/
+
+/**
+Builds the packed segment tree of a point array. Segments are
+ordered sort-tile-recursive, on the doubled x and y of their
+midpoints, and every SEG_TREE_NODE_SIZE consecutive nodes of a
+level get one parent. Returns NULL for arrays without segments.
+*/
+SEG_TREE *
+seg_tree_new(const POINTARRAY *pa)
+{
+	SEG_TREE *tree;
+	LISTSTRUCT *list;
+	const POINT2D *p, *q;
+	int nsegs, nnodes, nlevels, n, nslices, slicesize;
+	int i, j, k, l, first, last;
+	double *box, *child;
+
+	if ( ! pa || pa->npoints < 2 )
+		return NULL;
+	nsegs = pa->npoints - 1;
+
+	/* Count the levels and nodes, leaves included */
+	nnodes = nlevels = 0;
+	for ( n = nsegs; ; n = (n + SEG_TREE_NODE_SIZE - 1) / SEG_TREE_NODE_SIZE )
+	{
+		nnodes += n;
+		nlevels++;
+		if ( n == 1 ) break;
+	}
+
+	tree = lwalloc(sizeof(SEG_TREE));
+	tree->nsegs = nsegs;
+	tree->nnodes = nnodes;
+	tree->nlevels = nlevels;
+	tree->level = lwalloc(sizeof(int) * (nlevels + 1));
+	tree->seg = lwalloc(sizeof(int) * nsegs);
+	tree->minseg = lwalloc(sizeof(int) * nnodes);
+	tree->box = lwalloc(sizeof(double) * 4 * nnodes);
+	tree->maxabs = 0.0;
+
+	/* Sort on x, then cut in vertical slices sorted on y */
+	list = lwalloc(sizeof(LISTSTRUCT) * nsegs);
+	for ( i = 0; i < nsegs; i++ )
+	{
+		p = getPoint2d_cp(pa, i);
+		q = getPoint2d_cp(pa, i + 1);
+		list[i].themeasure = p->x + q->x;
+		list[i].pnr = i;
+	}
+	qsort(list, nsegs, sizeof(LISTSTRUCT), struct_cmp_by_measure);
+
+	n = (nsegs + SEG_TREE_NODE_SIZE - 1) / SEG_TREE_NODE_SIZE;
+	nslices = (int) ceil(sqrt((double) n));
+	slicesize = SEG_TREE_NODE_SIZE * ((n + nslices - 1) / nslices);
+	for ( first = 0; first < nsegs; first += slicesize )
+	{
+		last = FP_MIN(first + slicesize, nsegs);
+		for ( i = first; i < last; i++ )
+		{
+			p = getPoint2d_cp(pa, list[i].pnr);
+			q = getPoint2d_cp(pa, list[i].pnr + 1);
+			list[i].themeasure = p->y + q->y;
+		}
+		qsort(list + first, last - first, sizeof(LISTSTRUCT), struct_cmp_by_measure);
+	}
+
+	/* Leaves */
+	for ( i = 0; i < nsegs; i++ )
+	{
+		k = list[i].pnr;
+		p = getPoint2d_cp(pa, k);
+		q = getPoint2d_cp(pa, k + 1);
+		box = tree->box + 4 * i;
+		box[0] = FP_MIN(p->x, q->x);
+		box[1] = FP_MIN(p->y, q->y);
+		box[2] = FP_MAX(p->x, q->x);
+		box[3] = FP_MAX(p->y, q->y);
+		tree->seg[i] = k;
+		tree->minseg[i] = k;
+		tree->maxabs = FP_MAX(tree->maxabs, FP_MAX(FP_MAX(fabs(box[0]), fabs(box[1])), FP_MAX(fabs(box[2]), fabs(box[3]))));
+	}
+	lwfree(list);
+
+	/* Upper levels, each node covering a run of the level below */
+	tree->level[0] = 0;
+	tree->level[1] = nsegs;
+	for ( l = 1; l < nlevels; l++ )
+	{
+		n = tree->level[l] - tree->level[l-1];
+		tree->level[l+1] = tree->level[l] + (n + SEG_TREE_NODE_SIZE - 1) / SEG_TREE_NODE_SIZE;
+		for ( i = tree->level[l]; i < tree->level[l+1]; i++ )
+		{
+			first = tree->level[l-1] + (i - tree->level[l]) * SEG_TREE_NODE_SIZE;
+			last = FP_MIN(first + SEG_TREE_NODE_SIZE, tree->level[l]);
+			box = tree->box + 4 * i;
+			memcpy(box, tree->box + 4 * first, 4 * sizeof(double));
+			tree->minseg[i] = tree->minseg[first];
+			for ( j = first + 1; j < last; j++ )
+			{
+				child = tree->box + 4 * j;
+				box[0] = FP_MIN(box[0], child[0]);
+				box[1] = FP_MIN(box[1], child[1]);
+				box[2] = FP_MAX(box[2], child[2]);
+				box[3] = FP_MAX(box[3], child[3]);
+				tree->minseg[i] = FP_MIN(tree->minseg[i], tree->minseg[j]);
+			}
+		}
+	}
+
+	return tree;
+}
+
+void
+seg_tree_free(SEG_TREE *tree)
+{
+	if ( ! tree ) return;
+	lwfree(tree->level);
+	lwfree(tree->seg);
+	lwfree(tree->minseg);
+	lwfree(tree->box);
+	lwfree(tree);
+}
+
+/**
+The segment tree built for this very point array, if any
+*/
+const SEG_TREE *
+lw_dist_tree_lookup(const LWDISTTREE *dtree, const POINTARRAY *pa)
+{
+	int lo = 0, hi, mid;
+
+	if ( ! dtree ) return NULL;
+	hi = dtree->ntrees - 1;
+	while ( lo <= hi )
+	{
+		mid = (lo + hi) / 2;
+		if ( dtree->pa[mid] == pa )
+		{
+			/* The array changed under the tree */
+			if ( dtree->trees[mid]->nsegs != pa->npoints - 1 )
+				return NULL;
+			return dtree->trees[mid];
+		}
+		if ( (uintptr_t) dtree->pa[mid] < (uintptr_t) pa )
+			lo = mid + 1;
+		else
+			hi = mid - 1;
+	}
+	return NULL;
+}
+
+static void
+lw_dist_tree_add(LWDISTTREE *dtree, int *maxtrees, const POINTARRAY *pa)
+{
+	if ( pa->npoints - 1 < SEG_TREE_MIN_SEGS )
+		return;
+	if ( dtree->ntrees == *maxtrees )
+	{
+		*maxtrees *= 2;
+		dtree->pa = lwrealloc(dtree->pa, sizeof(POINTARRAY*) * *maxtrees);
+		dtree->trees = lwrealloc(dtree->trees, sizeof(SEG_TREE*) * *maxtrees);
+	}
+	dtree->pa[dtree->ntrees] = pa;
+	dtree->trees[dtree->ntrees] = seg_tree_new(pa);
+	dtree->ntrees++;
+}
+
+/*
+* Index the line and polygon ring point arrays of geom. Boxes
+* are added to every component here, since the distance code
+* adds the missing ones itself and geom may outlive the memory
+* that happens in.
+*/
+static void
+lw_dist_tree_collect(LWGEOM *geom, LWDISTTREE *dtree, int *maxtrees)
+{
+	int i;
+
+	if ( lwgeom_is_empty(geom) )
+		return;
+	lwgeom_add_bbox(geom);
+
+	if ( lwgeom_is_collection(geom) )
+	{
+		LWCOLLECTION *col = (LWCOLLECTION*)geom;
+		for ( i = 0; i < col->ngeoms; i++ )
+			lw_dist_tree_collect(col->geoms[i], dtree, maxtrees);
+	}
+	else if ( geom->type == LINETYPE )
+	{
+		lw_dist_tree_add(dtree, maxtrees, ((LWLINE*)geom)->points);
+	}
+	else if ( geom->type == POLYGONTYPE )
+	{
+		LWPOLY *poly = (LWPOLY*)geom;
+		for ( i = 0; i < poly->nrings; i++ )
+			lw_dist_tree_add(dtree, maxtrees, poly->rings[i]);
+	}
+}
+
+/**
+Builds the segment trees of all the large enough point arrays of
+geom, for repeated minimum distance calculations against it.
+Returns NULL when none of them is worth a tree.
+*/
+LWDISTTREE *
+lwgeom_distance_tree_new(LWGEOM *geom)
+{
+	LWDISTTREE *dtree;
+	int maxtrees = 4;
+	int i, j;
+
+	dtree = lwalloc(sizeof(LWDISTTREE));
+	dtree->ntrees = 0;
+	dtree->pa = lwalloc(sizeof(POINTARRAY*) * maxtrees);
+	dtree->trees = lwalloc(sizeof(SEG_TREE*) * maxtrees);
+
+	lw_dist_tree_collect(geom, dtree, &maxtrees);
+	if ( ! dtree->ntrees )
+	{
+		lwgeom_distance_tree_free(dtree);
+		return NULL;
+	}
+
+	/* Sort on array address for lookups; there are few arrays */
+	for ( i = 1; i < dtree->ntrees; i++ )
+	{
+		const POINTARRAY *pa = dtree->pa[i];
+		SEG_TREE *tree = dtree->trees[i];
+		for ( j = i; j > 0 && (uintptr_t) dtree->pa[j-1] > (uintptr_t) pa; j-- )
+		{
+			dtree->pa[j] = dtree->pa[j-1];
+			dtree->trees[j] = dtree->trees[j-1];
+		}
+		dtree->pa[j] = pa;
+		dtree->trees[j] = tree;
+	}
+	return dtree;
+}
+
+void
+lwgeom_distance_tree_free(LWDISTTREE *dtree)
+{
+	int i;
+	if ( ! dtree ) return;
+	for ( i = 0; i < dtree->ntrees; i++ )
+		seg_tree_free(dtree->trees[i]);
+	lwfree(dtree->pa);
+	lwfree(dtree->trees);
+	lwfree(dtree);
+}
+
+/* Is segment pair (t1,u1) before (t2,u2) in the exhaustive loop order? */
+static inline int
+lw_dist2d_segpair_before(int t1, int u1, int t2, int u2)
+{
+	return t1 < t2 || ( t1 == t2 && u1 < u2 );
+}
+
+/* Squared distance between a node box and the box of a segment */
+static inline double
+lw_dist2d_segtree_boxdist2(const double *box, const double *qbox)
+{
+	double dx = FP_MAX(0.0, FP_MAX(box[0] - qbox[2], qbox[0] - box[2]));
+	double dy = FP_MAX(0.0, FP_MAX(box[1] - qbox[3], qbox[1] - box[3]));
+	return dx * dx + dy * dy;
+}
+
+/**
+Minimum distance between two point arrays, searching the segment
+tree of one of them (tree2 if given, else tree1) once for each
+segment of the other one, with branch-and-bound on node boxes.
+
+The answer is the one of lw_dist2d_ptarray_ptarray, points and
+all: the first pair, in its loop order, within the tolerance, or
+else the first pair at the smallest distance. Only pairs that
+beat the distance already in dl are taken.
+*/
+int
+lw_dist2d_segtree_ptarray_ptarray(const POINTARRAY *l1, const POINTARRAY *l2, const SEG_TREE *tree1, const SEG_TREE *tree2, DISTPTS *dl)
+{
+	const SEG_TREE *tree = tree2 ? tree2 : tree1;
+	const POINTARRAY *probe = tree2 ? l1 : l2;
+	int swapped = tree2 ? LW_FALSE : LW_TRUE;
+	int twist = dl->twisted;
+	double tolerance = dl->tolerance;
+	DISTPTS best, dltmp;
+	int found = LW_FALSE, within = LW_FALSE;
+	int best_t = 0, best_u = 0;
+	int stack_node[SEG_TREE_NODE_SIZE * 32];
+	int stack_level[SEG_TREE_NODE_SIZE * 32];
+	double stack_dist[SEG_TREE_NODE_SIZE * 32];
+	int sp, node, l, first, last, i, j, k, t, u;
+	double qbox[4], slack, limit, d2;
+	const POINT2D *A, *B;
+
+	if ( l1->npoints < 2 || l2->npoints < 2 )
+		return LW_TRUE;
+	if ( ! tree || tree->nlevels > 32 )
+		return lw_dist2d_ptarray_ptarray((POINTARRAY*)l1, (POINTARRAY*)l2, dl);
+
+	LWDEBUGF(2, "lw_dist2d_segtree_ptarray_ptarray called (points: %d-%d)", l1->npoints, l2->npoints);
+
+	/* Node boxes are a lower bound up to rounding of the segment distances */
+	slack = tree->maxabs;
+	for ( i = 0; i < probe->npoints; i++ )
+	{
+		A = getPoint2d_cp(probe, i);
+		slack = FP_MAX(slack, FP_MAX(fabs(A->x), fabs(A->y)));
+	}
+	slack = (slack + 1.0) * 1e-12;
+
+	best = *dl;
+
+	for ( i = 0; i < probe->npoints - 1; i++ )
+	{
+		/* With l1 probing, later segments all come after a pair within tolerance */
+		if ( within && ! swapped )
+			break;
+
+		A = getPoint2d_cp(probe, i);
+		B = getPoint2d_cp(probe, i + 1);
+		qbox[0] = FP_MIN(A->x, B->x);
+		qbox[1] = FP_MIN(A->y, B->y);
+		qbox[2] = FP_MAX(A->x, B->x);
+		qbox[3] = FP_MAX(A->y, B->y);
+
+		sp = 0;
+		stack_node[sp] = tree->nnodes - 1;
+		stack_level[sp] = tree->nlevels - 1;
+		stack_dist[sp] = lw_dist2d_segtree_boxdist2(tree->box + 4 * (tree->nnodes - 1), qbox);
+		sp++;
+
+		while ( sp > 0 )
+		{
+			sp--;
+			node = stack_node[sp];
+			l = stack_level[sp];
+			limit = ( within ? tolerance : best.distance ) + slack;
+			if ( stack_dist[sp] > limit * limit )
+				continue;
+
+			/* Nothing below can come before the pair within tolerance */
+			if ( within )
+			{
+				t = swapped ? tree->minseg[node] : i;
+				u = swapped ? i : tree->minseg[node];
+				if ( ! lw_dist2d_segpair_before(t, u, best_t, best_u) )
+					continue;
+			}
+
+			if ( l == 0 )
+			{
+				j = tree->seg[node];
+				t = swapped ? j : i;
+				u = swapped ? i : j;
+				lw_dist2d_distpts_init(&dltmp, DIST_MIN);
+				dltmp.twisted = twist;
+				lw_dist2d_seg_seg(getPoint2d_cp(l1, t), getPoint2d_cp(l1, t + 1),
+				                  getPoint2d_cp(l2, u), getPoint2d_cp(l2, u + 1), &dltmp);
+
+				if ( dltmp.distance <= tolerance )
+				{
+					if ( ! within || lw_dist2d_segpair_before(t, u, best_t, best_u) )
+					{
+						within = found = LW_TRUE;
+						best = dltmp;
+						best_t = t;
+						best_u = u;
+					}
+				}
+				else if ( ! within &&
+				          ( dltmp.distance < best.distance ||
+				            ( found && dltmp.distance == best.distance &&
+				              lw_dist2d_segpair_before(t, u, best_t, best_u) ) ) )
+				{
+					found = LW_TRUE;
+					best = dltmp;
+					best_t = t;
+					best_u = u;
+				}
+				continue;
+			}
+
+			/* Push the children, nearest on top */
+			first = tree->level[l-1] + (node - tree->level[l]) * SEG_TREE_NODE_SIZE;
+			last = FP_MIN(first + SEG_TREE_NODE_SIZE, tree->level[l]);
+			for ( j = first; j < last; j++ )
+			{
+				d2 = lw_dist2d_segtree_boxdist2(tree->box + 4 * j, qbox);
+				if ( d2 > limit * limit )
+					continue;
+				for ( k = sp; k > 0 && stack_level[k-1] == l - 1 && stack_dist[k-1] < d2; k-- )
+				{
+					stack_node[k] = stack_node[k-1];
+					stack_level[k] = stack_level[k-1];
+					stack_dist[k] = stack_dist[k-1];
+				}
+				stack_node[k] = j;
+				stack_level[k] = l - 1;
+				stack_dist[k] = d2;
+				sp++;
+			}
+		}
+	}
+
+	if ( found )
+	{
+		dl->distance = best.distance;
+		dl->p1 = best.p1;
+		dl->p2 = best.p2;
+	}
+
+	/* Leave twisted as the last pair of the exhaustive loop leaves it */
+	t = within ? best_t : l1->npoints - 2;
+	u = within ? best_u : l2->npoints - 2;
+	lw_dist2d_distpts_init(&dltmp, DIST_MIN);
+	dltmp.twisted = twist;
+	lw_dist2d_seg_seg(getPoint2d_cp(l1, t), getPoint2d_cp(l1, t + 1),
+	                  getPoint2d_cp(l2, u), getPoint2d_cp(l2, u + 1), &dltmp);
+	dl->twisted = dltmp.twisted;
+
+	return LW_TRUE;
+}
+
+/*------------------------------------------------------------------------------------------------------------
+End of Indexed distance calculations
+--------------------------------------------------------------------------------------------------------------*/
+
+
 /*------------------------------------------------------------------------------------------------------------
 Functions in common for Brute force and new calculation
 --------------------------------------------------------------------------------------------------------------*/
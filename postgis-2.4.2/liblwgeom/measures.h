@@ -51,6 +51,7 @@ typedef struct
 	int mode;	/*the direction of looking, if thedir = -1 then we look for maxdistance and if it is 1 then we look for mindistance*/
 	int twisted; /*To preserve the order of incoming points to match the first and secon point in shortest and longest line*/
 	double tolerance; /*the tolerance for dwithin and dfullywithin*/
+	const LWDISTTREE *tree; /*prebuilt segment trees of one of the geometries, or NULL*/
 } DISTPTS;
 
 typedef struct
@@ -59,6 +60,43 @@ typedef struct
 	int pnr;	/*pointnumber. the ordernumber of the point*/
 } LISTSTRUCT;
 
+/* Fan-out of the packed segment tree */
+#define SEG_TREE_NODE_SIZE 8
+/* Segment pairs below which two point arrays are compared exhaustively */
+#define SEG_TREE_MIN_PAIRS 256
+/* Segments below which a point array is never indexed */
+#define SEG_TREE_MIN_SEGS 8
+
+/**
+* Packed segment tree over the edges of one point array, built
+* by sort-tile-recursive loading. Nodes of all levels live in one
+* array, leaves first and the root last. Leaf i stands for the
+* segment from point seg[i] to point seg[i]+1. Nodes only carry
+* segment numbers, so a tree serves any copy of its point array.
+*/
+typedef struct
+{
+	int nsegs;	/*number of segments, and of leaves*/
+	int nnodes;	/*number of nodes in all levels*/
+	int nlevels;
+	int *level;	/*index of the first node of each level, plus nnodes*/
+	int *seg;	/*segment of each leaf*/
+	int *minseg;	/*lowest segment number under each node*/
+	double *box;	/*xmin, ymin, xmax, ymax of each node*/
+	double maxabs;	/*largest absolute coordinate, to scale rounding slack*/
+} SEG_TREE;
+
+/**
+* The segment trees of a whole geometry, sorted on the
+* address of the point array each of them indexes.
+*/
+struct LWDISTTREE_T
+{
+	int ntrees;
+	const POINTARRAY **pa;
+	SEG_TREE **trees;
+};
+
 
 /*
 * Preprocessing functions
@@ -102,6 +140,14 @@ int lw_dist2d_selected_seg_seg(const POINT2D *A, const POINT2D *B, const POINT2D
 int struct_cmp_by_measure(const void *a, const void *b);
 int lw_dist2d_fast_ptarray_ptarray(POINTARRAY *l1,POINTARRAY *l2, DISTPTS *dl,  GBOX *box1, GBOX *box2);
 
+/*
+* Indexed distance calculations
+*/
+SEG_TREE* seg_tree_new(const POINTARRAY *pa);
+void seg_tree_free(SEG_TREE *tree);
+const SEG_TREE* lw_dist_tree_lookup(const LWDISTTREE *dtree, const POINTARRAY *pa);
+int lw_dist2d_segtree_ptarray_ptarray(const POINTARRAY *l1, const POINTARRAY *l2, const SEG_TREE *tree1, const SEG_TREE *tree2, DISTPTS *dl);
+
 /*
 * Distance calculation primitives.
 */
@@ -123,5 +169,7 @@ double lw_arc_length(const POINT2D *A1, const POINT2D *A2, const POINT2D *A3);
 */
 LWGEOM* lw_dist2d_distancepoint(const LWGEOM *lw1, const LWGEOM *lw2, int srid, int mode);
 LWGEOM* lw_dist2d_distanceline(const LWGEOM *lw1, const LWGEOM *lw2, int srid, int mode);
+LWGEOM* lw_dist2d_distancepoint_tree(const LWGEOM *lw1, const LWGEOM *lw2, int srid, int mode, const LWDISTTREE *dtree);
+LWGEOM* lw_dist2d_distanceline_tree(const LWGEOM *lw1, const LWGEOM *lw2, int srid, int mode, const LWDISTTREE *dtree);
 
 
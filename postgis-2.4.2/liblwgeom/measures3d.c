@@ -132,7 +132,7 @@ lw_dist3d_distanceline(const LWGEOM *lw1, const LWGEOM *lw2, int srid, int mode)
 			return lw_dist2d_distanceline(lw1, lw2, srid, mode);
 
 		DISTPTS thedl2d;
-		thedl2d.mode = mode;
+		lw_dist2d_distpts_init(&thedl2d, mode);
 		thedl2d.distance = initdistance;
 		thedl2d.tolerance = 0.0;
 		if (!lw_dist2d_comp( lw1,lw2,&thedl2d))
@@ -237,7 +237,7 @@ lw_dist3d_distancepoint(const LWGEOM *lw1, const LWGEOM *lw2, int srid, int mode
 
 
 		DISTPTS thedl2d;
-		thedl2d.mode = mode;
+		lw_dist2d_distpts_init(&thedl2d, mode);
 		thedl2d.distance = initdistance;
 		thedl2d.tolerance = 0.0;
 		if (!lw_dist2d_comp( lw1,lw2,&thedl2d))
@@ -183,6 +183,32 @@ ptarray_append_point(POINTARRAY *pa, const POINT4D *pt, int repeated_points)
 	return ptarray_insert_point(pa, pt, pa->npoints);
 }
 
+/**
+ * Ensure the point array can hold at least npoints points
+ */
+void
+ptarray_reserve(POINTARRAY *pa, uint32_t npoints)
+{
+	if ( npoints <= pa->maxpoints && pa->serialized_pointlist )
+		return;
+
+	if ( FLAGS_GET_READONLY(pa->flags) )
+	{
+		lwerror("ptarray_reserve: called on read-only point array");
+		return;
+	}
+
+	if ( pa->maxpoints == 0 || ! pa->serialized_pointlist )
+	{
+		pa->maxpoints = npoints > 32 ? npoints : 32;
+		pa->serialized_pointlist = lwalloc(ptarray_point_size(pa) * pa->maxpoints);
+		return;
+	}
+
+	do { pa->maxpoints *= 2; } while ( pa->maxpoints < npoints );
+	pa->serialized_pointlist = lwrealloc(pa->serialized_pointlist, ptarray_point_size(pa) * pa->maxpoints);
+}
+
 int
 ptarray_append_ptarray(POINTARRAY *pa1, POINTARRAY *pa2, double gap_tolerance)
 {
@@ -140,6 +140,39 @@ stringbuffer_append(stringbuffer_t *s, const char *a)
 	s->str_end += alen;
 }
 
+/**
+* Append the first len bytes of the specified string to the stringbuffer_t.
+*/
+void
+stringbuffer_append_len(stringbuffer_t *s, const char *a, size_t len)
+{
+	stringbuffer_makeroom(s, len + 1);
+	memcpy(s->str_end, a, len);
+	s->str_end += len;
+	*(s->str_end) = '\0';
+}
+
+/**
+* Append a double with at most precision decimals, without trailing
+* zeros, see lwprint_double. Formats straight into the buffer.
+*/
+void
+stringbuffer_append_double(stringbuffer_t *s, double d, int precision)
+{
+	int len;
+
+	stringbuffer_makeroom(s, OUT_DOUBLE_BUFFER_SIZE);
+	len = lwprint_double(d, precision, s->str_end, OUT_DOUBLE_BUFFER_SIZE);
+
+	/* Only with more decimals than OUT_MAX_DOUBLE_PRECISION */
+	if ( len >= OUT_DOUBLE_BUFFER_SIZE )
+	{
+		stringbuffer_makeroom(s, len + 1);
+		len = lwprint_double(d, precision, s->str_end, len + 1);
+	}
+	s->str_end += len;
+}
+
 /**
 * Returns a reference to the internal string being managed by
 * the stringbuffer. The current string will be null-terminated
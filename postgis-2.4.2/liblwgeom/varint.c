@@ -97,6 +97,29 @@ varint_s32_encode_buf(int32_t val, uint8_t *buf)
 	return _varint_u64_encode_buf((uint64_t)zigzag32(val), buf);
 }
 
+/**
+* Write an array of signed values as consecutive varints. The buffer
+* must have room for VARINT_MAX_SIZE bytes per value. Small deltas are
+* by far the common case in TWKB, so values that zig-zag into a single
+* byte are written without going through the general encoder.
+*/
+size_t
+varint_s64_encode_array(const int64_t *vals, size_t nvals, uint8_t *buf)
+{
+	uint8_t *ptr = buf;
+	size_t i;
+
+	for ( i = 0; i < nvals; i++ )
+	{
+		uint64_t q = zigzag64(vals[i]);
+		if ( q < 0x80 )
+			*ptr++ = (uint8_t)q;
+		else
+			ptr += _varint_u64_encode_buf(q, ptr);
+	}
+	return ptr - buf;
+}
+
 /* Read from signed 64bit varint */
 int64_t
 varint_s64_decode(const uint8_t *the_start, const uint8_t *the_end, size_t *size)
@@ -30,6 +30,8 @@
 #include <stdint.h>
 #include <stdlib.h>
 
+/* Largest encoding of a 64 bit value, 7 bits per byte */
+#define VARINT_MAX_SIZE 10
 
 /* NEW SIGNATURES */
 
@@ -37,6 +39,7 @@ size_t varint_u32_encode_buf(uint32_t val, uint8_t *buf);
 size_t varint_s32_encode_buf(int32_t val, uint8_t *buf);
 size_t varint_u64_encode_buf(uint64_t val, uint8_t *buf);
 size_t varint_s64_encode_buf(int64_t val, uint8_t *buf);
+size_t varint_s64_encode_array(const int64_t *vals, size_t nvals, uint8_t *buf);
 int64_t varint_s64_decode(const uint8_t *the_start, const uint8_t *the_end, size_t *size);
 uint64_t varint_u64_decode(const uint8_t *the_start, const uint8_t *the_end, size_t *size);
 
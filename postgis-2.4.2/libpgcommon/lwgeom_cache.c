@@ -101,11 +101,10 @@ GetPROJ4SRSCache(FunctionCallInfoData* fcinfo)
 			{
 				cache->PROJ4SRSCache[i].srid = SRID_UNKNOWN;
 				cache->PROJ4SRSCache[i].projection = NULL;
-				cache->PROJ4SRSCache[i].projection_mcxt = NULL;
+				cache->PROJ4SRSCache[i].slot = -1;
 			}
 			cache->type = PROJ_CACHE_ENTRY;
-			cache->PROJ4SRSCacheCount = 0;
-			cache->PROJ4SRSCacheContext = FIContext(fcinfo);
+			cache->PROJ4SRSCacheGeneration = 0;
 
 			/* Store the pointer in GenericCache */
 			generic_cache->entry[PROJ_CACHE_ENTRY] = (GenericCache*)cache;
@@ -225,3 +224,267 @@ GetGeomCache(FunctionCallInfoData* fcinfo, const GeomCacheMethods* cache_methods
 }
 
 
+
+/*
+* Backend cache of linearized curves
+*
+* Stroking the same CIRCULARSTRING-heavy geometries over and over
+* (ST_Area, ST_Intersects, ST_CurveToLine on a curved column) repeats
+* a trigonometric evaluation for every output vertex. liblwgeom calls
+* GetLinearizedCurve() for every curve it strokes once the handlers
+* are installed, and we keep the last results for the backend.
+*
+* Entries are keyed on the geometry content (type, dimensions and
+* coordinates of every component) plus the tolerance arguments, so
+* there is nothing to invalidate, and the same value read from two
+* different rows or statements hits the same entry. The SRID is not
+* part of the key, it is stamped on the copy handed back instead.
+* Least recently used entries are evicted first, once either the
+* slots or the memory budget run out.
+*/
+typedef struct struct_LinearizeCacheItem
+{
+	uint32 hash;
+	double tol;
+	int tolerance_type;
+	int flags;
+	size_t key_size;
+	uint8 *key;
+	LWGEOM *geom;
+	size_t size;
+	uint64 last_used;
+}
+LinearizeCacheItem;
+
+static THR_LOCAL MemoryContext LinearizeCacheContext = NULL;
+static THR_LOCAL LinearizeCacheItem LinearizeCache[LINEARIZE_CACHE_ITEMS];
+static THR_LOCAL int LinearizeCacheCount = 0;
+static THR_LOCAL size_t LinearizeCacheSize = 0;
+static THR_LOCAL uint64 LinearizeCacheClock = 0;
+
+/**
+* Number of bytes needed to write the cache key of a geometry.
+*/
+static size_t
+LinearizeKeySize(const LWGEOM *geom)
+{
+	size_t size = 2 + sizeof(uint32);
+	const POINTARRAY *pa;
+	uint32 i;
+
+	switch (geom->type)
+	{
+		case POINTTYPE:
+		case LINETYPE:
+		case CIRCSTRINGTYPE:
+		case TRIANGLETYPE:
+			pa = ((const LWLINE *)geom)->points;
+			if ( pa )
+				size += (size_t)pa->npoints * ptarray_point_size(pa);
+			break;
+		case POLYGONTYPE:
+		{
+			const LWPOLY *poly = (const LWPOLY *)geom;
+			for (i = 0; i < poly->nrings; i++)
+				size += sizeof(uint32) + (size_t)poly->rings[i]->npoints * ptarray_point_size(poly->rings[i]);
+			break;
+		}
+		default:
+		{
+			const LWCOLLECTION *col = (const LWCOLLECTION *)geom;
+			for (i = 0; i < col->ngeoms; i++)
+				size += LinearizeKeySize(col->geoms[i]);
+			break;
+		}
+	}
+	return size;
+}
+
+/**
+* Write the cache key of a geometry: type, dimensions and count of
+* every component, followed by its coordinates. Returns the position
+* right after what was written.
+*/
+static uint8 *
+LinearizeKeyWrite(const LWGEOM *geom, uint8 *buf)
+{
+	const POINTARRAY *pa;
+	uint32 n, i;
+	size_t len;
+
+	*buf++ = geom->type;
+	*buf++ = FLAGS_GET_Z(geom->flags) | FLAGS_GET_M(geom->flags) << 1 | FLAGS_GET_GEODETIC(geom->flags) << 2;
+
+	switch (geom->type)
+	{
+		case POINTTYPE:
+		case LINETYPE:
+		case CIRCSTRINGTYPE:
+		case TRIANGLETYPE:
+			pa = ((const LWLINE *)geom)->points;
+			n = pa ? pa->npoints : 0;
+			memcpy(buf, &n, sizeof(uint32));
+			buf += sizeof(uint32);
+			if ( n )
+			{
+				len = (size_t)n * ptarray_point_size(pa);
+				memcpy(buf, getPoint_internal(pa, 0), len);
+				buf += len;
+			}
+			break;
+		case POLYGONTYPE:
+		{
+			const LWPOLY *poly = (const LWPOLY *)geom;
+			memcpy(buf, &(poly->nrings), sizeof(uint32));
+			buf += sizeof(uint32);
+			for (i = 0; i < poly->nrings; i++)
+			{
+				pa = poly->rings[i];
+				memcpy(buf, &(pa->npoints), sizeof(uint32));
+				buf += sizeof(uint32);
+				if ( pa->npoints )
+				{
+					len = (size_t)pa->npoints * ptarray_point_size(pa);
+					memcpy(buf, getPoint_internal(pa, 0), len);
+					buf += len;
+				}
+			}
+			break;
+		}
+		default:
+		{
+			const LWCOLLECTION *col = (const LWCOLLECTION *)geom;
+			memcpy(buf, &(col->ngeoms), sizeof(uint32));
+			buf += sizeof(uint32);
+			for (i = 0; i < col->ngeoms; i++)
+				buf = LinearizeKeyWrite(col->geoms[i], buf);
+			break;
+		}
+	}
+	return buf;
+}
+
+/**
+* Drop the least recently used entry of the linearization cache.
+*/
+static void
+LinearizeCacheEvict(void)
+{
+	int i, victim = 0;
+
+	for (i = 1; i < LinearizeCacheCount; i++)
+	{
+		if ( LinearizeCache[i].last_used < LinearizeCache[victim].last_used )
+			victim = i;
+	}
+
+	POSTGIS_DEBUGF(3, "evicting linearized curve of %zu bytes from slot %d", LinearizeCache[victim].size, victim);
+
+	LinearizeCacheSize -= LinearizeCache[victim].size;
+	lwgeom_free(LinearizeCache[victim].geom);
+	pfree(LinearizeCache[victim].key);
+
+	/* Keep the used slots packed */
+	LinearizeCacheCount--;
+	if ( victim != LinearizeCacheCount )
+		LinearizeCache[victim] = LinearizeCache[LinearizeCacheCount];
+}
+
+/**
+* Linearization hook installed into liblwgeom: return a copy of the
+* cached linear form of geom if there is one, otherwise compute it
+* with the given linearizer and remember it.
+*/
+LWGEOM*
+GetLinearizedCurve(const LWGEOM *geom, double tol, LW_LINEARIZE_TOLERANCE_TYPE tolerance_type, int flags, lwlinearizer linearize)
+{
+	LinearizeCacheItem *item;
+	MemoryContext old_context;
+	LWGEOM *result, *copy;
+	uint8 *key;
+	size_t key_size, size;
+	uint32 hash;
+	int i;
+
+	key_size = LinearizeKeySize(geom);
+
+	/* Not worth keeping something that would push everything else out */
+	if ( key_size > LINEARIZE_CACHE_MAX_ITEM_SIZE )
+		return linearize(geom, tol, tolerance_type, flags);
+
+	key = (uint8 *)palloc(key_size);
+	LinearizeKeyWrite(geom, key);
+	hash = DatumGetUInt32(hash_any(key, key_size));
+
+	for (i = 0; i < LinearizeCacheCount; i++)
+	{
+		item = &(LinearizeCache[i]);
+		if ( item->hash == hash &&
+		     item->tol == tol &&
+		     item->tolerance_type == (int)tolerance_type &&
+		     item->flags == flags &&
+		     item->key_size == key_size &&
+		     memcmp(item->key, key, key_size) == 0 )
+		{
+			pfree(key);
+			item->last_used = ++LinearizeCacheClock;
+			result = lwgeom_clone_deep(item->geom);
+			lwgeom_set_srid(result, geom->srid);
+			return result;
+		}
+	}
+
+	result = linearize(geom, tol, tolerance_type, flags);
+	if ( ! result )
+	{
+		pfree(key);
+		return NULL;
+	}
+
+	size = key_size + LinearizeKeySize(result);
+	if ( size > LINEARIZE_CACHE_MAX_ITEM_SIZE )
+	{
+		pfree(key);
+		return result;
+	}
+
+	if ( ! LinearizeCacheContext )
+	{
+		LinearizeCacheContext = AllocSetContextCreate(TopMemoryContext,
+		                                              "PostGIS Linearize Cache Context",
+		                                              ALLOCSET_DEFAULT_MINSIZE,
+		                                              ALLOCSET_DEFAULT_INITSIZE,
+		                                              ALLOCSET_DEFAULT_MAXSIZE);
+	}
+
+	while ( LinearizeCacheCount > 0 &&
+	        (LinearizeCacheCount >= LINEARIZE_CACHE_ITEMS ||
+	         LinearizeCacheSize + size > LINEARIZE_CACHE_MAX_SIZE) )
+	{
+		LinearizeCacheEvict();
+	}
+
+	/* Copy everything over before linking the new entry in */
+	old_context = MemoryContextSwitchTo(LinearizeCacheContext);
+	copy = lwgeom_clone_deep(result);
+	item = &(LinearizeCache[LinearizeCacheCount]);
+	item->key = (uint8 *)palloc(key_size);
+	MemoryContextSwitchTo(old_context);
+
+	memcpy(item->key, key, key_size);
+	pfree(key);
+	item->hash = hash;
+	item->tol = tol;
+	item->tolerance_type = (int)tolerance_type;
+	item->flags = flags;
+	item->key_size = key_size;
+	item->geom = copy;
+	item->size = size;
+	item->last_used = ++LinearizeCacheClock;
+	LinearizeCacheSize += size;
+	LinearizeCacheCount++;
+
+	POSTGIS_DEBUGF(3, "cached linearized curve of %zu bytes in slot %d", size, LinearizeCacheCount - 1);
+
+	return result;
+}
@@ -50,6 +50,7 @@ typedef struct {
 * Other specific geometry cache types are the
 * RTreeGeomCache - lwgeom_rtree.h
 * PrepGeomCache - lwgeom_geos_prepared.h
+* DistTreeGeomCache - lwgeom_functions_basic.c
 */
 
 /*
@@ -66,24 +67,26 @@ typedef struct struct_PROJ4SRSCacheItem
 {
 	int srid;
 	projPJ projection;
-	MemoryContext projection_mcxt;
+	int slot;
 }
 PROJ4SRSCacheItem;
 
 /* PROJ 4 lookup transaction cache methods */
-#define PROJ4_CACHE_ITEMS	8
+#define PROJ4_CACHE_ITEMS	2
 
 /*
-* The proj4 cache holds a fixed number of reprojection
-* entries. In normal usage we don't expect it to have
-* many entries, so we always linearly scan the list.
+* The projections themselves are owned by the backend
+* cache in lwgeom_transform.c. The portal cache only
+* remembers the last pair handed out, and the backend
+* cache generation they were handed out in, so that a
+* statement reprojecting between two SRIDs skips the
+* backend lookup altogether.
 */
 typedef struct struct_PROJ4PortalCache
 {
 	int type;
 	PROJ4SRSCacheItem PROJ4SRSCache[PROJ4_CACHE_ITEMS];
-	int PROJ4SRSCacheCount;
-	MemoryContext PROJ4SRSCacheContext;
+	uint32 PROJ4SRSCacheGeneration;
 }
 PROJ4PortalCache;
 
@@ -99,10 +102,19 @@ typedef struct
 	GeomCache* (*GeomCacheAllocator)(void); /* Allocate the kind of cache object you use (GeomCache+some extra space) */
 } GeomCacheMethods;
 
+/*
+* Backend cache of linearized curves, see GetLinearizedCurve(). Items
+* larger than the item limit are stroked every time.
+*/
+#define LINEARIZE_CACHE_ITEMS 256
+#define LINEARIZE_CACHE_MAX_SIZE (16 * 1024 * 1024)
+#define LINEARIZE_CACHE_MAX_ITEM_SIZE (LINEARIZE_CACHE_MAX_SIZE / 8)
+
 /*
 * Cache retrieval functions
 */
 PROJ4PortalCache*  GetPROJ4SRSCache(FunctionCallInfoData *fcinfo);
 GeomCache*         GetGeomCache(FunctionCallInfoData *fcinfo, const GeomCacheMethods* cache_methods, const GSERIALIZED* g1, const GSERIALIZED* g2);
+LWGEOM*            GetLinearizedCurve(const LWGEOM *geom, double tol, LW_LINEARIZE_TOLERANCE_TYPE tolerance_type, int flags, lwlinearizer linearize);
 
 #endif /* LWGEOM_CACHE_H_ */
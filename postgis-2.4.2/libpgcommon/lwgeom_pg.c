@@ -24,6 +24,7 @@
 #include "../postgis_config.h"
 #include "liblwgeom.h"
 #include "lwgeom_pg.h"
+#include "lwgeom_cache.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -204,6 +205,7 @@ pg_install_lwgeom_handlers(void)
 	/* install PostgreSQL handlers */
 	lwgeom_set_handlers(pg_alloc, pg_realloc, pg_free, pg_error, pg_notice);
 	lwgeom_set_debuglogger(pg_debug);
+	lwgeom_set_linearize_cache(GetLinearizedCurve);
 }
 
 /**
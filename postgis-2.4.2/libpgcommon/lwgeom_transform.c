@@ -40,45 +40,66 @@ int pj_transform_nodatum(projPJ srcdefn, projPJ dstdefn, long point_count, int p
 
 
 /*
- * PROJ 4 backend hash table initial hash size
- * (since 16 is the default portal hash table size, and we would
- * typically have 2 entries per portal
- * then we shall use a default size of 32)
+ * Number of projections kept open by each backend. PROJ handles are
+ * cheap to keep but expensive to build (grid shift files and all),
+ * so this is sized for queries mixing a good number of SRIDs.
  */
-#define PROJ4_BACKEND_HASH_SIZE	32
+#define PROJ4_BACKEND_CACHE_ITEMS	64
+
+/* Initial size of the backend SRID definition hash */
+#define PROJ4_SRS_HASH_SIZE	64
 
 
 /**
- * Backend projPJ hash table
+ * Backend SRID definition cache
  *
- * This hash table stores a key/value pair of MemoryContext/projPJ objects.
- * Whenever we create a projPJ object using pj_init(), we create a separate
- * MemoryContext as a child context of the current executor context.
- * The MemoryContext/projPJ object is stored in this hash table so
- * that when PROJ4SRSCacheDelete() is called during query cleanup, we can
- * lookup the projPJ object based upon the MemoryContext parameter and hence
- * pj_free() it.
+ * This hash table stores the proj4text of every spatial_ref_sys SRID
+ * looked up by this backend, so that SPI is only used the first time
+ * an SRID is seen. The table and strings live in SRSCacheContext, and
+ * are dropped whenever spatial_ref_sys is invalidated (DDL, or DML
+ * through the spatial_ref_sys_cache_invalidate trigger).
  */
-static THR_LOCAL HTAB *PJHash = NULL;
+static THR_LOCAL HTAB *SRSHash = NULL;
+static THR_LOCAL MemoryContext SRSCacheContext = NULL;
+static THR_LOCAL Oid SRSRelid = InvalidOid;
+static THR_LOCAL bool SRSCacheCallbackSet = false;
+static THR_LOCAL bool SRSCacheInvalid = false;
 
-typedef struct struct_PJHashEntry
+typedef struct struct_SRSHashEntry
 {
-	MemoryContext ProjectionContext;
-	projPJ projection;
+	int srid;
+	char *proj4text;
 }
-PJHashEntry;
+SRSHashEntry;
 
 
-/* PJ Hash API */
-uint32 mcxt_ptr_hash(const void *key, Size keysize);
+/**
+ * Backend projPJ cache
+ *
+ * A fixed array of projections, evicted least recently used first.
+ * Every eviction or invalidation bumps PROJ4BackendCacheGeneration,
+ * which tells the portal caches whether the slots they remember
+ * still hold the projections they were handed.
+ */
+typedef struct struct_PROJ4BackendCacheItem
+{
+	int srid;
+	projPJ projection;
+	uint64 last_used;
+}
+PROJ4BackendCacheItem;
+
+static THR_LOCAL PROJ4BackendCacheItem PROJ4BackendCache[PROJ4_BACKEND_CACHE_ITEMS];
+static THR_LOCAL int PROJ4BackendCacheCount = 0;
+static THR_LOCAL uint64 PROJ4BackendCacheClock = 0;
+static THR_LOCAL uint32 PROJ4BackendCacheGeneration = 1;
 
-static HTAB *CreatePJHash(void);
-static void AddPJHashEntry(MemoryContext mcxt, projPJ projection);
-static projPJ GetPJHashEntry(MemoryContext mcxt);
-static void DeletePJHashEntry(MemoryContext mcxt);
 
 /* Internal Cache API */
-/* static PROJ4PortalCache *GetPROJ4SRSCache(FunctionCallInfo fcinfo) ; */
+static void SRSCacheInvalidateCallback(Datum arg, Oid relid);
+static void PROJ4CacheFlushIfInvalid(void);
+static char *GetProj4StringFromSRSCache(int srid);
+static int FindInPROJ4SRSCache(int srid);
 static bool IsInPROJ4SRSCache(PROJ4PortalCache *PROJ4Cache, int srid);
 static projPJ GetProjectionFromPROJ4SRSCache(PROJ4PortalCache *PROJ4Cache, int srid);
 static void AddToPROJ4SRSCache(PROJ4PortalCache *PROJ4Cache, int srid, int other_srid);
@@ -88,211 +109,85 @@ static void DeleteFromPROJ4SRSCache(PROJ4PortalCache *PROJ4Cache, int srid);
 static THR_LOCAL bool IsPROJ4LibPathSet = false;
 void SetPROJ4LibPath(void);
 
-/* Memory context cache functions */
-static void PROJ4SRSCacheInit(MemoryContext context);
-static void PROJ4SRSCacheDelete(MemoryContext context);
-static void PROJ4SRSCacheReset(MemoryContext context);
-static bool PROJ4SRSCacheIsEmpty(MemoryContext context);
-
-#if POSTGIS_PGSQL_VERSION >= 96
-static void PROJ4SRSCacheStats(MemoryContext context, int level, bool print, MemoryContextCounters *totals);
-#else
-static void PROJ4SRSCacheStats(MemoryContext context, int level);
-#endif
-
-#ifdef MEMORY_CONTEXT_CHECKING
-static void PROJ4SRSCacheCheck(MemoryContext context);
-#endif
-
-
-/* Memory context definition must match the current version of PostgreSQL */
-static MemoryContextMethods PROJ4SRSCacheContextMethods =
-{
-	NULL,
-	NULL,
-	NULL,
-	PROJ4SRSCacheInit,
-	PROJ4SRSCacheReset,
-	PROJ4SRSCacheDelete,
-	NULL,
-	PROJ4SRSCacheIsEmpty,
-	PROJ4SRSCacheStats
-#ifdef MEMORY_CONTEXT_CHECKING
-	,PROJ4SRSCacheCheck
-#endif
-};
-
 
+/**
+ * Relcache callback: spatial_ref_sys (or everything) has been
+ * invalidated. Invalidation messages may be processed in the middle
+ * of a lookup (every SPI query accepts them), while the caller still
+ * holds projections from the cache, so we only take note here and
+ * leave the flushing to the next cache entry point.
+ */
 static void
-PROJ4SRSCacheInit(MemoryContext context)
+SRSCacheInvalidateCallback(Datum arg, Oid relid)
 {
-	/*
-	 * Do nothing as the cache is initialised when the transform()
-	 * function is first called
-	 */
+	if ( relid == InvalidOid || relid == SRSRelid )
+		SRSCacheInvalid = true;
 }
 
+/**
+ * Drop the cached SRID definitions and projections if spatial_ref_sys
+ * has been invalidated since the last call.
+ */
 static void
-PROJ4SRSCacheDelete(MemoryContext context)
+PROJ4CacheFlushIfInvalid(void)
 {
-	projPJ projection;
-
-	/* Lookup the projPJ pointer in the global hash table so we can free it */
-	projection = GetPJHashEntry(context);
-
-	if (!projection)
-		elog(ERROR, "PROJ4SRSCacheDelete: Trying to delete non-existant projection object with MemoryContext key (%p)", (void *)context);
-
-	POSTGIS_DEBUGF(3, "deleting projection object (%p) with MemoryContext key (%p)", projection, context);
+	int i;
 
-	/* Free it */
-	pj_free(projection);
+	if ( ! SRSCacheCallbackSet )
+	{
+		CacheRegisterThreadRelcacheCallback(SRSCacheInvalidateCallback, (Datum) 0);
+		SRSCacheCallbackSet = true;
+	}
 
-	/* Remove the hash entry as it is no longer needed */
-	DeletePJHashEntry(context);
-}
+	if ( ! SRSCacheInvalid )
+		return;
 
-static void
-PROJ4SRSCacheReset(MemoryContext context)
-{
-	/*
-	 * Do nothing, but we must supply a function since this call is mandatory according to tgl
-	 * (see postgis-devel archives July 2007)
-	 */
-}
+	POSTGIS_DEBUG(3, "spatial_ref_sys invalidated, flushing the backend PROJ4 caches");
 
-static bool
-PROJ4SRSCacheIsEmpty(MemoryContext context)
-{
-	/*
-	 * Always return false since this call is mandatory according to tgl
-	 * (see postgis-devel archives July 2007)
-	 */
-	return FALSE;
-}
+	if ( SRSCacheContext )
+		MemoryContextReset(SRSCacheContext);
+	SRSHash = NULL;
 
-static void
-#if POSTGIS_PGSQL_VERSION >= 96
-PROJ4SRSCacheStats(MemoryContext context, int level, bool print, MemoryContextCounters *totals)
-#else
-PROJ4SRSCacheStats(MemoryContext context, int level)
-#endif
-{
-	/*
-	 * Simple stats display function - we must supply a function since this call is mandatory according to tgl
-	 * (see postgis-devel archives July 2007)
-	 */
+	for (i = 0; i < PROJ4BackendCacheCount; i++)
+	{
+		pj_free(PROJ4BackendCache[i].projection);
+		PROJ4BackendCache[i].projection = NULL;
+		PROJ4BackendCache[i].srid = SRID_UNKNOWN;
+	}
+	PROJ4BackendCacheCount = 0;
+	PROJ4BackendCacheGeneration++;
 
-	fprintf(stderr, "%s: PROJ4 context\n", context->name);
+	SRSCacheInvalid = false;
 }
 
-#ifdef MEMORY_CONTEXT_CHECKING
-static void
-PROJ4SRSCacheCheck(MemoryContext context)
-{
-	/*
-	 * Do nothing - stub required for when PostgreSQL is compiled
-	 * with MEMORY_CONTEXT_CHECKING defined
-	 */
+bool
+IsInPROJ4Cache(Proj4Cache PROJ4Cache, int srid) {
+	return IsInPROJ4SRSCache((PROJ4PortalCache *)PROJ4Cache, srid) ;
 }
-#endif
-
 
 /*
- * PROJ4 projPJ Hash Table functions
+ * Per-cache management functions
  */
 
-
 /**
- * A version of tag_hash - we specify this here as the implementation
- * has changed over the years....
+ * Return the backend cache slot holding the projection for srid,
+ * or -1 if there is none.
  */
-
-uint32 mcxt_ptr_hash(const void *key, Size keysize)
-{
-	uint32 hashval;
-
-	hashval = DatumGetUInt32(hash_any(key, keysize));
-
-	return hashval;
-}
-
-
-static HTAB *CreatePJHash(void)
-{
-	HASHCTL ctl;
-
-	ctl.keysize = sizeof(MemoryContext);
-	ctl.entrysize = sizeof(PJHashEntry);
-	ctl.hash = mcxt_ptr_hash;
-
-	return hash_create("PostGIS PROJ4 Backend projPJ MemoryContext Hash", PROJ4_BACKEND_HASH_SIZE, &ctl, (HASH_ELEM | HASH_FUNCTION));
-}
-
-static void AddPJHashEntry(MemoryContext mcxt, projPJ projection)
+static int
+FindInPROJ4SRSCache(int srid)
 {
-	bool found;
-	void **key;
-	PJHashEntry *he;
-
-	/* The hash key is the MemoryContext pointer */
-	key = (void *)&mcxt;
+	int i;
 
-	he = (PJHashEntry *) hash_search(PJHash, key, HASH_ENTER, &found);
-	if (!found)
-	{
-		/* Insert the entry into the new hash element */
-		he->ProjectionContext = mcxt;
-		he->projection = projection;
-	}
-	else
+	for (i = 0; i < PROJ4BackendCacheCount; i++)
 	{
-		elog(ERROR, "AddPJHashEntry: PROJ4 projection object already exists for this MemoryContext (%p)",
-		     (void *)mcxt);
+		if (PROJ4BackendCache[i].srid == srid)
+			return i;
 	}
-}
-
-static projPJ GetPJHashEntry(MemoryContext mcxt)
-{
-	void **key;
-	PJHashEntry *he;
-
-	/* The hash key is the MemoryContext pointer */
-	key = (void *)&mcxt;
 
-	/* Return the projection object from the hash */
-	he = (PJHashEntry *) hash_search(PJHash, key, HASH_FIND, NULL);
-
-	return he->projection;
-}
-
-
-static void DeletePJHashEntry(MemoryContext mcxt)
-{
-	void **key;
-	PJHashEntry *he;
-
-	/* The hash key is the MemoryContext pointer */
-	key = (void *)&mcxt;
-
-	/* Delete the projection object from the hash */
-	he = (PJHashEntry *) hash_search(PJHash, key, HASH_REMOVE, NULL);
-
-	he->projection = NULL;
-
-	if (!he)
-		elog(ERROR, "DeletePJHashEntry: There was an error removing the PROJ4 projection object from this MemoryContext (%p)", (void *)mcxt);
-}
-
-bool
-IsInPROJ4Cache(Proj4Cache PROJ4Cache, int srid) {
-	return IsInPROJ4SRSCache((PROJ4PortalCache *)PROJ4Cache, srid) ;
+	/* Otherwise not found */
+	return -1;
 }
 
-/*
- * Per-cache management functions
- */
-
 static bool
 IsInPROJ4SRSCache(PROJ4PortalCache *PROJ4Cache, int srid)
 {
@@ -300,17 +195,7 @@ IsInPROJ4SRSCache(PROJ4PortalCache *PROJ4Cache, int srid)
 	 * Return true/false depending upon whether the item
 	 * is in the SRS cache.
 	 */
-
-	int i;
-
-	for (i = 0; i < PROJ4_CACHE_ITEMS; i++)
-	{
-		if (PROJ4Cache->PROJ4SRSCache[i].srid == srid)
-			return 1;
-	}
-
-	/* Otherwise not found */
-	return 0;
+	return FindInPROJ4SRSCache(srid) >= 0;
 }
 
 projPJ GetProjectionFromPROJ4Cache(Proj4Cache cache, int srid)
@@ -321,26 +206,29 @@ projPJ GetProjectionFromPROJ4Cache(Proj4Cache cache, int srid)
 /**
  * Return the projection object from the cache (we should
  * already have checked it exists using IsInPROJ4SRSCache first)
+ * and mark it as the most recently used.
  */
 static projPJ
 GetProjectionFromPROJ4SRSCache(PROJ4PortalCache *PROJ4Cache, int srid)
 {
-	int i;
+	int i = FindInPROJ4SRSCache(srid);
 
-	for (i = 0; i < PROJ4_CACHE_ITEMS; i++)
-	{
-		if (PROJ4Cache->PROJ4SRSCache[i].srid == srid)
-			return PROJ4Cache->PROJ4SRSCache[i].projection;
-	}
+	if ( i < 0 )
+		return NULL;
 
-	return NULL;
+	PROJ4BackendCache[i].last_used = ++PROJ4BackendCacheClock;
+	return PROJ4BackendCache[i].projection;
 }
 
-char* GetProj4StringSPI(int srid)
+/**
+ * Read the proj4text of srid from spatial_ref_sys into SRSCacheContext,
+ * and remember the spatial_ref_sys oid for the invalidation callback.
+ */
+static char *
+LoadProj4StringSPI(int srid)
 {
-	static int maxproj4len = 512;
 	int spi_result;
-	char *proj_str = palloc(maxproj4len);
+	char *proj_str = NULL;
 	char proj4_spi_buffer[256];
 
 	/* Connect */
@@ -351,7 +239,7 @@ char* GetProj4StringSPI(int srid)
 	}
 
 	/* Execute the lookup query */
-	snprintf(proj4_spi_buffer, 255, "SELECT proj4text FROM spatial_ref_sys WHERE srid = %d LIMIT 1", srid);
+	snprintf(proj4_spi_buffer, 255, "SELECT proj4text, tableoid FROM spatial_ref_sys WHERE srid = %d LIMIT 1", srid);
 	spi_result = SPI_exec(proj4_spi_buffer, 1);
 
 	/* Read back the PROJ4 text */
@@ -362,16 +250,14 @@ char* GetProj4StringSPI(int srid)
 		SPITupleTable *tuptable = SPI_tuptable;
 		HeapTuple tuple = tuptable->vals[0];
 		char *proj4text = SPI_getvalue(tuple, tupdesc, 1);
+		bool isnull;
+		Datum relid = SPI_getbinval(tuple, tupdesc, 2, &isnull);
 
-		if ( proj4text )
-		{
-			/* Make a projection object out of it */
-			strncpy(proj_str, proj4text, maxproj4len - 1);
-		}
-		else
-		{
-			proj_str[0] = 0;
-		}
+		if ( ! isnull )
+			SRSRelid = DatumGetObjectId(relid);
+
+		/* Copy out of the SPI context before it goes away */
+		proj_str = MemoryContextStrdup(SRSCacheContext, proj4text ? proj4text : "");
 	}
 	else
 	{
@@ -387,6 +273,65 @@ char* GetProj4StringSPI(int srid)
 	return proj_str;
 }
 
+/**
+ * Return the proj4text of srid from the backend definition cache,
+ * reading it from spatial_ref_sys on a miss. The returned string
+ * belongs to the cache.
+ */
+static char *
+GetProj4StringFromSRSCache(int srid)
+{
+	SRSHashEntry *he;
+	bool found;
+	char *proj_str;
+
+	if ( ! SRSCacheContext )
+	{
+		SRSCacheContext = AllocSetContextCreate(TopMemoryContext,
+		                                        "PostGIS SRS Cache Context",
+		                                        ALLOCSET_SMALL_MINSIZE,
+		                                        ALLOCSET_SMALL_INITSIZE,
+		                                        ALLOCSET_DEFAULT_MAXSIZE);
+	}
+
+	if ( ! SRSHash )
+	{
+		HASHCTL ctl;
+
+		memset(&ctl, 0, sizeof(ctl));
+		ctl.keysize = sizeof(int);
+		ctl.entrysize = sizeof(SRSHashEntry);
+		ctl.hash = tag_hash;
+		ctl.hcxt = SRSCacheContext;
+
+		SRSHash = hash_create("PostGIS Backend SRS Hash", PROJ4_SRS_HASH_SIZE, &ctl,
+		                      (HASH_ELEM | HASH_FUNCTION | HASH_CONTEXT));
+	}
+
+	he = (SRSHashEntry *) hash_search(SRSHash, &srid, HASH_FIND, NULL);
+	if ( he )
+		return he->proj4text;
+
+	/* Look it up before entering, so that a failed lookup leaves no entry */
+	proj_str = LoadProj4StringSPI(srid);
+
+	he = (SRSHashEntry *) hash_search(SRSHash, &srid, HASH_ENTER, &found);
+	he->proj4text = proj_str;
+
+	POSTGIS_DEBUGF(3, "added SRID %d with proj4text \"%s\" to the backend SRS cache", srid, he->proj4text);
+
+	return he->proj4text;
+}
+
+/**
+ * Return a palloc'd copy of the proj4text of srid in spatial_ref_sys.
+ */
+char* GetProj4StringSPI(int srid)
+{
+	PROJ4CacheFlushIfInvalid();
+	return pstrdup(GetProj4StringFromSRSCache(srid));
+}
+
 
 /**
  *  Given an SRID, return the proj4 text.
@@ -401,7 +346,7 @@ static char* GetProj4String(int srid)
 	/* SRIDs in SPATIAL_REF_SYS */
 	if ( srid < SRID_RESERVE_OFFSET )
 	{
-		return GetProj4StringSPI(srid);
+		return pstrdup(GetProj4StringFromSRSCache(srid));
 	}
 	/* Automagic SRIDs */
 	else
@@ -485,16 +430,17 @@ void AddToPROJ4Cache(Proj4Cache cache, int srid, int other_srid) {
 
 
 /**
- * Add an entry to the local PROJ4 SRS cache. If we need to wrap around then
- * we must make sure the entry we choose to delete does not contain other_srid
- * which is the definition for the other half of the transformation.
+ * Add an entry to the backend PROJ4 SRS cache. If the cache is full
+ * the least recently used entry goes, making sure it is not
+ * other_srid which is the definition for the other half of the
+ * transformation.
  */
 static void
 AddToPROJ4SRSCache(PROJ4PortalCache *PROJ4Cache, int srid, int other_srid)
 {
-	MemoryContext PJMemoryContext;
 	projPJ projection = NULL;
 	char *proj_str = NULL;
+	int slot;
 
 	/*
 	** Turn the SRID number into a proj4 string, by reading from spatial_ref_sys
@@ -518,61 +464,37 @@ AddToPROJ4SRSCache(PROJ4PortalCache *PROJ4Cache, int srid, int other_srid)
 		    proj_str, pj_errstr);
 	}
 
-	/*
-	 * If the cache is already full then find the first entry
-	 * that doesn't contain other_srid and use this as the
-	 * subsequent value of PROJ4SRSCacheCount
-	 */
-	if (PROJ4Cache->PROJ4SRSCacheCount == PROJ4_CACHE_ITEMS)
+	if (PROJ4BackendCacheCount < PROJ4_BACKEND_CACHE_ITEMS)
+	{
+		slot = PROJ4BackendCacheCount++;
+	}
+	else
 	{
-		bool found = false;
 		int i;
 
-		for (i = 0; i < PROJ4_CACHE_ITEMS; i++)
+		slot = -1;
+		for (i = 0; i < PROJ4_BACKEND_CACHE_ITEMS; i++)
 		{
-			if (PROJ4Cache->PROJ4SRSCache[i].srid != other_srid && found == false)
-			{
-				POSTGIS_DEBUGF(3, "choosing to remove item from query cache with SRID %d and index %d", PROJ4Cache->PROJ4SRSCache[i].srid, i);
-
-				DeleteFromPROJ4SRSCache(PROJ4Cache, PROJ4Cache->PROJ4SRSCache[i].srid);
-				PROJ4Cache->PROJ4SRSCacheCount = i;
-
-				found = true;
-			}
+			if (PROJ4BackendCache[i].srid == other_srid)
+				continue;
+			if (slot < 0 || PROJ4BackendCache[i].last_used < PROJ4BackendCache[slot].last_used)
+				slot = i;
 		}
-	}
-
-	/*
-	 * Now create a memory context for this projection and
-	 * store it in the backend hash
-	 */
-	POSTGIS_DEBUGF(3, "adding SRID %d with proj4text \"%s\" to query cache at index %d", srid, proj_str, PROJ4Cache->PROJ4SRSCacheCount);
-
-	PJMemoryContext = MemoryContextCreate(T_AllocSetContext, 8192,
-	                                      &PROJ4SRSCacheContextMethods,
-	                                      PROJ4Cache->PROJ4SRSCacheContext,
-	                                      "PostGIS PROJ4 PJ Memory Context");
 
-	/* Create the backend hash if it doesn't already exist */
-	if (!PJHash)
-		PJHash = CreatePJHash();
+		POSTGIS_DEBUGF(3, "choosing to remove item from backend cache with SRID %d and index %d", PROJ4BackendCache[slot].srid, slot);
 
-	/*
-	 * Add the MemoryContext to the backend hash so we can
-	 * clean up upon portal shutdown
-	 */
-	POSTGIS_DEBUGF(3, "adding projection object (%p) to hash table with MemoryContext key (%p)", projection, PJMemoryContext);
+		pj_free(PROJ4BackendCache[slot].projection);
+		PROJ4BackendCacheGeneration++;
+	}
 
-	AddPJHashEntry(PJMemoryContext, projection);
+	POSTGIS_DEBUGF(3, "adding SRID %d with proj4text \"%s\" to backend cache at index %d", srid, proj_str, slot);
 
-	PROJ4Cache->PROJ4SRSCache[PROJ4Cache->PROJ4SRSCacheCount].srid = srid;
-	PROJ4Cache->PROJ4SRSCache[PROJ4Cache->PROJ4SRSCacheCount].projection = projection;
-	PROJ4Cache->PROJ4SRSCache[PROJ4Cache->PROJ4SRSCacheCount].projection_mcxt = PJMemoryContext;
-	PROJ4Cache->PROJ4SRSCacheCount++;
+	PROJ4BackendCache[slot].srid = srid;
+	PROJ4BackendCache[slot].projection = projection;
+	PROJ4BackendCache[slot].last_used = ++PROJ4BackendCacheClock;
 
 	/* Free the projection string */
 	pfree(proj_str);
-
 }
 
 void DeleteFromPROJ4Cache(Proj4Cache cache, int srid) {
@@ -583,27 +505,22 @@ void DeleteFromPROJ4Cache(Proj4Cache cache, int srid) {
 static void DeleteFromPROJ4SRSCache(PROJ4PortalCache *PROJ4Cache, int srid)
 {
 	/*
-	 * Delete the SRID entry from the cache
+	 * Delete the SRID entry from the cache, moving the last
+	 * entry into its slot
 	 */
+	int i = FindInPROJ4SRSCache(srid);
 
-	int i;
+	if ( i < 0 )
+		return;
 
-	for (i = 0; i < PROJ4_CACHE_ITEMS; i++)
-	{
-		if (PROJ4Cache->PROJ4SRSCache[i].srid == srid)
-		{
-			POSTGIS_DEBUGF(3, "removing query cache entry with SRID %d at index %d", srid, i);
-
-			/*
-			 * Zero out the entries and free the PROJ4 handle
-			 * by deleting the memory context
-			 */
-			MemoryContextDelete(PROJ4Cache->PROJ4SRSCache[i].projection_mcxt);
-			PROJ4Cache->PROJ4SRSCache[i].projection = NULL;
-			PROJ4Cache->PROJ4SRSCache[i].projection_mcxt = NULL;
-			PROJ4Cache->PROJ4SRSCache[i].srid = SRID_UNKNOWN;
-		}
-	}
+	POSTGIS_DEBUGF(3, "removing backend cache entry with SRID %d at index %d", srid, i);
+
+	pj_free(PROJ4BackendCache[i].projection);
+	PROJ4BackendCacheCount--;
+	PROJ4BackendCache[i] = PROJ4BackendCache[PROJ4BackendCacheCount];
+	PROJ4BackendCache[PROJ4BackendCacheCount].projection = NULL;
+	PROJ4BackendCache[PROJ4BackendCacheCount].srid = SRID_UNKNOWN;
+	PROJ4BackendCacheGeneration++;
 }
 
 
@@ -650,79 +567,58 @@ void SetPROJ4LibPath(void)
 }
 
 Proj4Cache GetPROJ4Cache(FunctionCallInfo fcinfo) {
+	PROJ4CacheFlushIfInvalid();
 	return (Proj4Cache)GetPROJ4SRSCache(fcinfo);
 }
 
-#if 0
-static PROJ4PortalCache *GetPROJ4SRSCache(FunctionCallInfo fcinfo)
-{
-	PROJ4PortalCache *PROJ4Cache = (GetGeomCache(fcinfo))->proj;
-
-	/*
-	 * If we have not already created PROJ4 cache for this portal
-	 * then create it
-	 */
-	if (fcinfo->flinfo->fn_extra == NULL)
-	{
-		MemoryContext old_context;
-
-		old_context = MemoryContextSwitchTo(fcinfo->flinfo->fn_mcxt);
-		PROJ4Cache = palloc(sizeof(PROJ4PortalCache));
-		MemoryContextSwitchTo(old_context);
-
-		if (PROJ4Cache)
-		{
-			int i;
-
-			POSTGIS_DEBUGF(3, "Allocating PROJ4Cache for portal with transform() MemoryContext %p", fcinfo->flinfo->fn_mcxt);
-			/* Put in any required defaults */
-			for (i = 0; i < PROJ4_CACHE_ITEMS; i++)
-			{
-				PROJ4Cache->PROJ4SRSCache[i].srid = SRID_UNKNOWN;
-				PROJ4Cache->PROJ4SRSCache[i].projection = NULL;
-				PROJ4Cache->PROJ4SRSCache[i].projection_mcxt = NULL;
-			}
-			PROJ4Cache->PROJ4SRSCacheCount = 0;
-			PROJ4Cache->PROJ4SRSCacheContext = fcinfo->flinfo->fn_mcxt;
-
-			/* Store the pointer in fcinfo->flinfo->fn_extra */
-			fcinfo->flinfo->fn_extra = PROJ4Cache;
-		}
-	}
-	else
-	{
-		/* Use the existing cache */
-		PROJ4Cache = fcinfo->flinfo->fn_extra;
-	}
-
-	return PROJ4Cache ;
-}
-#endif
 
 int
 GetProjectionsUsingFCInfo(FunctionCallInfo fcinfo, int srid1, int srid2, projPJ *pj1, projPJ *pj2)
 {
-	Proj4Cache *proj_cache = NULL;
+	PROJ4PortalCache *proj_cache = NULL;
+	PROJ4SRSCacheItem *item;
 
 	/* Set the search path if we haven't already */
 	SetPROJ4LibPath();
 
 	/* get or initialize the cache for this round */
-	proj_cache = GetPROJ4Cache(fcinfo);
+	proj_cache = (PROJ4PortalCache *)GetPROJ4Cache(fcinfo);
 	if ( !proj_cache )
 		return LW_FAILURE;
 
+	item = proj_cache->PROJ4SRSCache;
+
+	/* Same pair as last time, and still in the backend cache */
+	if ( proj_cache->PROJ4SRSCacheGeneration == PROJ4BackendCacheGeneration &&
+	     item[0].srid == srid1 && item[1].srid == srid2 )
+	{
+		PROJ4BackendCache[item[0].slot].last_used = ++PROJ4BackendCacheClock;
+		PROJ4BackendCache[item[1].slot].last_used = ++PROJ4BackendCacheClock;
+		*pj1 = item[0].projection;
+		*pj2 = item[1].projection;
+		return LW_SUCCESS;
+	}
+
 	/* Add the output srid to the cache if it's not already there */
-	if (!IsInPROJ4Cache(proj_cache, srid1))
-		AddToPROJ4Cache(proj_cache, srid1, srid2);
+	if (!IsInPROJ4SRSCache(proj_cache, srid1))
+		AddToPROJ4SRSCache(proj_cache, srid1, srid2);
 
 	/* Add the input srid to the cache if it's not already there */
-	if (!IsInPROJ4Cache(proj_cache, srid2))
-		AddToPROJ4Cache(proj_cache, srid2, srid1);
+	if (!IsInPROJ4SRSCache(proj_cache, srid2))
+		AddToPROJ4SRSCache(proj_cache, srid2, srid1);
 
 	/* Get the projections */
-	*pj1 = GetProjectionFromPROJ4Cache(proj_cache, srid1);
-	*pj2 = GetProjectionFromPROJ4Cache(proj_cache, srid2);
+	*pj1 = GetProjectionFromPROJ4SRSCache(proj_cache, srid1);
+	*pj2 = GetProjectionFromPROJ4SRSCache(proj_cache, srid2);
+
+	/* Remember the pair for the next call */
+	item[0].srid = srid1;
+	item[0].projection = *pj1;
+	item[0].slot = FindInPROJ4SRSCache(srid1);
+	item[1].srid = srid2;
+	item[1].projection = *pj2;
+	item[1].slot = FindInPROJ4SRSCache(srid2);
+	proj_cache->PROJ4SRSCacheGeneration = PROJ4BackendCacheGeneration;
 
 	return LW_SUCCESS;
 }
@@ -106,6 +106,10 @@ usage()
 	printf(_( "  -g <geocolumn> Specify the name of the geometry/geography column\n"
 	          "      (mostly useful in append mode).\n" ));
 	printf(_( "  -D  Use postgresql dump format (defaults to SQL insert statements).\n" ));
+	printf(_( "  -B <filename> Write the rows to <filename> in binary COPY format, with the\n"
+	          "      geometries already serialized, and load them with \\copy.\n"
+	          "      Not compatible with -w or -s FROM_SRID:TO_SRID.\n" ));
+	printf(_( "  -j <threads> Number of threads decoding shapes for -B (default 1).\n" ));
 	printf(_( "  -e  Execute each statement individually, do not use a transaction.\n"
 	          "      Not compatible with -D.\n" ));
 	printf(_( "  -G  Use geography type (requires lon/lat data or -s to reproject).\n" ));
@@ -167,7 +171,7 @@ main (int argc, char **argv)
 	set_loader_config_defaults(config);
 
 	/* Keep the flag list alphabetic so it's easy to see what's left. */
-	while ((c = pgis_getopt(argc, argv, "-acdeg:ikm:nps:t:wDGIN:ST:W:X:")) != EOF)
+	while ((c = pgis_getopt(argc, argv, "-acdeg:ij:km:nps:t:wB:DGIN:ST:W:X:")) != EOF)
 	{
 		// can not do this inside the switch case
 		if ('-' == c)
@@ -186,6 +190,18 @@ main (int argc, char **argv)
 			config->dump_format = 1;
 			break;
 
+		case 'B':
+			config->copy_binary_file = pgis_optarg;
+			break;
+
+		case 'j':
+			if (sscanf(pgis_optarg, "%d", &config->num_threads) != 1 || config->num_threads < 1)
+			{
+				fprintf(stderr, "The -j parameter must be a positive number of threads\n");
+				exit(1);
+			}
+			break;
+
 		case 'G':
 			config->geography = 1;
 			break;
@@ -325,6 +341,24 @@ main (int argc, char **argv)
 		exit(1);
 	}
 
+	if (config->copy_binary_file && (config->dump_format || config->use_wkt))
+	{
+		fprintf(stderr, "Invalid argument combination - cannot use -B with -D or -w\n");
+		exit(1);
+	}
+
+	if (config->copy_binary_file && config->shp_sr_id != SRID_UNKNOWN)
+	{
+		fprintf(stderr, "Invalid argument combination - cannot use -B with -s FROM_SRID:TO_SRID\n");
+		exit(1);
+	}
+
+	if (config->num_threads > 1 && !config->copy_binary_file)
+	{
+		fprintf(stderr, "Invalid argument combination - -j requires -B\n");
+		exit(1);
+	}
+
 	/* Determine the shapefile name from the next argument, if no shape file, exit. */
 	if (pgis_optind < argc)
 	{
@@ -437,8 +471,42 @@ main (int argc, char **argv)
 	printf("%s", header);
 	free(header);
 
+	/* In binary COPY mode, write the data file and load it with \copy */
+	if ( state->config->opt != 'p' && state->config->copy_binary_file )
+	{
+		FILE *fp;
+
+		ret = ShpLoaderGetSQLCopyStatement(state, &header);
+		if (ret != SHPLOADEROK)
+		{
+			fprintf(stderr, "%s\n", state->message);
+			exit(1);
+		}
+
+		fp = fopen(state->config->copy_binary_file, "wb");
+		if (!fp)
+		{
+			fprintf(stderr, "Unable to open %s: %s\n", state->config->copy_binary_file, strerror(errno));
+			exit(1);
+		}
+
+		ret = ShpLoaderWriteCopyBinary(state, fp);
+		if (fclose(fp) != 0 && ret == SHPLOADEROK)
+		{
+			snprintf(state->message, SHPLOADERMSGLEN, "Unable to write %s: %s", state->config->copy_binary_file, strerror(errno));
+			ret = SHPLOADERERR;
+		}
+		if (ret != SHPLOADEROK)
+		{
+			fprintf(stderr, "%s\n", state->message);
+			exit(1);
+		}
+
+		printf("%s", header);
+		free(header);
+	}
 	/* If we are not in "prepare" mode, go ahead and write out the data. */
-	if ( state->config->opt != 'p' )
+	else if ( state->config->opt != 'p' )
 	{
 
 		/* If in COPY mode, output the COPY statement */
@@ -19,6 +19,8 @@
 #include "../liblwgeom/liblwgeom.h"
 #include "../liblwgeom/lwgeom_log.h" /* for LWDEBUG macros */
 
+#include <pthread.h>
+
 
 
 /* Internal ring/point structures */
@@ -220,11 +222,42 @@ escape_insert_string(char *str)
 
 
 /**
- * @brief Generate an allocated geometry string for shapefile object obj using the state parameters
+ * @brief Serialize lwgeom into an allocated geometry string (hex WKB or WKT) using the
+ * state parameters. The LWGEOM is freed.
+ */
+static int
+GenerateGeometryString(SHPLOADERSTATE *state, LWGEOM *lwgeom, char **geometry)
+{
+	char *mem;
+	size_t mem_length;
+
+	if (state->config->use_wkt)
+		mem = lwgeom_to_wkt(lwgeom, WKT_EXTENDED, WKT_PRECISION, &mem_length);
+	else
+		mem = lwgeom_to_hexwkb(lwgeom, WKB_EXTENDED, &mem_length);
+
+	/* Free all of the allocated items */
+	lwgeom_free(lwgeom);
+
+	if ( !mem )
+	{
+		snprintf(state->message, SHPLOADERMSGLEN, "unable to write geometry");
+		return SHPLOADERERR;
+	}
+
+	/* Return the string - everything ok */
+	*geometry = mem;
+
+	return SHPLOADEROK;
+}
+
+
+/**
+ * @brief Build the LWGEOM for point shapefile object obj using the state parameters
  * if "force_multi" is true, single points will instead be created as multipoints with a single vertice.
  */
-int
-GeneratePointGeometry(SHPLOADERSTATE *state, SHPObject *obj, char **geometry, int force_multi)
+static int
+BuildPointGeometry(SHPLOADERSTATE *state, SHPObject *obj, LWGEOM **geometry, int force_multi)
 {
 	LWGEOM **lwmultipoints;
 	LWGEOM *lwgeom = NULL;
@@ -234,9 +267,6 @@ GeneratePointGeometry(SHPLOADERSTATE *state, SHPObject *obj, char **geometry, in
 	int dims = 0;
 	int u;
 
-	char *mem;
-	size_t mem_length;
-
 	FLAGS_SET_Z(dims, state->has_z);
 	FLAGS_SET_M(dims, state->has_m);
 
@@ -277,26 +307,7 @@ GeneratePointGeometry(SHPLOADERSTATE *state, SHPObject *obj, char **geometry, in
 		lwfree(lwmultipoints);
 	}
 
-	if (state->config->use_wkt)
-	{
-		mem = lwgeom_to_wkt(lwgeom, WKT_EXTENDED, WKT_PRECISION, &mem_length);
-	}
-	else
-	{
-		mem = lwgeom_to_hexwkb(lwgeom, WKB_EXTENDED, &mem_length);
-	}
-
-	if ( !mem )
-	{
-		snprintf(state->message, SHPLOADERMSGLEN, "unable to write geometry");
-		return SHPLOADERERR;
-	}
-
-	/* Free all of the allocated items */
-	lwgeom_free(lwgeom);
-
-	/* Return the string - everything ok */
-	*geometry = mem;
+	*geometry = lwgeom;
 
 	return SHPLOADEROK;
 }
@@ -304,9 +315,25 @@ GeneratePointGeometry(SHPLOADERSTATE *state, SHPObject *obj, char **geometry, in
 
 /**
  * @brief Generate an allocated geometry string for shapefile object obj using the state parameters
+ * if "force_multi" is true, single points will instead be created as multipoints with a single vertice.
  */
 int
-GenerateLineStringGeometry(SHPLOADERSTATE *state, SHPObject *obj, char **geometry)
+GeneratePointGeometry(SHPLOADERSTATE *state, SHPObject *obj, char **geometry, int force_multi)
+{
+	LWGEOM *lwgeom;
+
+	if (BuildPointGeometry(state, obj, &lwgeom, force_multi) != SHPLOADEROK)
+		return SHPLOADERERR;
+
+	return GenerateGeometryString(state, lwgeom, geometry);
+}
+
+
+/**
+ * @brief Build the LWGEOM for line shapefile object obj using the state parameters
+ */
+static int
+BuildLineStringGeometry(SHPLOADERSTATE *state, SHPObject *obj, LWGEOM **geometry)
 {
 
 	LWGEOM **lwmultilinestrings;
@@ -314,8 +341,6 @@ GenerateLineStringGeometry(SHPLOADERSTATE *state, SHPObject *obj, char **geometr
 	POINT4D point4d;
 	int dims = 0;
 	int u, v, start_vertex, end_vertex;
-	char *mem;
-	size_t mem_length;
 
 
 	FLAGS_SET_Z(dims, state->has_z);
@@ -375,24 +400,24 @@ GenerateLineStringGeometry(SHPLOADERSTATE *state, SHPObject *obj, char **geometr
 		lwfree(lwmultilinestrings);
 	}
 
-	if (!state->config->use_wkt)
-		mem = lwgeom_to_hexwkb(lwgeom, WKB_EXTENDED, &mem_length);
-	else
-		mem = lwgeom_to_wkt(lwgeom, WKT_EXTENDED, WKT_PRECISION, &mem_length);
+	*geometry = lwgeom;
 
-	if ( !mem )
-	{
-		snprintf(state->message, SHPLOADERMSGLEN, "unable to write geometry");
-		return SHPLOADERERR;
-	}
+	return SHPLOADEROK;
+}
 
-	/* Free all of the allocated items */
-	lwgeom_free(lwgeom);
 
-	/* Return the string - everything ok */
-	*geometry = mem;
+/**
+ * @brief Generate an allocated geometry string for shapefile object obj using the state parameters
+ */
+int
+GenerateLineStringGeometry(SHPLOADERSTATE *state, SHPObject *obj, char **geometry)
+{
+	LWGEOM *lwgeom;
 
-	return SHPLOADEROK;
+	if (BuildLineStringGeometry(state, obj, &lwgeom) != SHPLOADEROK)
+		return SHPLOADERERR;
+
+	return GenerateGeometryString(state, lwgeom, geometry);
 }
 
 
@@ -597,14 +622,14 @@ ReleasePolygons(Ring **polys, int npolys)
 
 
 /**
- * @brief Generate an allocated geometry string for shapefile object obj using the state parameters
+ * @brief Build the LWGEOM for polygon shapefile object obj using the state parameters
  *
  * This function basically deals with the polygon case. It sorts the polys in order of outer,
  * inner,inner, so that inners always come after outers they are within.
  *
  */
-int
-GeneratePolygonGeometry(SHPLOADERSTATE *state, SHPObject *obj, char **geometry)
+static int
+BuildPolygonGeometry(SHPLOADERSTATE *state, SHPObject *obj, LWGEOM **geometry)
 {
 	Ring **Outer;
 	int polygon_total, ring_total;
@@ -617,9 +642,6 @@ GeneratePolygonGeometry(SHPLOADERSTATE *state, SHPObject *obj, char **geometry)
 
 	int dims = 0;
 
-	char *mem;
-	size_t mem_length;
-
 	FLAGS_SET_Z(dims, state->has_z);
 	FLAGS_SET_M(dims, state->has_m);
 
@@ -696,30 +718,27 @@ GeneratePolygonGeometry(SHPLOADERSTATE *state, SHPObject *obj, char **geometry)
 		lwfree(lwpolygons);
 	}
 
-	if (!state->config->use_wkt)
-		mem = lwgeom_to_hexwkb(lwgeom, WKB_EXTENDED, &mem_length);
-	else
-		mem = lwgeom_to_wkt(lwgeom, WKT_EXTENDED, WKT_PRECISION, &mem_length);
+	/* Free the linked list of rings */
+	ReleasePolygons(Outer, polygon_total);
 
-	if ( !mem )
-	{
-		/* Free the linked list of rings */
-		ReleasePolygons(Outer, polygon_total);
+	*geometry = lwgeom;
 
-		snprintf(state->message, SHPLOADERMSGLEN, "unable to write geometry");
-		return SHPLOADERERR;
-	}
+	return SHPLOADEROK;
+}
 
-	/* Free all of the allocated items */
-	lwgeom_free(lwgeom);
 
-	/* Free the linked list of rings */
-	ReleasePolygons(Outer, polygon_total);
+/**
+ * @brief Generate an allocated geometry string for shapefile object obj using the state parameters
+ */
+int
+GeneratePolygonGeometry(SHPLOADERSTATE *state, SHPObject *obj, char **geometry)
+{
+	LWGEOM *lwgeom;
 
-	/* Return the string - everything ok */
-	*geometry = mem;
+	if (BuildPolygonGeometry(state, obj, &lwgeom) != SHPLOADEROK)
+		return SHPLOADERERR;
 
-	return SHPLOADEROK;
+	return GenerateGeometryString(state, lwgeom, geometry);
 }
 
 
@@ -765,6 +784,8 @@ set_loader_config_defaults(SHPLOADERCONFIG *config)
 	config->idxtablespace = NULL;
 	config->usetransaction = 1;
 	config->column_map_filename = NULL;
+	config->copy_binary_file = NULL;
+	config->num_threads = 1;
 }
 
 /* Create a new shapefile state object */
@@ -1463,6 +1484,28 @@ ShpLoaderGetSQLCopyStatement(SHPLOADERSTATE *state, char **strheader)
 {
 	char *copystr;
 
+	/* Binary COPY data is read by the client from the data file */
+	if (state->config->copy_binary_file)
+	{
+		char *escfile = escape_insert_string(state->config->copy_binary_file);
+
+		copystr = malloc((state->config->schema ? strlen(state->config->schema) : 0) + strlen(state->config->table) +
+		                 strlen(state->col_names) + strlen(escfile) + 60);
+
+		if (state->config->schema)
+			sprintf(copystr, "\\copy \"%s\".\"%s\" %s FROM '%s' WITH BINARY\n",
+			        state->config->schema, state->config->table, state->col_names, escfile);
+		else
+			sprintf(copystr, "\\copy \"%s\" %s FROM '%s' WITH BINARY\n",
+			        state->config->table, state->col_names, escfile);
+
+		if (escfile != state->config->copy_binary_file)
+			free(escfile);
+
+		*strheader = copystr;
+		return SHPLOADEROK;
+	}
+
 	/* Allocate the string for the COPY statement */
 	if (state->config->dump_format)
 	{
@@ -1814,6 +1857,674 @@ ShpLoaderGenerateSQLRowStatement(SHPLOADERSTATE *state, int item, char **strreco
 }
 
 
+/*
+ * Binary COPY output
+ */
+
+/* Signature, flags and header extension length of a binary COPY file */
+static const char copy_binary_signature[11] = "PGCOPY\n\377\r\n\0";
+
+static void
+copy_append_int16(bytebuffer_t *buf, int16_t val)
+{
+	uint8_t b[2];
+
+	b[0] = (uint8_t)((uint16_t)val >> 8);
+	b[1] = (uint8_t)val;
+	bytebuffer_append_bulk(buf, b, 2);
+}
+
+static void
+copy_append_int32(bytebuffer_t *buf, int32_t val)
+{
+	uint8_t b[4];
+	int i;
+
+	for (i = 0; i < 4; i++)
+		b[i] = (uint8_t)((uint32_t)val >> (24 - 8 * i));
+	bytebuffer_append_bulk(buf, b, 4);
+}
+
+static void
+copy_append_int64(bytebuffer_t *buf, int64_t val)
+{
+	uint8_t b[8];
+	int i;
+
+	for (i = 0; i < 8; i++)
+		b[i] = (uint8_t)((uint64_t)val >> (56 - 8 * i));
+	bytebuffer_append_bulk(buf, b, 8);
+}
+
+static void
+copy_append_float8(bytebuffer_t *buf, double val)
+{
+	int64_t bits;
+
+	memcpy(&bits, &val, sizeof(double));
+	copy_append_int64(buf, bits);
+}
+
+/* Parse a DBF integer value, which may carry a trailing "." or blank padding */
+static int
+copy_parse_integer(const char *str, int64_t *val)
+{
+	char *end;
+
+	errno = 0;
+	*val = strtoll(str, &end, 10);
+	if (errno || end == str)
+		return LW_FALSE;
+
+	if (*end == '.')
+		end++;
+	while (*end == '0' || *end == ' ')
+		end++;
+
+	return *end == '\0';
+}
+
+/* Parse a DBF date value of the form YYYYMMDD into days since 2000-01-01 */
+static int
+copy_parse_date(const char *str, int32_t *days)
+{
+	int y, m, d, era, yoe, doy, doe;
+
+	if (sscanf(str, "%4d%2d%2d", &y, &m, &d) != 3 || m < 1 || m > 12 || d < 1 || d > 31)
+		return LW_FALSE;
+
+	/* Days from the civil date, see http://howardhinnant.github.io/date_algorithms.html */
+	y -= m <= 2;
+	era = (y >= 0 ? y : y - 399) / 400;
+	yoe = y - era * 400;
+	doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+	doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+
+	/* 719468 days from 0000-03-01 to 1970-01-01, 10957 more to 2000-01-01 */
+	*days = era * 146097 + doe - 719468 - 10957;
+
+	return LW_TRUE;
+}
+
+/*
+ * Append a decimal string as a binary numeric: digit count, weight, sign and
+ * display scale, followed by the base 10000 digits.
+ */
+static int
+copy_append_numeric(bytebuffer_t *buf, const char *str)
+{
+	char dig[MAXVALUELEN];
+	int16_t ndigits, weight, sign = 0, dscale;
+	int16_t *digits;
+	int ndig = 0, pointpos = -1, exponent = 0;
+	int first, last, k;
+
+	while (*str == ' ')
+		str++;
+	if (*str == '-' || *str == '+')
+		sign = (*str++ == '-') ? 0x4000 : 0;
+
+	for (; *str; str++)
+	{
+		if (isdigit((unsigned char)*str) && ndig < MAXVALUELEN)
+			dig[ndig++] = *str - '0';
+		else if (*str == '.' && pointpos < 0)
+			pointpos = ndig;
+		else
+			break;
+	}
+	if (*str == 'e' || *str == 'E')
+	{
+		char *end;
+		exponent = strtol(str + 1, &end, 10);
+		str = end;
+	}
+	while (*str == ' ')
+		str++;
+	if (*str || ndig == 0)
+		return LW_FALSE;
+
+	/* Position of the decimal point relative to the first digit */
+	if (pointpos < 0)
+		pointpos = ndig;
+	pointpos += exponent;
+	dscale = ndig > pointpos ? ndig - pointpos : 0;
+
+	/* Strip leading and trailing zeros */
+	for (first = 0; first < ndig && dig[first] == 0; first++);
+	for (last = ndig - 1; last >= first && dig[last] == 0; last--);
+
+	if (first > last)
+	{
+		/* Zero */
+		copy_append_int32(buf, 8);
+		copy_append_int16(buf, 0);
+		copy_append_int16(buf, 0);
+		copy_append_int16(buf, 0);
+		copy_append_int16(buf, dscale);
+		return LW_TRUE;
+	}
+
+	/* Digit k has decimal exponent pointpos - 1 - k, grouped by floor(exponent / 4) */
+#define NUMERIC_GROUP(e) ((e) >= 0 ? (e) / 4 : -((3 - (e)) / 4))
+	weight = NUMERIC_GROUP(pointpos - 1 - first);
+	ndigits = weight - NUMERIC_GROUP(pointpos - 1 - last) + 1;
+	digits = calloc(ndigits, sizeof(int16_t));
+	for (k = first; k <= last; k++)
+	{
+		int e = pointpos - 1 - k;
+		int g = NUMERIC_GROUP(e);
+		int p, scale = 1;
+
+		for (p = e - 4 * g; p > 0; p--)
+			scale *= 10;
+		digits[weight - g] += dig[k] * scale;
+	}
+#undef NUMERIC_GROUP
+
+	copy_append_int32(buf, 8 + 2 * ndigits);
+	copy_append_int16(buf, ndigits);
+	copy_append_int16(buf, weight);
+	copy_append_int16(buf, sign);
+	copy_append_int16(buf, dscale);
+	for (k = 0; k < ndigits; k++)
+		copy_append_int16(buf, digits[k]);
+	free(digits);
+
+	return LW_TRUE;
+}
+
+
+/* Append the binary COPY row for the specified record item to buf */
+int
+ShpLoaderGenerateCopyBinaryRow(SHPLOADERSTATE *state, int item, bytebuffer_t *buf)
+{
+	SHPObject *obj = NULL;
+	LWGEOM *lwgeom = NULL;
+	const char *val;
+	const char *pgtype;
+	int64_t ival;
+	int32_t days;
+	int res, i;
+
+	/* Skip deleted records */
+	if (state->hDBFHandle && DBFIsRecordDeleted(state->hDBFHandle, item))
+		return SHPLOADERRECDELETED;
+
+	/* If we are reading the shapefile, open the specified record */
+	if (state->config->readshape == 1)
+	{
+		obj = SHPReadObject(state->hSHPHandle, item);
+		if (!obj)
+		{
+			snprintf(state->message, SHPLOADERMSGLEN, _("Error reading shape object %d"), item);
+			return SHPLOADERERR;
+		}
+
+		/* If we are set to skip NULLs, return a NULL record status */
+		if (state->config->null_policy == POLICY_NULL_SKIP && obj->nVertices == 0 )
+		{
+			SHPDestroyObject(obj);
+			return SHPLOADERRECISNULL;
+		}
+	}
+
+	copy_append_int16(buf, state->num_fields + (state->config->readshape == 1 ? 1 : 0));
+
+	/* Read all of the attributes from the DBF file for this item */
+	for (i = 0; i < state->num_fields; i++)
+	{
+		/* Special case for NULL attributes */
+		if (DBFIsAttributeNULL(state->hDBFHandle, item, i))
+		{
+			copy_append_int32(buf, -1);
+			continue;
+		}
+
+		val = DBFReadStringAttribute(state->hDBFHandle, item, i);
+		pgtype = state->pgfieldtypes[i];
+		res = LW_TRUE;
+
+		if (!strcmp(pgtype, "varchar"))
+		{
+			char *utf8str = NULL;
+
+			if (state->config->encoding)
+			{
+				int rv = utf8(state->config->encoding, (char *)val, &utf8str);
+
+				if (rv != UTF8_GOOD_RESULT)
+				{
+					if ( rv == UTF8_BAD_RESULT )
+						free(utf8str);
+
+					snprintf(state->message, SHPLOADERMSGLEN, _("Unable to convert data value to UTF-8 (iconv reports \"%s\"). Current encoding is \"%s\"."), strerror(errno), state->config->encoding);
+					SHPDestroyObject(obj);
+					return SHPLOADERERR;
+				}
+				val = utf8str;
+			}
+
+			copy_append_int32(buf, strlen(val));
+			bytebuffer_append_bulk(buf, (void *)val, strlen(val));
+
+			if (utf8str)
+				free(utf8str);
+		}
+		else if (!strcmp(pgtype, "int2"))
+		{
+			res = copy_parse_integer(val, &ival) && ival >= INT16_MIN && ival <= INT16_MAX;
+			if (res)
+			{
+				copy_append_int32(buf, 2);
+				copy_append_int16(buf, ival);
+			}
+		}
+		else if (!strcmp(pgtype, "int4"))
+		{
+			res = copy_parse_integer(val, &ival) && ival >= INT32_MIN && ival <= INT32_MAX;
+			if (res)
+			{
+				copy_append_int32(buf, 4);
+				copy_append_int32(buf, ival);
+			}
+		}
+		else if (!strcmp(pgtype, "int8"))
+		{
+			res = copy_parse_integer(val, &ival);
+			if (res)
+			{
+				copy_append_int32(buf, 8);
+				copy_append_int64(buf, ival);
+			}
+		}
+		else if (!strcmp(pgtype, "float8"))
+		{
+			char *end;
+			double dval = strtod(val, &end);
+
+			while (*end == ' ')
+				end++;
+			res = (end != val && *end == '\0');
+			if (res)
+			{
+				copy_append_int32(buf, 8);
+				copy_append_float8(buf, dval);
+			}
+		}
+		else if (!strcmp(pgtype, "numeric"))
+		{
+			res = copy_append_numeric(buf, val);
+		}
+		else if (!strcmp(pgtype, "date"))
+		{
+			res = copy_parse_date(val, &days);
+			if (res)
+			{
+				copy_append_int32(buf, 4);
+				copy_append_int32(buf, days);
+			}
+		}
+		else if (!strcmp(pgtype, "boolean"))
+		{
+			res = (strchr("TtYyFfNn", val[0]) != NULL && val[0] != '\0');
+			if (res)
+			{
+				copy_append_int32(buf, 1);
+				bytebuffer_append_byte(buf, strchr("TtYy", val[0]) ? 1 : 0);
+			}
+		}
+
+		if (!res)
+		{
+			snprintf(state->message, SHPLOADERMSGLEN, _("Invalid %s value \"%s\" in field %d of record %d"), pgtype, val, i, item);
+			SHPDestroyObject(obj);
+			return SHPLOADERERR;
+		}
+	}
+
+	/* Add the shape attribute if we are reading it, as EWKB */
+	if (state->config->readshape == 1)
+	{
+		/* Handle the case of a NULL shape */
+		if (obj->nVertices == 0)
+		{
+			copy_append_int32(buf, -1);
+		}
+		else
+		{
+			uint8_t *wkb;
+			size_t wkb_size;
+
+			switch (obj->nSHPType)
+			{
+			case SHPT_POLYGON:
+			case SHPT_POLYGONM:
+			case SHPT_POLYGONZ:
+				res = BuildPolygonGeometry(state, obj, &lwgeom);
+				break;
+
+			case SHPT_POINT:
+			case SHPT_POINTM:
+			case SHPT_POINTZ:
+				res = BuildPointGeometry(state, obj, &lwgeom, 0);
+				break;
+
+			case SHPT_MULTIPOINT:
+			case SHPT_MULTIPOINTM:
+			case SHPT_MULTIPOINTZ:
+				/* Force it to multi unless using -S */
+				res = BuildPointGeometry(state, obj, &lwgeom,
+					state->config->simple_geometries ? 0 : 1);
+				break;
+
+			case SHPT_ARC:
+			case SHPT_ARCM:
+			case SHPT_ARCZ:
+				res = BuildLineStringGeometry(state, obj, &lwgeom);
+				break;
+
+			default:
+				snprintf(state->message, SHPLOADERMSGLEN, _("Shape type is not supported, type id = %d"), obj->nSHPType);
+				res = SHPLOADERERR;
+			}
+
+			if (res != SHPLOADEROK)
+			{
+				/* Error message has already been set */
+				SHPDestroyObject(obj);
+				return SHPLOADERERR;
+			}
+
+			wkb = lwgeom_to_wkb(lwgeom, WKB_EXTENDED, &wkb_size);
+			lwgeom_free(lwgeom);
+			if (!wkb)
+			{
+				snprintf(state->message, SHPLOADERMSGLEN, "unable to write geometry");
+				SHPDestroyObject(obj);
+				return SHPLOADERERR;
+			}
+
+			copy_append_int32(buf, wkb_size);
+			bytebuffer_append_bulk(buf, wkb, wkb_size);
+			lwfree(wkb);
+		}
+
+		SHPDestroyObject(obj);
+	}
+
+	return SHPLOADEROK;
+}
+
+
+/* Number of records decoded by a worker thread in one go */
+#define SHPLOADER_COPY_CHUNK 256
+
+/* A chunk of encoded rows, waiting for the writer */
+typedef struct
+{
+	/* Index of the chunk held, -1 when the slot is free */
+	int chunk;
+
+	/* Set once the rows are encoded */
+	int ready;
+
+	/* SHPLOADEROK or SHPLOADERERR, with the message of the error */
+	int status;
+	char message[SHPLOADERMSGLEN];
+
+	bytebuffer_t *buf;
+} SHPLOADERCOPYSLOT;
+
+/* Shared state of the decoding threads */
+typedef struct
+{
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+
+	/* Next chunk to hand out, and the number of chunks in the file */
+	int next_chunk;
+	int num_chunks;
+
+	/* Set when the writer gives up, so the workers stop */
+	int abort;
+
+	/* Ring of chunk results; chunk c goes in slot c % num_slots */
+	int num_slots;
+	SHPLOADERCOPYSLOT *slots;
+} SHPLOADERCOPYPOOL;
+
+/*
+ * A decoding thread. Each worker reads through a copy of the loader state with
+ * its own shapefile and dbf handles, since shapelib keeps the record being read
+ * in the handle.
+ */
+typedef struct
+{
+	SHPLOADERCOPYPOOL *pool;
+	SHPLOADERSTATE state;
+	pthread_t thread;
+} SHPLOADERCOPYWORKER;
+
+/* Encode the rows of chunk into buf, returning SHPLOADEROK or SHPLOADERERR */
+static int
+ShpLoaderEncodeCopyChunk(SHPLOADERSTATE *state, int chunk, bytebuffer_t *buf)
+{
+	int item, end;
+
+	end = (chunk + 1) * SHPLOADER_COPY_CHUNK;
+	if (end > state->num_entities)
+		end = state->num_entities;
+
+	for (item = chunk * SHPLOADER_COPY_CHUNK; item < end; item++)
+	{
+		if (ShpLoaderGenerateCopyBinaryRow(state, item, buf) == SHPLOADERERR)
+			return SHPLOADERERR;
+	}
+
+	return SHPLOADEROK;
+}
+
+static void *
+ShpLoaderCopyWorker(void *arg)
+{
+	SHPLOADERCOPYWORKER *worker = (SHPLOADERCOPYWORKER *)arg;
+	SHPLOADERCOPYPOOL *pool = worker->pool;
+	SHPLOADERCOPYSLOT *slot;
+	int chunk, status;
+
+	pthread_mutex_lock(&pool->lock);
+	while (!pool->abort && pool->next_chunk < pool->num_chunks)
+	{
+		chunk = pool->next_chunk++;
+		slot = &pool->slots[chunk % pool->num_slots];
+
+		/* Wait for the writer to drain the previous chunk held in the slot */
+		while (slot->chunk != -1 && !pool->abort)
+			pthread_cond_wait(&pool->cond, &pool->lock);
+		if (pool->abort)
+			break;
+
+		slot->chunk = chunk;
+		slot->ready = 0;
+		pthread_mutex_unlock(&pool->lock);
+
+		bytebuffer_clear(slot->buf);
+		status = ShpLoaderEncodeCopyChunk(&worker->state, chunk, slot->buf);
+
+		pthread_mutex_lock(&pool->lock);
+		slot->status = status;
+		if (status != SHPLOADEROK)
+			snprintf(slot->message, SHPLOADERMSGLEN, "%s", worker->state.message);
+		slot->ready = 1;
+		pthread_cond_broadcast(&pool->cond);
+	}
+	pthread_mutex_unlock(&pool->lock);
+
+	return NULL;
+}
+
+/* Write buf to fp, returning SHPLOADEROK or SHPLOADERERR */
+static int
+ShpLoaderWriteCopyBuffer(SHPLOADERSTATE *state, bytebuffer_t *buf, FILE *fp)
+{
+	const uint8_t *bytes;
+	size_t len;
+
+	bytes = bytebuffer_get_buffer(buf, &len);
+	if (fwrite(bytes, 1, len, fp) != len)
+	{
+		snprintf(state->message, SHPLOADERMSGLEN, _("Error writing binary COPY data: %s"), strerror(errno));
+		return SHPLOADERERR;
+	}
+
+	return SHPLOADEROK;
+}
+
+/*
+ * Write every record to fp in binary COPY format. Records are decoded in chunks by
+ * config->num_threads threads and written out in file order.
+ */
+int
+ShpLoaderWriteCopyBinary(SHPLOADERSTATE *state, FILE *fp)
+{
+	SHPLOADERCOPYPOOL pool;
+	SHPLOADERCOPYWORKER *workers;
+	bytebuffer_t *buf;
+	int num_threads = state->config->num_threads;
+	int num_started = 0;
+	int num_chunks;
+	int ret;
+	int chunk, i;
+
+	/* Header: signature, flags and header extension length */
+	buf = bytebuffer_create();
+	bytebuffer_append_bulk(buf, (void *)copy_binary_signature, sizeof(copy_binary_signature));
+	copy_append_int32(buf, 0);
+	copy_append_int32(buf, 0);
+	ret = ShpLoaderWriteCopyBuffer(state, buf, fp);
+
+	num_chunks = (state->num_entities + SHPLOADER_COPY_CHUNK - 1) / SHPLOADER_COPY_CHUNK;
+
+	if (num_threads <= 1 || num_chunks <= 1)
+	{
+		/* Single threaded, encode and write one chunk at a time */
+		for (chunk = 0; chunk < num_chunks && ret == SHPLOADEROK; chunk++)
+		{
+			bytebuffer_clear(buf);
+			ret = ShpLoaderEncodeCopyChunk(state, chunk, buf);
+			if (ret == SHPLOADEROK)
+				ret = ShpLoaderWriteCopyBuffer(state, buf, fp);
+		}
+	}
+	else if (ret == SHPLOADEROK)
+	{
+		pthread_mutex_init(&pool.lock, NULL);
+		pthread_cond_init(&pool.cond, NULL);
+		pool.next_chunk = 0;
+		pool.num_chunks = num_chunks;
+		pool.abort = 0;
+		pool.num_slots = 2 * num_threads;
+		pool.slots = calloc(pool.num_slots, sizeof(SHPLOADERCOPYSLOT));
+		for (i = 0; i < pool.num_slots; i++)
+		{
+			pool.slots[i].chunk = -1;
+			pool.slots[i].buf = bytebuffer_create();
+		}
+
+		/* Open the handles of every worker before starting any of them */
+		workers = calloc(num_threads, sizeof(SHPLOADERCOPYWORKER));
+		for (i = 0; i < num_threads; i++)
+		{
+			workers[i].pool = &pool;
+			memcpy(&workers[i].state, state, sizeof(SHPLOADERSTATE));
+			workers[i].state.hSHPHandle = NULL;
+			if (state->config->readshape == 1)
+				workers[i].state.hSHPHandle = SHPOpen(state->config->shp_file, "rb");
+			workers[i].state.hDBFHandle = DBFOpen(state->config->shp_file, "rb");
+
+			if ((state->config->readshape == 1 && !workers[i].state.hSHPHandle) || !workers[i].state.hDBFHandle)
+			{
+				snprintf(state->message, SHPLOADERMSGLEN, _("%s: shape or dbf file can not be opened by decoding thread %d"), state->config->shp_file, i);
+				ret = SHPLOADERERR;
+			}
+		}
+
+		for (i = 0; i < num_threads && ret == SHPLOADEROK; i++)
+		{
+			if (pthread_create(&workers[i].thread, NULL, ShpLoaderCopyWorker, &workers[i]))
+			{
+				snprintf(state->message, SHPLOADERMSGLEN, _("Unable to start decoding thread %d"), i);
+				ret = SHPLOADERERR;
+			}
+			else
+				num_started++;
+		}
+
+		/* Write out the chunks in file order as they become ready */
+		for (chunk = 0; chunk < num_chunks && ret == SHPLOADEROK; chunk++)
+		{
+			SHPLOADERCOPYSLOT *slot = &pool.slots[chunk % pool.num_slots];
+
+			pthread_mutex_lock(&pool.lock);
+			while (!(slot->chunk == chunk && slot->ready))
+				pthread_cond_wait(&pool.cond, &pool.lock);
+			pthread_mutex_unlock(&pool.lock);
+
+			if (slot->status != SHPLOADEROK)
+			{
+				snprintf(state->message, SHPLOADERMSGLEN, "%s", slot->message);
+				ret = SHPLOADERERR;
+			}
+			else
+				ret = ShpLoaderWriteCopyBuffer(state, slot->buf, fp);
+
+			pthread_mutex_lock(&pool.lock);
+			slot->chunk = -1;
+			pthread_cond_broadcast(&pool.cond);
+			pthread_mutex_unlock(&pool.lock);
+		}
+
+		/* Stop the workers early if anything failed */
+		pthread_mutex_lock(&pool.lock);
+		if (ret != SHPLOADEROK)
+			pool.abort = 1;
+		pthread_cond_broadcast(&pool.cond);
+		pthread_mutex_unlock(&pool.lock);
+
+		for (i = 0; i < num_started; i++)
+			pthread_join(workers[i].thread, NULL);
+
+		/* Close the worker handles; the rest of the state is shared */
+		for (i = 0; i < num_threads; i++)
+		{
+			if (workers[i].state.hSHPHandle)
+				SHPClose(workers[i].state.hSHPHandle);
+			if (workers[i].state.hDBFHandle)
+				DBFClose(workers[i].state.hDBFHandle);
+		}
+		free(workers);
+
+		for (i = 0; i < pool.num_slots; i++)
+			bytebuffer_destroy(pool.slots[i].buf);
+		free(pool.slots);
+		pthread_cond_destroy(&pool.cond);
+		pthread_mutex_destroy(&pool.lock);
+	}
+
+	/* Trailer */
+	if (ret == SHPLOADEROK)
+	{
+		bytebuffer_clear(buf);
+		copy_append_int16(buf, -1);
+		ret = ShpLoaderWriteCopyBuffer(state, buf, fp);
+	}
+	bytebuffer_destroy(buf);
+
+	return ret;
+}
+
+
 /* Return a pointer to an allocated string containing the header for the specified loader state */
 int
 ShpLoaderGetSQLFooter(SHPLOADERSTATE *state, char **strfooter)
@@ -28,6 +28,7 @@
 #include "getopt.h"
 
 #include "../liblwgeom/stringbuffer.h"
+#include "../liblwgeom/bytebuffer.h"
 
 #define S2P_RCSID "$Id: shp2pgsql-core.h 15731 2017-09-14 15:56:58Z strk $"
 
@@ -147,6 +148,12 @@ typedef struct shp_loader_config
 	/* Name of the column map file if specified */
 	char *column_map_filename;
 
+	/* file to write binary COPY data to, or NULL for SQL/dump text output */
+	char *copy_binary_file;
+
+	/* number of threads decoding records for binary COPY */
+	int num_threads;
+
 } SHPLOADERCONFIG;
 
 
@@ -233,5 +240,7 @@ int ShpLoaderGetSQLHeader(SHPLOADERSTATE *state, char **strheader);
 int ShpLoaderGetSQLCopyStatement(SHPLOADERSTATE *state, char **strheader);
 int ShpLoaderGetRecordCount(SHPLOADERSTATE *state);
 int ShpLoaderGenerateSQLRowStatement(SHPLOADERSTATE *state, int item, char **strrecord);
+int ShpLoaderGenerateCopyBinaryRow(SHPLOADERSTATE *state, int item, bytebuffer_t *buf);
+int ShpLoaderWriteCopyBinary(SHPLOADERSTATE *state, FILE *fp);
 int ShpLoaderGetSQLFooter(SHPLOADERSTATE *state, char **strfooter);
 void ShpLoaderDestroy(SHPLOADERSTATE *state);
@@ -89,3 +89,284 @@ geom2d_brin_inclusion_add_value(PG_FUNCTION_ARGS)
 
 	PG_RETURN_BOOL(true);
 }
+
+/*
+ * Multi-box summaries (brin_geometry_multibox_ops_2d).
+ *
+ * A single inclusion box per block range soon covers the whole extent of
+ * the data once the table is not perfectly clustered, and the index stops
+ * excluding anything. This opclass keeps up to BRIN_MULTIBOX_MAX_BOXES
+ * boxes per range instead: a new box that no stored box contains is added
+ * to the set, and when the set overflows the two boxes whose union grows
+ * the covered area the least are merged. Boxes only ever grow, so every
+ * geometry of the range stays inside one of them.
+ */
+
+PG_FUNCTION_INFO_V1(geom2d_brin_multibox_opcinfo);
+PG_FUNCTION_INFO_V1(geom2d_brin_multibox_add_value);
+PG_FUNCTION_INFO_V1(geom2d_brin_multibox_consistent);
+PG_FUNCTION_INFO_V1(geom2d_brin_multibox_union);
+
+static double
+brin_multibox_area(const BOX2DF *a)
+{
+	return ((double) a->xmax - a->xmin) * ((double) a->ymax - a->ymin);
+}
+
+static bool
+brin_multibox_overlaps(const BOX2DF *a, const BOX2DF *b)
+{
+	return !(a->xmin > b->xmax || b->xmin > a->xmax ||
+	         a->ymin > b->ymax || b->ymin > a->ymax);
+}
+
+/*
+ * Add a box to a set holding at most BRIN_MULTIBOX_MAX_BOXES of them (the
+ * array has room for one more). Returns false when a box of the set already
+ * contains the new one.
+ */
+static bool
+brin_multibox_add(BOX2DF *boxes, int *nboxes, const BOX2DF *box)
+{
+	int i, j, best_i = 0, best_j = 1;
+	double best_cost = DBL_MAX, best_edge = DBL_MAX;
+
+	for (i = 0; i < *nboxes; i++)
+	{
+		if (box2df_contains(&boxes[i], box))
+			return false;
+	}
+
+	boxes[(*nboxes)++] = *box;
+	if (*nboxes <= BRIN_MULTIBOX_MAX_BOXES)
+		return true;
+
+	/*
+	 * Merge the pair with the smallest growth in area, overlapping boxes
+	 * first, and the smallest union perimeter among equals (think of point
+	 * boxes, which have no area).
+	 */
+	for (i = 0; i < *nboxes; i++)
+	{
+		for (j = i + 1; j < *nboxes; j++)
+		{
+			BOX2DF u;
+			double cost, edge;
+
+			u.xmin = Min(boxes[i].xmin, boxes[j].xmin);
+			u.xmax = Max(boxes[i].xmax, boxes[j].xmax);
+			u.ymin = Min(boxes[i].ymin, boxes[j].ymin);
+			u.ymax = Max(boxes[i].ymax, boxes[j].ymax);
+			cost = brin_multibox_area(&u) - brin_multibox_area(&boxes[i]) - brin_multibox_area(&boxes[j]);
+			edge = ((double) u.xmax - u.xmin) + ((double) u.ymax - u.ymin);
+			if (cost < best_cost || (cost == best_cost && edge < best_edge))
+			{
+				best_cost = cost;
+				best_edge = edge;
+				best_i = i;
+				best_j = j;
+			}
+		}
+	}
+
+	boxes[best_i].xmin = Min(boxes[best_i].xmin, boxes[best_j].xmin);
+	boxes[best_i].xmax = Max(boxes[best_i].xmax, boxes[best_j].xmax);
+	boxes[best_i].ymin = Min(boxes[best_i].ymin, boxes[best_j].ymin);
+	boxes[best_i].ymax = Max(boxes[best_i].ymax, boxes[best_j].ymax);
+	boxes[best_j] = boxes[--(*nboxes)];
+	return true;
+}
+
+static int
+brin_multibox_get(Datum summary, BOX2DF *boxes, uint16 *flags)
+{
+	/* Stored values can come back with a short varlena header */
+	BRIN_MULTIBOX *mb = (BRIN_MULTIBOX *) PG_DETOAST_DATUM(summary);
+
+	memcpy(boxes, mb->boxes, mb->nboxes * sizeof(BOX2DF));
+	*flags = mb->flags;
+	return mb->nboxes;
+}
+
+static Datum
+brin_multibox_datum(const BOX2DF *boxes, int nboxes, uint16 flags)
+{
+	size_t size = BRIN_MULTIBOX_SIZE(nboxes);
+	BRIN_MULTIBOX *mb = (BRIN_MULTIBOX *) palloc(size);
+
+	SET_VARSIZE(mb, size);
+	mb->nboxes = nboxes;
+	mb->flags = flags;
+	memcpy(mb->boxes, boxes, nboxes * sizeof(BOX2DF));
+	return PointerGetDatum(mb);
+}
+
+Datum
+geom2d_brin_multibox_opcinfo(PG_FUNCTION_ARGS)
+{
+	BrinOpcInfo *result;
+
+	/* A single stored value: the bytea holding the set of boxes */
+	result = (BrinOpcInfo *) palloc0(SizeofBrinOpcInfo(1));
+	result->oi_nstored = 1;
+	result->oi_typcache[0] = lookup_type_cache(BYTEAOID, 0);
+
+	PG_RETURN_POINTER(result);
+}
+
+Datum
+geom2d_brin_multibox_add_value(PG_FUNCTION_ARGS)
+{
+	BrinValues *column = (BrinValues *) PG_GETARG_POINTER(1);
+	Datum      newval = PG_GETARG_DATUM(2);
+	bool	   isnull = PG_GETARG_BOOL(3);
+	BOX2DF     box_geom;
+	BOX2DF     boxes[BRIN_MULTIBOX_MAX_BOXES + 1];
+	int        nboxes = 0;
+	uint16     flags = 0;
+
+	if (isnull)
+	{
+		if (column->bv_hasnulls)
+			PG_RETURN_BOOL(false);
+
+		column->bv_hasnulls = true;
+		PG_RETURN_BOOL(true);
+	}
+
+	if (!column->bv_allnulls)
+		nboxes = brin_multibox_get(column->bv_values[0], boxes, &flags);
+
+	if (gserialized_datum_get_box2df_p(newval, &box_geom) == LW_FAILURE)
+	{
+		if (!is_gserialized_from_datum_empty(newval))
+			elog(ERROR, "Error while extracting the box2df from the geom");
+
+		/*
+		 * Empties match no box operator, but the range must not look
+		 * all-nulls to IS NOT NULL scans: record them with a flag.
+		 */
+		if (!column->bv_allnulls && (flags & BRIN_MULTIBOX_CONTAINS_EMPTY))
+			PG_RETURN_BOOL(false);
+		flags |= BRIN_MULTIBOX_CONTAINS_EMPTY;
+	}
+	else if (!brin_multibox_add(boxes, &nboxes, &box_geom))
+	{
+		PG_RETURN_BOOL(false);
+	}
+
+	if (!column->bv_allnulls)
+		pfree(DatumGetPointer(column->bv_values[0]));
+	column->bv_values[0] = brin_multibox_datum(boxes, nboxes, flags);
+	column->bv_allnulls = false;
+
+	PG_RETURN_BOOL(true);
+}
+
+Datum
+geom2d_brin_multibox_consistent(PG_FUNCTION_ARGS)
+{
+	BrinDesc   *bdesc = (BrinDesc *) PG_GETARG_POINTER(0);
+	BrinValues *column = (BrinValues *) PG_GETARG_POINTER(1);
+	ScanKey     key = (ScanKey) PG_GETARG_POINTER(2);
+	Oid         geomtype;
+	BOX2DF      boxes[BRIN_MULTIBOX_MAX_BOXES + 1];
+	BOX2DF      query;
+	uint16      flags;
+	int         nboxes, i;
+
+#if POSTGIS_PGSQL_VERSION < 110
+	geomtype = bdesc->bd_tupdesc->attrs[column->bv_attno - 1]->atttypid;
+#else
+	geomtype = bdesc->bd_tupdesc->attrs[column->bv_attno - 1].atttypid;
+#endif
+
+	/* Handle IS NULL/IS NOT NULL tests */
+	if (key->sk_flags & SK_ISNULL)
+	{
+		if (key->sk_flags & SK_SEARCHNULL)
+			PG_RETURN_BOOL(column->bv_allnulls || column->bv_hasnulls);
+
+		if (key->sk_flags & SK_SEARCHNOTNULL)
+			PG_RETURN_BOOL(!column->bv_allnulls);
+
+		PG_RETURN_BOOL(false);
+	}
+
+	/* If it is all nulls, it cannot possibly be consistent. */
+	if (column->bv_allnulls)
+		PG_RETURN_BOOL(false);
+
+	/* The query is either a geometry or a box2df */
+	if (key->sk_subtype == InvalidOid || key->sk_subtype == geomtype)
+	{
+		if (gserialized_datum_get_box2df_p(key->sk_argument, &query) == LW_FAILURE)
+			PG_RETURN_BOOL(false);
+	}
+	else
+		query = *((BOX2DF *) DatumGetPointer(key->sk_argument));
+
+	nboxes = brin_multibox_get(column->bv_values[0], boxes, &flags);
+
+	switch (key->sk_strategy)
+	{
+		case RTOverlapStrategyNumber:
+		case RTContainedByStrategyNumber:
+			for (i = 0; i < nboxes; i++)
+			{
+				if (brin_multibox_overlaps(&boxes[i], &query))
+					PG_RETURN_BOOL(true);
+			}
+			PG_RETURN_BOOL(false);
+
+		case RTContainsStrategyNumber:
+			/* Whole geometries are inside one box, never across two */
+			for (i = 0; i < nboxes; i++)
+			{
+				if (box2df_contains(&boxes[i], &query))
+					PG_RETURN_BOOL(true);
+			}
+			PG_RETURN_BOOL(false);
+
+		default:
+			elog(ERROR, "invalid strategy number %d", key->sk_strategy);
+	}
+
+	PG_RETURN_BOOL(false);
+}
+
+Datum
+geom2d_brin_multibox_union(PG_FUNCTION_ARGS)
+{
+	BrinValues *col_a = (BrinValues *) PG_GETARG_POINTER(1);
+	BrinValues *col_b = (BrinValues *) PG_GETARG_POINTER(2);
+	BOX2DF      boxes_a[BRIN_MULTIBOX_MAX_BOXES + 1];
+	BOX2DF      boxes_b[BRIN_MULTIBOX_MAX_BOXES + 1];
+	uint16      flags_a, flags_b;
+	int         nboxes_a, nboxes_b, i;
+
+	/* Adjust "hasnulls" */
+	if (!col_a->bv_hasnulls && col_b->bv_hasnulls)
+		col_a->bv_hasnulls = true;
+
+	/* If there are no values in B, there's nothing left to do */
+	if (col_b->bv_allnulls)
+		PG_RETURN_VOID();
+
+	/* If A has no values, just copy B */
+	if (col_a->bv_allnulls)
+	{
+		col_a->bv_allnulls = false;
+		col_a->bv_values[0] = datumCopy(col_b->bv_values[0], false, -1);
+		PG_RETURN_VOID();
+	}
+
+	nboxes_a = brin_multibox_get(col_a->bv_values[0], boxes_a, &flags_a);
+	nboxes_b = brin_multibox_get(col_b->bv_values[0], boxes_b, &flags_b);
+	for (i = 0; i < nboxes_b; i++)
+		brin_multibox_add(boxes_a, &nboxes_a, &boxes_b[i]);
+
+	col_a->bv_values[0] = brin_multibox_datum(boxes_a, nboxes_a, flags_a | flags_b);
+
+	PG_RETURN_VOID();
+}
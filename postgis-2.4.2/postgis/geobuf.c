@@ -27,18 +27,99 @@
 
 #ifdef HAVE_LIBPROTOBUF
 
-#define FEATURES_CAPACITY_INITIAL 50
 #define MAX_PRECISION 1e6
 
-static Data__Geometry *encode_geometry(struct geobuf_agg_context *ctx,
-	LWGEOM *lwgeom);
+/* Wire types and field numbers of geobuf.proto */
+#define WIRE_VARINT 0
+#define WIRE_64BIT 1
+#define WIRE_LEN 2
+#define TAG(field, wire) (((field) << 3) | (wire))
+
+#define DATA_KEYS 1
+#define DATA_DIMENSIONS 2
+#define DATA_PRECISION 3
+#define DATA_FEATURE_COLLECTION 4
+#define FEATURE_COLLECTION_FEATURES 1
+#define FEATURE_GEOMETRY 1
+#define FEATURE_VALUES 13
+#define FEATURE_PROPERTIES 14
+#define GEOMETRY_TYPE 1
+#define GEOMETRY_LENGTHS 2
+#define GEOMETRY_COORDS 3
+#define GEOMETRY_GEOMETRIES 4
+#define VALUE_STRING 1
+#define VALUE_DOUBLE 2
+#define VALUE_POS_INT 3
+#define VALUE_NEG_INT 4
+
+/* Longest encoding of one point, four 64 bit varints */
+#define MAX_POINT_SIZE 40
+
+/* Message levels, for walking already encoded features */
+#define LEVEL_COLLECTION 0
+#define LEVEL_FEATURE 1
+#define LEVEL_GEOMETRY 2
+
+static void encode_geometry(struct geobuf_agg_context *ctx,
+	LWGEOM *lwgeom, StringInfo out);
+
+static inline uint8_t *varint_write(uint8_t *p, uint64_t v)
+{
+	while (v >= 0x80) {
+		*p++ = (uint8_t) (v | 0x80);
+		v >>= 7;
+	}
+	*p++ = (uint8_t) v;
+	return p;
+}
+
+static inline size_t varint_size(uint64_t v)
+{
+	size_t size = 1;
+	while (v >= 0x80) {
+		v >>= 7;
+		size++;
+	}
+	return size;
+}
+
+static uint64_t varint_read(const uint8_t **p, const uint8_t *end)
+{
+	uint64_t v = 0;
+	int shift = 0;
+	while (*p < end && shift < 64) {
+		uint8_t b = *(*p)++;
+		v |= (uint64_t) (b & 0x7f) << shift;
+		if (!(b & 0x80))
+			return v;
+		shift += 7;
+	}
+	elog(ERROR, "varint_read: truncated geobuf state");
+	return 0;
+}
+
+static inline uint64_t zigzag(int64_t v)
+{
+	return ((uint64_t) v << 1) ^ (uint64_t) (v >> 63);
+}
+
+static inline int64_t unzigzag(uint64_t v)
+{
+	return (int64_t) (v >> 1) ^ -(int64_t) (v & 1);
+}
+
+static void write_varint(StringInfo out, uint64_t v)
+{
+	uint8_t buf[10];
+	appendBinaryStringInfo(out, (char *) buf, varint_write(buf, v) - buf);
+}
 
-static Data__Geometry *galloc(Data__Geometry__Type type) {
-	Data__Geometry *geometry;
-	geometry = palloc (sizeof (Data__Geometry));
-	data__geometry__init(geometry);
-	geometry->type = type;
-	return geometry;
+static void write_field(StringInfo out, uint32_t field, const char *data,
+	size_t len)
+{
+	write_varint(out, TAG(field, WIRE_LEN));
+	write_varint(out, len);
+	appendBinaryStringInfo(out, data, len);
 }
 
 static TupleDesc get_tuple_desc(struct geobuf_agg_context *ctx)
@@ -49,23 +130,36 @@ static TupleDesc get_tuple_desc(struct geobuf_agg_context *ctx)
 	return tupdesc;
 }
 
+/**
+ * Find the geometry column and the property keys, and the types and
+ * output functions of the properties, assuming a static schema.
+ */
 static void encode_keys(struct geobuf_agg_context *ctx)
 {
 	TupleDesc tupdesc = get_tuple_desc(ctx);
 	int natts = tupdesc->natts;
-	char **keys = palloc(natts * sizeof(*keys));
+	char **keys = (char **) palloc(natts * sizeof(*keys));
 	uint32_t i, k = 0;
 	bool geom_found = false;
+
+	ctx->natts = natts;
+	ctx->typoids = (Oid *) palloc(natts * sizeof(Oid));
+	ctx->foutoids = (Oid *) palloc(natts * sizeof(Oid));
+
 	for (i = 0; i < natts; i++) {
+		bool typisvarlena;
 #if POSTGIS_PGSQL_VERSION < 110
-		Oid typoid = getBaseType(tupdesc->attrs[i]->atttypid);
+		Oid atttypid = tupdesc->attrs[i]->atttypid;
 		char *tkey = tupdesc->attrs[i]->attname.data;
 #else
-		Oid typoid = getBaseType(tupdesc->attrs[i].atttypid);
+		Oid atttypid = tupdesc->attrs[i].atttypid;
 		char *tkey = tupdesc->attrs[i].attname.data;
 #endif
-		char *key = palloc(strlen(tkey) + 1);
+		Oid typoid = getBaseType(atttypid);
+		char *key = (char *) palloc(strlen(tkey) + 1);
 		strcpy(key, tkey);
+		ctx->typoids[i] = atttypid;
+		getTypeOutputInfo(typoid, &ctx->foutoids[i], &typisvarlena);
 		if (ctx->geom_name == NULL) {
 			if (!geom_found && typoid == TypenameGetTypid("geometry")) {
 				ctx->geom_index = i;
@@ -83,36 +177,53 @@ static void encode_keys(struct geobuf_agg_context *ctx)
 	}
 	if (!geom_found)
 		elog(ERROR, "encode_keys: no geometry column found");
-	ctx->data->n_keys = k;
-	ctx->data->keys = keys;
+	ctx->n_keys = k;
+	ctx->keys = keys;
 	ReleaseTupleDesc(tupdesc);
 }
 
-
-static void set_int_value(Data__Value *value, int64 intval) {
-	if (intval >= 0) {
-		value->value_type_case = DATA__VALUE__VALUE_TYPE_POS_INT_VALUE;
-		value->pos_int_value = (uint64_t) intval;
-	} else {
-		value->value_type_case = DATA__VALUE__VALUE_TYPE_NEG_INT_VALUE;
-		value->neg_int_value = (uint64_t) labs(intval);
+static void write_int_value(StringInfo out, int64 intval)
+{
+	uint32_t field = VALUE_POS_INT;
+	uint64_t v = (uint64_t) intval;
+	if (intval < 0) {
+		field = VALUE_NEG_INT;
+		v = (uint64_t) labs(intval);
 	}
+	write_varint(out, TAG(FEATURE_VALUES, WIRE_LEN));
+	write_varint(out, 1 + varint_size(v));
+	write_varint(out, TAG(field, WIRE_VARINT));
+	write_varint(out, v);
+}
+
+static void write_double_value(StringInfo out, double d)
+{
+	write_varint(out, TAG(FEATURE_VALUES, WIRE_LEN));
+	write_varint(out, 1 + sizeof(double));
+	write_varint(out, TAG(VALUE_DOUBLE, WIRE_64BIT));
+	appendBinaryStringInfo(out, (char *) &d, sizeof(double));
 }
 
+static void write_string_value(StringInfo out, const char *str)
+{
+	size_t len = strlen(str);
+	write_varint(out, TAG(FEATURE_VALUES, WIRE_LEN));
+	write_varint(out, 1 + varint_size(len) + len);
+	write_field(out, VALUE_STRING, str, len);
+}
+
+/**
+ * Write the values and properties fields of the current row.
+ */
 static void encode_properties(struct geobuf_agg_context *ctx,
-	Data__Feature *feature)
+	StringInfo out)
 {
-	uint32_t *properties;
-	Data__Value **values;
+	StringInfo properties = &ctx->lengths;
 	uint32_t i, k = 0, c = 0;
-	TupleDesc tupdesc = get_tuple_desc(ctx);
-	int natts = tupdesc->natts;
-	properties = palloc(sizeof (*properties) * (natts - 1) * 2);
-	values = palloc (sizeof (*values) * (natts - 1));
 
-	for (i = 0; i < natts; i++) {
-		Data__Value *value;
-		char *type, *string_value;
+	resetStringInfo(properties);
+
+	for (i = 0; i < ctx->natts; i++) {
 		Datum datum;
 		bool isnull;
 
@@ -120,327 +231,259 @@ static void encode_properties(struct geobuf_agg_context *ctx,
 			continue;
 		k++;
 
-		value = palloc (sizeof (*value));
-		data__value__init(value);
-
-		type = SPI_gettype(tupdesc, i + 1);
 		datum = GetAttributeByNum(ctx->row, i + 1, &isnull);
 		if (isnull)
 			continue;
-#if POSTGIS_PGSQL_VERSION < 110
-		Oid typoid = getBaseType(tupdesc->attrs[i]->atttypid);
-#else
-		Oid typoid = getBaseType(tupdesc->attrs[i].atttypid);
-#endif
-		if (strcmp(type, "int2") == 0) {
-			set_int_value(value, DatumGetInt16(datum));
-		} else if (strcmp(type, "int4") == 0) {
-			set_int_value(value, DatumGetInt32(datum));
-		} else if (strcmp(type, "int8") == 0) {
-			set_int_value(value, DatumGetInt64(datum));
-		} else if (strcmp(type, "float4") == 0) {
-			value->value_type_case = DATA__VALUE__VALUE_TYPE_DOUBLE_VALUE;
-			value->double_value = DatumGetFloat4(datum);
-		} else if (strcmp(type, "float8") == 0) {
-			value->value_type_case = DATA__VALUE__VALUE_TYPE_DOUBLE_VALUE;
-			value->double_value = DatumGetFloat8(datum);
-		} else {
-			Oid foutoid;
-			bool typisvarlena;
-			getTypeOutputInfo(typoid, &foutoid, &typisvarlena);
-			string_value = OidOutputFunctionCall(foutoid, datum);
-			value->value_type_case = DATA__VALUE__VALUE_TYPE_STRING_VALUE;
-			value->string_value = string_value;
+
+		switch (ctx->typoids[i]) {
+		case INT2OID:
+			write_int_value(out, DatumGetInt16(datum));
+			break;
+		case INT4OID:
+			write_int_value(out, DatumGetInt32(datum));
+			break;
+		case INT8OID:
+			write_int_value(out, DatumGetInt64(datum));
+			break;
+		case FLOAT4OID:
+			write_double_value(out, DatumGetFloat4(datum));
+			break;
+		case FLOAT8OID:
+			write_double_value(out, DatumGetFloat8(datum));
+			break;
+		default:
+			write_string_value(out,
+				OidOutputFunctionCall(ctx->foutoids[i], datum));
+			break;
 		}
-		properties[c * 2] = k - 1;
-		properties[c * 2 + 1] = c;
-		values[c++] = value;
+		write_varint(properties, k - 1);
+		write_varint(properties, c++);
 	}
 
-	ReleaseTupleDesc(tupdesc);
-
-	feature->n_values = c;
-	feature->values = values;
-	feature->n_properties = c * 2;
-	feature->properties = properties;
+	if (properties->len)
+		write_field(out, FEATURE_PROPERTIES, properties->data,
+			properties->len);
 }
 
-static int64_t *encode_coords(struct geobuf_agg_context *ctx, POINTARRAY *pa,
-	int64_t *coords, int len, int offset)
+/**
+ * Append delta-coded coordinates of the first len points of pa.
+ * Deltas start over on every call, as they do for every ring.
+ */
+static void encode_coords(struct geobuf_agg_context *ctx, POINTARRAY *pa,
+	int len, StringInfo out)
 {
-	int i, c;
+	int i;
 	POINT4D pt;
-	int64_t sum[] = { 0, 0, 0, 0 };
+	int64_t v, sum[] = { 0, 0, 0, 0 };
+	uint8_t *p;
 
-	if (offset == 0)
-		coords = palloc(sizeof (int64_t) * len * ctx->dimensions);
-	else
-		coords = repalloc(coords, sizeof (int64_t) *
-			((len * ctx->dimensions) + offset));
-
-	c = offset;
 	for (i = 0; i < len; i++) {
+		if (out->maxlen - out->len <= MAX_POINT_SIZE)
+			enlargeStringInfo(out, MAX_POINT_SIZE);
+		p = (uint8_t *) out->data + out->len;
 		getPoint4d_p(pa, i, &pt);
-		sum[0] += coords[c++] = (int64_t) (ceil(pt.x * ctx->e) - sum[0]);
-		sum[1] += coords[c++] = (int64_t) (ceil(pt.y * ctx->e) - sum[1]);
-		if (ctx->dimensions == 3)
-			sum[2] += coords[c++] = (int64_t) (ceil(pt.z * ctx->e) - sum[2]);
-		else if (ctx->dimensions == 4)
-			sum[3] += coords[c++] = (int64_t) (ceil(pt.m * ctx->e) - sum[3]);
+		v = llround(pt.x * ctx->e);
+		p = varint_write(p, zigzag(v - sum[0]));
+		sum[0] = v;
+		v = llround(pt.y * ctx->e);
+		p = varint_write(p, zigzag(v - sum[1]));
+		sum[1] = v;
+		if (ctx->dimensions >= 3) {
+			v = llround(pt.z * ctx->e);
+			p = varint_write(p, zigzag(v - sum[2]));
+			sum[2] = v;
+		}
+		if (ctx->dimensions == 4) {
+			v = llround(pt.m * ctx->e);
+			p = varint_write(p, zigzag(v - sum[3]));
+			sum[3] = v;
+		}
+		out->len = (char *) p - out->data;
 	}
-	return coords;
+	out->data[out->len] = '\0';
 }
 
-static Data__Geometry *encode_point(struct geobuf_agg_context *ctx,
-	LWPOINT *lwpoint)
+/**
+ * Write a geometry of the given type, with the lengths and coordinates
+ * gathered in the scratch buffers.
+ */
+static void write_geometry(struct geobuf_agg_context *ctx,
+	Data__Geometry__Type type, StringInfo out)
 {
-	int npoints;
-	Data__Geometry *geometry;
-	POINTARRAY *pa;
-
-	geometry = galloc(DATA__GEOMETRY__TYPE__POINT);
-
-	pa = lwpoint->point;
-	npoints = pa->npoints;
-
-	if (npoints == 0)
-		return geometry;
-
-	geometry->n_coords = npoints * ctx->dimensions;
-	geometry->coords = encode_coords(ctx, pa, NULL, 1, 0);
+	write_varint(out, TAG(GEOMETRY_TYPE, WIRE_VARINT));
+	write_varint(out, type);
+	if (ctx->lengths.len)
+		write_field(out, GEOMETRY_LENGTHS, ctx->lengths.data,
+			ctx->lengths.len);
+	if (ctx->coords.len)
+		write_field(out, GEOMETRY_COORDS, ctx->coords.data,
+			ctx->coords.len);
+}
 
-	return geometry;
+static void encode_point(struct geobuf_agg_context *ctx, LWPOINT *lwpoint,
+	StringInfo out)
+{
+	POINTARRAY *pa = lwpoint->point;
+	if (pa->npoints > 0)
+		encode_coords(ctx, pa, 1, &ctx->coords);
+	write_geometry(ctx, DATA__GEOMETRY__TYPE__POINT, out);
 }
 
-static Data__Geometry *encode_mpoint(struct geobuf_agg_context *ctx,
-	LWMPOINT *lwmpoint)
+static void encode_mpoint(struct geobuf_agg_context *ctx, LWMPOINT *lwmpoint,
+	StringInfo out)
 {
-	int i, ngeoms;
+	int i;
 	POINTARRAY *pa;
-	Data__Geometry *geometry;
-
-	geometry = galloc(DATA__GEOMETRY__TYPE__MULTIPOINT);
-
-	ngeoms = lwmpoint->ngeoms;
-
-	if (ngeoms == 0)
-		return geometry;
-
-	pa = ptarray_construct_empty(0, 0, ngeoms);
+	POINT4D pt;
 
-	for (i = 0; i < ngeoms; i++) {
-		POINT4D pt;
-		getPoint4d_p(lwmpoint->geoms[i]->point, 0, &pt);
-		ptarray_append_point(pa, &pt, 0);
+	if (lwmpoint->ngeoms > 0) {
+		pa = ptarray_construct_empty(
+			FLAGS_GET_Z(lwmpoint->flags), FLAGS_GET_M(lwmpoint->flags),
+			lwmpoint->ngeoms);
+		for (i = 0; i < lwmpoint->ngeoms; i++) {
+			if (lwmpoint->geoms[i]->point->npoints == 0)
+				continue;
+			getPoint4d_p(lwmpoint->geoms[i]->point, 0, &pt);
+			ptarray_append_point(pa, &pt, LW_TRUE);
+		}
+		encode_coords(ctx, pa, pa->npoints, &ctx->coords);
+		ptarray_free(pa);
 	}
-
-	geometry->n_coords = ngeoms * ctx->dimensions;
-	geometry->coords = encode_coords(ctx, pa, NULL, ngeoms, 0);
-
-	return geometry;
+	write_geometry(ctx, DATA__GEOMETRY__TYPE__MULTIPOINT, out);
 }
 
-static Data__Geometry *encode_line(struct geobuf_agg_context *ctx,
-	LWLINE *lwline)
+static void encode_line(struct geobuf_agg_context *ctx, LWLINE *lwline,
+	StringInfo out)
 {
-	POINTARRAY *pa;
-	Data__Geometry *geometry;
-
-	geometry = galloc(DATA__GEOMETRY__TYPE__LINESTRING);
-
-	pa = lwline->points;
-
-	if (pa->npoints == 0)
-		return geometry;
-
-	geometry->n_coords = pa->npoints * ctx->dimensions;
-	geometry->coords = encode_coords(ctx, pa, NULL, pa->npoints, 0);
-
-	return geometry;
+	POINTARRAY *pa = lwline->points;
+	if (pa->npoints > 0)
+		encode_coords(ctx, pa, pa->npoints, &ctx->coords);
+	write_geometry(ctx, DATA__GEOMETRY__TYPE__LINESTRING, out);
 }
 
-static Data__Geometry *encode_mline(struct geobuf_agg_context *ctx,
-	LWMLINE *lwmline)
+static void encode_mline(struct geobuf_agg_context *ctx, LWMLINE *lwmline,
+	StringInfo out)
 {
-	int i, offset, ngeoms;
+	int i;
 	POINTARRAY *pa;
-	Data__Geometry *geometry;
-	uint32_t *lengths;
-	int64_t *coords = NULL;
-
-	geometry = galloc(DATA__GEOMETRY__TYPE__MULTILINESTRING);
-
-	ngeoms = lwmline->ngeoms;
-
-	if (ngeoms == 0)
-		return geometry;
 
-	lengths = palloc (sizeof (uint32_t) * ngeoms);
-
-	offset = 0;
-	for (i = 0; i < ngeoms; i++) {
+	for (i = 0; i < lwmline->ngeoms; i++) {
 		pa = lwmline->geoms[i]->points;
-		coords = encode_coords(ctx, pa, coords, pa->npoints, offset);
-		offset += pa->npoints * ctx->dimensions;
-		lengths[i] = pa->npoints;
-	}
-
-	if (ngeoms > 1) {
-		geometry->n_lengths = ngeoms;
-		geometry->lengths = lengths;
+		encode_coords(ctx, pa, pa->npoints, &ctx->coords);
+		write_varint(&ctx->lengths, pa->npoints);
 	}
 
-	geometry->n_coords = offset;
-	geometry->coords = coords;
+	if (lwmline->ngeoms <= 1)
+		resetStringInfo(&ctx->lengths);
 
-	return geometry;
+	write_geometry(ctx, DATA__GEOMETRY__TYPE__MULTILINESTRING, out);
 }
 
-static Data__Geometry *encode_poly(struct geobuf_agg_context *ctx,
-	LWPOLY *lwpoly)
+/* Rings are written without their closing point */
+static void encode_rings(struct geobuf_agg_context *ctx, LWPOLY *lwpoly)
 {
-	int i, len, nrings, offset;
+	int i, len;
 	POINTARRAY *pa;
-	Data__Geometry *geometry;
-	uint32_t *lengths;
-	int64_t *coords = NULL;
-
-	geometry = galloc(DATA__GEOMETRY__TYPE__POLYGON);
-
-	nrings = lwpoly->nrings;
-
-	if (nrings == 0)
-		return geometry;
 
-	lengths = palloc (sizeof (uint32_t) * nrings);
-
-	offset = 0;
-	for (i = 0; i < nrings; i++) {
+	for (i = 0; i < lwpoly->nrings; i++) {
 		pa = lwpoly->rings[i];
-		len = pa->npoints - 1;
-		coords = encode_coords(ctx, pa, coords, len, offset);
-		offset += len * ctx->dimensions;
-		lengths[i] = len;
-	}
-
-	if (nrings > 1) {
-		geometry->n_lengths = nrings;
-		geometry->lengths = lengths;
+		len = pa->npoints > 0 ? pa->npoints - 1 : 0;
+		encode_coords(ctx, pa, len, &ctx->coords);
+		write_varint(&ctx->lengths, len);
 	}
-
-	geometry->n_coords = offset;
-	geometry->coords = coords;
-
-	return geometry;
 }
 
-static Data__Geometry *encode_mpoly(struct geobuf_agg_context *ctx,
-	LWMPOLY* lwmpoly)
+static void encode_poly(struct geobuf_agg_context *ctx, LWPOLY *lwpoly,
+	StringInfo out)
 {
-	int i, j, c, len, offset, n_lengths, ngeoms, nrings;
-	POINTARRAY *pa;
-	Data__Geometry *geometry;
-	uint32_t *lengths;
-	int64_t *coords = NULL;
-
-	geometry = galloc(DATA__GEOMETRY__TYPE__MULTIPOLYGON);
+	encode_rings(ctx, lwpoly);
 
-	ngeoms = lwmpoly->ngeoms;
+	if (lwpoly->nrings <= 1)
+		resetStringInfo(&ctx->lengths);
 
-	if (ngeoms == 0) return geometry;
+	write_geometry(ctx, DATA__GEOMETRY__TYPE__POLYGON, out);
+}
 
-	n_lengths = 1;
-	for (i = 0; i < ngeoms; i++) {
-		nrings = lwmpoly->geoms[i]->nrings;
-		n_lengths++;
-		for (j = 0; j < nrings; j++)
-			n_lengths++;
-	}
+static void encode_mpoly(struct geobuf_agg_context *ctx, LWMPOLY *lwmpoly,
+	StringInfo out)
+{
+	int i;
 
-	lengths = palloc (sizeof (uint32_t) * n_lengths);
-
-	c = 0;
-	offset = 0;
-	lengths[c++] = ngeoms;
-	for (i = 0; i < ngeoms; i++) {
-		nrings = lwmpoly->geoms[i]->nrings;
-		lengths[c++] = nrings;
-		for (j = 0; j < nrings; j++) {
-			pa = lwmpoly->geoms[i]->rings[j];
-			len = pa->npoints - 1;
-			coords = encode_coords(ctx, pa, coords, len, offset);
-			offset += len * ctx->dimensions;
-			lengths[c++] = len;
+	if (lwmpoly->ngeoms > 0) {
+		write_varint(&ctx->lengths, lwmpoly->ngeoms);
+		for (i = 0; i < lwmpoly->ngeoms; i++) {
+			write_varint(&ctx->lengths, lwmpoly->geoms[i]->nrings);
+			encode_rings(ctx, lwmpoly->geoms[i]);
 		}
 	}
 
-	if (c > 1) {
-		geometry->n_lengths = n_lengths;
-		geometry->lengths = lengths;
-	}
-
-	geometry->n_coords = offset;
-	geometry->coords = coords;
-
-	return geometry;
+	write_geometry(ctx, DATA__GEOMETRY__TYPE__MULTIPOLYGON, out);
 }
 
-static Data__Geometry *encode_collection(struct geobuf_agg_context *ctx,
-	LWCOLLECTION* lwcollection)
+static void encode_collection(struct geobuf_agg_context *ctx,
+	LWCOLLECTION *lwcollection, StringInfo out)
 {
-	int i, ngeoms;
-	Data__Geometry *geometry, **geometries;
-
-	geometry = galloc(DATA__GEOMETRY__TYPE__GEOMETRYCOLLECTION);
-
-	ngeoms = lwcollection->ngeoms;
+	int i;
+	StringInfoData geometry;
 
-	if (ngeoms == 0)
-		return geometry;
+	write_varint(out, TAG(GEOMETRY_TYPE, WIRE_VARINT));
+	write_varint(out, DATA__GEOMETRY__TYPE__GEOMETRYCOLLECTION);
 
-	geometries = palloc (sizeof (Data__Geometry *) * ngeoms);
-	for (i = 0; i < ngeoms; i++) {
-		LWGEOM *lwgeom = lwcollection->geoms[i];
-		Data__Geometry *geom = encode_geometry(ctx, lwgeom);
-		geometries[i] = geom;
+	initStringInfo(&geometry);
+	for (i = 0; i < lwcollection->ngeoms; i++) {
+		resetStringInfo(&geometry);
+		encode_geometry(ctx, lwcollection->geoms[i], &geometry);
+		write_field(out, GEOMETRY_GEOMETRIES, geometry.data, geometry.len);
 	}
-
-	geometry->n_geometries = ngeoms;
-	geometry->geometries = geometries;
-
-	return geometry;
+	pfree(geometry.data);
 }
 
-static Data__Geometry *encode_geometry(struct geobuf_agg_context *ctx,
-	LWGEOM *lwgeom)
+/**
+ * Write a Geometry message, without its tag and length, to out.
+ */
+static void encode_geometry(struct geobuf_agg_context *ctx,
+	LWGEOM *lwgeom, StringInfo out)
 {
 	int type = lwgeom->type;
+
+	resetStringInfo(&ctx->lengths);
+	resetStringInfo(&ctx->coords);
+
 	switch (type)
 	{
 	case POINTTYPE:
-		return encode_point(ctx, (LWPOINT*)lwgeom);
+		encode_point(ctx, (LWPOINT*)lwgeom, out);
+		break;
 	case LINETYPE:
-		return encode_line(ctx, (LWLINE*)lwgeom);
+		encode_line(ctx, (LWLINE*)lwgeom, out);
+		break;
 	case POLYGONTYPE:
-		return encode_poly(ctx, (LWPOLY*)lwgeom);
+		encode_poly(ctx, (LWPOLY*)lwgeom, out);
+		break;
 	case MULTIPOINTTYPE:
-		return encode_mpoint(ctx, (LWMPOINT*)lwgeom);
+		encode_mpoint(ctx, (LWMPOINT*)lwgeom, out);
+		break;
 	case MULTILINETYPE:
-		return encode_mline(ctx, (LWMLINE*)lwgeom);
+		encode_mline(ctx, (LWMLINE*)lwgeom, out);
+		break;
 	case MULTIPOLYGONTYPE:
-		return encode_mpoly(ctx, (LWMPOLY*)lwgeom);
+		encode_mpoly(ctx, (LWMPOLY*)lwgeom, out);
+		break;
 	case COLLECTIONTYPE:
-		return encode_collection(ctx, (LWCOLLECTION*)lwgeom);
+		encode_collection(ctx, (LWCOLLECTION*)lwgeom, out);
+		break;
 	default:
 		elog(ERROR, "encode_geometry: '%s' geometry type not supported",
 				lwtype_name(type));
 	}
-	return NULL;
 }
 
+/**
+ * Raise the precision until val is represented, up to the maximum.
+ */
 static void analyze_val(struct geobuf_agg_context *ctx, double val)
 {
-	if (fabs((round(val * ctx->e) / ctx->e) - val) >= EPSILON &&
+	while (fabs((round(val * ctx->e) / ctx->e) - val) >= EPSILON &&
 		ctx->e < MAX_PRECISION)
 		ctx->e *= 10;
 }
@@ -507,15 +550,116 @@ static void analyze_geometry_flags(struct geobuf_agg_context *ctx,
 	}
 }
 
-static Data__Feature *encode_feature(struct geobuf_agg_context *ctx)
+/**
+ * Copy an encoded message, multiplying all coordinates by factor and
+ * giving 2d coordinates a zero third dimension if add_dim is set.
+ */
+static void rescale_message(const uint8_t *p, const uint8_t *end, int level,
+	int64_t factor, bool add_dim, StringInfo out)
 {
-	Data__Feature *feature;
+	while (p < end) {
+		uint64_t tag = varint_read(&p, end);
+		uint32_t field = tag >> 3;
+		const uint8_t *sub;
+		uint64_t len;
+
+		write_varint(out, tag);
+		switch (tag & 7) {
+		case WIRE_VARINT:
+			write_varint(out, varint_read(&p, end));
+			break;
+		case WIRE_64BIT:
+			if (end - p < 8)
+				elog(ERROR, "rescale_message: truncated geobuf state");
+			appendBinaryStringInfo(out, (const char *) p, 8);
+			p += 8;
+			break;
+		case WIRE_LEN:
+			len = varint_read(&p, end);
+			if ((uint64_t) (end - p) < len)
+				elog(ERROR, "rescale_message: truncated geobuf state");
+			sub = p;
+			p += len;
+			if ((level == LEVEL_COLLECTION && field == FEATURE_COLLECTION_FEATURES) ||
+				(level == LEVEL_FEATURE && field == FEATURE_GEOMETRY) ||
+				(level == LEVEL_GEOMETRY && field == GEOMETRY_GEOMETRIES)) {
+				StringInfoData msg;
+				initStringInfo(&msg);
+				rescale_message(sub, p,
+					level == LEVEL_COLLECTION ? LEVEL_FEATURE : LEVEL_GEOMETRY,
+					factor, add_dim, &msg);
+				write_varint(out, msg.len);
+				appendBinaryStringInfo(out, msg.data, msg.len);
+				pfree(msg.data);
+			} else if (level == LEVEL_GEOMETRY && field == GEOMETRY_COORDS) {
+				StringInfoData coords;
+				uint32_t n = 0;
+				initStringInfo(&coords);
+				while (sub < p) {
+					write_varint(&coords,
+						zigzag(unzigzag(varint_read(&sub, p)) * factor));
+					if (add_dim && ++n % 2 == 0)
+						write_varint(&coords, 0);
+				}
+				write_varint(out, coords.len);
+				appendBinaryStringInfo(out, coords.data, coords.len);
+				pfree(coords.data);
+			} else {
+				write_varint(out, len);
+				appendBinaryStringInfo(out, (const char *) sub, len);
+			}
+			break;
+		default:
+			elog(ERROR, "rescale_message: unexpected wire type in geobuf state");
+		}
+	}
+}
 
-	feature = palloc (sizeof (Data__Feature));
-	data__feature__init(feature);
+/**
+ * Bring the features encoded so far to a higher precision and/or
+ * from 2 to 3 dimensions.
+ */
+static void rescale_features(struct geobuf_agg_context *ctx, uint32_t e,
+	uint32_t dimensions)
+{
+	StringInfoData features;
+	bool add_dim = ctx->dimensions == 2 && dimensions == 3;
+
+	if (ctx->n_features > 0 && (e != ctx->e || add_dim)) {
+		POSTGIS_DEBUGF(3, "rescale_features: %u features from e=%u to e=%u",
+			ctx->n_features, ctx->e, e);
+		initStringInfo(&features);
+		rescale_message((uint8_t *) ctx->features.data,
+			(uint8_t *) ctx->features.data + ctx->features.len,
+			LEVEL_COLLECTION, e / ctx->e, add_dim, &features);
+		resetStringInfo(&ctx->features);
+		appendBinaryStringInfo(&ctx->features, features.data, features.len);
+		pfree(features.data);
+	}
+	ctx->e = e;
+	ctx->dimensions = dimensions;
+}
 
-	encode_properties(ctx, feature);
-	return feature;
+/**
+ * Append the feature of the current row to the collection.
+ */
+static void encode_feature(struct geobuf_agg_context *ctx, LWGEOM *lwgeom)
+{
+	StringInfo features = &ctx->features;
+	size_t len;
+
+	resetStringInfo(&ctx->geom);
+	resetStringInfo(&ctx->props);
+
+	encode_geometry(ctx, lwgeom, &ctx->geom);
+	encode_properties(ctx, &ctx->props);
+
+	len = 1 + varint_size(ctx->geom.len) + ctx->geom.len + ctx->props.len;
+	write_varint(features, TAG(FEATURE_COLLECTION_FEATURES, WIRE_LEN));
+	write_varint(features, len);
+	write_field(features, FEATURE_GEOMETRY, ctx->geom.data, ctx->geom.len);
+	appendBinaryStringInfo(features, ctx->props.data, ctx->props.len);
+	ctx->n_features++;
 }
 
 /**
@@ -523,116 +667,217 @@ static Data__Feature *encode_feature(struct geobuf_agg_context *ctx)
  */
 void geobuf_agg_init_context(struct geobuf_agg_context *ctx)
 {
-	Data *data;
-	Data__FeatureCollection *fc;
-
 	ctx->has_dimensions = 0;
 	ctx->dimensions = 2;
 	ctx->has_precision = 0;
 	ctx->precision = MAX_PRECISION;
 	ctx->e = 1;
-	ctx->features_capacity = FEATURES_CAPACITY_INITIAL;
-
-	data = palloc(sizeof(*data));
-	data__init(data);
-
-	fc = palloc(sizeof(*fc));
-	data__feature_collection__init(fc);
-
-	fc->features = palloc (ctx->features_capacity *
-		sizeof(*fc->features));
-
-	ctx->lwgeoms = palloc (ctx->features_capacity *
-		sizeof(*ctx->lwgeoms));
-
-	data->data_type_case = DATA__DATA_TYPE_FEATURE_COLLECTION;
-	data->feature_collection = fc;
-
-	ctx->data = data;
+	ctx->keys = NULL;
+	ctx->n_keys = 0;
+	ctx->natts = 0;
+	ctx->n_features = 0;
+
+	initStringInfo(&ctx->features);
+	initStringInfo(&ctx->geom);
+	initStringInfo(&ctx->props);
+	initStringInfo(&ctx->lengths);
+	initStringInfo(&ctx->coords);
+
+	ctx->row_context = AllocSetContextCreate(CurrentMemoryContext,
+		"geobuf row context",
+		ALLOCSET_DEFAULT_MINSIZE,
+		ALLOCSET_DEFAULT_INITSIZE,
+		ALLOCSET_DEFAULT_MAXSIZE);
 }
 
 /**
  * Aggregation step.
  *
- * Expands features array if needed by a factor of 2.
- * Allocates a new feature, increment feature counter and
- * encode properties into it.
- */
+ * Encodes the feature of the row into the collection right away, after
+ * raising the precision of what is already there if the new geometry
+ * needs more. Only the encoded bytes are kept, everything else used for
+ * the row goes away with the row context.
+ */
 void geobuf_agg_transfn(struct geobuf_agg_context *ctx)
 {
 	LWGEOM *lwgeom;
 	bool isnull = false;
 	Datum datum;
-	Data__FeatureCollection *fc = ctx->data->feature_collection;
-	Data__Feature *feature;
 	GSERIALIZED *gs;
-	if (fc->n_features >= ctx->features_capacity) {
-		size_t new_capacity = ctx->features_capacity * 2;
-		fc->features = repalloc(fc->features, new_capacity *
-			sizeof(*fc->features));
-		ctx->lwgeoms = repalloc(ctx->lwgeoms, new_capacity *
-			sizeof(*ctx->lwgeoms));
-		ctx->features_capacity = new_capacity;
-	}
+	MemoryContext old_context;
+	uint32_t e;
 
 	/* inspect row and encode keys assuming static schema */
-	if (fc->n_features == 0)
+	if (ctx->keys == NULL)
 		encode_keys(ctx);
 
 	datum = GetAttributeByNum(ctx->row, ctx->geom_index + 1, &isnull);
 	if (isnull)
 		return;
 
-	gs = (GSERIALIZED *) PG_DETOAST_DATUM_COPY(datum);
-	lwgeom = lwgeom_from_gserialized(gs);
+	old_context = MemoryContextSwitchTo(ctx->row_context);
 
-	feature = encode_feature(ctx);
+	gs = (GSERIALIZED *) PG_DETOAST_DATUM(datum);
+	lwgeom = lwgeom_from_gserialized(gs);
 
 	/* inspect geometry flags assuming static schema */
-	if (fc->n_features == 0)
+	if (ctx->n_features == 0)
 		analyze_geometry_flags(ctx, lwgeom);
 
+	e = ctx->e;
 	analyze_geometry(ctx, lwgeom);
+	if (ctx->e != e) {
+		uint32_t new_e = ctx->e;
+		ctx->e = e;
+		rescale_features(ctx, new_e, ctx->dimensions);
+	}
+
+	encode_feature(ctx, lwgeom);
 
-	ctx->lwgeoms[fc->n_features] = lwgeom;
-	fc->features[fc->n_features++] = feature;
+	MemoryContextSwitchTo(old_context);
+	MemoryContextReset(ctx->row_context);
 }
 
 /**
- * Finalize aggregation.
+ * Combine two partial aggregations into ctx1.
  *
- * Encode into Data message and return it packed as a bytea.
+ * Both are brought to the higher precision and dimensions of the two,
+ * then the features of ctx2 are appended to those of ctx1.
  */
-uint8_t *geobuf_agg_finalfn(struct geobuf_agg_context *ctx)
+void geobuf_agg_combine(struct geobuf_agg_context *ctx1,
+	struct geobuf_agg_context *ctx2)
 {
-	int i;
-	Data *data;
-	Data__FeatureCollection *fc;
+	uint32_t e = Max(ctx1->e, ctx2->e);
+	uint32_t dimensions = ctx1->dimensions;
 
-	data = ctx->data;
-	fc = data->feature_collection;
+	if (ctx2->has_dimensions) {
+		if (!ctx1->has_dimensions || ctx2->dimensions > dimensions)
+			dimensions = ctx2->dimensions;
+		ctx1->has_dimensions = 1;
+	}
 
-	/* check and set dimensions if not default */
-	if (ctx->dimensions != 2) {
-		data->has_dimensions = ctx->has_dimensions;
-		data->dimensions = ctx->dimensions;
+	if (ctx1->keys == NULL) {
+		ctx1->keys = ctx2->keys;
+		ctx1->n_keys = ctx2->n_keys;
+		ctx1->geom_index = ctx2->geom_index;
 	}
 
+	rescale_features(ctx1, e, dimensions);
+	rescale_features(ctx2, e, dimensions);
+
+	appendBinaryStringInfo(&ctx1->features, ctx2->features.data,
+		ctx2->features.len);
+	ctx1->n_features += ctx2->n_features;
+}
+
+/**
+ * Serialize a partial aggregation: header fields, the keys as
+ * NUL terminated strings, then the encoded features.
+ */
+bytea *geobuf_agg_serialize(struct geobuf_agg_context *ctx)
+{
+	StringInfoData buf;
+	uint32_t header[6];
+	uint32_t i;
+
+	header[0] = ctx->geom_index;
+	header[1] = ctx->n_keys;
+	header[2] = ctx->n_features;
+	header[3] = ctx->e;
+	header[4] = ctx->has_dimensions;
+	header[5] = ctx->dimensions;
+
+	initStringInfo(&buf);
+	appendStringInfoSpaces(&buf, VARHDRSZ);
+	appendBinaryStringInfo(&buf, (char *) header, sizeof(header));
+	for (i = 0; i < ctx->n_keys; i++)
+		appendBinaryStringInfo(&buf, ctx->keys[i], strlen(ctx->keys[i]) + 1);
+	appendBinaryStringInfo(&buf, ctx->features.data, ctx->features.len);
+
+	SET_VARSIZE(buf.data, buf.len);
+	return (bytea *) buf.data;
+}
+
+/**
+ * Rebuild a partial aggregation from its serialized form, in the
+ * current memory context. It can be combined and finalized, but not
+ * given more rows.
+ */
+struct geobuf_agg_context *geobuf_agg_deserialize(const bytea *ba)
+{
+	struct geobuf_agg_context *ctx;
+	const char *p = VARDATA(ba);
+	const char *end = p + VARSIZE(ba) - VARHDRSZ;
+	uint32_t header[6];
+	uint32_t i;
+
+	ctx = (struct geobuf_agg_context *) palloc0(sizeof(*ctx));
+
+	memcpy(header, p, sizeof(header));
+	p += sizeof(header);
+	ctx->geom_index = header[0];
+	ctx->n_keys = header[1];
+	ctx->n_features = header[2];
+	ctx->e = header[3];
+	ctx->has_dimensions = header[4];
+	ctx->dimensions = header[5];
+	ctx->precision = MAX_PRECISION;
+
+	ctx->keys = (char **) palloc(Max(ctx->n_keys, 1) * sizeof(char *));
+	for (i = 0; i < ctx->n_keys; i++) {
+		size_t len = strlen(p) + 1;
+		ctx->keys[i] = (char *) palloc(len);
+		memcpy(ctx->keys[i], p, len);
+		p += len;
+	}
+
+	initStringInfo(&ctx->features);
+	appendBinaryStringInfo(&ctx->features, p, end - p);
+
+	return ctx;
+}
+
+/**
+ * Finalize aggregation.
+ *
+ * Write the Data message header in front of the encoded features and
+ * return it as a bytea.
+ */
+uint8_t *geobuf_agg_finalfn(struct geobuf_agg_context *ctx)
+{
+	StringInfoData header;
+	uint32_t i;
+	uint8_t *buf;
+	size_t len;
+
 	/* check and set precision if not default */
 	if (ctx->e > MAX_PRECISION)
 		ctx->e = MAX_PRECISION;
 	ctx->precision = ceil(log(ctx->e) / log(10));
-	if (ctx->precision != 6) {
-		data->has_precision = 1;
-		data->precision = ctx->precision;
-	}
 
-	for (i = 0; i < fc->n_features; i++)
-		fc->features[i]->geometry = encode_geometry(ctx, ctx->lwgeoms[i]);
+	initStringInfo(&header);
+	for (i = 0; i < ctx->n_keys; i++)
+		write_field(&header, DATA_KEYS, ctx->keys[i], strlen(ctx->keys[i]));
 
-	size_t len = data__get_packed_size(data);
-	uint8_t *buf = palloc(sizeof(*buf) * (len + VARHDRSZ));
-	data__pack(data, buf + VARHDRSZ);
+	/* check and set dimensions if not default */
+	if (ctx->has_dimensions && ctx->dimensions != 2) {
+		write_varint(&header, TAG(DATA_DIMENSIONS, WIRE_VARINT));
+		write_varint(&header, ctx->dimensions);
+	}
+	if (ctx->precision != 6) {
+		ctx->has_precision = 1;
+		write_varint(&header, TAG(DATA_PRECISION, WIRE_VARINT));
+		write_varint(&header, ctx->precision);
+	}
+	write_varint(&header, TAG(DATA_FEATURE_COLLECTION, WIRE_LEN));
+	write_varint(&header, ctx->features.len);
+
+	len = header.len + ctx->features.len;
+	buf = (uint8_t *) palloc(sizeof(*buf) * (len + VARHDRSZ));
+	memcpy(buf + VARHDRSZ, header.data, header.len);
+	memcpy(buf + VARHDRSZ + header.len, ctx->features.data,
+		ctx->features.len);
+	pfree(header.data);
 
 	SET_VARSIZE(buf, VARHDRSZ + len);
 
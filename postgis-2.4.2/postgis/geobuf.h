@@ -36,23 +36,46 @@
 
 #include "geobuf.pb-c.h"
 
+/*
+ * Features are encoded as they arrive, straight into the wire format of
+ * the FeatureCollection, so the state holds little more than the output.
+ *
+ * Coordinates are written at the precision needed so far. When a later
+ * feature needs more digits, what was written is scaled up by the power
+ * of ten that was missing (delta coding is linear, so that is exact).
+ */
 struct geobuf_agg_context {
 	char *geom_name;
 	uint32_t geom_index;
 	HeapTupleHeader row;
-	LWGEOM **lwgeoms;
-        Data *data;
-        Data__Feature *feature;
-	size_t features_capacity;
-        uint32_t e;
-        protobuf_c_boolean has_precision;
-        uint32_t precision;
-        protobuf_c_boolean has_dimensions;
-        uint32_t dimensions;
+	/* Property schema, set up from the first row */
+	char **keys;
+	uint32_t n_keys;
+	int natts;
+	Oid *typoids;
+	Oid *foutoids;
+	/* Encoded "features" fields of the FeatureCollection */
+	StringInfoData features;
+	uint32_t n_features;
+	/* Scratch buffers and memory for the row being encoded */
+	StringInfoData geom;
+	StringInfoData props;
+	StringInfoData lengths;
+	StringInfoData coords;
+	MemoryContext row_context;
+	uint32_t e;
+	protobuf_c_boolean has_precision;
+	uint32_t precision;
+	protobuf_c_boolean has_dimensions;
+	uint32_t dimensions;
 };
 
 void geobuf_agg_init_context(struct geobuf_agg_context *ctx);
 void geobuf_agg_transfn(struct geobuf_agg_context *ctx);
+void geobuf_agg_combine(struct geobuf_agg_context *ctx1,
+	struct geobuf_agg_context *ctx2);
+bytea *geobuf_agg_serialize(struct geobuf_agg_context *ctx);
+struct geobuf_agg_context *geobuf_agg_deserialize(const bytea *ba);
 uint8_t *geobuf_agg_finalfn(struct geobuf_agg_context *ctx);
 
 #endif  /* HAVE_LIBPROTOBUF */
@@ -31,6 +31,11 @@
 * for the CircTreeGeomCache here because we can't shove
 * the PgSQL specific bits of the code (fcinfo) back into
 * liblwgeom, where most of the circtree logic lives.
+*
+* Besides the tree for the repeated argument, the cache keeps
+* the tree of the last value seen in the other argument, so a
+* call repeating both arguments builds nothing at all. Trees are
+* kept flattened (CIRC_TREE) so they are cheap to walk and free.
 */
 typedef struct {
 	int                     type;       // <GeomCache>
@@ -39,7 +44,11 @@ typedef struct {
 	size_t                      geom1_size; //
 	size_t                      geom2_size; //
 	int32                       argnum;     // </GeomCache>
-	CIRC_NODE*                  index;
+	CIRC_TREE*                  index;
+	GSERIALIZED*                other_geom;
+	size_t                      other_size;
+	LWGEOM*                     other_lwgeom;
+	CIRC_TREE*                  other_index;
 } CircTreeGeomCache;
 
 
@@ -55,26 +64,43 @@ CircTreeBuilder(const LWGEOM* lwgeom, GeomCache* cache)
 
 	if ( circ_cache->index )
 	{
-		circ_tree_free(circ_cache->index);
+		circ_tree_flat_free(circ_cache->index);
 		circ_cache->index = 0;
 	}
 	if ( ! tree )
 		return LW_FAILURE;
 
-	circ_cache->index = tree;
+	circ_cache->index = circ_tree_flatten(tree);
+	circ_tree_free(tree);
 	return LW_SUCCESS;
 }
 
+static void
+CircTreeOtherFreer(CircTreeGeomCache* circ_cache)
+{
+	if ( circ_cache->other_index )
+		circ_tree_flat_free(circ_cache->other_index);
+	if ( circ_cache->other_lwgeom )
+		lwgeom_free(circ_cache->other_lwgeom);
+	if ( circ_cache->other_geom )
+		pfree(circ_cache->other_geom);
+	circ_cache->other_index = NULL;
+	circ_cache->other_lwgeom = NULL;
+	circ_cache->other_geom = NULL;
+	circ_cache->other_size = 0;
+}
+
 static int
 CircTreeFreer(GeomCache* cache)
 {
 	CircTreeGeomCache* circ_cache = (CircTreeGeomCache*)cache;
 	if ( circ_cache->index )
 	{
-		circ_tree_free(circ_cache->index);
+		circ_tree_flat_free(circ_cache->index);
 		circ_cache->index = 0;
 		circ_cache->argnum = 0;
 	}
+	CircTreeOtherFreer(circ_cache);
 	return LW_SUCCESS;
 }
 
@@ -100,6 +126,44 @@ GetCircTreeGeomCache(FunctionCallInfoData* fcinfo, const GSERIALIZED* g1, const
 	return (CircTreeGeomCache*)GetGeomCache(fcinfo, &CircTreeCacheMethods, g1, g2);
 }
 
+/**
+* Return the tree of the argument that is not indexed by the
+* cache proper, building and remembering it unless it is the
+* same value as on the previous call. The tree points into the
+* cached copy of the value, so both live in the function context.
+*/
+static CIRC_TREE*
+GetCircTreeOtherIndex(FunctionCallInfoData* fcinfo, CircTreeGeomCache* circ_cache, const GSERIALIZED* g)
+{
+	MemoryContext old_context;
+	CIRC_NODE* tree;
+
+	if ( circ_cache->other_index &&
+	     circ_cache->other_size == VARSIZE(g) &&
+	     memcmp(circ_cache->other_geom, g, circ_cache->other_size) == 0 )
+	{
+		POSTGIS_DEBUG(3, "reusing tree of the uncached argument");
+		return circ_cache->other_index;
+	}
+
+	CircTreeOtherFreer(circ_cache);
+
+	old_context = MemoryContextSwitchTo(fcinfo->flinfo->fn_mcxt);
+	circ_cache->other_size = VARSIZE(g);
+	circ_cache->other_geom = (GSERIALIZED*)palloc(circ_cache->other_size);
+	memcpy(circ_cache->other_geom, g, circ_cache->other_size);
+	circ_cache->other_lwgeom = lwgeom_from_gserialized(circ_cache->other_geom);
+	tree = lwgeom_calculate_circ_tree(circ_cache->other_lwgeom);
+	if ( tree )
+	{
+		circ_cache->other_index = circ_tree_flatten(tree);
+		circ_tree_free(tree);
+	}
+	MemoryContextSwitchTo(old_context);
+
+	return circ_cache->other_index;
+}
+
 
 static int
 CircTreePIP(const CIRC_NODE* tree1, const GSERIALIZED* g1, const POINT4D* in_point)
@@ -178,7 +242,8 @@ geography_distance_cache_tolerance(FunctionCallInfoData* fcinfo, const GSERIALIZ
 	/* fill in the other tree argument */
 	if ( tree_cache && tree_cache->argnum && tree_cache->index )
 	{
-		CIRC_NODE* circtree_cached = tree_cache->index;
+		CIRC_NODE* circtree_cached = tree_cache->index->nodes;
+		CIRC_TREE* circtree_other = NULL;
 		CIRC_NODE* circtree = NULL;
 		const GSERIALIZED* g_cached;
 		const GSERIALIZED* g;
@@ -187,7 +252,7 @@ geography_distance_cache_tolerance(FunctionCallInfoData* fcinfo, const GSERIALIZ
 		int geomtype;
 		POINT4D p4d;
 
-		/* We need to dynamically build a tree for the uncached side of the function call */
+		/* We need a tree for the uncached side of the function call too */
 		if ( tree_cache->argnum == 1 )
 		{
 			g_cached = g1;
@@ -208,19 +273,22 @@ geography_distance_cache_tolerance(FunctionCallInfoData* fcinfo, const GSERIALIZ
 			return LW_FAILURE;
 		}
 
-		lwgeom = lwgeom_from_gserialized(g);
+		circtree_other = GetCircTreeOtherIndex(fcinfo, tree_cache, g);
+		if ( ! circtree_other )
+			return LW_FAILURE;
+		circtree = circtree_other->nodes;
+		lwgeom = tree_cache->other_lwgeom;
+
 		if ( geomtype_cached == POLYGONTYPE || geomtype_cached == MULTIPOLYGONTYPE )
 		{
 			lwgeom_startpoint(lwgeom, &p4d);
 			if ( CircTreePIP(circtree_cached, g_cached, &p4d) )
 			{
 				*distance = 0.0;
-				lwgeom_free(lwgeom);
 				return LW_SUCCESS;
 			}
 		}
 
-		circtree = lwgeom_calculate_circ_tree(lwgeom);
 		if ( geomtype == POLYGONTYPE || geomtype == MULTIPOLYGONTYPE )
 		{
 			POINT2D p2d;
@@ -230,15 +298,11 @@ geography_distance_cache_tolerance(FunctionCallInfoData* fcinfo, const GSERIALIZ
 			if ( CircTreePIP(circtree, g, &p4d) )
 			{
 				*distance = 0.0;
-				circ_tree_free(circtree);
-				lwgeom_free(lwgeom);
 				return LW_SUCCESS;
 			}
 		}
 
 		*distance = circ_tree_distance_tree(circtree_cached, circtree, s, tolerance);
-		circ_tree_free(circtree);
-		lwgeom_free(lwgeom);
 		return LW_SUCCESS;
 	}
 	else
@@ -54,6 +54,19 @@ The 2D mode is put in effect by retrieving the 2D histogram from the
 statistics cache and then allowing the generic ND calculations to
 go to work.
 
+Next to each fixed-grid histogram ANALYZE also stores an adaptive
+one (ND_KD_STATS): the sample is split at the median feature center
+along its most spread-out axis until partitions hold few features,
+and each leaf keeps the bounds of its feature centers and the average
+feature width. A box of width w overlaps a search box [qmin, qmax]
+when its center lies in [qmin - w/2, qmax + w/2], so selectivity is
+a sum of per-leaf interval overlaps, and a join sums, over pairs of
+leaves, the probability that two centers are within half the summed
+widths of each other. Clustered data gets resolution where it needs
+it, and the leaf count is capped to keep ANALYZE and join estimation
+cheap. The estimators use the adaptive histogram when present and
+fall back to the grid for tables analyzed by older versions.
+
 TO DO: More testing and examination of the &&& operator and mixed
 dimensionality cases. (2D geometry) &&& (3D column), etc.
 
@@ -123,6 +136,10 @@ extern "C" Datum geometry_estimated_extent(PG_FUNCTION_ARGS);
 #define STATISTIC_KIND_2D 103
 #define STATISTIC_SLOT_ND 0
 #define STATISTIC_SLOT_2D 1
+#define STATISTIC_KIND_ND_KD 104
+#define STATISTIC_KIND_2D_KD 105
+#define STATISTIC_SLOT_ND_KD 2
+#define STATISTIC_SLOT_2D_KD 3
 
 /*
 * The SD factor restricts the side of the statistics histogram
@@ -159,6 +176,17 @@ extern "C" Datum geometry_estimated_extent(PG_FUNCTION_ARGS);
 #define FALLBACK_ND_SEL 0.2
 #define FALLBACK_ND_JOINSEL 0.3
 
+/**
+* The adaptive (kd-tree) histogram stops splitting a partition
+* once it holds ND_KD_MIN_FEATURES sample features or less, and
+* aims for no more than ND_KD_MAX_CELLS partitions, so that the
+* pairwise join estimate stays cheap. ND_KD_MAX_DEPTH bounds the
+* recursion on heavily duplicated samples.
+*/
+#define ND_KD_MIN_FEATURES 10
+#define ND_KD_MAX_CELLS 512
+#define ND_KD_MAX_DEPTH 32
+
 /**
 * N-dimensional box type for calculations, to avoid doing
 * explicit axis conversions from GBOX in all calculations
@@ -222,6 +250,54 @@ typedef struct ND_STATS_T
 } ND_STATS;
 
 
+/**
+* One leaf of the adaptive histogram. Rather than pro-rating
+* feature boxes over fixed cells, each leaf remembers where the
+* centers of its features lie and how big they are on average.
+*/
+typedef struct ND_KD_CELL_T
+{
+	/* Bounds of the feature box centers in this leaf. */
+	ND_BOX centers;
+
+	/* Average feature box width in each dimension. */
+	float4 width[ND_DIMS];
+
+	/* How many sample features fell in this leaf? */
+	float4 count;
+} ND_KD_CELL;
+
+/**
+* Adaptive N-dimensional statistics. The sample is split
+* recursively at the median of the feature centers along
+* the widest axis, so dense areas get small leaves and empty
+* areas cost nothing. Stored, like ND_STATS, as float4 numbers.
+*/
+typedef struct ND_KD_STATS_T
+{
+	/* Dimensionality of the partitioning. */
+	float4 ndims;
+
+	/* How many leaves follow the header? */
+	float4 ncells;
+
+	/* How many rows in the table itself? */
+	float4 table_features;
+
+	/* How many rows were in the sample that built these stats? */
+	float4 sample_features;
+
+	/* How many not-Null/Empty features were in the sample? */
+	float4 not_null_features;
+
+	/* Spatial bounds of the not-Null/Empty sample features. */
+	ND_BOX extent;
+
+	/* Variable length # of leaves */
+	ND_KD_CELL cell[1];
+} ND_KD_STATS;
+
+
 
 
 /**
@@ -814,17 +890,15 @@ nd_increment(ND_IBOX *ibox, int ndims, int *counter)
 	return TRUE;
 }
 
-static ND_STATS*
-pg_nd_stats_from_tuple(HeapTuple stats_tuple, int mode)
+/**
+* Copy the numbers of the statistics slot of the given kind
+* out of a pg_statistic tuple, or return NULL if there is none.
+*/
+static float4*
+pg_stats_numbers_from_tuple(HeapTuple stats_tuple, int stats_kind)
 {
-	int stats_kind = STATISTIC_KIND_ND;
 	int rv;
-	ND_STATS *nd_stats;
-
-	/* If we're in 2D mode, set the kind appropriately */
-	if ( mode == 2 ) stats_kind = STATISTIC_KIND_2D;
-
-    /* Then read the geom status histogram from that */
+	float4 *numbers;
 
 #if POSTGIS_PGSQL_VERSION < 100
 	float4 *floatptr;
@@ -840,8 +914,8 @@ pg_nd_stats_from_tuple(HeapTuple stats_tuple, int mode)
 	}
 
 	/* Clone the stats here so we can release the attstatsslot immediately */
-	nd_stats = palloc(sizeof(float) * nvalues);
-	memcpy(nd_stats, floatptr, sizeof(float) * nvalues);
+	numbers = (float4*)palloc(sizeof(float) * nvalues);
+	memcpy(numbers, floatptr, sizeof(float) * nvalues);
 
 	/* Clean up */
 	free_attstatsslot(0, NULL, 0, floatptr, nvalues);
@@ -856,24 +930,39 @@ pg_nd_stats_from_tuple(HeapTuple stats_tuple, int mode)
 	}
 
 	/* Clone the stats here so we can release the attstatsslot immediately */
-	nd_stats = palloc(sizeof(float4) * sslot.nnumbers);
-	memcpy(nd_stats, sslot.numbers, sizeof(float4) * sslot.nnumbers);
+	numbers = (float4*)palloc(sizeof(float4) * sslot.nnumbers);
+	memcpy(numbers, sslot.numbers, sizeof(float4) * sslot.nnumbers);
 
 	free_attstatsslot(&sslot);
 #endif
 
-    return nd_stats;
+	return numbers;
+}
+
+static ND_STATS*
+pg_nd_stats_from_tuple(HeapTuple stats_tuple, int mode)
+{
+	/* If we're in 2D mode, read the 2D histogram */
+	int stats_kind = ( mode == 2 ) ? STATISTIC_KIND_2D : STATISTIC_KIND_ND;
+	return (ND_STATS*)pg_stats_numbers_from_tuple(stats_tuple, stats_kind);
+}
+
+static ND_KD_STATS*
+pg_nd_kd_stats_from_tuple(HeapTuple stats_tuple, int mode)
+{
+	/* If we're in 2D mode, read the 2D partitioning */
+	int stats_kind = ( mode == 2 ) ? STATISTIC_KIND_2D_KD : STATISTIC_KIND_ND_KD;
+	return (ND_KD_STATS*)pg_stats_numbers_from_tuple(stats_tuple, stats_kind);
 }
 
 /**
-* Pull the stats object from the PgSQL system catalogs. Used
-* by the selectivity functions and the debugging functions.
+* Look up the pg_statistic tuple for a table column. The caller
+* has to ReleaseSysCache() any tuple returned.
 */
-static ND_STATS*
-pg_get_nd_stats(const Oid table_oid, AttrNumber att_num, int mode, bool only_parent)
+static HeapTuple
+pg_get_stats_tuple(const Oid table_oid, AttrNumber att_num, bool only_parent)
 {
 	HeapTuple stats_tuple = NULL;
-	ND_STATS *nd_stats;
 	//return NULL;
 	/* First pull the stats tuple for the whole tree */
 	if ( ! only_parent )
@@ -897,9 +986,25 @@ pg_get_nd_stats(const Oid table_oid, AttrNumber att_num, int mode, bool only_par
 	if ( ! stats_tuple )
 	{
 		POSTGIS_DEBUGF(2, "stats for \"%s\" do not exist", get_rel_name(table_oid)? get_rel_name(table_oid) : "NULL");
-		return NULL;
 	}
 
+	return stats_tuple;
+}
+
+/**
+* Pull the stats object from the PgSQL system catalogs. Used
+* by the selectivity functions and the debugging functions.
+*/
+static ND_STATS*
+pg_get_nd_stats(const Oid table_oid, AttrNumber att_num, int mode, bool only_parent)
+{
+	HeapTuple stats_tuple;
+	ND_STATS *nd_stats;
+
+	stats_tuple = pg_get_stats_tuple(table_oid, att_num, only_parent);
+	if ( ! stats_tuple )
+		return NULL;
+
 	nd_stats = pg_nd_stats_from_tuple(stats_tuple, mode);
 	ReleaseSysCache(stats_tuple);
 	if ( ! nd_stats )
@@ -913,15 +1018,31 @@ pg_get_nd_stats(const Oid table_oid, AttrNumber att_num, int mode, bool only_par
 }
 
 /**
-* Pull the stats object from the PgSQL system catalogs. The
-* debugging functions are taking human input (table names)
+* Pull the adaptive stats object from the PgSQL system catalogs.
+* Tables analyzed by older versions only have the histogram, so
+* callers must be ready to fall back to pg_get_nd_stats.
+*/
+static ND_KD_STATS*
+pg_get_nd_kd_stats(const Oid table_oid, AttrNumber att_num, int mode, bool only_parent)
+{
+	HeapTuple stats_tuple;
+	ND_KD_STATS *kd_stats;
+
+	stats_tuple = pg_get_stats_tuple(table_oid, att_num, only_parent);
+	if ( ! stats_tuple )
+		return NULL;
+
+	kd_stats = pg_nd_kd_stats_from_tuple(stats_tuple, mode);
+	ReleaseSysCache(stats_tuple);
+	return kd_stats;
+}
+
+/**
+* The debugging functions are taking human input (table names)
 * and columns, so we have to look those up first.
-* In case of parent tables whith INHERITS, when "only_parent"
-* is TRUE this function only searchs for stats in the parent
-* table ignoring any statistic collected from the children.
 */
-static ND_STATS*
-pg_get_nd_stats_by_name(const Oid table_oid, const text *att_text, int mode, bool only_parent)
+static AttrNumber
+pg_get_attnum_by_name(const Oid table_oid, const text *att_text)
 {
 	const char *att_name = text2cstring(att_text);
 	AttrNumber att_num;
@@ -933,18 +1054,448 @@ pg_get_nd_stats_by_name(const Oid table_oid, const text *att_text, int mode, boo
 		att_num = get_attnum(table_oid, att_name);
 		if  ( ! att_num ) {
 			elog(ERROR, "attribute \"%s\" does not exist", att_name);
-			return NULL;
+			return InvalidAttrNumber;
 		}
 	}
 	else
 	{
 		elog(ERROR, "attribute name is null");
-		return NULL;
+		return InvalidAttrNumber;
 	}
 
+	return att_num;
+}
+
+/**
+* Pull the stats object from the PgSQL system catalogs by
+* column name.
+* In case of parent tables whith INHERITS, when "only_parent"
+* is TRUE this function only searchs for stats in the parent
+* table ignoring any statistic collected from the children.
+*/
+static ND_STATS*
+pg_get_nd_stats_by_name(const Oid table_oid, const text *att_text, int mode, bool only_parent)
+{
+	AttrNumber att_num = pg_get_attnum_by_name(table_oid, att_text);
 	return pg_get_nd_stats(table_oid, att_num, mode, only_parent);
 }
 
+static ND_KD_STATS*
+pg_get_nd_kd_stats_by_name(const Oid table_oid, const text *att_text, int mode, bool only_parent)
+{
+	AttrNumber att_num = pg_get_attnum_by_name(table_oid, att_text);
+	return pg_get_nd_kd_stats(table_oid, att_num, mode, only_parent);
+}
+
+/**
+* Working state of the adaptive histogram build.
+*/
+typedef struct ND_KD_ITEM_T
+{
+	const ND_BOX *box;
+	double key;
+} ND_KD_ITEM;
+
+typedef struct ND_KD_BUILD_T
+{
+	int ndims;
+	int leaf_features;
+	const ND_BOX *extent;
+	ND_KD_CELL *cells;
+	int ncells;
+	int maxcells;
+} ND_KD_BUILD;
+
+static int
+cmp_nd_kd_item(const void *a, const void *b)
+{
+	double ka = ((const ND_KD_ITEM*)a)->key;
+	double kb = ((const ND_KD_ITEM*)b)->key;
+	return (ka > kb) - (ka < kb);
+}
+
+/**
+* Summarize a partition of the sample into one leaf.
+*/
+static void
+nd_kd_add_leaf(ND_KD_BUILD *build, const ND_KD_ITEM *items, int nitems)
+{
+	ND_KD_CELL *cell;
+	double width[ND_DIMS];
+	int d, i;
+
+	if ( build->ncells == build->maxcells )
+	{
+		build->maxcells *= 2;
+		build->cells = (ND_KD_CELL*)repalloc(build->cells, sizeof(ND_KD_CELL) * build->maxcells);
+	}
+	cell = &(build->cells[build->ncells++]);
+	memset(cell, 0, sizeof(ND_KD_CELL));
+	nd_box_init_bounds(&(cell->centers));
+
+	for ( d = 0; d < build->ndims; d++ )
+		width[d] = 0.0;
+
+	for ( i = 0; i < nitems; i++ )
+	{
+		const ND_BOX *box = items[i].box;
+		for ( d = 0; d < build->ndims; d++ )
+		{
+			float4 center = (box->min[d] + box->max[d]) / 2.0;
+			cell->centers.min[d] = Min(cell->centers.min[d], center);
+			cell->centers.max[d] = Max(cell->centers.max[d], center);
+			width[d] += box->max[d] - box->min[d];
+		}
+	}
+
+	for ( d = 0; d < build->ndims; d++ )
+		cell->width[d] = width[d] / nitems;
+
+	cell->count = nitems;
+}
+
+/**
+* Recursively split a partition of the sample at the median
+* feature center of the axis along which the centers are most
+* spread out (relative to the sample extent), until partitions
+* are small enough to be leaves. Runs of equal centers are never
+* split, so duplicated features land in a single leaf.
+*/
+static void
+nd_kd_build(ND_KD_BUILD *build, ND_KD_ITEM *items, int nitems, int depth)
+{
+	double spread_max = 0.0;
+	int split_dim = -1;
+	int d, i, lo, hi, mid;
+
+	/* Give backend a chance of interrupting us */
+	vacuum_delay_point();
+
+	if ( nitems > build->leaf_features && depth < ND_KD_MAX_DEPTH )
+	{
+		for ( d = 0; d < build->ndims; d++ )
+		{
+			double cmin = FLT_MAX, cmax = -1 * FLT_MAX;
+			double width = build->extent->max[d] - build->extent->min[d];
+			double spread;
+
+			if ( width < MIN_DIMENSION_WIDTH )
+				continue;
+
+			for ( i = 0; i < nitems; i++ )
+			{
+				double center = (items[i].box->min[d] + items[i].box->max[d]) / 2.0;
+				cmin = Min(cmin, center);
+				cmax = Max(cmax, center);
+			}
+
+			spread = (cmax - cmin) / width;
+			if ( spread > spread_max )
+			{
+				spread_max = spread;
+				split_dim = d;
+			}
+		}
+	}
+
+	/* Small enough, or nothing left to split on */
+	if ( split_dim < 0 )
+	{
+		nd_kd_add_leaf(build, items, nitems);
+		return;
+	}
+
+	for ( i = 0; i < nitems; i++ )
+		items[i].key = (items[i].box->min[split_dim] + items[i].box->max[split_dim]) / 2.0;
+	qsort(items, nitems, sizeof(ND_KD_ITEM), cmp_nd_kd_item);
+
+	/* Find the run of keys equal to the median... */
+	mid = nitems / 2;
+	lo = hi = mid;
+	while ( lo > 0 && items[lo-1].key == items[mid].key )
+		lo--;
+	while ( hi < nitems && items[hi].key == items[mid].key )
+		hi++;
+
+	/* ...and split at whichever end of it is nearer the median */
+	if ( lo == 0 )
+		mid = hi;
+	else if ( hi == nitems )
+		mid = lo;
+	else
+		mid = ( mid - lo <= hi - mid ) ? lo : hi;
+
+	nd_kd_build(build, items, mid, depth + 1);
+	nd_kd_build(build, items + mid, nitems - mid, depth + 1);
+}
+
+/**
+* Build the adaptive statistics object for a set of sample
+* boxes. The result is allocated in stats_context, the
+* working memory in the current context.
+*/
+static ND_KD_STATS*
+nd_kd_stats_build(const ND_BOX **sample_boxes, int nboxes, int ndims,
+                  const ND_BOX *extent, int cells_target,
+                  double sample_rows, double total_rows,
+                  MemoryContext stats_context, size_t *kd_stats_size)
+{
+	ND_KD_BUILD build;
+	ND_KD_ITEM *items;
+	ND_KD_STATS *kd_stats;
+	MemoryContext old_context;
+	int i;
+
+	cells_target = Max(1, Min(cells_target, ND_KD_MAX_CELLS));
+
+	build.ndims = ndims;
+	build.leaf_features = Max(ND_KD_MIN_FEATURES, (int)ceil((double)nboxes / cells_target));
+	build.extent = extent;
+	build.ncells = 0;
+	build.maxcells = Max(16, 2 * nboxes / build.leaf_features);
+	build.cells = (ND_KD_CELL*)palloc(sizeof(ND_KD_CELL) * build.maxcells);
+
+	items = (ND_KD_ITEM*)palloc(sizeof(ND_KD_ITEM) * nboxes);
+	for ( i = 0; i < nboxes; i++ )
+	{
+		items[i].box = sample_boxes[i];
+		items[i].key = 0.0;
+	}
+
+	nd_kd_build(&build, items, nboxes, 0);
+	pfree(items);
+
+	POSTGIS_DEBUGF(3, " adaptive histogram: %d leaves of up to %d features", build.ncells, build.leaf_features);
+
+	*kd_stats_size = offsetof(ND_KD_STATS, cell) + sizeof(ND_KD_CELL) * build.ncells;
+	old_context = MemoryContextSwitchTo(stats_context);
+	kd_stats = (ND_KD_STATS*)palloc0(*kd_stats_size);
+	MemoryContextSwitchTo(old_context);
+
+	kd_stats->ndims = ndims;
+	kd_stats->ncells = build.ncells;
+	kd_stats->table_features = total_rows;
+	kd_stats->sample_features = sample_rows;
+	kd_stats->not_null_features = nboxes;
+	kd_stats->extent = *extent;
+	memcpy(kd_stats->cell, build.cells, sizeof(ND_KD_CELL) * build.ncells);
+	pfree(build.cells);
+
+	return kd_stats;
+}
+
+/**
+* What fraction of the features of a leaf interact with the
+* search box? A feature of average width w centered at c overlaps
+* [qmin, qmax] when c lies in [qmin - w/2, qmax + w/2], and the
+* centers are taken to be spread evenly over the leaf.
+*/
+static double
+nd_kd_cell_fraction(const ND_KD_CELL *cell, const ND_BOX *box, int ndims)
+{
+	double fraction = 1.0;
+	int d;
+
+	for ( d = 0; d < ndims; d++ )
+	{
+		double qmin = box->min[d] - cell->width[d] / 2.0;
+		double qmax = box->max[d] + cell->width[d] / 2.0;
+		double cmin = cell->centers.min[d];
+		double cmax = cell->centers.max[d];
+
+		if ( cmax < qmin || cmin > qmax )
+			return 0.0;
+
+		/* All centers at one coordinate: they are all in or all out */
+		if ( cmax - cmin <= 0.0 )
+			continue;
+
+		fraction *= (Min(qmax, cmax) - Max(qmin, cmin)) / (cmax - cmin);
+	}
+	return fraction;
+}
+
+/**
+* Share of [a, b] (of length len > 0) within reach h of x.
+*/
+static inline double
+nd_kd_reach(double x, double a, double b, double len, double h)
+{
+	return Max(0.0, Min(x + h, b) - Max(x - h, a)) / len;
+}
+
+/**
+* Probability that two values, uniformly distributed over
+* [a1, b1] and [a2, b2], lie within h of each other.
+*/
+static double
+nd_kd_interval_prob(double a1, double b1, double a2, double b2, double h)
+{
+	double len1 = b1 - a1;
+	double len2 = b2 - a2;
+	double x[6], p = 0.0;
+	int n = 0, i, j;
+
+	if ( b1 + h < a2 || b2 + h < a1 )
+		return 0.0;
+
+	/* Integrate over the longer interval */
+	if ( len2 > len1 )
+	{
+		double tmp;
+		tmp = a1; a1 = a2; a2 = tmp;
+		tmp = b1; b1 = b2; b2 = tmp;
+		tmp = len1; len1 = len2; len2 = tmp;
+	}
+
+	/* Two points */
+	if ( len1 <= 0.0 )
+		return 1.0;
+
+	/* A point against an interval */
+	if ( len2 <= 0.0 )
+		return nd_kd_reach(a2, a1, b1, len1, h);
+
+	/*
+	 * The reach of a point of the first interval into the second
+	 * is piecewise linear with breaks at a2-h, a2+h, b2-h and b2+h,
+	 * so the trapezoid rule over those breaks is exact.
+	 */
+	x[n++] = a1;
+	if ( a2 - h > a1 && a2 - h < b1 ) x[n++] = a2 - h;
+	if ( a2 + h > a1 && a2 + h < b1 ) x[n++] = a2 + h;
+	if ( b2 - h > a1 && b2 - h < b1 ) x[n++] = b2 - h;
+	if ( b2 + h > a1 && b2 + h < b1 ) x[n++] = b2 + h;
+	x[n++] = b1;
+
+	/* Insertion sort the handful of breaks */
+	for ( i = 1; i < n; i++ )
+	{
+		double v = x[i];
+		for ( j = i; j > 0 && x[j-1] > v; j-- )
+			x[j] = x[j-1];
+		x[j] = v;
+	}
+
+	for ( i = 0; i < n - 1; i++ )
+	{
+		double q0 = nd_kd_reach(x[i], a2, b2, len2, h);
+		double q1 = nd_kd_reach(x[i+1], a2, b2, len2, h);
+		p += (q0 + q1) / 2.0 * (x[i+1] - x[i]);
+	}
+
+	return p / len1;
+}
+
+/**
+* Selectivity of a search box against the adaptive histogram:
+* the expected number of sample features interacting with the box
+* divided by the number of rows sampled.
+*/
+static float8
+estimate_selectivity_kd(const GBOX *box, const ND_KD_STATS *kd_stats, int mode)
+{
+	ND_BOX nd_box;
+	int ndims, ncells, i;
+	double total_count = 0.0;
+	float8 selectivity;
+
+	nd_box_from_gbox(box, &nd_box);
+
+	/* Only compare the dimensions both sides have */
+	ndims = Min((int)roundf(kd_stats->ndims), gbox_ndims(box));
+	if ( mode == 2 )
+		ndims = 2;
+
+	if ( ! nd_box_intersects(&nd_box, &(kd_stats->extent), ndims) )
+	{
+		POSTGIS_DEBUG(3, " search box does not overlap sample, returning 0");
+		return 0.0;
+	}
+
+	if ( nd_box_contains(&nd_box, &(kd_stats->extent), ndims) )
+	{
+		POSTGIS_DEBUG(3, " search box contains sample, returning not-null fraction");
+		return kd_stats->not_null_features / kd_stats->sample_features;
+	}
+
+	ncells = (int)roundf(kd_stats->ncells);
+	for ( i = 0; i < ncells; i++ )
+	{
+		const ND_KD_CELL *cell = &(kd_stats->cell[i]);
+		total_count += cell->count * nd_kd_cell_fraction(cell, &nd_box, ndims);
+	}
+
+	selectivity = total_count / kd_stats->sample_features;
+	POSTGIS_DEBUGF(3, " adaptive sum = %f, selectivity = %f", total_count, selectivity);
+
+	/* Prevent rounding overflows */
+	if (selectivity > 1.0) selectivity = 1.0;
+	else if (selectivity < 0.0) selectivity = 0.0;
+
+	return selectivity;
+}
+
+/**
+* Join selectivity from two adaptive histograms. For each pair
+* of leaves, two features interact when their centers are closer
+* than half the sum of their widths in every dimension; we sum
+* the expected number of interacting sample pairs and divide by
+* the number of sampled row pairs.
+*/
+static float8
+estimate_join_selectivity_kd(const ND_KD_STATS *s1, const ND_KD_STATS *s2)
+{
+	int ndims, ncells1, ncells2, i, j, d;
+	double val = 0.0;
+	float8 selectivity;
+
+	ndims = Min((int)roundf(s1->ndims), (int)roundf(s2->ndims));
+	ncells1 = (int)roundf(s1->ncells);
+	ncells2 = (int)roundf(s2->ncells);
+
+	/* If relation stats do not intersect, join is very very selective. */
+	if ( ! nd_box_intersects(&(s1->extent), &(s2->extent), ndims) )
+	{
+		POSTGIS_DEBUG(3, "relation stats do not intersect, returning 0");
+		return 0.0;
+	}
+
+	for ( i = 0; i < ncells1; i++ )
+	{
+		const ND_KD_CELL *c1 = &(s1->cell[i]);
+		for ( j = 0; j < ncells2; j++ )
+		{
+			const ND_KD_CELL *c2 = &(s2->cell[j]);
+			double p = c1->count * c2->count;
+
+			for ( d = 0; d < ndims && p > 0.0; d++ )
+			{
+				p *= nd_kd_interval_prob(
+				       c1->centers.min[d], c1->centers.max[d],
+				       c2->centers.min[d], c2->centers.max[d],
+				       (c1->width[d] + c2->width[d]) / 2.0);
+			}
+			val += p;
+		}
+	}
+
+	selectivity = val / (s1->sample_features * s2->sample_features);
+	POSTGIS_DEBUGF(3, "adaptive join pairs = %g, selectivity = %g", val, selectivity);
+
+	/* Guard against over-estimates and crazy numbers :) */
+	if ( isnan(selectivity) || ! isfinite(selectivity) || selectivity < 0.0 )
+	{
+		selectivity = DEFAULT_ND_JOINSEL;
+	}
+	else if ( selectivity > 1.0 )
+	{
+		selectivity = 1.0;
+	}
+
+	return selectivity;
+}
+
 /**
 * Given two statistics histograms, what is the selectivity
 * of a join driven by the && or &&& operator?
@@ -1211,6 +1762,7 @@ Datum gserialized_gist_joinsel(PG_FUNCTION_ARGS)
 	Oid relid1, relid2;
 
 	ND_STATS *stats1, *stats2;
+	ND_KD_STATS *kd_stats1, *kd_stats2;
 	float8 selectivity;
 
 	/* Only respond to an inner join/unknown context join */
@@ -1241,6 +1793,19 @@ Datum gserialized_gist_joinsel(PG_FUNCTION_ARGS)
 	POSTGIS_DEBUGF(3, "using relations \"%s\" Oid(%d), \"%s\" Oid(%d)",
 	                 get_rel_name(relid1) ? get_rel_name(relid1) : "NULL", relid1, get_rel_name(relid2) ? get_rel_name(relid2) : "NULL", relid2);
 
+	/* Prefer the adaptive histograms when both sides have one */
+	kd_stats1 = pg_get_nd_kd_stats(relid1, var1->varattno, mode, FALSE);
+	kd_stats2 = kd_stats1 ? pg_get_nd_kd_stats(relid2, var2->varattno, mode, FALSE) : NULL;
+	if ( kd_stats1 && kd_stats2 )
+	{
+		selectivity = estimate_join_selectivity_kd(kd_stats1, kd_stats2);
+		POSTGIS_DEBUGF(2, "got selectivity %g", selectivity);
+		pfree(kd_stats1);
+		pfree(kd_stats2);
+		PG_RETURN_FLOAT8(selectivity);
+	}
+	if ( kd_stats1 ) pfree(kd_stats1);
+
 	/* Pull the stats from the stats system. */
 	stats1 = pg_get_nd_stats(relid1, var1->varattno, mode, FALSE);
 	stats2 = pg_get_nd_stats(relid2, var2->varattno, mode, FALSE);
@@ -1298,6 +1863,8 @@ compute_gserialized_stats_mode(VacAttrStats *stats, AnalyzeAttrFetchFunc fetchfu
 
 	ND_STATS *nd_stats;                /* Our histogram */
 	size_t    nd_stats_size;           /* Size to allocate */
+	ND_KD_STATS *kd_stats;             /* Our adaptive histogram */
+	size_t    kd_stats_size;           /* Size allocated */
 
 	double total_width = 0;            /* # of bytes used by sample */
 	double total_sample_volume = 0;    /* Area/volume coverage of the sample */
@@ -1323,6 +1890,8 @@ compute_gserialized_stats_mode(VacAttrStats *stats, AnalyzeAttrFetchFunc fetchfu
 
 	int stats_slot;                     /* What slot is this data going into? (2D vs ND) */
 	int stats_kind;                     /* And this is what? (2D vs ND) */
+	int kd_stats_slot;                  /* Same for the adaptive histogram */
+	int kd_stats_kind;
 
 	/* Initialize sum and stddev */
 	nd_box_init(&sum);
@@ -1458,6 +2027,16 @@ compute_gserialized_stats_mode(VacAttrStats *stats, AnalyzeAttrFetchFunc fetchfu
 		return;
 	}
 
+	/*
+	 * Build the adaptive histogram from the full sample, before the
+	 * hard deviants get dropped below: its partitions follow the
+	 * data, so outliers cost a leaf rather than stretching cells.
+	 */
+	kd_stats = nd_kd_stats_build(sample_boxes, notnull_cnt, ndims,
+	                             &sample_extent, histo_cells_target,
+	                             sample_rows, total_rows,
+	                             stats->anl_context, &kd_stats_size);
+
 	POSTGIS_DEBUGF(3, " sample_extent: %s", nd_box_to_json(&sample_extent, ndims));
 
 	/*
@@ -1729,11 +2308,15 @@ compute_gserialized_stats_mode(VacAttrStats *stats, AnalyzeAttrFetchFunc fetchfu
 	{
 		stats_slot = STATISTIC_SLOT_2D;
 		stats_kind = STATISTIC_KIND_2D;
+		kd_stats_slot = STATISTIC_SLOT_2D_KD;
+		kd_stats_kind = STATISTIC_KIND_2D_KD;
 	}
 	else
 	{
 		stats_slot = STATISTIC_SLOT_ND;
 		stats_kind = STATISTIC_KIND_ND;
+		kd_stats_slot = STATISTIC_SLOT_ND_KD;
+		kd_stats_kind = STATISTIC_KIND_ND_KD;
 	}
 
 	/* Write the statistics data */
@@ -1741,6 +2324,10 @@ compute_gserialized_stats_mode(VacAttrStats *stats, AnalyzeAttrFetchFunc fetchfu
 	stats->staop[stats_slot] = InvalidOid;
 	stats->stanumbers[stats_slot] = (float4*)nd_stats;
 	stats->numnumbers[stats_slot] = nd_stats_size/sizeof(float4);
+	stats->stakind[kd_stats_slot] = kd_stats_kind;
+	stats->staop[kd_stats_slot] = InvalidOid;
+	stats->stanumbers[kd_stats_slot] = (float4*)kd_stats;
+	stats->numnumbers[kd_stats_slot] = kd_stats_size/sizeof(float4);
 	stats->stanullfrac = (float4)null_cnt/sample_rows;
 	stats->stawidth = total_width/notnull_cnt;
 	stats->stadistinct = -1.0;
@@ -2022,6 +2609,7 @@ Datum _postgis_gserialized_sel(PG_FUNCTION_ARGS)
 	GBOX gbox; /* search box read from gserialized datum */
 	float8 selectivity = 0;
 	ND_STATS *nd_stats;
+	ND_KD_STATS *kd_stats;
 	int mode = 2; /* 2D mode by default */
 
 	/* Check if we've been asked to not use 2d mode */
@@ -2040,8 +2628,17 @@ Datum _postgis_gserialized_sel(PG_FUNCTION_ARGS)
 
 	POSTGIS_DEBUGF(3, " %s", gbox_to_string(&gbox));
 
-	/* Do the estimation */
-	selectivity = estimate_selectivity(&gbox, nd_stats, mode);
+	/* Do the estimation, the same way the planner would */
+	kd_stats = pg_get_nd_kd_stats_by_name(table_oid, att_text, mode, FALSE);
+	if ( kd_stats )
+	{
+		selectivity = estimate_selectivity_kd(&gbox, kd_stats, mode);
+		pfree(kd_stats);
+	}
+	else
+	{
+		selectivity = estimate_selectivity(&gbox, nd_stats, mode);
+	}
 
 	pfree(nd_stats);
 	PG_RETURN_FLOAT8(selectivity);
@@ -2060,6 +2657,7 @@ Datum _postgis_gserialized_joinsel(PG_FUNCTION_ARGS)
 	Oid table_oid2 = PG_GETARG_OID(2);
 	text *att_text2 = PG_GETARG_TEXT_P(3);
 	ND_STATS *nd_stats1, *nd_stats2;
+	ND_KD_STATS *kd_stats1, *kd_stats2;
 	float8 selectivity = 0;
 	int mode = 2; /* 2D mode by default */
 
@@ -2083,8 +2681,16 @@ Datum _postgis_gserialized_joinsel(PG_FUNCTION_ARGS)
 			mode = 0;
 	}
 
-	/* Do the estimation */
-	selectivity = estimate_join_selectivity(nd_stats1, nd_stats2);
+	/* Do the estimation, the same way the planner would */
+	kd_stats1 = pg_get_nd_kd_stats_by_name(table_oid1, att_text1, mode, FALSE);
+	kd_stats2 = pg_get_nd_kd_stats_by_name(table_oid2, att_text2, mode, FALSE);
+	if ( kd_stats1 && kd_stats2 )
+		selectivity = estimate_join_selectivity_kd(kd_stats1, kd_stats2);
+	else
+		selectivity = estimate_join_selectivity(nd_stats1, nd_stats2);
+
+	if ( kd_stats1 ) pfree(kd_stats1);
+	if ( kd_stats2 ) pfree(kd_stats2);
 
 	pfree(nd_stats1);
 	pfree(nd_stats2);
@@ -2145,6 +2751,7 @@ Datum gserialized_gist_sel(PG_FUNCTION_ARGS)
 
 	VariableStatData vardata;
 	ND_STATS *nd_stats = NULL;
+	ND_KD_STATS *kd_stats = NULL;
 
 	Node *other;
 	Var *self;
@@ -2198,10 +2805,21 @@ Datum gserialized_gist_sel(PG_FUNCTION_ARGS)
 	/* Get pg_statistic row */
 	examine_variable(root, (Node*)self, 0, &vardata);
 	if ( vardata.statsTuple ) {
-		nd_stats = pg_nd_stats_from_tuple(vardata.statsTuple, mode);
+		kd_stats = pg_nd_kd_stats_from_tuple(vardata.statsTuple, mode);
+		if ( ! kd_stats )
+			nd_stats = pg_nd_stats_from_tuple(vardata.statsTuple, mode);
 	}
 	ReleaseVariableStats(vardata);
 
+	/* Prefer the adaptive histogram when ANALYZE built one */
+	if ( kd_stats )
+	{
+		selectivity = estimate_selectivity_kd(&search_box, kd_stats, mode);
+		POSTGIS_DEBUGF(3, " returning computed value: %f", selectivity);
+		pfree(kd_stats);
+		PG_RETURN_FLOAT8(selectivity);
+	}
+
 	if ( ! nd_stats )
 	{
 		POSTGIS_DEBUG(3, " unable to load stats from syscache, not analyzed yet?");
@@ -57,6 +57,10 @@
 
 #include <float.h> /* For FLT_MAX */
 
+#if POSTGIS_PGSQL_VERSION >= 140
+#include "utils/sortsupport.h" /* For SortSupport */
+#endif
+
 /*
 ** When is a node split not so good? If more than 90% of the entries
 ** end up in one of the children.
@@ -94,6 +98,9 @@ extern "C" Datum gserialized_gist_picksplit_2d(PG_FUNCTION_ARGS);
 extern "C" Datum gserialized_gist_union_2d(PG_FUNCTION_ARGS);
 extern "C" Datum gserialized_gist_same_2d(PG_FUNCTION_ARGS);
 extern "C" Datum gserialized_gist_distance_2d(PG_FUNCTION_ARGS);
+#if POSTGIS_PGSQL_VERSION >= 140
+extern "C" Datum gserialized_gist_sortsupport_2d(PG_FUNCTION_ARGS);
+#endif
 
 /*
 ** GiST 2D operator prototypes
@@ -1409,6 +1416,97 @@ Datum gserialized_gist_same_2d(PG_FUNCTION_ARGS)
 	PG_RETURN_POINTER(result);
 }
 
+#if POSTGIS_PGSQL_VERSION >= 140
+/*
+** Sorted GiST build. The server sorts the keys along a Hilbert
+** curve of their centers and packs the leaf pages in that order,
+** instead of inserting the keys one by one with penalty and
+** picksplit. Neighbouring keys end up on the same pages, so the
+** pages overlap less than with a one by one build.
+*/
+static uint64_t box2df_get_sortable_hilbert(const BOX2DF *b)
+{
+	GBOX box;
+
+	gbox_init(&box);
+	box.xmin = b->xmin;
+	box.xmax = b->xmax;
+	box.ymin = b->ymin;
+	box.ymax = b->ymax;
+	return gbox_get_sortable_hilbert(&box);
+}
+
+static int
+gserialized_gist_cmp_full_2d(Datum a, Datum b, SortSupport ssup)
+{
+	BOX2DF *b1 = (BOX2DF*)DatumGetPointer(a);
+	BOX2DF *b2 = (BOX2DF*)DatumGetPointer(b);
+	uint64_t hash1 = box2df_get_sortable_hilbert(b1);
+	uint64_t hash2 = box2df_get_sortable_hilbert(b2);
+	int cmp;
+
+	if ( hash1 > hash2 )
+		return 1;
+	if ( hash1 < hash2 )
+		return -1;
+
+	/* Same center, give a stable order anyway */
+	cmp = memcmp(b1, b2, sizeof(BOX2DF));
+	return cmp == 0 ? 0 : (cmp > 0 ? 1 : -1);
+}
+
+/*
+** Abbreviated keys are the Hilbert keys themselves. Equal
+** abbreviations fall back to the full comparator.
+*/
+static int
+gserialized_gist_cmp_abbrev_2d(Datum a, Datum b, SortSupport ssup)
+{
+	if ( a > b )
+		return 1;
+	if ( a < b )
+		return -1;
+	return 0;
+}
+
+static Datum
+gserialized_gist_abbrev_convert_2d(Datum original, SortSupport ssup)
+{
+	return (Datum) box2df_get_sortable_hilbert((BOX2DF*)DatumGetPointer(original));
+}
+
+static bool
+gserialized_gist_abbrev_abort_2d(int memtupcount, SortSupport ssup)
+{
+	return false;
+}
+
+/*
+** GiST support function. Sort support for sorted index builds.
+*/
+PG_FUNCTION_INFO_V1(gserialized_gist_sortsupport_2d);
+Datum gserialized_gist_sortsupport_2d(PG_FUNCTION_ARGS)
+{
+	SortSupport ssup = (SortSupport) PG_GETARG_POINTER(0);
+
+	POSTGIS_DEBUG(4, "[GIST] 'sortsupport' function called");
+
+	ssup->comparator = gserialized_gist_cmp_full_2d;
+	ssup->ssup_extra = NULL;
+
+	/* The whole key only fits in the abbreviation with 64 bit Datums */
+	if ( ssup->abbreviate && sizeof(Datum) == sizeof(uint64_t) )
+	{
+		ssup->comparator = gserialized_gist_cmp_abbrev_2d;
+		ssup->abbrev_converter = gserialized_gist_abbrev_convert_2d;
+		ssup->abbrev_abort = gserialized_gist_abbrev_abort_2d;
+		ssup->abbrev_full_comparator = gserialized_gist_cmp_full_2d;
+	}
+
+	PG_RETURN_VOID();
+}
+#endif /* POSTGIS_PGSQL_VERSION >= 140 */
+
 #if KOROTKOV_SPLIT > 0
 /*
  * Adjust BOX2DF b boundaries with insertion of addon.
@@ -42,6 +42,11 @@ extern "C" Datum pgis_geometry_polygonize_finalfn(PG_FUNCTION_ARGS);
 extern "C" Datum pgis_geometry_makeline_finalfn(PG_FUNCTION_ARGS);
 extern "C" Datum pgis_geometry_clusterintersecting_finalfn(PG_FUNCTION_ARGS);
 extern "C" Datum pgis_geometry_clusterwithin_finalfn(PG_FUNCTION_ARGS);
+extern "C" Datum pgis_geometry_union_parallel_transfn(PG_FUNCTION_ARGS);
+extern "C" Datum pgis_geometry_union_parallel_combinefn(PG_FUNCTION_ARGS);
+extern "C" Datum pgis_geometry_union_parallel_serialfn(PG_FUNCTION_ARGS);
+extern "C" Datum pgis_geometry_union_parallel_deserialfn(PG_FUNCTION_ARGS);
+extern "C" Datum pgis_geometry_union_parallel_finalfn(PG_FUNCTION_ARGS);
 extern "C" Datum pgis_abs_in(PG_FUNCTION_ARGS);
 extern "C" Datum pgis_abs_out(PG_FUNCTION_ARGS);
 
@@ -239,6 +244,323 @@ pgis_geometry_union_finalfn(PG_FUNCTION_ARGS)
 	PG_RETURN_DATUM(result);
 }
 
+/**
+** The "parallel union" aggregate does not keep every input around until
+** the final function. Instead the transition state holds a list of
+** detoasted inputs, and once that list grows past a size threshold it is
+** unioned down to a single geometry, which then becomes the first element
+** of the next batch. This keeps memory bounded for very large inputs.
+** The combine/serial/deserial functions let parallel workers union
+** their own share of the rows before the leader merges the partials.
+*/
+
+/**
+** Size in bytes of pending inputs at which a batch is unioned. The
+** threshold is also at least twice the size of the last partial result,
+** so inputs that do not dissolve don't get re-unioned for every batch.
+*/
+#define PGIS_UNION_BATCH_SIZE (16 * 1024 * 1024)
+
+typedef struct
+{
+	Oid typid;         /* geometry type oid, needed to build arrays */
+	List *list;        /* GSERIALIZED inputs, allocated in aggcontext */
+	Size size;         /* total size of the geometries in list */
+	Size merged_size;  /* size of the partial union from the last batch */
+}
+pgis_union_state;
+
+/**
+** Union all the geometries of the state into one, using the same
+** cascaded union as ST_Union(geometry[]). Result is allocated in the
+** current memory context and is NULL if there is nothing to union.
+*/
+static Datum
+pgis_union_state_union(pgis_union_state *state)
+{
+	ListCell *lc;
+	Datum *elems;
+	ArrayType *array;
+	int nelems = list_length(state->list);
+	int i = 0;
+
+	if ( nelems == 0 )
+		return (Datum) 0;
+
+	elems = (Datum *) palloc(sizeof(Datum) * nelems);
+	foreach(lc, state->list)
+	{
+		elems[i++] = PointerGetDatum(lfirst(lc));
+	}
+
+	array = construct_array(elems, nelems, state->typid, -1, false, 'd');
+	pfree(elems);
+
+	return PGISDirectFunctionCall1(pgis_union_geometry_array, PointerGetDatum(array));
+}
+
+/**
+** Replace the pending list with its union, copied into the aggregate
+** context.
+*/
+static void
+pgis_union_state_compact(pgis_union_state *state, MemoryContext aggcontext)
+{
+	ListCell *lc;
+	Datum result;
+	MemoryContext old;
+
+	if ( list_length(state->list) < 2 )
+		return;
+
+	result = pgis_union_state_union(state);
+
+	foreach(lc, state->list)
+	{
+		pfree(lfirst(lc));
+	}
+	list_free(state->list);
+	state->list = NIL;
+	state->size = 0;
+	state->merged_size = 0;
+
+	if ( result )
+	{
+		GSERIALIZED *gser = (GSERIALIZED *) DatumGetPointer(result);
+		GSERIALIZED *gser_copy;
+
+		old = MemoryContextSwitchTo(aggcontext);
+		gser_copy = (GSERIALIZED *) palloc(VARSIZE(gser));
+		memcpy(gser_copy, gser, VARSIZE(gser));
+		state->list = lappend(state->list, gser_copy);
+		MemoryContextSwitchTo(old);
+
+		state->size = state->merged_size = VARSIZE(gser_copy);
+	}
+}
+
+/**
+** Union the pending batch once it got large enough.
+*/
+static void
+pgis_union_state_check_size(pgis_union_state *state, MemoryContext aggcontext)
+{
+	Size threshold = Max(PGIS_UNION_BATCH_SIZE, 2 * state->merged_size);
+
+	if ( state->size >= threshold )
+		pgis_union_state_compact(state, aggcontext);
+}
+
+static pgis_union_state *
+pgis_union_state_new(MemoryContext aggcontext, Oid typid)
+{
+	MemoryContext old = MemoryContextSwitchTo(aggcontext);
+	pgis_union_state *state = (pgis_union_state *) palloc(sizeof(pgis_union_state));
+
+	state->typid = typid;
+	state->list = NIL;
+	state->size = 0;
+	state->merged_size = 0;
+	MemoryContextSwitchTo(old);
+
+	return state;
+}
+
+/**
+** The "parallel union" transition function copies each input into the
+** aggregate context and unions the pending batch when it gets too big.
+*/
+PG_FUNCTION_INFO_V1(pgis_geometry_union_parallel_transfn);
+Datum
+pgis_geometry_union_parallel_transfn(PG_FUNCTION_ARGS)
+{
+	MemoryContext aggcontext, old;
+	pgis_union_state *state;
+	GSERIALIZED *gser;
+	GSERIALIZED *gser_copy;
+
+	if ( ! AggCheckCallContext(fcinfo, &aggcontext) )
+		elog(ERROR, "%s called in non-aggregate context", __func__);
+
+	if ( PG_ARGISNULL(0) )
+	{
+		Oid typid = get_fn_expr_argtype(fcinfo->flinfo, 1);
+		if ( typid == InvalidOid )
+			ereport(ERROR,
+			        (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+			         errmsg("could not determine input data type")));
+		state = pgis_union_state_new(aggcontext, typid);
+	}
+	else
+	{
+		state = (pgis_union_state *) PG_GETARG_POINTER(0);
+	}
+
+	/* Null inputs do not take part in the union */
+	if ( PG_ARGISNULL(1) )
+		PG_RETURN_POINTER(state);
+
+	gser = PG_GETARG_GSERIALIZED_P(1);
+
+	old = MemoryContextSwitchTo(aggcontext);
+	gser_copy = (GSERIALIZED *) palloc(VARSIZE(gser));
+	memcpy(gser_copy, gser, VARSIZE(gser));
+	state->list = lappend(state->list, gser_copy);
+	MemoryContextSwitchTo(old);
+
+	state->size += VARSIZE(gser_copy);
+	PG_FREE_IF_COPY(gser, 1);
+
+	pgis_union_state_check_size(state, aggcontext);
+
+	PG_RETURN_POINTER(state);
+}
+
+/**
+** The "parallel union" combine function concatenates the pending lists
+** of two partial states.
+*/
+PG_FUNCTION_INFO_V1(pgis_geometry_union_parallel_combinefn);
+Datum
+pgis_geometry_union_parallel_combinefn(PG_FUNCTION_ARGS)
+{
+	MemoryContext aggcontext, old;
+	pgis_union_state *state1 = NULL;
+	pgis_union_state *state2 = NULL;
+
+	if ( ! AggCheckCallContext(fcinfo, &aggcontext) )
+		elog(ERROR, "%s called in non-aggregate context", __func__);
+
+	if ( ! PG_ARGISNULL(0) )
+		state1 = (pgis_union_state *) PG_GETARG_POINTER(0);
+	if ( ! PG_ARGISNULL(1) )
+		state2 = (pgis_union_state *) PG_GETARG_POINTER(1);
+
+	if ( ! state1 && ! state2 )
+		PG_RETURN_NULL();
+	if ( ! state2 )
+		PG_RETURN_POINTER(state1);
+	if ( ! state1 )
+		PG_RETURN_POINTER(state2);
+
+	old = MemoryContextSwitchTo(aggcontext);
+	state1->list = list_concat(state1->list, state2->list);
+	MemoryContextSwitchTo(old);
+
+	state1->size += state2->size;
+	state1->merged_size = Max(state1->merged_size, state2->merged_size);
+
+	pgis_union_state_check_size(state1, aggcontext);
+
+	PG_RETURN_POINTER(state1);
+}
+
+/**
+** The "parallel union" state is serialized as the type oid followed by
+** the pending geometries, one after the other.
+*/
+PG_FUNCTION_INFO_V1(pgis_geometry_union_parallel_serialfn);
+Datum
+pgis_geometry_union_parallel_serialfn(PG_FUNCTION_ARGS)
+{
+	pgis_union_state *state;
+	ListCell *lc;
+	bytea *result;
+	uint8_t *ptr;
+	Size size;
+
+	if ( ! AggCheckCallContext(fcinfo, NULL) )
+		elog(ERROR, "%s called in non-aggregate context", __func__);
+
+	state = (pgis_union_state *) PG_GETARG_POINTER(0);
+
+	size = VARHDRSZ + sizeof(Oid) + sizeof(Size) + state->size;
+	result = (bytea *) palloc(size);
+	SET_VARSIZE(result, size);
+	ptr = (uint8_t *) VARDATA(result);
+
+	memcpy(ptr, &state->typid, sizeof(Oid));
+	ptr += sizeof(Oid);
+	memcpy(ptr, &state->merged_size, sizeof(Size));
+	ptr += sizeof(Size);
+
+	foreach(lc, state->list)
+	{
+		GSERIALIZED *gser = (GSERIALIZED *) lfirst(lc);
+		memcpy(ptr, gser, VARSIZE(gser));
+		ptr += VARSIZE(gser);
+	}
+
+	PG_RETURN_BYTEA_P(result);
+}
+
+/**
+** Rebuild a "parallel union" state from its serialized form.
+*/
+PG_FUNCTION_INFO_V1(pgis_geometry_union_parallel_deserialfn);
+Datum
+pgis_geometry_union_parallel_deserialfn(PG_FUNCTION_ARGS)
+{
+	MemoryContext aggcontext, old;
+	pgis_union_state *state;
+	bytea *serialized;
+	uint8_t *ptr, *end;
+	Oid typid;
+
+	if ( ! AggCheckCallContext(fcinfo, &aggcontext) )
+		elog(ERROR, "%s called in non-aggregate context", __func__);
+
+	serialized = PG_GETARG_BYTEA_P(0);
+	ptr = (uint8_t *) VARDATA(serialized);
+	end = ptr + VARSIZE(serialized) - VARHDRSZ;
+
+	memcpy(&typid, ptr, sizeof(Oid));
+	ptr += sizeof(Oid);
+	state = pgis_union_state_new(aggcontext, typid);
+	memcpy(&state->merged_size, ptr, sizeof(Size));
+	ptr += sizeof(Size);
+
+	old = MemoryContextSwitchTo(aggcontext);
+	while ( ptr < end )
+	{
+		/* Geometries are copied out so they end up aligned */
+		Size gsize = VARSIZE(ptr);
+		GSERIALIZED *gser = (GSERIALIZED *) palloc(gsize);
+		memcpy(gser, ptr, gsize);
+		state->list = lappend(state->list, gser);
+		state->size += gsize;
+		ptr += gsize;
+	}
+	MemoryContextSwitchTo(old);
+
+	PG_RETURN_POINTER(state);
+}
+
+/**
+** The "parallel union" final function unions what is left in the state.
+*/
+PG_FUNCTION_INFO_V1(pgis_geometry_union_parallel_finalfn);
+Datum
+pgis_geometry_union_parallel_finalfn(PG_FUNCTION_ARGS)
+{
+	pgis_union_state *state;
+	Datum result;
+
+	if ( ! AggCheckCallContext(fcinfo, NULL) )
+		elog(ERROR, "%s called in non-aggregate context", __func__);
+
+	if ( PG_ARGISNULL(0) )
+		PG_RETURN_NULL();   /* returns null iff no input values */
+
+	state = (pgis_union_state *) PG_GETARG_POINTER(0);
+
+	result = pgis_union_state_union(state);
+	if ( ! result )
+		PG_RETURN_NULL();
+
+	PG_RETURN_DATUM(result);
+}
+
 /**
 * The "collect" final function passes the geometry[] to a geometrycollection
 * conversion before returning the result.
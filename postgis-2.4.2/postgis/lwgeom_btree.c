@@ -43,6 +43,7 @@ extern "C" Datum lwgeom_eq(PG_FUNCTION_ARGS);
 extern "C" Datum lwgeom_ge(PG_FUNCTION_ARGS);
 extern "C" Datum lwgeom_gt(PG_FUNCTION_ARGS);
 extern "C" Datum lwgeom_cmp(PG_FUNCTION_ARGS);
+extern "C" Datum ST_SortableHash(PG_FUNCTION_ARGS);
 
 PG_FUNCTION_INFO_V1(lwgeom_lt);
 Datum lwgeom_lt(PG_FUNCTION_ARGS)
@@ -125,3 +126,24 @@ Datum lwgeom_cmp(PG_FUNCTION_ARGS)
 	PG_RETURN_INT32(ret);
 }
 
+/*
+** Hilbert key of the bounding box center. Ordering a table by it
+** before building a GiST index inserts neighbouring features one
+** after the other, which gives a faster build and tighter pages.
+** Empty geometries sort first.
+*/
+PG_FUNCTION_INFO_V1(ST_SortableHash);
+Datum ST_SortableHash(PG_FUNCTION_ARGS)
+{
+	GSERIALIZED *g = PG_GETARG_GSERIALIZED_P(0);
+	GBOX box;
+	uint64_t hash = 0;
+
+	if ( gserialized_get_gbox_p(g, &box) == LW_SUCCESS )
+		hash = gbox_get_sortable_hilbert(&box);
+
+	PG_FREE_IF_COPY(g, 0);
+
+	/* Flip the top bit so the signed int8 order is the key order */
+	PG_RETURN_INT64((int64_t)(hash ^ ((uint64_t)1 << 63)));
+}
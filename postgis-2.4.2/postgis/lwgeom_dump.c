@@ -54,6 +54,7 @@ typedef struct GEOMDUMPSTATE
 	int stacklen;
 	GEOMDUMPNODE *stack[MAXDEPTH];
 	LWGEOM *root;
+	GSERIALIZED *serialized; /* the input, returned as is for simple geometries */
 }
 GEOMDUMPSTATE;
 
@@ -73,13 +74,12 @@ Datum LWGEOM_dump(PG_FUNCTION_ARGS)
 	GEOMDUMPNODE *node;
 	TupleDesc tupdesc;
 	HeapTuple tuple;
-	AttInMetadata *attinmeta;
 	MemoryContext oldcontext, newcontext;
 	Datum result;
-	char address[256];
-	char *ptr;
+	Datum address[MAXDEPTH];
 	uint32 i;
-	char *values[2];
+	Datum values[2];
+	bool isnull[2] = {0,0};
 
 	if (SRF_IS_FIRSTCALL())
 	{
@@ -94,6 +94,7 @@ Datum LWGEOM_dump(PG_FUNCTION_ARGS)
 		/* Create function state */
 		state = lwalloc(sizeof(GEOMDUMPSTATE));
 		state->root = lwgeom;
+		state->serialized = pglwgeom;
 		state->stacklen=0;
 
 		if ( lwgeom_is_collection(lwgeom) )
@@ -111,16 +112,12 @@ Datum LWGEOM_dump(PG_FUNCTION_ARGS)
 
 		/*
 		 * Build a tuple description for an
-		 * geometry_dump tuple
+		 * geometry_dump tuple. Rows are formed straight from the path
+		 * array and the serialized geometry, without a trip through
+		 * their text representations.
 		 */
 		tupdesc = RelationNameGetTupleDesc("geometry_dump");
-
-		/*
-		 * generate attribute metadata needed later to produce
-		 * tuples from raw C strings
-		 */
-		attinmeta = TupleDescGetAttInMetadata(tupdesc);
-		funcctx->attinmeta = attinmeta;
+		funcctx->tuple_desc = BlessTupleDesc(tupdesc);
 
 		MemoryContextSwitchTo(oldcontext);
 	}
@@ -138,9 +135,9 @@ Datum LWGEOM_dump(PG_FUNCTION_ARGS)
 	if ( lwgeom_is_empty(state->root) ) SRF_RETURN_DONE(funcctx);
 	if ( ! lwgeom_is_collection(state->root) )
 	{
-		values[0] = "{}";
-		values[1] = lwgeom_to_hexwkb(state->root, WKB_EXTENDED, 0);
-		tuple = BuildTupleFromCStrings(funcctx->attinmeta, values);
+		values[0] = PointerGetDatum(construct_empty_array(INT4OID));
+		values[1] = PointerGetDatum(state->serialized);
+		tuple = heap_form_tuple(funcctx->tuple_desc, values, isnull);
 		result = HeapTupleGetDatum(tuple);
 
 		state->root = NULL;
@@ -158,15 +155,8 @@ Datum LWGEOM_dump(PG_FUNCTION_ARGS)
 			if ( ! lwgeom_is_collection(lwgeom) )
 			{
 				/* write address of current geom */
-				ptr=address;
-				*ptr++='{';
 				for (i=0; i<state->stacklen; i++)
-				{
-					if ( i ) ptr += sprintf(ptr, ",");
-					ptr += sprintf(ptr, "%d", state->stack[i]->idx+1);
-				}
-				*ptr++='}';
-				*ptr='\0';
+					address[i] = Int32GetDatum(state->stack[i]->idx+1);
 
 				break;
 			}
@@ -195,10 +185,10 @@ Datum LWGEOM_dump(PG_FUNCTION_ARGS)
 
 	lwgeom->srid = state->root->srid;
 
-	values[0] = address;
-	values[1] = lwgeom_to_hexwkb(lwgeom, WKB_EXTENDED, 0);
-	tuple = BuildTupleFromCStrings(funcctx->attinmeta, values);
-	result = TupleGetDatum(funcctx->slot, tuple);
+	values[0] = PointerGetDatum(construct_array(address, state->stacklen, INT4OID, sizeof(int32), true, 'i'));
+	values[1] = PointerGetDatum(gserialized_from_lwgeom(lwgeom, 0));
+	tuple = heap_form_tuple(funcctx->tuple_desc, values, isnull);
+	result = HeapTupleGetDatum(tuple);
 	node->idx++;
 	SRF_RETURN_NEXT(funcctx, result);
 }
@@ -218,11 +208,11 @@ Datum LWGEOM_dump_rings(PG_FUNCTION_ARGS)
 	struct POLYDUMPSTATE *state;
 	TupleDesc tupdesc;
 	HeapTuple tuple;
-	AttInMetadata *attinmeta;
 	MemoryContext oldcontext, newcontext;
 	Datum result;
-	char address[256];
-	char *values[2];
+	Datum address;
+	Datum values[2];
+	bool isnull[2] = {0,0};
 
 	if (SRF_IS_FIRSTCALL())
 	{
@@ -252,13 +242,7 @@ Datum LWGEOM_dump_rings(PG_FUNCTION_ARGS)
 		 * geometry_dump tuple
 		 */
 		tupdesc = RelationNameGetTupleDesc("geometry_dump");
-
-		/*
-		 * generate attribute metadata needed later to produce
-		 * tuples from raw C strings
-		 */
-		attinmeta = TupleDescGetAttInMetadata(tupdesc);
-		funcctx->attinmeta = attinmeta;
+		funcctx->tuple_desc = BlessTupleDesc(tupdesc);
 
 		MemoryContextSwitchTo(oldcontext);
 	}
@@ -278,7 +262,7 @@ Datum LWGEOM_dump_rings(PG_FUNCTION_ARGS)
 		LWGEOM* ringgeom;
 
 		/* Switch to an appropriate memory context for POINTARRAY
-		 * cloning and hexwkb allocation */
+		 * cloning and serialization */
 		oldcontext = MemoryContextSwitchTo(newcontext);
 
 		/* We need a copy of input ring here */
@@ -292,14 +276,14 @@ Datum LWGEOM_dump_rings(PG_FUNCTION_ARGS)
 		               &ring);
 
 		/* Write path as ``{ <ringnum> }'' */
-		sprintf(address, "{%d}", state->ringnum);
+		address = Int32GetDatum(state->ringnum);
 
-		values[0] = address;
-		values[1] = lwgeom_to_hexwkb(ringgeom, WKB_EXTENDED, 0);
+		values[0] = PointerGetDatum(construct_array(&address, 1, INT4OID, sizeof(int32), true, 'i'));
+		values[1] = PointerGetDatum(gserialized_from_lwgeom(ringgeom, 0));
 
 		MemoryContextSwitchTo(oldcontext);
 
-		tuple = BuildTupleFromCStrings(funcctx->attinmeta, values);
+		tuple = heap_form_tuple(funcctx->tuple_desc, values, isnull);
 		result = HeapTupleGetDatum(tuple);
 		++state->ringnum;
 		SRF_RETURN_NEXT(funcctx, result);
@@ -334,21 +318,19 @@ Datum ST_Subdivide(PG_FUNCTION_ARGS)
 
 	typedef struct
 	{
-		int nextgeom;
-		int numgeoms;
-		LWCOLLECTION *col;
-	} collection_fctx;
+		LWGEOM *geom;
+		LWSUBDIVIDEITERATOR *it;
+	} subdivide_fctx;
 
 	FuncCallContext *funcctx;
-	collection_fctx *fctx;
+	subdivide_fctx *fctx;
 	MemoryContext oldcontext;
+	LWGEOM *piece;
 
 	/* stuff done only on the first call of the function */
 	if (SRF_IS_FIRSTCALL())
 	{
 		GSERIALIZED *gser;
-		LWGEOM *geom;
-		LWCOLLECTION *col;
 		int maxvertices = 256;
 
 		/* create a function context for cross-call persistence */
@@ -359,11 +341,14 @@ Datum ST_Subdivide(PG_FUNCTION_ARGS)
 		*/
 		oldcontext = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
 
+		/* allocate memory for user context */
+		fctx = (subdivide_fctx *) palloc(sizeof(subdivide_fctx));
+
 		/*
 		* Get the geometry value
 		*/
 		gser = PG_GETARG_GSERIALIZED_P(0);
-		geom = lwgeom_from_gserialized(gser);
+		fctx->geom = lwgeom_from_gserialized(gser);
 
 		/*
 		* Get the max vertices value
@@ -372,20 +357,10 @@ Datum ST_Subdivide(PG_FUNCTION_ARGS)
 			maxvertices = PG_GETARG_INT32(1);
 
 		/*
-		* Compute the subdivision of the geometry
+		* Pieces are computed one per call rather than all up front,
+		* so the first ones go out before the last ones are cut
 		*/
-		col = lwgeom_subdivide(geom, maxvertices);
-
-		if ( ! col )
-			SRF_RETURN_DONE(funcctx);
-
-		/* allocate memory for user context */
-		fctx = (collection_fctx *) palloc(sizeof(collection_fctx));
-
-		/* initialize state */
-		fctx->nextgeom = 0;
-		fctx->numgeoms = col->ngeoms;
-		fctx->col = col;
+		fctx->it = lwsubdivideiterator_create(fctx->geom, maxvertices);
 
 		/* save user context, switch back to function context */
 		funcctx->user_fctx = fctx;
@@ -394,17 +369,23 @@ Datum ST_Subdivide(PG_FUNCTION_ARGS)
 
 	/* stuff done on every call of the function */
 	funcctx = SRF_PERCALL_SETUP();
-	fctx = funcctx->user_fctx;
+	fctx = (subdivide_fctx *) funcctx->user_fctx;
+
+	/* The pieces still to cut live across calls */
+	oldcontext = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+	piece = lwsubdivideiterator_next(fctx->it);
+	MemoryContextSwitchTo(oldcontext);
 
-	if (fctx->nextgeom < fctx->numgeoms)
+	if (piece)
 	{
-		GSERIALIZED *gpart = geometry_serialize(fctx->col->geoms[fctx->nextgeom]);
-		fctx->nextgeom++;
+		GSERIALIZED *gpart = geometry_serialize(piece);
+		lwgeom_free(piece);
 		SRF_RETURN_NEXT(funcctx, PointerGetDatum(gpart));
 	}
 	else
 	{
 		/* do when there is no more left */
+		lwsubdivideiterator_destroy(fctx->it);
 		SRF_RETURN_DONE(funcctx);
 	}
 
@@ -62,6 +62,17 @@ struct dumpstate {
 
 	int ring; /* ring of top polygon */
 	int pt; /* point of top geom or current ring */
+
+	/*
+	 * Rows are copied by heap_form_tuple, so the path array and the point
+	 * are kept across calls and only patched: the last path element is
+	 * the point number, and the point is a serialized template of the
+	 * right srid and dimensions that gets the coordinates copied in.
+	 */
+	ArrayType *patharray;
+	GSERIALIZED *point;
+	uint8_t *coords; /* ordinates within point */
+	size_t ptsize;
 };
 
 PG_FUNCTION_INFO_V1(LWGEOM_dumppoints);
@@ -127,6 +138,19 @@ Datum LWGEOM_dumppoints(PG_FUNCTION_ARGS) {
 
 		/* get and cache data for constructing int4 arrays */
 		get_typlenbyvalalign(INT4OID, &state->typlen, &state->byval, &state->align);
+		state->patharray = NULL;
+
+		/* serialize a point once, the ordinates are the last bytes of it */
+		{
+			POINT4D zero = {0, 0, 0, 0};
+			LWPOINT *lwpoint = lwpoint_make(lwgeom->srid, FLAGS_GET_Z(lwgeom->flags), FLAGS_GET_M(lwgeom->flags), &zero);
+			size_t size;
+
+			state->point = gserialized_from_lwgeom((LWGEOM*)lwpoint, &size);
+			state->ptsize = FLAGS_NDIMS(lwgeom->flags) * sizeof(double);
+			state->coords = (uint8_t*)state->point + size - state->ptsize;
+			lwpoint_free(lwpoint);
+		}
 
 		MemoryContextSwitchTo(oldcontext);
 	}
@@ -145,20 +169,18 @@ Datum LWGEOM_dumppoints(PG_FUNCTION_ARGS) {
 		/* need to return a point from this geometry */
 		if (!lwgeom_is_collection(lwgeom)) {
 			/* either return a point, or pop the stack */
-			/* TODO use a union?  would save a tiny amount of stack space.
-			 * probably not worth the bother
-			 */
 			LWLINE	*line;
 			LWCIRCSTRING *circ;
 			LWPOLY	*poly;
 			LWTRIANGLE	*tri;
-			LWPOINT *lwpoint = NULL;
-			POINT4D	pt;
+			LWPOINT *lwpoint;
+			const POINTARRAY *pa = NULL; /* array holding the next point */
+			int idx = 0; /* and its index there */
 
 			/*
-			 * net result of switch should be to set lwpoint to the
-			 * next point to return, or leave at NULL if there
-			 * are no more points in the geometry
+			 * net result of switch should be to set pa to the point
+			 * array of the next point to return, or leave at NULL if
+			 * there are no more points in the geometry
 			 */
 			switch(lwgeom->type) {
 				case TRIANGLETYPE:
@@ -166,20 +188,16 @@ Datum LWGEOM_dumppoints(PG_FUNCTION_ARGS) {
 					if (state->pt == 0) {
 						state->path[state->pathlen++] = Int32GetDatum(state->ring+1);
 					}
-					if (state->pt <= 3) {
-						getPoint4d_p(tri->points, state->pt, &pt);
-						lwpoint = lwpoint_make(tri->srid,
-								FLAGS_GET_Z(tri->points->flags),
-								FLAGS_GET_M(tri->points->flags),
-								&pt);
-					}
-					if (state->pt > 3) {
+					if (state->pt <= 3 && state->pt < tri->points->npoints) {
+						pa = tri->points;
+						idx = state->pt;
+					} else {
 						state->pathlen--;
 					}
 					break;
 				case POLYGONTYPE:
 					poly = lwgeom_as_lwpoly(lwgeom);
-					if (state->pt == poly->rings[state->ring]->npoints) {
+					if (state->ring < poly->nrings && state->pt == poly->rings[state->ring]->npoints) {
 						state->pt = 0;
 						state->ring++;
 						state->pathlen--;
@@ -189,38 +207,30 @@ Datum LWGEOM_dumppoints(PG_FUNCTION_ARGS) {
 						state->path[state->pathlen] = Int32GetDatum(state->ring+1);
 						state->pathlen++;
 					}
-				       	if (state->ring == poly->nrings) {
-					} else {
-					/* TODO should be able to directly get the point
-					 * into the point array of a fixed lwpoint
-					 */
-					/* can't get the point directly from the ptarray because
-					 * it might be aligned wrong, so at least one memcpy
-					 * seems unavoidable
-					 * It might be possible to pass it directly to gserialized
-					 * depending how that works, it might effectively be gserialized
-					 * though a brief look at the code indicates not
-					 */
-						getPoint4d_p(poly->rings[state->ring], state->pt, &pt);
-						lwpoint = lwpoint_make(poly->srid,
-								FLAGS_GET_Z(poly->rings[state->ring]->flags),
-								FLAGS_GET_M(poly->rings[state->ring]->flags),
-								&pt);
+					if (state->ring < poly->nrings) {
+						pa = poly->rings[state->ring];
+						idx = state->pt;
 					}
 					break;
 				case POINTTYPE:
-					if (state->pt == 0) lwpoint = lwgeom_as_lwpoint(lwgeom);
+					lwpoint = lwgeom_as_lwpoint(lwgeom);
+					if (state->pt == 0) {
+						pa = lwpoint->point;
+						idx = 0;
+					}
 					break;
 				case LINETYPE:
 					line = lwgeom_as_lwline(lwgeom);
-					if (line->points && state->pt <= line->points->npoints) {
-						lwpoint = lwline_get_lwpoint((LWLINE*)lwgeom, state->pt);
+					if (line->points && state->pt < line->points->npoints) {
+						pa = line->points;
+						idx = state->pt;
 					}
 					break;
 				case CIRCSTRINGTYPE:
 					circ = lwgeom_as_lwcircstring(lwgeom);
-					if (circ->points && state->pt <= circ->points->npoints) {
-						lwpoint = lwcircstring_get_lwpoint((LWCIRCSTRING*)lwgeom, state->pt);
+					if (circ->points && state->pt < circ->points->npoints) {
+						pa = circ->points;
+						idx = state->pt;
 					}
 					break;
 				default:
@@ -229,15 +239,15 @@ Datum LWGEOM_dumppoints(PG_FUNCTION_ARGS) {
 			}
 
 			/*
-			 * At this point, lwpoint is either NULL, in which case
+			 * At this point, pa is either NULL, in which case
 			 * we need to pop the geometry stack and get the next
-			 * geometry, if amy, or lwpoint is set and we construct
+			 * geometry, if amy, or pa is set and we construct
 			 * a record type with the integer array of geometry
 			 * indexes and the point number, and the actual point
 			 * geometry itself
 			 */
 
-			if (!lwpoint) {
+			if (!pa) {
 				/* no point, so pop the geom and look for more */
 				if (--state->stacklen == 0) SRF_RETURN_DONE(funcctx);
 				state->pathlen--;
@@ -246,11 +256,33 @@ Datum LWGEOM_dumppoints(PG_FUNCTION_ARGS) {
 				/* write address of current geom/pt */
 				state->pt++;
 
-				state->path[state->pathlen] = Int32GetDatum(state->pt);
-				pathpt[0] = PointerGetDatum(construct_array(state->path, state->pathlen+1,
-						INT4OID, state->typlen, state->byval, state->align));
-
-				pathpt[1] = PointerGetDatum(gserialized_from_lwgeom((LWGEOM*)lwpoint,0));
+				if (state->pt == 1 || !state->patharray) {
+					/* first point of a point array, the rest of the path changed */
+					oldcontext = MemoryContextSwitchTo(newcontext);
+					if (state->patharray) pfree(state->patharray);
+					state->path[state->pathlen] = Int32GetDatum(state->pt);
+					state->patharray = construct_array(state->path, state->pathlen+1,
+							INT4OID, state->typlen, state->byval, state->align);
+					MemoryContextSwitchTo(oldcontext);
+				} else {
+					((int32*)ARR_DATA_PTR(state->patharray))[state->pathlen] = state->pt;
+				}
+				pathpt[0] = PointerGetDatum(state->patharray);
+
+				if (pa->npoints == 0) {
+					/* the empty point of a collection */
+					pathpt[1] = PointerGetDatum(gserialized_from_lwgeom(lwgeom, 0));
+				} else if (FLAGS_NDIMS(pa->flags) * sizeof(double) == state->ptsize) {
+					/* can't get the point from the ptarray in place, it might
+					 * be aligned wrong, but one memcpy into the template will do */
+					memcpy(state->coords, getPoint_internal(pa, idx), state->ptsize);
+					pathpt[1] = PointerGetDatum(state->point);
+				} else {
+					POINT4D	pt;
+					getPoint4d_p(pa, idx, &pt);
+					lwpoint = lwpoint_make(lwgeom->srid, FLAGS_GET_Z(pa->flags), FLAGS_GET_M(pa->flags), &pt);
+					pathpt[1] = PointerGetDatum(gserialized_from_lwgeom((LWGEOM*)lwpoint, 0));
+				}
 
 				tuple = heap_form_tuple(funcctx->tuple_desc, pathpt, isnull);
 				result = HeapTupleGetDatum(tuple);
@@ -46,6 +46,7 @@
 /* Prototypes */
 extern "C" Datum LWGEOM_simplify2d(PG_FUNCTION_ARGS);
 extern "C" Datum LWGEOM_SetEffectiveArea(PG_FUNCTION_ARGS);
+extern "C" Datum LWGEOM_SetEffectiveAreaCoverage(PG_FUNCTION_ARGS);
 extern "C" Datum ST_LineCrossingDirection(PG_FUNCTION_ARGS);
 extern "C" Datum ST_MinimumBoundingRadius(PG_FUNCTION_ARGS);
 extern "C" Datum ST_MinimumBoundingCircle(PG_FUNCTION_ARGS);
@@ -57,7 +58,7 @@ extern "C" Datum ST_IsPolygonCW(PG_FUNCTION_ARGS);
 static double determineSide(const POINT2D *seg1, const POINT2D *seg2, const POINT2D *point);
 static int isOnSegment(const POINT2D *seg1, const POINT2D *seg2, const POINT2D *point);
 static int point_in_ring(POINTARRAY *pts, const POINT2D *point);
-static int point_in_ring_rtree(RTREE_NODE *root, const POINT2D *point);
+static int point_in_ring_rtree(const RTREE_NODE *root, const POINT2D *point);
 
 
 PG_FUNCTION_INFO_V1(LWGEOM_simplify2d);
@@ -126,6 +127,93 @@ Datum LWGEOM_SetEffectiveArea(PG_FUNCTION_ARGS)
 	PG_RETURN_POINTER(result);
 }
 
+/*
+ * Visvalingam-Whyatt simplification of an array of polygons as one
+ * coverage: shared boundaries are simplified once, the same way for
+ * every polygon using them. NULL elements stay NULL.
+ */
+PG_FUNCTION_INFO_V1(LWGEOM_SetEffectiveAreaCoverage);
+Datum LWGEOM_SetEffectiveAreaCoverage(PG_FUNCTION_ARGS)
+{
+	ArrayType *array = PG_GETARG_ARRAYTYPE_P(0);
+	double area = PG_GETARG_FLOAT8(1);
+	ArrayType *result;
+	ArrayIterator iterator;
+	Datum value;
+	bool isnull;
+	LWGEOM **in;
+	LWGEOM **out;
+	Datum *elems;
+	bool *nulls;
+	int dims[1];
+	int lbs[1];
+	int16 elmlen;
+	bool elmbyval;
+	char elmalign;
+	int srid = SRID_UNKNOWN;
+	bool gotsrid = false;
+	uint32_t nelems, i = 0;
+
+	nelems = ArrayGetNItems(ARR_NDIM(array), ARR_DIMS(array));
+	if ( nelems == 0 )
+		PG_RETURN_POINTER(array);
+
+	in = (LWGEOM**)palloc(sizeof(LWGEOM*) * nelems);
+
+#if POSTGIS_PGSQL_VERSION >= 95
+	iterator = array_create_iterator(array, 0, NULL);
+#else
+	iterator = array_create_iterator(array, 0);
+#endif
+	while( array_iterate(iterator, &value, &isnull) )
+	{
+		GSERIALIZED *geom;
+
+		in[i] = NULL;
+		if ( ! isnull )
+		{
+			geom = (GSERIALIZED*)DatumGetPointer(value);
+			if ( ! gotsrid )
+			{
+				srid = gserialized_get_srid(geom);
+				gotsrid = true;
+			}
+			else
+				error_if_srid_mismatch(srid, gserialized_get_srid(geom));
+			in[i] = lwgeom_from_gserialized(geom);
+		}
+		i++;
+	}
+	array_free_iterator(iterator);
+
+	out = lwgeom_set_effective_area_coverage(in, nelems, area);
+
+	elems = (Datum*)palloc(sizeof(Datum) * nelems);
+	nulls = (bool*)palloc(sizeof(bool) * nelems);
+	for ( i = 0; i < nelems; i++ )
+	{
+		nulls[i] = (out[i] == NULL);
+		elems[i] = (Datum)0;
+		if ( out[i] )
+		{
+			/* COMPUTE_BBOX TAINTING */
+			if ( in[i]->bbox ) lwgeom_add_bbox(out[i]);
+			elems[i] = PointerGetDatum(geometry_serialize(out[i]));
+			lwgeom_free(out[i]);
+		}
+		if ( in[i] ) lwgeom_free(in[i]);
+	}
+	lwfree(out);
+	pfree(in);
+
+	dims[0] = nelems;
+	lbs[0] = 1;
+	get_typlenbyvalalign(ARR_ELEMTYPE(array), &elmlen, &elmbyval, &elmalign);
+	result = construct_md_array(elems, nulls, 1, dims, lbs, ARR_ELEMTYPE(array), elmlen, elmbyval, elmalign);
+
+	PG_RETURN_POINTER(result);
+}
+
 
 /***********************************************************************
  * --strk@kbt.io;
@@ -703,78 +791,97 @@ static int isOnSegment(const POINT2D *seg1, const POINT2D *seg2, const POINT2D *
 }
 
 /*
- * return -1 iff point is outside ring pts
- * return 1 iff point is inside ring pts
- * return 0 iff point is on ring pts
+ * Winding number contribution of one segment of a ring, as in
+ * point_in_ring. Returns 0 iff point is on the segment, 1 otherwise.
  */
-static int point_in_ring_rtree(RTREE_NODE *root, const POINT2D *point)
+static inline int
+point_in_ring_segment(const POINT2D *seg1, const POINT2D *seg2, const POINT2D *point, int *wn)
 {
-	int wn = 0;
-	int i;
 	double side;
-	const POINT2D *seg1;
-	const POINT2D *seg2;
-	LWMLINE *lines;
 
-	POSTGIS_DEBUG(2, "point_in_ring called.");
+	/* zero length segments are ignored. */
+	if (((seg2->x - seg1->x)*(seg2->x - seg1->x) + (seg2->y - seg1->y)*(seg2->y - seg1->y)) < 1e-12*1e-12)
+		return 1;
 
-	lines = RTreeFindLineSegments(root, point->y);
-	if (!lines)
-		return -1;
+	side = determineSide(seg1, seg2, point);
 
-	for (i=0; i<lines->ngeoms; i++)
+	/* a point on the boundary of a ring is not contained. */
+	if (side == 0.0)
 	{
-		seg1 = getPoint2d_cp(lines->geoms[i]->points, 0);
-		seg2 = getPoint2d_cp(lines->geoms[i]->points, 1);
+		if (isOnSegment(seg1, seg2, point) == 1)
+			return 0;
+	}
 
-		side = determineSide(seg1, seg2, point);
+	if (FP_CONTAINS_BOTTOM(seg1->y, point->y, seg2->y) && side>0)
+		++(*wn);
+	else if (FP_CONTAINS_BOTTOM(seg2->y, point->y, seg1->y) && side<0)
+		--(*wn);
 
-		POSTGIS_DEBUGF(3, "segment: (%.8f, %.8f),(%.8f, %.8f)", seg1->x, seg1->y, seg2->x, seg2->y);
-		POSTGIS_DEBUGF(3, "side result: %.8f", side);
-		POSTGIS_DEBUGF(3, "counterclockwise wrap %d, clockwise wrap %d", FP_CONTAINS_BOTTOM(seg1->y, point->y, seg2->y), FP_CONTAINS_BOTTOM(seg2->y, point->y, seg1->y));
+	return 1;
+}
 
-		/* zero length segments are ignored. */
-		if (((seg2->x - seg1->x)*(seg2->x - seg1->x) + (seg2->y - seg1->y)*(seg2->y - seg1->y)) < 1e-12*1e-12)
-		{
-			POSTGIS_DEBUG(3, "segment is zero length... ignoring.");
+/*
+ * Walk node of the given level of a packed ring index, adding up the
+ * winding number of the segments whose y-range contains the point.
+ * Returns 0 iff point is on the ring, 1 otherwise.
+ */
+static int
+point_in_ring_rtree_node(const RTREE_NODE *root, int level, int node, const POINT2D *point, int *wn)
+{
+	const RTREE_INTERVAL *children = root->nodes + root->offsets[level-1];
+	int first = node * RTREE_NODE_SIZE;
+	int last = first + RTREE_NODE_SIZE < root->counts[level-1] ? first + RTREE_NODE_SIZE : root->counts[level-1];
+	int i;
 
+	for (i = first; i < last; i++)
+	{
+		if (!FP_CONTAINS_INCL(children[i].min, point->y, children[i].max))
 			continue;
-		}
 
-		/* a point on the boundary of a ring is not contained. */
-		/* WAS: if (fabs(side) < 1e-12), see #852 */
-		if (side == 0.0)
+		if (level == 1)
 		{
-			if (isOnSegment(seg1, seg2, point) == 1)
+			if (!point_in_ring_segment(&(root->points[i]), &(root->points[i+1]), point, wn))
 			{
 				POSTGIS_DEBUGF(3, "point on ring boundary between points %d, %d", i, i+1);
-
 				return 0;
 			}
 		}
-
-		/*
-		 * If the point is to the left of the line, and it's rising,
-		 * then the line is to the right of the point and
-		 * circling counter-clockwise, so incremement.
-		 */
-		if (FP_CONTAINS_BOTTOM(seg1->y, point->y, seg2->y) && side>0)
+		else if (!point_in_ring_rtree_node(root, level-1, i, point, wn))
 		{
-			POSTGIS_DEBUG(3, "incrementing winding number.");
-
-			++wn;
+			return 0;
 		}
-		/*
-		 * If the point is to the right of the line, and it's falling,
-		 * then the line is to the right of the point and circling
-		 * clockwise, so decrement.
-		 */
-		else if (FP_CONTAINS_BOTTOM(seg2->y, point->y, seg1->y) && side<0)
-		{
-			POSTGIS_DEBUG(3, "decrementing winding number.");
+	}
+	return 1;
+}
 
-			--wn;
-		}
+/*
+ * return -1 iff point is outside ring pts
+ * return 1 iff point is inside ring pts
+ * return 0 iff point is on ring pts
+ */
+static int point_in_ring_rtree(const RTREE_NODE *root, const POINT2D *point)
+{
+	int wn = 0;
+	int top;
+
+	POSTGIS_DEBUG(2, "point_in_ring_rtree called.");
+
+	if (root->nlevels == 0)
+		return -1;
+
+	top = root->nlevels - 1;
+	if (!FP_CONTAINS_INCL(root->nodes[root->offsets[top]].min, point->y, root->nodes[root->offsets[top]].max))
+		return -1;
+
+	if (top == 0)
+	{
+		/* Single segment ring */
+		if (!point_in_ring_segment(&(root->points[0]), &(root->points[1]), point, &wn))
+			return 0;
+	}
+	else if (!point_in_ring_rtree_node(root, top, 0, point, &wn))
+	{
+		return 0;
 	}
 
 	POSTGIS_DEBUGF(3, "winding number %d", wn);
@@ -867,7 +974,7 @@ static int point_in_ring(POINTARRAY *pts, const POINT2D *point)
  * return 0 iff point outside polygon or on boundary
  * return 1 iff point inside polygon
  */
-int point_in_polygon_rtree(RTREE_NODE **root, int ringCount, LWPOINT *point)
+int point_in_polygon_rtree(RTREE_NODE *root, int ringCount, LWPOINT *point)
 {
 	int i;
 	POINT2D pt;
@@ -877,7 +984,7 @@ int point_in_polygon_rtree(RTREE_NODE **root, int ringCount, LWPOINT *point)
 	getPoint2d_p(point->point, 0, &pt);
 	/* assume bbox short-circuit has already been attempted */
 
-	if (point_in_ring_rtree(root[0], &pt) != 1)
+	if (point_in_ring_rtree(&(root[0]), &pt) != 1)
 	{
 		POSTGIS_DEBUG(3, "point_in_polygon_rtree: outside exterior ring.");
 
@@ -886,7 +993,7 @@ int point_in_polygon_rtree(RTREE_NODE **root, int ringCount, LWPOINT *point)
 
 	for (i=1; i<ringCount; i++)
 	{
-		if (point_in_ring_rtree(root[i], &pt) != -1)
+		if (point_in_ring_rtree(&(root[i]), &pt) != -1)
 		{
 			POSTGIS_DEBUGF(3, "point_in_polygon_rtree: within hole %d.", i);
 
@@ -903,7 +1010,7 @@ int point_in_polygon_rtree(RTREE_NODE **root, int ringCount, LWPOINT *point)
  *
  * Expected **root order is each exterior ring followed by its holes, eg. EIIEIIEI
  */
-int point_in_multipolygon_rtree(RTREE_NODE **root, int polyCount, int *ringCounts, LWPOINT *point)
+int point_in_multipolygon_rtree(RTREE_NODE *root, int polyCount, int *ringCounts, LWPOINT *point)
 {
 	int i, p, r, in_ring;
 	POINT2D pt;
@@ -919,7 +1026,7 @@ int point_in_multipolygon_rtree(RTREE_NODE **root, int polyCount, int *ringCount
 	/* is the point inside any of the sub-polygons? */
 	for ( p = 0; p < polyCount; p++ )
 	{
-		in_ring = point_in_ring_rtree(root[i], &pt);
+		in_ring = point_in_ring_rtree(&(root[i]), &pt);
 		POSTGIS_DEBUGF(4, "point_in_multipolygon_rtree: exterior ring (%d), point_in_ring returned %d", p, in_ring);
 		if ( in_ring == -1 ) /* outside the exterior ring */
 		{
@@ -934,7 +1041,7 @@ int point_in_multipolygon_rtree(RTREE_NODE **root, int polyCount, int *ringCount
 
 	                for(r=1; r<ringCounts[p]; r++)
      	                {
-                        	in_ring = point_in_ring_rtree(root[i+r], &pt);
+                        	in_ring = point_in_ring_rtree(&(root[i+r]), &pt);
 		        	POSTGIS_DEBUGF(4, "point_in_multipolygon_rtree: interior ring (%d), point_in_ring returned %d", r, in_ring);
                         	if (in_ring == 1) /* inside a hole => outside the polygon */
                         	{
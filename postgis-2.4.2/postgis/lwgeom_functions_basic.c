@@ -28,6 +28,7 @@
 #include "../postgis_config.h"
 #include "liblwgeom.h"
 #include "lwgeom_pg.h"
+#include "lwgeom_cache.h"
 
 #include <math.h>
 #include <float.h>
@@ -597,6 +598,98 @@ Datum LWGEOM_force_sfs(PG_FUNCTION_ARGS)
 	PG_RETURN_POINTER(result);
 }
 
+/*
+* Segment tree cache for the 2d minimum distance functions. When
+* one argument repeats across calls, a deep copy of it is kept in
+* the function memory context with the segment trees of its point
+* arrays, and the distance is measured against that copy, since
+* the trees are keyed on the point arrays they were built from.
+*/
+typedef struct {
+	int                         type;       // <GeomCache>
+	GSERIALIZED*                geom1;      //
+	GSERIALIZED*                geom2;      //
+	size_t                      geom1_size; //
+	size_t                      geom2_size; //
+	int32                       argnum;     // </GeomCache>
+	LWGEOM*                     lwgeom;
+	LWDISTTREE*                 index;
+} DistTreeGeomCache;
+
+static int
+DistTreeFreer(GeomCache* cache)
+{
+	DistTreeGeomCache* dist_cache = (DistTreeGeomCache*)cache;
+	if ( dist_cache->index )
+		lwgeom_distance_tree_free(dist_cache->index);
+	if ( dist_cache->lwgeom )
+		lwgeom_free(dist_cache->lwgeom);
+	dist_cache->index = NULL;
+	dist_cache->lwgeom = NULL;
+	dist_cache->argnum = 0;
+	return LW_SUCCESS;
+}
+
+/*
+* Small geometries get no trees, but their copy is still cached,
+* so that the build is not retried on every call.
+*/
+static int
+DistTreeBuilder(const LWGEOM* lwgeom, GeomCache* cache)
+{
+	DistTreeGeomCache* dist_cache = (DistTreeGeomCache*)cache;
+
+	DistTreeFreer(cache);
+	dist_cache->lwgeom = lwgeom_clone_deep(lwgeom);
+	dist_cache->index = lwgeom_distance_tree_new(dist_cache->lwgeom);
+	return LW_SUCCESS;
+}
+
+static GeomCache*
+DistTreeAllocator(void)
+{
+	DistTreeGeomCache* cache = (DistTreeGeomCache*)palloc(sizeof(DistTreeGeomCache));
+	memset(cache, 0, sizeof(DistTreeGeomCache));
+	return (GeomCache*)cache;
+}
+
+static GeomCacheMethods DistTreeCacheMethods =
+{
+	RECT_CACHE_ENTRY,
+	DistTreeBuilder,
+	DistTreeFreer,
+	DistTreeAllocator
+};
+
+/**
+* Swap the cached copy of a repeated argument in for *lw1 or *lw2,
+* and return its segment trees. Returns NULL, leaving both alone,
+* when nothing is cached or when no argument can use a tree.
+*/
+static const LWDISTTREE*
+GetDistTree(FunctionCallInfo fcinfo, const GSERIALIZED* g1, const GSERIALIZED* g2, const LWGEOM** lw1, const LWGEOM** lw2)
+{
+	DistTreeGeomCache* dist_cache;
+
+	/* Direct calls have no flinfo to hang a cache on */
+	if ( ! fcinfo->flinfo )
+		return NULL;
+
+	/* Points are measured against a point array in one linear pass */
+	if ( gserialized_get_type(g1) == POINTTYPE || gserialized_get_type(g2) == POINTTYPE )
+		return NULL;
+
+	dist_cache = (DistTreeGeomCache*)GetGeomCache(fcinfo, &DistTreeCacheMethods, g1, g2);
+	if ( ! dist_cache || ! dist_cache->argnum || ! dist_cache->index )
+		return NULL;
+
+	if ( dist_cache->argnum == 1 )
+		*lw1 = dist_cache->lwgeom;
+	else
+		*lw2 = dist_cache->lwgeom;
+	return dist_cache->index;
+}
+
 /**
 Returns the point in first input geometry that is closest to the second input geometry in 2d
 */
@@ -610,10 +703,14 @@ Datum LWGEOM_closestpoint(PG_FUNCTION_ARGS)
 	LWGEOM *point;
 	LWGEOM *lwgeom1 = lwgeom_from_gserialized(geom1);
 	LWGEOM *lwgeom2 = lwgeom_from_gserialized(geom2);
+	const LWGEOM *lw1 = lwgeom1;
+	const LWGEOM *lw2 = lwgeom2;
+	const LWDISTTREE *tree;
 
 	error_if_srid_mismatch(lwgeom1->srid, lwgeom2->srid);
 
-	point = lwgeom_closest_point(lwgeom1, lwgeom2);
+	tree = GetDistTree(fcinfo, geom1, geom2, &lw1, &lw2);
+	point = lwgeom_closest_point_tree(lw1, lw2, tree);
 
 	if (lwgeom_is_empty(point))
 		PG_RETURN_NULL();
@@ -640,10 +737,14 @@ Datum LWGEOM_shortestline2d(PG_FUNCTION_ARGS)
 	LWGEOM *theline;
 	LWGEOM *lwgeom1 = lwgeom_from_gserialized(geom1);
 	LWGEOM *lwgeom2 = lwgeom_from_gserialized(geom2);
+	const LWGEOM *lw1 = lwgeom1;
+	const LWGEOM *lw2 = lwgeom2;
+	const LWDISTTREE *tree;
 
 	error_if_srid_mismatch(lwgeom1->srid, lwgeom2->srid);
 
-	theline = lwgeom_closest_line(lwgeom1, lwgeom2);
+	tree = GetDistTree(fcinfo, geom1, geom2, &lw1, &lw2);
+	theline = lwgeom_closest_line_tree(lw1, lw2, tree);
 
 	if (lwgeom_is_empty(theline))
 		PG_RETURN_NULL();
@@ -698,10 +799,14 @@ Datum LWGEOM_mindistance2d(PG_FUNCTION_ARGS)
 	GSERIALIZED *geom2 = PG_GETARG_GSERIALIZED_P(1);
 	LWGEOM *lwgeom1 = lwgeom_from_gserialized(geom1);
 	LWGEOM *lwgeom2 = lwgeom_from_gserialized(geom2);
+	const LWGEOM *lw1 = lwgeom1;
+	const LWGEOM *lw2 = lwgeom2;
+	const LWDISTTREE *tree;
 
 	error_if_srid_mismatch(lwgeom1->srid, lwgeom2->srid);
 
-	mindist = lwgeom_mindistance2d(lwgeom1, lwgeom2);
+	tree = GetDistTree(fcinfo, geom1, geom2, &lw1, &lw2);
+	mindist = lwgeom_mindistance2d_tolerance_tree(lw1, lw2, 0.0, tree);
 
 	lwgeom_free(lwgeom1);
 	lwgeom_free(lwgeom2);
@@ -730,6 +835,9 @@ Datum LWGEOM_dwithin(PG_FUNCTION_ARGS)
 	double tolerance = PG_GETARG_FLOAT8(2);
 	LWGEOM *lwgeom1 = lwgeom_from_gserialized(geom1);
 	LWGEOM *lwgeom2 = lwgeom_from_gserialized(geom2);
+	const LWGEOM *lw1 = lwgeom1;
+	const LWGEOM *lw2 = lwgeom2;
+	const LWDISTTREE *tree;
 
 	if ( tolerance < 0 )
 	{
@@ -739,7 +847,8 @@ Datum LWGEOM_dwithin(PG_FUNCTION_ARGS)
 
 	error_if_srid_mismatch(lwgeom1->srid, lwgeom2->srid);
 
-	mindist = lwgeom_mindistance2d_tolerance(lwgeom1,lwgeom2,tolerance);
+	tree = GetDistTree(fcinfo, geom1, geom2, &lw1, &lw2);
+	mindist = lwgeom_mindistance2d_tolerance_tree(lw1, lw2, tolerance, tree);
 
 	PG_FREE_IF_COPY(geom1, 0);
 	PG_FREE_IF_COPY(geom2, 1);
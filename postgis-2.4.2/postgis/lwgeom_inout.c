@@ -60,6 +60,7 @@ extern "C" Datum WKBFromLWGEOM(PG_FUNCTION_ARGS);
 extern "C" Datum TWKBFromLWGEOM(PG_FUNCTION_ARGS);
 extern "C" Datum TWKBFromLWGEOMArray(PG_FUNCTION_ARGS);
 extern "C" Datum LWGEOMFromTWKB(PG_FUNCTION_ARGS);
+extern "C" Datum TWKBDump(PG_FUNCTION_ARGS);
 
 
 /*
@@ -513,17 +514,16 @@ Datum TWKBFromLWGEOMArray(PG_FUNCTION_ARGS)
 {
 	ArrayType *arr_geoms = NULL;
 	ArrayType *arr_ids = NULL;
-	int num_geoms, num_ids, i = 0;
+	int num_geoms, num_ids, i = 0, pos = 0;
 
 	ArrayIterator iter_geoms, iter_ids;
 	bool null_geom, null_id;
 	Datum val_geom, val_id;
 
-	int is_homogeneous = true;
-	int subtype = 0;
 	int has_z = 0;
 	int has_m  = 0;
-	LWCOLLECTION *col = NULL;
+	int srid = SRID_UNKNOWN;
+	LWGEOM **geoms = NULL;
 	int64_t *idlist = NULL;
 	uint8_t variant = 0;
 
@@ -548,8 +548,13 @@ Datum TWKBFromLWGEOMArray(PG_FUNCTION_ARGS)
 		PG_RETURN_NULL();
 	}
 
-	/* Loop through array and build a collection of geometry and */
+	/* Loop through array and build a plain array of geometry and */
 	/* a simple array of ids. If either side is NULL, skip it */
+	if ( num_geoms > 0 )
+	{
+		geoms = palloc(num_geoms * sizeof(LWGEOM*));
+		idlist = palloc(num_geoms * sizeof(int64_t));
+	}
 
 #if POSTGIS_PGSQL_VERSION >= 95
 	iter_geoms = array_create_iterator(arr_geoms, 0, NULL);
@@ -563,27 +568,23 @@ Datum TWKBFromLWGEOMArray(PG_FUNCTION_ARGS)
 	       array_iterate(iter_ids, &val_id, &null_id) )
 	{
 		LWGEOM *geom;
-		int32_t uid;
 
+		pos++;
 		if ( null_geom || null_id )
 		{
-			elog(NOTICE, "ST_AsTWKB skipping NULL entry at position %d", i);
+			elog(NOTICE, "ST_AsTWKB skipping NULL entry at position %d", pos);
 			continue;
 		}
 
 		geom = lwgeom_from_gserialized((GSERIALIZED*)DatumGetPointer(val_geom));
-		uid = DatumGetInt64(val_id);
 
-		/* Construct collection/idlist first time through */
-		if ( ! col )
+		/* First time through the dimensionality and srid are set */
+		if ( i == 0 )
 		{
 			has_z = lwgeom_has_z(geom);
 			has_m = lwgeom_has_m(geom);
-			col = lwcollection_construct_empty(COLLECTIONTYPE, lwgeom_get_srid(geom), has_z, has_m);
+			srid = lwgeom_get_srid(geom);
 		}
-		if ( ! idlist )
-			idlist = palloc0(num_geoms * sizeof(int64_t));
-
 
 		/*Check if there is differences in dimmenstionality*/
 		if( lwgeom_has_z(geom)!=has_z || lwgeom_has_m(geom)!=has_m)
@@ -593,21 +594,10 @@ Datum TWKBFromLWGEOMArray(PG_FUNCTION_ARGS)
 			elog(ERROR, "Geometries have differenct dimensionality");
 			PG_RETURN_NULL();
 		}
-		/* Store the values */
-		lwcollection_add_lwgeom(col, geom);
-		idlist[i++] = uid;
-
-		/* Grab the geometry type and note if all geometries share it */
-		/* If so, we can make this a homogeneous collection and save some space */
-		if ( lwgeom_get_type(geom) != subtype && subtype )
-		{
-			is_homogeneous = false;
-		}
-		else
-		{
-			subtype = lwgeom_get_type(geom);
-		}
 
+		/* Store the values, ids are bigint */
+		geoms[i] = geom;
+		idlist[i++] = DatumGetInt64(val_id);
 	}
 	array_free_iterator(iter_geoms);
 	array_free_iterator(iter_ids);
@@ -619,13 +609,9 @@ Datum TWKBFromLWGEOMArray(PG_FUNCTION_ARGS)
 		elog(NOTICE, "No valid geometry - id pairs found");
 		PG_RETURN_NULL();
 	}
-	if ( is_homogeneous )
-	{
-		col->type = lwtype_get_collectiontype(subtype);
-	}
 
 	/* Read sensible precision defaults (about one meter) given the srs */
-	sp = srid_axis_precision(fcinfo, lwgeom_get_srid(lwcollection_as_lwgeom(col)), TWKB_DEFAULT_PRECISION);
+	sp = srid_axis_precision(fcinfo, srid, TWKB_DEFAULT_PRECISION);
 
 	/* If user specified XY precision, use it */
 	if ( PG_NARGS() > 2 && ! PG_ARGISNULL(2) )
@@ -650,11 +636,11 @@ Datum TWKBFromLWGEOMArray(PG_FUNCTION_ARGS)
 	if ( PG_NARGS() > 6 && ! PG_ARGISNULL(6) && PG_GETARG_BOOL(6) )
 		variant |= TWKB_BBOX;
 
-	/* Write out the TWKB */
-	twkb = lwgeom_to_twkb_with_idlist(lwcollection_as_lwgeom(col),
-	                                  idlist, variant,
-	                                  sp.precision_xy, sp.precision_z, sp.precision_m,
-	                                  &twkb_size);
+	/* Write out the TWKB, as a homogeneous multi-geometry when */
+	/* all the inputs share a type, as a collection otherwise */
+	twkb = lwgeom_to_twkb_batch(geoms, idlist, i, variant,
+	                            sp.precision_xy, sp.precision_z, sp.precision_m,
+	                            &twkb_size);
 
 	/* Convert to a bytea return type */
 	result = palloc(twkb_size + VARHDRSZ);
@@ -663,14 +649,91 @@ Datum TWKBFromLWGEOMArray(PG_FUNCTION_ARGS)
 
 	/* Clean up */
 	pfree(twkb);
+	while ( i > 0 )
+		lwgeom_free(geoms[--i]);
+	pfree(geoms);
 	pfree(idlist);
-	lwcollection_free(col);
 	PG_FREE_IF_COPY(arr_geoms, 0);
 	PG_FREE_IF_COPY(arr_ids, 1);
 
 	PG_RETURN_BYTEA_P(result);
 }
 
+struct twkbdumpstate {
+	LWGEOM **geoms;
+	int64_t *idlist;
+	int ngeoms;
+	int next; /* member to return on the next call */
+};
+
+/*
+ * TWKBDump(twkb) --> setof (id, geometry)
+ * Unpacks a TWKB collection, as written by ST_AsTWKB(geometry[], bigint[]),
+ * one member per row without building the collection first.
+ */
+PG_FUNCTION_INFO_V1(TWKBDump);
+Datum TWKBDump(PG_FUNCTION_ARGS)
+{
+	FuncCallContext *funcctx;
+	MemoryContext oldcontext;
+	struct twkbdumpstate *state;
+	Datum values[2];
+	bool isnull[2] = {0,0};
+	HeapTuple tuple;
+	LWGEOM *lwgeom;
+
+	if ( SRF_IS_FIRSTCALL() )
+	{
+		bytea *bytea_twkb;
+
+		funcctx = SRF_FIRSTCALL_INIT();
+		oldcontext = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+
+		/* Read all the members up front, they are handed out one per call */
+		bytea_twkb = PG_GETARG_BYTEA_P(0);
+		state = (struct twkbdumpstate*)palloc0(sizeof(struct twkbdumpstate));
+		state->geoms = lwgeom_from_twkb_batch((uint8_t*)VARDATA(bytea_twkb),
+		                                      VARSIZE(bytea_twkb) - VARHDRSZ,
+		                                      LW_PARSER_CHECK_ALL,
+		                                      &state->idlist, &state->ngeoms);
+		funcctx->user_fctx = state;
+
+		/* get tuple description for return type */
+		if ( get_call_result_type(fcinfo, 0, &funcctx->tuple_desc) != TYPEFUNC_COMPOSITE )
+		{
+			ereport(ERROR, (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				errmsg("set-valued function called in context that cannot accept a set")));
+		}
+		BlessTupleDesc(funcctx->tuple_desc);
+
+		MemoryContextSwitchTo(oldcontext);
+	}
+
+	/* stuff done on every call of the function */
+	funcctx = SRF_PERCALL_SETUP();
+	state = (struct twkbdumpstate*)funcctx->user_fctx;
+
+	if ( state->next >= state->ngeoms )
+		SRF_RETURN_DONE(funcctx);
+
+	lwgeom = state->geoms[state->next];
+	if ( lwgeom_needs_bbox(lwgeom) )
+		lwgeom_add_bbox(lwgeom);
+
+	/* Members without an id, from a TWKB with no idlist, get a NULL */
+	if ( state->idlist )
+		values[0] = Int64GetDatum(state->idlist[state->next]);
+	else
+		isnull[0] = true;
+	values[1] = PointerGetDatum(geometry_serialize(lwgeom));
+
+	lwgeom_free(lwgeom);
+	state->geoms[state->next++] = NULL;
+
+	tuple = heap_form_tuple(funcctx->tuple_desc, values, isnull);
+	SRF_RETURN_NEXT(funcctx, HeapTupleGetDatum(tuple));
+}
+
 
 /* puts a bbox inside the geometry */
 PG_FUNCTION_INFO_V1(LWGEOM_addBBOX);
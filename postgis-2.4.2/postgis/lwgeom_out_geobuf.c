@@ -36,6 +36,10 @@
 #include "liblwgeom.h"
 #include "geobuf.h"
 
+extern "C" Datum pgis_asgeobuf_combinefn(PG_FUNCTION_ARGS);
+extern "C" Datum pgis_asgeobuf_serialfn(PG_FUNCTION_ARGS);
+extern "C" Datum pgis_asgeobuf_deserialfn(PG_FUNCTION_ARGS);
+
 /**
  * Process input parameters and row data into state
  */
@@ -73,6 +77,89 @@ Datum pgis_asgeobuf_transfn(PG_FUNCTION_ARGS)
 #endif
 }
 
+/**
+ * Combine two partial states, for parallel aggregation
+ */
+PG_FUNCTION_INFO_V1(pgis_asgeobuf_combinefn);
+Datum pgis_asgeobuf_combinefn(PG_FUNCTION_ARGS)
+{
+#ifndef HAVE_LIBPROTOBUF
+	elog(ERROR, "Missing libprotobuf-c");
+	PG_RETURN_NULL();
+#else
+	MemoryContext aggcontext, old;
+	struct geobuf_agg_context *ctx1 = NULL;
+	struct geobuf_agg_context *ctx2 = NULL;
+
+	if (!AggCheckCallContext(fcinfo, &aggcontext))
+		elog(ERROR, "pgis_asgeobuf_combinefn called in non-aggregate context");
+
+	if (!PG_ARGISNULL(0))
+		ctx1 = (struct geobuf_agg_context *) PG_GETARG_POINTER(0);
+	if (!PG_ARGISNULL(1))
+		ctx2 = (struct geobuf_agg_context *) PG_GETARG_POINTER(1);
+
+	if (!ctx1 && !ctx2)
+		PG_RETURN_NULL();
+	if (!ctx2)
+		PG_RETURN_POINTER(ctx1);
+	if (!ctx1)
+		PG_RETURN_POINTER(ctx2);
+
+	old = MemoryContextSwitchTo(aggcontext);
+	geobuf_agg_combine(ctx1, ctx2);
+	MemoryContextSwitchTo(old);
+
+	PG_RETURN_POINTER(ctx1);
+#endif
+}
+
+/**
+ * Serialize a partial state, the encoded features are passed along as is
+ */
+PG_FUNCTION_INFO_V1(pgis_asgeobuf_serialfn);
+Datum pgis_asgeobuf_serialfn(PG_FUNCTION_ARGS)
+{
+#ifndef HAVE_LIBPROTOBUF
+	elog(ERROR, "Missing libprotobuf-c");
+	PG_RETURN_NULL();
+#else
+	struct geobuf_agg_context *ctx;
+
+	if (!AggCheckCallContext(fcinfo, NULL))
+		elog(ERROR, "pgis_asgeobuf_serialfn called in non-aggregate context");
+
+	ctx = (struct geobuf_agg_context *) PG_GETARG_POINTER(0);
+	PG_RETURN_BYTEA_P(geobuf_agg_serialize(ctx));
+#endif
+}
+
+/**
+ * Rebuild a partial state from its serialized form
+ */
+PG_FUNCTION_INFO_V1(pgis_asgeobuf_deserialfn);
+Datum pgis_asgeobuf_deserialfn(PG_FUNCTION_ARGS)
+{
+#ifndef HAVE_LIBPROTOBUF
+	elog(ERROR, "Missing libprotobuf-c");
+	PG_RETURN_NULL();
+#else
+	MemoryContext aggcontext, old;
+	struct geobuf_agg_context *ctx;
+	bytea *ba;
+
+	if (!AggCheckCallContext(fcinfo, &aggcontext))
+		elog(ERROR, "pgis_asgeobuf_deserialfn called in non-aggregate context");
+
+	ba = PG_GETARG_BYTEA_P(0);
+	old = MemoryContextSwitchTo(aggcontext);
+	ctx = geobuf_agg_deserialize(ba);
+	MemoryContextSwitchTo(old);
+
+	PG_RETURN_POINTER(ctx);
+#endif
+}
+
 /**
  * Encode final state to Geobuf
  */
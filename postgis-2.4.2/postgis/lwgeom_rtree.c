@@ -49,24 +49,20 @@ RTreeCacheCreate()
 }
 
 /**
-* Recursively frees the child nodes, the interval and the line before
-* freeing the root node.
+* Frees the vertices and nodes of a ring index, which share one
+* allocation.
 */
 static void
 RTreeFree(RTREE_NODE* root)
 {
 	POSTGIS_DEBUGF(2, "RTreeFree called for %p", root);
 
-	if (root->leftNode)
-		RTreeFree(root->leftNode);
-	if (root->rightNode)
-		RTreeFree(root->rightNode);
-	lwfree(root->interval);
-	if (root->segment)
-	{
-		lwline_free(root->segment);
-	}
-	lwfree(root);
+	if (root->points)
+		lwfree(root->points);
+	root->points = NULL;
+	root->nodes = NULL;
+	root->nsegs = 0;
+	root->nlevels = 0;
 }
 
 /**
@@ -82,7 +78,7 @@ RTreeCacheClear(RTREE_POLY_CACHE* cache)
 	{
 		for (r = 0; r < cache->ringCounts[g]; r++)
 		{
-			RTreeFree(cache->ringIndices[i]);
+			RTreeFree(&(cache->ringIndices[i]));
 			i++;
 		}
 	}
@@ -93,217 +89,82 @@ RTreeCacheClear(RTREE_POLY_CACHE* cache)
 	cache->polyCount = 0;
 }
 
-
-/**
- * Returns 1 if min < value <= max, 0 otherwise.
-*/
-static uint32
-IntervalIsContained(RTREE_INTERVAL* interval, double value)
-{
-	return FP_CONTAINS_INCL(interval->min, value, interval->max) ? 1 : 0;
-}
-
 /**
-* Creates an interval with the total extents of the two given intervals.
+* Builds the packed index of the given point array into root.
+* The point array will be part of a geometry that will be freed
+* independently of the index, so the vertices are copied.
 */
-static RTREE_INTERVAL*
-RTreeMergeIntervals(RTREE_INTERVAL *inter1, RTREE_INTERVAL *inter2)
-{
-	RTREE_INTERVAL *interval;
-
-	POSTGIS_DEBUGF(2, "RTreeMergeIntervals called with %p, %p", inter1, inter2);
-
-	interval = lwalloc(sizeof(RTREE_INTERVAL));
-	interval->max = FP_MAX(inter1->max, inter2->max);
-	interval->min = FP_MIN(inter1->min, inter2->min);
-
-	POSTGIS_DEBUGF(3, "interval min = %8.3f, max = %8.3f", interval->min, interval->max);
-
-	return interval;
-}
-
-/**
-* Creates an interval given the min and max values, in arbitrary order.
-*/
-static RTREE_INTERVAL*
-RTreeCreateInterval(double value1, double value2)
-{
-	RTREE_INTERVAL *interval;
-
-	POSTGIS_DEBUGF(2, "RTreeCreateInterval called with %8.3f, %8.3f", value1, value2);
-
-	interval = lwalloc(sizeof(RTREE_INTERVAL));
-	interval->max = FP_MAX(value1, value2);
-	interval->min = FP_MIN(value1, value2);
-
-	POSTGIS_DEBUGF(3, "interval min = %8.3f, max = %8.3f", interval->min, interval->max);
-
-	return interval;
-}
-
-/**
-* Creates an interior node given the children.
-*/
-static RTREE_NODE*
-RTreeCreateInteriorNode(RTREE_NODE* left, RTREE_NODE* right)
-{
-	RTREE_NODE *parent;
-
-	POSTGIS_DEBUGF(2, "RTreeCreateInteriorNode called for children %p, %p", left, right);
-
-	parent = lwalloc(sizeof(RTREE_NODE));
-	parent->leftNode = left;
-	parent->rightNode = right;
-	parent->interval = RTreeMergeIntervals(left->interval, right->interval);
-	parent->segment = NULL;
-
-	POSTGIS_DEBUGF(3, "RTreeCreateInteriorNode returning %p", parent);
-
-	return parent;
-}
-
-/**
-* Creates a leaf node given the pointer to the start point of the segment.
-*/
-static RTREE_NODE*
-RTreeCreateLeafNode(POINTARRAY* pa, int startPoint)
+static void
+RTreeCreate(RTREE_NODE* root, POINTARRAY* pointArray)
 {
-	RTREE_NODE *parent;
-	LWLINE *line;
-	double value1;
-	double value2;
-	POINT4D tmp;
-	POINTARRAY *npa;
+	int i, j, level;
+	int nodeCount = 0;
+	int n;
+	char *mem;
 
-	POSTGIS_DEBUGF(2, "RTreeCreateLeafNode called for point %d of %p", startPoint, pa);
+	POSTGIS_DEBUGF(2, "RTreeCreate called with pointarray %p", pointArray);
 
-	if (pa->npoints < startPoint + 2)
-	{
-		lwpgerror("RTreeCreateLeafNode: npoints = %d, startPoint = %d", pa->npoints, startPoint);
-	}
+	memset(root, 0, sizeof(RTREE_NODE));
+	root->nsegs = pointArray->npoints > 1 ? pointArray->npoints - 1 : 0;
 
 	/*
-	 * The given point array will be part of a geometry that will be freed
-	 * independently of the index.	Since we may want to cache the index,
-	 * we must create independent arrays.
+	 * Size the levels: the leaves, then one node per RTREE_NODE_SIZE
+	 * nodes of the level below, until we have a single top node.
 	 */
-	npa = ptarray_construct_empty(0,0,2);
-
-	getPoint4d_p(pa, startPoint, &tmp);
-	value1 = tmp.y;
-	ptarray_append_point(npa,&tmp,LW_TRUE);
-
-	getPoint4d_p(pa, startPoint+1, &tmp);
-	value2 = tmp.y;
-	ptarray_append_point(npa,&tmp,LW_TRUE);
-
-	line = lwline_construct(SRID_UNKNOWN, NULL, npa);
-
-	parent = lwalloc(sizeof(RTREE_NODE));
-	parent->interval = RTreeCreateInterval(value1, value2);
-	parent->segment = line;
-	parent->leftNode = NULL;
-	parent->rightNode = NULL;
-
-	POSTGIS_DEBUGF(3, "RTreeCreateLeafNode returning %p", parent);
-
-	return parent;
-}
+	n = root->nsegs;
+	while (n > 0)
+	{
+		root->offsets[root->nlevels] = nodeCount;
+		root->counts[root->nlevels] = n;
+		root->nlevels++;
+		nodeCount += n;
+		if (n == 1)
+			break;
+		n = (n + RTREE_NODE_SIZE - 1) / RTREE_NODE_SIZE;
+	}
 
-/**
-* Creates an rtree given a pointer to the point array.
-* Must copy the point array.
-*/
-static RTREE_NODE*
-RTreeCreate(POINTARRAY* pointArray)
-{
-	RTREE_NODE* root;
-	RTREE_NODE** nodes = lwalloc(pointArray->npoints * sizeof(RTREE_NODE*));
-	int i, nodeCount;
-	int childNodes, parentNodes;
+	POSTGIS_DEBUGF(3, "Total leaf nodes: %d, levels: %d, nodes: %d", root->nsegs, root->nlevels, nodeCount);
 
-	POSTGIS_DEBUGF(2, "RTreeCreate called with pointarray %p", pointArray);
+	if (root->nsegs == 0)
+		return;
 
-	nodeCount = pointArray->npoints - 1;
+	mem = lwalloc(sizeof(POINT2D) * pointArray->npoints + sizeof(RTREE_INTERVAL) * nodeCount);
+	root->points = (POINT2D*)mem;
+	root->nodes = (RTREE_INTERVAL*)(mem + sizeof(POINT2D) * pointArray->npoints);
 
-	POSTGIS_DEBUGF(3, "Total leaf nodes: %d", nodeCount);
+	for (i = 0; i < pointArray->npoints; i++)
+		root->points[i] = *getPoint2d_cp(pointArray, i);
 
-	/*
-	 * Create a leaf node for every line segment.
-	 */
-	for (i = 0; i < nodeCount; i++)
+	/* One leaf for every line segment */
+	for (i = 0; i < root->nsegs; i++)
 	{
-		nodes[i] = RTreeCreateLeafNode(pointArray, i);
+		root->nodes[i].min = FP_MIN(root->points[i].y, root->points[i+1].y);
+		root->nodes[i].max = FP_MAX(root->points[i].y, root->points[i+1].y);
 	}
 
-	/*
-	 * Next we group nodes by pairs.  If there's an odd number of nodes,
-	 * we bring the last node up a level as is.	 Continue until we have
-	 * a single top node.
-	 */
-	childNodes = nodeCount;
-	parentNodes = nodeCount / 2;
-	while (parentNodes > 0)
+	/* Each interior node spans the intervals of its children */
+	for (level = 1; level < root->nlevels; level++)
 	{
-		POSTGIS_DEBUGF(3, "Merging %d children into %d parents.", childNodes, parentNodes);
+		RTREE_INTERVAL *parents = root->nodes + root->offsets[level];
+		RTREE_INTERVAL *children = root->nodes + root->offsets[level-1];
+		int childCount = root->counts[level-1];
 
-		i = 0;
-		while (i < parentNodes)
-		{
-			nodes[i] = RTreeCreateInteriorNode(nodes[i*2], nodes[i*2+1]);
-			i++;
-		}
-		/*
-		 * Check for an odd numbered final node.
-		 */
-		if (parentNodes * 2 < childNodes)
+		for (i = 0; i < root->counts[level]; i++)
 		{
-			POSTGIS_DEBUGF(3, "Shuffling child %d to parent %d", childNodes - 1, i);
+			int first = i * RTREE_NODE_SIZE;
+			int last = first + RTREE_NODE_SIZE < childCount ? first + RTREE_NODE_SIZE : childCount;
 
-			nodes[i] = nodes[childNodes - 1];
-			parentNodes++;
+			parents[i] = children[first];
+			for (j = first + 1; j < last; j++)
+			{
+				parents[i].min = FP_MIN(parents[i].min, children[j].min);
+				parents[i].max = FP_MAX(parents[i].max, children[j].max);
+			}
 		}
-		childNodes = parentNodes;
-		parentNodes = parentNodes / 2;
 	}
 
-	root = nodes[0];
-	lwfree(nodes);
-	POSTGIS_DEBUGF(3, "RTreeCreate returning %p", root);
-
-	return root;
-}
-
-
-/**
-* Merges two multilinestrings into a single multilinestring.
-*/
-static LWMLINE*
-RTreeMergeMultiLines(LWMLINE *line1, LWMLINE *line2)
-{
-	LWGEOM **geoms;
-	LWCOLLECTION *col;
-	int i, j, ngeoms;
-
-	POSTGIS_DEBUGF(2, "RTreeMergeMultiLines called on %p, %d, %d; %p, %d, %d", line1, line1->ngeoms, line1->type, line2, line2->ngeoms, line2->type);
-
-	ngeoms = line1->ngeoms + line2->ngeoms;
-	geoms = lwalloc(sizeof(LWGEOM *) * ngeoms);
-
-	j = 0;
-	for (i = 0; i < line1->ngeoms; i++, j++)
-	{
-		geoms[j] = lwgeom_clone((LWGEOM *)line1->geoms[i]);
-	}
-	for (i = 0; i < line2->ngeoms; i++, j++)
-	{
-		geoms[j] = lwgeom_clone((LWGEOM *)line2->geoms[i]);
-	}
-	col = lwcollection_construct(MULTILINETYPE, SRID_UNKNOWN, NULL, ngeoms, geoms);
-
-	POSTGIS_DEBUGF(3, "RTreeMergeMultiLines returning %p, %d, %d", col, col->ngeoms, col->type);
-
-	return (LWMLINE *)col;
+	POSTGIS_DEBUGF(3, "RTreeCreate built %p, y range %8.3f to %8.3f", root,
+	               root->nodes[nodeCount-1].min, root->nodes[nodeCount-1].max);
 }
 
 
@@ -347,7 +208,7 @@ RTreeBuilder(const LWGEOM* lwgeom, GeomCache* cache)
 			currentCache->ringCounts[i] = mpoly->geoms[i]->nrings;
 			nrings += mpoly->geoms[i]->nrings;
 		}
-		currentCache->ringIndices = lwalloc(sizeof(RTREE_NODE *) * nrings);
+		currentCache->ringIndices = lwalloc(sizeof(RTREE_NODE) * nrings);
 		/*
 		** Load the array in geometry order, each outer ring followed by the inner rings
                 ** associated with that outer ring
@@ -357,7 +218,7 @@ RTreeBuilder(const LWGEOM* lwgeom, GeomCache* cache)
 		{
 			for ( r = 0; r < mpoly->geoms[p]->nrings; r++ )
 			{
-				currentCache->ringIndices[i] = RTreeCreate(mpoly->geoms[p]->rings[r]);
+				RTreeCreate(&(currentCache->ringIndices[i]), mpoly->geoms[p]->rings[r]);
 				i++;
 			}
 		}
@@ -374,10 +235,10 @@ RTreeBuilder(const LWGEOM* lwgeom, GeomCache* cache)
 		/*
 		** Just load the rings on in order
 		*/
-		currentCache->ringIndices = lwalloc(sizeof(RTREE_NODE *) * poly->nrings);
+		currentCache->ringIndices = lwalloc(sizeof(RTREE_NODE) * poly->nrings);
 		for ( i = 0; i < poly->nrings; i++ )
 		{
-			currentCache->ringIndices[i] = RTreeCreate(poly->rings[i]);
+			RTreeCreate(&(currentCache->ringIndices[i]), poly->rings[i]);
 		}
 		rtree_cache->index = currentCache;
 	}
@@ -440,78 +301,3 @@ GetRtreeCache(FunctionCallInfoData* fcinfo, GSERIALIZED* g1)
 	return index;
 }
 
-
-/**
-* Retrieves a collection of line segments given the root and crossing value.
-* The collection is a multilinestring consisting of two point lines
-* representing the segments of the ring that may be crossed by the
-* horizontal projection line at the given y value.
-*/
-LWMLINE *RTreeFindLineSegments(RTREE_NODE *root, double value)
-{
-	LWMLINE *tmp, *result;
-	LWGEOM **lwgeoms;
-
-	POSTGIS_DEBUGF(2, "RTreeFindLineSegments called for tree %p and value %8.3f", root, value);
-
-	result = NULL;
-
-	if (!IntervalIsContained(root->interval, value))
-	{
-		POSTGIS_DEBUGF(3, "RTreeFindLineSegments %p: not contained.", root);
-
-		return NULL;
-	}
-
-	/* If there is a segment defined for this node, include it. */
-	if (root->segment)
-	{
-		POSTGIS_DEBUGF(3, "RTreeFindLineSegments %p: adding segment %p %d.", root, root->segment, root->segment->type);
-
-		lwgeoms = lwalloc(sizeof(LWGEOM *));
-		lwgeoms[0] = (LWGEOM *)root->segment;
-
-		POSTGIS_DEBUGF(3, "Found geom %p, type %d, dim %d", root->segment, root->segment->type, FLAGS_GET_Z(root->segment->flags));
-
-		result = (LWMLINE *)lwcollection_construct(MULTILINETYPE, SRID_UNKNOWN, NULL, 1, lwgeoms);
-	}
-
-	/* If there is a left child node, recursively include its results. */
-	if (root->leftNode)
-	{
-		POSTGIS_DEBUGF(3, "RTreeFindLineSegments %p: recursing left.", root);
-
-		tmp = RTreeFindLineSegments(root->leftNode, value);
-		if (tmp)
-		{
-			POSTGIS_DEBUGF(3, "Found geom %p, type %d, dim %d", tmp, tmp->type, FLAGS_GET_Z(tmp->flags));
-
-			if (result)
-				result = RTreeMergeMultiLines(result, tmp);
-			else
-				result = tmp;
-		}
-	}
-
-	/* Same for any right child. */
-	if (root->rightNode)
-	{
-		POSTGIS_DEBUGF(3, "RTreeFindLineSegments %p: recursing right.", root);
-
-		tmp = RTreeFindLineSegments(root->rightNode, value);
-		if (tmp)
-		{
-			POSTGIS_DEBUGF(3, "Found geom %p, type %d, dim %d", tmp, tmp->type, FLAGS_GET_Z(tmp->flags));
-
-			if (result)
-				result = RTreeMergeMultiLines(result, tmp);
-			else
-				result = tmp;
-		}
-	}
-
-	return result;
-}
-
-
-
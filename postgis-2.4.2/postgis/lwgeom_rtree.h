@@ -37,17 +37,31 @@ typedef struct
 }
 RTREE_INTERVAL;
 
+/** Number of children of each interior node of a ring index */
+#define RTREE_NODE_SIZE 8
+
+/** Enough levels for any ring with RTREE_NODE_SIZE fan-out */
+#define RTREE_MAX_LEVELS 16
+
 /**
-* The following struct and methods are used for a 1D RTree implementation,
-* described at:
+* The following struct and methods are used for a packed 1D RTree
+* over the y-ranges of the segments of a ring, as described at:
 *  http://lin-ear-th-inking.blogspot.com/2007/06/packed-1-dimensional-r-tree.html
+*
+* Level 0 holds one interval per segment, in ring order, and every level
+* above holds one interval per RTREE_NODE_SIZE nodes of the level below,
+* up to a single root. All levels live in one array, next to a copy of
+* the ring vertices, so a query walks the tree and tests the segments
+* it reaches without any further allocation.
 */
-typedef struct rtree_node
+typedef struct
 {
-	RTREE_INTERVAL *interval;
-	struct rtree_node *leftNode;
-	struct rtree_node *rightNode;
-	LWLINE *segment;
+	POINT2D *points;                  /* ring vertices, nsegs + 1 of them */
+	RTREE_INTERVAL *nodes;            /* all the levels, leaves first */
+	int nsegs;
+	int nlevels;
+	int offsets[RTREE_MAX_LEVELS];    /* first node of each level */
+	int counts[RTREE_MAX_LEVELS];     /* number of nodes in each level */
 }
 RTREE_NODE;
 
@@ -56,7 +70,7 @@ RTREE_NODE;
 */
 typedef struct
 {
-	RTREE_NODE **ringIndices;
+	RTREE_NODE *ringIndices;
 	int* ringCounts;
 	int polyCount;
 }
@@ -75,12 +89,6 @@ typedef struct {
 } RTreeGeomCache;
 
 
-/**
-* Retrieves a collection of line segments given the root and crossing value.
-*/
-LWMLINE *RTreeFindLineSegments(RTREE_NODE *root, double value);
-
-
 /**
 * Checks for a cache hit against the provided geometry and returns
 * a pre-built index structure (RTREE_POLY_CACHE) if one exists. Otherwise
@@ -33,6 +33,7 @@
 extern "C" Datum transform(PG_FUNCTION_ARGS);
 extern "C" Datum transform_geom(PG_FUNCTION_ARGS);
 extern "C" Datum postgis_proj_version(PG_FUNCTION_ARGS);
+extern "C" Datum postgis_srs_cache_invalidate(PG_FUNCTION_ARGS);
 
 
 
@@ -205,3 +206,21 @@ Datum postgis_proj_version(PG_FUNCTION_ARGS)
 	text *result = cstring2text(ver);
 	PG_RETURN_POINTER(result);
 }
+
+/**
+ * Statement trigger on spatial_ref_sys. Plain DML does not invalidate
+ * the relation, so do it here: every backend then drops the SRID
+ * definitions and projections it has cached (see libpgcommon).
+ */
+PG_FUNCTION_INFO_V1(postgis_srs_cache_invalidate);
+Datum postgis_srs_cache_invalidate(PG_FUNCTION_ARGS)
+{
+	TriggerData *trigdata = (TriggerData *) fcinfo->context;
+
+	if ( ! CALLED_AS_TRIGGER(fcinfo) )
+		elog(ERROR, "postgis_srs_cache_invalidate: not fired by trigger manager");
+
+	CacheInvalidateRelcache(trigdata->tg_relation);
+
+	return PointerGetDatum(NULL);
+}
@@ -6,6 +6,7 @@
 
 #include "liblwgeom.h"         /* For standard geometry types. */
 #include "lwgeom_pg.h"       /* For debugging macros. */
+#include "gserialized_gist.h" /* For BOX2DF. */
 
 #include <assert.h>
 #include <math.h>
@@ -17,4 +18,21 @@
 #define INCLUSION_UNMERGEABLE		1
 #define INCLUSION_CONTAINS_EMPTY	2
 
+/*
+ * Multi-box summaries of the brin_geometry_multibox_ops_2d opclass: a
+ * bytea holding up to BRIN_MULTIBOX_MAX_BOXES boxes per block range.
+ */
+#define BRIN_MULTIBOX_MAX_BOXES			8
+#define BRIN_MULTIBOX_CONTAINS_EMPTY	0x01
+
+typedef struct
+{
+	int32		vl_len_;	/* varlena header (do not touch directly!) */
+	uint16		nboxes;
+	uint16		flags;
+	BOX2DF		boxes[1];	/* nboxes of them */
+} BRIN_MULTIBOX;
+
+#define BRIN_MULTIBOX_SIZE(n) (offsetof(BRIN_MULTIBOX, boxes) + (n) * sizeof(BOX2DF))
+
 bool is_gserialized_from_datum_empty(Datum the_datum);
@@ -183,3 +183,21 @@ IF _postgis_scripts_pgsql_version()::integer >= 96 THEN
 END IF;
 END;
 $$;
+
+-- Triggers aren't carried by the upgrade of functions, so backends of
+-- upgraded databases would never hear of spatial_ref_sys changes
+DO language 'plpgsql'
+$$
+BEGIN
+IF NOT EXISTS ( SELECT 1 FROM pg_catalog.pg_trigger
+		WHERE tgrelid = 'spatial_ref_sys'::regclass
+		AND tgname = 'spatial_ref_sys_cache_invalidate' )
+	AND EXISTS ( SELECT 1 FROM pg_catalog.pg_proc
+		WHERE proname = 'postgis_srs_cache_invalidate' )
+THEN
+	CREATE TRIGGER spatial_ref_sys_cache_invalidate
+		AFTER INSERT OR UPDATE OR DELETE ON spatial_ref_sys
+		FOR EACH STATEMENT EXECUTE PROCEDURE postgis_srs_cache_invalidate();
+END IF;
+END;
+$$;
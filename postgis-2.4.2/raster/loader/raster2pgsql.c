@@ -29,6 +29,8 @@
 #include "gdal_vrt.h"
 #include "ogr_srs_api.h"
 #include <assert.h>
+#include <errno.h>
+#include <pthread.h>
 
 static void
 loader_rt_error_handler(const char *fmt, va_list ap) {
@@ -440,6 +442,15 @@ usage() {
 	printf(_(
 		"  -Y  Use COPY statements instead of INSERT statements.\n"
 	));
+	printf(_(
+		"  -B <filename> Write the tiles to <filename> in binary COPY format\n"
+		"      and load them with \\copy. Overview tiles are written to\n"
+		"      <filename>.o_<overview factor>. Cannot be used with -Y or\n"
+		"      -s FROM_SRID:TO_SRID.\n"
+	));
+	printf(_(
+		"  -j <threads> Number of threads tiling rasters for -B (default 1).\n"
+	));
 	printf(_(
 		"  -G  Print the supported GDAL raster formats.\n"
 	));
@@ -723,6 +734,8 @@ init_config(RTLOADERCFG *config) {
 	config->version = 0;
 	config->transaction = 1;
 	config->copy_statements = 0;
+	config->copy_binary_file = NULL;
+	config->num_threads = 1;
 }
 
 static void
@@ -761,6 +774,8 @@ rtdealloc_config(RTLOADERCFG *config) {
 		rtdealloc(config->tablespace);
 	if (config->idx_tablespace != NULL)
 		rtdealloc(config->idx_tablespace);
+	if (config->copy_binary_file != NULL)
+		rtdealloc(config->copy_binary_file);
 
 	rtdealloc(config);
 }
@@ -1560,46 +1575,76 @@ build_overview(int idx, RTLOADERCFG *config, RASTERINFO *info, int ovx, STRINGBU
 	return 1;
 }
 
+/* create an out-db tile of raster idx with its upper-left corner at gt */
+static rt_raster
+build_outdb_tile(int idx, RTLOADERCFG *config, RASTERINFO *info, int width, int height, double *gt) {
+	rt_raster rast = NULL;
+	rt_band band = NULL;
+	int i = 0;
+
+	/* create raster object */
+	rast = rt_raster_new(width, height);
+	if (rast == NULL) {
+		rterror(_("build_outdb_tile: Could not create raster"));
+		return NULL;
+	}
+
+	/* set raster attributes */
+	rt_raster_set_srid(rast, info->srid);
+	rt_raster_set_geotransform_matrix(rast, gt);
+
+	/* add bands */
+	for (i = 0; i < info->nband_count; i++) {
+		band = rt_band_new_offline(
+			width, height,
+			info->bandtype[i],
+			info->hasnodata[i], info->nodataval[i],
+			info->nband[i] - 1,
+			config->rt_file[idx]
+		);
+		if (band == NULL) {
+			rterror(_("build_outdb_tile: Could not create offline band"));
+			raster_destroy(rast);
+			return NULL;
+		}
+
+		/* add band to raster */
+		if (rt_raster_add_band(rast, band, rt_raster_get_num_bands(rast)) == -1) {
+			rterror(_("build_outdb_tile: Could not add offlineband to raster"));
+			rt_band_destroy(band);
+			raster_destroy(rast);
+			return NULL;
+		}
+
+		/* inspect each band of raster where band is NODATA */
+		if (!config->skip_nodataval_check)
+			rt_band_check_is_nodata(band);
+	}
+
+	return rast;
+}
+
+/* record the attributes of raster idx, opened as hdsSrc, in info */
 static int
-convert_raster(int idx, RTLOADERCFG *config, RASTERINFO *info, STRINGBUFFER *tileset, STRINGBUFFER *buffer) {
-	GDALDatasetH hdsSrc;
+read_rastinfo(int idx, RTLOADERCFG *config, RASTERINFO *info, GDALDatasetH hdsSrc) {
 	GDALRasterBandH hbandSrc;
 	int nband = 0;
 	int i = 0;
-	int ntiles[2] = {1, 1};
-	int _tile_size[2] = {0, 0};
-	int xtile = 0;
-	int ytile = 0;
-	double gt[6] = {0.};
 	const char* pszProjectionRef = NULL;
 	int tilesize = 0;
 
-	rt_raster rast = NULL;
-	int numbands = 0;
-	rt_band band = NULL;
-	char *hex;
-	uint32_t hexlen = 0;
-
 	info->srid = config->srid;
 
-	hdsSrc = GDALOpenShared(config->rt_file[idx], GA_ReadOnly);
-	if (hdsSrc == NULL) {
-		rterror(_("convert_raster: Could not open raster: %s"), config->rt_file[idx]);
-		return 0;
-	}
-
 	nband = GDALGetRasterCount(hdsSrc);
 	if (!nband) {
-		rterror(_("convert_raster: No bands found in raster: %s"), config->rt_file[idx]);
-		GDALClose(hdsSrc);
+		rterror(_("read_rastinfo: No bands found in raster: %s"), config->rt_file[idx]);
 		return 0;
 	}
 
 	/* check that bands specified are available */
 	for (i = 0; i < config->nband_count; i++) {
 		if (config->nband[i] > nband) {
-			rterror(_("convert_raster: Band %d not found in raster: %s"), config->nband[i], config->rt_file[idx]);
-			GDALClose(hdsSrc);
+			rterror(_("read_rastinfo: Band %d not found in raster: %s"), config->nband[i], config->rt_file[idx]);
 			return 0;
 		}
 	}
@@ -1609,8 +1654,7 @@ convert_raster(int idx, RTLOADERCFG *config, RASTERINFO *info, STRINGBUFFER *til
 	if (pszProjectionRef != NULL && pszProjectionRef[0] != '\0') {
 		info->srs = rtalloc(sizeof(char) * (strlen(pszProjectionRef) + 1));
 		if (info->srs == NULL) {
-			rterror(_("convert_raster: Could not allocate memory for storing SRS"));
-			GDALClose(hdsSrc);
+			rterror(_("read_rastinfo: Could not allocate memory for storing SRS"));
 			return 0;
 		}
 		strcpy(info->srs, pszProjectionRef);
@@ -1633,8 +1677,7 @@ convert_raster(int idx, RTLOADERCFG *config, RASTERINFO *info, STRINGBUFFER *til
 	}
 
 	if ( info->srid == SRID_UNKNOWN && config->out_srid != SRID_UNKNOWN ) {
-		  rterror(_("convert_raster: could not determine source srid, cannot transform to target srid %d"), config->out_srid);
-		  GDALClose(hdsSrc);
+		  rterror(_("read_rastinfo: could not determine source srid, cannot transform to target srid %d"), config->out_srid);
 		  return 0;
 	}
 
@@ -1648,7 +1691,6 @@ convert_raster(int idx, RTLOADERCFG *config, RASTERINFO *info, STRINGBUFFER *til
 		info->gt[4] = 0;
 		info->gt[5] = -1;
 	}
-	memcpy(gt, info->gt, sizeof(double) * 6);
 
 	/* record # of bands */
 	/* user-specified bands */
@@ -1656,8 +1698,7 @@ convert_raster(int idx, RTLOADERCFG *config, RASTERINFO *info, STRINGBUFFER *til
 		info->nband_count = config->nband_count;
 		info->nband = rtalloc(sizeof(int) * info->nband_count);
 		if (info->nband == NULL) {
-			rterror(_("convert_raster: Could not allocate memory for storing band indices"));
-			GDALClose(hdsSrc);
+			rterror(_("read_rastinfo: Could not allocate memory for storing band indices"));
 			return 0;
 		}
 		memcpy(info->nband, config->nband, sizeof(int) * info->nband_count);
@@ -1667,8 +1708,7 @@ convert_raster(int idx, RTLOADERCFG *config, RASTERINFO *info, STRINGBUFFER *til
 		info->nband_count = nband;
 		info->nband = rtalloc(sizeof(int) * info->nband_count);
 		if (info->nband == NULL) {
-			rterror(_("convert_raster: Could not allocate memory for storing band indices"));
-			GDALClose(hdsSrc);
+			rterror(_("read_rastinfo: Could not allocate memory for storing band indices"));
 			return 0;
 		}
 		for (i = 0; i < info->nband_count; i++)
@@ -1678,26 +1718,22 @@ convert_raster(int idx, RTLOADERCFG *config, RASTERINFO *info, STRINGBUFFER *til
 	/* initialize parameters dependent on nband */
 	info->gdalbandtype = rtalloc(sizeof(GDALDataType) * info->nband_count);
 	if (info->gdalbandtype == NULL) {
-		rterror(_("convert_raster: Could not allocate memory for storing GDAL data type"));
-		GDALClose(hdsSrc);
+		rterror(_("read_rastinfo: Could not allocate memory for storing GDAL data type"));
 		return 0;
 	}
 	info->bandtype = rtalloc(sizeof(rt_pixtype) * info->nband_count);
 	if (info->bandtype == NULL) {
-		rterror(_("convert_raster: Could not allocate memory for storing pixel type"));
-		GDALClose(hdsSrc);
+		rterror(_("read_rastinfo: Could not allocate memory for storing pixel type"));
 		return 0;
 	}
 	info->hasnodata = rtalloc(sizeof(int) * info->nband_count);
 	if (info->hasnodata == NULL) {
-		rterror(_("convert_raster: Could not allocate memory for storing hasnodata flag"));
-		GDALClose(hdsSrc);
+		rterror(_("read_rastinfo: Could not allocate memory for storing hasnodata flag"));
 		return 0;
 	}
 	info->nodataval = rtalloc(sizeof(double) * info->nband_count);
 	if (info->nodataval == NULL) {
-		rterror(_("convert_raster: Could not allocate memory for storing nodata value"));
-		GDALClose(hdsSrc);
+		rterror(_("read_rastinfo: Could not allocate memory for storing nodata value"));
 		return 0;
 	}
 	memset(info->gdalbandtype, GDT_Unknown, sizeof(GDALDataType) * info->nband_count);
@@ -1732,12 +1768,6 @@ convert_raster(int idx, RTLOADERCFG *config, RASTERINFO *info, STRINGBUFFER *til
 	else
 		info->tile_size[1] = config->tile_size[1];
 
-	/* number of tiles */
-	if (info->tile_size[0] != info->dim[0])
-		ntiles[0] = (info->dim[0] + info->tile_size[0]  - 1) / info->tile_size[0];
-	if (info->tile_size[1] != info->dim[1])
-		ntiles[1] = (info->dim[1] + info->tile_size[1]  - 1) / info->tile_size[1];
-
 	/* estimate size of 1 tile */
 	tilesize = info->tile_size[0] * info->tile_size[1];
 
@@ -1750,8 +1780,7 @@ convert_raster(int idx, RTLOADERCFG *config, RASTERINFO *info, STRINGBUFFER *til
 
 		/* complex data type? */
 		if (GDALDataTypeIsComplex(info->gdalbandtype[i])) {
-			rterror(_("convert_raster: The pixel type of band %d is a complex data type.  PostGIS raster does not support complex data types"), i + 1);
-			GDALClose(hdsSrc);
+			rterror(_("read_rastinfo: The pixel type of band %d is a complex data type.  PostGIS raster does not support complex data types"), i + 1);
 			return 0;
 		}
 
@@ -1779,6 +1808,43 @@ convert_raster(int idx, RTLOADERCFG *config, RASTERINFO *info, STRINGBUFFER *til
 	if (tilesize > MAXTILESIZE)
 		rtwarn(_("The size of each output tile may exceed 1 GB. Use -t to specify a reasonable tile size"));
 
+	return 1;
+}
+
+static int
+convert_raster(int idx, RTLOADERCFG *config, RASTERINFO *info, STRINGBUFFER *tileset, STRINGBUFFER *buffer) {
+	GDALDatasetH hdsSrc;
+	int i = 0;
+	int ntiles[2] = {1, 1};
+	int _tile_size[2] = {0, 0};
+	int xtile = 0;
+	int ytile = 0;
+	double gt[6] = {0.};
+
+	rt_raster rast = NULL;
+	int numbands = 0;
+	rt_band band = NULL;
+	char *hex;
+	uint32_t hexlen = 0;
+
+	hdsSrc = GDALOpenShared(config->rt_file[idx], GA_ReadOnly);
+	if (hdsSrc == NULL) {
+		rterror(_("convert_raster: Could not open raster: %s"), config->rt_file[idx]);
+		return 0;
+	}
+
+	if (!read_rastinfo(idx, config, info, hdsSrc)) {
+		GDALClose(hdsSrc);
+		return 0;
+	}
+	memcpy(gt, info->gt, sizeof(double) * 6);
+
+	/* number of tiles */
+	if (info->tile_size[0] != info->dim[0])
+		ntiles[0] = (info->dim[0] + info->tile_size[0]  - 1) / info->tile_size[0];
+	if (info->tile_size[1] != info->dim[1])
+		ntiles[1] = (info->dim[1] + info->tile_size[1]  - 1) / info->tile_size[1];
+
 	/* out-db raster */
 	if (config->outdb) {
 		GDALClose(hdsSrc);
@@ -1807,43 +1873,9 @@ convert_raster(int idx, RTLOADERCFG *config, RASTERINFO *info, STRINGBUFFER *til
 				);
 
 				/* create raster object */
-				rast = rt_raster_new(_tile_size[0], _tile_size[1]);
-				if (rast == NULL) {
-					rterror(_("convert_raster: Could not create raster"));
+				rast = build_outdb_tile(idx, config, info, _tile_size[0], _tile_size[1], gt);
+				if (rast == NULL)
 					return 0;
-				}
-
-				/* set raster attributes */
-				rt_raster_set_srid(rast, info->srid);
-				rt_raster_set_geotransform_matrix(rast, gt);
-
-				/* add bands */
-				for (i = 0; i < info->nband_count; i++) {
-					band = rt_band_new_offline(
-						_tile_size[0], _tile_size[1],
-						info->bandtype[i],
-						info->hasnodata[i], info->nodataval[i],
-						info->nband[i] - 1,
-						config->rt_file[idx]
-					);
-					if (band == NULL) {
-						rterror(_("convert_raster: Could not create offline band"));
-						raster_destroy(rast);
-						return 0;
-					}
-
-					/* add band to raster */
-					if (rt_raster_add_band(rast, band, rt_raster_get_num_bands(rast)) == -1) {
-						rterror(_("convert_raster: Could not add offlineband to raster"));
-						rt_band_destroy(band);
-						raster_destroy(rast);
-						return 0;
-					}
-
-					/* inspect each band of raster where band is NODATA */
-					if (!config->skip_nodataval_check)
-						rt_band_check_is_nodata(band);
-				}
 
 				/* convert rt_raster to hexwkb */
 				hex = rt_raster_to_hexwkb(rast, FALSE, &hexlen);
@@ -2000,137 +2032,1099 @@ convert_raster(int idx, RTLOADERCFG *config, RASTERINFO *info, STRINGBUFFER *til
 	return 1;
 }
 
+/******************************************************************************
+* binary COPY output
+******************************************************************************/
+
+/* signature of a binary COPY file, followed by flags and header extension length */
+static const char copy_binary_signature[11] = "PGCOPY\n\377\r\n\0";
+
+static void
+init_copybuffer(COPYBUFFER *buffer) {
+	buffer->length = 0;
+	buffer->size = 0;
+	buffer->data = NULL;
+}
+
+static void
+rtdealloc_copybuffer(COPYBUFFER *buffer) {
+	if (buffer->data != NULL)
+		rtdealloc(buffer->data);
+	init_copybuffer(buffer);
+}
+
 static int
-process_rasters(RTLOADERCFG *config, STRINGBUFFER *buffer) {
-	int i = 0;
+append_copybuffer(COPYBUFFER *buffer, const void *bytes, size_t len) {
+	if (buffer->length + len > buffer->size) {
+		size_t size = buffer->size ? buffer->size : 4096;
+		uint8_t *data = NULL;
 
-	assert(config != NULL);
-	assert(config->table != NULL);
-	assert(config->raster_column != NULL);
+		while (size < buffer->length + len)
+			size *= 2;
 
-	if (config->transaction) {
-		if (!append_sql_to_buffer(buffer, strdup("BEGIN;"))) {
-			rterror(_("process_rasters: Could not add BEGIN statement to string buffer"));
+		data = rtrealloc(buffer->data, size);
+		if (data == NULL) {
+			rterror(_("append_copybuffer: Could not allocate memory for binary COPY data"));
 			return 0;
 		}
+		buffer->data = data;
+		buffer->size = size;
 	}
 
-	/* drop table */
-	if (config->opt == 'd') {
-		if (!drop_table(config->schema, config->table, buffer)) {
-			rterror(_("process_rasters: Could not add DROP TABLE statement to string buffer"));
-			return 0;
-		}
+	memcpy(buffer->data + buffer->length, bytes, len);
+	buffer->length += len;
 
-		if (config->overview_count) {
-			for (i = 0; i < config->overview_count; i++) {
-				if (!drop_table(config->schema, config->overview_table[i], buffer)) {
-					rterror(_("process_rasters: Could not add an overview's DROP TABLE statement to string buffer"));
-					return 0;
-				}
-			}
-		}
-	}
+	return 1;
+}
 
-	/* create table */
-	if (config->opt != 'a') {
-		if (!create_table(
-			config->schema, config->table, config->raster_column,
-			config->file_column, config->file_column_name,
-			config->tablespace, config->idx_tablespace,
-			buffer
-		)) {
-			rterror(_("process_rasters: Could not add CREATE TABLE statement to string buffer"));
-			return 0;
-		}
+/* network byte order */
+static int
+append_copybuffer_int16(COPYBUFFER *buffer, int16_t val) {
+	uint8_t b[2];
 
-		if (config->overview_count) {
-			for (i = 0; i < config->overview_count; i++) {
-				if (!create_table(
-					config->schema, config->overview_table[i], config->raster_column,
-					config->file_column, config->file_column_name,
-					config->tablespace, config->idx_tablespace,
-					buffer
-				)) {
-					rterror(_("process_rasters: Could not add an overview's CREATE TABLE statement to string buffer"));
-					return 0;
-				}
-			}
-		}
-	}
+	b[0] = (uint8_t) ((uint16_t) val >> 8);
+	b[1] = (uint8_t) val;
 
-	/* no need to run if opt is 'p' */
-	if (config->opt != 'p') {
-		RASTERINFO refinfo;
-		init_rastinfo(&refinfo);
+	return append_copybuffer(buffer, b, 2);
+}
 
-		/* process each raster */
-		for (i = 0; i < config->rt_file_count; i++) {
-			RASTERINFO rastinfo;
-			STRINGBUFFER tileset;
+static int
+append_copybuffer_int32(COPYBUFFER *buffer, int32_t val) {
+	uint8_t b[4];
+	int i = 0;
 
-			fprintf(stderr, _("Processing %d/%d: %s\n"), i + 1, config->rt_file_count, config->rt_file[i]);
+	for (i = 0; i < 4; i++)
+		b[i] = (uint8_t) ((uint32_t) val >> (24 - 8 * i));
 
-			init_rastinfo(&rastinfo);
-			init_stringbuffer(&tileset);
+	return append_copybuffer(buffer, b, 4);
+}
 
-			/* convert raster */
-			if (!convert_raster(i, config, &rastinfo, &tileset, buffer)) {
-				rterror(_("process_rasters: Could not process raster: %s"), config->rt_file[i]);
-				rtdealloc_rastinfo(&rastinfo);
-				rtdealloc_stringbuffer(&tileset, 0);
-				return 0;
-			}
+/* append one row holding the raster as WKB and optionally its filename */
+static int
+append_copy_row(COPYBUFFER *buffer, rt_raster rast, const char *filename) {
+	uint8_t *wkb = NULL;
+	uint32_t wkblen = 0;
+	int rtn = 0;
+
+	wkb = rt_raster_to_wkb(rast, FALSE, &wkblen);
+	if (wkb == NULL) {
+		rterror(_("append_copy_row: Could not convert PostGIS raster to WKB"));
+		return 0;
+	}
 
-			/* process raster tiles into COPY or INSERT statements */
-			if (tileset.length && !insert_records(
-				config->schema, config->table, config->raster_column,
-				(config->file_column ? config->rt_filename[i] : NULL),
-        config->file_column_name,
-				config->copy_statements, config->out_srid,
-				&tileset, buffer
-			)) {
-				rterror(_("process_rasters: Could not convert raster tiles into INSERT or COPY statements"));
-				rtdealloc_rastinfo(&rastinfo);
-				rtdealloc_stringbuffer(&tileset, 0);
-				return 0;
-			}
+	rtn = (
+		append_copybuffer_int16(buffer, filename != NULL ? 2 : 1) &&
+		append_copybuffer_int32(buffer, wkblen) &&
+		append_copybuffer(buffer, wkb, wkblen)
+	);
+	rtdealloc(wkb);
 
-			rtdealloc_stringbuffer(&tileset, 0);
+	if (rtn && filename != NULL) {
+		rtn = (
+			append_copybuffer_int32(buffer, strlen(filename)) &&
+			append_copybuffer(buffer, filename, strlen(filename))
+		);
+	}
 
-			/* flush buffer after every raster */
-			flush_stringbuffer(buffer);
+	return rtn;
+}
 
-			/* overviews */
-			if (config->overview_count) {
-				int j = 0;
+static int
+write_copybuffer(COPYBUFFER *buffer, FILE *fp) {
+	if (buffer->length && fwrite(buffer->data, 1, buffer->length, fp) != buffer->length) {
+		rterror(_("write_copybuffer: Could not write binary COPY data: %s"), strerror(errno));
+		return 0;
+	}
+	buffer->length = 0;
 
-				for (j = 0; j < config->overview_count; j++) {
+	return 1;
+}
 
-					if (!build_overview(i, config, &rastinfo, j, &tileset, buffer)) {
-						rterror(_("process_rasters: Could not create overview of factor %d for raster %s"), config->overview[j], config->rt_file[i]);
-						rtdealloc_rastinfo(&rastinfo);
-						rtdealloc_stringbuffer(&tileset, 0);
-						return 0;
-					}
+static int
+copy_from_binary(const char *schema, const char *table, const char *column,
+	const char *file_column_name, const char *copyfile,
+	STRINGBUFFER *buffer
+) {
+	char *sql = NULL;
+	char *fn = NULL;
+	uint32_t len = 0;
 
-					if (tileset.length && !insert_records(
-						config->schema, config->overview_table[j], config->raster_column,
-						(config->file_column ? config->rt_filename[i] : NULL), config->file_column_name,
-						config->copy_statements, config->out_srid,
-						&tileset, buffer
-					)) {
-						rterror(_("process_rasters: Could not convert overview tiles into INSERT or COPY statements"));
-						rtdealloc_rastinfo(&rastinfo);
-						rtdealloc_stringbuffer(&tileset, 0);
-						return 0;
-					}
+	assert(table != NULL);
+	assert(column != NULL);
 
-					rtdealloc_stringbuffer(&tileset, 0);
+	/* escape single-quotes in filename */
+	fn = strreplace(copyfile, "'", "''", NULL);
 
-					/* flush buffer after every raster */
-					flush_stringbuffer(buffer);
-				}
+	len = strlen("\\copy  () FROM '' WITH BINARY") + 1;
+	if (schema != NULL)
+		len += strlen(schema);
+	len += strlen(table);
+	len += strlen(column);
+	if (file_column_name != NULL)
+		len += strlen(",") + strlen(file_column_name);
+	len += strlen(fn);
+
+	sql = rtalloc(sizeof(char) * len);
+	if (sql == NULL) {
+		rterror(_("copy_from_binary: Could not allocate memory for \\copy command"));
+		rtdealloc(fn);
+		return 0;
+	}
+	sprintf(sql, "\\copy %s%s (%s%s%s) FROM '%s' WITH BINARY",
+		(schema != NULL ? schema : ""),
+		table,
+		column,
+		(file_column_name != NULL ? "," : ""),
+		(file_column_name != NULL ? file_column_name : ""),
+		fn
+	);
+	rtdealloc(fn);
+
+	append_sql_to_buffer(buffer, sql);
+
+	return 1;
+}
+
+/*
+	write the trailers and close the binary COPY files.  The file names
+	are kept for the \copy commands unless there was an error
+*/
+static int
+close_copy_binary_files(int count, FILE **fp, char **file, int trailer) {
+	COPYBUFFER buffer;
+	int rtn = 1;
+	int i = 0;
+
+	init_copybuffer(&buffer);
+	for (i = 0; i < count; i++) {
+		if (fp[i] == NULL)
+			continue;
+
+		if (trailer && rtn) {
+			rtn = append_copybuffer_int16(&buffer, -1) && write_copybuffer(&buffer, fp[i]);
+		}
+
+		if (fclose(fp[i]) != 0 && rtn) {
+			rterror(_("close_copy_binary_files: Could not write %s: %s"), file[i], strerror(errno));
+			rtn = 0;
+		}
+	}
+	rtdealloc_copybuffer(&buffer);
+	rtdealloc(fp);
+
+	if (!trailer || !rtn) {
+		for (i = 1; i < count; i++) {
+			if (file[i] != NULL)
+				rtdealloc(file[i]);
+		}
+		rtdealloc(file);
+	}
+
+	return rtn;
+}
+
+/*
+	create the binary COPY files, config->copy_binary_file for the table and
+	<copy_binary_file>.o_<factor> for each overview, and write their headers
+*/
+static int
+open_copy_binary_files(RTLOADERCFG *config, FILE ***fp, char ***file) {
+	int count = 1 + config->overview_count;
+	COPYBUFFER header;
+	int i = 0;
+
+	*fp = rtalloc(sizeof(FILE *) * count);
+	*file = rtalloc(sizeof(char *) * count);
+	if (*fp == NULL || *file == NULL) {
+		rterror(_("open_copy_binary_files: Could not allocate memory for binary COPY files"));
+		return 0;
+	}
+	memset(*fp, 0, sizeof(FILE *) * count);
+	memset(*file, 0, sizeof(char *) * count);
+
+	(*file)[0] = config->copy_binary_file;
+	for (i = 1; i < count; i++) {
+		(*file)[i] = rtalloc(sizeof(char) * (strlen(config->copy_binary_file) + strlen(".o_") + 5));
+		if ((*file)[i] == NULL) {
+			rterror(_("open_copy_binary_files: Could not allocate memory for binary COPY files"));
+			close_copy_binary_files(count, *fp, *file, 0);
+			return 0;
+		}
+		sprintf((*file)[i], "%s.o_%d", config->copy_binary_file, config->overview[i - 1]);
+	}
+
+	for (i = 0; i < count; i++) {
+		(*fp)[i] = fopen((*file)[i], "wb");
+		if ((*fp)[i] == NULL) {
+			rterror(_("open_copy_binary_files: Could not open %s: %s"), (*file)[i], strerror(errno));
+			close_copy_binary_files(count, *fp, *file, 0);
+			return 0;
+		}
+
+		/* signature, flags and header extension length */
+		init_copybuffer(&header);
+		if (
+			!append_copybuffer(&header, copy_binary_signature, sizeof(copy_binary_signature)) ||
+			!append_copybuffer_int32(&header, 0) ||
+			!append_copybuffer_int32(&header, 0) ||
+			!write_copybuffer(&header, (*fp)[i])
+		) {
+			rtdealloc_copybuffer(&header);
+			close_copy_binary_files(count, *fp, *file, 0);
+			return 0;
+		}
+		rtdealloc_copybuffer(&header);
+	}
+
+	return 1;
+}
+
+/*
+	create an in-db tile of width x height pixels from the decoded rows of
+	each band, strip[band] holding striph rows of stripw pixels.  The tile's
+	upper-left pixel is column x0 of the strip.  Pixels past the strip are
+	padding and set to NODATA, or 0 without NODATA, as GDAL's VRT does
+*/
+static rt_raster
+build_tile(RASTERINFO *info, uint8_t **strip, int stripw, int striph, int x0, int width, int height, double *gt) {
+	rt_raster rast = NULL;
+	rt_band band = NULL;
+	uint8_t *mem = NULL;
+	int pixsize = 0;
+	int cols = 0;
+	int rows = 0;
+	int i = 0;
+	int x = 0;
+	int y = 0;
+
+	rast = rt_raster_new(width, height);
+	if (rast == NULL) {
+		rterror(_("build_tile: Could not create raster"));
+		return NULL;
+	}
+
+	rt_raster_set_srid(rast, info->srid);
+	rt_raster_set_geotransform_matrix(rast, gt);
+
+	cols = (stripw - x0 < width) ? stripw - x0 : width;
+	rows = (striph < height) ? striph : height;
+
+	for (i = 0; i < info->nband_count; i++) {
+		pixsize = rt_pixtype_size(info->bandtype[i]);
+
+		mem = rtalloc((size_t) pixsize * width * height);
+		if (mem == NULL) {
+			rterror(_("build_tile: Could not allocate memory for band"));
+			raster_destroy(rast);
+			return NULL;
+		}
+		if (cols < width || rows < height)
+			memset(mem, 0, (size_t) pixsize * width * height);
+
+		for (y = 0; y < rows; y++) {
+			memcpy(
+				mem + (size_t) y * width * pixsize,
+				strip[i] + ((size_t) y * stripw + x0) * pixsize,
+				(size_t) cols * pixsize
+			);
+		}
+
+		band = rt_band_new_inline(
+			width, height,
+			info->bandtype[i],
+			info->hasnodata[i], info->nodataval[i],
+			mem
+		);
+		if (band == NULL) {
+			rterror(_("build_tile: Could not create band"));
+			rtdealloc(mem);
+			raster_destroy(rast);
+			return NULL;
+		}
+		rt_band_set_ownsdata_flag(band, 1);
+
+		if (rt_raster_add_band(rast, band, rt_raster_get_num_bands(rast)) == -1) {
+			rterror(_("build_tile: Could not add band to raster"));
+			rt_band_destroy(band);
+			raster_destroy(rast);
+			return NULL;
+		}
+
+		/* padding is NODATA */
+		if (info->hasnodata[i] && FLT_NEQ(info->nodataval[i], 0.)) {
+			for (y = 0; y < height; y++) {
+				for (x = (y < rows ? cols : 0); x < width; x++)
+					rt_band_set_pixel(band, x, y, info->nodataval[i], NULL);
+			}
+		}
+	}
+
+	return rast;
+}
+
+/* a tile row being tiled, waiting for the writer */
+typedef struct {
+	/* tile row held, -1 when the slot is free */
+	int ytile;
+
+	/* set once the tiles are encoded */
+	int ready;
+
+	/* 1 if the tiles were encoded, 0 on error */
+	int status;
+
+	/* the encoded tiles */
+	COPYBUFFER rows;
+
+	/* decoded source rows y0 to y0 + striph of each band, kept for the overviews */
+	int y0;
+	int striph;
+	uint8_t **strip;
+} TILEROWSLOT;
+
+/* shared state of the tiling threads */
+typedef struct {
+	int idx;
+	RTLOADERCFG *config;
+	RASTERINFO *info;
+	int ntiles[2];
+
+	/* tile rows must be decoded for the overviews */
+	int decode;
+
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+
+	/* next tile row to hand out */
+	int next_ytile;
+
+	/* set when the writer gives up, so the workers stop */
+	int abort;
+
+	/* ring of tile rows; tile row y goes in slot y % num_slots */
+	int num_slots;
+	TILEROWSLOT *slots;
+} TILEPOOL;
+
+/* a tiling thread, with its own handle on the raster */
+typedef struct {
+	TILEPOOL *pool;
+	GDALDatasetH hdsSrc;
+	pthread_t thread;
+} TILEWORKER;
+
+static void
+init_tilerowslot(TILEROWSLOT *slot) {
+	slot->ytile = -1;
+	slot->ready = 0;
+	slot->status = 0;
+	init_copybuffer(&(slot->rows));
+	slot->y0 = 0;
+	slot->striph = 0;
+	slot->strip = NULL;
+}
+
+static void
+rtdealloc_tilerowstrip(TILEROWSLOT *slot, int nband_count) {
+	int i = 0;
+
+	if (slot->strip == NULL)
+		return;
+
+	for (i = 0; i < nband_count; i++) {
+		if (slot->strip[i] != NULL)
+			rtdealloc(slot->strip[i]);
+	}
+	rtdealloc(slot->strip);
+	slot->strip = NULL;
+}
+
+/* decode tile row ytile of the raster and encode its tiles into slot */
+static int
+encode_tile_row(TILEPOOL *pool, GDALDatasetH hdsSrc, int ytile, TILEROWSLOT *slot) {
+	RTLOADERCFG *config = pool->config;
+	RASTERINFO *info = pool->info;
+	int _tile_size[2] = {0, 0};
+	int xtile = 0;
+	double gt[6] = {0.};
+	int pixsize = 0;
+	int i = 0;
+
+	rt_raster rast = NULL;
+	rt_band band = NULL;
+	int numbands = 0;
+
+	memcpy(gt, info->gt, sizeof(double) * 6);
+
+	/* edge y tile */
+	if (!config->pad_tile && pool->ntiles[1] > 1 && (ytile + 1) == pool->ntiles[1])
+		_tile_size[1] = info->dim[1] - (ytile * info->tile_size[1]);
+	else
+		_tile_size[1] = info->tile_size[1];
+
+	/* source rows of the tile row, less any padding */
+	slot->y0 = ytile * info->tile_size[1];
+	slot->striph = info->dim[1] - slot->y0;
+	if (slot->striph > _tile_size[1])
+		slot->striph = _tile_size[1];
+
+	/* read the whole tile row of each band at once */
+	if (!config->outdb || pool->decode) {
+		slot->strip = rtalloc(sizeof(uint8_t *) * info->nband_count);
+		if (slot->strip == NULL) {
+			rterror(_("encode_tile_row: Could not allocate memory for tile row"));
+			return 0;
+		}
+		memset(slot->strip, 0, sizeof(uint8_t *) * info->nband_count);
+
+		for (i = 0; i < info->nband_count; i++) {
+			pixsize = rt_pixtype_size(info->bandtype[i]);
+
+			slot->strip[i] = rtalloc((size_t) pixsize * info->dim[0] * slot->striph);
+			if (slot->strip[i] == NULL) {
+				rterror(_("encode_tile_row: Could not allocate memory for tile row"));
+				return 0;
+			}
+
+			if (GDALRasterIO(
+				GDALGetRasterBand(hdsSrc, info->nband[i]), GF_Read,
+				0, slot->y0, info->dim[0], slot->striph,
+				slot->strip[i], info->dim[0], slot->striph,
+				rt_util_pixtype_to_gdal_datatype(info->bandtype[i]),
+				0, 0
+			) != CE_None) {
+				rterror(_("encode_tile_row: Could not read rows %d to %d of raster: %s"), slot->y0, slot->y0 + slot->striph - 1, config->rt_file[pool->idx]);
+				return 0;
+			}
+		}
+	}
+
+	for (xtile = 0; xtile < pool->ntiles[0]; xtile++) {
+
+		/* edge x tile */
+		if (!config->pad_tile && pool->ntiles[0] > 1 && (xtile + 1) == pool->ntiles[0])
+			_tile_size[0] = info->dim[0] - (xtile * info->tile_size[0]);
+		else
+			_tile_size[0] = info->tile_size[0];
+
+		/* compute tile's upper-left corner */
+		GDALApplyGeoTransform(
+			info->gt,
+			xtile * info->tile_size[0], ytile * info->tile_size[1],
+			&(gt[0]), &(gt[3])
+		);
+
+		/* out-db raster */
+		if (config->outdb)
+			rast = build_outdb_tile(pool->idx, config, info, _tile_size[0], _tile_size[1], gt);
+		/* in-db raster */
+		else {
+			rast = build_tile(
+				info, slot->strip, info->dim[0], slot->striph,
+				xtile * info->tile_size[0], _tile_size[0], _tile_size[1],
+				gt
+			);
+
+			/* inspect each band of raster where band is NODATA */
+			if (rast != NULL && !config->skip_nodataval_check) {
+				numbands = rt_raster_get_num_bands(rast);
+				for (i = 0; i < numbands; i++) {
+					band = rt_raster_get_band(rast, i);
+					if (band != NULL)
+						rt_band_check_is_nodata(band);
+				}
+			}
+		}
+		if (rast == NULL)
+			return 0;
+
+		if (!append_copy_row(&(slot->rows), rast, (config->file_column ? config->rt_filename[pool->idx] : NULL))) {
+			raster_destroy(rast);
+			return 0;
+		}
+		raster_destroy(rast);
+	}
+
+	if (!pool->decode)
+		rtdealloc_tilerowstrip(slot, info->nband_count);
+
+	return 1;
+}
+
+static void *
+tile_worker(void *arg) {
+	TILEWORKER *worker = (TILEWORKER *) arg;
+	TILEPOOL *pool = worker->pool;
+	TILEROWSLOT *slot = NULL;
+	int ytile = 0;
+	int status = 0;
+
+	pthread_mutex_lock(&(pool->lock));
+	while (!pool->abort && pool->next_ytile < pool->ntiles[1]) {
+		ytile = pool->next_ytile++;
+		slot = &(pool->slots[ytile % pool->num_slots]);
+
+		/* wait for the writer to drain the previous tile row held in the slot */
+		while (slot->ytile != -1 && !pool->abort)
+			pthread_cond_wait(&(pool->cond), &(pool->lock));
+		if (pool->abort)
+			break;
+
+		slot->ytile = ytile;
+		slot->ready = 0;
+		pthread_mutex_unlock(&(pool->lock));
+
+		status = encode_tile_row(pool, worker->hdsSrc, ytile, slot);
+
+		pthread_mutex_lock(&(pool->lock));
+		slot->status = status;
+		slot->ready = 1;
+		pthread_cond_broadcast(&(pool->cond));
+	}
+	pthread_mutex_unlock(&(pool->lock));
+
+	/* close the out-db datasets cached by this thread */
+	rt_band_outdb_cache_reset();
+
+	return NULL;
+}
+
+/* overview of the raster sampled from the decoded tile rows */
+typedef struct {
+	int dim[2];
+	int tile_size[2];
+	int ntiles[2];
+	double gt[6];
+
+	/* source column of each overview column */
+	int *srccol;
+
+	/* next overview row to sample, and the tile row it goes in */
+	int row;
+	int ytile;
+
+	/* rows of the tile row being sampled, for each band */
+	uint8_t **strip;
+
+	FILE *fp;
+	COPYBUFFER rows;
+} OVERVIEWSTATE;
+
+static void
+rtdealloc_overviewstate(OVERVIEWSTATE *ov, int nband_count) {
+	int i = 0;
+
+	if (ov->srccol != NULL)
+		rtdealloc(ov->srccol);
+	if (ov->strip != NULL) {
+		for (i = 0; i < nband_count; i++) {
+			if (ov->strip[i] != NULL)
+				rtdealloc(ov->strip[i]);
+		}
+		rtdealloc(ov->strip);
+	}
+	rtdealloc_copybuffer(&(ov->rows));
+}
+
+static int
+init_overviewstate(RTLOADERCFG *config, RASTERINFO *info, int ovx, FILE *fp, OVERVIEWSTATE *ov) {
+	int factor = 0;
+	int striph = 0;
+	int i = 0;
+
+	memset(ov, 0, sizeof(OVERVIEWSTATE));
+	init_copybuffer(&(ov->rows));
+	ov->fp = fp;
+
+	factor = config->overview[ovx];
+
+	/* factor must be within valid range */
+	if (factor < MINOVFACTOR || factor > MAXOVFACTOR) {
+		rterror(_("init_overviewstate: Overview factor %d is not between %d and %d"), factor, MINOVFACTOR, MAXOVFACTOR);
+		return 0;
+	}
+
+	ov->dim[0] = (int) (info->dim[0] + (factor / 2)) / factor;
+	ov->dim[1] = (int) (info->dim[1] + (factor / 2)) / factor;
+
+	/* adjust scale */
+	memcpy(ov->gt, info->gt, sizeof(double) * 6);
+	ov->gt[1] *= factor;
+	ov->gt[5] *= factor;
+
+	/* decide on tile size */
+	for (i = 0; i < 2; i++) {
+		if (!config->tile_size[i])
+			ov->tile_size[i] = ov->dim[i];
+		else
+			ov->tile_size[i] = config->tile_size[i];
+
+		ov->ntiles[i] = 1;
+		if (ov->tile_size[i] != ov->dim[i])
+			ov->ntiles[i] = (ov->dim[i] + ov->tile_size[i] - 1) / ov->tile_size[i];
+	}
+
+	/* nearest neighbor, sampled at the centers of the overview pixels */
+	ov->srccol = rtalloc(sizeof(int) * ov->dim[0]);
+	if (ov->srccol == NULL) {
+		rterror(_("init_overviewstate: Could not allocate memory for overview"));
+		return 0;
+	}
+	for (i = 0; i < ov->dim[0]; i++) {
+		ov->srccol[i] = (int) ((i + 0.5) * info->dim[0] / ov->dim[0]);
+		if (ov->srccol[i] >= info->dim[0])
+			ov->srccol[i] = info->dim[0] - 1;
+	}
+
+	striph = (ov->tile_size[1] < ov->dim[1]) ? ov->tile_size[1] : ov->dim[1];
+	ov->strip = rtalloc(sizeof(uint8_t *) * info->nband_count);
+	if (ov->strip == NULL) {
+		rterror(_("init_overviewstate: Could not allocate memory for overview"));
+		return 0;
+	}
+	memset(ov->strip, 0, sizeof(uint8_t *) * info->nband_count);
+	for (i = 0; i < info->nband_count; i++) {
+		ov->strip[i] = rtalloc((size_t) rt_pixtype_size(info->bandtype[i]) * ov->dim[0] * striph);
+		if (ov->strip[i] == NULL) {
+			rterror(_("init_overviewstate: Could not allocate memory for overview"));
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+/* encode and write the overview tile row that is completely sampled */
+static int
+flush_overview_row(int idx, RTLOADERCFG *config, RASTERINFO *info, OVERVIEWSTATE *ov) {
+	int _tile_size[2] = {0, 0};
+	int xtile = 0;
+	double gt[6] = {0.};
+	rt_raster rast = NULL;
+
+	memcpy(gt, ov->gt, sizeof(double) * 6);
+
+	/* edge y tile */
+	if (!config->pad_tile && ov->ntiles[1] > 1 && (ov->ytile + 1) == ov->ntiles[1])
+		_tile_size[1] = ov->dim[1] - (ov->ytile * ov->tile_size[1]);
+	else
+		_tile_size[1] = ov->tile_size[1];
+
+	for (xtile = 0; xtile < ov->ntiles[0]; xtile++) {
+
+		/* edge x tile */
+		if (!config->pad_tile && ov->ntiles[0] > 1 && (xtile + 1) == ov->ntiles[0])
+			_tile_size[0] = ov->dim[0] - (xtile * ov->tile_size[0]);
+		else
+			_tile_size[0] = ov->tile_size[0];
+
+		/* compute tile's upper-left corner */
+		GDALApplyGeoTransform(
+			ov->gt,
+			xtile * ov->tile_size[0], ov->ytile * ov->tile_size[1],
+			&(gt[0]), &(gt[3])
+		);
+
+		rast = build_tile(
+			info, ov->strip, ov->dim[0], ov->row - (ov->ytile * ov->tile_size[1]),
+			xtile * ov->tile_size[0], _tile_size[0], _tile_size[1],
+			gt
+		);
+		if (rast == NULL)
+			return 0;
+
+		if (!append_copy_row(&(ov->rows), rast, (config->file_column ? config->rt_filename[idx] : NULL))) {
+			raster_destroy(rast);
+			return 0;
+		}
+		raster_destroy(rast);
+	}
+
+	return write_copybuffer(&(ov->rows), ov->fp);
+}
+
+/* sample the overview rows whose source rows are in the decoded tile row */
+static int
+sample_overview(int idx, RTLOADERCFG *config, RASTERINFO *info, OVERVIEWSTATE *ov, TILEROWSLOT *slot) {
+	int srcrow = 0;
+	int pixsize = 0;
+	uint8_t *dst = NULL;
+	uint8_t *src = NULL;
+	int i = 0;
+	int x = 0;
+
+	while (ov->row < ov->dim[1]) {
+		srcrow = (int) ((ov->row + 0.5) * info->dim[1] / ov->dim[1]);
+		if (srcrow >= (int) info->dim[1])
+			srcrow = info->dim[1] - 1;
+		if (srcrow >= slot->y0 + slot->striph)
+			break;
+
+		for (i = 0; i < info->nband_count; i++) {
+			pixsize = rt_pixtype_size(info->bandtype[i]);
+			dst = ov->strip[i] + (size_t) (ov->row - (ov->ytile * ov->tile_size[1])) * ov->dim[0] * pixsize;
+			src = slot->strip[i] + (size_t) (srcrow - slot->y0) * info->dim[0] * pixsize;
+
+			for (x = 0; x < ov->dim[0]; x++)
+				memcpy(dst + (size_t) x * pixsize, src + (size_t) ov->srccol[x] * pixsize, pixsize);
+		}
+		ov->row++;
+
+		/* tile row complete */
+		if (ov->row == ov->dim[1] || ov->row == (ov->ytile + 1) * ov->tile_size[1]) {
+			if (!flush_overview_row(idx, config, info, ov))
+				return 0;
+			ov->ytile++;
+		}
+	}
+
+	return 1;
+}
+
+/* write the tiles of a tile row and sample it for the overviews */
+static int
+write_tile_row(int idx, RTLOADERCFG *config, RASTERINFO *info, TILEROWSLOT *slot, FILE **fp, OVERVIEWSTATE *ov) {
+	int i = 0;
+
+	if (!write_copybuffer(&(slot->rows), fp[0]))
+		return 0;
+
+	for (i = 0; i < config->overview_count; i++) {
+		if (!sample_overview(idx, config, info, &(ov[i]), slot))
+			return 0;
+	}
+
+	rtdealloc_tilerowstrip(slot, info->nband_count);
+
+	return 1;
+}
+
+/*
+	tile raster idx into the binary COPY files, fp[0] for the table and
+	fp[1 + i] for overview i.  Tile rows are decoded and encoded by
+	config->num_threads threads and written in order.  Overviews are
+	sampled from the decoded tile rows instead of reading the raster again
+*/
+static int
+convert_raster_binary(int idx, RTLOADERCFG *config, RASTERINFO *info, FILE **fp) {
+	GDALDatasetH hdsSrc;
+	TILEPOOL pool;
+	TILEWORKER *workers = NULL;
+	OVERVIEWSTATE *ov = NULL;
+	int num_threads = config->num_threads;
+	int num_started = 0;
+	int ytile = 0;
+	int rtn = 1;
+	int i = 0;
+
+	hdsSrc = GDALOpen(config->rt_file[idx], GA_ReadOnly);
+	if (hdsSrc == NULL) {
+		rterror(_("convert_raster_binary: Could not open raster: %s"), config->rt_file[idx]);
+		return 0;
+	}
+
+	if (!read_rastinfo(idx, config, info, hdsSrc)) {
+		GDALClose(hdsSrc);
+		return 0;
+	}
+
+	memset(&pool, 0, sizeof(TILEPOOL));
+	pool.idx = idx;
+	pool.config = config;
+	pool.info = info;
+	pool.decode = (config->overview_count > 0);
+
+	/* number of tiles */
+	pool.ntiles[0] = pool.ntiles[1] = 1;
+	if (info->tile_size[0] != info->dim[0])
+		pool.ntiles[0] = (info->dim[0] + info->tile_size[0]  - 1) / info->tile_size[0];
+	if (info->tile_size[1] != info->dim[1])
+		pool.ntiles[1] = (info->dim[1] + info->tile_size[1]  - 1) / info->tile_size[1];
+
+	/* overviews */
+	if (config->overview_count) {
+		ov = rtalloc(sizeof(OVERVIEWSTATE) * config->overview_count);
+		if (ov == NULL) {
+			rterror(_("convert_raster_binary: Could not allocate memory for overviews"));
+			GDALClose(hdsSrc);
+			return 0;
+		}
+		memset(ov, 0, sizeof(OVERVIEWSTATE) * config->overview_count);
+
+		for (i = 0; i < config->overview_count; i++) {
+			if (!init_overviewstate(config, info, i, fp[i + 1], &(ov[i]))) {
+				rtn = 0;
+				break;
+			}
+		}
+	}
+
+	/* single threaded, tile and write one tile row at a time */
+	if (rtn && (num_threads <= 1 || pool.ntiles[1] <= 1)) {
+		TILEROWSLOT slot;
+		init_tilerowslot(&slot);
+
+		for (ytile = 0; ytile < pool.ntiles[1] && rtn; ytile++) {
+			rtn = encode_tile_row(&pool, hdsSrc, ytile, &slot);
+			if (rtn)
+				rtn = write_tile_row(idx, config, info, &slot, fp, ov);
+			rtdealloc_tilerowstrip(&slot, info->nband_count);
+		}
+
+		rtdealloc_copybuffer(&(slot.rows));
+		rt_band_outdb_cache_reset();
+	}
+	else if (rtn) {
+		pthread_mutex_init(&(pool.lock), NULL);
+		pthread_cond_init(&(pool.cond), NULL);
+		pool.next_ytile = 0;
+		pool.abort = 0;
+		pool.num_slots = 2 * num_threads;
+		pool.slots = rtalloc(sizeof(TILEROWSLOT) * pool.num_slots);
+		workers = rtalloc(sizeof(TILEWORKER) * num_threads);
+		if (pool.slots == NULL || workers == NULL) {
+			rterror(_("convert_raster_binary: Could not allocate memory for tiling threads"));
+			rtn = 0;
+			num_threads = 0;
+		}
+		else {
+			for (i = 0; i < pool.num_slots; i++)
+				init_tilerowslot(&(pool.slots[i]));
+		}
+
+		/* GDAL dataset handles cannot be shared between threads */
+		for (i = 0; i < num_threads; i++) {
+			workers[i].pool = &pool;
+			workers[i].hdsSrc = GDALOpen(config->rt_file[idx], GA_ReadOnly);
+			if (workers[i].hdsSrc == NULL) {
+				rterror(_("convert_raster_binary: Could not open raster for tiling thread %d: %s"), i, config->rt_file[idx]);
+				rtn = 0;
+			}
+		}
+
+		for (i = 0; i < num_threads && rtn; i++) {
+			if (pthread_create(&(workers[i].thread), NULL, tile_worker, &(workers[i]))) {
+				rterror(_("convert_raster_binary: Could not start tiling thread %d"), i);
+				rtn = 0;
+			}
+			else
+				num_started++;
+		}
+
+		/* write out the tile rows in order as they become ready */
+		for (ytile = 0; ytile < pool.ntiles[1] && rtn; ytile++) {
+			TILEROWSLOT *slot = &(pool.slots[ytile % pool.num_slots]);
+
+			pthread_mutex_lock(&(pool.lock));
+			while (!(slot->ytile == ytile && slot->ready))
+				pthread_cond_wait(&(pool.cond), &(pool.lock));
+			pthread_mutex_unlock(&(pool.lock));
+
+			if (!slot->status)
+				rtn = 0;
+			else
+				rtn = write_tile_row(idx, config, info, slot, fp, ov);
+			rtdealloc_tilerowstrip(slot, info->nband_count);
+			slot->rows.length = 0;
+
+			pthread_mutex_lock(&(pool.lock));
+			slot->ytile = -1;
+			pthread_cond_broadcast(&(pool.cond));
+			pthread_mutex_unlock(&(pool.lock));
+		}
+
+		/* stop the workers early if anything failed */
+		pthread_mutex_lock(&(pool.lock));
+		if (!rtn)
+			pool.abort = 1;
+		pthread_cond_broadcast(&(pool.cond));
+		pthread_mutex_unlock(&(pool.lock));
+
+		for (i = 0; i < num_started; i++)
+			pthread_join(workers[i].thread, NULL);
+
+		for (i = 0; i < num_threads; i++) {
+			if (workers[i].hdsSrc != NULL)
+				GDALClose(workers[i].hdsSrc);
+		}
+		if (workers != NULL)
+			rtdealloc(workers);
+
+		if (pool.slots != NULL) {
+			for (i = 0; i < pool.num_slots; i++) {
+				rtdealloc_tilerowstrip(&(pool.slots[i]), info->nband_count);
+				rtdealloc_copybuffer(&(pool.slots[i].rows));
+			}
+			rtdealloc(pool.slots);
+		}
+		pthread_cond_destroy(&(pool.cond));
+		pthread_mutex_destroy(&(pool.lock));
+	}
+
+	if (ov != NULL) {
+		for (i = 0; i < config->overview_count; i++)
+			rtdealloc_overviewstate(&(ov[i]), info->nband_count);
+		rtdealloc(ov);
+	}
+
+	GDALClose(hdsSrc);
+
+	return rtn;
+}
+
+static int
+process_rasters(RTLOADERCFG *config, STRINGBUFFER *buffer) {
+	int i = 0;
+
+	assert(config != NULL);
+	assert(config->table != NULL);
+	assert(config->raster_column != NULL);
+
+	if (config->transaction) {
+		if (!append_sql_to_buffer(buffer, strdup("BEGIN;"))) {
+			rterror(_("process_rasters: Could not add BEGIN statement to string buffer"));
+			return 0;
+		}
+	}
+
+	/* drop table */
+	if (config->opt == 'd') {
+		if (!drop_table(config->schema, config->table, buffer)) {
+			rterror(_("process_rasters: Could not add DROP TABLE statement to string buffer"));
+			return 0;
+		}
+
+		if (config->overview_count) {
+			for (i = 0; i < config->overview_count; i++) {
+				if (!drop_table(config->schema, config->overview_table[i], buffer)) {
+					rterror(_("process_rasters: Could not add an overview's DROP TABLE statement to string buffer"));
+					return 0;
+				}
+			}
+		}
+	}
+
+	/* create table */
+	if (config->opt != 'a') {
+		if (!create_table(
+			config->schema, config->table, config->raster_column,
+			config->file_column, config->file_column_name,
+			config->tablespace, config->idx_tablespace,
+			buffer
+		)) {
+			rterror(_("process_rasters: Could not add CREATE TABLE statement to string buffer"));
+			return 0;
+		}
+
+		if (config->overview_count) {
+			for (i = 0; i < config->overview_count; i++) {
+				if (!create_table(
+					config->schema, config->overview_table[i], config->raster_column,
+					config->file_column, config->file_column_name,
+					config->tablespace, config->idx_tablespace,
+					buffer
+				)) {
+					rterror(_("process_rasters: Could not add an overview's CREATE TABLE statement to string buffer"));
+					return 0;
+				}
+			}
+		}
+	}
+
+	/* no need to run if opt is 'p' */
+	if (config->opt != 'p') {
+		RASTERINFO refinfo;
+		FILE **copyfp = NULL;
+		char **copyfile = NULL;
+		int copyfile_count = 0;
+
+		init_rastinfo(&refinfo);
+
+		/* binary COPY files of the table and of each overview */
+		if (config->copy_binary_file != NULL) {
+			copyfile_count = 1 + config->overview_count;
+			if (!open_copy_binary_files(config, &copyfp, &copyfile)) {
+				rterror(_("process_rasters: Could not create binary COPY files"));
+				return 0;
+			}
+		}
+
+		/* process each raster */
+		for (i = 0; i < config->rt_file_count; i++) {
+			RASTERINFO rastinfo;
+			STRINGBUFFER tileset;
+
+			fprintf(stderr, _("Processing %d/%d: %s\n"), i + 1, config->rt_file_count, config->rt_file[i]);
+
+			init_rastinfo(&rastinfo);
+			init_stringbuffer(&tileset);
+
+			/* tiles and overviews straight to the binary COPY files */
+			if (copyfp != NULL) {
+				if (!convert_raster_binary(i, config, &rastinfo, copyfp)) {
+					rterror(_("process_rasters: Could not process raster: %s"), config->rt_file[i]);
+					rtdealloc_rastinfo(&rastinfo);
+					close_copy_binary_files(copyfile_count, copyfp, copyfile, 0);
+					return 0;
+				}
+			}
+			/* convert raster */
+			else if (!convert_raster(i, config, &rastinfo, &tileset, buffer)) {
+				rterror(_("process_rasters: Could not process raster: %s"), config->rt_file[i]);
+				rtdealloc_rastinfo(&rastinfo);
+				rtdealloc_stringbuffer(&tileset, 0);
+				return 0;
+			}
+
+			/* process raster tiles into COPY or INSERT statements */
+			if (tileset.length && !insert_records(
+				config->schema, config->table, config->raster_column,
+				(config->file_column ? config->rt_filename[i] : NULL),
+        config->file_column_name,
+				config->copy_statements, config->out_srid,
+				&tileset, buffer
+			)) {
+				rterror(_("process_rasters: Could not convert raster tiles into INSERT or COPY statements"));
+				rtdealloc_rastinfo(&rastinfo);
+				rtdealloc_stringbuffer(&tileset, 0);
+				return 0;
+			}
+
+			rtdealloc_stringbuffer(&tileset, 0);
+
+			/* flush buffer after every raster */
+			flush_stringbuffer(buffer);
+
+			/* overviews, already written in binary COPY mode */
+			if (config->overview_count && copyfp == NULL) {
+				int j = 0;
+
+				for (j = 0; j < config->overview_count; j++) {
+
+					if (!build_overview(i, config, &rastinfo, j, &tileset, buffer)) {
+						rterror(_("process_rasters: Could not create overview of factor %d for raster %s"), config->overview[j], config->rt_file[i]);
+						rtdealloc_rastinfo(&rastinfo);
+						rtdealloc_stringbuffer(&tileset, 0);
+						return 0;
+					}
+
+					if (tileset.length && !insert_records(
+						config->schema, config->overview_table[j], config->raster_column,
+						(config->file_column ? config->rt_filename[i] : NULL), config->file_column_name,
+						config->copy_statements, config->out_srid,
+						&tileset, buffer
+					)) {
+						rterror(_("process_rasters: Could not convert overview tiles into INSERT or COPY statements"));
+						rtdealloc_rastinfo(&rastinfo);
+						rtdealloc_stringbuffer(&tileset, 0);
+						return 0;
+					}
+
+					rtdealloc_stringbuffer(&tileset, 0);
+
+					/* flush buffer after every raster */
+					flush_stringbuffer(buffer);
+				}
 			}
 
 			if (config->rt_file_count > 1) {
@@ -2145,6 +3139,40 @@ process_rasters(RTLOADERCFG *config, STRINGBUFFER *buffer) {
 		}
 
 		rtdealloc_rastinfo(&refinfo);
+
+		/* load the binary COPY files */
+		if (copyfp != NULL) {
+			if (!close_copy_binary_files(copyfile_count, copyfp, copyfile, 1)) {
+				rterror(_("process_rasters: Could not write binary COPY files"));
+				return 0;
+			}
+
+			if (!copy_from_binary(
+				config->schema, config->table, config->raster_column,
+				(config->file_column ? config->file_column_name : NULL),
+				config->copy_binary_file,
+				buffer
+			)) {
+				rterror(_("process_rasters: Could not add \\copy command to string buffer"));
+				return 0;
+			}
+
+			for (i = 0; i < config->overview_count; i++) {
+				if (!copy_from_binary(
+					config->schema, config->overview_table[i], config->raster_column,
+					(config->file_column ? config->file_column_name : NULL),
+					copyfile[i + 1],
+					buffer
+				)) {
+					rterror(_("process_rasters: Could not add an overview's \\copy command to string buffer"));
+					return 0;
+				}
+			}
+
+			for (i = 1; i < copyfile_count; i++)
+				rtdealloc(copyfile[i]);
+			rtdealloc(copyfile);
+		}
 	}
 
 	/* index */
@@ -2602,6 +3630,28 @@ main(int argc, char **argv) {
 		else if (CSEQUAL(argv[i], "-Y")) {
 			config->copy_statements = 1;
 		}
+		/* binary COPY file */
+		else if (CSEQUAL(argv[i], "-B") && i < argc - 1) {
+			if (config->copy_binary_file != NULL)
+				rtdealloc(config->copy_binary_file);
+			i++;
+			config->copy_binary_file = rtalloc(sizeof(char) * (strlen(argv[i]) + 1));
+			if (config->copy_binary_file == NULL) {
+				rterror(_("Could not allocate memory for storing binary COPY filename"));
+				rtdealloc_config(config);
+				exit(1);
+			}
+			strncpy(config->copy_binary_file, argv[i], strlen(argv[i]) + 1);
+		}
+		/* tiling threads */
+		else if (CSEQUAL(argv[i], "-j") && i < argc - 1) {
+			config->num_threads = atoi(argv[++i]);
+			if (config->num_threads < 1) {
+				rterror(_("The -j parameter must be a positive number of threads"));
+				rtdealloc_config(config);
+				exit(1);
+			}
+		}
 		/* GDAL formats */
 		else if (CSEQUAL(argv[i], "-G")) {
 			uint32_t drv_count = 0;
@@ -2654,6 +3704,20 @@ main(int argc, char **argv) {
 			rterror(_("Invalid argument combination - cannot use -Y with -s FROM_SRID:TO_SRID"));
 			exit(1);
 		}
+		if (config->copy_binary_file != NULL) {
+			rterror(_("Invalid argument combination - cannot use -B with -s FROM_SRID:TO_SRID"));
+			exit(1);
+		}
+	}
+
+	if (config->copy_binary_file != NULL && config->copy_statements) {
+		rterror(_("Invalid argument combination - cannot use -B with -Y"));
+		exit(1);
+	}
+
+	if (config->num_threads > 1 && config->copy_binary_file == NULL) {
+		rterror(_("Invalid argument combination - -j requires -B"));
+		exit(1);
 	}
 
 	/* register GDAL drivers */
@@ -159,6 +159,12 @@ typedef struct raster_loader_config {
 	/* use COPY instead of INSERT */
 	int copy_statements;
 
+	/* write tiles to this file in binary COPY format, loaded with \copy */
+	char *copy_binary_file;
+
+	/* number of threads tiling rasters in binary COPY mode */
+	int num_threads;
+
 } RTLOADERCFG;
 
 typedef struct rasterinfo_t {
@@ -196,3 +202,9 @@ typedef struct stringbuffer_t {
 	uint32_t length;
 	char **line;
 } STRINGBUFFER;
+
+typedef struct copybuffer_t {
+	size_t length;
+	size_t size;
+	uint8_t *data;
+} COPYBUFFER;
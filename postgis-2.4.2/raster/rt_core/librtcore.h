@@ -150,12 +150,15 @@ typedef struct rt_geomval_t* rt_geomval;
 typedef struct rt_bandstats_t* rt_bandstats;
 typedef struct rt_histogram_t* rt_histogram;
 typedef struct rt_quantile_t* rt_quantile;
+typedef struct rt_statsacc_t* rt_statsacc;
 typedef struct rt_valuecount_t* rt_valuecount;
 typedef struct rt_gdaldriver_t* rt_gdaldriver;
 typedef struct rt_reclassexpr_t* rt_reclassexpr;
 
 typedef struct rt_iterator_t* rt_iterator;
 typedef struct rt_iterator_arg_t* rt_iterator_arg;
+typedef struct rt_iterator_block_arg_t* rt_iterator_block_arg;
+typedef struct rt_kernel_t* rt_kernel;
 
 typedef struct rt_colormap_entry_t* rt_colormap_entry;
 typedef struct rt_colormap_t* rt_colormap;
@@ -206,6 +209,23 @@ typedef enum {
 	ET_CUSTOM
 } rt_extenttype;
 
+/* built-in kernels of the block raster iterator */
+typedef enum {
+	KT_SUM = 0,
+	KT_MEAN,
+	KT_MIN,
+	KT_MAX,
+	KT_RANGE,
+	KT_SLOPE
+} rt_kerneltype;
+
+/* units of the slope kernel */
+typedef enum {
+	SU_DEGREES = 0,
+	SU_RADIANS,
+	SU_PERCENT
+} rt_slopeunits;
+
 /**
  * GEOS spatial relationship tests available
  *
@@ -549,12 +569,22 @@ void* rt_band_get_data(rt_band band);
 	* and should not be released by the caller.  Data will be
 	* released when band is destroyed with rt_band_destroy().
 	*
+	* Dataset handles and decoded windows are cached per backend,
+	* see rt_band_outdb_cache_reset().
+	*
 	* @param band : the band who's data to get
 	*
 	* @return ES_NONE if success, ES_ERROR if failure
 	*/
 rt_errorstate rt_band_load_offline_data(rt_band band);
 
+/**
+	* Close the cached GDAL datasets and release the cached windows
+	* of out-db bands.  Call when out-db files have changed or before
+	* GDAL itself is torn down.
+	*/
+void rt_band_outdb_cache_reset(void);
+
 /**
  * Destroy a raster band
  *
@@ -708,6 +738,27 @@ rt_errorstate rt_band_get_pixel(
 	int *nodata
 );
 
+/**
+ * Get a run of pixel values of a row as doubles.  Unlike
+ * rt_band_get_pixel_line(), the run may extend beyond the band's
+ * extent.  Pixels outside of the extent are flagged as NODATA.
+ *
+ * @param band : the band to get pixel values from
+ * @param x : pixel column of the first value (0-based)
+ * @param y : pixel row (0-based)
+ * @param len : the number of values to get
+ * @param *vals : array of len values to fill
+ * @param *nodata : array of len 0,1 NODATA flags to fill
+ *
+ * @return ES_NONE on success, ES_ERROR on error
+ */
+rt_errorstate rt_band_get_pixel_row(
+	rt_band band,
+	int x, int y,
+	uint32_t len,
+	double *vals, uint8_t *nodata
+);
+
 /**
  * Get nearest pixel(s) with value (not NODATA) to specified pixel
  *
@@ -899,6 +950,112 @@ rt_quantile rt_band_get_quantiles_stream(
 	uint32_t *rtn_count
 );
 
+/**
+ * Create a statistics accumulator collecting count, sum, min, max
+ * and standard deviation in one pass over any number of bands
+ *
+ * @param sketch : if non-zero, also keep a t-digest of the values
+ *   so that quantiles and histograms can be computed
+ *
+ * @return new accumulator or NULL on error
+ */
+rt_statsacc rt_statsacc_new(int sketch);
+
+/**
+ * Destroy a statistics accumulator
+ *
+ * @param acc : the accumulator to destroy
+ */
+void rt_statsacc_destroy(rt_statsacc acc);
+
+/**
+ * Add a value to a statistics accumulator
+ *
+ * @param acc : the accumulator to add to
+ * @param value : the value to add
+ * @param count : the number of times value is added
+ */
+void rt_statsacc_add(rt_statsacc acc, double value, uint32_t count);
+
+/**
+ * Add the values of a band to a statistics accumulator
+ *
+ * @param acc : the accumulator to add to
+ * @param band : the band to add
+ * @param exclude_nodata_value : if non-zero, ignore nodata values
+ * @param sample : percentage of pixels to sample
+ *
+ * @return ES_NONE on success, ES_ERROR on error
+ */
+rt_errorstate rt_statsacc_add_band(
+	rt_statsacc acc, rt_band band,
+	int exclude_nodata_value, double sample
+);
+
+/**
+ * Merge one statistics accumulator into another. Both accumulators
+ * must have been created with the same sketch flag
+ *
+ * @param acc : the accumulator to merge into
+ * @param other : the accumulator to merge from
+ *
+ * @return ES_NONE on success, ES_ERROR on error
+ */
+rt_errorstate rt_statsacc_merge(rt_statsacc acc, rt_statsacc other);
+
+/**
+ * Get the summary statistics of a statistics accumulator
+ *
+ * @param acc : the accumulator to query
+ * @param sample : percentage of pixels sampled. If between 0 and 1,
+ *   stddev is the sample standard deviation
+ *
+ * @return the summary statistics (values is always NULL) or NULL
+ */
+rt_bandstats rt_statsacc_get_stats(rt_statsacc acc, double sample);
+
+/**
+ * Count the distribution of the values of a statistics accumulator.
+ * Bins are approximate once more than RT_STATSACC_BUFFER values have
+ * been added. Parameters are the same as rt_band_get_histogram()
+ *
+ * @param acc : the accumulator to query, created with sketch
+ * @param bin_count : the number of bins to group the data by
+ * @param bin_width : the width of each bin as an array
+ * @param bin_width_count : number of values in bin_width
+ * @param right : evaluate bins by (a,b] rather than default [a,b)
+ * @param min : user-defined minimum value of the histogram
+ * @param max : user-defined maximum value of the histogram
+ * @param rtn_count : set to the number of bins being returned
+ *
+ * @return the histogram of the data or NULL
+ */
+rt_histogram rt_statsacc_get_histogram(
+	rt_statsacc acc,
+	int bin_count, double *bin_width, int bin_width_count,
+	int right, double min, double max,
+	uint32_t *rtn_count
+);
+
+/**
+ * Compute the default set of or requested quantiles of a statistics
+ * accumulator. Quantiles are exact (R method 7) until more than
+ * RT_STATSACC_BUFFER values have been added and estimated from the
+ * t-digest afterwards
+ *
+ * @param acc : the accumulator to query, created with sketch
+ * @param quantiles : the quantiles to be computed
+ * @param quantiles_count : the number of quantiles to be computed
+ * @param rtn_count : the number of quantiles being returned
+ *
+ * @return the default set of or requested quantiles or NULL
+ */
+rt_quantile rt_statsacc_get_quantiles(
+	rt_statsacc acc,
+	double *quantiles, int quantiles_count,
+	uint32_t *rtn_count
+);
+
 /**
  * Count the number of times provided value(s) occur in
  * the band
@@ -1967,6 +2124,59 @@ rt_raster_iterator(
 	rt_raster *rtnraster
 );
 
+/**
+ * Block n-raster iterator.  Returns a raster with one band.
+ * The raster returned should be freed by the caller
+ *
+ * Same as rt_raster_iterator() except that the callback is called
+ * once per row of the output raster with buffers holding the rows
+ * of every input raster covering the neighborhoods of that row.
+ * Each input pixel is read only once.
+ *
+ * The callback function _must_ have the following signature.
+ *
+ *    int FNAME(rt_iterator_block_arg arg, void *userarg, double *values, uint8_t *nodata)
+ *
+ * - rt_iterator_block_arg arg : struct containing row buffers and metadata
+ * - void *userarg : NULL or calling function provides to rt_raster_iterator_block() for use by callback function
+ * - double *values : arg->columns values of the row to be burned
+ * - uint8_t *nodata : arg->columns flags (0 or 1) indicating that pixel to be burned is NODATA
+ *
+ * The callback function _must_ return zero (error) or non-zero (success).
+ *
+ * @return ES_NONE on success, ES_ERROR on error
+ */
+rt_errorstate
+rt_raster_iterator_block(
+	rt_iterator itrset, uint16_t itrcount,
+	rt_extenttype extenttype, rt_raster customextent,
+	rt_pixtype pixtype,
+	uint8_t hasnodata, double nodataval,
+	uint16_t distancex, uint16_t distancey,
+	void *userarg,
+	int (*callback)(
+		rt_iterator_block_arg arg,
+		void *userarg,
+		double *values,
+		uint8_t *nodata
+	),
+	rt_raster *rtnraster
+);
+
+/**
+ * Built-in callback of rt_raster_iterator_block() computing the
+ * sum, mean, minimum, maximum or range of each neighborhood over
+ * all rasters, or the slope of the 3x3 neighborhood of the first
+ * raster.  userarg must be a rt_kernel.
+ *
+ * @return zero on error, non-zero on success
+ */
+int
+rt_raster_iterator_kernel(
+	rt_iterator_block_arg arg, void *userarg,
+	double *values, uint8_t *nodata
+);
+
 /**
  * Returns a new raster with up to four 8BUI bands (RGBA) from
  * applying a colormap to the user-specified band of the
@@ -2000,6 +2210,13 @@ extern void rtdealloc(void *mem);
 #define GDAL_DISABLE_ALL "DISABLE_ALL"
 #define GDAL_VSICURL "VSICURL"
 
+/*
+ * default size in kilobytes of the per-backend cache
+ * of decoded out-db windows (postgis.outdb_cache_size)
+ */
+
+#define RT_OUTDB_CACHE_SIZE 65536
+
 /*
  * Set of functions to clamp double to int of different size
  */
@@ -2339,6 +2556,35 @@ struct rt_quantile_t {
 	uint32_t has_value;
 };
 
+/* single-pass, mergeable statistics of one or more bands */
+#define RT_STATSACC_COMPRESSION 100
+#define RT_STATSACC_CENTROIDS 128 /* > RT_STATSACC_COMPRESSION + 1 */
+#define RT_STATSACC_BUFFER 512
+
+struct rt_statsacc_centroid_t {
+	double mean;
+	double weight;
+};
+
+struct rt_statsacc_t {
+	uint64_t count;
+
+	double min;
+	double max;
+	double sum;
+
+	/* one-pass standard deviation */
+	double M;
+	double Q;
+
+	/* merging t-digest, k1 scale function */
+	int sketch;
+	uint32_t centroids_count;
+	uint32_t buffer_count;
+	struct rt_statsacc_centroid_t centroids[RT_STATSACC_CENTROIDS];
+	struct rt_statsacc_centroid_t buffer[RT_STATSACC_BUFFER];
+};
+
 /* listed-list structures for rt_band_get_quantiles_stream */
 struct quantile_llist {
 	uint8_t algeq; /* AL-GEQ (1) or AL-GT (0) */
@@ -2418,6 +2664,49 @@ struct rt_iterator_arg_t {
 	int dst_pixel[2];
 };
 
+/* callback argument from block raster iterator */
+struct rt_iterator_block_arg_t {
+	/* # of rasters */
+	uint16_t rasters;
+	/* # of pixels in the output row */
+	uint32_t columns;
+
+	/* # of pixels around each output pixel along the X and Y axis */
+	uint16_t distancex;
+	uint16_t distancey;
+
+	/* # of rows in each buffer: distancey * 2 + 1 */
+	uint32_t rows;
+	/* # of values in each row of a buffer: columns + distancex * 2 */
+	uint32_t stride;
+
+	/*
+		per raster, rows * stride values and 0,1 NODATA flags, row-major.
+		NODATA values are 0.  The neighborhood of output pixel X is made
+		of columns X to X + distancex * 2 of every row
+	*/
+	double **values;
+	uint8_t **nodata;
+
+	/* Y of row from output raster */
+	int dst_row;
+};
+
+/* userarg of rt_raster_iterator_kernel() */
+struct rt_kernel_t {
+	rt_kerneltype type;
+
+	/* value substituted for NODATA pixels by KT_SUM to KT_RANGE */
+	int hassubstitute;
+	double substitute;
+
+	/* KT_SLOPE */
+	double pixwidth;
+	double pixheight;
+	double scale;
+	rt_slopeunits units;
+};
+
 /* gdal driver information */
 struct rt_gdaldriver_t {
 	int idx;
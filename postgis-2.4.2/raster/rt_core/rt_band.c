@@ -32,8 +32,6 @@
 #include "librtcore.h"
 #include "librtcore_internal.h"
 
-#include "gdal_vrt.h"
-
 /**
  * Create an in-db rt_band with no data
  *
@@ -344,27 +342,410 @@ rt_band_get_data(rt_band band) {
 /* variable for PostgreSQL GUC: postgis.enable_outdb_rasters */
 bool THR_LOCAL enable_outdb_rasters = 1;
 
+/* variable for PostgreSQL GUC: postgis.outdb_cache_size (kilobytes) */
+int THR_LOCAL outdb_cache_size = RT_OUTDB_CACHE_SIZE;
+
+/******************************************************************************
+* out-db read cache
+*
+* Every access to an out-db band used to open the file through GDAL, wrap it
+* in a VRT and decode the tile extent.  For coverages made of many small
+* out-db tiles over a handful of files, the open dominates everything else.
+*
+* Two per-backend caches are kept here:
+*   - the most recently used GDAL dataset handles, keyed by path
+*   - decoded tile windows, keyed by path, band, window and pixel type,
+*     evicted least recently used first once outdb_cache_size is exceeded
+*
+* Both live in malloc'd memory as they must outlive the memory context of
+* the query that filled them.  Files are assumed not to change underneath
+* an open backend; rt_band_outdb_cache_reset() drops everything.
+******************************************************************************/
+
+#define RT_OUTDB_DATASETS 16
+#define RT_OUTDB_BUCKETS 1024
+
+typedef struct rt_outdb_dataset_t {
+	char *path;
+	GDALDatasetH hds;
+	double gt[6];
+	int nband;
+	uint64_t used;
+} rt_outdb_dataset;
+
+typedef struct rt_outdb_block_t *rt_outdb_block;
+struct rt_outdb_block_t {
+	uint32_t hash;
+	char *path;
+	uint8_t bandNum;
+	rt_pixtype pixtype;
+	int xoff;
+	int yoff;
+	uint16_t width;
+	uint16_t height;
+	int hasnodata;
+	double nodataval;
+
+	uint8_t *data;
+	size_t size;
+
+	/* hash chain */
+	rt_outdb_block hnext;
+	/* LRU list, most recently used first */
+	rt_outdb_block prev;
+	rt_outdb_block next;
+};
+
+static THR_LOCAL rt_outdb_dataset _rt_outdb_datasets[RT_OUTDB_DATASETS];
+static THR_LOCAL uint64_t _rt_outdb_clock = 0;
+
+static THR_LOCAL rt_outdb_block _rt_outdb_buckets[RT_OUTDB_BUCKETS];
+static THR_LOCAL rt_outdb_block _rt_outdb_head = NULL;
+static THR_LOCAL rt_outdb_block _rt_outdb_tail = NULL;
+static THR_LOCAL size_t _rt_outdb_bytes = 0;
+
+/* FNV-1a */
+static uint32_t
+_rt_outdb_hash_bytes(uint32_t h, const void *bytes, size_t len) {
+	const uint8_t *p = (const uint8_t *) bytes;
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		h ^= p[i];
+		h *= 16777619U;
+	}
+
+	return h;
+}
+
+static void
+_rt_outdb_block_unlink(rt_outdb_block block) {
+	if (block->prev != NULL)
+		block->prev->next = block->next;
+	else
+		_rt_outdb_head = block->next;
+
+	if (block->next != NULL)
+		block->next->prev = block->prev;
+	else
+		_rt_outdb_tail = block->prev;
+
+	block->prev = NULL;
+	block->next = NULL;
+}
+
+static void
+_rt_outdb_block_push(rt_outdb_block block) {
+	block->prev = NULL;
+	block->next = _rt_outdb_head;
+	if (_rt_outdb_head != NULL)
+		_rt_outdb_head->prev = block;
+	_rt_outdb_head = block;
+	if (_rt_outdb_tail == NULL)
+		_rt_outdb_tail = block;
+}
+
+static void
+_rt_outdb_block_evict(rt_outdb_block block) {
+	rt_outdb_block *link = &(_rt_outdb_buckets[block->hash % RT_OUTDB_BUCKETS]);
+
+	while (*link != block)
+		link = &((*link)->hnext);
+	*link = block->hnext;
+
+	_rt_outdb_block_unlink(block);
+	_rt_outdb_bytes -= block->size;
+
+	free(block->path);
+	free(block->data);
+	free(block);
+}
+
+static uint32_t
+_rt_outdb_block_hash(rt_band band, int xoff, int yoff) {
+	uint32_t h = 2166136261U;
+
+	h = _rt_outdb_hash_bytes(h, band->data.offline.path, strlen(band->data.offline.path));
+	h = _rt_outdb_hash_bytes(h, &(band->data.offline.bandNum), sizeof(uint8_t));
+	h = _rt_outdb_hash_bytes(h, &xoff, sizeof(int));
+	h = _rt_outdb_hash_bytes(h, &yoff, sizeof(int));
+	h = _rt_outdb_hash_bytes(h, &(band->width), sizeof(uint16_t));
+	h = _rt_outdb_hash_bytes(h, &(band->height), sizeof(uint16_t));
+
+	return h;
+}
+
+static rt_outdb_block
+_rt_outdb_block_find(rt_band band, int xoff, int yoff, uint32_t hash) {
+	rt_outdb_block block = _rt_outdb_buckets[hash % RT_OUTDB_BUCKETS];
+
+	for (; block != NULL; block = block->hnext) {
+		if (
+			block->hash != hash ||
+			block->bandNum != band->data.offline.bandNum ||
+			block->pixtype != band->pixtype ||
+			block->xoff != xoff ||
+			block->yoff != yoff ||
+			block->width != band->width ||
+			block->height != band->height ||
+			block->hasnodata != band->hasnodata ||
+			(band->hasnodata && FLT_NEQ(block->nodataval, band->nodataval)) ||
+			strcmp(block->path, band->data.offline.path) != 0
+		) {
+			continue;
+		}
+
+		/* most recently used */
+		if (block != _rt_outdb_head) {
+			_rt_outdb_block_unlink(block);
+			_rt_outdb_block_push(block);
+		}
+
+		return block;
+	}
+
+	return NULL;
+}
+
+static void
+_rt_outdb_block_add(rt_band band, int xoff, int yoff, uint32_t hash, const uint8_t *data, size_t size) {
+	size_t limit = 0;
+	rt_outdb_block block = NULL;
+
+	if (outdb_cache_size < 1)
+		return;
+	limit = (size_t) outdb_cache_size * 1024;
+
+	/* window alone would flush the cache */
+	if (size > limit / 4)
+		return;
+
+	while (_rt_outdb_tail != NULL && _rt_outdb_bytes + size > limit)
+		_rt_outdb_block_evict(_rt_outdb_tail);
+
+	block = (rt_outdb_block) malloc(sizeof(struct rt_outdb_block_t));
+	if (block == NULL)
+		return;
+	memset(block, 0, sizeof(struct rt_outdb_block_t));
+
+	block->path = (char *) malloc(strlen(band->data.offline.path) + 1);
+	block->data = (uint8_t *) malloc(size);
+	if (block->path == NULL || block->data == NULL) {
+		free(block->path);
+		free(block->data);
+		free(block);
+		return;
+	}
+
+	strcpy(block->path, band->data.offline.path);
+	memcpy(block->data, data, size);
+	block->size = size;
+	block->hash = hash;
+	block->bandNum = band->data.offline.bandNum;
+	block->pixtype = band->pixtype;
+	block->xoff = xoff;
+	block->yoff = yoff;
+	block->width = band->width;
+	block->height = band->height;
+	block->hasnodata = band->hasnodata;
+	block->nodataval = band->nodataval;
+
+	block->hnext = _rt_outdb_buckets[hash % RT_OUTDB_BUCKETS];
+	_rt_outdb_buckets[hash % RT_OUTDB_BUCKETS] = block;
+	_rt_outdb_block_push(block);
+	_rt_outdb_bytes += size;
+}
+
+static void
+_rt_outdb_dataset_close(rt_outdb_dataset *ds) {
+	if (ds->hds != NULL)
+		GDALClose(ds->hds);
+	free(ds->path);
+	memset(ds, 0, sizeof(rt_outdb_dataset));
+}
+
+/* open or reuse the GDAL dataset of path */
+static rt_outdb_dataset *
+_rt_outdb_dataset_get(const char *path) {
+	rt_outdb_dataset *ds = NULL;
+	rt_outdb_dataset *slot = NULL;
+	int i;
+
+	for (i = 0; i < RT_OUTDB_DATASETS; i++) {
+		ds = &(_rt_outdb_datasets[i]);
+
+		if (ds->hds == NULL) {
+			if (slot == NULL || slot->hds != NULL)
+				slot = ds;
+			continue;
+		}
+
+		if (strcmp(ds->path, path) == 0) {
+			ds->used = ++_rt_outdb_clock;
+			return ds;
+		}
+
+		/* least recently used */
+		if (slot == NULL || (slot->hds != NULL && ds->used < slot->used))
+			slot = ds;
+	}
+
+	_rt_outdb_dataset_close(slot);
+
+	slot->path = (char *) malloc(strlen(path) + 1);
+	if (slot->path == NULL) {
+		rterror("rt_band_load_offline_data: Could not allocate memory for offline raster path");
+		return NULL;
+	}
+	strcpy(slot->path, path);
+
+	/*
+	slot->hds = rt_util_gdal_open(path, GA_ReadOnly, 1);
+	*/
+	slot->hds = rt_util_gdal_open(path, GA_ReadOnly, 0);
+	if (slot->hds == NULL) {
+		rterror("rt_band_load_offline_data: Cannot open offline raster: %s", path);
+		_rt_outdb_dataset_close(slot);
+		return NULL;
+	}
+
+	slot->nband = GDALGetRasterCount(slot->hds);
+
+	/* get offline raster's geotransform */
+	if (GDALGetGeoTransform(slot->hds, slot->gt) != CE_None) {
+		RASTER_DEBUG(4, "Using default geotransform matrix (0, 1, 0, 0, 0, -1)");
+		slot->gt[0] = 0;
+		slot->gt[1] = 1;
+		slot->gt[2] = 0;
+		slot->gt[3] = 0;
+		slot->gt[4] = 0;
+		slot->gt[5] = -1;
+	}
+
+	slot->used = ++_rt_outdb_clock;
+	return slot;
+}
+
+/**
+	* Close the cached GDAL datasets and release the cached windows
+	* of out-db bands.  Call when out-db files have changed or before
+	* GDAL itself is torn down.
+	*/
+void
+rt_band_outdb_cache_reset(void) {
+	int i;
+
+	while (_rt_outdb_head != NULL)
+		_rt_outdb_block_evict(_rt_outdb_head);
+
+	for (i = 0; i < RT_OUTDB_DATASETS; i++)
+		_rt_outdb_dataset_close(&(_rt_outdb_datasets[i]));
+
+	_rt_outdb_clock = 0;
+}
+
+/* set all pixels of a band buffer to value */
+static void
+_rt_band_fill_mem(uint8_t *mem, rt_pixtype pixtype, uint32_t count, double value) {
+	int size = rt_pixtype_size(pixtype);
+	uint8_t pixel[8] = {0};
+	uint32_t i;
+
+	switch (pixtype) {
+		case PT_1BB:
+			pixel[0] = rt_util_clamp_to_1BB(value);
+			break;
+		case PT_2BUI:
+			pixel[0] = rt_util_clamp_to_2BUI(value);
+			break;
+		case PT_4BUI:
+			pixel[0] = rt_util_clamp_to_4BUI(value);
+			break;
+		case PT_8BSI: {
+			int8_t v = rt_util_clamp_to_8BSI(value);
+			memcpy(pixel, &v, sizeof(int8_t));
+			break;
+		}
+		case PT_8BUI:
+			pixel[0] = rt_util_clamp_to_8BUI(value);
+			break;
+		case PT_16BSI: {
+			int16_t v = rt_util_clamp_to_16BSI(value);
+			memcpy(pixel, &v, sizeof(int16_t));
+			break;
+		}
+		case PT_16BUI: {
+			uint16_t v = rt_util_clamp_to_16BUI(value);
+			memcpy(pixel, &v, sizeof(uint16_t));
+			break;
+		}
+		case PT_32BSI: {
+			int32_t v = rt_util_clamp_to_32BSI(value);
+			memcpy(pixel, &v, sizeof(int32_t));
+			break;
+		}
+		case PT_32BUI: {
+			uint32_t v = rt_util_clamp_to_32BUI(value);
+			memcpy(pixel, &v, sizeof(uint32_t));
+			break;
+		}
+		case PT_32BF: {
+			float v = rt_util_clamp_to_32F(value);
+			memcpy(pixel, &v, sizeof(float));
+			break;
+		}
+		case PT_64BF:
+			memcpy(pixel, &value, sizeof(double));
+			break;
+		default:
+			break;
+	}
+
+	if (size == 1) {
+		memset(mem, pixel[0], count);
+		return;
+	}
+
+	for (i = 0; i < count; i++)
+		memcpy(mem + (size_t) i * size, pixel, size);
+}
+
 /**
 	* Load offline band's data.  Loaded data is internally owned
 	* and should not be released by the caller.  Data will be
 	* released when band is destroyed with rt_band_destroy().
 	*
+	* Dataset handles and decoded windows are cached per backend,
+	* see rt_band_outdb_cache_reset().
+	*
 	* @param band : the band who's data to get
 	*
 	* @return ES_NONE if success, ES_ERROR if failure
 	*/
 rt_errorstate
 rt_band_load_offline_data(rt_band band) {
-	GDALDatasetH hdsSrc = NULL;
-	int nband = 0;
-	VRTDatasetH hdsDst = NULL;
-	VRTSourcedRasterBandH hbandDst = NULL;
+	rt_outdb_dataset *ds = NULL;
+	rt_outdb_block block = NULL;
+	GDALRasterBandH hbandSrc = NULL;
 	double gt[6] = {0.};
-	double ogt[6] = {0};
 	double offset[2] = {0};
+	int xoff = 0;
+	int yoff = 0;
+	uint32_t hash = 0;
+
+	/* source window clipped to the offline raster */
+	int srcXSize = 0;
+	int srcYSize = 0;
+	int x0 = 0;
+	int y0 = 0;
+	int x1 = 0;
+	int y1 = 0;
+
+	uint8_t *mem = NULL;
+	int pixsize = 0;
+	size_t size = 0;
 
 	rt_raster _rast = NULL;
-	rt_band _band = NULL;
 	int aligned = 0;
 	int err = ES_NONE;
 
@@ -395,26 +776,18 @@ rt_band_load_offline_data(rt_band band) {
 	}
 
 	rt_util_gdal_register_all(0);
-	/*
-	hdsSrc = rt_util_gdal_open(band->data.offline.path, GA_ReadOnly, 1);
-	*/
-	hdsSrc = rt_util_gdal_open(band->data.offline.path, GA_ReadOnly, 0);
-	if (hdsSrc == NULL) {
-		rterror("rt_band_load_offline_data: Cannot open offline raster: %s", band->data.offline.path);
+	ds = _rt_outdb_dataset_get(band->data.offline.path);
+	if (ds == NULL)
 		return ES_ERROR;
-	}
 
 	/* # of bands */
-	nband = GDALGetRasterCount(hdsSrc);
-	if (!nband) {
+	if (!ds->nband) {
 		rterror("rt_band_load_offline_data: No bands found in offline raster: %s", band->data.offline.path);
-		GDALClose(hdsSrc);
 		return ES_ERROR;
 	}
 	/* bandNum is 0-based */
-	else if (band->data.offline.bandNum + 1 > nband) {
+	else if (band->data.offline.bandNum + 1 > ds->nband) {
 		rterror("rt_band_load_offline_data: Specified band %d not found in offline raster: %s", band->data.offline.bandNum, band->data.offline.path);
-		GDALClose(hdsSrc);
 		return ES_ERROR;
 	}
 
@@ -422,30 +795,18 @@ rt_band_load_offline_data(rt_band band) {
 	rt_raster_get_geotransform_matrix(band->raster, gt);
 	RASTER_DEBUGF(3, "Raster geotransform (%f, %f, %f, %f, %f, %f)",
 		gt[0], gt[1], gt[2], gt[3], gt[4], gt[5]);
-
-	/* get offline raster's geotransform */
-	if (GDALGetGeoTransform(hdsSrc, ogt) != CE_None) {
-		RASTER_DEBUG(4, "Using default geotransform matrix (0, 1, 0, 0, 0, -1)");
-		ogt[0] = 0;
-		ogt[1] = 1;
-		ogt[2] = 0;
-		ogt[3] = 0;
-		ogt[4] = 0;
-		ogt[5] = -1;
-	}
 	RASTER_DEBUGF(3, "Offline geotransform (%f, %f, %f, %f, %f, %f)",
-		ogt[0], ogt[1], ogt[2], ogt[3], ogt[4], ogt[5]);
+		ds->gt[0], ds->gt[1], ds->gt[2], ds->gt[3], ds->gt[4], ds->gt[5]);
 
 	/* are rasters aligned? */
 	_rast = rt_raster_new(1, 1);
-	rt_raster_set_geotransform_matrix(_rast, ogt);
+	rt_raster_set_geotransform_matrix(_rast, ds->gt);
 	rt_raster_set_srid(_rast, band->raster->srid);
 	err = rt_raster_same_alignment(band->raster, _rast, &aligned, NULL);
 	rt_raster_destroy(_rast);
 
 	if (err != ES_NONE) {
 		rterror("rt_band_load_offline_data: Could not test alignment of in-db representation of out-db raster");
-		GDALClose(hdsSrc);
 		return ES_ERROR;
 	}
 	else if (!aligned) {
@@ -455,63 +816,67 @@ rt_band_load_offline_data(rt_band band) {
 	/* get offsets */
 	rt_raster_geopoint_to_cell(
 		band->raster,
-		ogt[0], ogt[3],
+		ds->gt[0], ds->gt[3],
 		&(offset[0]), &(offset[1]),
 		NULL
 	);
 
 	RASTER_DEBUGF(4, "offsets: (%f, %f)", offset[0], offset[1]);
 
-	/* create VRT dataset */
-	hdsDst = VRTCreate(band->width, band->height);
-	GDALSetGeoTransform(hdsDst, gt);
-	/*
-	GDALSetDescription(hdsDst, "/tmp/offline.vrt");
-	*/
-
-	/* add band as simple sources */
-	GDALAddBand(hdsDst, rt_util_pixtype_to_gdal_datatype(band->pixtype), NULL);
-	hbandDst = (VRTSourcedRasterBandH) GDALGetRasterBand(hdsDst, 1);
+	/* upper-left of the band in the offline raster's pixel space */
+	xoff = (int) -offset[0];
+	yoff = (int) -offset[1];
 
-	if (band->hasnodata)
-		GDALSetRasterNoDataValue(hbandDst, band->nodataval);
-
-	VRTAddSimpleSource(
-		hbandDst, GDALGetRasterBand(hdsSrc, band->data.offline.bandNum + 1),
-		fabs(offset[0]), fabs(offset[1]),
-		band->width, band->height,
-		0, 0,
-		band->width, band->height,
-		"near", VRT_NODATA_UNSET
-	);
-
-	/* make sure VRT reflects all changes */
-	VRTFlushCache(hdsDst);
-
-	/* convert VRT dataset to rt_raster */
-	_rast = rt_raster_from_gdal_dataset(hdsDst);
-
-	GDALClose(hdsDst);
-	GDALClose(hdsSrc);
-	/*
-	{
-		FILE *fp;
-		fp = fopen("/tmp/gdal_open_files.log", "w");
-		GDALDumpOpenDatasets(fp);
-		fclose(fp);
+	pixsize = rt_pixtype_size(band->pixtype);
+	size = (size_t) pixsize * band->width * band->height;
+	mem = (uint8_t *) rtalloc(size);
+	if (mem == NULL) {
+		rterror("rt_band_load_offline_data: Could not allocate memory for band data");
+		return ES_ERROR;
 	}
-	*/
 
-	if (_rast == NULL) {
-		rterror("rt_band_load_offline_data: Cannot load data from offline raster: %s", band->data.offline.path);
-		return ES_ERROR;
+	hash = _rt_outdb_block_hash(band, xoff, yoff);
+	block = _rt_outdb_block_find(band, xoff, yoff, hash);
+	if (block != NULL) {
+		RASTER_DEBUGF(4, "window (%d, %d) of %s found in cache", xoff, yoff, band->data.offline.path);
+		memcpy(mem, block->data, size);
 	}
+	else {
+		hbandSrc = GDALGetRasterBand(ds->hds, band->data.offline.bandNum + 1);
+		srcXSize = GDALGetRasterXSize(ds->hds);
+		srcYSize = GDALGetRasterYSize(ds->hds);
+
+		x0 = xoff < 0 ? 0 : xoff;
+		y0 = yoff < 0 ? 0 : yoff;
+		x1 = xoff + band->width > srcXSize ? srcXSize : xoff + band->width;
+		y1 = yoff + band->height > srcYSize ? srcYSize : yoff + band->height;
+
+		/* pixels outside of the offline raster are NODATA */
+		if (x0 != xoff || y0 != yoff || x1 - xoff != band->width || y1 - yoff != band->height) {
+			_rt_band_fill_mem(
+				mem, band->pixtype,
+				band->width * band->height,
+				band->hasnodata ? band->nodataval : 0
+			);
+		}
 
-	_band = rt_raster_get_band(_rast, 0);
-	if (_band == NULL) {
-		rterror("rt_band_load_offline_data: Cannot load data from offline raster: %s", band->data.offline.path);
-		rt_raster_destroy(_rast);
-		return ES_ERROR;
+		/* read the overlap straight into the band buffer */
+		if (x1 > x0 && y1 > y0) {
+			if (GDALRasterIO(
+				hbandSrc, GF_Read,
+				x0, y0, x1 - x0, y1 - y0,
+				mem + ((size_t) (y0 - yoff) * band->width + (x0 - xoff)) * pixsize,
+				x1 - x0, y1 - y0,
+				rt_util_pixtype_to_gdal_datatype(band->pixtype),
+				pixsize, pixsize * band->width
+			) != CE_None) {
+				rterror("rt_band_load_offline_data: Cannot load data from offline raster: %s", band->data.offline.path);
+				rtdealloc(mem);
+				return ES_ERROR;
+			}
+		}
+
+		_rt_outdb_block_add(band, xoff, yoff, hash, mem, size);
 	}
 
 	/* band->data.offline.mem not NULL, free first */
@@ -520,10 +885,7 @@ rt_band_load_offline_data(rt_band band) {
 		band->data.offline.mem = NULL;
 	}
 
-	band->data.offline.mem = _band->data.mem;
-
-	rtdealloc(_band); /* cannot use rt_band_destroy */
-	rt_raster_destroy(_rast);
+	band->data.offline.mem = mem;
 
 	return ES_NONE;
 }
@@ -1313,6 +1675,148 @@ rt_band_get_pixel(
 	return ES_NONE;
 }
 
+/**
+ * Get a run of pixel values of a row as doubles.  Unlike
+ * rt_band_get_pixel_line(), the run may extend beyond the band's
+ * extent.  Pixels outside of the extent are flagged as NODATA and
+ * set to the band's NODATA value or the minimum possible value of
+ * the pixel type if the band has no NODATA value.
+ *
+ * @param band : the band to get pixel values from
+ * @param x : pixel column of the first value (0-based)
+ * @param y : pixel row (0-based)
+ * @param len : the number of values to get
+ * @param *vals : array of len values to fill
+ * @param *nodata : array of len 0,1 NODATA flags to fill
+ *
+ * @return ES_NONE on success, ES_ERROR on error
+ */
+rt_errorstate
+rt_band_get_pixel_row(
+	rt_band band,
+	int x, int y,
+	uint32_t len,
+	double *vals, uint8_t *nodata
+) {
+	uint8_t *data = NULL;
+	double outval = 0;
+	uint32_t offset = 0;
+	int start = 0;
+	int end = 0;
+	int i = 0;
+
+	if (NULL == band) {
+		rterror("rt_band_get_pixel_row: band cannot be NULL.");
+		return ES_ERROR;
+	}
+
+	if (NULL == vals || NULL == nodata) {
+		rterror("rt_band_get_pixel_row: vals and nodata cannot be NULL.");
+		return ES_ERROR;
+	}
+
+	if (band->hasnodata)
+		outval = band->nodataval;
+	else
+		outval = rt_pixtype_get_min_value(band->pixtype);
+
+	/* part of the run within the band's extent */
+	start = 0;
+	end = 0;
+	if (y >= 0 && y < band->height && x < band->width && x + (int) len > 0) {
+		start = x < 0 ? -x : 0;
+		end = (x + (int) len > band->width) ? band->width - x : (int) len;
+	}
+
+	for (i = 0; i < start; i++) {
+		vals[i] = outval;
+		nodata[i] = 1;
+	}
+	for (i = (end > start ? end : start); i < (int) len; i++) {
+		vals[i] = outval;
+		nodata[i] = 1;
+	}
+	if (end <= start)
+		return ES_NONE;
+
+	/* band is NODATA */
+	if (band->isnodata) {
+		for (i = start; i < end; i++) {
+			vals[i] = band->nodataval;
+			nodata[i] = 1;
+		}
+		return ES_NONE;
+	}
+
+	data = rt_band_get_data(band);
+	if (data == NULL) {
+		rterror("rt_band_get_pixel_row: Cannot get band data");
+		return ES_ERROR;
+	}
+
+	offset = (x + start) + (y * band->width);
+
+	/* sub-byte pixel types are stored one per byte, as in rt_band_get_pixel() */
+	switch (band->pixtype) {
+		case PT_1BB:
+		case PT_2BUI:
+		case PT_4BUI:
+		case PT_8BSI: {
+			int8_t *ptr = (int8_t *) data + offset;
+			for (i = start; i < end; i++) vals[i] = *ptr++;
+			break;
+		}
+		case PT_8BUI: {
+			uint8_t *ptr = data + offset;
+			for (i = start; i < end; i++) vals[i] = *ptr++;
+			break;
+		}
+		case PT_16BSI: {
+			int16_t *ptr = (int16_t *) data + offset;
+			for (i = start; i < end; i++) vals[i] = *ptr++;
+			break;
+		}
+		case PT_16BUI: {
+			uint16_t *ptr = (uint16_t *) data + offset;
+			for (i = start; i < end; i++) vals[i] = *ptr++;
+			break;
+		}
+		case PT_32BSI: {
+			int32_t *ptr = (int32_t *) data + offset;
+			for (i = start; i < end; i++) vals[i] = *ptr++;
+			break;
+		}
+		case PT_32BUI: {
+			uint32_t *ptr = (uint32_t *) data + offset;
+			for (i = start; i < end; i++) vals[i] = *ptr++;
+			break;
+		}
+		case PT_32BF: {
+			float *ptr = (float *) data + offset;
+			for (i = start; i < end; i++) vals[i] = *ptr++;
+			break;
+		}
+		case PT_64BF: {
+			memcpy(vals + start, (double *) data + offset, sizeof(double) * (end - start));
+			break;
+		}
+		default: {
+			rterror("rt_band_get_pixel_row: Unknown pixeltype %d", band->pixtype);
+			return ES_ERROR;
+		}
+	}
+
+	/* set NODATA flags */
+	if (band->hasnodata) {
+		for (i = start; i < end; i++)
+			nodata[i] = rt_band_clamped_value_is_nodata(band, vals[i]) ? 1 : 0;
+	}
+	else
+		memset(nodata + start, 0, sizeof(uint8_t) * (end - start));
+
+	return ES_NONE;
+}
+
 /**
  * Get nearest pixel(s) with value (not NODATA) to specified pixel
  *
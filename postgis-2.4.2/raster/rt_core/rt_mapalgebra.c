@@ -423,6 +423,20 @@ struct _rti_iterator_arg_t {
 		int **nodata;
 	} empty;
 
+	/* rows of each raster covering the neighborhoods of an output row */
+	struct {
+		uint32_t rows;
+		uint32_t stride;
+		double **values;
+		uint8_t **nodata;
+	} rowbuf;
+
+	/* neighborhood of each raster passed to the callback */
+	struct {
+		double ***values;
+		int ***nodata;
+	} window;
+
 	rt_iterator_arg arg;
 };
 
@@ -459,6 +473,14 @@ _rti_iterator_arg_init() {
 	_param->empty.values = NULL;
 	_param->empty.nodata = NULL;
 
+	_param->rowbuf.rows = 0;
+	_param->rowbuf.stride = 0;
+	_param->rowbuf.values = NULL;
+	_param->rowbuf.nodata = NULL;
+
+	_param->window.values = NULL;
+	_param->window.nodata = NULL;
+
 	_param->arg = NULL;
 
 	return _param;
@@ -514,6 +536,43 @@ _rti_iterator_arg_destroy(_rti_iterator_arg _param) {
 		rtdealloc(_param->empty.nodata);
 	}
 
+	if (_param->rowbuf.values != NULL) {
+		for (i = 0; i < _param->count; i++) {
+			if (_param->rowbuf.values[i] != NULL)
+				rtdealloc(_param->rowbuf.values[i]);
+		}
+		rtdealloc(_param->rowbuf.values);
+	}
+	if (_param->rowbuf.nodata != NULL) {
+		for (i = 0; i < _param->count; i++) {
+			if (_param->rowbuf.nodata[i] != NULL)
+				rtdealloc(_param->rowbuf.nodata[i]);
+		}
+		rtdealloc(_param->rowbuf.nodata);
+	}
+
+	/* each window is a set of row pointers into one block */
+	if (_param->window.values != NULL) {
+		for (i = 0; i < _param->count; i++) {
+			if (_param->window.values[i] == NULL)
+				continue;
+			if (_param->window.values[i][0] != NULL)
+				rtdealloc(_param->window.values[i][0]);
+			rtdealloc(_param->window.values[i]);
+		}
+		rtdealloc(_param->window.values);
+	}
+	if (_param->window.nodata != NULL) {
+		for (i = 0; i < _param->count; i++) {
+			if (_param->window.nodata[i] == NULL)
+				continue;
+			if (_param->window.nodata[i][0] != NULL)
+				rtdealloc(_param->window.nodata[i][0]);
+			rtdealloc(_param->window.nodata[i]);
+		}
+		rtdealloc(_param->window.nodata);
+	}
+
 	if (_param->arg != NULL) {
 		if (_param->arg->values != NULL)
 			rtdealloc(_param->arg->values);
@@ -674,6 +733,20 @@ _rti_iterator_arg_populate(
 	return 1;
 }
 
+/*
+	empty raster
+	OR band does not exist and flag set to use NODATA
+	OR band is NODATA
+*/
+static int
+_rti_iterator_arg_isnodata(_rti_iterator_arg _param, int i) {
+	return (
+		_param->isempty[i] ||
+		_param->band.rtband[i] == NULL ||
+		_param->band.isnodata[i]
+	);
+}
+
 static int
 _rti_iterator_arg_empty_init(_rti_iterator_arg _param) {
 	int x = 0;
@@ -704,9 +777,90 @@ _rti_iterator_arg_empty_init(_rti_iterator_arg _param) {
 	return 1;
 }
 
+static int
+_rti_iterator_arg_rowbuf_init(_rti_iterator_arg _param, int width) {
+	int i = 0;
+	uint32_t size = 0;
+
+	_param->rowbuf.rows = _param->dimension.rows;
+	_param->rowbuf.stride = width + _param->distance.x * 2;
+	size = _param->rowbuf.rows * _param->rowbuf.stride;
+
+	_param->rowbuf.values = rtalloc(sizeof(double *) * _param->count);
+	_param->rowbuf.nodata = rtalloc(sizeof(uint8_t *) * _param->count);
+	if (_param->rowbuf.values == NULL || _param->rowbuf.nodata == NULL) {
+		rterror("_rti_iterator_arg_rowbuf_init: Could not allocate memory for row buffers");
+		return 0;
+	}
+	memset(_param->rowbuf.values, 0, sizeof(double *) * _param->count);
+	memset(_param->rowbuf.nodata, 0, sizeof(uint8_t *) * _param->count);
+
+	for (i = 0; i < _param->count; i++) {
+		_param->rowbuf.values[i] = rtalloc(sizeof(double) * size);
+		_param->rowbuf.nodata[i] = rtalloc(sizeof(uint8_t) * size);
+		if (_param->rowbuf.values[i] == NULL || _param->rowbuf.nodata[i] == NULL) {
+			rterror("_rti_iterator_arg_rowbuf_init: Could not allocate memory for elements of row buffers");
+			return 0;
+		}
+
+		/* NODATA until read */
+		memset(_param->rowbuf.values[i], 0, sizeof(double) * size);
+		memset(_param->rowbuf.nodata[i], 1, sizeof(uint8_t) * size);
+	}
+
+	return 1;
+}
+
+/*
+	read the rows of raster i covering the neighborhoods of output row y.
+	the rows of the previous output row are shifted up so that only the
+	last row is read, unless all is non-zero
+*/
+static int
+_rti_iterator_arg_rowbuf_read(_rti_iterator_arg _param, int i, int y, int all) {
+	uint32_t rows = _param->rowbuf.rows;
+	uint32_t stride = _param->rowbuf.stride;
+	double *values = _param->rowbuf.values[i];
+	uint8_t *nodata = _param->rowbuf.nodata[i];
+	int x0 = -((int) _param->offset[i][0]) - _param->distance.x;
+	int y0 = y - (int) _param->offset[i][1] - _param->distance.y;
+	uint32_t first = 0;
+	uint32_t r = 0;
+	uint32_t k = 0;
+
+	if (!all) {
+		first = rows - 1;
+		if (rows > 1) {
+			memmove(values, values + stride, sizeof(double) * stride * first);
+			memmove(nodata, nodata + stride, sizeof(uint8_t) * stride * first);
+		}
+	}
+
+	for (r = first; r < rows; r++) {
+		if (rt_band_get_pixel_row(
+			_param->band.rtband[i],
+			x0, y0 + r,
+			stride,
+			values + r * stride, nodata + r * stride
+		) != ES_NONE) {
+			rterror("_rti_iterator_arg_rowbuf_read: Could not get pixel values of row %d of raster %d", y0 + r, i);
+			return 0;
+		}
+	}
+
+	/* NODATA values are zero */
+	for (k = first * stride; k < rows * stride; k++) {
+		if (nodata[k])
+			values[k] = 0;
+	}
+
+	return 1;
+}
+
 static int
 _rti_iterator_arg_callback_init(_rti_iterator_arg _param) {
 	int i = 0;
+	uint32_t y = 0;
 
 	_param->arg = rtalloc(sizeof(struct rt_iterator_arg_t));
 	if (_param->arg == NULL) {
@@ -728,6 +882,7 @@ _rti_iterator_arg_callback_init(_rti_iterator_arg _param) {
 	}
 	memset(_param->arg->values, 0, sizeof(double **) * _param->count);
 	memset(_param->arg->nodata, 0, sizeof(int **) * _param->count);
+	memset(_param->arg->src_pixel, 0, sizeof(int *) * _param->count);
 
 	/* initialize pos */
 	for (i = 0; i < _param->count; i++) {
@@ -740,6 +895,37 @@ _rti_iterator_arg_callback_init(_rti_iterator_arg _param) {
 		memset(_param->arg->src_pixel[i], 0, sizeof(int) * 2);
 	}
 
+	/* neighborhoods, reused for every pixel */
+	_param->window.values = rtalloc(sizeof(double **) * _param->count);
+	_param->window.nodata = rtalloc(sizeof(int **) * _param->count);
+	if (_param->window.values == NULL || _param->window.nodata == NULL) {
+		rterror("_rti_iterator_arg_callback_init: Could not allocate memory for neighborhoods");
+		return 0;
+	}
+	memset(_param->window.values, 0, sizeof(double **) * _param->count);
+	memset(_param->window.nodata, 0, sizeof(int **) * _param->count);
+
+	for (i = 0; i < _param->count; i++) {
+		_param->window.values[i] = rtalloc(sizeof(double *) * _param->dimension.rows);
+		_param->window.nodata[i] = rtalloc(sizeof(int *) * _param->dimension.rows);
+		if (_param->window.values[i] == NULL || _param->window.nodata[i] == NULL) {
+			rterror("_rti_iterator_arg_callback_init: Could not allocate memory for neighborhoods");
+			return 0;
+		}
+
+		_param->window.values[i][0] = rtalloc(sizeof(double) * _param->dimension.rows * _param->dimension.columns);
+		_param->window.nodata[i][0] = rtalloc(sizeof(int) * _param->dimension.rows * _param->dimension.columns);
+		if (_param->window.values[i][0] == NULL || _param->window.nodata[i][0] == NULL) {
+			rterror("_rti_iterator_arg_callback_init: Could not allocate memory for neighborhoods");
+			return 0;
+		}
+
+		for (y = 1; y < _param->dimension.rows; y++) {
+			_param->window.values[i][y] = _param->window.values[i][0] + y * _param->dimension.columns;
+			_param->window.nodata[i][y] = _param->window.nodata[i][0] + y * _param->dimension.columns;
+		}
+	}
+
 	_param->arg->rasters = _param->count;
 	_param->arg->rows = _param->dimension.rows;
 	_param->arg->columns = _param->dimension.columns;
@@ -750,141 +936,101 @@ _rti_iterator_arg_callback_init(_rti_iterator_arg _param) {
 	return 1;
 }
 
+/*
+	copy the neighborhood of output pixel x of raster i from the row
+	buffer to the callback argument, applying the mask as
+	rt_pixel_set_to_array() does
+*/
 static void
-_rti_iterator_arg_callback_clean(_rti_iterator_arg _param) {
-	int i = 0;
-	int y = 0;
-
-	for (i = 0; i < _param->count; i++) {
-		RASTER_DEBUGF(5, "empty at @ %p", _param->empty.values);
-		RASTER_DEBUGF(5, "values at @ %p", _param->arg->values[i]);
-
-		if (_param->arg->values[i] == _param->empty.values) {
-			_param->arg->values[i] = NULL;
-			_param->arg->nodata[i] = NULL;
-
-			continue;
-		}
-
-		for (y = 0; y < _param->dimension.rows; y++) {
-			rtdealloc(_param->arg->values[i][y]);
-			rtdealloc(_param->arg->nodata[i][y]);
+_rti_iterator_arg_callback_fill(_rti_iterator_arg _param, int i, int x, rt_mask mask) {
+	uint32_t rows = _param->dimension.rows;
+	uint32_t columns = _param->dimension.columns;
+	double **values = _param->window.values[i];
+	int **nodata = _param->window.nodata[i];
+	const double *rowvalues = NULL;
+	const uint8_t *rownodata = NULL;
+	/* neighbors are only used if both distances are not zero */
+	int neighbors = (_param->distance.x > 0 && _param->distance.y > 0);
+	uint32_t r = 0;
+	uint32_t c = 0;
+
+	for (r = 0; r < rows; r++) {
+		rowvalues = _param->rowbuf.values[i] + r * _param->rowbuf.stride + x;
+		rownodata = _param->rowbuf.nodata[i] + r * _param->rowbuf.stride + x;
+
+		for (c = 0; c < columns; c++) {
+			if (
+				rownodata[c] ||
+				(!neighbors && (r != _param->distance.y || c != _param->distance.x))
+			) {
+				values[r][c] = 0;
+				nodata[r][c] = 1;
+			}
+			/* no mask */
+			else if (mask == NULL) {
+				values[r][c] = rowvalues[c];
+				nodata[r][c] = 0;
+			}
+			/* unweighted (boolean) mask */
+			else if (mask->weighted == 0) {
+				if (FLT_EQ(mask->values[r][c], 0) || mask->nodata[r][c] == 1) {
+					values[r][c] = 0;
+					nodata[r][c] = 1;
+				}
+				else {
+					values[r][c] = rowvalues[c];
+					nodata[r][c] = 0;
+				}
+			}
+			/* weighted mask */
+			else {
+				if (mask->nodata[r][c] == 1) {
+					values[r][c] = 0;
+					nodata[r][c] = 1;
+				}
+				else {
+					values[r][c] = rowvalues[c] * mask->values[r][c];
+					nodata[r][c] = 0;
+				}
+			}
 		}
-
-		rtdealloc(_param->arg->values[i]);
-		rtdealloc(_param->arg->nodata[i]);
-
-		_param->arg->values[i] = NULL;
-		_param->arg->nodata[i] = NULL;
 	}
+
+	_param->arg->values[i] = values;
+	_param->arg->nodata[i] = nodata;
 }
 
-/**
- * n-raster iterator.
- * The raster returned should be freed by the caller
- *
- * @param itrset : set of rt_iterator objects.
- * @param itrcount : number of objects in itrset.
- * @param extenttype : type of extent for the output raster.
- * @param customextent : raster specifying custom extent.
- * is only used if extenttype is ET_CUSTOM.
- * @param pixtype : the desired pixel type of the output raster's band.
- * @param hasnodata : indicates if the band has nodata value
- * @param nodataval : the nodata value, will be appropriately
- * truncated to fit the pixtype size.
- * @param distancex : the number of pixels around the specified pixel
- * along the X axis
- * @param distancey : the number of pixels around the specified pixel
- * along the Y axis
- * @param mask : the object of mask
- * @param userarg : pointer to any argument that is passed as-is to callback.
- * @param callback : callback function for actual processing of pixel values.
- * @param *rtnraster : return one band raster from iterator process
- *
- * The callback function _must_ have the following signature.
- *
- *    int FNAME(rt_iterator_arg arg, void *userarg, double *value, int *nodata)
- *
- * The callback function _must_ return zero (error) or non-zero (success)
- * indicating whether the function ran successfully.
- * The parameters passed to the callback function are as follows.
- *
- * - rt_iterator_arg arg: struct containing pixel values, NODATA flags and metadata
- * - void *userarg: NULL or calling function provides to rt_raster_iterator() for use by callback function
- * - double *value: value of pixel to be burned by rt_raster_iterator()
- * - int *nodata: flag (0 or 1) indicating that pixel to be burned is NODATA
- *
- * @return ES_NONE on success, ES_ERROR on error
- */
-rt_errorstate
-rt_raster_iterator(
+/*
+	check the input rasters, build the output raster with its one band
+	and compute the offsets of the input rasters.  if there is nothing
+	to iterate over, *rtnband is NULL and *rtnraster is what to return
+*/
+static rt_errorstate
+_rti_iterator_prepare(
+	_rti_iterator_arg _param,
 	rt_iterator itrset, uint16_t itrcount,
 	rt_extenttype extenttype, rt_raster customextent,
 	rt_pixtype pixtype,
 	uint8_t hasnodata, double nodataval,
 	uint16_t distancex, uint16_t distancey,
-	rt_mask mask,
-	void *userarg,
-	int (*callback)(
-		rt_iterator_arg arg,
-		void *userarg,
-		double *value,
-		int *nodata
-	),
-	rt_raster *rtnraster
+	rt_raster *rtnraster, rt_band *rtnband
 ) {
 	/* output raster */
 	rt_raster rtnrast = NULL;
-	/* output raster's band */
-	rt_band rtnband = NULL;
 
 	/* working raster */
 	rt_raster rast = NULL;
 
-	_rti_iterator_arg _param = NULL;
 	int allnull = 0;
 	int allempty = 0;
 	int aligned = 0;
 	double offset[4] = {0.};
-	rt_pixel npixels;
 
 	int i = 0;
 	int status = 0;
-	int inextent = 0;
-	int x = 0;
-	int y = 0;
-	int _x = 0;
-	int _y = 0;
-
-	int _width = 0;
-	int _height = 0;
-
-	double minval;
-	double value;
-	int isnodata;
-	int nodata;
 
-	RASTER_DEBUG(3, "Starting...");
-
-	//assert(itrset != NULL && itrcount > 0);
-	//assert(rtnraster != NULL);
-
-	if (NULL == rtnraster) {
-		rterror("rt_raster_iterator: rtnraster cannot be NULL.");
-	}
-
-	if (NULL == itrset || itrcount == 0) {
-		rterror("rt_raster_iterator: itrset cannot be NULL, itrcount cannot be 0.");
-	}
-
-	/* init rtnraster to NULL */
 	*rtnraster = NULL;
-
-	/* check that callback function is not NULL */
-	if (callback == NULL) {
-		rterror("rt_raster_iterator: Callback function not provided");
-		return ES_ERROR;
-	}
+	*rtnband = NULL;
 
 	/* check that custom extent is provided if extenttype = ET_CUSTOM */
 	if (extenttype == ET_CUSTOM && rt_raster_is_empty(customextent)) {
@@ -898,33 +1044,21 @@ rt_raster_iterator(
 		return ES_ERROR;
 	}
 
-	/* initialize _param */
-	if ((_param = _rti_iterator_arg_init()) == NULL) {
-		rterror("rt_raster_iterator: Could not initialize internal variables");
-		return ES_ERROR;
-	}
-
 	/* fill _param */
 	if (!_rti_iterator_arg_populate(_param, itrset, itrcount, distancex, distancey, &allnull, &allempty)) {
 		rterror("rt_raster_iterator: Could not populate for internal variables");
-		_rti_iterator_arg_destroy(_param);
 		return ES_ERROR;
 	}
 
 	/* shortcut if all null, return NULL */
 	if (allnull == itrcount) {
 		RASTER_DEBUG(3, "all rasters are NULL, returning NULL");
-
-		_rti_iterator_arg_destroy(_param);
-
 		return ES_NONE;
 	}
 	/* shortcut if all empty, return empty raster */
 	else if (allempty == itrcount) {
 		RASTER_DEBUG(3, "all rasters are empty, returning empty raster");
 
-		_rti_iterator_arg_destroy(_param);
-
 		rtnrast = rt_raster_new(0, 0);
 		if (rtnrast == NULL) {
 			rterror("rt_raster_iterator: Could not create empty raster");
@@ -960,9 +1094,6 @@ rt_raster_iterator(
 	/* no rasters found, SHOULD NEVER BE HERE! */
 	if (rast == NULL) {
 		rterror("rt_raster_iterator: Could not find reference raster to use for alignment tests");
-
-		_rti_iterator_arg_destroy(_param);
-
 		return ES_ERROR;
 	}
 
@@ -973,9 +1104,6 @@ rt_raster_iterator(
 		if (extenttype == ET_CUSTOM && rast != customextent) {
 			if (rt_raster_same_alignment(rast, customextent, &aligned, NULL) != ES_NONE) {
 				rterror("rt_raster_iterator: Could not test for alignment between reference raster and custom extent");
-
-				_rti_iterator_arg_destroy(_param);
-
 				return ES_ERROR;
 			}
 
@@ -991,9 +1119,6 @@ rt_raster_iterator(
 
 			if (rt_raster_same_alignment(rast, _param->raster[i], &aligned, NULL) != ES_NONE) {
 				rterror("rt_raster_iterator: Could not test for alignment between reference raster and raster %d", i);
-
-				_rti_iterator_arg_destroy(_param);
-
 				return ES_ERROR;
 			}
 			RASTER_DEBUGF(5, "raster at index %d alignment: %d", i, aligned);
@@ -1008,9 +1133,6 @@ rt_raster_iterator(
 	/* not aligned, error */
 	if (!aligned) {
 		rterror("rt_raster_iterator: The set of rasters provided (custom extent included, if appropriate) do not have the same alignment");
-
-		_rti_iterator_arg_destroy(_param);
-
 		return ES_ERROR;
 	}
 
@@ -1023,9 +1145,6 @@ rt_raster_iterator(
 			rtnrast = rtalloc(sizeof(struct rt_raster_t));
 			if (rtnrast == NULL) {
 				rterror("rt_raster_iterator: Could not allocate memory for output raster");
-
-				_rti_iterator_arg_destroy(_param);
-
 				return ES_ERROR;
 			}
 
@@ -1051,9 +1170,6 @@ rt_raster_iterator(
 					rterror("rt_raster_iterator: Could not compute %s extent of rasters",
 						extenttype == ET_UNION ? "union" : "intersection"
 					);
-
-					_rti_iterator_arg_destroy(_param);
-
 					return ES_ERROR;
 				}
 				else if (rt_raster_is_empty(rast)) {
@@ -1061,8 +1177,6 @@ rt_raster_iterator(
 						extenttype == ET_UNION ? "union" : "intersection"
 					);
 
-					_rti_iterator_arg_destroy(_param);
-
 					*rtnraster = rast;
 					return ES_NONE;
 				}
@@ -1094,9 +1208,6 @@ rt_raster_iterator(
 					(i == 0 ? "first" : (i == 1 ? "second" : "last")),
 					(i == 0 ? "FIRST" : (i == 1 ? "SECOND" : "LAST"))
 				);
-
-				_rti_iterator_arg_destroy(_param);
-
 				return ES_NONE;
 			}
 			/* input raster is empty, return empty raster */
@@ -1106,8 +1217,6 @@ rt_raster_iterator(
 					(i == 0 ? "FIRST" : (i == 1 ? "SECOND" : "LAST"))
 				);
 
-				_rti_iterator_arg_destroy(_param);
-
 				rtnrast = rt_raster_new(0, 0);
 				if (rtnrast == NULL) {
 					rterror("rt_raster_iterator: Could not create empty raster");
@@ -1123,9 +1232,6 @@ rt_raster_iterator(
 			rtnrast = rtalloc(sizeof(struct rt_raster_t));
 			if (rtnrast == NULL) {
 				rterror("rt_raster_iterator: Could not allocate memory for output raster");
-
-				_rti_iterator_arg_destroy(_param);
-
 				return ES_ERROR;
 			}
 
@@ -1143,12 +1249,9 @@ rt_raster_iterator(
 			break;
 	}
 
-	_width = rt_raster_get_width(rtnrast);
-	_height = rt_raster_get_height(rtnrast);
-
 	RASTER_DEBUGF(4, "rtnrast (width, height, ulx, uly, scalex, scaley, skewx, skewy, srid) = (%d, %d, %f, %f, %f, %f, %f, %f, %d)",
-		_width,
-		_height,
+		rt_raster_get_width(rtnrast),
+		rt_raster_get_height(rtnrast),
 		rt_raster_get_x_offset(rtnrast),
 		rt_raster_get_y_offset(rtnrast),
 		rt_raster_get_x_scale(rtnrast),
@@ -1161,10 +1264,7 @@ rt_raster_iterator(
 	/* init values and NODATA for use with empty rasters */
 	if (!_rti_iterator_arg_empty_init(_param)) {
 		rterror("rt_raster_iterator: Could not initialize empty values and NODATA");
-
-		_rti_iterator_arg_destroy(_param);
 		rt_raster_destroy(rtnrast);
-
 		return ES_ERROR;
 	}
 
@@ -1177,35 +1277,15 @@ rt_raster_iterator(
 		0
 	) < 0) {
 		rterror("rt_raster_iterator: Could not add new band to output raster");
-
-		_rti_iterator_arg_destroy(_param);
 		rt_raster_destroy(rtnrast);
-
 		return ES_ERROR;
 	}
 
 	/* get output band */
-	rtnband = rt_raster_get_band(rtnrast, 0);
-	if (rtnband == NULL) {
+	*rtnband = rt_raster_get_band(rtnrast, 0);
+	if (*rtnband == NULL) {
 		rterror("rt_raster_iterator: Could not get new band from output raster");
-
-		_rti_iterator_arg_destroy(_param);
-		rt_raster_destroy(rtnrast);
-
-		return ES_ERROR;
-	}
-
-	/* output band's minimum value */
-	minval = rt_band_get_min_value(rtnband);
-
-	/* initialize argument for callback function */
-	if (!_rti_iterator_arg_callback_init(_param)) {
-		rterror("rt_raster_iterator: Could not initialize callback function argument");
-
-		_rti_iterator_arg_destroy(_param);
-		rt_band_destroy(rtnband);
 		rt_raster_destroy(rtnrast);
-
 		return ES_ERROR;
 	}
 
@@ -1218,11 +1298,9 @@ rt_raster_iterator(
 		rtdealloc(rast);
 		if (status != ES_NONE) {
 			rterror("rt_raster_iterator: Could not compute raster offsets");
-
-			_rti_iterator_arg_destroy(_param);
-			rt_band_destroy(rtnband);
+			rt_band_destroy(*rtnband);
 			rt_raster_destroy(rtnrast);
-
+			*rtnband = NULL;
 			return ES_ERROR;
 		}
 
@@ -1231,156 +1309,217 @@ rt_raster_iterator(
 		RASTER_DEBUGF(4, "rast %d offset: %f %f", i, offset[2], offset[3]);
 	}
 
-	/* loop over each pixel (POI) of output raster */
-	/* _x,_y are for output raster */
-	/* x,y are for input raster */
-	for (_y = 0; _y < _height; _y++) {
-		for (_x = 0; _x < _width; _x++) {
-			RASTER_DEBUGF(4, "iterating output pixel (x, y) = (%d, %d)", _x, _y);
-			_param->arg->dst_pixel[0] = _x;
-			_param->arg->dst_pixel[1] = _y;
+	/* row buffers of input rasters */
+	if (!_rti_iterator_arg_rowbuf_init(_param, rt_raster_get_width(rtnrast))) {
+		rterror("rt_raster_iterator: Could not initialize row buffers");
+		rt_band_destroy(*rtnband);
+		rt_raster_destroy(rtnrast);
+		*rtnband = NULL;
+		return ES_ERROR;
+	}
 
-			/* loop through each input raster */
-			for (i = 0; i < itrcount; i++) {
-				RASTER_DEBUGF(4, "raster %d", i);
+	*rtnraster = rtnrast;
+	return ES_NONE;
+}
 
-				/*
-					empty raster
-					OR band does not exist and flag set to use NODATA
-					OR band is NODATA
-				*/
-				if (
-					_param->isempty[i] ||
-					(_param->band.rtband[i] == NULL && itrset[i].nbnodata) ||
-					_param->band.isnodata[i]
-				) {
-					RASTER_DEBUG(4, "empty raster, band does not exist or band is NODATA. using empty values and NODATA");
+/**
+ * n-raster iterator.
+ * The raster returned should be freed by the caller
+ *
+ * @param itrset : set of rt_iterator objects.
+ * @param itrcount : number of objects in itrset.
+ * @param extenttype : type of extent for the output raster.
+ * @param customextent : raster specifying custom extent.
+ * is only used if extenttype is ET_CUSTOM.
+ * @param pixtype : the desired pixel type of the output raster's band.
+ * @param hasnodata : indicates if the band has nodata value
+ * @param nodataval : the nodata value, will be appropriately
+ * truncated to fit the pixtype size.
+ * @param distancex : the number of pixels around the specified pixel
+ * along the X axis
+ * @param distancey : the number of pixels around the specified pixel
+ * along the Y axis
+ * @param mask : the object of mask
+ * @param userarg : pointer to any argument that is passed as-is to callback.
+ * @param callback : callback function for actual processing of pixel values.
+ * @param *rtnraster : return one band raster from iterator process
+ *
+ * The callback function _must_ have the following signature.
+ *
+ *    int FNAME(rt_iterator_arg arg, void *userarg, double *value, int *nodata)
+ *
+ * The callback function _must_ return zero (error) or non-zero (success)
+ * indicating whether the function ran successfully.
+ * The parameters passed to the callback function are as follows.
+ *
+ * - rt_iterator_arg arg: struct containing pixel values, NODATA flags and metadata
+ * - void *userarg: NULL or calling function provides to rt_raster_iterator() for use by callback function
+ * - double *value: value of pixel to be burned by rt_raster_iterator()
+ * - int *nodata: flag (0 or 1) indicating that pixel to be burned is NODATA
+ *
+ * @return ES_NONE on success, ES_ERROR on error
+ */
+rt_errorstate
+rt_raster_iterator(
+	rt_iterator itrset, uint16_t itrcount,
+	rt_extenttype extenttype, rt_raster customextent,
+	rt_pixtype pixtype,
+	uint8_t hasnodata, double nodataval,
+	uint16_t distancex, uint16_t distancey,
+	rt_mask mask,
+	void *userarg,
+	int (*callback)(
+		rt_iterator_arg arg,
+		void *userarg,
+		double *value,
+		int *nodata
+	),
+	rt_raster *rtnraster
+) {
+	/* output raster */
+	rt_raster rtnrast = NULL;
+	/* output raster's band */
+	rt_band rtnband = NULL;
 
-					x = _x;
-					y = _y;
+	_rti_iterator_arg _param = NULL;
 
-					_param->arg->values[i] = _param->empty.values;
-					_param->arg->nodata[i] = _param->empty.nodata;
+	int i = 0;
+	int status = 0;
+	int _x = 0;
+	int _y = 0;
 
-					continue;
-				}
+	int _width = 0;
+	int _height = 0;
 
-				/* input raster's X,Y */
-				x = _x - (int) _param->offset[i][0];
-				y = _y - (int) _param->offset[i][1];
-				RASTER_DEBUGF(4, "source pixel (x, y) = (%d, %d)", x, y);
+	double minval;
+	double value;
+	int nodata;
 
-				_param->arg->src_pixel[i][0] = x;
-				_param->arg->src_pixel[i][1] = y;
+	RASTER_DEBUG(3, "Starting...");
 
-				/* neighborhood */
-				npixels = NULL;
-				status = 0;
-				if (distancex > 0 && distancey > 0) {
-					RASTER_DEBUG(4, "getting neighborhood");
-
-					status = rt_band_get_nearest_pixel(
-						_param->band.rtband[i],
-						x, y,
-						distancex, distancey,
-						1,
-						&npixels
-					);
-					if (status < 0) {
-						rterror("rt_raster_iterator: Could not get pixel neighborhood");
+	//assert(itrset != NULL && itrcount > 0);
+	//assert(rtnraster != NULL);
 
-						_rti_iterator_arg_destroy(_param);
-						rt_band_destroy(rtnband);
-						rt_raster_destroy(rtnrast);
+	if (NULL == rtnraster) {
+		rterror("rt_raster_iterator: rtnraster cannot be NULL.");
+	}
 
-						return ES_ERROR;
-					}
-				}
+	if (NULL == itrset || itrcount == 0) {
+		rterror("rt_raster_iterator: itrset cannot be NULL, itrcount cannot be 0.");
+	}
 
-				/* get value of POI */
-				/* get pixel's value */
-				if (
-					(x >= 0 && x < _param->width[i]) &&
-					(y >= 0 && y < _param->height[i])
-				) {
-					RASTER_DEBUG(4, "getting value of POI");
-					if (rt_band_get_pixel(
-						_param->band.rtband[i],
-						x, y,
-						&value,
-						&isnodata
-					) != ES_NONE) {
-						rterror("rt_raster_iterator: Could not get the pixel value of band");
-
-						_rti_iterator_arg_destroy(_param);
-						rt_band_destroy(rtnband);
-						rt_raster_destroy(rtnrast);
-
-						return ES_ERROR;
-					}
-					inextent = 1;
-				}
-				/* outside band extent, set to NODATA */
-				else {
-					RASTER_DEBUG(4, "Outside band extent, setting value to NODATA");
-					/* has NODATA, use NODATA */
-					if (_param->band.hasnodata[i])
-						value = _param->band.nodataval[i];
-					/* no NODATA, use min possible value */
-					else
-						value = _param->band.minval[i];
+	/* init rtnraster to NULL */
+	*rtnraster = NULL;
 
-					inextent = 0;
-					isnodata = 1;
-				}
+	/* check that callback function is not NULL */
+	if (callback == NULL) {
+		rterror("rt_raster_iterator: Callback function not provided");
+		return ES_ERROR;
+	}
 
-				/* add pixel to neighborhood */
-				status++;
-				if (status > 1)
-					npixels = (rt_pixel) rtrealloc(npixels, sizeof(struct rt_pixel_t) * status);
-				else
-					npixels = (rt_pixel) rtalloc(sizeof(struct rt_pixel_t));
+	/* make sure that the mask matches the neighborhood */
+	if (mask != NULL) {
+		if (mask->dimx != distancex * 2 + 1 || mask->dimy != distancey * 2 + 1) {
+			rterror("rt_raster_iterator: mask dimensions %d x %d do not match given dims %d x %d",
+				mask->dimx, mask->dimy, distancex * 2 + 1, distancey * 2 + 1);
+			return ES_ERROR;
+		}
+
+		if (mask->values == NULL || mask->nodata == NULL) {
+			rterror("rt_raster_iterator: Invalid mask");
+			return ES_ERROR;
+		}
+	}
+
+	/* initialize _param */
+	if ((_param = _rti_iterator_arg_init()) == NULL) {
+		rterror("rt_raster_iterator: Could not initialize internal variables");
+		return ES_ERROR;
+	}
 
-				if (npixels == NULL) {
-					rterror("rt_raster_iterator: Could not reallocate memory for neighborhood");
+	if (_rti_iterator_prepare(
+		_param,
+		itrset, itrcount,
+		extenttype, customextent,
+		pixtype,
+		hasnodata, nodataval,
+		distancex, distancey,
+		&rtnrast, &rtnband
+	) != ES_NONE) {
+		_rti_iterator_arg_destroy(_param);
+		return ES_ERROR;
+	}
 
-					_rti_iterator_arg_destroy(_param);
-					rt_band_destroy(rtnband);
-					rt_raster_destroy(rtnrast);
+	/* nothing to iterate over */
+	if (rtnband == NULL) {
+		_rti_iterator_arg_destroy(_param);
 
-					return ES_ERROR;
-				}
+		*rtnraster = rtnrast;
+		return ES_NONE;
+	}
 
-				npixels[status - 1].x = x;
-				npixels[status - 1].y = y;
-				npixels[status - 1].nodata = 1;
-				npixels[status - 1].value = value;
+	_width = rt_raster_get_width(rtnrast);
+	_height = rt_raster_get_height(rtnrast);
 
-				/* set nodata flag */
-				if ((!_param->band.hasnodata[i] && inextent) || !isnodata) {
-					npixels[status - 1].nodata = 0;
-				}
-				RASTER_DEBUGF(4, "value, nodata: %f, %d", value, npixels[status - 1].nodata);
-
-				/* convert set of rt_pixel to 2D array */
-				status = rt_pixel_set_to_array(
-					npixels, status, mask,
-					x, y,
-					distancex, distancey,
-					&(_param->arg->values[i]),
-					&(_param->arg->nodata[i]),
-					NULL, NULL
-				);
-				rtdealloc(npixels);
-				if (status != ES_NONE) {
-					rterror("rt_raster_iterator: Could not create 2D array of neighborhood");
+	/* output band's minimum value */
+	minval = rt_band_get_min_value(rtnband);
 
-					_rti_iterator_arg_destroy(_param);
-					rt_band_destroy(rtnband);
-					rt_raster_destroy(rtnrast);
+	/* initialize argument for callback function */
+	if (!_rti_iterator_arg_callback_init(_param)) {
+		rterror("rt_raster_iterator: Could not initialize callback function argument");
 
-					return ES_ERROR;
+		_rti_iterator_arg_destroy(_param);
+		rt_band_destroy(rtnband);
+		rt_raster_destroy(rtnrast);
+
+		return ES_ERROR;
+	}
+
+	/* loop over each pixel (POI) of output raster */
+	/* _x,_y are for output raster */
+	for (_y = 0; _y < _height; _y++) {
+		/* read the rows of each input raster once for all pixels of the row */
+		for (i = 0; i < itrcount; i++) {
+			if (_rti_iterator_arg_isnodata(_param, i))
+				continue;
+
+			if (!_rti_iterator_arg_rowbuf_read(_param, i, _y, _y == 0)) {
+				rterror("rt_raster_iterator: Could not get pixel values of band");
+
+				_rti_iterator_arg_destroy(_param);
+				rt_band_destroy(rtnband);
+				rt_raster_destroy(rtnrast);
+
+				return ES_ERROR;
+			}
+		}
+
+		for (_x = 0; _x < _width; _x++) {
+			RASTER_DEBUGF(4, "iterating output pixel (x, y) = (%d, %d)", _x, _y);
+			_param->arg->dst_pixel[0] = _x;
+			_param->arg->dst_pixel[1] = _y;
+
+			/* loop through each input raster */
+			for (i = 0; i < itrcount; i++) {
+				RASTER_DEBUGF(4, "raster %d", i);
+
+				if (_rti_iterator_arg_isnodata(_param, i)) {
+					RASTER_DEBUG(4, "empty raster, band does not exist or band is NODATA. using empty values and NODATA");
+
+					_param->arg->values[i] = _param->empty.values;
+					_param->arg->nodata[i] = _param->empty.nodata;
+
+					continue;
 				}
+
+				/* input raster's X,Y */
+				_param->arg->src_pixel[i][0] = _x - (int) _param->offset[i][0];
+				_param->arg->src_pixel[i][1] = _y - (int) _param->offset[i][1];
+				RASTER_DEBUGF(4, "source pixel (x, y) = (%d, %d)",
+					_param->arg->src_pixel[i][0], _param->arg->src_pixel[i][1]);
+
+				/* neighborhood */
+				_rti_iterator_arg_callback_fill(_param, i, _x, mask);
 			}
 
 			/* callback */
@@ -1389,9 +1528,6 @@ rt_raster_iterator(
 			nodata = 0;
 			status = callback(_param->arg, userarg, &value, &nodata);
 
-			/* free memory from callback */
-			_rti_iterator_arg_callback_clean(_param);
-
 			/* handle callback status */
 			if (status == 0) {
 				rterror("rt_raster_iterator: Callback function returned an error");
@@ -1435,6 +1571,373 @@ rt_raster_iterator(
 	return ES_NONE;
 }
 
+/**
+ * Block n-raster iterator.
+ * The raster returned should be freed by the caller
+ *
+ * @param itrset : set of rt_iterator objects.
+ * @param itrcount : number of objects in itrset.
+ * @param extenttype : type of extent for the output raster.
+ * @param customextent : raster specifying custom extent.
+ * is only used if extenttype is ET_CUSTOM.
+ * @param pixtype : the desired pixel type of the output raster's band.
+ * @param hasnodata : indicates if the band has nodata value
+ * @param nodataval : the nodata value, will be appropriately
+ * truncated to fit the pixtype size.
+ * @param distancex : the number of pixels around the specified pixel
+ * along the X axis
+ * @param distancey : the number of pixels around the specified pixel
+ * along the Y axis
+ * @param userarg : pointer to any argument that is passed as-is to callback.
+ * @param callback : callback function processing a row of pixels.
+ * @param *rtnraster : return one band raster from iterator process
+ *
+ * @return ES_NONE on success, ES_ERROR on error
+ */
+rt_errorstate
+rt_raster_iterator_block(
+	rt_iterator itrset, uint16_t itrcount,
+	rt_extenttype extenttype, rt_raster customextent,
+	rt_pixtype pixtype,
+	uint8_t hasnodata, double nodataval,
+	uint16_t distancex, uint16_t distancey,
+	void *userarg,
+	int (*callback)(
+		rt_iterator_block_arg arg,
+		void *userarg,
+		double *values,
+		uint8_t *nodata
+	),
+	rt_raster *rtnraster
+) {
+	/* output raster */
+	rt_raster rtnrast = NULL;
+	/* output raster's band */
+	rt_band rtnband = NULL;
+
+	_rti_iterator_arg _param = NULL;
+	struct rt_iterator_block_arg_t arg;
+
+	double *values = NULL;
+	uint8_t *nodata = NULL;
+
+	int i = 0;
+	int status = 0;
+	int _x = 0;
+	int _y = 0;
+
+	int _width = 0;
+	int _height = 0;
+
+	double minval;
+
+	RASTER_DEBUG(3, "Starting...");
+
+	if (NULL == rtnraster) {
+		rterror("rt_raster_iterator_block: rtnraster cannot be NULL.");
+		return ES_ERROR;
+	}
+
+	if (NULL == itrset || itrcount == 0) {
+		rterror("rt_raster_iterator_block: itrset cannot be NULL, itrcount cannot be 0.");
+		return ES_ERROR;
+	}
+
+	/* init rtnraster to NULL */
+	*rtnraster = NULL;
+
+	/* check that callback function is not NULL */
+	if (callback == NULL) {
+		rterror("rt_raster_iterator_block: Callback function not provided");
+		return ES_ERROR;
+	}
+
+	/* initialize _param */
+	if ((_param = _rti_iterator_arg_init()) == NULL) {
+		rterror("rt_raster_iterator_block: Could not initialize internal variables");
+		return ES_ERROR;
+	}
+
+	if (_rti_iterator_prepare(
+		_param,
+		itrset, itrcount,
+		extenttype, customextent,
+		pixtype,
+		hasnodata, nodataval,
+		distancex, distancey,
+		&rtnrast, &rtnband
+	) != ES_NONE) {
+		_rti_iterator_arg_destroy(_param);
+		return ES_ERROR;
+	}
+
+	/* nothing to iterate over */
+	if (rtnband == NULL) {
+		_rti_iterator_arg_destroy(_param);
+
+		*rtnraster = rtnrast;
+		return ES_NONE;
+	}
+
+	_width = rt_raster_get_width(rtnrast);
+	_height = rt_raster_get_height(rtnrast);
+
+	/* output band's minimum value */
+	minval = rt_band_get_min_value(rtnband);
+
+	/* output row */
+	values = rtalloc(sizeof(double) * (_width > 0 ? _width : 1));
+	nodata = rtalloc(sizeof(uint8_t) * (_width > 0 ? _width : 1));
+	if (values == NULL || nodata == NULL) {
+		rterror("rt_raster_iterator_block: Could not allocate memory for output row");
+
+		if (values != NULL) rtdealloc(values);
+		if (nodata != NULL) rtdealloc(nodata);
+		_rti_iterator_arg_destroy(_param);
+		rt_band_destroy(rtnband);
+		rt_raster_destroy(rtnrast);
+
+		return ES_ERROR;
+	}
+
+	arg.rasters = itrcount;
+	arg.columns = _width;
+	arg.distancex = distancex;
+	arg.distancey = distancey;
+	arg.rows = _param->rowbuf.rows;
+	arg.stride = _param->rowbuf.stride;
+	arg.values = _param->rowbuf.values;
+	arg.nodata = _param->rowbuf.nodata;
+	arg.dst_row = 0;
+
+	for (_y = 0; _y < _height; _y++) {
+		RASTER_DEBUGF(4, "iterating output row %d", _y);
+
+		/* rows of rasters without values stay NODATA */
+		for (i = 0; i < itrcount; i++) {
+			if (_rti_iterator_arg_isnodata(_param, i))
+				continue;
+
+			if (!_rti_iterator_arg_rowbuf_read(_param, i, _y, _y == 0)) {
+				rterror("rt_raster_iterator_block: Could not get pixel values of band");
+				status = -1;
+				break;
+			}
+		}
+
+		if (status >= 0) {
+			arg.dst_row = _y;
+			memset(values, 0, sizeof(double) * _width);
+			memset(nodata, 0, sizeof(uint8_t) * _width);
+
+			if (!callback(&arg, userarg, values, nodata)) {
+				rterror("rt_raster_iterator_block: Callback function returned an error");
+				status = -1;
+			}
+		}
+
+		/* burn values to row */
+		for (_x = 0; status >= 0 && _x < _width; _x++) {
+			if (!nodata[_x])
+				status = rt_band_set_pixel(rtnband, _x, _y, values[_x], NULL);
+			else if (!hasnodata)
+				status = rt_band_set_pixel(rtnband, _x, _y, minval, NULL);
+
+			if (status != ES_NONE) {
+				rterror("rt_raster_iterator_block: Could not set pixel value");
+				status = -1;
+			}
+		}
+
+		if (status < 0) {
+			rtdealloc(values);
+			rtdealloc(nodata);
+			_rti_iterator_arg_destroy(_param);
+			rt_band_destroy(rtnband);
+			rt_raster_destroy(rtnrast);
+
+			return ES_ERROR;
+		}
+	}
+
+	rtdealloc(values);
+	rtdealloc(nodata);
+	_rti_iterator_arg_destroy(_param);
+
+	*rtnraster = rtnrast;
+	return ES_NONE;
+}
+
+/*
+	slope of the 3x3 neighborhoods of the first raster, NODATA neighbors
+	take the value of the center pixel
+*/
+static int
+_rti_kernel_slope(
+	rt_iterator_block_arg arg, rt_kernel kernel,
+	double *values, uint8_t *nodata
+) {
+	double v[3][3];
+	double dz_dx;
+	double dz_dy;
+	double slope;
+	const double *rowvalues;
+	const uint8_t *rownodata;
+	uint32_t x = 0;
+	int r = 0;
+	int c = 0;
+
+	if (arg->distancex != 1 || arg->distancey != 1) {
+		rterror("rt_raster_iterator_kernel: Slope requires a 3x3 neighborhood");
+		return 0;
+	}
+
+	for (x = 0; x < arg->columns; x++) {
+		/* center pixel is NODATA */
+		if (arg->nodata[0][arg->stride + x + 1]) {
+			nodata[x] = 1;
+			continue;
+		}
+
+		for (r = 0; r < 3; r++) {
+			rowvalues = arg->values[0] + r * arg->stride + x;
+			rownodata = arg->nodata[0] + r * arg->stride + x;
+
+			for (c = 0; c < 3; c++)
+				v[r][c] = rownodata[c] ? arg->values[0][arg->stride + x + 1] : rowvalues[c];
+		}
+
+		dz_dy = ((v[2][0] + v[2][1] + v[2][1] + v[2][2]) -
+			(v[0][0] + v[0][1] + v[0][1] + v[0][2])) / kernel->pixheight;
+		dz_dx = ((v[0][2] + v[1][2] + v[1][2] + v[2][2]) -
+			(v[0][0] + v[1][0] + v[1][0] + v[2][0])) / kernel->pixwidth;
+
+		slope = sqrt(dz_dx * dz_dx + dz_dy * dz_dy) / (8 * kernel->scale);
+
+		switch (kernel->units) {
+			case SU_PERCENT:
+				values[x] = 100.0 * slope;
+				break;
+			case SU_RADIANS:
+				values[x] = atan(slope);
+				break;
+			case SU_DEGREES:
+			default:
+				values[x] = atan(slope) * (180.0 / M_PI);
+				break;
+		}
+	}
+
+	return 1;
+}
+
+/**
+ * Built-in callback of rt_raster_iterator_block() computing the
+ * sum, mean, minimum, maximum or range of each neighborhood over
+ * all rasters, or the slope of the 3x3 neighborhood of the first
+ * raster.  userarg must be a rt_kernel.
+ *
+ * NODATA pixels are skipped unless the kernel has a substitute
+ * value.  The sum of a neighborhood without values is zero; the
+ * other statistics are NODATA.
+ *
+ * @return zero on error, non-zero on success
+ */
+int
+rt_raster_iterator_kernel(
+	rt_iterator_block_arg arg, void *userarg,
+	double *values, uint8_t *nodata
+) {
+	rt_kernel kernel = (rt_kernel) userarg;
+	uint32_t columns = 0;
+	uint32_t x = 0;
+	uint32_t r = 0;
+	uint32_t c = 0;
+	int z = 0;
+
+	const double *rowvalues;
+	const uint8_t *rownodata;
+	double val;
+	double sum;
+	double min;
+	double max;
+	uint32_t count;
+
+	if (arg == NULL || kernel == NULL) {
+		rterror("rt_raster_iterator_kernel: arg and userarg cannot be NULL");
+		return 0;
+	}
+
+	if (kernel->type == KT_SLOPE)
+		return _rti_kernel_slope(arg, kernel, values, nodata);
+
+	/* width of a neighborhood */
+	columns = arg->distancex * 2 + 1;
+
+	for (x = 0; x < arg->columns; x++) {
+		sum = 0;
+		min = INFINITY;
+		max = -INFINITY;
+		count = 0;
+
+		for (z = 0; z < arg->rasters; z++) {
+			for (r = 0; r < arg->rows; r++) {
+				rowvalues = arg->values[z] + r * arg->stride + x;
+				rownodata = arg->nodata[z] + r * arg->stride + x;
+
+				for (c = 0; c < columns; c++) {
+					if (!rownodata[c])
+						val = rowvalues[c];
+					else if (kernel->hassubstitute)
+						val = kernel->substitute;
+					else
+						continue;
+
+					sum += val;
+					if (val < min) min = val;
+					if (val > max) max = val;
+					count++;
+				}
+			}
+		}
+
+		switch (kernel->type) {
+			case KT_SUM:
+				values[x] = sum;
+				break;
+			case KT_MEAN:
+				if (count < 1)
+					nodata[x] = 1;
+				else
+					values[x] = sum / count;
+				break;
+			case KT_MIN:
+				if (min == INFINITY)
+					nodata[x] = 1;
+				else
+					values[x] = min;
+				break;
+			case KT_MAX:
+				if (max == -INFINITY)
+					nodata[x] = 1;
+				else
+					values[x] = max;
+				break;
+			case KT_RANGE:
+				if (min == INFINITY || max == -INFINITY)
+					nodata[x] = 1;
+				else
+					values[x] = max - min;
+				break;
+			default:
+				rterror("rt_raster_iterator_kernel: Unknown kernel type %d", kernel->type);
+				return 0;
+		}
+	}
+
+	return 1;
+}
+
 /******************************************************************************
 * rt_raster_colormap()
 ******************************************************************************/
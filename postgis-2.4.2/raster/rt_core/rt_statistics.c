@@ -398,27 +398,14 @@ rt_band_get_summary_stats(
 * rt_band_get_histogram()
 ******************************************************************************/
 
-/**
- * Count the distribution of data
- *
- * @param stats : a populated stats struct for processing
- * @param bin_count : the number of bins to group the data by
- * @param bin_width : the width of each bin as an array
- * @param bin_width_count : number of values in bin_width
- * @param right : evaluate bins by (a,b] rather than default [a,b)
- * @param min : user-defined minimum value of the histogram
- *   a value less than the minimum value is not counted in any bins
- *   if min = max, min and max are not used
- * @param max : user-defined maximum value of the histogram
- *   a value greater than the max value is not counted in any bins
- *   if min = max, min and max are not used
- * @param rtn_count : set to the number of bins being returned
- *
- * @return the histogram of the data or NULL
- */
-rt_histogram
-rt_band_get_histogram(
-	rt_bandstats stats,
+/*
+	bin values (each counted weights[i] times if weights is not NULL)
+	summarized by count, vmin and vmax
+*/
+static rt_histogram
+_rt_get_histogram(
+	uint32_t count, double vmin, double vmax,
+	double *values, double *weights, uint32_t values_count,
 	int bin_count, double *bin_width, int bin_width_count,
 	int right, double min, double max,
 	uint32_t *rtn_count
@@ -427,36 +414,14 @@ rt_band_get_histogram(
 	int init_width = 0;
 	int i;
 	int j;
+	uint32_t k;
 	double tmp;
 	double value;
-	int sum = 0;
+	uint32_t w;
+	uint32_t sum = 0;
 	double qmin;
 	double qmax;
 
-#if POSTGIS_DEBUG_LEVEL > 0
-	clock_t start, stop;
-	double elapsed = 0;
-#endif
-
-	RASTER_DEBUG(3, "starting");
-#if POSTGIS_DEBUG_LEVEL > 0
-	start = clock();
-#endif
-
-	//assert(NULL != stats);
-	//assert(NULL != rtn_count);
-	if (NULL == stats) {
-		rterror("rt_band_get_histogram: stats cannot be NULL");
-	}
-	if (NULL == rtn_count) {
-		rterror("rt_band_get_histogram: rtn_count cannot be NULL");
-	}
-
-	if (stats->count < 1 || NULL == stats->values) {
-		rterror("rt_util_get_histogram: rt_bandstats object has no value");
-		return NULL;
-	}
-
 	/* bin width must be positive numbers and not zero */
 	if (NULL != bin_width && bin_width_count > 0) {
 		for (i = 0; i < bin_width_count; i++) {
@@ -469,8 +434,8 @@ rt_band_get_histogram(
 
 	/* ignore min and max parameters */
 	if (FLT_EQ(max, min)) {
-		qmin = stats->min;
-		qmax = stats->max;
+		qmin = vmin;
+		qmax = vmax;
 	}
 	else {
 		qmin = min;
@@ -489,12 +454,12 @@ rt_band_get_histogram(
 
 			all computed bins are assumed to have equal width
 		*/
-		/* Square-root choice for stats->count < 30 */
-		if (stats->count < 30)
-			bin_count = ceil(sqrt(stats->count));
-		/* Sturges' formula for stats->count >= 30 */
+		/* Square-root choice for count < 30 */
+		if (count < 30)
+			bin_count = ceil(sqrt(count));
+		/* Sturges' formula for count >= 30 */
 		else
-			bin_count = ceil(log2((double) stats->count) + 1.);
+			bin_count = ceil(log2((double) count) + 1.);
 
 		/* bin_width_count provided and bin_width has value */
 		if (bin_width_count > 0 && NULL != bin_width) {
@@ -528,7 +493,7 @@ rt_band_get_histogram(
 			return NULL;
 		}
 
-		bins->count = stats->count;
+		bins->count = count;
 		bins->percent = -1;
 		bins->min = qmin;
 		bins->max = qmax;
@@ -610,8 +575,9 @@ rt_band_get_histogram(
 	}
 
 	/* process the values */
-	for (i = 0; i < stats->count; i++) {
-		value = stats->values[i];
+	for (k = 0; k < values_count; k++) {
+		value = values[k];
+		w = (weights != NULL) ? (uint32_t) weights[k] : 1;
 
 		/* default, [a, b) */
 		if (!right) {
@@ -624,8 +590,8 @@ rt_band_get_histogram(
 						)
 					)
 				) {
-					bins[j].count++;
-					sum++;
+					bins[j].count += w;
+					sum += w;
 					break;
 				}
 			}
@@ -641,23 +607,19 @@ rt_band_get_histogram(
 						)
 					)
 				) {
-					bins[j].count++;
-					sum++;
+					bins[j].count += w;
+					sum += w;
 					break;
 				}
 			}
 		}
 	}
 
-	for (i = 0; i < bin_count; i++) {
-		bins[i].percent = ((double) bins[i].count) / sum;
+	for (j = 0; j < bin_count; j++) {
+		bins[j].percent = ((double) bins[j].count) / sum;
 	}
 
 #if POSTGIS_DEBUG_LEVEL > 0
-	stop = clock();
-	elapsed = ((double) (stop - start)) / CLOCKS_PER_SEC;
-	RASTER_DEBUGF(3, "elapsed time = %0.4f", elapsed);
-
 	for (j = 0; j < bin_count; j++) {
 		RASTER_DEBUGF(5, "(min, max, inc_min, inc_max, count, sum, percent) = (%f, %f, %d, %d, %d, %d, %f)",
 			bins[j].min, bins[j].max, bins[j].inc_min, bins[j].inc_max, bins[j].count, sum, bins[j].percent);
@@ -666,6 +628,74 @@ rt_band_get_histogram(
 
 	if (init_width) rtdealloc(bin_width);
 	*rtn_count = bin_count;
+	return bins;
+}
+
+/**
+ * Count the distribution of data
+ *
+ * @param stats : a populated stats struct for processing
+ * @param bin_count : the number of bins to group the data by
+ * @param bin_width : the width of each bin as an array
+ * @param bin_width_count : number of values in bin_width
+ * @param right : evaluate bins by (a,b] rather than default [a,b)
+ * @param min : user-defined minimum value of the histogram
+ *   a value less than the minimum value is not counted in any bins
+ *   if min = max, min and max are not used
+ * @param max : user-defined maximum value of the histogram
+ *   a value greater than the max value is not counted in any bins
+ *   if min = max, min and max are not used
+ * @param rtn_count : set to the number of bins being returned
+ *
+ * @return the histogram of the data or NULL
+ */
+rt_histogram
+rt_band_get_histogram(
+	rt_bandstats stats,
+	int bin_count, double *bin_width, int bin_width_count,
+	int right, double min, double max,
+	uint32_t *rtn_count
+) {
+	rt_histogram bins = NULL;
+
+#if POSTGIS_DEBUG_LEVEL > 0
+	clock_t start, stop;
+	double elapsed = 0;
+#endif
+
+	RASTER_DEBUG(3, "starting");
+#if POSTGIS_DEBUG_LEVEL > 0
+	start = clock();
+#endif
+
+	//assert(NULL != stats);
+	//assert(NULL != rtn_count);
+	if (NULL == stats) {
+		rterror("rt_band_get_histogram: stats cannot be NULL");
+	}
+	if (NULL == rtn_count) {
+		rterror("rt_band_get_histogram: rtn_count cannot be NULL");
+	}
+
+	if (stats->count < 1 || NULL == stats->values) {
+		rterror("rt_util_get_histogram: rt_bandstats object has no value");
+		return NULL;
+	}
+
+	bins = _rt_get_histogram(
+		stats->count, stats->min, stats->max,
+		stats->values, NULL, stats->count,
+		bin_count, bin_width, bin_width_count,
+		right, min, max,
+		rtn_count
+	);
+
+#if POSTGIS_DEBUG_LEVEL > 0
+	stop = clock();
+	elapsed = ((double) (stop - start)) / CLOCKS_PER_SEC;
+	RASTER_DEBUGF(3, "elapsed time = %0.4f", elapsed);
+#endif
+
 	RASTER_DEBUG(3, "done");
 	return bins;
 }
@@ -1619,6 +1649,721 @@ rt_band_get_quantiles_stream(
 	return rtn;
 }
 
+/******************************************************************************
+* rt_statsacc
+******************************************************************************/
+
+/**
+ * Create a statistics accumulator collecting count, sum, min, max
+ * and standard deviation in one pass over any number of bands
+ *
+ * @param sketch : if non-zero, also keep a t-digest of the values
+ *   so that quantiles and histograms can be computed
+ *
+ * @return new accumulator or NULL on error
+ */
+rt_statsacc
+rt_statsacc_new(int sketch) {
+	rt_statsacc acc = NULL;
+
+	acc = (rt_statsacc) rtalloc(sizeof(struct rt_statsacc_t));
+	if (NULL == acc) {
+		rterror("rt_statsacc_new: Could not allocate memory for accumulator");
+		return NULL;
+	}
+
+	acc->count = 0;
+	acc->min = acc->max = 0;
+	acc->sum = 0;
+	acc->M = 0;
+	acc->Q = 0;
+
+	acc->sketch = sketch ? 1 : 0;
+	acc->centroids_count = 0;
+	acc->buffer_count = 0;
+
+	return acc;
+}
+
+/**
+ * Destroy a statistics accumulator
+ *
+ * @param acc : the accumulator to destroy
+ */
+void
+rt_statsacc_destroy(rt_statsacc acc) {
+	if (NULL == acc)
+		return;
+
+	rtdealloc(acc);
+}
+
+static int
+_rt_statsacc_centroid_cmp(const void *a, const void *b) {
+	double ma = ((const struct rt_statsacc_centroid_t *) a)->mean;
+	double mb = ((const struct rt_statsacc_centroid_t *) b)->mean;
+
+	if (ma < mb)
+		return -1;
+	else if (ma > mb)
+		return 1;
+	return 0;
+}
+
+/* k1 scale function of the t-digest */
+static double
+_rt_statsacc_k(double q) {
+	if (q < 0) q = 0;
+	else if (q > 1) q = 1;
+
+	return (RT_STATSACC_COMPRESSION / (2. * M_PI)) * asin((2. * q) - 1.);
+}
+
+/* inverse of the k1 scale function */
+static double
+_rt_statsacc_kinv(double k) {
+	if (k >= RT_STATSACC_COMPRESSION / 4.)
+		return 1;
+
+	return (sin(k * (2. * M_PI) / RT_STATSACC_COMPRESSION) + 1.) / 2.;
+}
+
+/*
+	merge the buffer into the centroids
+
+	once this has happened, the digest no longer holds the exact values
+*/
+static void
+_rt_statsacc_compress(rt_statsacc acc) {
+	struct rt_statsacc_centroid_t all[RT_STATSACC_CENTROIDS + RT_STATSACC_BUFFER];
+	struct rt_statsacc_centroid_t cur;
+	uint32_t count = 0;
+	uint32_t i = 0;
+	double total = 0;
+	double sofar = 0;
+	double limit = 0;
+
+	if (!acc->buffer_count)
+		return;
+
+	count = acc->centroids_count;
+	memcpy(all, acc->centroids, sizeof(struct rt_statsacc_centroid_t) * count);
+	memcpy(all + count, acc->buffer, sizeof(struct rt_statsacc_centroid_t) * acc->buffer_count);
+	count += acc->buffer_count;
+	acc->buffer_count = 0;
+
+	qsort(all, count, sizeof(struct rt_statsacc_centroid_t), _rt_statsacc_centroid_cmp);
+	for (i = 0; i < count; i++)
+		total += all[i].weight;
+
+	acc->centroids_count = 0;
+	cur = all[0];
+	limit = total * _rt_statsacc_kinv(_rt_statsacc_k(0) + 1);
+	for (i = 1; i < count; i++) {
+		/* a centroid may span one unit of k, the last one takes what is left */
+		if (
+			sofar + cur.weight + all[i].weight <= limit ||
+			acc->centroids_count == RT_STATSACC_CENTROIDS - 1
+		) {
+			cur.weight += all[i].weight;
+			cur.mean += (all[i].mean - cur.mean) * all[i].weight / cur.weight;
+		}
+		else {
+			acc->centroids[acc->centroids_count++] = cur;
+			sofar += cur.weight;
+			limit = total * _rt_statsacc_kinv(_rt_statsacc_k(sofar / total) + 1);
+			cur = all[i];
+		}
+	}
+	acc->centroids[acc->centroids_count++] = cur;
+
+	RASTER_DEBUGF(4, "compressed %d values to %d centroids", count, acc->centroids_count);
+}
+
+static void
+_rt_statsacc_push(rt_statsacc acc, double mean, double weight) {
+	acc->buffer[acc->buffer_count].mean = mean;
+	acc->buffer[acc->buffer_count].weight = weight;
+	if (++(acc->buffer_count) == RT_STATSACC_BUFFER)
+		_rt_statsacc_compress(acc);
+}
+
+/*
+	sorted centroids of the digest
+
+	while the digest has never been compressed, the buffer holds the
+	exact values (with their counts) and is only sorted
+*/
+static struct rt_statsacc_centroid_t *
+_rt_statsacc_sorted(rt_statsacc acc, uint32_t *count) {
+	if (!acc->centroids_count) {
+		qsort(acc->buffer, acc->buffer_count, sizeof(struct rt_statsacc_centroid_t), _rt_statsacc_centroid_cmp);
+		*count = acc->buffer_count;
+		return acc->buffer;
+	}
+
+	_rt_statsacc_compress(acc);
+	*count = acc->centroids_count;
+	return acc->centroids;
+}
+
+/*
+	value at quantile q of the sorted centroids
+*/
+static double
+_rt_statsacc_quantile(
+	rt_statsacc acc,
+	struct rt_statsacc_centroid_t *c, uint32_t count,
+	double q
+) {
+	double h = (acc->count - 1.) * q;
+	double cb = 0;
+	double x0;
+	double y0;
+	double x1;
+	double y1;
+	double hl;
+	uint32_t i = 0;
+
+	/* exact values, same formula as rt_band_get_quantiles */
+	if (!acc->centroids_count) {
+		hl = floor(h);
+
+		while (i < count - 1 && cb + c[i].weight - 1 < hl)
+			cb += c[i++].weight;
+		y0 = c[i].mean;
+		if (h <= hl)
+			return y0;
+
+		/* next position may be in the next set of values */
+		if (hl + 1 > cb + c[i].weight - 1 && i < count - 1)
+			y1 = c[i + 1].mean;
+		else
+			y1 = y0;
+
+		return y0 + ((h - hl) * (y1 - y0));
+	}
+
+	/*
+		interpolate between the centroids placed at the middle of the
+		positions they cover, and the extremes at the first and last positions
+	*/
+	x0 = 0;
+	y0 = acc->min;
+	for (i = 0; i < count; i++) {
+		x1 = cb + ((c[i].weight - 1.) / 2.);
+		y1 = c[i].mean;
+		if (h <= x1)
+			return (x1 > x0) ? y0 + (((h - x0) / (x1 - x0)) * (y1 - y0)) : y1;
+
+		cb += c[i].weight;
+		x0 = x1;
+		y0 = y1;
+	}
+
+	x1 = acc->count - 1.;
+	y1 = acc->max;
+	return (x1 > x0) ? y0 + (((h - x0) / (x1 - x0)) * (y1 - y0)) : y1;
+}
+
+/*
+	number of values less than (or equal to if inclusive) value
+	estimated by inverting the interpolation of _rt_statsacc_quantile()
+*/
+static double
+_rt_statsacc_rank(
+	rt_statsacc acc,
+	struct rt_statsacc_centroid_t *c, uint32_t count,
+	double value, int inclusive
+) {
+	double cb = 0;
+	double x0 = 0;
+	double y0 = acc->min;
+	double x1;
+	double y1;
+	double p;
+	uint32_t i;
+
+	if (value < acc->min || (!inclusive && FLT_EQ(value, acc->min)))
+		return 0;
+	if (value > acc->max || (inclusive && FLT_EQ(value, acc->max)))
+		return acc->count;
+
+	for (i = 0; i <= count; i++) {
+		if (i < count) {
+			x1 = cb + ((c[i].weight - 1.) / 2.);
+			y1 = c[i].mean;
+		}
+		else {
+			x1 = acc->count - 1.;
+			y1 = acc->max;
+		}
+
+		if (value < y1 || (!inclusive && FLT_EQ(value, y1))) {
+			p = (y1 > y0) ? x0 + (((value - y0) / (y1 - y0)) * (x1 - x0)) : x0;
+			return inclusive ? p + 1 : p;
+		}
+
+		if (i < count)
+			cb += c[i].weight;
+		x0 = x1;
+		y0 = y1;
+	}
+
+	return acc->count;
+}
+
+/**
+ * Add a value to a statistics accumulator
+ *
+ * @param acc : the accumulator to add to
+ * @param value : the value to add
+ * @param count : the number of times value is added
+ */
+void
+rt_statsacc_add(rt_statsacc acc, double value, uint32_t count) {
+	uint64_t n;
+	double delta;
+
+	if (!count)
+		return;
+
+	/* min/max */
+	if (acc->count < 1)
+		acc->min = acc->max = value;
+	else if (value < acc->min)
+		acc->min = value;
+	else if (value > acc->max)
+		acc->max = value;
+
+	/* one-pass standard deviation of count values at once */
+	n = acc->count + count;
+	delta = value - acc->M;
+	acc->M += (delta * count) / n;
+	acc->Q += (delta * delta * acc->count * count) / n;
+
+	acc->count = n;
+	acc->sum += value * count;
+
+	if (acc->sketch)
+		_rt_statsacc_push(acc, value, count);
+}
+
+/**
+ * Add the values of a band to a statistics accumulator
+ *
+ * @param acc : the accumulator to add to
+ * @param band : the band to add
+ * @param exclude_nodata_value : if non-zero, ignore nodata values
+ * @param sample : percentage of pixels to sample
+ *
+ * @return ES_NONE on success, ES_ERROR on error
+ */
+rt_errorstate
+rt_statsacc_add_band(
+	rt_statsacc acc, rt_band band,
+	int exclude_nodata_value, double sample
+) {
+	rt_bandstats stats = NULL;
+	double nodata = 0;
+	double *values = NULL;
+	uint8_t *isnodata = NULL;
+	uint32_t x = 0;
+	uint32_t y = 0;
+
+	if (NULL == acc) {
+		rterror("rt_statsacc_add_band: Accumulator cannot be NULL");
+		return ES_ERROR;
+	}
+	if (NULL == band) {
+		rterror("rt_statsacc_add_band: Band cannot be NULL");
+		return ES_ERROR;
+	}
+
+	/* band is empty */
+	if (band->width < 1 || band->height < 1)
+		return ES_NONE;
+
+	if (rt_band_get_hasnodata_flag(band))
+		rt_band_get_nodata(band, &nodata);
+	else
+		exclude_nodata_value = 0;
+
+	/* entire band is nodata */
+	if (rt_band_get_isnodata_flag(band)) {
+		if (!exclude_nodata_value)
+			rt_statsacc_add(acc, nodata, band->width * band->height);
+		return ES_NONE;
+	}
+
+	/* sample the same pixels as rt_band_get_summary_stats() */
+	if (
+		(sample > 0 && !FLT_EQ(sample, 0.0)) &&
+		(sample < 1 && !FLT_EQ(sample, 1.0))
+	) {
+		stats = rt_band_get_summary_stats(band, exclude_nodata_value, sample, 1, NULL, NULL, NULL);
+		if (NULL == stats) {
+			rterror("rt_statsacc_add_band: Could not sample band");
+			return ES_ERROR;
+		}
+
+		for (x = 0; x < stats->count; x++)
+			rt_statsacc_add(acc, stats->values[x], 1);
+
+		if (NULL != stats->values)
+			rtdealloc(stats->values);
+		rtdealloc(stats);
+
+		return ES_NONE;
+	}
+
+	values = rtalloc(sizeof(double) * band->width);
+	isnodata = rtalloc(sizeof(uint8_t) * band->width);
+	if (NULL == values || NULL == isnodata) {
+		rterror("rt_statsacc_add_band: Could not allocate memory for row of band");
+		if (NULL != values) rtdealloc(values);
+		if (NULL != isnodata) rtdealloc(isnodata);
+		return ES_ERROR;
+	}
+
+	for (y = 0; y < band->height; y++) {
+		if (rt_band_get_pixel_row(band, 0, y, band->width, values, isnodata) != ES_NONE) {
+			rterror("rt_statsacc_add_band: Could not get row %d of band", y);
+			rtdealloc(values);
+			rtdealloc(isnodata);
+			return ES_ERROR;
+		}
+
+		for (x = 0; x < band->width; x++) {
+			if (exclude_nodata_value && isnodata[x])
+				continue;
+			rt_statsacc_add(acc, values[x], 1);
+		}
+	}
+
+	rtdealloc(values);
+	rtdealloc(isnodata);
+
+	return ES_NONE;
+}
+
+/**
+ * Merge one statistics accumulator into another. Both accumulators
+ * must have been created with the same sketch flag
+ *
+ * @param acc : the accumulator to merge into
+ * @param other : the accumulator to merge from
+ *
+ * @return ES_NONE on success, ES_ERROR on error
+ */
+rt_errorstate
+rt_statsacc_merge(rt_statsacc acc, rt_statsacc other) {
+	uint64_t n;
+	double delta;
+	uint32_t i;
+
+	if (NULL == acc || NULL == other) {
+		rterror("rt_statsacc_merge: Accumulators cannot be NULL");
+		return ES_ERROR;
+	}
+	if (acc->sketch != other->sketch) {
+		rterror("rt_statsacc_merge: Cannot merge accumulators with and without sketch");
+		return ES_ERROR;
+	}
+
+	if (other->count < 1)
+		return ES_NONE;
+
+	/* min/max */
+	if (acc->count < 1) {
+		acc->min = other->min;
+		acc->max = other->max;
+	}
+	else {
+		if (other->min < acc->min)
+			acc->min = other->min;
+		if (other->max > acc->max)
+			acc->max = other->max;
+	}
+
+	/* pairwise combination of the one-pass standard deviations */
+	n = acc->count + other->count;
+	delta = other->M - acc->M;
+	acc->M += (delta * other->count) / n;
+	acc->Q += other->Q + ((delta * delta * acc->count * other->count) / n);
+
+	acc->count = n;
+	acc->sum += other->sum;
+
+	if (!acc->sketch)
+		return ES_NONE;
+
+	for (i = 0; i < other->centroids_count; i++)
+		_rt_statsacc_push(acc, other->centroids[i].mean, other->centroids[i].weight);
+	for (i = 0; i < other->buffer_count; i++)
+		_rt_statsacc_push(acc, other->buffer[i].mean, other->buffer[i].weight);
+
+	/* centroids of other are not exact values */
+	if (other->centroids_count)
+		_rt_statsacc_compress(acc);
+
+	return ES_NONE;
+}
+
+/**
+ * Get the summary statistics of a statistics accumulator
+ *
+ * @param acc : the accumulator to query
+ * @param sample : percentage of pixels sampled. If between 0 and 1,
+ *   stddev is the sample standard deviation
+ *
+ * @return the summary statistics (values is always NULL) or NULL
+ */
+rt_bandstats
+rt_statsacc_get_stats(rt_statsacc acc, double sample) {
+	rt_bandstats stats = NULL;
+
+	if (NULL == acc) {
+		rterror("rt_statsacc_get_stats: Accumulator cannot be NULL");
+		return NULL;
+	}
+
+	stats = (rt_bandstats) rtalloc(sizeof(struct rt_bandstats_t));
+	if (NULL == stats) {
+		rterror("rt_statsacc_get_stats: Could not allocate memory for stats");
+		return NULL;
+	}
+
+	stats->sample = sample;
+	stats->values = NULL;
+	stats->sorted = 0;
+
+	stats->count = acc->count;
+	if (acc->count < 1) {
+		stats->min = stats->max = 0;
+		stats->sum = 0;
+		stats->mean = 0;
+		stats->stddev = -1;
+		return stats;
+	}
+
+	stats->min = acc->min;
+	stats->max = acc->max;
+	stats->sum = acc->sum;
+	stats->mean = acc->sum / acc->count;
+
+	/* sample deviation */
+	if (sample > 0 && sample < 1) {
+		if (acc->count < 2)
+			stats->stddev = -1;
+		else
+			stats->stddev = sqrt(acc->Q / (acc->count - 1));
+	}
+	/* standard deviation */
+	else
+		stats->stddev = sqrt(acc->Q / acc->count);
+
+	return stats;
+}
+
+/**
+ * Count the distribution of the values of a statistics accumulator.
+ * Bins are approximate once more than RT_STATSACC_BUFFER values have
+ * been added. Parameters are the same as rt_band_get_histogram()
+ *
+ * @param acc : the accumulator to query, created with sketch
+ * @param bin_count : the number of bins to group the data by
+ * @param bin_width : the width of each bin as an array
+ * @param bin_width_count : number of values in bin_width
+ * @param right : evaluate bins by (a,b] rather than default [a,b)
+ * @param min : user-defined minimum value of the histogram
+ * @param max : user-defined maximum value of the histogram
+ * @param rtn_count : set to the number of bins being returned
+ *
+ * @return the histogram of the data or NULL
+ */
+rt_histogram
+rt_statsacc_get_histogram(
+	rt_statsacc acc,
+	int bin_count, double *bin_width, int bin_width_count,
+	int right, double min, double max,
+	uint32_t *rtn_count
+) {
+	rt_histogram bins = NULL;
+	struct rt_statsacc_centroid_t *c = NULL;
+	uint32_t count = 0;
+	double *means = NULL;
+	double *weights = NULL;
+	double lo;
+	double hi;
+	uint32_t sum = 0;
+	uint32_t i;
+
+	if (NULL == acc) {
+		rterror("rt_statsacc_get_histogram: Accumulator cannot be NULL");
+		return NULL;
+	}
+	if (NULL == rtn_count) {
+		rterror("rt_statsacc_get_histogram: rtn_count cannot be NULL");
+		return NULL;
+	}
+	if (!acc->sketch) {
+		rterror("rt_statsacc_get_histogram: Accumulator does not have a sketch");
+		return NULL;
+	}
+	if (acc->count < 1) {
+		rterror("rt_statsacc_get_histogram: Accumulator has no value");
+		return NULL;
+	}
+
+	c = _rt_statsacc_sorted(acc, &count);
+
+	/* exact values, each falls in its bin */
+	if (!acc->centroids_count) {
+		means = rtalloc(sizeof(double) * count);
+		weights = rtalloc(sizeof(double) * count);
+		if (NULL == means || NULL == weights) {
+			rterror("rt_statsacc_get_histogram: Could not allocate memory for values");
+			if (NULL != means) rtdealloc(means);
+			if (NULL != weights) rtdealloc(weights);
+			return NULL;
+		}
+		for (i = 0; i < count; i++) {
+			means[i] = c[i].mean;
+			weights[i] = c[i].weight;
+		}
+
+		bins = _rt_get_histogram(
+			acc->count, acc->min, acc->max,
+			means, weights, count,
+			bin_count, bin_width, bin_width_count,
+			right, min, max,
+			rtn_count
+		);
+
+		rtdealloc(means);
+		rtdealloc(weights);
+
+		return bins;
+	}
+
+	/* digest, count the values between the edges of each bin */
+	bins = _rt_get_histogram(
+		acc->count, acc->min, acc->max,
+		NULL, NULL, 0,
+		bin_count, bin_width, bin_width_count,
+		right, min, max,
+		rtn_count
+	);
+	if (NULL == bins || *rtn_count < 2)
+		return bins;
+
+	for (i = 0; i < *rtn_count; i++) {
+		lo = round(_rt_statsacc_rank(acc, c, count, bins[i].min, !bins[i].inc_min));
+		hi = round(_rt_statsacc_rank(acc, c, count, bins[i].max, bins[i].inc_max));
+		bins[i].count = (hi > lo) ? (uint32_t) (hi - lo) : 0;
+		sum += bins[i].count;
+	}
+	for (i = 0; i < *rtn_count; i++)
+		bins[i].percent = sum ? ((double) bins[i].count) / sum : 0;
+
+	return bins;
+}
+
+/**
+ * Compute the default set of or requested quantiles of a statistics
+ * accumulator. Quantiles are exact (R method 7) until more than
+ * RT_STATSACC_BUFFER values have been added and estimated from the
+ * t-digest afterwards
+ *
+ * @param acc : the accumulator to query, created with sketch
+ * @param quantiles : the quantiles to be computed
+ * @param quantiles_count : the number of quantiles to be computed
+ * @param rtn_count : the number of quantiles being returned
+ *
+ * @return the default set of or requested quantiles or NULL
+ */
+rt_quantile
+rt_statsacc_get_quantiles(
+	rt_statsacc acc,
+	double *quantiles, int quantiles_count,
+	uint32_t *rtn_count
+) {
+	rt_quantile rtn = NULL;
+	struct rt_statsacc_centroid_t *c = NULL;
+	uint32_t count = 0;
+	double *q = NULL;
+	int i = 0;
+
+	if (NULL == acc) {
+		rterror("rt_statsacc_get_quantiles: Accumulator cannot be NULL");
+		return NULL;
+	}
+	if (NULL == rtn_count) {
+		rterror("rt_statsacc_get_quantiles: rtn_count cannot be NULL");
+		return NULL;
+	}
+	if (!acc->sketch) {
+		rterror("rt_statsacc_get_quantiles: Accumulator does not have a sketch");
+		return NULL;
+	}
+	if (acc->count < 1) {
+		rterror("rt_statsacc_get_quantiles: Accumulator has no value");
+		return NULL;
+	}
+
+	/* quantiles not provided, default to quartiles */
+	if (NULL == quantiles) {
+		if (quantiles_count < 2)
+			quantiles_count = 5;
+	}
+	else if (quantiles_count < 1) {
+		rterror("rt_statsacc_get_quantiles: quantiles_count must be positive");
+		return NULL;
+	}
+
+	q = rtalloc(sizeof(double) * quantiles_count);
+	if (NULL == q) {
+		rterror("rt_statsacc_get_quantiles: Could not allocate memory for quantile input");
+		return NULL;
+	}
+
+	if (NULL == quantiles) {
+		for (i = 0; i < quantiles_count; i++)
+			q[i] = ((double) i) / (quantiles_count - 1);
+	}
+	else {
+		for (i = 0; i < quantiles_count; i++) {
+			if (quantiles[i] < 0. || quantiles[i] > 1.) {
+				rterror("rt_statsacc_get_quantiles: Quantile value not between 0 and 1");
+				rtdealloc(q);
+				return NULL;
+			}
+			q[i] = quantiles[i];
+		}
+		quicksort(q, q + quantiles_count - 1);
+	}
+
+	rtn = rtalloc(sizeof(struct rt_quantile_t) * quantiles_count);
+	if (NULL == rtn) {
+		rterror("rt_statsacc_get_quantiles: Could not allocate memory for quantile output");
+		rtdealloc(q);
+		return NULL;
+	}
+
+	c = _rt_statsacc_sorted(acc, &count);
+	for (i = 0; i < quantiles_count; i++) {
+		rtn[i].quantile = q[i];
+		rtn[i].value = _rt_statsacc_quantile(acc, c, count, q[i]);
+		rtn[i].has_value = 1;
+	}
+
+	rtdealloc(q);
+
+	*rtn_count = quantiles_count;
+	return rtn;
+}
+
 /******************************************************************************
 * rt_band_get_value_count()
 ******************************************************************************/
@@ -29,12 +29,14 @@
 
 #include <postgres.h>
 #include <fmgr.h>
+#include <lib/stringinfo.h> /* for StringInfo */
 
 #include "rtpostgis.h"
 
 extern "C" {
 	Datum RASTER_in(PG_FUNCTION_ARGS);
 	Datum RASTER_out(PG_FUNCTION_ARGS);
+	Datum RASTER_recv(PG_FUNCTION_ARGS);
 	Datum RASTER_noop(PG_FUNCTION_ARGS);
 
 	Datum RASTER_to_bytea(PG_FUNCTION_ARGS);
@@ -67,6 +69,40 @@ Datum RASTER_in(PG_FUNCTION_ARGS)
 	PG_RETURN_POINTER(result);
 }
 
+/**
+ * Binary input is the raster in Well-Known-Binary form, as written by
+ * RASTER_to_bytea (raster_send) and binary COPY files of raster2pgsql
+ */
+PG_FUNCTION_INFO_V1(RASTER_recv);
+Datum RASTER_recv(PG_FUNCTION_ARGS)
+{
+	StringInfo buf = (StringInfo) PG_GETARG_POINTER(0);
+	rt_raster raster;
+	void *result = NULL;
+
+	POSTGIS_RT_DEBUG(3, "Starting");
+
+	raster = rt_raster_from_wkb(
+		(const uint8_t *) (buf->data + buf->cursor),
+		buf->len - buf->cursor
+	);
+	if (raster == NULL) {
+		elog(ERROR, "RASTER_recv: Could not parse WKB");
+		PG_RETURN_NULL();
+	}
+
+	/* whole buffer consumed */
+	buf->cursor = buf->len;
+
+	result = rt_raster_serialize(raster);
+	rt_raster_destroy(raster);
+	if (result == NULL)
+		PG_RETURN_NULL();
+
+	SET_VARSIZE(result, ((rt_pgraster*)result)->size);
+	PG_RETURN_POINTER(result);
+}
+
 /**
  * Given a RASTER structure, convert it to Hex and put it in a string
  */
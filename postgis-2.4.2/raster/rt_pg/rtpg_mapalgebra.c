@@ -528,6 +528,125 @@ static int rtpg_nmapalgebra_callback(
 	return 1;
 }
 
+/* built-in callback functions with a native kernel */
+static const struct {
+	const char *name;
+	rt_kerneltype type;
+} rtpg_nmapalgebra_kernels[] = {
+	{"st_sum4ma", KT_SUM},
+	{"st_mean4ma", KT_MEAN},
+	{"st_min4ma", KT_MIN},
+	{"st_max4ma", KT_MAX},
+	{"st_range4ma", KT_RANGE},
+	{"_st_slope4ma", KT_SLOPE}
+};
+
+static int rtpg_nmapalgebra_kernel_double(char *str, double *val) {
+	char *end = NULL;
+
+	*val = strtod(str, &end);
+	if (end == str)
+		return 0;
+	while (isspace((unsigned char) *end))
+		end++;
+
+	return *end == '\0';
+}
+
+/*
+	set kernel if the callback function is a built-in function of this
+	extension that rt_raster_iterator_kernel() computes identically.
+	anything unusual is left to the callback function
+*/
+static int rtpg_nmapalgebra_kernel(
+	rtpg_nmapalgebra_arg arg, Oid fnoid,
+	rt_kernel kernel
+) {
+	char *fnname = NULL;
+	ArrayType *array = NULL;
+	Datum *e = NULL;
+	bool *nulls = NULL;
+	int n = 0;
+	int16 typlen;
+	bool typbyval;
+	char typalign;
+	int found = 0;
+	int i = 0;
+
+	memset(kernel, 0, sizeof(struct rt_kernel_t));
+
+	/* masks are applied to the values passed to the callback function */
+	if (arg->mask != NULL)
+		return 0;
+
+	/* neighbors are only passed if both distances are not zero */
+	if ((arg->distance[0] > 0) != (arg->distance[1] > 0))
+		return 0;
+
+	if (get_func_namespace(arg->callback.ufc_noid) != get_func_namespace(fnoid))
+		return 0;
+
+	fnname = get_func_name(arg->callback.ufc_noid);
+	if (fnname == NULL)
+		return 0;
+	for (i = 0; i < (int) (sizeof(rtpg_nmapalgebra_kernels) / sizeof(rtpg_nmapalgebra_kernels[0])); i++) {
+		if (strcmp(fnname, rtpg_nmapalgebra_kernels[i].name) == 0) {
+			kernel->type = rtpg_nmapalgebra_kernels[i].type;
+			found = 1;
+			break;
+		}
+	}
+	pfree(fnname);
+	if (!found)
+		return 0;
+
+	/* userargs */
+	if (!arg->callback.ufc_info.argnull[2]) {
+		array = DatumGetArrayTypeP(arg->callback.ufc_info.arg[2]);
+		get_typlenbyvalalign(TEXTOID, &typlen, &typbyval, &typalign);
+		deconstruct_array(array, TEXTOID, typlen, typbyval, typalign, &e, &nulls, &n);
+	}
+
+	found = 1;
+	if (kernel->type == KT_SLOPE) {
+		char *units = NULL;
+
+		/* pixel width, pixel height, width, height, units, scale */
+		if (
+			arg->numraster != 1 ||
+			arg->distance[0] != 1 || arg->distance[1] != 1 ||
+			n < 6 || nulls[0] || nulls[1] || nulls[4] || nulls[5] ||
+			!rtpg_nmapalgebra_kernel_double(text_to_cstring(DatumGetTextP(e[0])), &(kernel->pixwidth)) ||
+			!rtpg_nmapalgebra_kernel_double(text_to_cstring(DatumGetTextP(e[1])), &(kernel->pixheight)) ||
+			!rtpg_nmapalgebra_kernel_double(text_to_cstring(DatumGetTextP(e[5])), &(kernel->scale))
+		) {
+			found = 0;
+		}
+		else {
+			/* _st_slope4ma() compares the uppercased units to 'rad', so only percentages and degrees */
+			units = rtpg_strtoupper(rtpg_trim(text_to_cstring(DatumGetTextP(e[4]))));
+			if (strncmp(units, "PER", 3) == 0)
+				kernel->units = SU_PERCENT;
+			else
+				kernel->units = SU_DEGREES;
+		}
+	}
+	/* first userarg substitutes NODATA */
+	else if (n > 0) {
+		if (nulls[0] || !rtpg_nmapalgebra_kernel_double(text_to_cstring(DatumGetTextP(e[0])), &(kernel->substitute)))
+			found = 0;
+		else
+			kernel->hassubstitute = 1;
+	}
+
+	if (n > 0) {
+		pfree(e);
+		pfree(nulls);
+	}
+
+	return found;
+}
+
 /*
  ST_MapAlgebra for n rasters
 */
@@ -536,6 +655,7 @@ Datum RASTER_nMapAlgebra(PG_FUNCTION_ARGS)
 {
 	rtpg_nmapalgebra_arg arg = NULL;
 	rt_iterator itrset;
+	struct rt_kernel_t kernel;
 	ArrayType *maskArray;
 	Oid etype;
 	Datum *maskElements;
@@ -960,18 +1080,35 @@ Datum RASTER_nMapAlgebra(PG_FUNCTION_ARGS)
 		itrset[i].nbnodata = 1;
 	}
 
+	/* built-in callback function, compute a row at a time */
+	if (rtpg_nmapalgebra_kernel(arg, fcinfo->flinfo->fn_oid, &kernel)) {
+		POSTGIS_RT_DEBUGF(3, "using native kernel %d", kernel.type);
+
+		noerr = rt_raster_iterator_block(
+			itrset, arg->numraster,
+			arg->extenttype, arg->cextent,
+			arg->pixtype,
+			arg->hasnodata, arg->nodataval,
+			arg->distance[0], arg->distance[1],
+			&kernel,
+			rt_raster_iterator_kernel,
+			&raster
+		);
+	}
 	/* pass everything to iterator */
-	noerr = rt_raster_iterator(
-		itrset, arg->numraster,
-		arg->extenttype, arg->cextent,
-		arg->pixtype,
-		arg->hasnodata, arg->nodataval,
-		arg->distance[0], arg->distance[1],
-		arg->mask,
-		&(arg->callback),
-		rtpg_nmapalgebra_callback,
-		&raster
-	);
+	else {
+		noerr = rt_raster_iterator(
+			itrset, arg->numraster,
+			arg->extenttype, arg->cextent,
+			arg->pixtype,
+			arg->hasnodata, arg->nodataval,
+			arg->distance[0], arg->distance[1],
+			arg->mask,
+			&(arg->callback),
+			rtpg_nmapalgebra_callback,
+			&raster
+		);
+	}
 
 	/* cleanup */
 	pfree(itrset);
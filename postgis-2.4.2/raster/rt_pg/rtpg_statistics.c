@@ -53,6 +53,9 @@ extern "C"
 	Datum RASTER_summaryStatsCoverage(PG_FUNCTION_ARGS);
 
 	Datum RASTER_summaryStats_transfn(PG_FUNCTION_ARGS);
+	Datum RASTER_summaryStats_combinefn(PG_FUNCTION_ARGS);
+	Datum RASTER_summaryStats_serialfn(PG_FUNCTION_ARGS);
+	Datum RASTER_summaryStats_deserialfn(PG_FUNCTION_ARGS);
 	Datum RASTER_summaryStats_finalfn(PG_FUNCTION_ARGS);
 
 	/* get histogram */
@@ -63,6 +66,9 @@ extern "C"
 	Datum RASTER_quantile(PG_FUNCTION_ARGS);
 	Datum RASTER_quantileCoverage(PG_FUNCTION_ARGS);
 
+	Datum RASTER_quantile_transfn(PG_FUNCTION_ARGS);
+	Datum RASTER_quantile_finalfn(PG_FUNCTION_ARGS);
+
 	/* get counts of values */
 	Datum RASTER_valueCount(PG_FUNCTION_ARGS);
 	Datum RASTER_valueCountCoverage(PG_FUNCTION_ARGS);
@@ -502,28 +508,30 @@ Datum RASTER_summaryStatsCoverage(PG_FUNCTION_ARGS)
 
 typedef struct rtpg_summarystats_arg_t *rtpg_summarystats_arg;
 struct rtpg_summarystats_arg_t {
-	rt_bandstats stats;
-
-	/* coefficients for one-pass standard deviation */
-	uint64_t cK;
-	double cM;
-	double cQ;
+	/* mergeable count, sum, min, max and one-pass standard deviation */
+	rt_statsacc acc;
 
 	int32_t band_index; /* one-based */
 	bool exclude_nodata_value;
 	double sample; /* value between 0 and 1 */
+
+	/* ST_QuantileAgg */
+	double *quantiles;
+	uint32_t quantiles_count;
 };
 
 static void
 rtpg_summarystats_arg_destroy(rtpg_summarystats_arg arg) {
-	if (arg->stats != NULL)
-		pfree(arg->stats);
+	if (arg->acc != NULL)
+		rt_statsacc_destroy(arg->acc);
+	if (arg->quantiles != NULL)
+		pfree(arg->quantiles);
 
 	pfree(arg);
 }
 
 static rtpg_summarystats_arg
-rtpg_summarystats_arg_init() {
+rtpg_summarystats_arg_init(int sketch) {
 	rtpg_summarystats_arg arg = NULL;
 
 	arg = palloc(sizeof(struct rtpg_summarystats_arg_t));
@@ -535,8 +543,11 @@ rtpg_summarystats_arg_init() {
 		return NULL;
 	}
 
-	arg->stats = (rt_bandstats) palloc(sizeof(struct rt_bandstats_t));
-	if (arg->stats == NULL) {
+	arg->quantiles = NULL;
+	arg->quantiles_count = 0;
+
+	arg->acc = rt_statsacc_new(sketch);
+	if (arg->acc == NULL) {
 		rtpg_summarystats_arg_destroy(arg);
 		elog(
 			ERROR,
@@ -545,20 +556,6 @@ rtpg_summarystats_arg_init() {
 		return NULL;
 	}
 
-	arg->stats->sample = 0;
-	arg->stats->count = 0;
-	arg->stats->min = 0;
-	arg->stats->max = 0;
-	arg->stats->sum = 0;
-	arg->stats->mean = 0;
-	arg->stats->stddev = -1;
-	arg->stats->values = NULL;
-	arg->stats->sorted = 0;
-
-	arg->cK = 0;
-	arg->cM = 0;
-	arg->cQ = 0;
-
 	arg->band_index = 1;
 	arg->exclude_nodata_value = TRUE;
 	arg->sample = 1;
@@ -580,7 +577,7 @@ Datum RASTER_summaryStats_transfn(PG_FUNCTION_ARGS)
 	rt_raster raster = NULL;
 	rt_band band = NULL;
 	int num_bands = 0;
-	rt_bandstats stats = NULL;
+	rt_errorstate err;
 
 	POSTGIS_RT_DEBUG(3, "Starting...");
 
@@ -599,7 +596,7 @@ Datum RASTER_summaryStats_transfn(PG_FUNCTION_ARGS)
 	if (PG_ARGISNULL(0)) {
 		POSTGIS_RT_DEBUG(3, "Creating state variable");
 
-		state = rtpg_summarystats_arg_init();
+		state = rtpg_summarystats_arg_init(0);
 		if (state == NULL) {
 			MemoryContextSwitchTo(oldcontext);
 			elog(
@@ -775,18 +772,16 @@ Datum RASTER_summaryStats_transfn(PG_FUNCTION_ARGS)
 		PG_RETURN_POINTER(state);
 	}
 
-	/* we don't need the raw values, hence the zero parameter */
-	stats = rt_band_get_summary_stats(
-		band, (int) state->exclude_nodata_value,
-		state->sample, 0,
-		&(state->cK), &(state->cM), &(state->cQ)
+	err = rt_statsacc_add_band(
+		state->acc, band,
+		(int) state->exclude_nodata_value, state->sample
 	);
 
 	rt_band_destroy(band);
 	rt_raster_destroy(raster);
 	PG_FREE_IF_COPY(pgraster, 1);
 
-	if (NULL == stats) {
+	if (err != ES_NONE) {
 		elog(
 			NOTICE,
 			"Cannot compute summary statistics for band at index %d. Returning NULL",
@@ -799,34 +794,183 @@ Datum RASTER_summaryStats_transfn(PG_FUNCTION_ARGS)
 		PG_RETURN_NULL();
 	}
 
-	if (stats->count > 0) {
-		if (state->stats->count < 1) {
-			state->stats->sample = stats->sample;
-			state->stats->count = stats->count;
-			state->stats->min = stats->min;
-			state->stats->max = stats->max;
-			state->stats->sum = stats->sum;
-			state->stats->mean = stats->mean;
-			state->stats->stddev = -1;
-		}
-		else {
-			state->stats->count += stats->count;
-			state->stats->sum += stats->sum;
+	/* switch back to local context */
+	MemoryContextSwitchTo(oldcontext);
+
+	POSTGIS_RT_DEBUG(3, "Finished");
+
+	PG_RETURN_POINTER(state);
+}
 
-			if (stats->min < state->stats->min)
-				state->stats->min = stats->min;
-			if (stats->max > state->stats->max)
-				state->stats->max = stats->max;
+PG_FUNCTION_INFO_V1(RASTER_summaryStats_combinefn);
+Datum RASTER_summaryStats_combinefn(PG_FUNCTION_ARGS)
+{
+	MemoryContext aggcontext;
+	MemoryContext oldcontext;
+	rtpg_summarystats_arg state1 = NULL;
+	rtpg_summarystats_arg state2 = NULL;
+
+	POSTGIS_RT_DEBUG(3, "Starting...");
+
+	/* cannot be called directly as this is exclusive aggregate function */
+	if (!AggCheckCallContext(fcinfo, &aggcontext)) {
+		elog(
+			ERROR,
+			"RASTER_summaryStats_combinefn: Cannot be called in a non-aggregate context"
+		);
+		PG_RETURN_NULL();
+	}
+
+	if (!PG_ARGISNULL(0))
+		state1 = (rtpg_summarystats_arg) PG_GETARG_POINTER(0);
+	if (!PG_ARGISNULL(1))
+		state2 = (rtpg_summarystats_arg) PG_GETARG_POINTER(1);
+
+	if (state2 == NULL) {
+		if (state1 == NULL)
+			PG_RETURN_NULL();
+		PG_RETURN_POINTER(state1);
+	}
+
+	/* switch to aggcontext */
+	oldcontext = MemoryContextSwitchTo(aggcontext);
+
+	/* copy of state2 as it may live in another context */
+	if (state1 == NULL) {
+		state1 = rtpg_summarystats_arg_init(state2->acc->sketch);
+		state1->band_index = state2->band_index;
+		state1->exclude_nodata_value = state2->exclude_nodata_value;
+		state1->sample = state2->sample;
+		if (state2->quantiles_count) {
+			state1->quantiles = (double *) palloc(sizeof(double) * state2->quantiles_count);
+			memcpy(state1->quantiles, state2->quantiles, sizeof(double) * state2->quantiles_count);
+			state1->quantiles_count = state2->quantiles_count;
 		}
 	}
 
-	pfree(stats);
+	if (rt_statsacc_merge(state1->acc, state2->acc) != ES_NONE) {
+		MemoryContextSwitchTo(oldcontext);
+		elog(ERROR, "RASTER_summaryStats_combinefn: Cannot merge summary stats");
+		PG_RETURN_NULL();
+	}
 
-	/* switch back to local context */
 	MemoryContextSwitchTo(oldcontext);
 
 	POSTGIS_RT_DEBUG(3, "Finished");
 
+	PG_RETURN_POINTER(state1);
+}
+
+/*
+	serialized state is band_index, exclude_nodata_value, sample and
+	quantiles followed by the accumulator without the unused part of
+	its digest
+*/
+#define RTPG_SUMMARYSTATS_HEADER_SIZE (sizeof(int32_t) * 3 + sizeof(double))
+#define RTPG_SUMMARYSTATS_ACC_SIZE offsetof(struct rt_statsacc_t, centroids)
+
+PG_FUNCTION_INFO_V1(RASTER_summaryStats_serialfn);
+Datum RASTER_summaryStats_serialfn(PG_FUNCTION_ARGS)
+{
+	rtpg_summarystats_arg state = NULL;
+	bytea *result = NULL;
+	uint8_t *ptr = NULL;
+	size_t centroids_size;
+	size_t buffer_size;
+	size_t size;
+	int32_t exclude_nodata_value;
+
+	/* cannot be called directly as this is exclusive aggregate function */
+	if (!AggCheckCallContext(fcinfo, NULL)) {
+		elog(ERROR, "RASTER_summaryStats_serialfn: Cannot be called in a non-aggregate context");
+		PG_RETURN_NULL();
+	}
+
+	state = (rtpg_summarystats_arg) PG_GETARG_POINTER(0);
+
+	centroids_size = sizeof(struct rt_statsacc_centroid_t) * state->acc->centroids_count;
+	buffer_size = sizeof(struct rt_statsacc_centroid_t) * state->acc->buffer_count;
+	size = VARHDRSZ + RTPG_SUMMARYSTATS_HEADER_SIZE + (sizeof(double) * state->quantiles_count) +
+		RTPG_SUMMARYSTATS_ACC_SIZE + centroids_size + buffer_size;
+
+	result = (bytea *) palloc(size);
+	SET_VARSIZE(result, size);
+	ptr = (uint8_t *) VARDATA(result);
+
+	exclude_nodata_value = state->exclude_nodata_value ? 1 : 0;
+	memcpy(ptr, &(state->band_index), sizeof(int32_t));
+	ptr += sizeof(int32_t);
+	memcpy(ptr, &exclude_nodata_value, sizeof(int32_t));
+	ptr += sizeof(int32_t);
+	memcpy(ptr, &(state->sample), sizeof(double));
+	ptr += sizeof(double);
+	memcpy(ptr, &(state->quantiles_count), sizeof(int32_t));
+	ptr += sizeof(int32_t);
+	if (state->quantiles_count) {
+		memcpy(ptr, state->quantiles, sizeof(double) * state->quantiles_count);
+		ptr += sizeof(double) * state->quantiles_count;
+	}
+
+	memcpy(ptr, state->acc, RTPG_SUMMARYSTATS_ACC_SIZE);
+	ptr += RTPG_SUMMARYSTATS_ACC_SIZE;
+	memcpy(ptr, state->acc->centroids, centroids_size);
+	ptr += centroids_size;
+	memcpy(ptr, state->acc->buffer, buffer_size);
+
+	PG_RETURN_BYTEA_P(result);
+}
+
+PG_FUNCTION_INFO_V1(RASTER_summaryStats_deserialfn);
+Datum RASTER_summaryStats_deserialfn(PG_FUNCTION_ARGS)
+{
+	MemoryContext aggcontext;
+	MemoryContext oldcontext;
+	rtpg_summarystats_arg state = NULL;
+	bytea *serialized = NULL;
+	uint8_t *ptr = NULL;
+	int32_t exclude_nodata_value;
+
+	/* cannot be called directly as this is exclusive aggregate function */
+	if (!AggCheckCallContext(fcinfo, &aggcontext)) {
+		elog(ERROR, "RASTER_summaryStats_deserialfn: Cannot be called in a non-aggregate context");
+		PG_RETURN_NULL();
+	}
+
+	serialized = PG_GETARG_BYTEA_P(0);
+	if (VARSIZE(serialized) - VARHDRSZ < RTPG_SUMMARYSTATS_HEADER_SIZE + RTPG_SUMMARYSTATS_ACC_SIZE) {
+		elog(ERROR, "RASTER_summaryStats_deserialfn: Invalid serialized state");
+		PG_RETURN_NULL();
+	}
+	ptr = (uint8_t *) VARDATA(serialized);
+
+	oldcontext = MemoryContextSwitchTo(aggcontext);
+
+	state = rtpg_summarystats_arg_init(0);
+
+	memcpy(&(state->band_index), ptr, sizeof(int32_t));
+	ptr += sizeof(int32_t);
+	memcpy(&exclude_nodata_value, ptr, sizeof(int32_t));
+	ptr += sizeof(int32_t);
+	state->exclude_nodata_value = exclude_nodata_value ? TRUE : FALSE;
+	memcpy(&(state->sample), ptr, sizeof(double));
+	ptr += sizeof(double);
+	memcpy(&(state->quantiles_count), ptr, sizeof(int32_t));
+	ptr += sizeof(int32_t);
+	if (state->quantiles_count) {
+		state->quantiles = (double *) palloc(sizeof(double) * state->quantiles_count);
+		memcpy(state->quantiles, ptr, sizeof(double) * state->quantiles_count);
+		ptr += sizeof(double) * state->quantiles_count;
+	}
+
+	/* the accumulator carries its own sketch flag */
+	memcpy(state->acc, ptr, RTPG_SUMMARYSTATS_ACC_SIZE);
+	ptr += RTPG_SUMMARYSTATS_ACC_SIZE;
+	memcpy(state->acc->centroids, ptr, sizeof(struct rt_statsacc_centroid_t) * state->acc->centroids_count);
+	ptr += sizeof(struct rt_statsacc_centroid_t) * state->acc->centroids_count;
+	memcpy(state->acc->buffer, ptr, sizeof(struct rt_statsacc_centroid_t) * state->acc->buffer_count);
+
+	MemoryContextSwitchTo(oldcontext);
+
 	PG_RETURN_POINTER(state);
 }
 
@@ -834,6 +978,7 @@ PG_FUNCTION_INFO_V1(RASTER_summaryStats_finalfn);
 Datum RASTER_summaryStats_finalfn(PG_FUNCTION_ARGS)
 {
 	rtpg_summarystats_arg state = NULL;
+	rt_bandstats stats = NULL;
 
 	TupleDesc tupdesc;
 	HeapTuple tuple;
@@ -862,14 +1007,10 @@ Datum RASTER_summaryStats_finalfn(PG_FUNCTION_ARGS)
 	}
 
 	/* coverage mean and deviation */
-	if (state->stats->count > 0) {
-		state->stats->mean = state->stats->sum / state->stats->count;
-		/* sample deviation */
-		if (state->stats->sample > 0 && state->stats->sample < 1)
-			state->stats->stddev = sqrt(state->cQ / (state->stats->count - 1));
-		/* standard deviation */
-		else
-			state->stats->stddev = sqrt(state->cQ / state->stats->count);
+	stats = rt_statsacc_get_stats(state->acc, state->sample);
+	if (NULL == stats) {
+		elog(ERROR, "RASTER_summaryStats_finalfn: Cannot compute coverage summary stats");
+		PG_RETURN_NULL();
 	}
 
 	/* Build a tuple descriptor for our result type */
@@ -888,13 +1029,13 @@ Datum RASTER_summaryStats_finalfn(PG_FUNCTION_ARGS)
 
 	memset(nulls, FALSE, sizeof(bool) * values_length);
 
-	values[0] = Int64GetDatum(state->stats->count);
-	if (state->stats->count > 0) {
-		values[1] = Float8GetDatum(state->stats->sum);
-		values[2] = Float8GetDatum(state->stats->mean);
-		values[3] = Float8GetDatum(state->stats->stddev);
-		values[4] = Float8GetDatum(state->stats->min);
-		values[5] = Float8GetDatum(state->stats->max);
+	values[0] = Int64GetDatum(state->acc->count);
+	if (stats->count > 0) {
+		values[1] = Float8GetDatum(stats->sum);
+		values[2] = Float8GetDatum(stats->mean);
+		values[3] = Float8GetDatum(stats->stddev);
+		values[4] = Float8GetDatum(stats->min);
+		values[5] = Float8GetDatum(stats->max);
 	}
 	else {
 		nulls[1] = TRUE;
@@ -911,6 +1052,7 @@ Datum RASTER_summaryStats_finalfn(PG_FUNCTION_ARGS)
 	result = HeapTupleGetDatum(tuple);
 
 	/* clean up */
+	pfree(stats);
 	//rtpg_summarystats_arg_destroy(state);
 
 	PG_RETURN_DATUM(result);
@@ -2404,6 +2546,264 @@ Datum RASTER_quantileCoverage(PG_FUNCTION_ARGS)
 	}
 }
 
+/* ---------------------------------------------------------------- */
+/* Aggregate ST_QuantileAgg                                         */
+/* ---------------------------------------------------------------- */
+
+PG_FUNCTION_INFO_V1(RASTER_quantile_transfn);
+Datum RASTER_quantile_transfn(PG_FUNCTION_ARGS)
+{
+	MemoryContext aggcontext;
+	MemoryContext oldcontext;
+	rtpg_summarystats_arg state = NULL;
+
+	int i = 0;
+	int j = 0;
+	int n = 0;
+	int nargs = 0;
+	double quantile = 0;
+
+	rt_pgraster *pgraster = NULL;
+	rt_raster raster = NULL;
+	rt_band band = NULL;
+	rt_errorstate err;
+
+	ArrayType *array;
+	Oid etype;
+	Datum *e;
+	bool *nulls;
+	int16 typlen;
+	bool typbyval;
+	char typalign;
+
+	POSTGIS_RT_DEBUG(3, "Starting...");
+
+	/* cannot be called directly as this is exclusive aggregate function */
+	if (!AggCheckCallContext(fcinfo, &aggcontext)) {
+		elog(
+			ERROR,
+			"RASTER_quantile_transfn: Cannot be called in a non-aggregate context"
+		);
+		PG_RETURN_NULL();
+	}
+
+	/* switch to aggcontext */
+	oldcontext = MemoryContextSwitchTo(aggcontext);
+
+	if (PG_ARGISNULL(0)) {
+		POSTGIS_RT_DEBUG(3, "Creating state variable");
+
+		state = rtpg_summarystats_arg_init(1);
+		if (state == NULL) {
+			MemoryContextSwitchTo(oldcontext);
+			elog(
+				ERROR,
+				"RASTER_quantile_transfn: Cannot allocate memory for state variable"
+			);
+			PG_RETURN_NULL();
+		}
+
+		/* 3 or 5 total possible args, quantiles is always last */
+		nargs = PG_NARGS();
+		if (nargs == 5) {
+			if (!PG_ARGISNULL(2))
+				state->band_index = PG_GETARG_INT32(2);
+			if (!PG_ARGISNULL(3))
+				state->exclude_nodata_value = PG_GETARG_BOOL(3);
+
+			if (state->band_index < 1) {
+				rtpg_summarystats_arg_destroy(state);
+				MemoryContextSwitchTo(oldcontext);
+				elog(
+					ERROR,
+					"RASTER_quantile_transfn: Invalid band index (must use 1-based). Returning NULL"
+				);
+				PG_RETURN_NULL();
+			}
+		}
+
+		/* quantiles */
+		if (!PG_ARGISNULL(nargs - 1)) {
+			array = PG_GETARG_ARRAYTYPE_P(nargs - 1);
+			etype = ARR_ELEMTYPE(array);
+			get_typlenbyvalalign(etype, &typlen, &typbyval, &typalign);
+
+			deconstruct_array(array, etype, typlen, typbyval, typalign, &e,
+				&nulls, &n);
+
+			if (n > 0)
+				state->quantiles = (double *) palloc(sizeof(double) * n);
+			for (i = 0, j = 0; i < n; i++) {
+				if (nulls[i]) continue;
+
+				quantile = DatumGetFloat8(e[i]);
+				if (quantile < 0 || quantile > 1) {
+					rtpg_summarystats_arg_destroy(state);
+					MemoryContextSwitchTo(oldcontext);
+					elog(
+						ERROR,
+						"RASTER_quantile_transfn: Invalid value for quantile (must be between 0 and 1)"
+					);
+					PG_RETURN_NULL();
+				}
+
+				state->quantiles[j++] = quantile;
+			}
+			state->quantiles_count = j;
+		}
+	}
+	else {
+		POSTGIS_RT_DEBUG(3, "State variable already exists");
+		state = (rtpg_summarystats_arg) PG_GETARG_POINTER(0);
+	}
+
+	/* null raster, return */
+	if (PG_ARGISNULL(1)) {
+		POSTGIS_RT_DEBUG(4, "NULL raster so processing required");
+		MemoryContextSwitchTo(oldcontext);
+		PG_RETURN_POINTER(state);
+	}
+
+	/* deserialize raster */
+	pgraster = (rt_pgraster *) PG_DETOAST_DATUM(PG_GETARG_DATUM(1));
+
+	/* Get raster object */
+	raster = rt_raster_deserialize(pgraster, FALSE);
+	if (raster == NULL) {
+		rtpg_summarystats_arg_destroy(state);
+		PG_FREE_IF_COPY(pgraster, 1);
+
+		MemoryContextSwitchTo(oldcontext);
+		elog(ERROR, "RASTER_quantile_transfn: Cannot deserialize raster");
+		PG_RETURN_NULL();
+	}
+
+	/* inspect number of bands */
+	if (state->band_index > rt_raster_get_num_bands(raster)) {
+		elog(
+			NOTICE,
+			"Raster does not have band at index %d. Skipping raster",
+			state->band_index
+		);
+
+		rt_raster_destroy(raster);
+		PG_FREE_IF_COPY(pgraster, 1);
+
+		MemoryContextSwitchTo(oldcontext);
+		PG_RETURN_POINTER(state);
+	}
+
+	/* get band */
+	band = rt_raster_get_band(raster, state->band_index - 1);
+	if (!band) {
+		elog(
+			NOTICE, "Cannot find band at index %d. Skipping raster",
+			state->band_index
+		);
+
+		rt_raster_destroy(raster);
+		PG_FREE_IF_COPY(pgraster, 1);
+
+		MemoryContextSwitchTo(oldcontext);
+		PG_RETURN_POINTER(state);
+	}
+
+	err = rt_statsacc_add_band(
+		state->acc, band,
+		(int) state->exclude_nodata_value, 1
+	);
+
+	rt_band_destroy(band);
+	rt_raster_destroy(raster);
+	PG_FREE_IF_COPY(pgraster, 1);
+
+	if (err != ES_NONE) {
+		elog(
+			NOTICE,
+			"Cannot compute quantiles for band at index %d. Returning NULL",
+			state->band_index
+		);
+
+		rtpg_summarystats_arg_destroy(state);
+
+		MemoryContextSwitchTo(oldcontext);
+		PG_RETURN_NULL();
+	}
+
+	/* switch back to local context */
+	MemoryContextSwitchTo(oldcontext);
+
+	POSTGIS_RT_DEBUG(3, "Finished");
+
+	PG_RETURN_POINTER(state);
+}
+
+PG_FUNCTION_INFO_V1(RASTER_quantile_finalfn);
+Datum RASTER_quantile_finalfn(PG_FUNCTION_ARGS)
+{
+	rtpg_summarystats_arg state = NULL;
+	rt_quantile quant = NULL;
+	uint32_t count = 0;
+	Datum *values = NULL;
+	ArrayType *result = NULL;
+	int16 typlen;
+	bool typbyval;
+	char typalign;
+	uint32_t i = 0;
+	uint32_t j = 0;
+
+	POSTGIS_RT_DEBUG(3, "Starting...");
+
+	/* cannot be called directly as this is exclusive aggregate function */
+	if (!AggCheckCallContext(fcinfo, NULL)) {
+		elog(ERROR, "RASTER_quantile_finalfn: Cannot be called in a non-aggregate context");
+		PG_RETURN_NULL();
+	}
+
+	/* NULL, return null */
+	if (PG_ARGISNULL(0))
+		PG_RETURN_NULL();
+
+	state = (rtpg_summarystats_arg) PG_GETARG_POINTER(0);
+
+	/* no values, no quantiles */
+	if (NULL == state || state->acc->count < 1)
+		PG_RETURN_NULL();
+
+	quant = rt_statsacc_get_quantiles(
+		state->acc,
+		state->quantiles, state->quantiles_count,
+		&count
+	);
+	if (NULL == quant) {
+		elog(ERROR, "RASTER_quantile_finalfn: Cannot compute coverage quantiles");
+		PG_RETURN_NULL();
+	}
+
+	/* values in the order of the requested quantiles */
+	values = (Datum *) palloc(sizeof(Datum) * count);
+	for (i = 0; i < count; i++) {
+		if (!state->quantiles_count) {
+			values[i] = Float8GetDatum(quant[i].value);
+			continue;
+		}
+
+		for (j = 0; j < count; j++) {
+			if (FLT_EQ(quant[j].quantile, state->quantiles[i]))
+				break;
+		}
+		values[i] = Float8GetDatum(quant[j < count ? j : i].value);
+	}
+
+	get_typlenbyvalalign(FLOAT8OID, &typlen, &typbyval, &typalign);
+	result = construct_array(values, count, FLOAT8OID, typlen, typbyval, typalign);
+
+	pfree(values);
+	pfree(quant);
+
+	PG_RETURN_ARRAYTYPE_P(result);
+}
+
 /* get counts of values */
 PG_FUNCTION_INFO_V1(RASTER_valueCount);
 Datum RASTER_valueCount(PG_FUNCTION_ARGS) {
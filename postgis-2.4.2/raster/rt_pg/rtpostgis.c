@@ -255,6 +255,7 @@ rt_pg_debug(const char *fmt, va_list ap)
 //static char *gdal_datapath = NULL;
 extern THR_LOCAL char *gdal_enabled_drivers;
 extern THR_LOCAL bool enable_outdb_rasters;
+extern THR_LOCAL int outdb_cache_size;
 
 /* ---------------------------------------------------------------- */
 /*  Useful variables                                                */
@@ -577,6 +578,9 @@ _PG_init_gdal(void) {
 	/* postgis.enable_outdb_rasters is alway true  */
 	enable_outdb_rasters = TRUE;
 
+	/* postgis.outdb_cache_size is alway RT_OUTDB_CACHE_SIZE kilobytes */
+	outdb_cache_size = RT_OUTDB_CACHE_SIZE;
+
 	/* postgis.gdal_datapath */
 	rtpg_assignHookGDALDataPath(NULL, extra);
 
@@ -608,6 +612,9 @@ _PG_fini(void) {
 	//boot_postgis_gdal_enabled_drivers = NULL;
 	//env_postgis_enable_outdb_rasters = NULL;
 
+	/* close cached out-db datasets */
+	rt_band_outdb_cache_reset();
+
 	pfree(gdal_enabled_drivers);
 	gdal_enabled_drivers = NULL;
 
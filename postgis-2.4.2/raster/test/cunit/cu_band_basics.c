@@ -1252,6 +1252,83 @@ static void test_band_get_pixel_line() {
 	cu_free_raster(rast);
 }
 
+static void test_band_load_offline_data() {
+	rt_raster rast = NULL;
+	rt_raster rast2 = NULL;
+	rt_band band = NULL;
+	rt_band band2 = NULL;
+	char *path = "../regress/loader/testraster.tif";
+	uint8_t *data = NULL;
+	int width = 10;
+	int height = 10;
+	double val = 0;
+	double val2 = 0;
+	int x;
+	int y;
+
+	/* window completely within the 90x50 offline raster */
+	band = rt_band_new_offline(
+		width, height,
+		PT_8BUI,
+		0, 0,
+		1, path
+	);
+	CU_ASSERT(band != NULL);
+
+	rast = rt_raster_new(width, height);
+	CU_ASSERT(rast != NULL);
+	rt_raster_set_offsets(rast, 80, -40);
+	CU_ASSERT_NOT_EQUAL(rt_raster_add_band(rast, band, 0), -1);
+
+	CU_ASSERT_EQUAL(rt_band_load_offline_data(band), ES_NONE);
+	data = rtalloc(width * height);
+	CU_ASSERT(data != NULL);
+	memcpy(data, band->data.offline.mem, width * height);
+
+	/* same window again is served by the cache */
+	CU_ASSERT_EQUAL(rt_band_load_offline_data(band), ES_NONE);
+	CU_ASSERT_EQUAL(memcmp(data, band->data.offline.mem, width * height), 0);
+
+	/* and is unchanged when read back from the file */
+	rt_band_outdb_cache_reset();
+	CU_ASSERT_EQUAL(rt_band_load_offline_data(band), ES_NONE);
+	CU_ASSERT_EQUAL(memcmp(data, band->data.offline.mem, width * height), 0);
+	rtdealloc(data);
+
+	/* window straddling the lower-right corner of the offline raster */
+	band2 = rt_band_new_offline(
+		width, height,
+		PT_8BUI,
+		1, 255,
+		1, path
+	);
+	CU_ASSERT(band2 != NULL);
+
+	rast2 = rt_raster_new(width, height);
+	CU_ASSERT(rast2 != NULL);
+	rt_raster_set_offsets(rast2, 85, -45);
+	CU_ASSERT_NOT_EQUAL(rt_raster_add_band(rast2, band2, 0), -1);
+
+	CU_ASSERT_EQUAL(rt_band_load_offline_data(band2), ES_NONE);
+
+	for (y = 0; y < height; y++) {
+		for (x = 0; x < width; x++) {
+			CU_ASSERT_EQUAL(rt_band_get_pixel(band2, x, y, &val2, NULL), ES_NONE);
+
+			if (x < 5 && y < 5) {
+				CU_ASSERT_EQUAL(rt_band_get_pixel(band, x + 5, y + 5, &val, NULL), ES_NONE);
+				CU_ASSERT_DOUBLE_EQUAL(val2, val, DBL_EPSILON);
+			}
+			else
+				CU_ASSERT_DOUBLE_EQUAL(val2, 255, DBL_EPSILON);
+		}
+	}
+
+	rt_band_outdb_cache_reset();
+	cu_free_raster(rast2);
+	cu_free_raster(rast);
+}
+
 /* register tests */
 void band_basics_suite_setup(void);
 void band_basics_suite_setup(void)
@@ -1270,5 +1347,6 @@ void band_basics_suite_setup(void)
 	PG_ADD_TEST(suite, test_band_pixtype_32BF);
 	PG_ADD_TEST(suite, test_band_pixtype_64BF);
 	PG_ADD_TEST(suite, test_band_get_pixel_line);
+	PG_ADD_TEST(suite, test_band_load_offline_data);
 }
 
@@ -209,6 +209,160 @@ static void test_band_stats() {
 	cu_free_raster(raster);
 }
 
+static void test_band_stats_accumulator() {
+	rt_bandstats stats = NULL;
+	rt_bandstats accstats = NULL;
+	rt_histogram histogram = NULL;
+	rt_histogram acchistogram = NULL;
+	rt_quantile quantile = NULL;
+	rt_quantile accquantile = NULL;
+	uint32_t count = 0;
+	uint32_t acccount = 0;
+	rt_statsacc acc = NULL;
+	rt_statsacc acc2 = NULL;
+
+	rt_raster raster;
+	rt_band band;
+	uint32_t x;
+	uint32_t xmax = 100;
+	uint32_t y;
+	uint32_t ymax = 100;
+
+	uint32_t values[] = {0, 91, 55, 86, 76, 41, 36, 97, 25, 63, 68, 2, 78, 15, 82, 47};
+
+	raster = rt_raster_new(xmax, ymax);
+	CU_ASSERT(raster != NULL);
+	band = cu_add_band(raster, PT_32BUI, 1, 0);
+	CU_ASSERT(band != NULL);
+
+	for (x = 0; x < xmax; x++) {
+		for (y = 0; y < ymax; y++) {
+			rt_band_set_pixel(band, x, y, x + y, NULL);
+		}
+	}
+
+	stats = (rt_bandstats) rt_band_get_summary_stats(band, 1, 0, 1, NULL, NULL, NULL);
+	CU_ASSERT(stats != NULL);
+
+	acc = rt_statsacc_new(1);
+	CU_ASSERT(acc != NULL);
+	CU_ASSERT_EQUAL(rt_statsacc_add_band(acc, band, 1, 1), ES_NONE);
+
+	accstats = rt_statsacc_get_stats(acc, 1);
+	CU_ASSERT(accstats != NULL);
+	CU_ASSERT_EQUAL(accstats->count, stats->count);
+	CU_ASSERT_DOUBLE_EQUAL(accstats->sum, stats->sum, DBL_EPSILON);
+	CU_ASSERT_DOUBLE_EQUAL(accstats->mean, stats->mean, FLT_EPSILON);
+	CU_ASSERT_DOUBLE_EQUAL(accstats->stddev, stats->stddev, FLT_EPSILON);
+	CU_ASSERT_DOUBLE_EQUAL(accstats->min, 1, DBL_EPSILON);
+	CU_ASSERT_DOUBLE_EQUAL(accstats->max, 198, DBL_EPSILON);
+	rtdealloc(accstats);
+
+	/* sketch estimates within 1% of the range */
+	quantile = (rt_quantile) rt_band_get_quantiles(stats, NULL, 0, &count);
+	CU_ASSERT(quantile != NULL);
+	accquantile = rt_statsacc_get_quantiles(acc, NULL, 0, &acccount);
+	CU_ASSERT(accquantile != NULL);
+	CU_ASSERT_EQUAL(acccount, count);
+	for (x = 0; x < count; x++) {
+		CU_ASSERT_DOUBLE_EQUAL(accquantile[x].quantile, quantile[x].quantile, DBL_EPSILON);
+		CU_ASSERT_DOUBLE_EQUAL(accquantile[x].value, quantile[x].value, 2);
+	}
+	rtdealloc(quantile);
+	rtdealloc(accquantile);
+
+	histogram = (rt_histogram) rt_band_get_histogram(stats, 10, NULL, 0, 0, 0, 0, &count);
+	CU_ASSERT(histogram != NULL);
+	acchistogram = rt_statsacc_get_histogram(acc, 10, NULL, 0, 0, 0, 0, &acccount);
+	CU_ASSERT(acchistogram != NULL);
+	CU_ASSERT_EQUAL(acccount, count);
+	for (x = 0; x < count; x++) {
+		CU_ASSERT_DOUBLE_EQUAL(acchistogram[x].min, histogram[x].min, DBL_EPSILON);
+		CU_ASSERT_DOUBLE_EQUAL(acchistogram[x].percent, histogram[x].percent, 0.01);
+	}
+	rtdealloc(histogram);
+	rtdealloc(acchistogram);
+
+	/* merged accumulators are the same as one accumulator over both */
+	acc2 = rt_statsacc_new(1);
+	CU_ASSERT(acc2 != NULL);
+	CU_ASSERT_EQUAL(rt_statsacc_add_band(acc2, band, 1, 1), ES_NONE);
+	CU_ASSERT_EQUAL(rt_statsacc_merge(acc, acc2), ES_NONE);
+	rt_statsacc_destroy(acc2);
+
+	accstats = rt_statsacc_get_stats(acc, 1);
+	CU_ASSERT(accstats != NULL);
+	CU_ASSERT_EQUAL(accstats->count, stats->count * 2);
+	CU_ASSERT_DOUBLE_EQUAL(accstats->mean, stats->mean, FLT_EPSILON);
+	CU_ASSERT_DOUBLE_EQUAL(accstats->stddev, stats->stddev, FLT_EPSILON);
+	rtdealloc(accstats);
+
+	accquantile = rt_statsacc_get_quantiles(acc, NULL, 3, &acccount);
+	CU_ASSERT(accquantile != NULL);
+	CU_ASSERT_EQUAL(acccount, 3);
+	CU_ASSERT_DOUBLE_EQUAL(accquantile[1].value, 99, 2);
+	rtdealloc(accquantile);
+
+	rt_statsacc_destroy(acc);
+	rtdealloc(stats->values);
+	rtdealloc(stats);
+
+	/* no sketch, no quantiles */
+	acc = rt_statsacc_new(0);
+	CU_ASSERT(acc != NULL);
+	CU_ASSERT_EQUAL(rt_statsacc_add_band(acc, band, 1, 1), ES_NONE);
+	CU_ASSERT(rt_statsacc_get_quantiles(acc, NULL, 0, &acccount) == NULL);
+	rt_statsacc_destroy(acc);
+
+	cu_free_raster(raster);
+
+	/* exact while few values */
+	raster = rt_raster_new(4, 4);
+	CU_ASSERT(raster != NULL);
+	band = cu_add_band(raster, PT_8BUI, 0, 0);
+	CU_ASSERT(band != NULL);
+	rt_band_set_nodata(band, 0, NULL);
+
+	for (x = 0; x < 4; x++) {
+		for (y = 0; y < 4; y++) {
+			rt_band_set_pixel(band, x, y, values[(x * 4) + y], NULL);
+		}
+	}
+
+	stats = (rt_bandstats) rt_band_get_summary_stats(band, 1, 0, 1, NULL, NULL, NULL);
+	CU_ASSERT(stats != NULL);
+
+	acc = rt_statsacc_new(1);
+	CU_ASSERT(acc != NULL);
+	CU_ASSERT_EQUAL(rt_statsacc_add_band(acc, band, 1, 1), ES_NONE);
+
+	quantile = (rt_quantile) rt_band_get_quantiles(stats, NULL, 11, &count);
+	CU_ASSERT(quantile != NULL);
+	accquantile = rt_statsacc_get_quantiles(acc, NULL, 11, &acccount);
+	CU_ASSERT(accquantile != NULL);
+	CU_ASSERT_EQUAL(acccount, count);
+	for (x = 0; x < count; x++)
+		CU_ASSERT_DOUBLE_EQUAL(accquantile[x].value, quantile[x].value, FLT_EPSILON);
+	rtdealloc(quantile);
+	rtdealloc(accquantile);
+
+	histogram = (rt_histogram) rt_band_get_histogram(stats, 0, NULL, 0, 1, 0, 0, &count);
+	CU_ASSERT(histogram != NULL);
+	acchistogram = rt_statsacc_get_histogram(acc, 0, NULL, 0, 1, 0, 0, &acccount);
+	CU_ASSERT(acchistogram != NULL);
+	CU_ASSERT_EQUAL(acccount, count);
+	for (x = 0; x < count; x++)
+		CU_ASSERT_EQUAL(acchistogram[x].count, histogram[x].count);
+	rtdealloc(histogram);
+	rtdealloc(acchistogram);
+
+	rt_statsacc_destroy(acc);
+	rtdealloc(stats->values);
+	rtdealloc(stats);
+
+	cu_free_raster(raster);
+}
+
 static void test_band_value_count() {
 	rt_valuecount vcnts = NULL;
 
@@ -272,6 +426,7 @@ void band_stats_suite_setup(void)
 {
 	CU_pSuite suite = CU_add_suite("band_stats", NULL, NULL);
 	PG_ADD_TEST(suite, test_band_stats);
+	PG_ADD_TEST(suite, test_band_stats_accumulator);
 	PG_ADD_TEST(suite, test_band_value_count);
 }
 
@@ -1183,12 +1183,233 @@ static void test_raster_colormap() {
 	cu_free_raster(raster);
 }
 
+/* sum of neighborhood, same as KT_SUM */
+static int testRasterIteratorBlock_callback(rt_iterator_arg arg, void *userarg, double *value, int *nodata) {
+	int x = 0;
+	int y = 0;
+
+	*value = 0;
+	for (y = 0; y < arg->rows; y++) {
+		for (x = 0; x < arg->columns; x++) {
+			if (!arg->nodata[0][y][x])
+				*value += arg->values[0][y][x];
+		}
+	}
+
+	return 1;
+}
+
+static void test_raster_iterator_block() {
+	rt_raster rast;
+	rt_raster rtn = NULL;
+	rt_raster rtnpixel = NULL;
+	rt_band band;
+	rt_band rtnband;
+	struct rt_iterator_t itrset;
+	struct rt_kernel_t kernel;
+	int maxX = 5;
+	int maxY = 5;
+	int x = 0;
+	int y = 0;
+	double value = 0;
+	double pixelvalue = 0;
+	int nodata = 0;
+	double vals[4];
+	uint8_t nodatas[4];
+
+	rast = rt_raster_new(maxX, maxY);
+	CU_ASSERT(rast != NULL);
+	rt_raster_set_offsets(rast, 0, 0);
+	rt_raster_set_scale(rast, 1, -1);
+
+	band = cu_add_band(rast, PT_32BF, 1, -1);
+	CU_ASSERT(band != NULL);
+
+	for (y = 0; y < maxY; y++) {
+		for (x = 0; x < maxX; x++)
+			rt_band_set_pixel(band, x, y, x + (y * maxX), NULL);
+	}
+	rt_band_set_pixel(band, 2, 2, -1, NULL);
+
+	/* row running over the band's extent */
+	CU_ASSERT_EQUAL(rt_band_get_pixel_row(band, -1, 2, 4, vals, nodatas), ES_NONE);
+	CU_ASSERT_EQUAL(nodatas[0], 1);
+	CU_ASSERT_DOUBLE_EQUAL(vals[1], 10, DBL_EPSILON);
+	CU_ASSERT_EQUAL(nodatas[1], 0);
+	CU_ASSERT_EQUAL(nodatas[3], 1);
+	CU_ASSERT_EQUAL(rt_band_get_pixel_row(band, 0, 5, 4, vals, nodatas), ES_NONE);
+	CU_ASSERT_EQUAL(nodatas[0], 1);
+	CU_ASSERT_EQUAL(nodatas[3], 1);
+
+	itrset.raster = rast;
+	itrset.nband = 0;
+	itrset.nbnodata = 1;
+
+	/* sum of 3x3 neighborhood matches per-pixel iterator */
+	memset(&kernel, 0, sizeof(struct rt_kernel_t));
+	kernel.type = KT_SUM;
+
+	CU_ASSERT_EQUAL(rt_raster_iterator_block(
+		&itrset, 1,
+		ET_FIRST, NULL,
+		PT_32BF,
+		1, -1,
+		1, 1,
+		&kernel,
+		rt_raster_iterator_kernel,
+		&rtn
+	), ES_NONE);
+	CU_ASSERT(rtn != NULL);
+	CU_ASSERT_EQUAL(rt_raster_get_width(rtn), maxX);
+	CU_ASSERT_EQUAL(rt_raster_get_height(rtn), maxY);
+
+	CU_ASSERT_EQUAL(rt_raster_iterator(
+		&itrset, 1,
+		ET_FIRST, NULL,
+		PT_32BF,
+		1, -1,
+		1, 1,
+		NULL,
+		NULL,
+		testRasterIteratorBlock_callback,
+		&rtnpixel
+	), ES_NONE);
+	CU_ASSERT(rtnpixel != NULL);
+
+	rtnband = rt_raster_get_band(rtn, 0);
+	band = rt_raster_get_band(rtnpixel, 0);
+	for (y = 0; y < maxY; y++) {
+		for (x = 0; x < maxX; x++) {
+			CU_ASSERT_EQUAL(rt_band_get_pixel(rtnband, x, y, &value, &nodata), ES_NONE);
+			CU_ASSERT_EQUAL(rt_band_get_pixel(band, x, y, &pixelvalue, &nodata), ES_NONE);
+			CU_ASSERT_DOUBLE_EQUAL(value, pixelvalue, FLT_EPSILON);
+		}
+	}
+
+	/* 0 + 1 + 5 + 6 */
+	rt_band_get_pixel(rtnband, 0, 0, &value, &nodata);
+	CU_ASSERT_DOUBLE_EQUAL(value, 12, FLT_EPSILON);
+	/* 6 + 7 + 8 + 11 + 13 + 16 + 17 + 18, center is NODATA */
+	rt_band_get_pixel(rtnband, 2, 2, &value, &nodata);
+	CU_ASSERT_DOUBLE_EQUAL(value, 96, FLT_EPSILON);
+
+	cu_free_raster(rtn);
+	cu_free_raster(rtnpixel);
+	rtn = NULL;
+
+	/* minimum, NODATA substituted */
+	kernel.type = KT_MIN;
+	kernel.hassubstitute = 1;
+	kernel.substitute = -10;
+
+	CU_ASSERT_EQUAL(rt_raster_iterator_block(
+		&itrset, 1,
+		ET_FIRST, NULL,
+		PT_32BF,
+		1, -1,
+		1, 1,
+		&kernel,
+		rt_raster_iterator_kernel,
+		&rtn
+	), ES_NONE);
+	rtnband = rt_raster_get_band(rtn, 0);
+	rt_band_get_pixel(rtnband, 4, 4, &value, &nodata);
+	CU_ASSERT_DOUBLE_EQUAL(value, -10, FLT_EPSILON);
+	cu_free_raster(rtn);
+	rtn = NULL;
+
+	/* mean of 1x1 neighborhood is the value, NODATA stays NODATA */
+	kernel.type = KT_MEAN;
+	kernel.hassubstitute = 0;
+
+	CU_ASSERT_EQUAL(rt_raster_iterator_block(
+		&itrset, 1,
+		ET_FIRST, NULL,
+		PT_32BF,
+		1, -1,
+		0, 0,
+		&kernel,
+		rt_raster_iterator_kernel,
+		&rtn
+	), ES_NONE);
+	rtnband = rt_raster_get_band(rtn, 0);
+	rt_band_get_pixel(rtnband, 3, 1, &value, &nodata);
+	CU_ASSERT_DOUBLE_EQUAL(value, 8, FLT_EPSILON);
+	rt_band_get_pixel(rtnband, 2, 2, &value, &nodata);
+	CU_ASSERT_EQUAL(nodata, 1);
+	cu_free_raster(rtn);
+	rtn = NULL;
+
+	/* slope of a plane rising one unit per pixel along X */
+	band = rt_raster_get_band(rast, 0);
+	for (y = 0; y < maxY; y++) {
+		for (x = 0; x < maxX; x++)
+			rt_band_set_pixel(band, x, y, x, NULL);
+	}
+
+	kernel.type = KT_SLOPE;
+	kernel.pixwidth = 1;
+	kernel.pixheight = 1;
+	kernel.scale = 1;
+	kernel.units = SU_DEGREES;
+
+	CU_ASSERT_EQUAL(rt_raster_iterator_block(
+		&itrset, 1,
+		ET_FIRST, NULL,
+		PT_32BF,
+		1, -1,
+		1, 1,
+		&kernel,
+		rt_raster_iterator_kernel,
+		&rtn
+	), ES_NONE);
+	rtnband = rt_raster_get_band(rtn, 0);
+	rt_band_get_pixel(rtnband, 2, 2, &value, &nodata);
+	CU_ASSERT_DOUBLE_EQUAL(value, 45, FLT_EPSILON);
+	cu_free_raster(rtn);
+	rtn = NULL;
+
+	kernel.units = SU_PERCENT;
+	CU_ASSERT_EQUAL(rt_raster_iterator_block(
+		&itrset, 1,
+		ET_FIRST, NULL,
+		PT_32BF,
+		1, -1,
+		1, 1,
+		&kernel,
+		rt_raster_iterator_kernel,
+		&rtn
+	), ES_NONE);
+	rtnband = rt_raster_get_band(rtn, 0);
+	rt_band_get_pixel(rtnband, 1, 3, &value, &nodata);
+	CU_ASSERT_DOUBLE_EQUAL(value, 100, FLT_EPSILON);
+	cu_free_raster(rtn);
+	rtn = NULL;
+
+	/* slope needs a 3x3 neighborhood */
+	cu_error_msg_reset();
+	CU_ASSERT_EQUAL(rt_raster_iterator_block(
+		&itrset, 1,
+		ET_FIRST, NULL,
+		PT_32BF,
+		1, -1,
+		2, 2,
+		&kernel,
+		rt_raster_iterator_kernel,
+		&rtn
+	), ES_ERROR);
+	CU_ASSERT(rtn == NULL);
+
+	cu_free_raster(rast);
+}
+
 /* register tests */
 void mapalgebra_suite_setup(void);
 void mapalgebra_suite_setup(void)
 {
 	CU_pSuite suite = CU_add_suite("mapalgebra", NULL, NULL);
 	PG_ADD_TEST(suite, test_raster_iterator);
+	PG_ADD_TEST(suite, test_raster_iterator_block);
 	PG_ADD_TEST(suite, test_band_reclass);
 	PG_ADD_TEST(suite, test_raster_colormap);
 }
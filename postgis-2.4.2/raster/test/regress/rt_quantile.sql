@@ -288,4 +288,7 @@ SAVEPOINT test;
 SELECT round(ST_Quantile('test_quantile', 'rast', -1.)::numeric, 3);
 ROLLBACK TO SAVEPOINT test;
 RELEASE SAVEPOINT test;
+SELECT ST_QuantileAgg(rast, 1, TRUE, ARRAY[0, 0.5, 1]::double precision[])::numeric(8, 3)[] FROM test_quantile;
+SELECT ST_QuantileAgg(rast, 1, FALSE, ARRAY[0.995, 0.005]::double precision[])::numeric(8, 3)[] FROM test_quantile;
+SELECT ST_QuantileAgg(rast, NULL::double precision[])::numeric(8, 3)[] FROM test_quantile;
 ROLLBACK;
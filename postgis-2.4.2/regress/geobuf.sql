@@ -19,3 +19,5 @@ SELECT 'T9', encode(ST_AsGeobuf(q, 'geom'), 'base64')
     FROM (SELECT ST_MakePoint(1, 2, 3) as geom) AS q;
 SELECT 'T10', encode(ST_AsGeobuf(q), 'base64')
     FROM (SELECT ST_MakePoint(1, 2, 3) as geom) AS q;
+SELECT 'T11', encode(ST_AsGeobuf(q, 'geom'), 'base64')
+    FROM (SELECT ST_GeomFromText(wkt) as geom FROM (VALUES ('POINT(1 2)'), ('LINESTRING(0 0,1.5 2.25)')) AS v(wkt)) AS q;
@@ -0,0 +1,30 @@
+-- Two overlapping squares
+SELECT 1, ST_AsText(ST_ParallelUnion(g)) FROM (VALUES
+	('POLYGON((0 0, 10 0, 10 10, 0 10, 0 0))'::geometry),
+	('POLYGON((5 5, 15 5, 15 15, 5 15, 5 5))'::geometry)) AS t(g);
+
+-- Null inputs are skipped, all nulls give null
+SELECT 2, ST_AsText(ST_ParallelUnion(g)) FROM (VALUES
+	(NULL::geometry), (NULL::geometry)) AS t(g);
+SELECT 3, ST_AsText(ST_ParallelUnion(g)) FROM (VALUES
+	(NULL::geometry), ('POINT(1 1)'::geometry)) AS t(g);
+
+-- Only empties give the largest empty type
+SELECT 4, ST_AsText(ST_ParallelUnion(g)) FROM (VALUES
+	('POINT EMPTY'::geometry), ('LINESTRING EMPTY'::geometry)) AS t(g);
+
+-- Same result as ST_Union over a larger set
+SELECT 5, ST_Equals(ST_ParallelUnion(g), ST_Union(g)), ST_SRID(ST_ParallelUnion(g))
+FROM (SELECT ST_Buffer(ST_SetSRID(ST_MakePoint(i % 50, i / 50), 4326), 0.7, 2) AS g
+	FROM generate_series(0, 2499) i) AS t;
+
+-- Grouped
+SELECT 6, k, ST_Area(ST_ParallelUnion(g)) FROM (VALUES
+	(1, 'POLYGON((0 0, 2 0, 2 2, 0 2, 0 0))'::geometry),
+	(1, 'POLYGON((1 0, 3 0, 3 2, 1 2, 1 0))'::geometry),
+	(2, 'POLYGON((0 0, 1 0, 1 1, 0 1, 0 0))'::geometry)) AS t(k, g)
+GROUP BY k ORDER BY k;
+
+-- Mixed SRIDs are an error
+SELECT 7, ST_AsText(ST_ParallelUnion(g)) FROM (VALUES
+	('SRID=4326;POINT(0 0)'::geometry), ('SRID=3857;POINT(0 0)'::geometry)) AS t(g);
@@ -58,6 +58,24 @@ SELECT 'scan_idx', qnodes('select * from test where the_geom @ ST_MakePoint(0,0)
 
 DROP INDEX brin_2d;
 
+-- 2D multi-box
+CREATE INDEX brin_2d_multi on test using brin (the_geom brin_geometry_multibox_ops_2d);
+
+set enable_indexscan = off;
+set enable_bitmapscan = on;
+set enable_seqscan = off;
+
+SELECT 'scan_idx', qnodes('select * from test where the_geom && ST_MakePoint(0,0)');
+ select num,ST_astext(the_geom) from test where the_geom && 'BOX(125 125,135 135)'::box2d order by num;
+
+SELECT 'scan_idx', qnodes('select * from test where ST_MakePoint(0,0) ~ the_geom');
+ select num,ST_astext(the_geom) from test where 'BOX(125 125,135 135)'::box2d ~ the_geom order by num;
+
+SELECT 'scan_idx', qnodes('select * from test where the_geom @ ST_MakePoint(0,0)');
+ select num,ST_astext(the_geom) from test where the_geom @ 'BOX(125 125,135 135)'::box2d order by num;
+
+DROP INDEX brin_2d_multi;
+
 -- 3D
 CREATE INDEX brin_3d on test using brin (the_geom brin_geometry_inclusion_ops_3d);
 
@@ -123,6 +141,30 @@ SELECT 'scan_idx', qnodes('select count(*) from test where the_geom && ''BOX(900
 
 DROP INDEX brin_2d;
 
+-- 2D multi-box
+TRUNCATE TABLE test;
+INSERT INTO test select 1, st_makepoint(1, 1);
+CREATE INDEX brin_2d_multi on test using brin (the_geom brin_geometry_multibox_ops_2d) WITH (pages_per_range = 1);
+INSERT INTO test select i, st_makepoint(i, i) FROM generate_series(2, 3) i;
+
+set enable_indexscan = off;
+set enable_bitmapscan = on;
+set enable_seqscan = off;
+
+SELECT 'scan_idx', qnodes('select count(*) from test where the_geom && ''BOX(2.1 2.1, 3.1 3.1)''::box2d');
+ select '2d multi', count(*) from test where the_geom && 'BOX(2.1 2.1, 3.1 3.1)'::box2d;
+
+INSERT INTO test select i, st_makepoint(i, i) FROM generate_series(4, 1000) i;
+SELECT 'scan_idx', qnodes('select count(*) from test where the_geom && ''BOX(900.1 900.1, 920.1 920.1)''::box2d');
+ select '2d multi', count(*) from test where the_geom && 'BOX(900.1 900.1, 920.1 920.1)'::box2d;
+
+SELECT 'summarize 2d multi', brin_summarize_new_values('brin_2d_multi');
+
+SELECT 'scan_idx', qnodes('select count(*) from test where the_geom && ''BOX(900.1 900.1, 920.1 920.1)''::box2d');
+ select '2d multi', count(*) from test where the_geom && 'BOX(900.1 900.1, 920.1 920.1)'::box2d;
+
+DROP INDEX brin_2d_multi;
+
 -- 3D
 TRUNCATE TABLE test;
 INSERT INTO test select 1, st_makepoint(1, 1);
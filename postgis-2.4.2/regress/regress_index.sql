@@ -101,6 +101,22 @@ SELECT 'expr', estimate_error(
   'select num from test where st_centroid(the_geom) && ' || box, tol )
   FROM sample_queries ORDER BY id;
 
+-- GiST index over rows stored in Hilbert order
+
+CREATE TABLE test_sorted AS
+  SELECT * FROM test ORDER BY _ST_SortableHash(the_geom);
+CREATE INDEX quick_gist_sorted on test_sorted using gist (the_geom);
+
+set enable_indexscan = on;
+set enable_bitmapscan = off;
+set enable_seqscan = off;
+
+SELECT 'sorted_scan', qnodes('select * from test_sorted where the_geom && ST_MakePoint(0,0)');
+ select 'sorted', num,ST_astext(the_geom) from test_sorted where the_geom && 'BOX3D(125 125,135 135)'::box3d order by num;
+SELECT 'sorted_count', count(*) FROM test_sorted WHERE the_geom && ST_MakeEnvelope(0,0,500,500);
+SELECT 'empty_first', _ST_SortableHash('POINT EMPTY'::geometry) < _ST_SortableHash('POINT(-1000 -1000)'::geometry);
+
+DROP TABLE test_sorted;
 DROP TABLE test;
 DROP TABLE sample_queries;
 
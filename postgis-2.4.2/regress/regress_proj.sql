@@ -56,5 +56,14 @@ SELECT 12, ST_AsEWKT(ST_Transform(
            ST_GeomFromEWKT('SRID=100002;POINT(16 48)'),
            'invalid projection'));
 
+--- test #13: a changed definition is picked up by the next transform
+SELECT 13, count(*) FROM pg_trigger
+	WHERE tgrelid = 'spatial_ref_sys'::regclass
+	AND tgname = 'spatial_ref_sys_cache_invalidate';
+UPDATE spatial_ref_sys
+	SET proj4text = '+proj=utm +zone=32 +ellps=WGS84 +datum=WGS84 +units=m +no_defs '
+	WHERE srid = 100001;
+SELECT 13, ST_AsEWKT(ST_SnapToGrid(ST_transform(ST_GeomFromEWKT('SRID=100002;POINT(16 48)'),100001),10));
+
 DELETE FROM spatial_ref_sys WHERE srid >= 100000;
 
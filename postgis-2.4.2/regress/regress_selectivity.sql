@@ -2181,6 +2181,11 @@ select 'selectivity_09', 'estimated', _postgis_selectivity('regular_overdots','g
 select 'selectivity_10', 'actual', 1;
 select 'selectivity_09', 'estimated', _postgis_selectivity('regular_overdots','g','LINESTRING(0 0, 12 12)');
 
+-- Self join
+select 'selectivity_11', count(*) from regular_overdots a, regular_overdots b where a.g && b.g;
+select 'selectivity_12', 'actual', round(80595.0/(2127.0*2127.0),3);
+select 'selectivity_13', 'estimated', round(_postgis_join_selectivity('regular_overdots','g','regular_overdots','g')::numeric,3);
+
 -- Clean
 drop table if exists regular_overdots;
 drop table if exists regular_overdots_ab;
@@ -1036,6 +1036,17 @@ sub run_loader_test
 	}
 	drop_table($tblname);
 
+	# Binary COPY must load the same rows as the wkb mode. Reprojection is not
+	# available with -B.
+	if ( $custom_opts !~ /-s\s*\d+:/ )
+	{
+		if( ! run_loader_and_check_output("wkb binary copy test", $tblname, "${TEST}-B.sql.expected", "${TEST}.select.expected", "-B ${TMPDIR}/loader.copy -j 2 $custom_opts", "true") )
+		{
+			return 0;
+		}
+		drop_table($tblname);
+	}
+
 	# Some custom parameters can be incompatible with -D.
 	if ( $custom_opts )
 	{
@@ -1177,6 +1188,18 @@ sub run_raster_loader_test
 
 	drop_table($tblname);
 
+	# Binary COPY must load the same rows. It is not available with -Y or
+	# reprojection.
+	if ( $custom_opts !~ /-Y/ && $custom_opts !~ /-s\s*\d*:/ )
+	{
+		if ( ! run_raster_loader_and_check_output("binary copy test", $tblname, "${TEST}-B.sql.expected", "${TEST}.select.expected", "-B ${TMPDIR}/loader.copy -j 2 $custom_opts", "true") )
+		{
+			return 0;
+		}
+
+		drop_table($tblname);
+	}
+
 	return 1;
 }
 
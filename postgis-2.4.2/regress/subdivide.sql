@@ -41,3 +41,15 @@ from (
          select ST_Subdivide(geom) geom
          from inverted_geom
      ) z;
+
+-- holes with edges on the medians: pieces stay valid, with no repeated points
+WITH g AS (SELECT geom FROM (VALUES
+('POLYGON((0 0,10 0,10 10,0 10,0 0),(2 2,8 2,8 8,2 8,2 2))'::geometry),
+('POLYGON((0 0,30 0,30 30,0 30,0 0),(5 5,10 5,10 10,5 10,5 5),(20 5,25 5,25 10,20 10,20 5),
+(5 20,10 20,10 25,5 25,5 20),(15 15,22.5 15,22.5 20,15 20,15 15))'::geometry),
+('POLYGON((0 0,39 0,39 39,0 39,0 0),(1 2,1 9,12 9,12 2,1 2),(20 3,20 9,24 9,24 3,20 3))'::geometry)
+) AS v(geom))
+, gs AS (SELECT ST_SubDivide(geom,8) As geom FROM g)
+SELECT '4' As rn, (SELECT SUM(ST_Area(geom)) FROM g)::numeric(10,3) = SUM(ST_Area(gs.geom))::numeric(10,3),
+	bool_and(ST_IsValid(geom)), bool_and(ST_NPoints(geom) = ST_NPoints(ST_RemoveRepeatedPoints(geom))), COUNT(geom) As num_pieces
+FROM gs;
@@ -2029,9 +2029,8 @@ cb_updateTopoGeomEdgeSplit ( const LWT_BE_TOPOLOGY* topo,
       appendStringInfo(sql, "(%d,%d,%" LWTFMT_ELEMID ",%d)",
         topogeo_id, layer_id, negate ? -new_edge1 : new_edge1, element_type);
       if ( new_edge2 != -1 ) {
-        resetStringInfo(sql);
         appendStringInfo(sql,
-          ",VALUES (%d,%d,%" LWTFMT_ELEMID ",%d",
+          ",(%d,%d,%" LWTFMT_ELEMID ",%d)",
           topogeo_id, layer_id, negate ? -new_edge2 : new_edge2, element_type);
       }
     }
@@ -2890,6 +2889,67 @@ cb_getFaceWithinBox2D ( const LWT_BE_TOPOLOGY* topo, const GBOX* box,
   return faces;
 }
 
+static int
+cb_reserveElementIds( const LWT_BE_TOPOLOGY* topo, int elemtype,
+                      LWT_ELEMID* ids, int numelems )
+{
+  MemoryContext oldcontext = CurrentMemoryContext;
+	int spi_result;
+  StringInfoData sqldata;
+  StringInfo sql = &sqldata;
+  const char *seqname;
+  bool isnull;
+  Datum dat;
+  int i;
+
+  switch ( elemtype )
+  {
+    case LWT_ELEM_NODE: seqname = "node_node_id_seq"; break;
+    case LWT_ELEM_EDGE: seqname = "edge_data_edge_id_seq"; break;
+    case LWT_ELEM_FACE: seqname = "face_face_id_seq"; break;
+    default:
+      cberror(topo->be_data, "unknown element type %d", elemtype);
+      return 0;
+  }
+
+  initStringInfo(sql);
+  appendStringInfo(sql, "SELECT nextval('\"%s\".%s') "
+                        "FROM generate_series(1,%d)",
+                        topo->name, seqname, numelems);
+  spi_result = SPI_execute(sql->data, false, numelems);
+  MemoryContextSwitchTo( oldcontext ); /* switch back */
+  if ( spi_result != SPI_OK_SELECT ) {
+		cberror(topo->be_data, "unexpected return (%d) from query execution: %s",
+            spi_result, sql->data);
+    pfree(sqldata.data);
+	  return 0;
+  }
+  pfree(sqldata.data);
+
+  if ( SPI_processed ) topo->be_data->data_changed = true;
+
+  if ( SPI_processed != (uint64)numelems ) {
+    cberror(topo->be_data, "processed " UINT64_FORMAT " rows, expected %d",
+            (uint64)SPI_processed, numelems);
+    return 0;
+  }
+
+  for ( i=0; i<numelems; ++i )
+  {
+    dat = SPI_getbinval( SPI_tuptable->vals[i],
+                         SPI_tuptable->tupdesc, 1, &isnull );
+    if ( isnull ) {
+      cberror(topo->be_data, "nextval for %s returned null", seqname);
+      return 0;
+    }
+    ids[i] = DatumGetInt64(dat); /* sequences return 64bit integers */
+  }
+
+  SPI_freetuptable(SPI_tuptable);
+
+  return 1;
+}
+
 
 static LWT_BE_CALLBACKS be_callbacks = {
     cb_lastErrorMessage,
@@ -2929,7 +2989,8 @@ static LWT_BE_CALLBACKS be_callbacks = {
     cb_updateTopoGeomFaceHeal,
     cb_checkTopoGeomRemNode,
     cb_updateTopoGeomEdgeHeal,
-    cb_getFaceWithinBox2D
+    cb_getFaceWithinBox2D,
+    cb_reserveElementIds
 };
 
 static void
@@ -4589,3 +4650,184 @@ Datum TopoGeo_AddPolygon(PG_FUNCTION_ARGS)
 
   SRF_RETURN_NEXT(funcctx, result);
 }
+
+/*
+ * Add all geometries of an array with a single bulk load session,
+ * for TopoGeo_AddPolygons and TopoGeo_AddLinestrings
+ */
+static Datum
+_topogeo_add_geometries(FunctionCallInfo fcinfo, int type, const char *fname)
+{
+  text* toponame_text;
+  char* toponame;
+  double tol;
+  LWT_ELEMID *elems = NULL;
+  int nelems = 0;
+  ArrayType *array;
+  ArrayIterator iterator;
+  Datum value;
+  bool isnull;
+  LWT_TOPOLOGY *topo, *bulk;
+  FuncCallContext *funcctx;
+  MemoryContext oldcontext, newcontext;
+  FACEEDGESSTATE *state;
+  Datum result;
+  LWT_ELEMID id;
+
+  if (SRF_IS_FIRSTCALL())
+  {
+    POSTGIS_DEBUGF(1, "%s first call", fname);
+    funcctx = SRF_FIRSTCALL_INIT();
+    newcontext = funcctx->multi_call_memory_ctx;
+
+    if ( PG_ARGISNULL(0) || PG_ARGISNULL(1) || PG_ARGISNULL(2) ) {
+      lwpgerror("SQL/MM Spatial exception - null argument");
+      PG_RETURN_NULL();
+    }
+
+    toponame_text = PG_GETARG_TEXT_P(0);
+    toponame = text2cstring(toponame_text);
+    PG_FREE_IF_COPY(toponame_text, 0);
+
+    array = PG_GETARG_ARRAYTYPE_P(1);
+
+    tol = PG_GETARG_FLOAT8(2);
+    if ( tol < 0 )
+    {
+      lwpgerror("Tolerance must be >=0");
+      PG_RETURN_NULL();
+    }
+
+    if ( SPI_OK_CONNECT != SPI_connect() ) {
+      lwpgerror("Could not connect to SPI");
+      PG_RETURN_NULL();
+    }
+
+    {
+      int pre = be_data.topoLoadFailMessageFlavor;
+      be_data.topoLoadFailMessageFlavor = 1;
+      topo = lwt_LoadTopology(be_iface, toponame);
+      be_data.topoLoadFailMessageFlavor = pre;
+    }
+    oldcontext = MemoryContextSwitchTo( newcontext );
+    pfree(toponame);
+    if ( ! topo ) {
+      /* should never reach this point, as lwerror would raise an exception */
+      SPI_finish();
+      PG_RETURN_NULL();
+    }
+
+    POSTGIS_DEBUG(1, "Calling lwt_BeginBulkLoad");
+    bulk = lwt_BeginBulkLoad(topo);
+
+#if POSTGIS_PGSQL_VERSION >= 95
+    iterator = array_create_iterator(array, 0, NULL);
+#else
+    iterator = array_create_iterator(array, 0);
+#endif
+
+    while( array_iterate(iterator, &value, &isnull) )
+    {
+      GSERIALIZED *geom;
+      LWGEOM *lwgeom;
+      LWT_ELEMID *ids;
+      int nids;
+
+      /* Skip null array items */
+      if ( isnull ) continue;
+
+      geom = (GSERIALIZED *)DatumGetPointer(value);
+      lwgeom = lwgeom_from_gserialized(geom);
+      if ( lwgeom->type != type ) {{
+        char buf[32];
+        _lwtype_upper_name(lwgeom_get_type(lwgeom), buf, 32);
+        lwgeom_free(lwgeom);
+        lwpgerror("Invalid geometry type (%s) passed to %s, expected %s",
+                  buf, fname, type == POLYGONTYPE ? "POLYGON" : "LINESTRING");
+        PG_RETURN_NULL();
+      }}
+
+      if ( type == POLYGONTYPE )
+        ids = lwt_AddPolygon(bulk, lwgeom_as_lwpoly(lwgeom), tol, &nids);
+      else
+        ids = lwt_AddLine(bulk, lwgeom_as_lwline(lwgeom), tol, &nids);
+      lwgeom_free(lwgeom);
+
+      if ( nids < 0 ) {
+        /* should never reach this point, as lwerror would raise an exception */
+        lwt_FreeTopology(bulk);
+        lwt_FreeTopology(topo);
+        SPI_finish();
+        PG_RETURN_NULL();
+      }
+      if ( nids )
+      {
+        elems = elems ? lwrealloc(elems, sizeof(LWT_ELEMID) * (nelems + nids))
+                      : lwalloc(sizeof(LWT_ELEMID) * nids);
+        memcpy(elems + nelems, ids, sizeof(LWT_ELEMID) * nids);
+        nelems += nids;
+        lwfree(ids);
+      }
+    }
+    array_free_iterator(iterator);
+
+    POSTGIS_DEBUG(1, "Calling lwt_EndBulkLoad");
+    if ( lwt_EndBulkLoad(bulk) != 0 ) {
+      /* should never reach this point, as lwerror would raise an exception */
+      lwt_FreeTopology(topo);
+      SPI_finish();
+      PG_RETURN_NULL();
+    }
+    lwt_FreeTopology(topo);
+
+    state = lwalloc(sizeof(FACEEDGESSTATE));
+    state->elems = elems;
+    state->nelems = nelems;
+    state->curr = 0;
+    funcctx->user_fctx = state;
+
+    POSTGIS_DEBUGF(1, "%s calling SPI_finish", fname);
+
+    MemoryContextSwitchTo(oldcontext);
+
+    SPI_finish();
+  }
+
+  POSTGIS_DEBUG(1, "Per-call invocation");
+
+  /* stuff done on every call of the function */
+  funcctx = SRF_PERCALL_SETUP();
+
+  /* get state */
+  state = funcctx->user_fctx;
+
+  if ( state->curr == state->nelems )
+  {
+    POSTGIS_DEBUG(1, "We're done, cleaning up all");
+    SRF_RETURN_DONE(funcctx);
+  }
+
+  id = state->elems[state->curr++];
+  POSTGIS_DEBUGF(1, "%s: cur:%d, val:%" LWTFMT_ELEMID,
+                    fname, state->curr-1, id);
+
+  result = Int32GetDatum((int32)id);
+
+  SRF_RETURN_NEXT(funcctx, result);
+}
+
+/*  TopoGeo_AddPolygons(atopology, polys, tolerance) */
+Datum TopoGeo_AddPolygons(PG_FUNCTION_ARGS);
+PG_FUNCTION_INFO_V1(TopoGeo_AddPolygons);
+Datum TopoGeo_AddPolygons(PG_FUNCTION_ARGS)
+{
+  return _topogeo_add_geometries(fcinfo, POLYGONTYPE, "TopoGeo_AddPolygons");
+}
+
+/*  TopoGeo_AddLinestrings(atopology, lines, tolerance) */
+Datum TopoGeo_AddLinestrings(PG_FUNCTION_ARGS);
+PG_FUNCTION_INFO_V1(TopoGeo_AddLinestrings);
+Datum TopoGeo_AddLinestrings(PG_FUNCTION_ARGS)
+{
+  return _topogeo_add_geometries(fcinfo, LINETYPE, "TopoGeo_AddLinestrings");
+}
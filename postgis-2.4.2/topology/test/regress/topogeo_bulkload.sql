@@ -0,0 +1,155 @@
+\set VERBOSITY terse
+set client_min_messages to ERROR;
+
+-- Overlapping squares, on rows shifted by half a square
+CREATE TABLE bulk_polys (id int, g geometry);
+INSERT INTO bulk_polys
+SELECT x * 5 + y, ST_Expand(ST_MakePoint(x * 6 + (y % 2) * 3, y * 6), 4)
+FROM generate_series(0,4) x, generate_series(0,4) y;
+INSERT INTO bulk_polys VALUES (25, NULL);
+
+-- Crossing lines, some ends within tolerance of others
+CREATE TABLE bulk_lines (id int, g geometry);
+INSERT INTO bulk_lines
+SELECT i, ST_MakeLine(ST_MakePoint(i * 5, -1), ST_MakePoint(i * 5 + 7, 31))
+FROM generate_series(0,5) i;
+INSERT INTO bulk_lines
+SELECT 6 + i, ST_MakeLine(ST_MakePoint(-1, i * 6.2), ST_MakePoint(33, i * 6 + 0.1))
+FROM generate_series(0,5) i;
+
+CREATE FUNCTION bulk_add_one_by_one(atopology text, tab text, tol float8)
+RETURNS int AS $$
+DECLARE
+  rec RECORD;
+  n int := 0;
+BEGIN
+  FOR rec IN EXECUTE 'SELECT g FROM ' || tab || ' WHERE g IS NOT NULL ORDER BY id'
+  LOOP
+    IF GeometryType(rec.g) = 'POLYGON' THEN
+      PERFORM TopoGeo_AddPolygon(atopology, rec.g, tol);
+    ELSE
+      PERFORM TopoGeo_AddLinestring(atopology, rec.g, tol);
+    END IF;
+    n := n + 1;
+  END LOOP;
+  RETURN n;
+END
+$$ LANGUAGE 'plpgsql';
+
+-- Compare the primitives of two topologies, ignoring identifiers
+CREATE FUNCTION bulk_compare(t1 text, t2 text)
+RETURNS TABLE (o text) AS $$
+DECLARE
+  rec RECORD;
+BEGIN
+  FOR rec IN EXECUTE '
+    SELECT ''nodes'' w, (SELECT count(*) FROM ' || quote_ident(t1) || '.node) = (SELECT count(*) FROM ' || quote_ident(t2) || '.node) ok
+    UNION ALL
+    SELECT ''edges'', (SELECT count(*) FROM ' || quote_ident(t1) || '.edge) = (SELECT count(*) FROM ' || quote_ident(t2) || '.edge)
+    UNION ALL
+    SELECT ''faces'', (SELECT count(*) FROM ' || quote_ident(t1) || '.face) = (SELECT count(*) FROM ' || quote_ident(t2) || '.face)
+    UNION ALL
+    SELECT ''node_geoms'', NOT EXISTS ( SELECT 1 FROM ' || quote_ident(t1) || '.node a WHERE NOT EXISTS (
+      SELECT 1 FROM ' || quote_ident(t2) || '.node b WHERE b.geom ~= a.geom
+        AND (b.containing_face IS NULL) = (a.containing_face IS NULL) ) )
+    UNION ALL
+    SELECT ''edge_geoms'', NOT EXISTS ( SELECT 1 FROM ' || quote_ident(t1) || '.edge a WHERE NOT EXISTS (
+      SELECT 1 FROM ' || quote_ident(t2) || '.edge b WHERE b.geom ~= a.geom
+        AND ST_Equals(b.geom, a.geom) ) )
+    UNION ALL
+    SELECT ''face_geoms'', NOT EXISTS ( SELECT 1 FROM ' || quote_ident(t1) || '.face a WHERE a.face_id > 0
+      AND NOT EXISTS ( SELECT 1 FROM ' || quote_ident(t2) || '.face b WHERE b.face_id > 0
+        AND b.mbr ~= a.mbr
+        AND ST_Equals(ST_GetFaceGeometry(' || quote_literal(t1) || ', a.face_id),
+                      ST_GetFaceGeometry(' || quote_literal(t2) || ', b.face_id)) ) )
+    UNION ALL
+    SELECT ''valid'', NOT EXISTS ( SELECT 1 FROM ValidateTopology(' || quote_literal(t2) || ') )
+    '
+  LOOP
+    o := rec.w || '|' || rec.ok;
+    RETURN NEXT;
+  END LOOP;
+END
+$$ LANGUAGE 'plpgsql';
+
+-- Polygons
+SELECT 'p.start', CreateTopology('bulk_incr') > 0, CreateTopology('bulk_load') > 0;
+SELECT 'p.incr', bulk_add_one_by_one('bulk_incr', 'bulk_polys', 0);
+CREATE TABLE bulk_faces AS SELECT TopoGeo_AddPolygons('bulk_load',
+  ( SELECT array_agg(g ORDER BY id) FROM bulk_polys )) f;
+SELECT 'p', bulk_compare('bulk_incr', 'bulk_load');
+-- Every face was returned, as the squares cover all of them
+SELECT 'p.faces', count(DISTINCT f) = (SELECT count(*) - 1 FROM bulk_load.face)
+  FROM bulk_faces;
+-- Add on top of a bulk loaded topology
+SELECT 'p.incr2', bulk_add_one_by_one('bulk_incr', 'bulk_lines', 0);
+SELECT 'p.load2', count(*) > 0 FROM TopoGeo_AddLinestrings('bulk_load',
+  ( SELECT array_agg(g ORDER BY id) FROM bulk_lines ));
+SELECT 'p2', bulk_compare('bulk_incr', 'bulk_load');
+SELECT 'p.end', DropTopology('bulk_incr'), DropTopology('bulk_load');
+DROP TABLE bulk_faces;
+
+-- Lines, with a tolerance
+SELECT 'l.start', CreateTopology('bulk_incr') > 0, CreateTopology('bulk_load') > 0;
+SELECT 'l.incr', bulk_add_one_by_one('bulk_incr', 'bulk_lines', 0.5);
+SELECT 'l.load', count(*) > 0 FROM TopoGeo_AddLinestrings('bulk_load',
+  ( SELECT array_agg(g ORDER BY id) FROM bulk_lines ), 0.5);
+SELECT 'l', bulk_compare('bulk_incr', 'bulk_load');
+SELECT 'l.end', DropTopology('bulk_incr'), DropTopology('bulk_load');
+
+-- TopoGeometry objects, whose primitives get split by the load
+CREATE FUNCTION bulk_layer(atopology text, tab text)
+RETURNS int AS $$
+  SELECT l.layer_id FROM topology.layer l, topology.topology t
+  WHERE l.topology_id = t.id AND t.name = $1 AND l.table_name = $2
+$$ LANGUAGE 'sql';
+CREATE TABLE bulk_area (id int, g geometry);
+INSERT INTO bulk_area VALUES (1, 'POLYGON((2 2,2 28,28 28,28 2,2 2))');
+CREATE TABLE bulk_path (id int, g geometry);
+INSERT INTO bulk_path VALUES (1, 'LINESTRING(0 13,32 13)');
+SELECT 't.start', CreateTopology('bulk_incr') > 0, CreateTopology('bulk_load') > 0;
+SELECT 't.layers',
+  AddTopoGeometryColumn('bulk_incr', 'public', 'bulk_area', 'tg_incr', 'POLYGON') > 0,
+  AddTopoGeometryColumn('bulk_load', 'public', 'bulk_area', 'tg_load', 'POLYGON') > 0,
+  AddTopoGeometryColumn('bulk_incr', 'public', 'bulk_path', 'tg_incr', 'LINE') > 0,
+  AddTopoGeometryColumn('bulk_load', 'public', 'bulk_path', 'tg_load', 'LINE') > 0;
+UPDATE bulk_area SET
+  tg_incr = toTopoGeom(g, 'bulk_incr', bulk_layer('bulk_incr', 'bulk_area')),
+  tg_load = toTopoGeom(g, 'bulk_load', bulk_layer('bulk_load', 'bulk_area'));
+UPDATE bulk_path SET
+  tg_incr = toTopoGeom(g, 'bulk_incr', bulk_layer('bulk_incr', 'bulk_path')),
+  tg_load = toTopoGeom(g, 'bulk_load', bulk_layer('bulk_load', 'bulk_path'));
+-- Every line splits the path and the area, most of them more than once
+SELECT 't.incr', bulk_add_one_by_one('bulk_incr', 'bulk_lines', 0);
+SELECT 't.load', count(*) > 0 FROM TopoGeo_AddLinestrings('bulk_load',
+  ( SELECT array_agg(g ORDER BY id) FROM bulk_lines ));
+SELECT 't', bulk_compare('bulk_incr', 'bulk_load');
+SELECT 't.area', ST_Equals(tg_incr::geometry, tg_load::geometry),
+  ST_Area(tg_load::geometry) > 600 FROM bulk_area;
+SELECT 't.path', ST_Equals(tg_incr::geometry, tg_load::geometry),
+  ST_Length(tg_load::geometry) > 31 FROM bulk_path;
+SELECT 't.relation',
+  (SELECT count(*) FROM bulk_incr.relation) = (SELECT count(*) FROM bulk_load.relation),
+  (SELECT count(*) FROM bulk_load.relation) > 20;
+SELECT 't.end', DropTopology('bulk_incr'), DropTopology('bulk_load');
+DROP TABLE bulk_path;
+DROP TABLE bulk_area;
+DROP FUNCTION bulk_layer(text, text);
+
+-- Errors
+SELECT 'e.start', CreateTopology('bulk_load') > 0;
+SELECT TopoGeo_AddPolygons('bulk_load', ARRAY['LINESTRING(0 0,10 0)'::geometry]);
+SELECT TopoGeo_AddLinestrings('bulk_load', ARRAY['POINT(0 0)'::geometry]);
+SELECT TopoGeo_AddPolygons('invalid', ARRAY['POLYGON((0 0,1 0,1 1,0 0))'::geometry]);
+SELECT TopoGeo_AddPolygons('bulk_load', ARRAY['POLYGON((0 0,1 0,1 1,0 0))'::geometry], -1);
+-- Nothing was written
+SELECT 'e.empty', (SELECT count(*) FROM bulk_load.edge) = 0;
+-- Empty and all-null arrays
+SELECT 'e.none', count(*) FROM TopoGeo_AddPolygons('bulk_load', '{}'::geometry[]);
+SELECT 'e.null', count(*) FROM TopoGeo_AddPolygons('bulk_load', ARRAY[NULL::geometry]);
+SELECT 'e.end', DropTopology('bulk_load');
+
+DROP FUNCTION bulk_compare(text, text);
+DROP FUNCTION bulk_add_one_by_one(text, text, float8);
+DROP TABLE bulk_lines;
+DROP TABLE bulk_polys;